@@ -0,0 +1,366 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/ICanny.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/internal/RunLabeling.h>
+#include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/Exception.h>
+
+#include <vector>
+
+namespace cvt {
+
+    enum ICannyDirection {
+        ICANNY_HORIZONTAL,
+        ICANNY_VERTICAL,
+        ICANNY_DIAGUP,
+        ICANNY_DIAGDOWN
+    };
+
+    enum ICannyClass {
+        ICANNY_NOEDGE = 0,
+        ICANNY_WEAK   = 1,
+        ICANNY_STRONG = 2
+    };
+
+    /* horizontal run of weak or strong candidates [ xs, xe ] in row y */
+    struct ICannyRun {
+        int     y;
+        int     xs;
+        int     xe;
+    };
+
+    /* rows processed by one task */
+    struct ICannyStrip {
+        typedef ICannyRun       RunType;
+        int                     y0, y1;
+        std::vector<ICannyRun>  runs;
+        std::vector<uint32_t>   parent;
+        std::vector<uint8_t>    strong;
+    };
+
+    /* gradient direction quantized to 45 degrees, tan( 67.5 ) = 2.4142 and tan( 22.5 ) = 0.41421 */
+    static inline uint8_t _cannyDirection( int32_t gx, int32_t gy )
+    {
+        int32_t ax = gx < 0 ? -gx : gx;
+        int32_t ay = gy < 0 ? -gy : gy;
+        if( ay && ( ay << 12 ) >= ax * 9889 )
+            return ICANNY_VERTICAL;
+        if( ay && ( ay << 12 ) >= ax * 1697 )
+            return ( gx > 0 ) ^ ( gy > 0 ) ? ICANNY_DIAGDOWN : ICANNY_DIAGUP;
+        return ICANNY_HORIZONTAL;
+    }
+
+    static inline uint8_t _cannyDirection( float gx, float gy )
+    {
+        float ax = Math::abs( gx );
+        float ay = Math::abs( gy );
+        if( ay > 0.0f && ay >= 2.4142f * ax )
+            return ICANNY_VERTICAL;
+        if( ay > 0.0f && ay >= 0.41421f * ax )
+            return ( gx > 0 ) ^ ( gy > 0 ) ? ICANNY_DIAGDOWN : ICANNY_DIAGUP;
+        return ICANNY_HORIZONTAL;
+    }
+
+    /* separable gradient with weights ( wa, wb, wa ) across the derivative */
+    template<typename T, typename A>
+    static inline void _cannyGradient( A* mag, uint8_t* dir, const T* r0, const T* r1, const T* r2, int xl, int x, int xr, A wa, A wb )
+    {
+        A gx = wa * ( ( A ) r0[ xr ] - ( A ) r0[ xl ] + ( A ) r2[ xr ] - ( A ) r2[ xl ] ) + wb * ( ( A ) r1[ xr ] - ( A ) r1[ xl ] );
+        A gy = wa * ( ( A ) r2[ xl ] - ( A ) r0[ xl ] + ( A ) r2[ xr ] - ( A ) r0[ xr ] ) + wb * ( ( A ) r2[ x ] - ( A ) r0[ x ] );
+        mag[ x ] = gx * gx + gy * gy;
+        dir[ x ] = _cannyDirection( gx, gy );
+    }
+
+    /* squared gradient magnitude and direction of one row of a GRAY_UINT8 or GRAY_FLOAT image, borders replicated */
+    template<typename T, typename A>
+    class ICannyImageSource {
+        public:
+            ICannyImageSource( const Image& img, const Image&, A wa, A wb ) :
+                _map( img ), _width( img.width() ), _height( img.height() ), _wa( wa ), _wb( wb )
+            {
+            }
+
+            void row( A* mag, uint8_t* dir, int y )
+            {
+                const T* r0 = ( const T* ) _map.line( y > 0 ? y - 1 : 0 );
+                const T* r1 = ( const T* ) _map.line( y );
+                const T* r2 = ( const T* ) _map.line( y < _height - 1 ? y + 1 : _height - 1 );
+                int w = _width;
+
+                _cannyGradient( mag, dir, r0, r1, r2, 0, 0, 1, _wa, _wb );
+                for( int x = 1; x < w - 1; x++ )
+                    _cannyGradient( mag, dir, r0, r1, r2, x - 1, x, x + 1, _wa, _wb );
+                _cannyGradient( mag, dir, r0, r1, r2, w - 2, w - 1, w - 1, _wa, _wb );
+            }
+
+        private:
+            IMapScoped<const uint8_t>   _map;
+            int                         _width;
+            int                         _height;
+            A                           _wa, _wb;
+    };
+
+    /* squared gradient magnitude and direction from two GRAY_FLOAT gradient images */
+    class ICannyGradientSource {
+        public:
+            ICannyGradientSource( const Image& gradx, const Image& grady, float, float ) :
+                _mapx( gradx ), _mapy( grady ), _width( gradx.width() )
+            {
+            }
+
+            void row( float* mag, uint8_t* dir, int y )
+            {
+                const float* gx = _mapx.line( y );
+                const float* gy = _mapy.line( y );
+                for( int x = 0; x < _width; x++ ) {
+                    mag[ x ] = gx[ x ] * gx[ x ] + gy[ x ] * gy[ x ];
+                    dir[ x ] = _cannyDirection( gx[ x ], gy[ x ] );
+                }
+            }
+
+        private:
+            IMapScoped<const float> _mapx;
+            IMapScoped<const float> _mapy;
+            int                     _width;
+    };
+
+    /* non-maximum suppression of row m1 against its neighbours along the gradient */
+    template<typename A>
+    static inline void _cannySuppress( uint8_t* cls, const A* m0, const A* m1, const A* m2, const uint8_t* dir, int w, A low, A high )
+    {
+        cls[ 0 ] = ICANNY_NOEDGE;
+        cls[ w - 1 ] = ICANNY_NOEDGE;
+        for( int x = 1; x < w - 1; x++ ) {
+            A m = m1[ x ];
+            uint8_t c = ICANNY_NOEDGE;
+            if( m >= low ) {
+                A n0, n1;
+                switch( dir[ x ] ) {
+                    case ICANNY_HORIZONTAL: n0 = m1[ x - 1 ]; n1 = m1[ x + 1 ]; break;
+                    case ICANNY_VERTICAL:   n0 = m0[ x ];     n1 = m2[ x ];     break;
+                    case ICANNY_DIAGDOWN:   n0 = m0[ x + 1 ]; n1 = m2[ x - 1 ]; break;
+                    default:                n0 = m0[ x - 1 ]; n1 = m2[ x + 1 ]; break;
+                }
+                if( n0 <= m && n1 <= m )
+                    c = m >= high ? ICANNY_STRONG : ICANNY_WEAK;
+            }
+            cls[ x ] = c;
+        }
+    }
+
+    /* runs of candidates in one row, a run is strong if it contains a strong candidate */
+    static inline void _cannyRowRuns( ICannyStrip& strip, const uint8_t* cls, int w, int y, size_t prevBegin, size_t prevEnd )
+    {
+        size_t curBegin = strip.runs.size();
+        _runRow( strip, cls, w, y, prevBegin, prevEnd, 1 );
+        for( size_t i = curBegin; i < strip.runs.size(); i++ ) {
+            uint8_t strong = 0;
+            for( int x = strip.runs[ i ].xs; x <= strip.runs[ i ].xe; x++ )
+                strong |= cls[ x ] & ICANNY_STRONG;
+            strip.strong.push_back( strong );
+        }
+    }
+
+    template<typename Source, typename A>
+    class ICannyStripTask {
+        public:
+            ICannyStripTask( std::vector<ICannyStrip>& strips, const Image& one, const Image& two, A wa, A wb, A low, A high ) :
+                _strips( strips ), _one( one ), _two( two ), _wa( wa ), _wb( wb ), _low( low ), _high( high )
+            {
+            }
+
+            void operator()( size_t begin, size_t end ) const
+            {
+                int w = _one.width();
+                int h = _one.height();
+                Source src( _one, _two, _wa, _wb );
+                ScopedBuffer<A, true> mag( 3 * w );
+                ScopedBuffer<uint8_t, true> dir( 3 * w );
+                ScopedBuffer<uint8_t, true> cls( w );
+
+                for( size_t s = begin; s < end; s++ ) {
+                    ICannyStrip& strip = _strips[ s ];
+                    strip.runs.clear();
+                    strip.parent.clear();
+                    strip.strong.clear();
+
+                    /* the first and the last row contain no edges */
+                    int ys = Math::max( strip.y0, 1 );
+                    int ye = Math::min( strip.y1, h - 1 );
+                    if( ys >= ye )
+                        continue;
+
+                    /* rolling buffer of three magnitude rows, row y in slot y % 3 */
+                    src.row( mag.ptr() + ( ( ys - 1 ) % 3 ) * w, dir.ptr() + ( ( ys - 1 ) % 3 ) * w, ys - 1 );
+                    src.row( mag.ptr() + ( ys % 3 ) * w, dir.ptr() + ( ys % 3 ) * w, ys );
+
+                    size_t prevBegin = 0, prevEnd = 0;
+                    for( int y = ys; y < ye; y++ ) {
+                        src.row( mag.ptr() + ( ( y + 1 ) % 3 ) * w, dir.ptr() + ( ( y + 1 ) % 3 ) * w, y + 1 );
+                        _cannySuppress( cls.ptr(), mag.ptr() + ( ( y - 1 ) % 3 ) * w, mag.ptr() + ( y % 3 ) * w,
+                                        mag.ptr() + ( ( y + 1 ) % 3 ) * w, dir.ptr() + ( y % 3 ) * w, w, _low, _high );
+                        size_t curBegin = strip.runs.size();
+                        _cannyRowRuns( strip, cls.ptr(), w, y, prevBegin, prevEnd );
+                        prevBegin = curBegin;
+                        prevEnd = strip.runs.size();
+                    }
+                }
+            }
+
+        private:
+            std::vector<ICannyStrip>&   _strips;
+            const Image&                _one;
+            const Image&                _two;
+            A                           _wa, _wb;
+            A                           _low, _high;
+    };
+
+    class ICannyFill {
+        public:
+            ICannyFill( const std::vector<ICannyStrip>& strips, const std::vector<size_t>& offsets, const std::vector<uint8_t>& edge, Image& out ) :
+                _strips( strips ), _offsets( offsets ), _edge( edge ), _out( out )
+            {
+            }
+
+            void operator()( size_t begin, size_t end ) const
+            {
+                IMapScoped<float> map( _out );
+                size_t width = _out.width();
+                for( size_t s = begin; s < end; s++ ) {
+                    const ICannyStrip& strip = _strips[ s ];
+                    size_t r = 0;
+                    map.setLine( strip.y0 );
+                    for( int y = strip.y0; y < strip.y1; y++ ) {
+                        float* ptr = map.ptr();
+                        for( size_t x = 0; x < width; x++ )
+                            ptr[ x ] = 0.0f;
+                        for( ; r < strip.runs.size() && strip.runs[ r ].y == y; r++ ) {
+                            if( !_edge[ _offsets[ s ] + r ] )
+                                continue;
+                            for( int x = strip.runs[ r ].xs; x <= strip.runs[ r ].xe; x++ )
+                                ptr[ x ] = 1.0f;
+                        }
+                        map++;
+                    }
+                }
+            }
+
+        private:
+            const std::vector<ICannyStrip>& _strips;
+            const std::vector<size_t>&      _offsets;
+            const std::vector<uint8_t>&     _edge;
+            Image&                          _out;
+    };
+
+    /* joins the strips and marks all runs connected to a strong candidate */
+    static void _cannyHysteresis( std::vector<uint8_t>& edge, std::vector<size_t>& offsets, const std::vector<ICannyStrip>& strips )
+    {
+        std::vector<uint32_t> parent;
+        _runMergeStrips( parent, offsets, strips, 1 );
+
+        size_t total = parent.size();
+        edge.assign( total, 0 );
+        for( size_t s = 0; s < strips.size(); s++ ) {
+            const ICannyStrip& strip = strips[ s ];
+            for( size_t i = 0; i < strip.runs.size(); i++ )
+                edge[ _runFind( parent, offsets[ s ] + i ) ] |= strip.strong[ i ];
+        }
+        for( size_t i = 0; i < total; i++ )
+            edge[ i ] = edge[ _runFind( parent, i ) ];
+    }
+
+    template<typename Source, typename A>
+    static void _cannyDetect( Image& out, const Image& one, const Image& two, A wa, A wb, A low, A high )
+    {
+        int height = one.height();
+        out.reallocate( one.width(), height, IFormat::GRAY_FLOAT );
+
+        std::vector<ICannyStrip> strips;
+        _runStrips( strips, height );
+        size_t nstrips = strips.size();
+
+        if( one.width() >= 3 && height >= 3 )
+            parallelFor( 0, nstrips, ICannyStripTask<Source, A>( strips, one, two, wa, wb, low, high ), 1 );
+
+        std::vector<uint8_t> edge;
+        std::vector<size_t> offsets;
+        _cannyHysteresis( edge, offsets, strips );
+        parallelFor( 0, nstrips, ICannyFill( strips, offsets, edge, out ), 1 );
+    }
+
+    /* squared threshold for integer magnitudes scaled by norm */
+    static inline int32_t _cannyThreshold( float t, float norm )
+    {
+        double v = ( double ) t * ( double ) norm;
+        if( v <= 0.0 )
+            return 0;
+        double sq = Math::ceil( v * v );
+        if( sq > 2147483647.0 )
+            return 2147483647;
+        return ( int32_t ) sq;
+    }
+
+    static inline float _cannyThreshold( float t )
+    {
+        return t > 0.0f ? t * t : 0.0f;
+    }
+
+    void ICanny::detectEdges( Image& out, const Image& in, float low, float high, ICannyGradient gradient )
+    {
+        if( in.channels() != 1 )
+            throw CVTException( "ICanny::detectEdges needs single channel image!" );
+
+        int32_t wa = gradient == ICANNY_SCHARR ? 3 : 1;
+        int32_t wb = gradient == ICANNY_SCHARR ? 10 : 2;
+        float norm = gradient == ICANNY_SCHARR ? 16.0f : 4.0f;
+
+        if( in.format() == IFormat::GRAY_UINT8 ) {
+            _cannyDetect<ICannyImageSource<uint8_t, int32_t>, int32_t>( out, in, in, wa, wb,
+                                                                        _cannyThreshold( low, 255.0f * norm ),
+                                                                        _cannyThreshold( high, 255.0f * norm ) );
+        } else if( in.format() == IFormat::GRAY_FLOAT ) {
+            _cannyDetect<ICannyImageSource<float, float>, float>( out, in, in, wa / norm, wb / norm,
+                                                                  _cannyThreshold( low ), _cannyThreshold( high ) );
+        } else {
+            Image tmp;
+            in.convert( tmp, IFormat::GRAY_FLOAT );
+            _cannyDetect<ICannyImageSource<float, float>, float>( out, tmp, tmp, wa / norm, wb / norm,
+                                                                  _cannyThreshold( low ), _cannyThreshold( high ) );
+        }
+    }
+
+    void ICanny::detectEdges( Image& out, const Image& gradx, const Image& grady, float low, float high )
+    {
+        if( gradx.channels() != 1 || grady.channels() != 1 ||
+            gradx.format() != IFormat::GRAY_FLOAT || grady.format() != IFormat::GRAY_FLOAT ||
+            gradx.width() != grady.width() || gradx.height() != grady.height() )
+            throw CVTException( "ICanny::detectEdges needs single channel floating point gradient image with the same size!" );
+
+        _cannyDetect<ICannyGradientSource, float>( out, gradx, grady, 0.0f, 0.0f, _cannyThreshold( low ), _cannyThreshold( high ) );
+    }
+
+}
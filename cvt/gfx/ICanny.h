@@ -22,23 +22,36 @@
    THE SOFTWARE.
  */
 
-
 #ifndef CVT_ICANNY_H
 #define CVT_ICANNY_H
 
-#include <cvt/gfx/IMapScoped.h>
-#include <cvt/util/Plugin.h>
-#include <cvt/util/Stack.h>
-#include <cvt/util/PluginManager.h>
+#include <cvt/gfx/Image.h>
 
 namespace cvt {
+    enum ICannyGradient {
+        ICANNY_SOBEL,
+        ICANNY_SCHARR
+    };
+
+    /**
+      \brief Canny edge detector for single channel images
+
+      Gradients, magnitude, quantized direction and the non-maximum suppression
+      are computed in one sweep over fixed horizontal strips in parallel, only
+      three rows of magnitudes are kept per strip. The hysteresis unites the runs
+      of weak and strong candidates with a union-find, a component is an edge if it
+      contains a strong candidate. GRAY_UINT8 images are processed with integer
+      gradients. The thresholds refer to intensities in [ 0, 1 ] and gradients
+      [ -1 0 1 ] smoothed with [ 1 2 1 ] / 4 ( Sobel ) or [ 3 10 3 ] / 16 ( Scharr ).
+      The result is a GRAY_FLOAT image with 1 at edges and 0 elsewhere.
+     */
     class ICanny
     {
         public:
             ICanny();
             ~ICanny();
 
-            static void detectEdges( Image& out, const Image& in, float low = 0.02f, float high = 0.025f );
+            static void detectEdges( Image& out, const Image& in, float low = 0.02f, float high = 0.025f, ICannyGradient gradient = ICANNY_SOBEL );
             static void detectEdges( Image& out, const Image& gradx, const Image& grady, float low = 0.02f, float high = 0.025f );
 
         private:
@@ -53,176 +66,6 @@ namespace cvt {
     {
     }
 
-
-    inline void ICanny::detectEdges( Image& out, const Image& in, float low, float high )
-    {
-        if( in.channels() != 1 )
-            throw CVTException( "ICanny::detectEdges needs single channel image!" );
-
-
-        Image dx( in.width(), in.height(), IFormat::GRAY_FLOAT );
-        Image dy( in.width(), in.height(), IFormat::GRAY_FLOAT );
-
-        in.convolve( dx, IKernel::HAAR_HORIZONTAL_3, IKernel::GAUSS_VERTICAL_3 );
-        in.convolve( dy, IKernel::GAUSS_HORIZONTAL_3, IKernel::HAAR_VERTICAL_3 );
-
-        ICanny::detectEdges( out, dx, dy, low, high );
-    }
-
-    inline void ICanny::detectEdges( Image& out, const Image& gradx, const Image& grady, float low, float high )
-    {
-        if( gradx.channels() != 1 || grady.channels() != 1 ||
-            gradx.format() != IFormat::GRAY_FLOAT || grady.format() != IFormat::GRAY_FLOAT ||
-            gradx.width() != grady.width() || gradx.height() != grady.height() )
-            throw CVTException( "ICanny::detectEdges needs single channel floating point gradient image with the same size!" );
-
-        enum SearchDirections {
-            HORIZONTAL,
-            VERTICAL,
-            DIAGUP,
-            DIAGDOWN
-        };
-
-        enum EdgeType {
-            NOEDGE = 1,
-            PEDGE = 0,
-            EDGE = 2
-        };
-
-        out.reallocate( gradx.width(), gradx.height(), IFormat::GRAY_FLOAT );
-
-		Image dir( gradx.width(), gradx.height(), IFormat::GRAY_UINT8 );
-        IMapScoped<const float> mapdx( gradx );
-        IMapScoped<const float> mapdy( grady );
-        IMapScoped<float> mapdst( out );
-        IMapScoped<uint8_t> mapdir( dir );
-        size_t stridedir = mapdir.stride();
-        size_t stridedst = mapdst.stride();
-
-        /* calculate edge direction and strength */
-        size_t h = out.height();
-        while( h-- ) {
-            size_t w = out.width();
-            const float* fdx =  mapdx.ptr();
-            const float* fdy =  mapdy.ptr();
-            float* fdst = mapdst.ptr();
-            uint8_t* udir = mapdir.ptr();
-            while( w-- ) {
-                *fdst++ = Math::sqrt( Math::sqr( *fdx ) + Math::sqr( *fdy ) );
-                float m = Math::abs( *fdy ) / Math::abs( *fdx );
-                if( m >= 2.4142f ) {
-                    *udir++ = VERTICAL;
-                } else if( m >= 0.41421f ) {
-                    *udir++ = ( *fdx > 0 ) ^ ( *fdy > 0 ) ? DIAGDOWN : DIAGUP;
-                } else {
-                    *udir++ = HORIZONTAL;
-                }
-                fdx++;
-                fdy++;
-            }
-            mapdx++;
-            mapdy++;
-            mapdir++;
-            mapdst++;
-        }
-
-        Stack<uint8_t*> stack( 1024 );
-        mapdst.reset();
-        mapdir.reset();
-        // first and last line are all NOEDGE
-        memset( mapdir.ptr(), NOEDGE, dir.width() );
-        memset( mapdir.ptr() + mapdir.stride() * ( dir.height() - 1 ), NOEDGE, dir.width() );
-
-        h = out.height() - 2;
-        mapdir++;
-        mapdst++;
-        while( h-- ) {
-            size_t w = out.width() - 2;
-            float* fdst =  mapdst.ptr();
-            uint8_t* udir = mapdir.ptr();
-            /* set map outside image to NOEDGE */
-            *udir++ = NOEDGE;
-            *fdst++ = 0.0f;
-            *( ( float* )( ( uint8_t* ) fdst - stridedst - 1  ) ) = 0.0f;
-
-            /* main */
-            while( w-- ) {
-                if( *fdst >= low ) {
-                    if( *udir == HORIZONTAL &&
-                       ( *(fdst - 1 ) > *fdst ||
-                        *( fdst + 1 ) > *fdst ) ) {
-                        *udir = NOEDGE;
-                    } else if( *udir == VERTICAL &&
-                              ( *( ( float* )( ( uint8_t* ) fdst - stridedst  ) ) > *fdst ||
-                               *( ( float* )( ( uint8_t* ) fdst + stridedst  ) ) > *fdst ) ) {
-                        *udir = NOEDGE;
-                    } else if( *udir == DIAGDOWN &&
-                              ( *( ( float* )( ( uint8_t* ) ( fdst + 1 ) - stridedst  ) ) > *fdst ||
-                               *( ( float* )( ( uint8_t* ) ( fdst - 1 ) + stridedst  ) ) > *fdst ) ) {
-                        *udir = NOEDGE;
-                    } else if( *udir == DIAGUP &&
-                              ( *( ( float* )( ( uint8_t* ) ( fdst - 1 ) - stridedst  ) ) > *fdst ||
-                               *( ( float* )( ( uint8_t* ) ( fdst + 1 ) + stridedst  ) ) > *fdst ) ) {
-                        *udir = NOEDGE;
-                    } else {
-                        if( *fdst >= high ) {
-                            *udir = EDGE;
-                            stack.push( udir );
-                        } else {
-                            *udir = PEDGE;
-                        }
-                    }
-                } else
-                    *udir = NOEDGE;
-                fdst++;
-                udir++;
-            }
-            *udir = NOEDGE;
-            mapdir++;
-            mapdst++;
-        }
-
-        while( !stack.isEmpty() ) {
-            uint8_t* m;
-            m = stack.pop();
-            *m = EDGE;
-            if( !m[ - 1 + stridedir ] )
-                stack.push( m - 1 + stridedir );
-            if( !m[ + stridedir ] )
-                stack.push( m + stridedir );
-            if( !m[ + 1 + stridedir ] )
-                stack.push( m + 1 + stridedir );
-            if( !m[ - 1 - stridedir ] )
-                stack.push( m - 1 - stridedir );
-            if( !m[ - stridedir ] )
-                stack.push( m - stridedir );
-            if( !m[ + 1 - stridedir ] )
-                stack.push( m + 1 - stridedir );
-            if( !m[ + 1 ] )
-                stack.push( m + 1 );
-            if( !m[ - 1 ] )
-                stack.push( m - 1 );
-        }
-
-
-        mapdst.reset();
-        mapdir.reset();
-        h = out.height();
-        while( h-- ) {
-            size_t w = out.width();
-            float* fdst =  mapdst.ptr();
-            uint8_t* udir = mapdir.ptr();
-            while( w-- ) {
-                if( *udir++ != EDGE )
-                    *fdst++ = 0;
-                else
-                    *fdst++ = 1.0f;
-            }
-            mapdst++;
-            mapdir++;
-        }
-    }
-
 }
 
 #endif
@@ -0,0 +1,211 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/ICanny.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/CVTTest.h>
+
+#include <vector>
+
+namespace cvt {
+
+    /* straightforward Canny on a float copy: Sobel, NMS and flood fill hysteresis */
+    static void _cannyReference( std::vector<uint8_t>& edges, const std::vector<float>& img, int w, int h, float low, float high )
+    {
+        std::vector<float> mag( w * h );
+        std::vector<uint8_t> dir( w * h );
+        for( int y = 0; y < h; y++ ) {
+            for( int x = 0; x < w; x++ ) {
+                int xl = Math::max( x - 1, 0 ), xr = Math::min( x + 1, w - 1 );
+                int yu = Math::max( y - 1, 0 ), yd = Math::min( y + 1, h - 1 );
+                float gx = 0.25f * ( img[ yu * w + xr ] - img[ yu * w + xl ] + img[ yd * w + xr ] - img[ yd * w + xl ] )
+                         + 0.5f * ( img[ y * w + xr ] - img[ y * w + xl ] );
+                float gy = 0.25f * ( img[ yd * w + xl ] - img[ yu * w + xl ] + img[ yd * w + xr ] - img[ yu * w + xr ] )
+                         + 0.5f * ( img[ yd * w + x ] - img[ yu * w + x ] );
+                mag[ y * w + x ] = Math::sqrt( gx * gx + gy * gy );
+                float m = Math::abs( gy ) / Math::abs( gx );
+                if( m >= 2.4142f )
+                    dir[ y * w + x ] = 1;
+                else if( m >= 0.41421f )
+                    dir[ y * w + x ] = ( gx > 0 ) ^ ( gy > 0 ) ? 3 : 2;
+                else
+                    dir[ y * w + x ] = 0;
+            }
+        }
+
+        // 0 no edge, 1 weak, 2 strong
+        std::vector<uint8_t> cls( w * h, 0 );
+        std::vector<int> stack;
+        for( int y = 1; y < h - 1; y++ ) {
+            for( int x = 1; x < w - 1; x++ ) {
+                int i = y * w + x;
+                float m = mag[ i ];
+                if( m < low )
+                    continue;
+                int o = dir[ i ] == 0 ? 1 : dir[ i ] == 1 ? w : dir[ i ] == 3 ? w - 1 : w + 1;
+                if( mag[ i - o ] > m || mag[ i + o ] > m )
+                    continue;
+                cls[ i ] = m >= high ? 2 : 1;
+                if( cls[ i ] == 2 )
+                    stack.push_back( i );
+            }
+        }
+
+        edges.assign( w * h, 0 );
+        while( !stack.empty() ) {
+            int i = stack.back();
+            stack.pop_back();
+            if( edges[ i ] )
+                continue;
+            edges[ i ] = 1;
+            for( int dy = -1; dy <= 1; dy++ )
+                for( int dx = -1; dx <= 1; dx++ )
+                    if( cls[ i + dy * w + dx ] && !edges[ i + dy * w + dx ] )
+                        stack.push_back( i + dy * w + dx );
+        }
+    }
+
+    static size_t _cannyMismatches( const Image& out, const std::vector<uint8_t>& ref )
+    {
+        size_t n = 0;
+        IMapScoped<const float> map( out );
+        for( size_t y = 0; y < out.height(); y++ ) {
+            for( size_t x = 0; x < out.width(); x++ )
+                n += ( map.ptr()[ x ] != 0.0f ) != ( ref[ y * out.width() + x ] != 0 );
+            map++;
+        }
+        return n;
+    }
+
+    BEGIN_CVTTEST( ICanny )
+        bool result = true;
+        bool b;
+
+        // blobs of varying contrast plus noise, several strips high
+        const int w = 173, h = 241;
+        Math::srand( 7 );
+        std::vector<float> data( w * h );
+        for( int y = 0; y < h; y++ ) {
+            for( int x = 0; x < w; x++ ) {
+                float v = 0.1f;
+                for( int k = 0; k < 6; k++ ) {
+                    float cx = 20.0f + k * 27.0f, cy = 30.0f + k * 35.0f;
+                    if( Math::sqr( x - cx ) + Math::sqr( y - cy ) < Math::sqr( 12.0f + 3.0f * k ) )
+                        v += 0.05f + 0.12f * k;
+                }
+                v += 0.15f * ( float ) x / ( float ) w + Math::rand( 0.0f, 0.03f );
+                data[ y * w + x ] = ( float ) ( int ) ( Math::min( v, 1.0f ) * 255.0f ) / 255.0f;
+            }
+        }
+
+        Image grayf( w, h, IFormat::GRAY_FLOAT );
+        Image gray8( w, h, IFormat::GRAY_UINT8 );
+        {
+            IMapScoped<float> mapf( grayf );
+            IMapScoped<uint8_t> map8( gray8 );
+            for( int y = 0; y < h; y++ ) {
+                for( int x = 0; x < w; x++ ) {
+                    mapf.ptr()[ x ] = data[ y * w + x ];
+                    map8.ptr()[ x ] = ( uint8_t ) Math::round( data[ y * w + x ] * 255.0f );
+                }
+                mapf++;
+                map8++;
+            }
+        }
+
+        const float low = 0.02f, high = 0.08f;
+        std::vector<uint8_t> ref;
+        _cannyReference( ref, data, w, h, low, high );
+        size_t nedges = 0;
+        for( size_t i = 0; i < ref.size(); i++ )
+            nedges += ref[ i ];
+
+        Image out;
+        ICanny::detectEdges( out, grayf, low, high );
+        size_t diff = _cannyMismatches( out, ref );
+        b = nedges > 500 && diff <= nedges / 200;
+        CVTTEST_LOG( "GRAY_FLOAT: " << diff << " of " << nedges << " edge pixels differ" );
+        CVTTEST_PRINT( "GRAY_FLOAT against reference", b );
+        result &= b;
+
+        ICanny::detectEdges( out, gray8, low, high );
+        diff = _cannyMismatches( out, ref );
+        b = diff <= nedges / 200;
+        CVTTEST_LOG( "GRAY_UINT8: " << diff << " of " << nedges << " edge pixels differ" );
+        CVTTEST_PRINT( "GRAY_UINT8 against reference", b );
+        result &= b;
+
+        // a long weak vertical edge crossing all strips, strong only at the top
+        {
+            Image ramp( 40, 300, IFormat::GRAY_UINT8 );
+            for( int strong = 0; strong < 2; strong++ ) {
+                {
+                    IMapScoped<uint8_t> map( ramp );
+                    for( int y = 0; y < 300; y++ ) {
+                        for( int x = 0; x < 40; x++ )
+                            map.ptr()[ x ] = x < 20 ? 50 : ( strong && y < 10 ? 200 : 70 );
+                        map++;
+                    }
+                }
+                ICanny::detectEdges( out, ramp, 0.01f, 0.1f );
+                IMapScoped<const float> mout( out );
+                size_t n = 0;
+                for( int y = 12; y < 299; y++ )
+                    n += mout( 19, y ) != 0.0f && mout( 20, y ) != 0.0f;
+                b = n == ( strong ? 287u : 0u );
+                if( strong ) {
+                    CVTTEST_PRINT( "Hysteresis across strips", b );
+                } else {
+                    CVTTEST_PRINT( "Weak edge without strong seed", b );
+                }
+                result &= b;
+            }
+        }
+
+        // edges from separate gradient images
+        {
+            Image dx( w, h, IFormat::GRAY_FLOAT ), dy( w, h, IFormat::GRAY_FLOAT );
+            IMapScoped<float> mx( dx );
+            IMapScoped<float> my( dy );
+            for( int y = 0; y < h; y++ ) {
+                for( int x = 0; x < w; x++ ) {
+                    int xl = Math::max( x - 1, 0 ), xr = Math::min( x + 1, w - 1 );
+                    int yu = Math::max( y - 1, 0 ), yd = Math::min( y + 1, h - 1 );
+                    mx( x, y ) = 0.25f * ( data[ yu * w + xr ] - data[ yu * w + xl ] + data[ yd * w + xr ] - data[ yd * w + xl ] )
+                               + 0.5f * ( data[ y * w + xr ] - data[ y * w + xl ] );
+                    my( x, y ) = 0.25f * ( data[ yd * w + xl ] - data[ yu * w + xl ] + data[ yd * w + xr ] - data[ yu * w + xr ] )
+                               + 0.5f * ( data[ yd * w + x ] - data[ yu * w + x ] );
+                }
+            }
+            ICanny::detectEdges( out, dx, dy, low, high );
+            diff = _cannyMismatches( out, ref );
+            b = diff <= nedges / 200;
+            CVTTEST_PRINT( "Gradient images against reference", b );
+            result &= b;
+        }
+
+        return result;
+    END_CVTTEST
+}
@@ -0,0 +1,165 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/IComponentLabeling.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/internal/RunLabeling.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/Exception.h>
+
+namespace cvt {
+
+	class IComponentLabelingStrip {
+		public:
+			IComponentLabelingStrip( const IComponentLabeling& labeling, std::vector<IComponentLabeling::Strip>& strips, const Image& img ) :
+				_labeling( labeling ), _strips( strips ), _img( img )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				for( size_t i = begin; i < end; i++ )
+					_labeling.labelStrip( _strips[ i ], _img );
+			}
+
+		private:
+			const IComponentLabeling&				_labeling;
+			std::vector<IComponentLabeling::Strip>& _strips;
+			const Image&							_img;
+	};
+
+	class IComponentLabelingFill {
+		public:
+			IComponentLabelingFill( const std::vector<ComponentRun>& runs, const std::vector<size_t>& rowStart, Image& labels ) :
+				_runs( runs ), _rowStart( rowStart ), _labels( labels )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				IMapScoped<float> map( _labels );
+				map.setLine( begin );
+				for( size_t y = begin; y < end; y++ ) {
+					float* ptr = map.ptr();
+					for( size_t x = 0; x < _labels.width(); x++ )
+						ptr[ x ] = 0.0f;
+					for( size_t r = _rowStart[ y ]; r < _rowStart[ y + 1 ]; r++ ) {
+						const ComponentRun& run = _runs[ r ];
+						float label = ( float ) run.label;
+						for( int x = run.xs; x <= run.xe; x++ )
+							ptr[ x ] = label;
+					}
+					map++;
+				}
+			}
+
+		private:
+			const std::vector<ComponentRun>& _runs;
+			const std::vector<size_t>&		 _rowStart;
+			Image&							 _labels;
+	};
+
+	IComponentLabeling::IComponentLabeling( bool eightConnected ) :
+		_eightConnected( eightConnected )
+	{
+	}
+
+	IComponentLabeling::~IComponentLabeling()
+	{
+	}
+
+	void IComponentLabeling::labelStrip( Strip& strip, const Image& img ) const
+	{
+		const int conn = _eightConnected ? 1 : 0;
+		const bool u8 = img.format().formatID == IFORMAT_GRAY_UINT8;
+		const int width = img.width();
+
+		strip.runs.clear();
+		strip.parent.clear();
+
+		IMapScoped<const uint8_t> map( img );
+		map.setLine( strip.y0 );
+
+		size_t prevBegin = 0, prevEnd = 0;
+		for( int y = strip.y0; y < strip.y1; y++ ) {
+			size_t curBegin = strip.runs.size();
+			if( u8 )
+				_runRow( strip, map.ptr(), width, y, prevBegin, prevEnd, conn );
+			else
+				_runRow( strip, ( const float* ) map.ptr(), width, y, prevBegin, prevEnd, conn );
+			map++;
+			prevBegin = curBegin;
+			prevEnd = strip.runs.size();
+		}
+	}
+
+	void IComponentLabeling::mergeStrips()
+	{
+		std::vector<size_t> offsets;
+		_runMergeStrips( _parent, offsets, _strips, _eightConnected ? 1 : 0 );
+
+		_runs.clear();
+		_runs.reserve( _parent.size() );
+		for( size_t s = 0; s < _strips.size(); s++ )
+			_runs.insert( _runs.end(), _strips[ s ].runs.begin(), _strips[ s ].runs.end() );
+	}
+
+	void IComponentLabeling::apply( const Image& img )
+	{
+		if( img.format() != IFormat::GRAY_UINT8 && img.format() != IFormat::GRAY_FLOAT )
+			throw CVTException( "Unsupported image format!" );
+
+		_runStrips( _strips, img.height() );
+		parallelFor( 0, _strips.size(), IComponentLabelingStrip( *this, _strips, img ), 1 );
+		mergeStrips();
+
+		// consecutive labels in raster order, the root is the first run of its component
+		_stats.clear();
+		for( size_t i = 0; i < _runs.size(); i++ ) {
+			uint32_t root = _runFind( _parent, i );
+			if( root == i ) {
+				_stats.push_back( ComponentStats() );
+				_runs[ i ].label = _stats.size();
+			} else {
+				_runs[ i ].label = _runs[ root ].label;
+			}
+			_stats[ _runs[ i ].label - 1 ].add( _runs[ i ] );
+		}
+	}
+
+	void IComponentLabeling::apply( Image& labels, const Image& img )
+	{
+		apply( img );
+
+		size_t height = img.height();
+		std::vector<size_t> rowStart( height + 1, 0 );
+		for( size_t i = 0; i < _runs.size(); i++ )
+			rowStart[ _runs[ i ].y + 1 ]++;
+		for( size_t y = 0; y < height; y++ )
+			rowStart[ y + 1 ] += rowStart[ y ];
+
+		labels.reallocate( img.width(), height, IFormat::GRAY_FLOAT );
+		parallelFor( 0, height, IComponentLabelingFill( _runs, rowStart, labels ), CVT_RUNLABELING_STRIP_HEIGHT );
+	}
+}
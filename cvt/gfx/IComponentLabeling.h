@@ -0,0 +1,186 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_ICOMPONENTLABELING_H
+#define CVT_ICOMPONENTLABELING_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/geom/Rect.h>
+#include <cvt/geom/Ellipse.h>
+#include <cvt/math/Vector.h>
+#include <cvt/math/Matrix.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/* horizontal run of foreground pixels [ xs, xe ] in row y */
+	struct ComponentRun {
+		int		 y;
+		int		 xs;
+		int		 xe;
+		uint32_t label;
+	};
+
+	/**
+	  \brief Moments of a connected component, accumulated per run
+	 */
+	struct ComponentStats {
+		ComponentStats();
+
+		size_t		area;
+		int			xmin, ymin, xmax, ymax;
+		double		sx, sy, sxx, sxy, syy;
+
+		void		add( const ComponentRun& run );
+
+		Recti		boundingBox() const;
+		Vector2f	centroid() const;
+		Matrix2f	covariance() const;
+		/* ellipse with the same first and second moments */
+		Ellipsef	ellipse() const;
+	};
+
+	/**
+	  \brief Connected component labeling of the non-zero pixels of GRAY_UINT8 or GRAY_FLOAT images
+
+	  Rows are run-length encoded and the runs united with a union-find in
+	  fixed horizontal strips in parallel, the strips are merged afterwards.
+	  Labels are assigned in raster order of the first pixel, starting at 1.
+	 */
+	class IComponentLabeling {
+		public:
+			IComponentLabeling( bool eightConnected = true );
+			~IComponentLabeling();
+
+			void	apply( const Image& img );
+			/* also writes the GRAY_FLOAT label image, 0 is background, exact up to 2^24 labels */
+			void	apply( Image& labels, const Image& img );
+
+			/* number of components */
+			size_t							size() const			 { return _stats.size(); }
+			/* statistics of the component with label i + 1 */
+			const ComponentStats&			operator[]( size_t i ) const { return _stats[ i ]; }
+			const std::vector<ComponentRun>& runs() const			 { return _runs; }
+
+		private:
+			IComponentLabeling( const IComponentLabeling& );
+			IComponentLabeling& operator=( const IComponentLabeling& );
+
+			friend class IComponentLabelingStrip;
+			friend class IComponentLabelingFill;
+
+			/* rows labeled by one task */
+			struct Strip {
+				typedef ComponentRun		RunType;
+				int							y0, y1;
+				std::vector<ComponentRun>	runs;
+				std::vector<uint32_t>		parent;
+			};
+
+			void			labelStrip( Strip& strip, const Image& img ) const;
+			void			mergeStrips();
+
+			bool						_eightConnected;
+			std::vector<Strip>			_strips;
+			std::vector<ComponentRun>	_runs;
+			std::vector<uint32_t>		_parent;
+			std::vector<ComponentStats> _stats;
+	};
+
+	inline ComponentStats::ComponentStats() :
+		area( 0 ),
+		xmin( 0 ), ymin( 0 ), xmax( -1 ), ymax( -1 ),
+		sx( 0 ), sy( 0 ), sxx( 0 ), sxy( 0 ), syy( 0 )
+	{
+	}
+
+	inline void ComponentStats::add( const ComponentRun& run )
+	{
+		double n = run.xe - run.xs + 1;
+		double a = run.xs - 1;
+		double b = run.xe;
+		double y = run.y;
+		// sum of x and x^2 over the run in closed form
+		double rx = n * ( run.xs + run.xe ) * 0.5;
+		double rxx = ( b * ( b + 1.0 ) * ( 2.0 * b + 1.0 ) - a * ( a + 1.0 ) * ( 2.0 * a + 1.0 ) ) / 6.0;
+
+		if( !area ) {
+			xmin = run.xs; xmax = run.xe;
+			ymin = ymax = run.y;
+		} else {
+			xmin = Math::min( xmin, run.xs );
+			xmax = Math::max( xmax, run.xe );
+			ymin = Math::min( ymin, run.y );
+			ymax = Math::max( ymax, run.y );
+		}
+		area += ( size_t ) n;
+		sx  += rx;
+		sy  += n * y;
+		sxx += rxx;
+		sxy += rx * y;
+		syy += n * y * y;
+	}
+
+	inline Recti ComponentStats::boundingBox() const
+	{
+		return Recti( xmin, ymin, xmax - xmin + 1, ymax - ymin + 1 );
+	}
+
+	inline Vector2f ComponentStats::centroid() const
+	{
+		if( !area )
+			return Vector2f( 0.0f, 0.0f );
+		return Vector2f( sx / area, sy / area );
+	}
+
+	inline Matrix2f ComponentStats::covariance() const
+	{
+		if( !area )
+			return Matrix2f( 0.0f, 0.0f, 0.0f, 0.0f );
+		double mx = sx / area;
+		double my = sy / area;
+		double cxx = sxx / area - mx * mx;
+		double cxy = sxy / area - mx * my;
+		double cyy = syy / area - my * my;
+		return Matrix2f( cxx, cxy, cxy, cyy );
+	}
+
+	inline Ellipsef ComponentStats::ellipse() const
+	{
+		Matrix2f cov = covariance();
+		float a = cov[ 0 ][ 0 ];
+		float b = cov[ 0 ][ 1 ];
+		float c = cov[ 1 ][ 1 ];
+		// eigenvalues of the covariance, a filled ellipse has variance semiaxis^2 / 4
+		float mean = 0.5f * ( a + c );
+		float diff = Math::sqrt( 0.25f * ( a - c ) * ( a - c ) + b * b );
+		float l1 = mean + diff;
+		float l2 = Math::max( mean - diff, 0.0f );
+		float orientation = 0.5f * Math::atan2( 2.0f * b, a - c );
+		return Ellipsef( centroid(), 2.0f * Math::sqrt( l1 ), 2.0f * Math::sqrt( l2 ), orientation );
+	}
+}
+
+#endif
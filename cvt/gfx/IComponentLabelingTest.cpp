@@ -0,0 +1,154 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/IComponentLabeling.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/CVTTest.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/* reference labeling by flood fill, labels in raster order of the first pixel */
+	static size_t _labelingFloodFill( std::vector<uint32_t>& labels, std::vector<size_t>& areas, const std::vector<uint8_t>& img, int w, int h, bool eight )
+	{
+		labels.assign( w * h, 0 );
+		areas.clear();
+		std::vector<int> stack;
+		for( int i = 0; i < w * h; i++ ) {
+			if( !img[ i ] || labels[ i ] )
+				continue;
+			areas.push_back( 0 );
+			uint32_t l = areas.size();
+			labels[ i ] = l;
+			stack.push_back( i );
+			while( !stack.empty() ) {
+				int p = stack.back();
+				stack.pop_back();
+				areas.back()++;
+				int px = p % w, py = p / w;
+				for( int dy = -1; dy <= 1; dy++ ) {
+					for( int dx = -1; dx <= 1; dx++ ) {
+						if( ( !dx && !dy ) || ( !eight && dx && dy ) )
+							continue;
+						int x = px + dx, y = py + dy;
+						if( x < 0 || y < 0 || x >= w || y >= h )
+							continue;
+						int q = y * w + x;
+						if( img[ q ] && !labels[ q ] ) {
+							labels[ q ] = l;
+							stack.push_back( q );
+						}
+					}
+				}
+			}
+		}
+		return areas.size();
+	}
+
+	static bool _labelingCompare( const Image& img, const std::vector<uint8_t>& data, bool eight )
+	{
+		int w = img.width(), h = img.height();
+		std::vector<uint32_t> reflabels;
+		std::vector<size_t> refareas;
+		size_t n = _labelingFloodFill( reflabels, refareas, data, w, h, eight );
+
+		IComponentLabeling labeling( eight );
+		Image labels;
+		labeling.apply( labels, img );
+		if( labeling.size() != n )
+			return false;
+		for( size_t i = 0; i < n; i++ ) {
+			if( labeling[ i ].area != refareas[ i ] )
+				return false;
+		}
+
+		IMapScoped<const float> map( labels );
+		for( int y = 0; y < h; y++ ) {
+			const float* ptr = map.ptr();
+			for( int x = 0; x < w; x++ ) {
+				if( ( uint32_t ) ptr[ x ] != reflabels[ y * w + x ] )
+					return false;
+			}
+			map++;
+		}
+		return true;
+	}
+
+	BEGIN_CVTTEST( IComponentLabeling )
+		bool result = true;
+		bool b;
+
+		// random blobs spanning several strips
+		const int w = 211, h = 300;
+		std::vector<uint8_t> data( w * h );
+		Image img( w, h, IFormat::GRAY_UINT8 );
+		{
+			IMapScoped<uint8_t> map( img );
+			Math::srand( 42 );
+			for( int y = 0; y < h; y++ ) {
+				uint8_t* ptr = map.ptr();
+				for( int x = 0; x < w; x++ ) {
+					ptr[ x ] = Math::rand( 0.0f, 1.0f ) < 0.45f ? 255 : 0;
+					data[ y * w + x ] = ptr[ x ];
+				}
+				map++;
+			}
+		}
+		b = _labelingCompare( img, data, true );
+		CVTTEST_PRINT( "IComponentLabeling 8-connected", b );
+		result &= b;
+
+		b = _labelingCompare( img, data, false );
+		CVTTEST_PRINT( "IComponentLabeling 4-connected", b );
+		result &= b;
+
+		// filled disc: moments give back center and radius
+		Image disc( 160, 140, IFormat::GRAY_FLOAT );
+		{
+			IMapScoped<float> map( disc );
+			for( int y = 0; y < 140; y++ ) {
+				float* ptr = map.ptr();
+				for( int x = 0; x < 160; x++ )
+					ptr[ x ] = Math::sqr( x - 70.0f ) + Math::sqr( y - 65.0f ) <= Math::sqr( 40.0f ) ? 1.0f : 0.0f;
+				map++;
+			}
+		}
+		IComponentLabeling labeling;
+		labeling.apply( disc );
+		b = labeling.size() == 1;
+		if( b ) {
+			Ellipsef e = labeling[ 0 ].ellipse();
+			Recti bbox = labeling[ 0 ].boundingBox();
+			b = Math::abs( e.center().x - 70.0f ) < 1e-3f && Math::abs( e.center().y - 65.0f ) < 1e-3f &&
+				Math::abs( e.semiMajor() - 40.0f ) < 0.5f && Math::abs( e.semiMinor() - 40.0f ) < 0.5f &&
+				bbox.x == 30 && bbox.y == 25 && bbox.width == 81 && bbox.height == 81;
+		}
+		CVTTEST_PRINT( "IComponentLabeling moments", b );
+		result &= b;
+
+		return result;
+	END_CVTTEST
+}
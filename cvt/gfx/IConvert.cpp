@@ -24,889 +24,552 @@
 
 #include <cvt/gfx/IConvert.h>
 #include <cvt/gfx/Image.h>
+#include <cvt/gfx/IScaleFilter.h>
 #include <cvt/util/SIMD.h>
+#include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/ThreadPool.h>
+
+/* rows per chunk of the row parallel conversions */
+#define CVT_ICONVERT_CHUNK_ROWS 32
 
 namespace cvt {
 
-#define LAST_FORMAT	( IFORMAT_UYVY_UINT8 )
+#define LAST_FORMAT	( IFORMAT_RGBA_HALF )
 
 #define TABLE( table, source, dst ) table[ ( ( source ) - 1 ) * LAST_FORMAT + ( dst ) - 1 ]
 
     IConvert* IConvert::_instance = 0;
 
 
-    #define CONV( func, dI, dsttype, sI, srctype, width )				\
+    /* row loop of the conversions that only need the source row itself */
+    #define CONV( func, dsttype, srctype, width )						\
     {																	\
-        sbase = src = sI.map( &sstride );								\
-        dbase = dst = dI.map( &dstride );								\
-        h = sI.height();												\
-        while( h-- ) {													\
+        SIMD* simd = SIMD::instance();									\
+        const uint8_t* src = rows.src + begin * rows.sstride;			\
+        for( size_t y = begin; y < end; y++ ) {							\
             simd->func( ( dsttype ) dst, ( const srctype ) src, width );\
-            src += sstride;												\
+            src += rows.sstride;										\
             dst += dstride;												\
         }																\
-        sI.unmap( sbase );												\
-        dI.unmap( dbase );												\
-        return;															\
     }
 
-    static void Conv_XYZAf_to_ZYXAf( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_XYZAf_to_ZYXAf( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-        CONV( Conv_XYZAf_to_ZYXAf, dstImage, float*, sourceImage, float*, sourceImage.width() )
+        CONV( Conv_XYZAf_to_ZYXAf, float*, float*, rows.width )
     }
 
-    static void Conv_XYZAu8_to_ZYXAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_XYZAu8_to_ZYXAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-        CONV( Conv_XYZAu8_to_ZYXAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
+        CONV( Conv_XYZAu8_to_ZYXAu8, uint8_t*, uint8_t*, rows.width )
     }
 
-    static void Conv_u8_to_f( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_u8_to_f( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-        CONV( Conv_u8_to_f, dstImage, float*, sourceImage, uint8_t*, sourceImage.width() * dstImage.channels() )
+        CONV( Conv_u8_to_f, float*, uint8_t*, rows.width * rows.channels )
     }
 
-    static void Conv_u16_to_u8( Image& dstImage, const Image& sourceImage, IConvertFlags )
+    static void Conv_u16_to_u8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-        CONV( Conv_u16_to_u8, dstImage, uint8_t*, sourceImage, uint16_t*, sourceImage.width() * dstImage.channels() )
+        CONV( Conv_u16_to_u8, uint8_t*, uint16_t*, rows.width * rows.channels )
     }
-    static void Conv_u16_to_XXXAu8( Image& dstImage, const Image& sourceImage, IConvertFlags )
+    static void Conv_u16_to_XXXAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-        CONV( Conv_u16_to_XXXAu8, dstImage, uint8_t*, sourceImage, uint16_t*, sourceImage.width() )
+        CONV( Conv_u16_to_XXXAu8, uint8_t*, uint16_t*, rows.width )
     }
 
-    static void Conv_u16_to_f( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_u16_to_f( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-        CONV( Conv_u16_to_f, dstImage, float*, sourceImage, uint16_t*, sourceImage.width() * dstImage.channels() )
+        CONV( Conv_u16_to_f, float*, uint16_t*, rows.width * rows.channels )
     }
 
-    static void Conv_f_to_u8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_f_to_u8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-
-        CONV( Conv_f_to_u8, dstImage, uint8_t*, sourceImage, float*, sourceImage.width() * dstImage.channels() )
+        CONV( Conv_f_to_u8, uint8_t*, float*, rows.width * rows.channels )
     }
 
-    static void Conv_f_to_u16( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_f_to_u16( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-
-        CONV( Conv_f_to_u16, dstImage, uint16_t*, sourceImage, float*, sourceImage.width() * dstImage.channels() )
+        CONV( Conv_f_to_u16, uint16_t*, float*, rows.width * rows.channels )
     }
 
-    static void Conv_s16_to_u8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_s16_to_u8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-
-        CONV( Conv_s16_to_u8, dstImage, uint8_t*, sourceImage, int16_t*, sourceImage.width() * dstImage.channels() )
+        CONV( Conv_s16_to_u8, uint8_t*, int16_t*, rows.width * rows.channels )
     }
 
-    static void Conv_GRAYf_to_GRAYu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_GRAYf_to_GRAYu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-
-        CONV( Conv_GRAYf_to_GRAYu8, dstImage, uint8_t*, sourceImage, float*, sourceImage.width() * dstImage.channels() )
+        CONV( Conv_GRAYf_to_GRAYu8, uint8_t*, float*, rows.width * rows.channels )
     }
 
-    static void Conv_GRAYALPHAf_to_GRAYf( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_GRAYALPHAf_to_GRAYf( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-
-        CONV( Conv_GRAYALPHAf_to_GRAYf, dstImage, float*, sourceImage, float*, sourceImage.width() )
+        CONV( Conv_GRAYALPHAf_to_GRAYf, float*, float*, rows.width )
     }
 
 
-    static void Conv_GRAYf_to_XXXAf( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_GRAYf_to_XXXAf( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-
-        CONV( Conv_GRAYf_to_XXXAf, dstImage, float*, sourceImage, float*, sourceImage.width() )
+        CONV( Conv_GRAYf_to_XXXAf, float*, float*, rows.width )
     }
 
 
-    static void Conv_RGBAu8_to_GRAYf( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_RGBAu8_to_GRAYf( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-
-        CONV( Conv_RGBAu8_to_GRAYf, dstImage, float*, sourceImage, uint8_t*, sourceImage.width() )
+        CONV( Conv_RGBAu8_to_GRAYf, float*, uint8_t*, rows.width )
     }
 
-    static void Conv_GRAYu8_to_XXXAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_GRAYu8_to_XXXAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        CONV( Conv_GRAYu8_to_XXXAu8, uint8_t*, uint8_t*, rows.width )
+    }
 
-        CONV( Conv_GRAYu8_to_XXXAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
+    static void Conv_XXXAu8_to_XXXAf( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        CONV( Conv_XXXAu8_to_XXXAf, float*, uint8_t*, rows.width )
     }
 
-    static void Conv_XXXAu8_to_XXXAf( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_XXXAf_to_XXXAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        CONV( Conv_XXXAf_to_XXXAu8, uint8_t*, float*, rows.width )
+    }
 
-        CONV( Conv_XXXAu8_to_XXXAf, dstImage, float*, sourceImage, uint8_t*, sourceImage.width() )
+    static void Conv_XYZAu8_to_ZYXAf( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        CONV( Conv_XYZAu8_to_ZYXAf, float*, uint8_t*, rows.width )
     }
 
-    static void Conv_XXXAf_to_XXXAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_XYZAf_to_ZYXAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        CONV( Conv_XYZAf_to_ZYXAu8, uint8_t*, float*, rows.width )
+    }
 
-        CONV( Conv_XXXAf_to_XXXAu8, dstImage, uint8_t*, sourceImage, float*, sourceImage.width() )
+    static void Conv_BGRAu8_to_GRAYu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        CONV( Conv_BGRAu8_to_GRAYu8, uint8_t*, uint8_t*, rows.width )
     }
 
-    static void Conv_XYZAu8_to_ZYXAf( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_RGBAu8_to_GRAYu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        CONV( Conv_RGBAu8_to_GRAYu8, uint8_t*, uint8_t*, rows.width )
+    }
+
 
-        CONV( Conv_XYZAu8_to_ZYXAf, dstImage, float*, sourceImage, uint8_t*, sourceImage.width() )
+    static void Conv_BGRAu8_to_GRAYf( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        CONV( Conv_BGRAu8_to_GRAYf, float*, uint8_t*, rows.width )
     }
 
-    static void Conv_XYZAf_to_ZYXAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_BGRAf_to_GRAYf( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        CONV( Conv_BGRAf_to_GRAYf, float*, float*, rows.width )
+    }
 
-        CONV( Conv_XYZAf_to_ZYXAu8, dstImage, uint8_t*, sourceImage, float*, sourceImage.width() )
+    static void Conv_RGBAf_to_GRAYf( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        CONV( Conv_RGBAf_to_GRAYf, float*, float*, rows.width )
     }
 
-    static void Conv_BGRAu8_to_GRAYu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+
+    static void Conv_YUYVu8_to_RGBAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        CONV( Conv_YUYVu8_to_RGBAu8, uint8_t*, uint8_t*, rows.width )
+    }
 
-        CONV( Conv_BGRAu8_to_GRAYu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
+    static void Conv_YUYVu8_to_BGRAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        CONV( Conv_YUYVu8_to_BGRAu8, uint8_t*, uint8_t*, rows.width )
     }
 
-    static void Conv_RGBAu8_to_GRAYu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_UYVYu8_to_RGBAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        CONV( Conv_UYVYu8_to_RGBAu8, uint8_t*, uint8_t*, rows.width )
+    }
 
-        CONV( Conv_RGBAu8_to_GRAYu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
+    static void Conv_UYVYu8_to_BGRAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        CONV( Conv_UYVYu8_to_BGRAu8, uint8_t*, uint8_t*, rows.width )
     }
 
 
-    static void Conv_BGRAu8_to_GRAYf( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_UYVYu8_to_GRAYu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-
-        CONV( Conv_BGRAu8_to_GRAYf, dstImage, float*, sourceImage, uint8_t*, sourceImage.width() )
+        CONV( Conv_UYVYu8_to_GRAYu8, uint8_t*, uint8_t*, rows.width )
     }
 
-    static void Conv_BGRAf_to_GRAYf( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_UYVYu8_to_GRAYf( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        CONV( Conv_UYVYu8_to_GRAYf, float*, uint8_t*, rows.width )
+    }
+
+
 
-        CONV( Conv_BGRAf_to_GRAYf, dstImage, float*, sourceImage, float*, sourceImage.width() )
+    static void Conv_UYVYu8_to_GRAYALPHAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        CONV( Conv_UYVYu8_to_GRAYALPHAu8, uint8_t*, uint8_t*, rows.width )
     }
 
-    static void Conv_RGBAf_to_GRAYf( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_YUYVu8_to_GRAYu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        CONV( Conv_YUYVu8_to_GRAYu8, uint8_t*, uint8_t*, rows.width )
+    }
 
-        CONV( Conv_RGBAf_to_GRAYf, dstImage, float*, sourceImage, float*, sourceImage.width() )
+    static void Conv_YUYVu8_to_GRAYALPHAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        CONV( Conv_YUYVu8_to_GRAYALPHAu8, uint8_t*, uint8_t*, rows.width )
     }
 
+    static void Conv_YUYVu8_to_GRAYf( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        CONV( Conv_YUYVu8_to_GRAYf, float*, uint8_t*, rows.width )
+    }
 
-    static void Conv_YUYVu8_to_RGBAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_f_to_f16( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        CONV( Conv_f_to_f16, uint16_t*, float*, rows.width * rows.channels )
+    }
 
-        CONV( Conv_YUYVu8_to_RGBAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
+    static void Conv_f16_to_f( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        CONV( Conv_f16_to_f, float*, uint16_t*, rows.width * rows.channels )
     }
 
-    static void Conv_YUYVu8_to_BGRAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+#undef CONV
+
+    /* same format, only used by the compound conversions */
+    static void Conv_copy( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
         SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-
-        CONV( Conv_YUYVu8_to_BGRAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
+        size_t n = rows.width * IFormat::formatForId( rows.format ).bpp;
+        const uint8_t* src = rows.src + begin * rows.sstride;
+        for( size_t y = begin; y < end; y++ ) {
+            simd->Memcpy( dst, src, n );
+            src += rows.sstride;
+            dst += dstride;
+        }
     }
 
-    static void Conv_UYVYu8_to_RGBAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    /* half float <-> uint8 with a float row in between */
+    static void Conv_u8_to_f16( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
         SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        size_t n = rows.width * rows.channels;
+        const uint8_t* src = rows.src + begin * rows.sstride;
+        ScopedBuffer<float, true> row( n );
 
-        CONV( Conv_UYVYu8_to_RGBAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
+        for( size_t y = begin; y < end; y++ ) {
+            simd->Conv_u8_to_f( row.ptr(), src, n );
+            simd->Conv_f_to_f16( ( uint16_t* ) dst, row.ptr(), n );
+            src += rows.sstride;
+            dst += dstride;
+        }
     }
 
-    static void Conv_UYVYu8_to_BGRAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_f16_to_u8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
         SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        size_t n = rows.width * rows.channels;
+        const uint8_t* src = rows.src + begin * rows.sstride;
+        ScopedBuffer<float, true> row( n );
 
-        CONV( Conv_UYVYu8_to_BGRAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
+        for( size_t y = begin; y < end; y++ ) {
+            simd->Conv_f16_to_f( row.ptr(), ( const uint16_t* ) src, n );
+            simd->Conv_f_to_u8( dst, row.ptr(), n );
+            src += rows.sstride;
+            dst += dstride;
+        }
     }
 
-
-    static void Conv_UYVYu8_to_GRAYu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    /* luma of YUV420_PLANAR and NV12 images, chroma is not needed */
+    static void Conv_YUV420u8_to_GRAYu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
         SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        const uint8_t* src = rows.src + begin * rows.sstride;
 
-        CONV( Conv_UYVYu8_to_GRAYu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
+        for( size_t y = begin; y < end; y++ ) {
+            simd->Memcpy( dst, src, rows.width );
+            src += rows.sstride;
+            dst += dstride;
+        }
     }
 
-    static void Conv_UYVYu8_to_GRAYf( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_YUV420u8_to_GRAYf( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
         SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        const uint8_t* src = rows.src + begin * rows.sstride;
 
-        CONV( Conv_UYVYu8_to_GRAYf, dstImage, float*, sourceImage, uint8_t*, sourceImage.width() )
+        for( size_t y = begin; y < end; y++ ) {
+            simd->Conv_u8_to_f( ( float* ) dst, src, rows.width );
+            src += rows.sstride;
+            dst += dstride;
+        }
     }
 
+    /* every chroma row is shared by two luma rows, NV12 chroma is deinterleaved once per chroma row */
+    static void Conv_YUV420u8_to_XXXAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end, bool bgra )
+    {
+        SIMD* simd = SIMD::instance();
+        size_t w = rows.width;
+        size_t h = rows.height;
+        size_t cw = ( w + 1 ) / 2;
+        size_t ch = ( h + 1 ) / 2;
+        bool nv12 = rows.format == IFORMAT_NV12_UINT8;
+
+        const uint8_t* chroma = rows.src + h * rows.sstride;
+        size_t cstride = nv12 ? rows.sstride : rows.sstride / 2;
+        ScopedBuffer<uint8_t, true> buf( nv12 ? 2 * cw : 1 );
+
+        const uint8_t* srcy = rows.src + begin * rows.sstride;
+        const uint8_t* srcu = NULL;
+        const uint8_t* srcv = NULL;
+        for( size_t y = begin; y < end; y++ ) {
+            if( y == begin || !( y & 1 ) ) {
+                if( nv12 ) {
+                    simd->Decompose_2u8( buf.ptr(), buf.ptr() + cw, chroma + ( y >> 1 ) * cstride, cw );
+                    srcu = buf.ptr();
+                    srcv = buf.ptr() + cw;
+                } else {
+                    srcu = chroma + ( y >> 1 ) * cstride;
+                    srcv = chroma + ( ch + ( y >> 1 ) ) * cstride;
+                }
+            }
+            if( bgra )
+                simd->Conv_YUV420u8_to_BGRAu8( dst, srcy, srcu, srcv, w );
+            else
+                simd->Conv_YUV420u8_to_RGBAu8( dst, srcy, srcu, srcv, w );
+            srcy += rows.sstride;
+            dst += dstride;
+        }
+    }
 
-
-    static void Conv_UYVYu8_to_GRAYALPHAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_YUV420u8_to_RGBAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
-
-        CONV( Conv_UYVYu8_to_GRAYALPHAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
+        Conv_YUV420u8_to_XXXAu8( dst, dstride, rows, begin, end, false );
     }
 
-    static void Conv_YUYVu8_to_GRAYu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_YUV420u8_to_BGRAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        Conv_YUV420u8_to_XXXAu8( dst, dstride, rows, begin, end, true );
+    }
+
+    typedef void ( SIMD::*DebayerFunction )( uint32_t*, const uint32_t*, const uint32_t*, const uint32_t*, size_t ) const;
+    typedef void ( SIMD::*DebayerHQFunction )( uint32_t*, const uint32_t*, const uint32_t*, const uint32_t*,
+                                               const uint32_t*, const uint32_t*, size_t ) const;
 
-        CONV( Conv_YUYVu8_to_GRAYu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
+    /* source row y of a Bayer image, rows outside the image are mirrored at the border rows */
+    static inline const uint32_t* _bayerRow( const IConvertRows& rows, ssize_t y )
+    {
+        ssize_t h = rows.height;
+        if( y < 0 )
+            y = -y;
+        if( y >= h )
+            y = 2 * ( h - 1 ) - y;
+        y = Math::clamp<ssize_t>( y, 0, h - 1 );
+        return ( const uint32_t* ) ( rows.src + y * rows.sstride );
     }
 
-    static void Conv_YUYVu8_to_GRAYALPHAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    /*
+       every output row only depends on its source neighbours, the even/odd kernels of RGGB are swapped for GBRG.
+       The high quality kernels need two neighbours and are used for all but the two border rows on each side.
+     */
+    static void _debayer( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end, bool gbrg,
+                          DebayerFunction even, DebayerFunction odd, DebayerHQFunction hqeven, DebayerHQFunction hqodd )
     {
         SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        bool hq = hqeven && ( rows.flags & ICONVERT_DEBAYER_HQLINEAR );
 
-        CONV( Conv_YUYVu8_to_GRAYALPHAu8, dstImage, uint8_t*, sourceImage, uint8_t*, sourceImage.width() )
+        for( size_t y = begin; y < end; y++ ) {
+            bool evenRow = ( ( y & 1 ) == 0 ) != gbrg;
+            ssize_t r = y;
+            if( hq && y >= 2 && y + 2 < rows.height ) {
+                ( simd->*( evenRow ? hqeven : hqodd ) )( ( uint32_t* ) dst, _bayerRow( rows, r - 2 ), _bayerRow( rows, r - 1 ),
+                                                         _bayerRow( rows, r ), _bayerRow( rows, r + 1 ), _bayerRow( rows, r + 2 ),
+                                                         rows.width );
+            } else {
+                ( simd->*( evenRow ? even : odd ) )( ( uint32_t* ) dst, _bayerRow( rows, r - 1 ), _bayerRow( rows, r ),
+                                                     _bayerRow( rows, r + 1 ), rows.width >> 2 );
+            }
+            dst += dstride;
+        }
     }
 
-    static void Conv_YUYVu8_to_GRAYf( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_BAYER_RGGB_to_RGBAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        SIMD* simd = SIMD::instance();
-        const uint8_t* src;
-        const uint8_t* sbase;
-        size_t sstride;
-        size_t dstride;
-        uint8_t* dst;
-        uint8_t* dbase;
-        size_t h;
+        _debayer( dst, dstride, rows, begin, end, false, &SIMD::debayer_EVEN_RGGBu8_RGBAu8, &SIMD::debayer_ODD_RGGBu8_RGBAu8,
+                  &SIMD::debayerhq_EVEN_RGGBu8_RGBAu8, &SIMD::debayerhq_ODD_RGGBu8_RGBAu8 );
+    }
 
-        CONV( Conv_YUYVu8_to_GRAYf, dstImage, float*, sourceImage, uint8_t*, sourceImage.width() )
+    static void Conv_BAYER_RGGB_to_BGRAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        _debayer( dst, dstride, rows, begin, end, false, &SIMD::debayer_EVEN_RGGBu8_BGRAu8, &SIMD::debayer_ODD_RGGBu8_BGRAu8, NULL, NULL );
     }
 
-#undef CONV
+    static void Conv_BAYER_RGGB_to_GRAYu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        _debayer( dst, dstride, rows, begin, end, false, &SIMD::debayer_EVEN_RGGBu8_GRAYu8, &SIMD::debayer_ODD_RGGBu8_GRAYu8, NULL, NULL );
+    }
 
-    void Conv_BAYER_RGGB_to_RGBAu8( Image & dstImage, const Image & sourceImage, IConvertFlags flags )
-    {
-        const uint32_t* src1;
-        const uint32_t* src2;
-        const uint32_t* src3;
-        const uint32_t* src4;
-        const uint32_t* src5;
-        const uint8_t* osrc;
-        uint32_t* dst;
-        uint8_t* odst;
-        size_t sstride;
-        size_t dstride;
-        size_t h;
-        size_t w;
-        size_t i;
+    static void Conv_BAYER_GBRG_to_RGBAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        _debayer( dst, dstride, rows, begin, end, true, &SIMD::debayer_EVEN_RGGBu8_RGBAu8, &SIMD::debayer_ODD_RGGBu8_RGBAu8,
+                  &SIMD::debayerhq_EVEN_RGGBu8_RGBAu8, &SIMD::debayerhq_ODD_RGGBu8_RGBAu8 );
+    }
 
-        SIMD* simd = SIMD::instance();
+    static void Conv_BAYER_GBRG_to_BGRAu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        _debayer( dst, dstride, rows, begin, end, true, &SIMD::debayer_EVEN_RGGBu8_BGRAu8, &SIMD::debayer_ODD_RGGBu8_BGRAu8, NULL, NULL );
+    }
 
-        osrc = sourceImage.map( &sstride );
-        src1 = ( uint32_t* ) osrc;
-        sstride = sstride >> 2;
-        src2 = src1 + sstride;
-        src3 = src2 + sstride;
-        src4 = src3 + sstride;
-        src5 = src4 + sstride;
-        w = sourceImage.width();
-        h = sourceImage.height();
-        odst = dstImage.map( &dstride );
-        dst = ( uint32_t* ) odst;
-        dstride = dstride >> 2;
-
-		if( flags & ICONVERT_DEBAYER_HQLINEAR ) {
-			simd->debayer_EVEN_RGGBu8_RGBAu8( dst, src2, src1, src2, w >> 2 );
-			dst += dstride;
-			simd->debayer_ODD_RGGBu8_RGBAu8( dst, src1, src2, src3, w >> 2 );
-			dst += dstride;
-			for( i = 2; i < h - 2; i += 2 ) {
-				simd->debayerhq_EVEN_RGGBu8_RGBAu8( dst, src1, src2, src3, src4, src5, w );
-				dst += dstride;
-				src1 += sstride;
-				src2 += sstride;
-				src3 += sstride;
-				src4 += sstride;
-				src5 += sstride;
-				simd->debayerhq_ODD_RGGBu8_RGBAu8( dst, src1, src2, src3, src4, src5, w );
-				dst += dstride;
-				src1 += sstride;
-				src2 += sstride;
-				src3 += sstride;
-				src4 += sstride;
-				src5 += sstride;
-			}
-			if( h - 2 == i ) {
-				simd->debayer_EVEN_RGGBu8_RGBAu8( dst, src2, src3, src4, w >> 2 );
-				dst += dstride;
-				simd->debayer_ODD_RGGBu8_RGBAu8( dst, src3, src4, src3, w >> 2 );
-			} else {
-				simd->debayerhq_EVEN_RGGBu8_RGBAu8( dst, src1, src2, src3, src4, src5, w );
-				dst += dstride;
-				simd->debayer_ODD_RGGBu8_RGBAu8( dst, src3, src4, src5, w >> 2 );
-				dst += dstride;
-				simd->debayer_EVEN_RGGBu8_RGBAu8( dst, src3, src4, src3, w >> 2 );
-			}
-
-		} else {
-			simd->debayer_EVEN_RGGBu8_RGBAu8( dst, src2, src1, src2, w >> 2 );
-			dst += dstride;
-			for( i = 1; i < h - 1; i += 2 ) {
-				simd->debayer_ODD_RGGBu8_RGBAu8( dst, src1, src2, src3, w >> 2 );
-				dst += dstride;
-				src1 += sstride;
-				src2 += sstride;
-				src3 += sstride;
-				simd->debayer_EVEN_RGGBu8_RGBAu8( dst, src1, src2, src3, w >> 2 );
-				dst += dstride;
-				src1 += sstride;
-				src2 += sstride;
-				src3 += sstride;
-			}
-			if( h - 1 == i )
-				simd->debayer_ODD_RGGBu8_RGBAu8( dst, src1, src2, src1, w >> 2 );
-			else {
-				simd->debayer_ODD_RGGBu8_RGBAu8( dst, src1, src2, src3, w >> 2 );
-				dst += dstride;
-				simd->debayer_EVEN_RGGBu8_RGBAu8( dst, src2, src3, src2, w >> 2 );
-			}
-		}
-
-        dstImage.unmap( odst );
-        sourceImage.unmap( osrc );
-    }
-
-    void Conv_BAYER_RGGB_to_BGRAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
-    {
-        const uint32_t* src1;
-        const uint32_t* src2;
-        const uint32_t* src3;
-        const uint8_t* osrc;
-        uint32_t* dst;
-        uint8_t* odst;
-        size_t sstride;
-        size_t dstride;
-        size_t h;
-        size_t w;
-        size_t i;
+    static void Conv_BAYER_GBRG_to_GRAYu8( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        _debayer( dst, dstride, rows, begin, end, true, &SIMD::debayer_EVEN_RGGBu8_GRAYu8, &SIMD::debayer_ODD_RGGBu8_GRAYu8, NULL, NULL );
+    }
 
+    /* fused debayer to GRAY_FLOAT: every gray row is converted while it is still in the cache */
+    static void _debayerGrayFloat( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end, bool gbrg )
+    {
         SIMD* simd = SIMD::instance();
+        ScopedBuffer<uint8_t, true> gray( rows.width );
 
-        osrc = sourceImage.map( &sstride );
-        src1 = ( uint32_t* ) osrc;
-        sstride = sstride >> 2;
-        src2 = src1 + sstride;
-        src3 = src2 + sstride;
-        w = sourceImage.width();
-        h = sourceImage.height();
-        odst = dstImage.map( &dstride );
-        dst = ( uint32_t* ) odst;
-        dstride = dstride >> 2;
-
-        simd->debayer_EVEN_RGGBu8_BGRAu8( dst, src2, src1, src2, w >> 2 );
-        dst += dstride;
-        for( i = 1; i < h - 1; i += 2 ) {
-            simd->debayer_ODD_RGGBu8_BGRAu8( dst, src1, src2, src3, w >> 2 );
+        for( size_t y = begin; y < end; y++ ) {
+            _debayer( gray.ptr(), 0, rows, y, y + 1, gbrg, &SIMD::debayer_EVEN_RGGBu8_GRAYu8, &SIMD::debayer_ODD_RGGBu8_GRAYu8, NULL, NULL );
+            simd->Conv_u8_to_f( ( float* ) dst, gray.ptr(), rows.width );
             dst += dstride;
-            src1 += sstride;
-            src2 += sstride;
-            src3 += sstride;
-            simd->debayer_EVEN_RGGBu8_BGRAu8( dst, src1, src2, src3, w >> 2 );
-            dst += dstride;
-            src1 += sstride;
-            src2 += sstride;
-            src3 += sstride;
         }
-        if( i < h ) {
-            if( i & 1 ) {
-                simd->debayer_ODD_RGGBu8_BGRAu8( dst, src1, src2, src1, w >> 2 );
-            } else {
-                simd->debayer_EVEN_RGGBu8_BGRAu8( dst, src1, src2, src1, w >> 2 );
-            }
-        }
-        dstImage.unmap( odst );
-        sourceImage.unmap( osrc );
     }
 
-    void Conv_BAYER_RGGB_to_GRAYu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    static void Conv_BAYER_RGGB_to_GRAYf( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
     {
-        const uint32_t* src1;
-        const uint32_t* src2;
-        const uint32_t* src3;
-        const uint8_t* osrc;
-        uint32_t* dst;
-        uint8_t* odst;
-        size_t sstride;
-        size_t dstride;
-        size_t h;
-        size_t w;
-        size_t i;
+        _debayerGrayFloat( dst, dstride, rows, begin, end, false );
+    }
 
-        SIMD* simd = SIMD::instance();
+    static void Conv_BAYER_GBRG_to_GRAYf( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end )
+    {
+        _debayerGrayFloat( dst, dstride, rows, begin, end, true );
+    }
 
-        osrc = sourceImage.map( &sstride );
-        src1 = ( uint32_t* ) osrc;
-        sstride = sstride >> 2;
-        src2 = src1 + sstride;
-        src3 = src2 + sstride;
-        w = sourceImage.width();
-        h = sourceImage.height();
-        odst = dstImage.map( &dstride );
-        dst = ( uint32_t* ) odst;
-        dstride = dstride >> 2;
-
-        simd->debayer_EVEN_RGGBu8_GRAYu8( dst, src2, src1, src2, w >> 2 );
-        dst += dstride;
-        for( i = 1; i < h - 1; i += 2 ) {
-            simd->debayer_ODD_RGGBu8_GRAYu8( dst, src1, src2, src3, w >> 2 );
-            dst += dstride;
-            src1 += sstride;
-            src2 += sstride;
-            src3 += sstride;
-            simd->debayer_EVEN_RGGBu8_GRAYu8( dst, src1, src2, src3, w >> 2 );
-            dst += dstride;
-            src1 += sstride;
-            src2 += sstride;
-            src3 += sstride;
-        }
-        if( i < h ) {
-            if( ++i & 1 ) {
-                simd->debayer_ODD_RGGBu8_GRAYu8( dst, src1, src2, src1, w >> 2 );
-            } else {
-                simd->debayer_EVEN_RGGBu8_GRAYu8( dst, src1, src2, src1, w >> 2 );
+    /* k x k box averages of k converted rows, the rows are stored in buf with rowstride bytes */
+    static void _boxRow( uint8_t* dst, const uint8_t* buf, size_t rowstride, size_t dw, size_t channels, size_t k )
+    {
+        if( k == 2 ) {
+            const uint8_t* r0 = buf;
+            const uint8_t* r1 = buf + rowstride;
+            for( size_t x = 0; x < dw; x++ ) {
+                for( size_t c = 0; c < channels; c++ )
+                    *dst++ = ( uint8_t ) ( ( r0[ c ] + r0[ channels + c ] + r1[ c ] + r1[ channels + c ] + 2 ) >> 2 );
+                r0 += 2 * channels;
+                r1 += 2 * channels;
             }
+            return;
         }
-        simd->debayer_EVEN_RGGBu8_GRAYu8( dst, src2, src1, src2, w >> 2 );
-        dstImage.unmap( odst );
-        sourceImage.unmap( osrc );
-    }
-
-    void Conv_BAYER_GBRG_to_RGBAu8( Image & dstImage, const Image & sourceImage, IConvertFlags flags )
-    {
-        const uint32_t* src1;
-        const uint32_t* src2;
-        const uint32_t* src3;
-        const uint32_t* src4;
-        const uint32_t* src5;
-        const uint8_t* osrc;
-        uint32_t* dst;
-        uint8_t* odst;
-        size_t sstride;
-        size_t dstride;
-        size_t h;
-        size_t w;
-        size_t i;
 
-        SIMD* simd = SIMD::instance();
-
-        osrc = sourceImage.map( &sstride );
-        src1 = ( uint32_t* ) osrc;
-        sstride = sstride >> 2;
-        src2 = src1 + sstride;
-        src3 = src2 + sstride;
-        src4 = src3 + sstride;
-        src5 = src4 + sstride;
-        w = sourceImage.width();
-        h = sourceImage.height();
-        odst = dstImage.map( &dstride );
-        dst = ( uint32_t* ) odst;
-        dstride = dstride >> 2;
-
-		if( flags & ICONVERT_DEBAYER_HQLINEAR ) {
-			simd->debayer_ODD_RGGBu8_RGBAu8( dst, src2, src1, src2, w >> 2 );
-			dst += dstride;
-			simd->debayer_EVEN_RGGBu8_RGBAu8( dst, src1, src2, src3, w >> 2 );
-			dst += dstride;
-			for( i = 2; i < h - 2; i += 2 ) {
-				simd->debayerhq_ODD_RGGBu8_RGBAu8( dst, src1, src2, src3, src4, src5, w );
-				dst += dstride;
-				src1 += sstride;
-				src2 += sstride;
-				src3 += sstride;
-				src4 += sstride;
-				src5 += sstride;
-				simd->debayerhq_EVEN_RGGBu8_RGBAu8( dst, src1, src2, src3, src4, src5, w );
-				dst += dstride;
-				src1 += sstride;
-				src2 += sstride;
-				src3 += sstride;
-				src4 += sstride;
-				src5 += sstride;
-			}
-			if( h - 2 == i ) {
-				simd->debayer_ODD_RGGBu8_RGBAu8( dst, src2, src3, src4, w >> 2 );
-				dst += dstride;
-				simd->debayer_EVEN_RGGBu8_RGBAu8( dst, src3, src4, src3, w >> 2 );
-			} else {
-				simd->debayerhq_ODD_RGGBu8_RGBAu8( dst, src1, src2, src3, src4, src5, w );
-				dst += dstride;
-				simd->debayer_EVEN_RGGBu8_RGBAu8( dst, src3, src4, src5, w >> 2 );
-				dst += dstride;
-				simd->debayer_ODD_RGGBu8_RGBAu8( dst, src3, src4, src3, w >> 2 );
-			}
-
-		} else {
-			simd->debayer_ODD_RGGBu8_RGBAu8( dst, src2, src1, src2, w >> 2 );
-			dst += dstride;
-			for( i = 1; i < h - 1; i += 2 ) {
-				simd->debayer_EVEN_RGGBu8_RGBAu8( dst, src1, src2, src3, w >> 2 );
-				dst += dstride;
-				src1 += sstride;
-				src2 += sstride;
-				src3 += sstride;
-				simd->debayer_ODD_RGGBu8_RGBAu8( dst, src1, src2, src3, w >> 2 );
-				dst += dstride;
-				src1 += sstride;
-				src2 += sstride;
-				src3 += sstride;
-			}
-			if( h - 1 == i )
-				simd->debayer_EVEN_RGGBu8_RGBAu8( dst, src1, src2, src1, w >> 2 );
-			else {
-				simd->debayer_EVEN_RGGBu8_RGBAu8( dst, src1, src2, src3, w >> 2 );
-				dst += dstride;
-				simd->debayer_ODD_RGGBu8_RGBAu8( dst, src2, src3, src2, w >> 2 );
-			}
-		}
-
-            dstImage.unmap( odst );
-            sourceImage.unmap( osrc );
-    }
-
-    void Conv_BAYER_GBRG_to_GRAYu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
-    {
-        const uint32_t* src1;
-        const uint32_t* src2;
-        const uint32_t* src3;
-        const uint8_t* osrc;
-        uint32_t* dst;
-        uint8_t* odst;
-        size_t sstride;
-        size_t dstride;
-        size_t h;
-        size_t w;
-        size_t i;
-
-        SIMD* simd = SIMD::instance();
+        uint32_t norm = k * k;
+        for( size_t x = 0; x < dw; x++ ) {
+            for( size_t c = 0; c < channels; c++ ) {
+                uint32_t sum = norm >> 1;
+                for( size_t j = 0; j < k; j++ ) {
+                    const uint8_t* src = buf + j * rowstride + x * k * channels + c;
+                    for( size_t i = 0; i < k; i++ )
+                        sum += src[ i * channels ];
+                }
+                *dst++ = ( uint8_t ) ( sum / norm );
+            }
+        }
+    }
 
-        osrc = sourceImage.map( &sstride );
-        src1 = ( uint32_t* ) osrc;
-        sstride = sstride >> 2;
-        src2 = src1 + sstride;
-        src3 = src2 + sstride;
-        w = sourceImage.width();
-        h = sourceImage.height();
-        odst = dstImage.map( &dstride );
-        dst = ( uint32_t* ) odst;
-        dstride = dstride >> 2;
-
-        simd->debayer_ODD_RGGBu8_GRAYu8( dst, src2, src1, src2, w >> 2 );
-        dst += dstride;
-        for( i = 1; i < h - 1; i += 2 ) {
-            simd->debayer_EVEN_RGGBu8_GRAYu8( dst, src1, src2, src3, w >> 2 );
-            dst += dstride;
-            src1 += sstride;
-            src2 += sstride;
-            src3 += sstride;
-            simd->debayer_ODD_RGGBu8_GRAYu8( dst, src1, src2, src3, w >> 2 );
-            dst += dstride;
-            src1 += sstride;
-            src2 += sstride;
-            src3 += sstride;
+    static void _boxRow( float* dst, const uint8_t* buf, size_t rowstride, size_t dw, size_t channels, size_t k )
+    {
+        if( k == 2 ) {
+            const float* r0 = ( const float* ) buf;
+            const float* r1 = ( const float* ) ( buf + rowstride );
+            for( size_t x = 0; x < dw; x++ ) {
+                for( size_t c = 0; c < channels; c++ )
+                    *dst++ = 0.25f * ( ( r0[ c ] + r0[ channels + c ] ) + ( r1[ c ] + r1[ channels + c ] ) );
+                r0 += 2 * channels;
+                r1 += 2 * channels;
+            }
+            return;
         }
-        if( i < h ) {
-            if( ++i & 1 ) {
-                simd->debayer_EVEN_RGGBu8_GRAYu8( dst, src1, src2, src1, w >> 2 );
-            } else {
-                simd->debayer_ODD_RGGBu8_GRAYu8( dst, src1, src2, src1, w >> 2 );
+
+        float norm = 1.0f / ( float ) ( k * k );
+        for( size_t x = 0; x < dw; x++ ) {
+            for( size_t c = 0; c < channels; c++ ) {
+                float sum = 0.0f;
+                for( size_t j = 0; j < k; j++ ) {
+                    const float* src = ( const float* ) ( buf + j * rowstride ) + x * k * channels + c;
+                    for( size_t i = 0; i < k; i++ )
+                        sum += src[ i * channels ];
+                }
+                *dst++ = sum * norm;
             }
         }
-        simd->debayer_ODD_RGGBu8_GRAYu8( dst, src2, src1, src2, w >> 2 );
-        dstImage.unmap( odst );
-        sourceImage.unmap( osrc );
     }
 
-    void Conv_BAYER_GBRG_to_BGRAu8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    IConvertRows::IConvertRows( const uint8_t* src, size_t sstride, const Image& img, const IFormat& dstFormat, IConvertFlags flags ) :
+        src( src ),
+        sstride( sstride ),
+        width( img.width() ),
+        height( img.height() ),
+        channels( dstFormat.channels ),
+        format( img.format().formatID ),
+        flags( flags )
     {
-        const uint32_t* src1;
-        const uint32_t* src2;
-        const uint32_t* src3;
-        const uint8_t* osrc;
-        uint32_t* dst;
-        uint8_t* odst;
-        size_t sstride;
-        size_t dstride;
-        size_t h;
-        size_t w;
-        size_t i;
+    }
 
-        SIMD* simd = SIMD::instance();
+    /* one conversion over chunks of CVT_ICONVERT_CHUNK_ROWS rows */
+    class IConvertChunk {
+        public:
+            IConvertChunk( ConversionFunction func, const IConvertRows& rows, uint8_t* dst, size_t dstride ) :
+                _func( func ), _rows( rows ), _dst( dst ), _dstride( dstride )
+            {
+            }
 
-        osrc = sourceImage.map( &sstride );
-        src1 = ( uint32_t* ) osrc;
-        sstride = sstride >> 2;
-        src2 = src1 + sstride;
-        src3 = src2 + sstride;
-        w = sourceImage.width();
-        h = sourceImage.height();
-        odst = dstImage.map( &dstride );
-        dst = ( uint32_t* ) odst;
-        dstride = dstride >> 2;
-
-        simd->debayer_ODD_RGGBu8_BGRAu8( dst, src2, src1, src2, w >> 2 );
-        dst += dstride;
-        for( i = 1; i < h - 1; i += 2 ) {
-            simd->debayer_EVEN_RGGBu8_BGRAu8( dst, src1, src2, src3, w >> 2 );
-            dst += dstride;
-            src1 += sstride;
-            src2 += sstride;
-            src3 += sstride;
-            simd->debayer_ODD_RGGBu8_BGRAu8( dst, src1, src2, src3, w >> 2 );
-            dst += dstride;
-            src1 += sstride;
-            src2 += sstride;
-            src3 += sstride;
-        }
-        if( i < h ) {
-            if( i & 1 ) {
-                simd->debayer_EVEN_RGGBu8_BGRAu8( dst, src1, src2, src1, w >> 2 );
-            } else {
-                simd->debayer_ODD_RGGBu8_BGRAu8( dst, src1, src2, src1, w >> 2 );
+            void operator()( size_t begin, size_t end ) const
+            {
+                _func( _dst + begin * _dstride, _dstride, _rows, begin, end );
+            }
+
+        private:
+            ConversionFunction  _func;
+            const IConvertRows& _rows;
+            uint8_t*            _dst;
+            size_t              _dstride;
+    };
+
+    /* converts the k source rows of every output row into a row buffer and averages k x k blocks */
+    class IConvertScaledChunk {
+        public:
+            IConvertScaledChunk( ConversionFunction func, const IConvertRows& rows, uint8_t* dst, size_t dstride,
+                                 size_t dw, size_t k, bool isFloat ) :
+                _func( func ), _rows( rows ), _dst( dst ), _dstride( dstride ), _dw( dw ), _k( k ), _float( isFloat )
+            {
+            }
+
+            void operator()( size_t begin, size_t end ) const
+            {
+                size_t rowstride = Math::pad16( _rows.width * _rows.channels * ( _float ? sizeof( float ) : 1 ) );
+                ScopedBuffer<uint8_t, true> buf( rowstride * _k );
+                uint8_t* dst = _dst + begin * _dstride;
+
+                for( size_t y = begin; y < end; y++ ) {
+                    _func( buf.ptr(), rowstride, _rows, y * _k, ( y + 1 ) * _k );
+                    if( _float )
+                        _boxRow( ( float* ) dst, buf.ptr(), rowstride, _dw, _rows.channels, _k );
+                    else
+                        _boxRow( dst, buf.ptr(), rowstride, _dw, _rows.channels, _k );
+                    dst += _dstride;
+                }
             }
-        }
-        dstImage.unmap( odst );
-        sourceImage.unmap( osrc );
-    }
+
+        private:
+            ConversionFunction  _func;
+            const IConvertRows& _rows;
+            uint8_t*            _dst;
+            size_t              _dstride;
+            size_t              _dw;
+            size_t              _k;
+            bool                _float;
+    };
 
     IConvert::IConvert():
         _convertFuncs( 0 )
@@ -989,11 +652,13 @@ namespace cvt {
         TABLE( _convertFuncs, IFORMAT_BAYER_RGGB_UINT8, IFORMAT_GRAY_UINT8 ) = &Conv_BAYER_RGGB_to_GRAYu8;
         TABLE( _convertFuncs, IFORMAT_BAYER_RGGB_UINT8, IFORMAT_RGBA_UINT8 ) = &Conv_BAYER_RGGB_to_RGBAu8;
         TABLE( _convertFuncs, IFORMAT_BAYER_RGGB_UINT8, IFORMAT_BGRA_UINT8 ) = &Conv_BAYER_RGGB_to_BGRAu8;
+        TABLE( _convertFuncs, IFORMAT_BAYER_RGGB_UINT8, IFORMAT_GRAY_FLOAT ) = &Conv_BAYER_RGGB_to_GRAYf;
 
         /* GBRG_UINT8 to X */
-        TABLE( _convertFuncs, IFORMAT_BAYER_GBRG_UINT8, IFORMAT_GRAY_UINT8 ) = &Conv_BAYER_RGGB_to_GRAYu8;
+        TABLE( _convertFuncs, IFORMAT_BAYER_GBRG_UINT8, IFORMAT_GRAY_UINT8 ) = &Conv_BAYER_GBRG_to_GRAYu8;
         TABLE( _convertFuncs, IFORMAT_BAYER_GBRG_UINT8, IFORMAT_RGBA_UINT8 ) = &Conv_BAYER_GBRG_to_RGBAu8;
         TABLE( _convertFuncs, IFORMAT_BAYER_GBRG_UINT8, IFORMAT_BGRA_UINT8 ) = &Conv_BAYER_GBRG_to_BGRAu8;
+        TABLE( _convertFuncs, IFORMAT_BAYER_GBRG_UINT8, IFORMAT_GRAY_FLOAT ) = &Conv_BAYER_GBRG_to_GRAYf;
 
         /* YUYV_UINT8 to X */
         TABLE( _convertFuncs, IFORMAT_YUYV_UINT8, IFORMAT_GRAY_UINT8 ) = &Conv_YUYVu8_to_GRAYu8;
@@ -1008,6 +673,28 @@ namespace cvt {
         TABLE( _convertFuncs, IFORMAT_UYVY_UINT8, IFORMAT_RGBA_UINT8 ) = &Conv_UYVYu8_to_RGBAu8;
         TABLE( _convertFuncs, IFORMAT_UYVY_UINT8, IFORMAT_BGRA_UINT8 ) = &Conv_UYVYu8_to_BGRAu8;
         TABLE( _convertFuncs, IFORMAT_UYVY_UINT8, IFORMAT_GRAY_FLOAT ) = &Conv_UYVYu8_to_GRAYf;
+
+        /* YUV420_PLANAR_UINT8 TO X */
+        TABLE( _convertFuncs, IFORMAT_YUV420_PLANAR_UINT8, IFORMAT_GRAY_UINT8 ) = &Conv_YUV420u8_to_GRAYu8;
+        TABLE( _convertFuncs, IFORMAT_YUV420_PLANAR_UINT8, IFORMAT_GRAY_FLOAT ) = &Conv_YUV420u8_to_GRAYf;
+        TABLE( _convertFuncs, IFORMAT_YUV420_PLANAR_UINT8, IFORMAT_RGBA_UINT8 ) = &Conv_YUV420u8_to_RGBAu8;
+        TABLE( _convertFuncs, IFORMAT_YUV420_PLANAR_UINT8, IFORMAT_BGRA_UINT8 ) = &Conv_YUV420u8_to_BGRAu8;
+
+        /* NV12_UINT8 TO X */
+        TABLE( _convertFuncs, IFORMAT_NV12_UINT8, IFORMAT_GRAY_UINT8 ) = &Conv_YUV420u8_to_GRAYu8;
+        TABLE( _convertFuncs, IFORMAT_NV12_UINT8, IFORMAT_GRAY_FLOAT ) = &Conv_YUV420u8_to_GRAYf;
+        TABLE( _convertFuncs, IFORMAT_NV12_UINT8, IFORMAT_RGBA_UINT8 ) = &Conv_YUV420u8_to_RGBAu8;
+        TABLE( _convertFuncs, IFORMAT_NV12_UINT8, IFORMAT_BGRA_UINT8 ) = &Conv_YUV420u8_to_BGRAu8;
+
+        /* HALF <-> X */
+        TABLE( _convertFuncs, IFORMAT_GRAY_FLOAT, IFORMAT_GRAY_HALF ) = &Conv_f_to_f16;
+        TABLE( _convertFuncs, IFORMAT_GRAY_HALF, IFORMAT_GRAY_FLOAT ) = &Conv_f16_to_f;
+        TABLE( _convertFuncs, IFORMAT_RGBA_FLOAT, IFORMAT_RGBA_HALF ) = &Conv_f_to_f16;
+        TABLE( _convertFuncs, IFORMAT_RGBA_HALF, IFORMAT_RGBA_FLOAT ) = &Conv_f16_to_f;
+        TABLE( _convertFuncs, IFORMAT_GRAY_UINT8, IFORMAT_GRAY_HALF ) = &Conv_u8_to_f16;
+        TABLE( _convertFuncs, IFORMAT_GRAY_HALF, IFORMAT_GRAY_UINT8 ) = &Conv_f16_to_u8;
+        TABLE( _convertFuncs, IFORMAT_RGBA_UINT8, IFORMAT_RGBA_HALF ) = &Conv_u8_to_f16;
+        TABLE( _convertFuncs, IFORMAT_RGBA_HALF, IFORMAT_RGBA_UINT8 ) = &Conv_f16_to_u8;
     }
 
     const IConvert& IConvert::instance()
@@ -1020,28 +707,86 @@ namespace cvt {
     }
 
 
-    void IConvert::convert( Image & dst, const Image & src, IConvertFlags flags )
+    ConversionFunction IConvert::function( const IFormat& src, const IFormat& dst )
     {
-        if( src.format() == dst.format() ) {
-            dst = src;
-            return;
-        }
-
-        IFormatID sourceID = src.format().formatID;
-        IFormatID dstID = dst.format().formatID;
+        if( src == dst )
+            return &Conv_copy;
+        if( src.formatID > LAST_FORMAT || dst.formatID > LAST_FORMAT )
+            return NULL;
+        const IConvert& self = IConvert::instance();
+        return self.TABLE( _convertFuncs, src.formatID, dst.formatID );
+    }
 
-        if( sourceID > LAST_FORMAT )
+    static ConversionFunction _conversionFunction( const Image& dst, const Image& src )
+    {
+        if( src.format().formatID > LAST_FORMAT )
             throw CVTException( "Source format unkown" );
-        if( dstID > LAST_FORMAT )
+        if( dst.format().formatID > LAST_FORMAT )
             throw CVTException( "Destination format unkown" );
 
-        const IConvert& self = IConvert::instance();
-        if( self.TABLE( _convertFuncs, sourceID, dstID ) ){
-            self.TABLE( _convertFuncs, sourceID, dstID)( dst, src, flags );
-        } else {
+        ConversionFunction func = IConvert::function( src.format(), dst.format() );
+        if( !func ) {
             std::cerr << "CONVERSION MISSING: " << src.format() << " -> " << dst.format() << std::endl;
             throw CVTException( "Conversion not implemented!" );
         }
+        return func;
+    }
+
+    IConvertPath IConvert::convert( Image & dst, const Image & src, IConvertFlags flags )
+    {
+        if( src.format() == dst.format() ) {
+            dst = src;
+            return ICONVERT_PATH_COPY;
+        }
+
+        ConversionFunction func = _conversionFunction( dst, src );
+
+        size_t sstride, dstride;
+        const uint8_t* sbase = src.map( &sstride );
+        uint8_t* dbase = dst.map( &dstride );
+        IConvertRows rows( sbase, sstride, src, dst.format(), flags );
+
+        IConvertChunk chunk( func, rows, dbase, dstride );
+        bool parallel = parallelFor( 0, rows.height, chunk, CVT_ICONVERT_CHUNK_ROWS );
+
+        src.unmap( sbase );
+        dst.unmap( dbase );
+
+        return parallel ? ICONVERT_PATH_PARALLEL : ICONVERT_PATH_SERIAL;
+    }
+
+    IConvertPath IConvert::convertScaled( Image& dst, const Image& src, IConvertFlags flags )
+    {
+        if( dst.width() == src.width() && dst.height() == src.height() )
+            return convert( dst, src, flags );
+
+        if( !dst.width() || !dst.height() || dst.width() > src.width() || dst.height() > src.height() )
+            throw CVTException( "convertScaled only reduces the image size" );
+
+        size_t k = src.width() / dst.width();
+        const IFormat& format = dst.format();
+        bool isFloat = format.type == IFORMAT_TYPE_FLOAT;
+        bool exact = src.width() == k * dst.width() && src.height() == k * dst.height();
+        ConversionFunction func = exact ? function( src.format(), format ) : NULL;
+
+        if( !func || format.isPlanar() || ( !isFloat && format.type != IFORMAT_TYPE_UINT8 ) ) {
+            Image tmp( src.width(), src.height(), format );
+            convert( tmp, src, flags );
+            tmp.scale( dst, dst.width(), dst.height(), IScaleFilterGauss() );
+            return ICONVERT_PATH_CHAINED;
+        }
+
+        size_t sstride, dstride;
+        const uint8_t* sbase = src.map( &sstride );
+        uint8_t* dbase = dst.map( &dstride );
+        IConvertRows rows( sbase, sstride, src, format, flags );
+
+        IConvertScaledChunk chunk( func, rows, dbase, dstride, dst.width(), k, isFloat );
+        parallelFor( 0, dst.height(), chunk, Math::max<size_t>( CVT_ICONVERT_CHUNK_ROWS / k, 1 ) );
+
+        src.unmap( sbase );
+        dst.unmap( dbase );
+        return ICONVERT_PATH_FUSED;
     }
 
 }
@@ -47,13 +47,51 @@ namespace cvt
 
 	CVT_ENUM_TO_FLAGS( IConvertFlagTypes, IConvertFlags )
 
-	typedef void (*ConversionFunction)( Image&, const Image&, IConvertFlags flags );
+	/* the way a conversion was executed */
+	enum IConvertPath {
+		ICONVERT_PATH_SHARED,	/* same format, the destination references the source memory */
+		ICONVERT_PATH_SERIAL,	/* one pass over all rows in the calling thread */
+		ICONVERT_PATH_PARALLEL,	/* one pass, chunks of rows are distributed over the ThreadPool */
+		ICONVERT_PATH_FUSED,	/* compound operation in one pass without intermediate images */
+		ICONVERT_PATH_CHAINED,	/* compound operation through an intermediate image */
+		ICONVERT_PATH_COPY		/* same format, the source is copied into the destination */
+	};
+
+	/* source rows of a conversion, channels is the channel count of the destination format */
+	struct IConvertRows {
+		IConvertRows( const uint8_t* src, size_t sstride, const Image& img, const IFormat& dstFormat, IConvertFlags flags );
+
+		const uint8_t*	src;
+		size_t			sstride;
+		size_t			width;
+		size_t			height;
+		size_t			channels;
+		IFormatID		format;
+		IConvertFlags	flags;
+	};
+
+	/*
+	   converts the source rows [ begin, end ) into dst, dst points to the destination row of begin.
+	   Rows are independent of each other, conversions that need neighbouring rows read them from the source.
+	 */
+	typedef void (*ConversionFunction)( uint8_t* dst, size_t dstride, const IConvertRows& rows, size_t begin, size_t end );
 
 	class IConvert
 	{
 		public:
-			/* conversion from source format to dst format */
-			static void convert( Image& dst, const Image& src, IConvertFlags flags = ICONVERT_DEBAYER_LINEAR );
+			/* conversion from source format to dst format, rows are converted in parallel, equal formats are copied */
+			static IConvertPath convert( Image& dst, const Image& src, IConvertFlags flags = ICONVERT_DEBAYER_LINEAR );
+
+			/**
+			  \brief conversion to the format and the smaller size of dst
+			  \desc  if both sizes of src are exactly k times the sizes of dst and dst is a UINT8 or FLOAT format,
+					 every k source rows are converted into a row buffer and averaged over k x k blocks in the same pass.
+					 Other sizes and formats convert into an intermediate image and scale it with IScaleFilterGauss.
+			 */
+			static IConvertPath convertScaled( Image& dst, const Image& src, IConvertFlags flags = ICONVERT_DEBAYER_LINEAR );
+
+			/* row conversion from src to dst for fusing conversions into other row sweeps, NULL if not implemented */
+			static ConversionFunction function( const IFormat& src, const IFormat& dst );
 
 			static const IConvert & instance();
 
@@ -26,12 +26,107 @@
 #include <cvt/gfx/Image.h>
 #include <cvt/gfx/IMapScoped.h>
 #include <cvt/gfx/IBorder.h>
+#include <cvt/util/Mutex.h>
 #include <cvt/util/SIMD.h>
 #include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/math/FFT.h>
+
+#include <algorithm>
+#include <list>
+#include <vector>
 
 namespace cvt {
 
-	/* general template use for separable convolution ( except the constant border case ) */
+#define CVT_ICONVOLVE_CHUNK_ROWS 64
+
+	/* source line y, rows outside the image are mapped by the border type or are zero for the constant border */
+	template<typename T>
+	static inline const T* _convolveLine( const uint8_t* base, size_t stride, ssize_t y, ssize_t h, IBorderType btype, const T* zero )
+	{
+		if( y < 0 || y >= h )
+			y = IBorder::value<ssize_t>( y, h, btype );
+		return y < 0 ? zero : ( const T* ) ( base + stride * y );
+	}
+
+	/* kh line buffers of bstride elements each */
+	template<typename BUFTYPE>
+	static inline void _convolveBuffers( BUFTYPE** buf, BUFTYPE* mem, size_t bstride, size_t kh )
+	{
+		buf[ 0 ] = mem;
+		for( size_t i = 1; i < kh; i++ )
+			buf[ i ] = buf[ i - 1 ] + bstride;
+	}
+
+	/*
+	   Separable convolution of the rows [begin, end): the ring of kh horizontally
+	   convolved lines is refilled at the start of every range, therefore each
+	   output row is independent of the partitioning.
+	 */
+	template<typename DSTTYPE, typename SRCTYPE, typename BUFTYPE, typename KERNTYPE>
+	class SeparableConvolveBody
+	{
+		public:
+			typedef void ( SIMD::*HConvFunc )( BUFTYPE*, const SRCTYPE*, size_t, const KERNTYPE* , size_t, IBorderType type ) const;
+			typedef void ( SIMD::*VConvFunc )( DSTTYPE*, const BUFTYPE**, const KERNTYPE* , size_t, size_t ) const;
+
+			SeparableConvolveBody( uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, size_t w, size_t h, size_t channels,
+								   const KERNTYPE* hkern, size_t kw, const KERNTYPE* vkern, size_t kh,
+								   HConvFunc hconv, VConvFunc vconv, IBorderType btype ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _w( w ), _h( h ), _channels( channels ),
+				_hkern( hkern ), _kw( kw ), _vkern( vkern ), _kh( kh ), _hconv( hconv ), _vconv( vconv ), _btype( btype )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				SIMD* simd = SIMD::instance();
+				size_t widthchannels = _w * _channels;
+				size_t bstride = Math::pad16( sizeof( BUFTYPE ) * widthchannels ) / sizeof( BUFTYPE );
+				ssize_t b1 = ( _kh >> 1 );
+				ssize_t b2 = _kh - b1 - 1;
+
+				ScopedBuffer<BUFTYPE,true> bufmem( bstride * _kh );
+				ScopedBuffer<BUFTYPE*,true> bufptr( _kh );
+				ScopedBuffer<SRCTYPE,true> zero( widthchannels );
+				SIMD::instance()->SetValueU8( ( uint8_t* ) zero.ptr(), 0, sizeof( SRCTYPE ) * widthchannels );
+				BUFTYPE** buf = bufptr.ptr();
+				_convolveBuffers( buf, bufmem.ptr(), bstride, _kh );
+
+				for( ssize_t k = -b1; k < b2; k++ )
+					( simd->*_hconv )( buf[ k + b1 + 1 ], line( ( ssize_t ) begin + k, zero.ptr() ), _w, _hkern, _kw, _btype );
+
+				for( size_t cy = begin; cy < end; cy++ ) {
+					BUFTYPE* tmp = buf[ 0 ];
+					for( size_t k = 0; k < _kh - 1; k++ )
+						buf[ k ] = buf[ k + 1 ];
+					buf[ _kh - 1 ] = tmp;
+					( simd->*_hconv )( tmp, line( cy + b2, zero.ptr() ), _w, _hkern, _kw, _btype );
+					( simd->*_vconv )( ( DSTTYPE* ) ( _dst + _dstride * cy ), ( const BUFTYPE** ) buf, _vkern, _kh, widthchannels );
+				}
+			}
+
+		private:
+			const SRCTYPE* line( ssize_t y, const SRCTYPE* zero ) const
+			{
+				return _convolveLine<SRCTYPE>( _src, _sstride, y, _h, _btype, zero );
+			}
+
+			uint8_t*		_dst;
+			size_t			_dstride;
+			const uint8_t*	_src;
+			size_t			_sstride;
+			size_t			_w, _h, _channels;
+			const KERNTYPE*	_hkern;
+			size_t			_kw;
+			const KERNTYPE*	_vkern;
+			size_t			_kh;
+			HConvFunc		_hconv;
+			VConvFunc		_vconv;
+			IBorderType		_btype;
+	};
+
+	/* general template use for separable convolution */
 	template<typename DSTTYPE, typename SRCTYPE, typename BUFTYPE, typename KERNTYPE>
 	static void convolveSeparableTemplate( Image& dst, const Image& src, const KERNTYPE* hkern, size_t kw, const KERNTYPE* vkern, size_t kh,
 										   void ( SIMD::*hconv )( BUFTYPE*, const SRCTYPE*, size_t, const KERNTYPE* , size_t, IBorderType type ) const,
@@ -39,67 +134,68 @@ namespace cvt {
 										   IBorderType btype
 										 )
 	{
-		SIMD* simd = SIMD::instance();
-		ssize_t w = src.width();
-		ssize_t h = src.height();
-		size_t widthchannels = w * src.channels();
-		size_t bstride = Math::pad16( sizeof( BUFTYPE ) * widthchannels ) / sizeof( BUFTYPE ); //FIXME: does this always work - it should
-		BUFTYPE** buf;
-		ssize_t cy;
-
 		IMapScoped<DSTTYPE> mapdst( dst );
 		IMapScoped<const SRCTYPE> mapsrc( src );
 
-		ssize_t b1 = ( kh >> 1 );
-		ssize_t b2 = kh - b1 - 1;
+		SeparableConvolveBody<DSTTYPE, SRCTYPE, BUFTYPE, KERNTYPE> body( ( uint8_t* ) mapdst.base(), mapdst.stride(),
+																		 ( const uint8_t* ) mapsrc.base(), mapsrc.stride(),
+																		 src.width(), src.height(), src.channels(),
+																		 hkern, kw, vkern, kh, hconv, vconv, btype );
+		parallelFor( 0, src.height(), body, Math::max<size_t>( CVT_ICONVOLVE_CHUNK_ROWS, kh ) );
+	}
 
-		/* allocate buffers and fill buffer*/
-		ScopedBuffer<BUFTYPE,true> bufmem( bstride * kh );
-		ScopedBuffer<BUFTYPE*,true> bufptr( kh );
+	/* direct convolution of the rows [begin, end), each kernel row is applied horizontally and the results are summed */
+	template<typename DSTTYPE, typename SRCTYPE, typename BUFTYPE, typename KERNTYPE>
+	class ConvolveBody
+	{
+		public:
+			typedef void ( SIMD::*ConvFunc )( BUFTYPE*, const SRCTYPE*, size_t, const KERNTYPE* , size_t, IBorderType type ) const;
+			typedef void ( SIMD::*AvgFunc )( DSTTYPE*, const BUFTYPE**, size_t, size_t ) const;
 
-		buf = bufptr.ptr();
-		buf[ 0 ] = bufmem.ptr();
-		for( size_t i = 1; i < kh; i++ )
-			buf[ i ] = buf[ i - 1 ] + bstride;
+			ConvolveBody( uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, size_t w, size_t h, size_t channels,
+						  const KERNTYPE* kern, size_t kw, size_t kh, ConvFunc conv, AvgFunc avg, IBorderType btype ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _w( w ), _h( h ), _channels( channels ),
+				_kern( kern ), _kw( kw ), _kh( kh ), _conv( conv ), _avg( avg ), _btype( btype )
+			{
+			}
 
-		for( ssize_t k = -b1; k <= b2; k++ ) {
-			ssize_t y = IBorder::value( k, h, btype );
-			( simd->*hconv )( buf[ k + b1 ], mapsrc.line( y ), w, hkern, kw, btype );
-		}
-		/* process first line */
-		( simd->*vconv )( mapdst.ptr(), ( const BUFTYPE** ) buf, vkern, kh, widthchannels );
-		mapdst++;
+			void operator()( size_t begin, size_t end ) const
+			{
+				SIMD* simd = SIMD::instance();
+				size_t widthchannels = _w * _channels;
+				size_t bstride = Math::pad16( sizeof( BUFTYPE ) * widthchannels ) / sizeof( BUFTYPE );
+				ssize_t b1 = ( _kh >> 1 );
 
-		mapsrc.setLine( b2 + 1 );
-		/* main part */
-		for( cy = 1; cy < h - b2; cy++ )
-		{
-				BUFTYPE* tmp = buf[ 0 ];
-				for( size_t k = 0; k < kh - 1; k++ )
-					buf[ k ] = buf[ k + 1 ];
-				buf[ kh - 1 ] = tmp;
-				( simd->*hconv )( tmp, mapsrc.ptr(), w, hkern, kw, btype );
-				( simd->*vconv )( mapdst.ptr(), ( const BUFTYPE** ) buf, vkern, kh, widthchannels );
-				mapdst++;
-				mapsrc++;
+				ScopedBuffer<BUFTYPE,true> bufmem( bstride * _kh );
+				ScopedBuffer<BUFTYPE*,true> bufptr( _kh );
+				ScopedBuffer<SRCTYPE,true> zero( widthchannels );
+				SIMD::instance()->SetValueU8( ( uint8_t* ) zero.ptr(), 0, sizeof( SRCTYPE ) * widthchannels );
+				BUFTYPE** buf = bufptr.ptr();
+				_convolveBuffers( buf, bufmem.ptr(), bstride, _kh );
 
-		}
+				for( size_t cy = begin; cy < end; cy++ ) {
+					for( size_t k = 0; k < _kh; k++ ) {
+						const SRCTYPE* src = _convolveLine<SRCTYPE>( _src, _sstride, ( ssize_t ) ( cy + k ) - b1, _h, _btype, zero.ptr() );
+						( simd->*_conv )( buf[ k ], src, _w, _kern + _kw * k, _kw, _btype );
+					}
+					( simd->*_avg )( ( DSTTYPE* ) ( _dst + _dstride * cy ), ( const BUFTYPE** ) buf, _kh, widthchannels );
+				}
+			}
 
-		/* lower border */
-		for( ; cy < h; cy++ ) {
-			BUFTYPE* tmp = buf[ 0 ];
-			for( size_t k = 0; k < kh - 1; k++ )
-				buf[ k ] = buf[ k + 1 ];
-			buf[ kh - 1 ] = tmp;
-			ssize_t y = IBorder::value( cy + b2, h, btype );
-			( simd->*hconv )( tmp, mapsrc.line( y ), w, hkern, kw, btype );
-			( simd->*vconv )( mapdst.ptr(), ( const BUFTYPE** ) buf, vkern, kh, widthchannels );
-			mapdst++;
-		}
+		private:
+			uint8_t*		_dst;
+			size_t			_dstride;
+			const uint8_t*	_src;
+			size_t			_sstride;
+			size_t			_w, _h, _channels;
+			const KERNTYPE*	_kern;
+			size_t			_kw, _kh;
+			ConvFunc		_conv;
+			AvgFunc			_avg;
+			IBorderType		_btype;
+	};
 
-	}
-
-	/* general template use for convolution ( except the constant border case ) */
+	/* general template use for convolution */
 	template<typename DSTTYPE, typename SRCTYPE, typename BUFTYPE, typename KERNTYPE>
 	static void convolveTemplate( Image& dst, const Image& src, const KERNTYPE* kern, ssize_t kw, ssize_t kh,
 										   void ( SIMD::*conv )( BUFTYPE*, const SRCTYPE*, size_t, const KERNTYPE* , size_t, IBorderType type ) const,
@@ -107,65 +203,520 @@ namespace cvt {
 										   IBorderType btype
 										 )
 	{
-		SIMD* simd = SIMD::instance();
-		ssize_t w = src.width();
-		ssize_t h = src.height();
-		size_t widthchannels = w * src.channels();
-		size_t bstride = Math::pad16( sizeof( BUFTYPE ) * widthchannels ) / sizeof( BUFTYPE ); //FIXME: does this always work - it should
-		BUFTYPE** buf;
-		ssize_t cy;
-
 		IMapScoped<DSTTYPE> mapdst( dst );
 		IMapScoped<const SRCTYPE> mapsrc( src );
 
-		ssize_t b1 = ( kh >> 1 );
-		ssize_t b2 = kh - b1 - 1;
+		ConvolveBody<DSTTYPE, SRCTYPE, BUFTYPE, KERNTYPE> body( ( uint8_t* ) mapdst.base(), mapdst.stride(),
+																( const uint8_t* ) mapsrc.base(), mapsrc.stride(),
+																src.width(), src.height(), src.channels(),
+																kern, kw, kh, conv, avg, btype );
+		parallelFor( 0, src.height(), body, CVT_ICONVOLVE_CHUNK_ROWS );
+	}
 
-		/* allocate buffers and fill buffer*/
-		ScopedBuffer<BUFTYPE,true> bufmem( bstride * kh );
-		ScopedBuffer<BUFTYPE*,true> bufptr( kh );
+	/*
+	   Direct convolution of single channel float images with a K x K kernel known at compile time,
+	   the inner loops are unrolled and no line buffers are needed. The border columns use the
+	   same border mapping as the horizontal SIMD convolutions. Only instantiated for K = 3 and 5,
+	   for K = 7 the SIMD line convolutions are faster.
+	 */
+	template<int K>
+	class ConvolveFixedBody
+	{
+		public:
+			ConvolveFixedBody( uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, size_t w, size_t h,
+							   const float* kern, IBorderType btype ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _w( w ), _h( h ), _kern( kern ), _btype( btype )
+			{
+			}
 
-		buf = bufptr.ptr();
-		buf[ 0 ] = bufmem.ptr();
-		for( ssize_t i = 1; i < kh; i++ )
-			buf[ i ] = buf[ i - 1 ] + bstride;
+			void operator()( size_t begin, size_t end ) const
+			{
+				const ssize_t b = K >> 1;
+				const ssize_t w = _w;
+				ScopedBuffer<float,true> zero( _w );
+				SIMD::instance()->SetValueU8( ( uint8_t* ) zero.ptr(), 0, sizeof( float ) * _w );
 
+				for( size_t cy = begin; cy < end; cy++ ) {
+					const float* rows[ K ];
+					for( int j = 0; j < K; j++ )
+						rows[ j ] = _convolveLine<float>( _src, _sstride, ( ssize_t ) cy + j - b, _h, _btype, zero.ptr() );
+					float* dst = ( float* ) ( _dst + _dstride * cy );
 
-		/* upper border */
-		for( cy = 0; cy < b1; cy++ ) {
-			for( ssize_t k = 0; k < kh; k++ ) {
-				ssize_t y = IBorder::value( cy - b1 + k, h, btype );
-				( simd->*conv )( buf[ k ], mapsrc.line( y ), w, kern + kw * k, kw, btype );
+					ssize_t x = 0;
+					for( ; x < b && x < w; x++ )
+						dst[ x ] = border( rows, x );
+					if( w > 2 * b ) {
+						/* kernel rows are accumulated in the destination row, the loop over x vectorizes */
+						for( int j = 0; j < K; j++ ) {
+							const float* src = rows[ j ] - b;
+							float k[ K ];
+							for( int i = 0; i < K; i++ )
+								k[ i ] = _kern[ j * K + i ];
+							for( ssize_t xi = b; xi < w - b; xi++ ) {
+								float sum = j ? dst[ xi ] : 0.0f;
+								for( int i = 0; i < K; i++ )
+									sum += k[ i ] * src[ xi + i ];
+								dst[ xi ] = sum;
+							}
+						}
+						x = w - b;
+					}
+					for( ; x < w; x++ )
+						dst[ x ] = border( rows, x );
+				}
 			}
-			( simd->*avg )( mapdst.ptr(), ( const BUFTYPE** ) buf, kh, widthchannels );
-			mapdst++;
-		}
 
-		/* main part */
-		for( ; cy < h - b2; cy++ )
-		{
-			for( ssize_t k = 0; k < kh; k++ ) {
-				( simd->*conv )( buf[ k ], mapsrc.line( cy - b1 + k ), w, kern + kw * k, kw, btype );
+		private:
+			float border( const float* const* rows, ssize_t x ) const
+			{
+				float sum = 0.0f;
+				for( int i = 0; i < K; i++ ) {
+					ssize_t sx = IBorder::value<ssize_t>( x + i - ( K >> 1 ), _w, _btype );
+					if( sx < 0 )
+						continue;
+					for( int j = 0; j < K; j++ )
+						sum += _kern[ j * K + i ] * rows[ j ][ sx ];
+				}
+				return sum;
 			}
-			( simd->*avg )( mapdst.ptr(), ( const BUFTYPE** ) buf, kh, widthchannels );
-			mapdst++;
-		}
 
-		/* lower border */
-		for( ; cy < h; cy++ ) {
-			for( ssize_t k = 0; k < kh; k++ ) {
-				ssize_t y = IBorder::value( cy - b1 + k, h, btype );
-				( simd->*conv )( buf[ k ], mapsrc.line( y ), w, kern + kw * k, kw, btype );
+			uint8_t*		_dst;
+			size_t			_dstride;
+			const uint8_t*	_src;
+			size_t			_sstride;
+			size_t			_w, _h;
+			const float*	_kern;
+			IBorderType		_btype;
+	};
+
+	template<int K>
+	static void convolveFixedTemplate( Image& dst, const Image& src, const float* kern, IBorderType btype )
+	{
+		IMapScoped<float> mapdst( dst );
+		IMapScoped<const float> mapsrc( src );
+
+		ConvolveFixedBody<K> body( ( uint8_t* ) mapdst.base(), mapdst.stride(), ( const uint8_t* ) mapsrc.base(), mapsrc.stride(),
+								   src.width(), src.height(), kern, btype );
+		parallelFor( 0, src.height(), body, CVT_ICONVOLVE_CHUNK_ROWS );
+	}
+
+	/*
+	   Sum of r separable float convolutions: every term keeps its own ring of horizontally
+	   convolved lines, the vertical convolutions are accumulated in the destination row.
+	 */
+	class LowRankConvolveBody
+	{
+		public:
+			typedef void ( SIMD::*HConvFunc )( float*, const float*, size_t, const float* , size_t, IBorderType type ) const;
+
+			LowRankConvolveBody( uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, size_t w, size_t h, size_t channels,
+								 const std::vector<IKernel>& hkernels, const std::vector<IKernel>& vkernels, HConvFunc hconv, IBorderType btype ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _w( w ), _h( h ), _channels( channels ),
+				_hkernels( hkernels ), _vkernels( vkernels ), _hconv( hconv ), _btype( btype )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				SIMD* simd = SIMD::instance();
+				size_t widthchannels = _w * _channels;
+				size_t bstride = Math::pad16( sizeof( float ) * widthchannels ) / sizeof( float );
+				size_t rank = _hkernels.size();
+				size_t kw = _hkernels[ 0 ].width();
+				size_t kh = _vkernels[ 0 ].height();
+				ssize_t b1 = ( kh >> 1 );
+				ssize_t b2 = kh - b1 - 1;
+
+				ScopedBuffer<float,true> bufmem( bstride * ( kh * rank + 1 ) );
+				ScopedBuffer<float*,true> bufptr( kh * rank );
+				ScopedBuffer<float,true> zero( widthchannels );
+				simd->SetValueU8( ( uint8_t* ) zero.ptr(), 0, sizeof( float ) * widthchannels );
+				float* tmp = bufmem.ptr() + bstride * kh * rank;
+				for( size_t r = 0; r < rank; r++ )
+					_convolveBuffers( bufptr.ptr() + r * kh, bufmem.ptr() + r * kh * bstride, bstride, kh );
+
+				for( size_t r = 0; r < rank; r++ ) {
+					float** buf = bufptr.ptr() + r * kh;
+					for( ssize_t k = -b1; k < b2; k++ )
+						( simd->*_hconv )( buf[ k + b1 + 1 ], line( ( ssize_t ) begin + k, zero.ptr() ), _w, _hkernels[ r ].ptr(), kw, _btype );
+				}
+
+				for( size_t cy = begin; cy < end; cy++ ) {
+					const float* src = line( cy + b2, zero.ptr() );
+					float* dst = ( float* ) ( _dst + _dstride * cy );
+					for( size_t r = 0; r < rank; r++ ) {
+						float** buf = bufptr.ptr() + r * kh;
+						float* last = buf[ 0 ];
+						for( size_t k = 0; k < kh - 1; k++ )
+							buf[ k ] = buf[ k + 1 ];
+						buf[ kh - 1 ] = last;
+						( simd->*_hconv )( last, src, _w, _hkernels[ r ].ptr(), kw, _btype );
+						simd->ConvolveClampVert_f( r ? tmp : dst, ( const float** ) buf, _vkernels[ r ].ptr(), kh, widthchannels );
+						if( r )
+							simd->Add( dst, dst, tmp, widthchannels );
+					}
+				}
+			}
+
+		private:
+			const float* line( ssize_t y, const float* zero ) const
+			{
+				return _convolveLine<float>( _src, _sstride, y, _h, _btype, zero );
+			}
+
+			uint8_t*					_dst;
+			size_t						_dstride;
+			const uint8_t*				_src;
+			size_t						_sstride;
+			size_t						_w, _h, _channels;
+			const std::vector<IKernel>&	_hkernels;
+			const std::vector<IKernel>&	_vkernels;
+			HConvFunc					_hconv;
+			IBorderType					_btype;
+	};
+
+	static inline void _runningSumStore( float* dst, double value )
+	{
+		*dst = ( float ) value;
+	}
+
+	static inline void _runningSumStore( uint8_t* dst, double value )
+	{
+		*dst = ( uint8_t ) Math::clamp( value + 0.5, 0.0, 255.0 );
+	}
+
+	/*
+	   Convolution with a constant kernel by running sums: the column sums over kh lines are
+	   updated by the entering and the leaving line, the output row is the running sum of kw
+	   column sums. The column sums restart every CVT_ICONVOLVE_CHUNK_ROWS rows so that the
+	   rounding does not depend on the partitioning. The cost per pixel is independent of the
+	   kernel size.
+	 */
+	template<typename DSTTYPE, typename SRCTYPE>
+	class RunningSumConvolveBody
+	{
+		public:
+			RunningSumConvolveBody( uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, size_t w, size_t h, size_t channels,
+									size_t kw, size_t kh, float value, IBorderType btype ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _w( w ), _h( h ), _channels( channels ),
+				_kw( kw ), _kh( kh ), _value( value ), _btype( btype )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				size_t widthchannels = _w * _channels;
+				ssize_t b1 = ( _kh >> 1 );
+				ssize_t b2 = _kh - b1 - 1;
+				ssize_t a = ( _kw >> 1 );
+
+				/* column sums with a border of a columns on the left and kw - a - 1 columns on the right */
+				ScopedBuffer<double,true> colmem( ( _w + _kw - 1 ) * _channels );
+				double* ext = colmem.ptr();
+				double* col = ext + a * _channels;
+
+				for( size_t cy = begin; cy < end; cy++ ) {
+					if( cy == begin || cy % CVT_ICONVOLVE_CHUNK_ROWS == 0 ) {
+						for( size_t i = 0; i < widthchannels; i++ )
+							col[ i ] = 0.0;
+						for( ssize_t k = -b1; k <= b2; k++ ) {
+							const SRCTYPE* src = line( ( ssize_t ) cy + k );
+							if( src ) {
+								for( size_t i = 0; i < widthchannels; i++ )
+									col[ i ] += src[ i ];
+							}
+						}
+					} else {
+						const SRCTYPE* enter = line( cy + b2 );
+						const SRCTYPE* leave = line( ( ssize_t ) cy - b1 - 1 );
+						if( enter && leave ) {
+							for( size_t i = 0; i < widthchannels; i++ )
+								col[ i ] += ( double ) enter[ i ] - ( double ) leave[ i ];
+						} else if( enter ) {
+							for( size_t i = 0; i < widthchannels; i++ )
+								col[ i ] += enter[ i ];
+						} else if( leave ) {
+							for( size_t i = 0; i < widthchannels; i++ )
+								col[ i ] -= leave[ i ];
+						}
+					}
+
+					horizontal( ( DSTTYPE* ) ( _dst + _dstride * cy ), ext, a );
+				}
+			}
+
+		private:
+			/* source line y mapped by the border type, NULL outside for the constant border */
+			const SRCTYPE* line( ssize_t y ) const
+			{
+				if( y < 0 || y >= ( ssize_t ) _h )
+					y = IBorder::value<ssize_t>( y, _h, _btype );
+				return y < 0 ? NULL : ( const SRCTYPE* ) ( _src + _sstride * y );
+			}
+
+			/* running sums of width kw over the column sums, the border columns are filled first */
+			void horizontal( DSTTYPE* dst, double* ext, ssize_t a ) const
+			{
+				ssize_t n = _w + _kw - 1;
+				double* col = ext + a * _channels;
+				for( ssize_t i = 0; i < n; i++ ) {
+					ssize_t x = i - a;
+					if( x >= 0 && x < ( ssize_t ) _w ) {
+						i = _w + a - 1;
+						continue;
+					}
+					x = IBorder::value<ssize_t>( x, _w, _btype );
+					for( size_t c = 0; c < _channels; c++ )
+						ext[ i * _channels + c ] = x < 0 ? 0.0 : col[ x * _channels + c ];
+				}
+
+				size_t kc = _kw * _channels;
+				size_t nc = _w * _channels;
+				double value = _value;
+				for( size_t c = 0; c < _channels; c++ ) {
+					double sum = 0.0;
+					for( size_t i = c; i < kc; i += _channels )
+						sum += ext[ i ];
+					_runningSumStore( dst + c, sum * value );
+					for( size_t i = c + _channels; i < nc; i += _channels ) {
+						sum += ext[ i - _channels + kc ] - ext[ i - _channels ];
+						_runningSumStore( dst + i, sum * value );
+					}
+				}
+			}
+
+			uint8_t*		_dst;
+			size_t			_dstride;
+			const uint8_t*	_src;
+			size_t			_sstride;
+			size_t			_w, _h, _channels;
+			size_t			_kw, _kh;
+			float			_value;
+			IBorderType		_btype;
+	};
+
+	template<typename DSTTYPE, typename SRCTYPE>
+	static void runningSumTemplate( Image& dst, const Image& src, size_t kw, size_t kh, float value, IBorderType btype )
+	{
+		IMapScoped<DSTTYPE> mapdst( dst );
+		IMapScoped<const SRCTYPE> mapsrc( src );
+
+		RunningSumConvolveBody<DSTTYPE, SRCTYPE> body( ( uint8_t* ) mapdst.base(), mapdst.stride(),
+													   ( const uint8_t* ) mapsrc.base(), mapsrc.stride(),
+													   src.width(), src.height(), src.channels(), kw, kh, value, btype );
+		parallelFor( 0, src.height(), body, CVT_ICONVOLVE_CHUNK_ROWS );
+	}
+
+	/* FFT length of the overlap-save tiles for kernel size k, minimizes n log n per valid output */
+	static size_t _fftTileSize( size_t k, size_t extent )
+	{
+		size_t maxn = FFT::fastSize( extent + k - 1 );
+		size_t best = maxn;
+		float bestcost = 0.0f;
+
+		for( size_t n = FFT::fastSize( k ); n <= maxn; n = FFT::fastSize( n + 1 ) ) {
+			float cost = ( float ) n * Math::log2( ( float ) n ) / ( float ) Math::min( n - k + 1, extent );
+			if( n == FFT::fastSize( k ) || cost < bestcost ) {
+				best = n;
+				bestcost = cost;
 			}
-			( simd->*avg )( mapdst.ptr(), ( const BUFTYPE** ) buf, kh, widthchannels );
-			mapdst++;
 		}
+		return best;
+	}
+
+	static inline void _fftStore( float* dst, float value )
+	{
+		*dst = value;
+	}
+
+	static inline void _fftStore( uint8_t* dst, float value )
+	{
+		*dst = ( uint8_t ) Math::clamp( value + 0.5f, 0.0f, 255.0f );
+	}
+
+	/*
+	   Overlap-save correlation: each tile of the output reads a region extended by the kernel size,
+	   the circular correlation then is valid for the first nx - kw + 1 by ny - kh + 1 values.
+	 */
+	template<typename DSTTYPE, typename SRCTYPE>
+	class FFTCorrelateBody
+	{
+		public:
+			FFTCorrelateBody( uint8_t* dst, size_t dstride, size_t dw, size_t dh,
+							  const uint8_t* src, size_t sstride, size_t sw, size_t sh, size_t channels,
+							  const Complex<float>* kspec, size_t kw, size_t kh, ssize_t ax, ssize_t ay,
+							  size_t nx, size_t ny, IBorderType btype ) :
+				_dst( dst ), _dstride( dstride ), _dw( dw ), _dh( dh ),
+				_src( src ), _sstride( sstride ), _sw( sw ), _sh( sh ), _channels( channels ),
+				_kspec( kspec ), _kw( kw ), _kh( kh ), _ax( ax ), _ay( ay ),
+				_nx( nx ), _ny( ny ), _btype( btype )
+			{
+			}
+
+			size_t tileWidth() const { return _nx - _kw + 1; }
+			size_t tileHeight() const { return _ny - _kh + 1; }
+			size_t numTilesX() const { return ( _dw + tileWidth() - 1 ) / tileWidth(); }
+			size_t numTiles() const { return numTilesX() * ( ( _dh + tileHeight() - 1 ) / tileHeight() ); }
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				RealFFT2D fft( _nx, _ny );
+				size_t nspec = fft.spectrumWidth() * _ny;
+				ScopedBuffer<float, true> bufmem( _nx * _ny );
+				ScopedBuffer<Complex<float>, true> specmem( nspec );
+				float* buf = bufmem.ptr();
+				Complex<float>* spec = specmem.ptr();
+
+				for( size_t t = begin; t < end; t++ ) {
+					size_t ox = ( t % numTilesX() ) * tileWidth();
+					size_t oy = ( t / numTilesX() ) * tileHeight();
+					size_t tw = Math::min( tileWidth(), _dw - ox );
+					size_t th = Math::min( tileHeight(), _dh - oy );
+
+					for( size_t c = 0; c < _channels; c++ ) {
+						gather( buf, ox, oy, tw + _kw - 1, th + _kh - 1, c );
+
+						fft.forward( spec, buf, _nx * sizeof( float ) );
+						for( size_t i = 0; i < nspec; i++ )
+							spec[ i ] *= _kspec[ i ];
+						fft.inverse( buf, _nx * sizeof( float ), spec );
+
+						for( size_t y = 0; y < th; y++ ) {
+							DSTTYPE* dst = ( DSTTYPE* ) ( _dst + _dstride * ( oy + y ) ) + ox * _channels + c;
+							const float* val = buf + y * _nx;
+							for( size_t x = 0; x < tw; x++ ) {
+								_fftStore( dst, val[ x ] );
+								dst += _channels;
+							}
+						}
+					}
+				}
+			}
+
+		private:
+			void gather( float* buf, size_t ox, size_t oy, size_t rw, size_t rh, size_t c ) const
+			{
+				for( size_t j = 0; j < _ny; j++ ) {
+					float* row = buf + j * _nx;
+					ssize_t y = j < rh ? IBorder::value<ssize_t>( ( ssize_t ) ( oy + j ) - _ay, _sh, _btype ) : -1;
+					if( y < 0 ) {
+						for( size_t i = 0; i < _nx; i++ )
+							row[ i ] = 0.0f;
+						continue;
+					}
+
+					const SRCTYPE* src = ( const SRCTYPE* ) ( _src + _sstride * y );
+					for( size_t i = 0; i < rw; i++ ) {
+						ssize_t x = ( ssize_t ) ( ox + i ) - _ax;
+						if( x < 0 || x >= ( ssize_t ) _sw )
+							x = IBorder::value<ssize_t>( x, _sw, _btype );
+						row[ i ] = x < 0 ? 0.0f : ( float ) src[ x * _channels + c ];
+					}
+					for( size_t i = rw; i < _nx; i++ )
+						row[ i ] = 0.0f;
+				}
+			}
+
+			uint8_t*				_dst;
+			size_t					_dstride;
+			size_t					_dw, _dh;
+			const uint8_t*			_src;
+			size_t					_sstride;
+			size_t					_sw, _sh;
+			size_t					_channels;
+			const Complex<float>*	_kspec;
+			size_t					_kw, _kh;
+			ssize_t					_ax, _ay;
+			size_t					_nx, _ny;
+			IBorderType				_btype;
+	};
+
+	template<typename DSTTYPE, typename SRCTYPE>
+	static void fftCorrelateTemplate( Image& dst, const Image& src, const float* kern, size_t kw, size_t kh, ssize_t ax, ssize_t ay, IBorderType btype )
+	{
+		size_t nx = _fftTileSize( kw, dst.width() );
+		size_t ny = _fftTileSize( kh, dst.height() );
+
+		/* conjugated spectrum of the zero padded kernel */
+		RealFFT2D fft( nx, ny );
+		std::vector<float> kbuf( nx * ny, 0.0f );
+		std::vector<Complex<float> > kspec( fft.spectrumWidth() * ny );
+		for( size_t y = 0; y < kh; y++ )
+			for( size_t x = 0; x < kw; x++ )
+				kbuf[ y * nx + x ] = kern[ y * kw + x ];
+		fft.forward( &kspec[ 0 ], &kbuf[ 0 ], nx * sizeof( float ) );
+		for( size_t i = 0; i < kspec.size(); i++ )
+			kspec[ i ] = kspec[ i ].conj();
+
+		IMapScoped<DSTTYPE> mapdst( dst );
+		IMapScoped<const SRCTYPE> mapsrc( src );
 
+		FFTCorrelateBody<DSTTYPE, SRCTYPE> body( ( uint8_t* ) mapdst.base(), mapdst.stride(), dst.width(), dst.height(),
+												 ( const uint8_t* ) mapsrc.base(), mapsrc.stride(), src.width(), src.height(), src.channels(),
+												 &kspec[ 0 ], kw, kh, ax, ay, nx, ny, btype );
+		parallelFor( 0, body.numTiles(), body );
 	}
 
-	void IConvolve::convolve( Image& dst, const Image& src, const IKernel& kernel, IBorderType btype, const Color& )
+	void IConvolve::convolveFFT( Image& dst, const Image& src, const IKernel& kernel, IBorderType btype )
+	{
+		if( dst.width() != src.width() || dst.height() != src.height() || dst.format() != src.format() )
+			dst.reallocate( src );
+
+		ssize_t ax = kernel.width() >> 1;
+		ssize_t ay = kernel.height() >> 1;
+
+		if( src.format().type == IFORMAT_TYPE_FLOAT )
+			fftCorrelateTemplate<float, float>( dst, src, kernel.ptr(), kernel.width(), kernel.height(), ax, ay, btype );
+		else if( src.format().type == IFORMAT_TYPE_UINT8 )
+			fftCorrelateTemplate<uint8_t, uint8_t>( dst, src, kernel.ptr(), kernel.width(), kernel.height(), ax, ay, btype );
+		else
+			throw CVTException( "Unsupported image format for FFT convolution" );
+	}
+
+	void IConvolve::correlate( Image& dst, const Image& src, const Image& templ )
+	{
+		if( src.channels() != 1 || templ.channels() != 1 )
+			throw CVTException( "Correlation only implemented for single channel images" );
+		if( templ.width() > src.width() || templ.height() > src.height() )
+			throw CVTException( "Template larger than image" );
+
+		size_t kw = templ.width();
+		size_t kh = templ.height();
+		std::vector<float> kern( kw * kh );
+		if( templ.format().type == IFORMAT_TYPE_FLOAT ) {
+			IMapScoped<const float> map( templ );
+			for( size_t y = 0; y < kh; y++, map++ )
+				for( size_t x = 0; x < kw; x++ )
+					kern[ y * kw + x ] = map.ptr()[ x ];
+		} else if( templ.format().type == IFORMAT_TYPE_UINT8 ) {
+			IMapScoped<const uint8_t> map( templ );
+			for( size_t y = 0; y < kh; y++, map++ )
+				for( size_t x = 0; x < kw; x++ )
+					kern[ y * kw + x ] = map.ptr()[ x ];
+		} else
+			throw CVTException( "Unsupported template format" );
+
+		dst.reallocate( src.width() - kw + 1, src.height() - kh + 1, IFormat::GRAY_FLOAT );
+
+		if( src.format().type == IFORMAT_TYPE_FLOAT )
+			fftCorrelateTemplate<float, float>( dst, src, &kern[ 0 ], kw, kh, 0, 0, IBORDER_CLAMP );
+		else if( src.format().type == IFORMAT_TYPE_UINT8 )
+			fftCorrelateTemplate<float, uint8_t>( dst, src, &kern[ 0 ], kw, kh, 0, 0, IBORDER_CLAMP );
+		else
+			throw CVTException( "Unsupported image format for correlation" );
+	}
+
+	static void _convolveDirect( Image& dst, const Image& src, const IKernel& kernel, IBorderType btype )
 	{
 		if( src.format().type == IFORMAT_TYPE_FLOAT && dst.format().type == IFORMAT_TYPE_FLOAT ) {
+			if( src.channels() == 1 && kernel.width() == kernel.height() ) {
+				switch( kernel.width() ) {
+					case 3: return convolveFixedTemplate<3>( dst, src, kernel.ptr(), btype );
+					case 5: return convolveFixedTemplate<5>( dst, src, kernel.ptr(), btype );
+					default: break;
+				}
+			}
+
 			if( src.channels() == 1 )
 				return convolveTemplate<float,float,float,float>( dst, src, kernel.ptr(), kernel.width(), kernel.height(),
 																		  &SIMD::ConvolveHorizontal1f, &SIMD::AddVert_f, btype );
@@ -206,8 +757,215 @@ namespace cvt {
 
 	}
 
-	void IConvolve::convolve( Image& dst, const Image& src, const IKernel& hkernel, const IKernel& vkernel, IBorderType btype, const Color& )
+	static void _convolveLowRank( Image& dst, const Image& src, const std::vector<IKernel>& hkernels, const std::vector<IKernel>& vkernels, IBorderType btype )
+	{
+		LowRankConvolveBody::HConvFunc hconv;
+		if( src.channels() == 1 )
+			hconv = &SIMD::ConvolveHorizontal1f;
+		else if( src.channels() == 2 )
+			hconv = &SIMD::ConvolveHorizontal2f;
+		else if( src.channels() == 4 )
+			hconv = &SIMD::ConvolveHorizontal4f;
+		else
+			throw CVTException( "Unsupported image format for low rank convolution" );
+
+		IMapScoped<float> mapdst( dst );
+		IMapScoped<const float> mapsrc( src );
+
+		LowRankConvolveBody body( ( uint8_t* ) mapdst.base(), mapdst.stride(), ( const uint8_t* ) mapsrc.base(), mapsrc.stride(),
+								  src.width(), src.height(), src.channels(), hkernels, vkernels, hconv, btype );
+		parallelFor( 0, src.height(), body, Math::max<size_t>( CVT_ICONVOLVE_CHUNK_ROWS, vkernels[ 0 ].height() ) );
+	}
+
+	/* kernels with more taps are not decomposed, the singular value decomposition would dominate */
+	static const size_t _svdKernelArea = 32 * 32;
+
+	/*
+	   Cost model: time in ns per output value and tap of the spatial paths, per output value for the
+	   running sums and per n log2 n of the tile transforms for the FFT, measured for a 1920x1080
+	   GRAY_FLOAT image on a single thread.
+	 */
+	static const float _costDirect		= 0.20f;
+	static const float _costDirectFixed = 0.12f;
+	static const float _costSeparable	= 0.15f;
+	static const float _costRunningSum	= 2.0f;
+	static const float _costFFT			= 3.5f;
+
+	static bool _fixedKernel( const IKernel& kernel, const Image& dst, const Image& src )
+	{
+		return src.format().type == IFORMAT_TYPE_FLOAT && dst.format().type == IFORMAT_TYPE_FLOAT && src.channels() == 1 &&
+			   kernel.width() == kernel.height() && ( kernel.width() == 3 || kernel.width() == 5 );
+	}
+
+	static bool _sameType( const Image& dst, const Image& src )
+	{
+		return src.format().type == dst.format().type &&
+			   ( src.format().type == IFORMAT_TYPE_FLOAT || src.format().type == IFORMAT_TYPE_UINT8 );
+	}
+
+	/* formats of the separable dispatch, sums of several separable terms are only accumulated in float */
+	static bool _separableType( const Image& dst, const Image& src, size_t rank )
+	{
+		if( src.format().type == IFORMAT_TYPE_FLOAT && dst.format().type == IFORMAT_TYPE_FLOAT )
+			return src.channels() != 3;
+		return rank == 1 && src.format().type == IFORMAT_TYPE_UINT8 &&
+			   ( dst.format().type == IFORMAT_TYPE_UINT8 || dst.format().type == IFORMAT_TYPE_INT16 );
+	}
+
+	/* FFT cost per output value with the overlap-save tiles chosen by fftCorrelateTemplate */
+	static float _fftCost( const IKernel& kernel, const Image& src )
+	{
+		size_t nx = _fftTileSize( kernel.width(), src.width() );
+		size_t ny = _fftTileSize( kernel.height(), src.height() );
+		float n = ( float ) ( nx * ny );
+		float valid = ( float ) ( Math::min( nx - kernel.width() + 1, src.width() ) * Math::min( ny - kernel.height() + 1, src.height() ) );
+		return _costFFT * n * Math::log2( n ) / valid;
+	}
+
+	/* number of kernels whose separation is kept */
+	#define CVT_ICONVOLVE_SEPARATIONS 16
+
+	struct IConvolveSeparation {
+		size_t					width, height;
+		std::vector<float>		values;
+		size_t					rank;
+		std::vector<IKernel>	hkernels, vkernels;
+	};
+
+	/*
+	   IKernel::separate with the results of the last kernels cached by value,
+	   the SVD of a kernel that is convolved repeatedly is only computed once
+	 */
+	static size_t _separate( const IKernel& kernel, std::vector<IKernel>& hkernels, std::vector<IKernel>& vkernels )
+	{
+		static Mutex _lock;
+		static std::list<IConvolveSeparation> _cache;
+
+		size_t n = kernel.width() * kernel.height();
+		{
+			ScopeLock lock( &_lock );
+			for( std::list<IConvolveSeparation>::iterator it = _cache.begin(); it != _cache.end(); ++it ) {
+				if( it->width != kernel.width() || it->height != kernel.height() ||
+					!std::equal( it->values.begin(), it->values.end(), kernel.ptr() ) )
+					continue;
+				/* most recently used first */
+				_cache.splice( _cache.begin(), _cache, it );
+				hkernels = it->hkernels;
+				vkernels = it->vkernels;
+				return it->rank;
+			}
+		}
+
+		IConvolveSeparation sep;
+		sep.width = kernel.width();
+		sep.height = kernel.height();
+		sep.values.assign( kernel.ptr(), kernel.ptr() + n );
+		sep.rank = kernel.separate( sep.hkernels, sep.vkernels );
+		hkernels = sep.hkernels;
+		vkernels = sep.vkernels;
+
+		ScopeLock lock( &_lock );
+		_cache.push_front( sep );
+		if( _cache.size() > CVT_ICONVOLVE_SEPARATIONS )
+			_cache.pop_back();
+		return sep.rank;
+	}
+
+	static IConvolvePath _plan( const IKernel& kernel, const Image& dst, const Image& src, std::vector<IKernel>* hkernels, std::vector<IKernel>* vkernels )
+	{
+		size_t kw = kernel.width();
+		size_t kh = kernel.height();
+
+		IConvolvePath best = ICONVOLVE_PATH_DIRECT;
+		float bestcost = ( _fixedKernel( kernel, dst, src ) ? _costDirectFixed : _costDirect ) * ( float ) ( kw * kh );
+
+		if( _sameType( dst, src ) && kernel.isConstant() && _costRunningSum < bestcost ) {
+			best = ICONVOLVE_PATH_RUNNINGSUM;
+			bestcost = _costRunningSum;
+		}
+
+		/* the decomposition is skipped if it can not beat the running sums */
+		if( best != ICONVOLVE_PATH_RUNNINGSUM && kw > 1 && kh > 1 && kw * kh <= _svdKernelArea ) {
+			std::vector<IKernel> h, v;
+			size_t rank = _separate( kernel, h, v );
+			float cost = _costSeparable * ( float ) ( rank * ( kw + kh ) );
+			if( rank && _separableType( dst, src, rank ) && cost < bestcost ) {
+				best = ICONVOLVE_PATH_SEPARABLE;
+				bestcost = cost;
+				if( hkernels )
+					hkernels->swap( h );
+				if( vkernels )
+					vkernels->swap( v );
+			}
+		}
+
+		if( _sameType( dst, src ) && _fftCost( kernel, src ) < bestcost )
+			best = ICONVOLVE_PATH_FFT;
+		return best;
+	}
+
+	IConvolvePath IConvolve::plan( const IKernel& kernel, const Image& dst, const Image& src )
+	{
+		return _plan( kernel, dst, src, NULL, NULL );
+	}
+
+	/* the constant border is padded with zero, convolveFFT has no border color */
+	static void _checkBorderColor( IBorderType btype, const Color& color )
+	{
+		if( btype == IBORDER_CONSTANT && ( color.red() != 0.0f || color.green() != 0.0f || color.blue() != 0.0f ) )
+			throw CVTException( "Convolution with a constant border only supports black" );
+	}
+
+	void IConvolve::convolve( Image& dst, const Image& src, const IKernel& kernel, IBorderType btype, const Color& color )
+	{
+		_checkBorderColor( btype, color );
+
+		std::vector<IKernel> hkernels, vkernels;
+		IConvolvePath path = _plan( kernel, dst, src, &hkernels, &vkernels );
+
+		if( path == ICONVOLVE_PATH_SEPARABLE ) {
+			if( hkernels.size() == 1 )
+				return convolve( dst, src, hkernels[ 0 ], vkernels[ 0 ], btype );
+			return _convolveLowRank( dst, src, hkernels, vkernels, btype );
+		}
+		convolve( dst, src, kernel, path, btype );
+	}
+
+	void IConvolve::convolve( Image& dst, const Image& src, const IKernel& kernel, IConvolvePath path, IBorderType btype )
+	{
+		switch( path ) {
+			case ICONVOLVE_PATH_DIRECT:
+				return _convolveDirect( dst, src, kernel, btype );
+			case ICONVOLVE_PATH_SEPARABLE:
+				{
+					std::vector<IKernel> hkernels, vkernels;
+					_separate( kernel, hkernels, vkernels );
+					if( hkernels.empty() )
+						return _convolveDirect( dst, src, kernel, btype );
+					if( hkernels.size() == 1 )
+						return convolve( dst, src, hkernels[ 0 ], vkernels[ 0 ], btype );
+					if( src.format().type != IFORMAT_TYPE_FLOAT || dst.format().type != IFORMAT_TYPE_FLOAT )
+						throw CVTException( "Kernels of rank larger than one are only separated for float images" );
+					return _convolveLowRank( dst, src, hkernels, vkernels, btype );
+				}
+			case ICONVOLVE_PATH_RUNNINGSUM:
+				if( !kernel.isConstant() )
+					throw CVTException( "Running sum convolution needs a constant kernel" );
+				if( src.format().type == IFORMAT_TYPE_FLOAT && dst.format().type == IFORMAT_TYPE_FLOAT )
+					return runningSumTemplate<float, float>( dst, src, kernel.width(), kernel.height(), kernel( 0, 0 ), btype );
+				if( src.format().type == IFORMAT_TYPE_UINT8 && dst.format().type == IFORMAT_TYPE_UINT8 )
+					return runningSumTemplate<uint8_t, uint8_t>( dst, src, kernel.width(), kernel.height(), kernel( 0, 0 ), btype );
+				throw CVTException( "Unsupported image format for running sum convolution" );
+			case ICONVOLVE_PATH_FFT:
+				if( src.format().type != dst.format().type )
+					throw CVTException( "FFT convolution needs equal source and destination formats" );
+				return convolveFFT( dst, src, kernel, btype );
+		}
+	}
+
+	void IConvolve::convolve( Image& dst, const Image& src, const IKernel& hkernel, const IKernel& vkernel, IBorderType btype, const Color& color )
 	{
+		_checkBorderColor( btype, color );
 		// TODO: check for compatible formats or reallocate
 		bool symh = hkernel.isSymmetrical();
 		bool symv = vkernel.isSymmetrical();
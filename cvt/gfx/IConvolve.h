@@ -33,11 +33,60 @@ namespace cvt
 	class Image;
 	class IKernel;
 
+	/**
+	  \brief Implementations of the convolution with a 2D kernel
+	 */
+	enum IConvolvePath {
+		ICONVOLVE_PATH_DIRECT,		/**< every kernel row is applied horizontally, K x K float kernels for K = 3 and 5 are unrolled */
+		ICONVOLVE_PATH_SEPARABLE,	/**< sum of separable convolutions, the number of terms is the numerical rank of the kernel */
+		ICONVOLVE_PATH_RUNNINGSUM,	/**< constant kernels, running sums independent of the kernel size */
+		ICONVOLVE_PATH_FFT			/**< overlap-save tiles in the frequency domain */
+	};
+
 	class IConvolve {
 		public:
+			/**
+			  \brief Convolution with the path chosen by plan
+			  IBORDER_CONSTANT pads with zero, colors other than black are rejected.
+			 */
 			static void convolve( Image& dst, const Image& src, const IKernel& kernel, IBorderType btype = IBORDER_CLAMP, const Color& = Color::BLACK );
+
+			/**
+			  \brief Convolution with an explicitly chosen path
+			  Throws if the path is not applicable to the kernel or the image formats.
+			 */
+			static void convolve( Image& dst, const Image& src, const IKernel& kernel, IConvolvePath path, IBorderType btype = IBORDER_CLAMP );
 			static void convolve( Image& dst, const Image& src, const IKernel& hkernel, const IKernel& vkernel, IBorderType btype = IBORDER_CLAMP, const Color& = Color::BLACK );
 
+			/**
+			  \brief Frequency domain version of convolve with identical results
+
+			  The image is processed in overlapping tiles, the tile size is chosen
+			  for the kernel size. Large non-separable kernels are passed to this
+			  function by convolve automatically.
+			 */
+			static void convolveFFT( Image& dst, const Image& src, const IKernel& kernel, IBorderType btype = IBORDER_CLAMP );
+
+			/**
+			  \brief Cross correlation of a gray image with a template
+
+			  dst( x, y ) = sum_ij templ( i, j ) * src( x + i, y + j ) for all positions
+			  where the template is inside the image, dst is GRAY_FLOAT of size
+			  ( src.width() - templ.width() + 1 ) x ( src.height() - templ.height() + 1 ).
+			 */
+			static void correlate( Image& dst, const Image& src, const Image& templ );
+
+			/**
+			  \brief Cheapest path for the kernel and the image formats
+
+			  The numerical rank of kernels up to 32x32 taps is computed, the separations
+			  of the most recently planned kernels are cached by value. Constant kernels
+			  use running sums and large kernels are compared to the FFT cost of the
+			  overlap-save tiles. The cost model is calibrated for a single thread, the
+			  rows of all spatial paths are processed in parallel.
+			 */
+			static IConvolvePath plan( const IKernel& kernel, const Image& dst, const Image& src );
+
 		private:
 			IConvolve() {}
 			IConvolve( const IConvolve& ) {}
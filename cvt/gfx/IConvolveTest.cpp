@@ -0,0 +1,278 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/gfx/IConvolve.h>
+#include <cvt/gfx/IKernel.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/CVTTest.h>
+
+#include <vector>
+
+namespace cvt {
+
+	static void _randomImage( Image& img, size_t w, size_t h, const IFormat& format )
+	{
+		img.reallocate( w, h, format );
+		size_t n = w * img.channels();
+		if( format.type == IFORMAT_TYPE_FLOAT ) {
+			IMapScoped<float> map( img );
+			for( size_t y = 0; y < h; y++, map++ )
+				for( size_t i = 0; i < n; i++ )
+					map.ptr()[ i ] = Math::rand( 0.0f, 1.0f );
+		} else {
+			IMapScoped<uint8_t> map( img );
+			for( size_t y = 0; y < h; y++, map++ )
+				for( size_t i = 0; i < n; i++ )
+					map.ptr()[ i ] = ( uint8_t ) Math::rand( 0, 255 );
+		}
+	}
+
+	static IKernel _randomKernel( size_t w, size_t h )
+	{
+		IKernel k( w, h );
+		for( size_t y = 0; y < h; y++ )
+			for( size_t x = 0; x < w; x++ )
+				k( x, y ) = Math::rand( -1.0f, 1.0f );
+		k.scale( 1.0f / ( float ) ( w * h ) );
+		return k;
+	}
+
+	/* sum of two separable kernels */
+	static IKernel _rankTwoKernel( size_t w, size_t h )
+	{
+		IKernel k( w, h );
+		for( size_t y = 0; y < h; y++ )
+			for( size_t x = 0; x < w; x++ )
+				k( x, y ) = 0.02f * ( Math::sin( 0.7f * x ) * Math::cos( 0.3f * y ) + ( float ) x * ( float ) y / ( float ) ( w * h ) );
+		return k;
+	}
+
+	static IKernel _boxKernel( size_t w, size_t h )
+	{
+		IKernel k( w, h );
+		for( size_t y = 0; y < h; y++ )
+			for( size_t x = 0; x < w; x++ )
+				k( x, y ) = 1.0f / ( float ) ( w * h );
+		return k;
+	}
+
+	/* largest difference to the direct sum */
+	template<typename T>
+	static float _convolveError( const Image& dst, const Image& src, const IKernel& kernel, IBorderType btype )
+	{
+		ssize_t kw = kernel.width();
+		ssize_t kh = kernel.height();
+		ssize_t w = src.width();
+		ssize_t h = src.height();
+		ssize_t c = src.channels();
+
+		float maxerr = 0;
+		IMapScoped<const T> msrc( src );
+		IMapScoped<const T> mdst( dst );
+		for( ssize_t y = 0; y < h; y++ ) {
+			const T* drow = ( const T* ) ( ( const uint8_t* ) mdst.base() + mdst.stride() * y );
+			for( ssize_t x = 0; x < w; x++ ) {
+				for( ssize_t ch = 0; ch < c; ch++ ) {
+					float sum = 0;
+					for( ssize_t j = 0; j < kh; j++ ) {
+						ssize_t sy = IBorder::value<ssize_t>( y - kh / 2 + j, h, btype );
+						const T* row = ( const T* ) ( ( const uint8_t* ) msrc.base() + msrc.stride() * sy );
+						for( ssize_t i = 0; i < kw; i++ ) {
+							ssize_t sx = IBorder::value<ssize_t>( x - kw / 2 + i, w, btype );
+							sum += kernel( i, j ) * ( float ) row[ sx * c + ch ];
+						}
+					}
+					if( sizeof( T ) == 1 )
+						sum = Math::clamp( sum, 0.0f, 255.0f );
+					maxerr = Math::max( maxerr, Math::abs( sum - ( float ) drow[ x * c + ch ] ) );
+				}
+			}
+		}
+		return maxerr;
+	}
+
+	static float _convolveError( const Image& dst, const Image& src, const IKernel& kernel, IBorderType btype )
+	{
+		if( src.format().type == IFORMAT_TYPE_FLOAT )
+			return _convolveError<float>( dst, src, kernel, btype );
+		return _convolveError<uint8_t>( dst, src, kernel, btype );
+	}
+
+	static bool _separateTest()
+	{
+		bool ret = true;
+		std::vector<IKernel> h, v;
+
+		ret &= IKernel::createGaussian2D( 1.5f ).separate( h, v ) == 1;
+		/* the exact factorization keeps the symmetry of the gaussian */
+		ret &= h[ 0 ].isSymmetrical() && v[ 0 ].isSymmetrical();
+		ret &= _rankTwoKernel( 9, 7 ).separate( h, v ) == 2;
+		ret &= _randomKernel( 5, 5 ).separate( h, v ) == 5;
+
+		IKernel k = _rankTwoKernel( 9, 7 );
+		k.separate( h, v );
+		float maxerr = 0;
+		for( size_t y = 0; y < k.height(); y++ ) {
+			for( size_t x = 0; x < k.width(); x++ ) {
+				float sum = 0;
+				for( size_t r = 0; r < h.size(); r++ )
+					sum += h[ r ]( x, 0 ) * v[ r ]( 0, y );
+				maxerr = Math::max( maxerr, Math::abs( sum - k( x, y ) ) );
+			}
+		}
+		return ret && maxerr < 1e-6f;
+	}
+
+	static bool _planTest()
+	{
+		Image src( 640, 480, IFormat::GRAY_FLOAT );
+		Image dst( 640, 480, IFormat::GRAY_FLOAT );
+		Image src8( 640, 480, IFormat::GRAY_UINT8 );
+		Image dst8( 640, 480, IFormat::GRAY_UINT8 );
+		bool ret = true;
+
+		ret &= IConvolve::plan( IKernel::createGaussian2D( 2.0f ), dst, src ) == ICONVOLVE_PATH_SEPARABLE;
+		ret &= IConvolve::plan( IKernel::createGaussian2D( 2.0f ), dst8, src8 ) == ICONVOLVE_PATH_SEPARABLE;
+		ret &= IConvolve::plan( _rankTwoKernel( 15, 15 ), dst, src ) == ICONVOLVE_PATH_SEPARABLE;
+		ret &= IConvolve::plan( _boxKernel( 31, 31 ), dst, src ) == ICONVOLVE_PATH_RUNNINGSUM;
+		ret &= IConvolve::plan( _boxKernel( 31, 31 ), dst8, src8 ) == ICONVOLVE_PATH_RUNNINGSUM;
+		ret &= IConvolve::plan( _randomKernel( 41, 41 ), dst, src ) == ICONVOLVE_PATH_FFT;
+		ret &= IConvolve::plan( _randomKernel( 3, 3 ), dst, src ) == ICONVOLVE_PATH_DIRECT;
+		ret &= IConvolve::plan( IKernel::HAAR_HORIZONTAL_3, dst, src ) == ICONVOLVE_PATH_DIRECT;
+
+		/* the cached separation follows a kernel changed in place */
+		IKernel k = IKernel::createGaussian2D( 2.0f );
+		ret &= IConvolve::plan( k, dst, src ) == ICONVOLVE_PATH_SEPARABLE;
+		for( size_t y = 0; y < k.height(); y++ )
+			for( size_t x = 0; x < k.width(); x++ )
+				k( x, y ) = Math::rand( -1.0f, 1.0f );
+		ret &= IConvolve::plan( k, dst, src ) == ICONVOLVE_PATH_DIRECT;
+		return ret;
+	}
+
+	static bool _pathTest( const IFormat& format, IBorderType btype )
+	{
+		const IConvolvePath paths[] = { ICONVOLVE_PATH_DIRECT, ICONVOLVE_PATH_SEPARABLE, ICONVOLVE_PATH_RUNNINGSUM, ICONVOLVE_PATH_FFT };
+		bool isfloat = format.type == IFORMAT_TYPE_FLOAT;
+		float tolerance = isfloat ? 1e-4f : 1.01f;
+		Image src, dst;
+		bool ret = true;
+
+		/* more rows than one chunk to cover the partitioning */
+		_randomImage( src, 97, 141, format );
+
+		std::vector<IKernel> kernels;
+		kernels.push_back( IKernel::createGaussian2D( 1.5f ) );
+		kernels.push_back( _rankTwoKernel( 9, 7 ) );
+		kernels.push_back( _boxKernel( 9, 5 ) );
+		kernels.push_back( _randomKernel( 3, 3 ) );
+		kernels.push_back( _randomKernel( 5, 5 ) );
+		kernels.push_back( _randomKernel( 7, 7 ) );
+
+		for( size_t k = 0; k < kernels.size(); k++ ) {
+			std::vector<IKernel> h, v;
+			size_t rank = kernels[ k ].separate( h, v );
+
+			for( size_t p = 0; p < sizeof( paths ) / sizeof( paths[ 0 ] ); p++ ) {
+				if( paths[ p ] == ICONVOLVE_PATH_SEPARABLE && rank > 1 && !isfloat )
+					continue;
+				if( paths[ p ] == ICONVOLVE_PATH_RUNNINGSUM && !kernels[ k ].isConstant() )
+					continue;
+
+				dst.reallocate( src );
+				IConvolve::convolve( dst, src, kernels[ k ], paths[ p ], btype );
+				ret &= _convolveError( dst, src, kernels[ k ], btype ) < tolerance;
+			}
+			dst.reallocate( src );
+			IConvolve::convolve( dst, src, kernels[ k ], btype );
+			ret &= _convolveError( dst, src, kernels[ k ], btype ) < tolerance;
+		}
+		return ret;
+	}
+
+	/* the constant border is zero, other colors are rejected */
+	static bool _borderColorTest()
+	{
+		Image src, dst;
+		_randomImage( src, 64, 48, IFormat::GRAY_FLOAT );
+		IKernel kernel = _randomKernel( 21, 21 );
+		bool ret = true;
+
+		dst.reallocate( src );
+		IConvolve::convolve( dst, src, kernel, ICONVOLVE_PATH_FFT, IBORDER_CONSTANT );
+		ret &= _convolveError( dst, src, kernel, IBORDER_CONSTANT ) < 1e-4f;
+		try {
+			IConvolve::convolve( dst, src, kernel, IBORDER_CONSTANT, Color::WHITE );
+			ret = false;
+		} catch( const Exception& ) {
+		}
+		try {
+			IConvolve::convolve( dst, src, IKernel::GAUSS_HORIZONTAL_3, IKernel::GAUSS_VERTICAL_3, IBORDER_CONSTANT, Color::RED );
+			ret = false;
+		} catch( const Exception& ) {
+		}
+		return ret;
+	}
+
+}
+
+using namespace cvt;
+
+BEGIN_CVTTEST( IConvolve )
+	bool ret = true;
+	bool b;
+
+	b = _separateTest();
+	CVTTEST_PRINT( "Kernel separation", b );
+	ret &= b;
+
+	b = _planTest();
+	CVTTEST_PRINT( "Convolution path planning", b );
+	ret &= b;
+
+	b = _pathTest( IFormat::GRAY_FLOAT, IBORDER_CLAMP );
+	CVTTEST_PRINT( "GRAY_FLOAT convolution paths", b );
+	ret &= b;
+
+	b = _pathTest( IFormat::RGBA_FLOAT, IBORDER_MIRROR );
+	CVTTEST_PRINT( "RGBA_FLOAT convolution paths", b );
+	ret &= b;
+
+	b = _pathTest( IFormat::GRAY_UINT8, IBORDER_CLAMP );
+	CVTTEST_PRINT( "GRAY_UINT8 convolution paths", b );
+	ret &= b;
+
+	b = _pathTest( IFormat::RGBA_UINT8, IBORDER_REPEAT );
+	CVTTEST_PRINT( "RGBA_UINT8 convolution paths", b );
+	ret &= b;
+
+	b = _borderColorTest();
+	CVTTEST_PRINT( "Constant border color", b );
+	ret &= b;
+
+	return ret;
+END_CVTTEST
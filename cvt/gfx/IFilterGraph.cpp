@@ -0,0 +1,472 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/IFilterGraph.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/Exception.h>
+
+namespace cvt {
+
+	/* runs the CPU nodes of one level concurrently */
+	class IFilterGraphLevel {
+		public:
+			IFilterGraphLevel( const IFilterGraph& graph, const std::vector<size_t>& nodes, std::vector<std::string>& errors ) :
+				_graph( graph ), _nodes( nodes ), _errors( errors )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				for( size_t i = begin; i < end; i++ ) {
+					const IFilterGraph::Node& node = _graph._nodes[ _nodes[ i ] ];
+					// exceptions must not escape into the pool workers
+					try {
+						node.filter->apply( node.params, node.placement );
+					} catch( Exception& e ) {
+						_errors[ i ] = e.what();
+					} catch( ... ) {
+						_errors[ i ] = "Unknown exception in filter " + std::string( node.filter->name().c_str() );
+					}
+				}
+			}
+
+		private:
+			const IFilterGraph&			_graph;
+			const std::vector<size_t>&	_nodes;
+			std::vector<std::string>&	_errors;
+	};
+
+	IFilterGraph::IFilterGraph( size_t numInputs ) :
+		_numInputs( numInputs ),
+		_scheduled( false ),
+		_queueSize( 2 ),
+		_streamRunning( false ),
+		_streamEnd( false )
+	{
+	}
+
+	IFilterGraph::~IFilterGraph()
+	{
+		stopStream();
+
+		for( size_t i = 0; i < _outQueue.size(); i++ ) {
+			for( size_t k = 0; k < _outQueue[ i ].size(); k++ )
+				delete _outQueue[ i ][ k ];
+		}
+		for( size_t i = 0; i < _slots.size(); i++ )
+			delete _slots[ i ];
+		for( size_t i = 0; i < _nodes.size(); i++ )
+			delete _nodes[ i ].params;
+	}
+
+	size_t IFilterGraph::addNode( const IFilter* filter, IFilterType placement )
+	{
+		if( !filter )
+			throw CVTException( "Invalid filter" );
+		if( !( filter->getIFilterType() & placement ) )
+			throw CVTException( "Filter does not support the requested placement" );
+
+		Node node;
+		node.filter = filter;
+		node.placement = placement;
+		node.params = filter->parameterSet();
+		node.level = 0;
+
+		size_t id = _nodes.size();
+		for( size_t i = 0; i < node.params->size(); i++ ) {
+			const ParamInfo* pinfo = node.params->paramInfo( i );
+			if( pinfo->type != PTYPE_IMAGEPTR )
+				continue;
+			// unconnected ports stay NULL
+			node.params->setArg<Image*>( i, NULL );
+			if( !pinfo->isInput ) {
+				Buffer buf;
+				buf.node = id;
+				buf.param = i;
+				buf.format = NULL;
+				buf.isOutput = false;
+				buf.lastUse = 0;
+				buf.slot = 0;
+				node.buffers.push_back( _buffers.size() );
+				_buffers.push_back( buf );
+			}
+		}
+		_nodes.push_back( node );
+		_scheduled = false;
+		return id;
+	}
+
+	ParamSet& IFilterGraph::parameters( size_t node )
+	{
+		if( node >= _nodes.size() )
+			throw CVTException( "Invalid node" );
+		return *_nodes[ node ].params;
+	}
+
+	size_t IFilterGraph::imagePort( size_t node, const String& port, bool input ) const
+	{
+		if( node >= _nodes.size() )
+			throw CVTException( "Invalid node" );
+		size_t param = _nodes[ node ].params->paramHandle( port.c_str() );
+		const ParamInfo* pinfo = _nodes[ node ].params->paramInfo( param );
+		if( pinfo->type != PTYPE_IMAGEPTR || pinfo->isInput != input )
+			throw CVTException( "Parameter \"" + pinfo->name + "\" is not an image port of the requested direction" );
+		return param;
+	}
+
+	size_t IFilterGraph::bufferForPort( size_t node, size_t param ) const
+	{
+		const Node& n = _nodes[ node ];
+		for( size_t i = 0; i < n.buffers.size(); i++ ) {
+			if( _buffers[ n.buffers[ i ] ].param == param )
+				return n.buffers[ i ];
+		}
+		throw CVTException( "Invalid output port" );
+	}
+
+	void IFilterGraph::connect( size_t src, const String& srcPort, size_t dst, const String& dstPort )
+	{
+		size_t srcParam = imagePort( src, srcPort, false );
+		size_t dstParam = imagePort( dst, dstPort, true );
+
+		Connection c;
+		c.source = bufferForPort( src, srcParam );
+		c.param = dstParam;
+		_nodes[ dst ].inputs.push_back( c );
+		_scheduled = false;
+	}
+
+	void IFilterGraph::connectInput( size_t input, size_t dst, const String& dstPort )
+	{
+		if( input >= _numInputs )
+			throw CVTException( "Invalid graph input" );
+
+		Connection c;
+		c.source = -( long ) input - 1;
+		c.param = imagePort( dst, dstPort, true );
+		_nodes[ dst ].inputs.push_back( c );
+		_scheduled = false;
+	}
+
+	size_t IFilterGraph::addOutput( size_t node, const String& port )
+	{
+		size_t buf = bufferForPort( node, imagePort( node, port, false ) );
+		_buffers[ buf ].isOutput = true;
+		_outputs.push_back( buf );
+		_scheduled = false;
+		return _outputs.size() - 1;
+	}
+
+	void IFilterGraph::setOutputFormat( size_t node, const String& port, const IFormat& format )
+	{
+		size_t buf = bufferForPort( node, imagePort( node, port, false ) );
+		_buffers[ buf ].format = &IFormat::formatForId( format.formatID );
+	}
+
+	void IFilterGraph::schedule()
+	{
+		// level of a node: longest path from the graph inputs
+		for( size_t i = 0; i < _nodes.size(); i++ )
+			_nodes[ i ].level = 0;
+
+		bool changed = true;
+		for( size_t iter = 0; changed; iter++ ) {
+			if( iter > _nodes.size() )
+				throw CVTException( "IFilterGraph contains a cycle" );
+			changed = false;
+			for( size_t i = 0; i < _nodes.size(); i++ ) {
+				Node& node = _nodes[ i ];
+				for( size_t k = 0; k < node.inputs.size(); k++ ) {
+					if( node.inputs[ k ].source < 0 )
+						continue;
+					size_t srcLevel = _nodes[ _buffers[ node.inputs[ k ].source ].node ].level;
+					if( srcLevel + 1 > node.level ) {
+						node.level = srcLevel + 1;
+						changed = true;
+					}
+				}
+			}
+		}
+
+		_levels.clear();
+		for( size_t i = 0; i < _nodes.size(); i++ ) {
+			if( _nodes[ i ].level >= _levels.size() )
+				_levels.resize( _nodes[ i ].level + 1 );
+			_levels[ _nodes[ i ].level ].push_back( i );
+		}
+
+		// lifetime of the intermediate images in levels
+		for( size_t i = 0; i < _buffers.size(); i++ )
+			_buffers[ i ].lastUse = _buffers[ i ].isOutput ? ( size_t ) -1 : _nodes[ _buffers[ i ].node ].level;
+		for( size_t i = 0; i < _nodes.size(); i++ ) {
+			const Node& node = _nodes[ i ];
+			for( size_t k = 0; k < node.inputs.size(); k++ ) {
+				if( node.inputs[ k ].source < 0 )
+					continue;
+				Buffer& buf = _buffers[ node.inputs[ k ].source ];
+				buf.lastUse = Math::max( buf.lastUse, node.level );
+			}
+		}
+		_scheduled = true;
+	}
+
+	void IFilterGraph::allocate( const std::vector<const Image*>& inputs )
+	{
+		// expected size and format of every intermediate image
+		std::vector<size_t> width( _buffers.size() ), height( _buffers.size() );
+		std::vector<const IFormat*> format( _buffers.size() );
+		std::vector<size_t> slotLastUse;
+		std::vector<size_t> slotBuffer;
+
+		for( size_t l = 0; l < _levels.size(); l++ ) {
+			for( size_t n = 0; n < _levels[ l ].size(); n++ ) {
+				const Node& node = _nodes[ _levels[ l ][ n ] ];
+
+				size_t w = 0, h = 0;
+				const IFormat* f = NULL;
+				if( !node.inputs.empty() ) {
+					long src = node.inputs[ 0 ].source;
+					if( src < 0 ) {
+						const Image* img = inputs[ -( src + 1 ) ];
+						w = img->width(); h = img->height(); f = &img->format();
+					} else {
+						w = width[ src ]; h = height[ src ]; f = format[ src ];
+					}
+				} else if( !inputs.empty() ) {
+					w = inputs[ 0 ]->width(); h = inputs[ 0 ]->height(); f = &inputs[ 0 ]->format();
+				}
+
+				IAllocatorType mem = node.placement == IFILTER_OPENCL ? IALLOCATOR_CL : IALLOCATOR_MEM;
+				for( size_t b = 0; b < node.buffers.size(); b++ ) {
+					size_t id = node.buffers[ b ];
+					Buffer& buf = _buffers[ id ];
+					width[ id ] = w;
+					height[ id ] = h;
+					format[ id ] = buf.format ? buf.format : f;
+
+					// reuse a pooled image whose last consumer ran in an earlier level
+					size_t slot = slotLastUse.size();
+					for( size_t s = 0; s < slotLastUse.size(); s++ ) {
+						const Buffer& prev = _buffers[ slotBuffer[ s ] ];
+						if( slotLastUse[ s ] < l && format[ slotBuffer[ s ] ] == format[ id ] &&
+							width[ slotBuffer[ s ] ] == w && height[ slotBuffer[ s ] ] == h &&
+							_nodes[ prev.node ].placement == node.placement ) {
+							slot = s;
+							break;
+						}
+					}
+					if( slot == slotLastUse.size() ) {
+						slotLastUse.push_back( 0 );
+						slotBuffer.push_back( 0 );
+					}
+					slotLastUse[ slot ] = buf.lastUse;
+					slotBuffer[ slot ] = id;
+					buf.slot = slot;
+
+					if( slot >= _slots.size() )
+						_slots.push_back( new Image() );
+					if( w && h && format[ id ] )
+						_slots[ slot ]->reallocate( w, h, *format[ id ], mem );
+				}
+			}
+		}
+
+		while( _slots.size() > slotLastUse.size() ) {
+			delete _slots.back();
+			_slots.pop_back();
+		}
+	}
+
+	const Image* IFilterGraph::sourceImage( long source, const std::vector<const Image*>& inputs ) const
+	{
+		if( source < 0 )
+			return inputs[ -( source + 1 ) ];
+		return _slots[ _buffers[ source ].slot ];
+	}
+
+	void IFilterGraph::bind( size_t id, const std::vector<const Image*>& inputs )
+	{
+		Node& node = _nodes[ id ];
+		for( size_t k = 0; k < node.inputs.size(); k++ )
+			node.params->setArg<Image*>( node.inputs[ k ].param, ( Image* ) sourceImage( node.inputs[ k ].source, inputs ) );
+		for( size_t b = 0; b < node.buffers.size(); b++ ) {
+			const Buffer& buf = _buffers[ node.buffers[ b ] ];
+			node.params->setArg<Image*>( buf.param, _slots[ buf.slot ] );
+		}
+	}
+
+	void IFilterGraph::process( const std::vector<const Image*>& inputs )
+	{
+		if( inputs.size() != _numInputs )
+			throw CVTException( "Number of inputs does not match the graph" );
+
+		if( !_scheduled )
+			schedule();
+		allocate( inputs );
+
+		std::vector<size_t> cpu, cl;
+		std::vector<std::string> errors;
+		for( size_t l = 0; l < _levels.size(); l++ ) {
+			cpu.clear();
+			cl.clear();
+			for( size_t n = 0; n < _levels[ l ].size(); n++ ) {
+				size_t id = _levels[ l ][ n ];
+				bind( id, inputs );
+				if( _nodes[ id ].placement == IFILTER_OPENCL )
+					cl.push_back( id );
+				else
+					cpu.push_back( id );
+			}
+
+			errors.assign( cpu.size(), std::string() );
+			IFilterGraphLevel body( *this, cpu, errors );
+			if( cpu.size() > 1 )
+				parallelFor( 0, cpu.size(), body, 1 );
+			else
+				body( 0, cpu.size() );
+
+			for( size_t n = 0; n < cl.size(); n++ ) {
+				const Node& node = _nodes[ cl[ n ] ];
+				node.filter->apply( node.params, node.placement );
+			}
+
+			for( size_t n = 0; n < errors.size(); n++ ) {
+				if( !errors[ n ].empty() )
+					throw CVTException( errors[ n ] );
+			}
+		}
+	}
+
+	void IFilterGraph::startStream( size_t queueSize )
+	{
+		_streamMutex.lock();
+		if( _streamRunning ) {
+			_streamMutex.unlock();
+			throw CVTException( "Stream already running" );
+		}
+		_queueSize = Math::max<size_t>( queueSize, 1 );
+		_streamRunning = true;
+		_streamEnd = false;
+		_streamMutex.unlock();
+		_worker.run( this );
+	}
+
+	void IFilterGraph::push( const std::vector<const Image*>& inputs )
+	{
+		if( inputs.size() != _numInputs )
+			throw CVTException( "Number of inputs does not match the graph" );
+
+		std::vector<Image*> frame( inputs.size() );
+		for( size_t i = 0; i < inputs.size(); i++ )
+			frame[ i ] = new Image( *inputs[ i ] );
+
+		_streamMutex.lock();
+		while( _streamRunning && !_streamEnd && _inQueue.size() >= _queueSize )
+			_streamCond.wait( _streamMutex );
+		if( !_streamRunning || _streamEnd ) {
+			_streamMutex.unlock();
+			for( size_t i = 0; i < frame.size(); i++ )
+				delete frame[ i ];
+			throw CVTException( "Stream not running" );
+		}
+		_inQueue.push_back( frame );
+		_streamCond.notifyAll();
+		_streamMutex.unlock();
+	}
+
+	bool IFilterGraph::pop( std::vector<Image>& outputs )
+	{
+		_streamMutex.lock();
+		while( _outQueue.empty() && _streamRunning )
+			_streamCond.wait( _streamMutex );
+		if( _outQueue.empty() ) {
+			_streamMutex.unlock();
+			return false;
+		}
+		std::vector<Image*> frame = _outQueue.front();
+		_outQueue.pop_front();
+		_streamCond.notifyAll();
+		_streamMutex.unlock();
+
+		outputs.resize( frame.size() );
+		for( size_t i = 0; i < frame.size(); i++ ) {
+			outputs[ i ] = *frame[ i ];
+			delete frame[ i ];
+		}
+		return true;
+	}
+
+	void IFilterGraph::stopStream()
+	{
+		_streamMutex.lock();
+		if( !_streamRunning ) {
+			_streamMutex.unlock();
+			return;
+		}
+		_streamEnd = true;
+		_streamCond.notifyAll();
+		_streamMutex.unlock();
+		_worker.join();
+	}
+
+	void IFilterGraph::streamLoop()
+	{
+		_streamMutex.lock();
+		while( true ) {
+			while( _inQueue.empty() && !_streamEnd )
+				_streamCond.wait( _streamMutex );
+			if( _inQueue.empty() )
+				break;
+
+			std::vector<Image*> frame = _inQueue.front();
+			_inQueue.pop_front();
+			_streamCond.notifyAll();
+			_streamMutex.unlock();
+
+			std::vector<const Image*> inputs( frame.begin(), frame.end() );
+			std::vector<Image*> result;
+			try {
+				process( inputs );
+				for( size_t i = 0; i < _outputs.size(); i++ )
+					result.push_back( new Image( output( i ) ) );
+			} catch( Exception& e ) {
+				std::cerr << "IFilterGraph: dropping frame: " << e.what() << std::endl;
+			}
+			for( size_t i = 0; i < frame.size(); i++ )
+				delete frame[ i ];
+
+			_streamMutex.lock();
+			if( result.size() ) {
+				// back-pressure, unless the stream is shutting down
+				while( _outQueue.size() >= _queueSize && !_streamEnd )
+					_streamCond.wait( _streamMutex );
+				_outQueue.push_back( result );
+				_streamCond.notifyAll();
+			}
+		}
+		_streamRunning = false;
+		_streamCond.notifyAll();
+		_streamMutex.unlock();
+	}
+}
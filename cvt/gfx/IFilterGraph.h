@@ -0,0 +1,173 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_IFILTERGRAPH_H
+#define CVT_IFILTERGRAPH_H
+
+#include <cvt/gfx/IFilter.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/util/Thread.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Condition.h>
+
+#include <vector>
+#include <deque>
+
+namespace cvt {
+
+	/**
+	  \brief Dataflow graph of IFilter nodes connected through their Image ports
+
+	  Nodes are scheduled level by level: all nodes whose inputs are available
+	  run concurrently on the ThreadPool (OpenCL nodes are issued by the calling
+	  thread). Intermediate images are pooled, a buffer is reused by a later
+	  level once its last consumer has run and the format matches.
+	  Output ports take the size of the first connected input of their node and,
+	  if not set explicitly, also its format.
+	 */
+	class IFilterGraph {
+		public:
+			IFilterGraph( size_t numInputs = 1 );
+			~IFilterGraph();
+
+			/**
+			  \brief add a node, the filter is not owned by the graph
+			  \return the node id
+			 */
+			size_t		addNode( const IFilter* filter, IFilterType placement = IFILTER_CPU );
+			/* the non-image parameters of the node */
+			ParamSet&	parameters( size_t node );
+
+			void		connect( size_t src, const String& srcPort, size_t dst, const String& dstPort );
+			void		connectInput( size_t input, size_t dst, const String& dstPort );
+			/* \return the index of the new graph output */
+			size_t		addOutput( size_t node, const String& port );
+			void		setOutputFormat( size_t node, const String& port, const IFormat& format );
+
+			size_t		numNodes() const	{ return _nodes.size(); }
+			size_t		numInputs() const	{ return _numInputs; }
+			size_t		numOutputs() const	{ return _outputs.size(); }
+			/* number of distinct intermediate images used by the last process call */
+			size_t		numBuffers() const	{ return _slots.size(); }
+
+			void		 process( const Image& input );
+			void		 process( const std::vector<const Image*>& inputs );
+			const Image& output( size_t i ) const;
+
+			/**
+			  \brief process frames on a worker thread
+			  \param queueSize	maximum number of queued input and output frames
+			 */
+			void		startStream( size_t queueSize = 2 );
+			/* copies the frame, blocks while the input queue is full */
+			void		push( const Image& input );
+			void		push( const std::vector<const Image*>& inputs );
+			/* blocks until a frame is processed, false once the stream ended and is drained */
+			bool		pop( std::vector<Image>& outputs );
+			/* processes the queued frames and stops the worker */
+			void		stopStream();
+
+		private:
+			IFilterGraph( const IFilterGraph& );
+			IFilterGraph& operator=( const IFilterGraph& );
+
+			/* output port of a node producing an intermediate image */
+			struct Buffer {
+				size_t			node;
+				size_t			param;
+				const IFormat*	format;
+				bool			isOutput;
+				size_t			lastUse;
+				size_t			slot;
+			};
+
+			/* input port of a node, source < 0 denotes graph input -( source + 1 ) */
+			struct Connection {
+				long			source;
+				size_t			param;
+			};
+
+			struct Node {
+				const IFilter*			filter;
+				IFilterType				placement;
+				ParamSet*				params;
+				std::vector<Connection> inputs;
+				std::vector<size_t>		buffers;
+				size_t					level;
+			};
+
+			class StreamWorker : public Thread<IFilterGraph> {
+				public:
+					void execute( IFilterGraph* graph ) { graph->streamLoop(); }
+			};
+
+			friend class IFilterGraphLevel;
+
+			size_t			imagePort( size_t node, const String& port, bool input ) const;
+			size_t			bufferForPort( size_t node, size_t param ) const;
+			void			schedule();
+			void			allocate( const std::vector<const Image*>& inputs );
+			const Image*	sourceImage( long source, const std::vector<const Image*>& inputs ) const;
+			void			bind( size_t node, const std::vector<const Image*>& inputs );
+			void			streamLoop();
+
+			size_t					_numInputs;
+			std::vector<Node>		_nodes;
+			std::vector<Buffer>		_buffers;
+			std::vector<size_t>		_outputs;
+			std::vector<std::vector<size_t> > _levels;
+			std::vector<Image*>		_slots;
+			bool					_scheduled;
+
+			Mutex					_streamMutex;
+			Condition				_streamCond;
+			std::deque<std::vector<Image*> > _inQueue;
+			std::deque<std::vector<Image*> > _outQueue;
+			size_t					_queueSize;
+			bool					_streamRunning;
+			bool					_streamEnd;
+			StreamWorker			_worker;
+	};
+
+	inline void IFilterGraph::process( const Image& input )
+	{
+		std::vector<const Image*> inputs( 1, &input );
+		process( inputs );
+	}
+
+	inline void IFilterGraph::push( const Image& input )
+	{
+		std::vector<const Image*> inputs( 1, &input );
+		push( inputs );
+	}
+
+	inline const Image& IFilterGraph::output( size_t i ) const
+	{
+		if( i >= _outputs.size() || _slots.empty() )
+			throw CVTException( "Invalid graph output" );
+		return *_slots[ _buffers[ _outputs[ i ] ].slot ];
+	}
+}
+
+#endif
@@ -0,0 +1,159 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/IFilterGraph.h>
+#include <cvt/gfx/ifilter/GaussIIR.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/CVTTest.h>
+
+namespace cvt {
+
+	static void _filterGraphInput( Image& img, size_t w, size_t h, size_t seed )
+	{
+		img.reallocate( w, h, IFormat::GRAY_FLOAT );
+		IMapScoped<float> map( img );
+		for( size_t y = 0; y < h; y++ ) {
+			float* ptr = map.ptr();
+			for( size_t x = 0; x < w; x++ )
+				ptr[ x ] = ( float ) ( ( x * 7 + y * 13 + seed * 31 ) % 17 ) / 17.0f;
+			map++;
+		}
+	}
+
+	static float _filterGraphMaxDiff( const Image& a, const Image& b )
+	{
+		if( a.width() != b.width() || a.height() != b.height() || a.format() != b.format() )
+			return 1e10f;
+		IMapScoped<const float> ma( a );
+		IMapScoped<const float> mb( b );
+		float ret = 0.0f;
+		for( size_t y = 0; y < a.height(); y++ ) {
+			for( size_t x = 0; x < a.width(); x++ )
+				ret = Math::max( ret, Math::abs( ma.ptr()[ x ] - mb.ptr()[ x ] ) );
+			ma++;
+			mb++;
+		}
+		return ret;
+	}
+
+	static void _filterGraphGauss( const GaussIIR& gauss, Image& dst, const Image& src, float sigma )
+	{
+		ParamSet* set = gauss.parameterSet();
+		set->setArg<Image*>( 0, ( Image* ) &src );
+		set->setArg<Image*>( 1, &dst );
+		set->setArg<float>( 2, sigma );
+		set->setArg<int>( 3, 0 );
+		gauss.apply( set, IFILTER_CPU );
+		delete set;
+	}
+
+	static size_t _filterGraphNode( IFilterGraph& graph, const GaussIIR& gauss, float sigma )
+	{
+		size_t n = graph.addNode( &gauss );
+		ParamSet& set = graph.parameters( n );
+		set.setArg<float>( set.paramHandle( "Sigma" ), sigma );
+		return n;
+	}
+
+	BEGIN_CVTTEST( IFilterGraph )
+		bool result = true;
+		bool b;
+		GaussIIR gauss;
+
+		// input -> g1 -> g2 -> g3 -> output 0, input -> g4 -> output 1
+		IFilterGraph graph;
+		size_t g1 = _filterGraphNode( graph, gauss, 1.0f );
+		size_t g2 = _filterGraphNode( graph, gauss, 2.0f );
+		size_t g3 = _filterGraphNode( graph, gauss, 1.5f );
+		size_t g4 = _filterGraphNode( graph, gauss, 3.0f );
+		graph.connectInput( 0, g1, "Input" );
+		graph.connect( g1, "Output", g2, "Input" );
+		graph.connect( g2, "Output", g3, "Input" );
+		graph.connectInput( 0, g4, "Input" );
+		graph.addOutput( g3, "Output" );
+		graph.addOutput( g4, "Output" );
+
+		Image input, tmp1, tmp2, ref0, ref1;
+		_filterGraphInput( input, 97, 61, 0 );
+		_filterGraphGauss( gauss, tmp1, input, 1.0f );
+		_filterGraphGauss( gauss, tmp2, tmp1, 2.0f );
+		_filterGraphGauss( gauss, ref0, tmp2, 1.5f );
+		_filterGraphGauss( gauss, ref1, input, 3.0f );
+
+		graph.process( input );
+		b = _filterGraphMaxDiff( graph.output( 0 ), ref0 ) < 1e-6f &&
+			_filterGraphMaxDiff( graph.output( 1 ), ref1 ) < 1e-6f;
+		CVTTEST_PRINT( "IFilterGraph process", b );
+		result &= b;
+
+		// g1's image is free once g2 ran and is reused for g3
+		b = graph.numBuffers() == 3;
+		CVTTEST_PRINT( "IFilterGraph buffer reuse", b );
+		result &= b;
+
+		b = false;
+		try {
+			graph.connect( g3, "Output", g1, "Input" );
+			graph.process( input );
+		} catch( Exception& ) {
+			b = true;
+		}
+		CVTTEST_PRINT( "IFilterGraph cycle detection", b );
+		result &= b;
+
+		// streaming, frames keep their order
+		IFilterGraph stream;
+		size_t s1 = _filterGraphNode( stream, gauss, 2.0f );
+		stream.connectInput( 0, s1, "Input" );
+		stream.addOutput( s1, "Output" );
+		stream.startStream( 2 );
+
+		const size_t numFrames = 5;
+		std::vector<Image> frames( numFrames );
+		for( size_t i = 0; i < numFrames; i++ ) {
+			_filterGraphInput( frames[ i ], 64, 48, i );
+			stream.push( frames[ i ] );
+			// keep the queues bounded without a separate consumer thread
+			if( i >= 1 ) {
+				std::vector<Image> out;
+				stream.pop( out );
+				Image ref;
+				_filterGraphGauss( gauss, ref, frames[ i - 1 ], 2.0f );
+				result &= out.size() == 1 && _filterGraphMaxDiff( out[ 0 ], ref ) < 1e-6f;
+			}
+		}
+		stream.stopStream();
+
+		std::vector<Image> out;
+		b = stream.pop( out );
+		Image ref;
+		_filterGraphGauss( gauss, ref, frames[ numFrames - 1 ], 2.0f );
+		b = b && _filterGraphMaxDiff( out[ 0 ], ref ) < 1e-6f && !stream.pop( out );
+		CVTTEST_PRINT( "IFilterGraph stream", b );
+		result &= b;
+
+		return result;
+	END_CVTTEST
+}
@@ -59,7 +59,14 @@ namespace cvt
         IFORMAT_BAYER_GRBG_UINT8,
         IFORMAT_BAYER_GBRG_UINT8,
 		IFORMAT_YUYV_UINT8,
-		IFORMAT_UYVY_UINT8
+		IFORMAT_UYVY_UINT8,
+		/* I420: Y plane, followed by the U and the V plane with half the stride and ( height + 1 ) / 2 rows each */
+		IFORMAT_YUV420_PLANAR_UINT8,
+		/* Y plane, followed by ( height + 1 ) / 2 rows of interleaved UV with the stride of the Y plane */
+		IFORMAT_NV12_UINT8,
+
+		IFORMAT_GRAY_HALF,
+		IFORMAT_RGBA_HALF
 	};
 
 	enum IFormatType
@@ -68,7 +75,8 @@ namespace cvt
 		IFORMAT_TYPE_UINT8,
 		IFORMAT_TYPE_UINT16,
 		IFORMAT_TYPE_INT16,
-		IFORMAT_TYPE_FLOAT
+		IFORMAT_TYPE_FLOAT,
+		IFORMAT_TYPE_HALF
 	};
 
 	struct IFormat
@@ -77,6 +85,11 @@ namespace cvt
 		bool operator==( const IFormat & other ) const;
 		bool operator!=( const IFormat & other ) const;
 
+		/* formats with chroma planes stored below the bpp-sized luma rows */
+		bool isPlanar() const;
+		/* number of rows of the memory layout of an image with the given height */
+		size_t bufferRows( size_t height ) const;
+
 		size_t channels;
 		size_t bpc;
 		size_t bpp;
@@ -104,6 +117,10 @@ namespace cvt
         static const IFormat BAYER_GBRG_UINT8;
 		static const IFormat YUYV_UINT8;
 		static const IFormat UYVY_UINT8;
+		static const IFormat YUV420_PLANAR_UINT8;
+		static const IFormat NV12_UINT8;
+		static const IFormat GRAY_HALF;
+		static const IFormat RGBA_HALF;
 
 		static const IFormat& uint8Equivalent( const IFormat& format );
 		static const IFormat& uint16Equivalent( const IFormat& format );
@@ -129,6 +146,18 @@ namespace cvt
 		return ( other.formatID != formatID );
 	}
 
+	inline bool IFormat::isPlanar() const
+	{
+		return formatID == IFORMAT_YUV420_PLANAR_UINT8 || formatID == IFORMAT_NV12_UINT8;
+	}
+
+	inline size_t IFormat::bufferRows( size_t height ) const
+	{
+		if( isPlanar() )
+			return height + ( height + 1 ) / 2;
+		return height;
+	}
+
 	inline const IFormat & IFormat::uint8Equivalent( const IFormat & format )
 	{
 		switch ( format.formatID ) {
@@ -136,6 +165,7 @@ namespace cvt
 			case IFORMAT_GRAY_UINT16:
 			case IFORMAT_GRAY_INT16:
 			case IFORMAT_GRAY_FLOAT:
+			case IFORMAT_GRAY_HALF:
 				return IFormat::GRAY_UINT8;
 			case IFORMAT_GRAYALPHA_UINT8:
 			case IFORMAT_GRAYALPHA_UINT16:
@@ -146,6 +176,7 @@ namespace cvt
 			case IFORMAT_RGBA_UINT16:
 			case IFORMAT_RGBA_INT16:
 			case IFORMAT_RGBA_FLOAT:
+			case IFORMAT_RGBA_HALF:
 				return IFormat::RGBA_UINT8;
 			case IFORMAT_BGRA_UINT8:
 			case IFORMAT_BGRA_UINT16:
@@ -162,6 +193,10 @@ namespace cvt
 				return IFormat::YUYV_UINT8;
 			case IFORMAT_UYVY_UINT8:
 				return IFormat::UYVY_UINT8;
+			case IFORMAT_YUV420_PLANAR_UINT8:
+				return IFormat::YUV420_PLANAR_UINT8;
+			case IFORMAT_NV12_UINT8:
+				return IFormat::NV12_UINT8;
 			default:
 				throw CVTException( "NO UINT8 equivalent for requested FORMAT" );
 		}
@@ -232,6 +267,7 @@ namespace cvt
 			case IFORMAT_GRAY_UINT16:
 			case IFORMAT_GRAY_INT16:
 			case IFORMAT_GRAY_FLOAT:
+			case IFORMAT_GRAY_HALF:
 				return IFormat::GRAY_FLOAT;
 			case IFORMAT_GRAYALPHA_UINT8:
 			case IFORMAT_GRAYALPHA_UINT16:
@@ -242,6 +278,7 @@ namespace cvt
 			case IFORMAT_RGBA_UINT16:
 			case IFORMAT_RGBA_INT16:
 			case IFORMAT_RGBA_FLOAT:
+			case IFORMAT_RGBA_HALF:
 				return IFormat::RGBA_FLOAT;
 			case IFORMAT_BGRA_UINT8:
 			case IFORMAT_BGRA_UINT16:
@@ -284,6 +321,9 @@ namespace cvt
 
 			case IFORMAT_YUYV_UINT8:		glformat = GL_RG; gltype = GL_UNSIGNED_BYTE; break;
 			case IFORMAT_UYVY_UINT8:		glformat = GL_RG; gltype = GL_UNSIGNED_BYTE; break;
+
+			case IFORMAT_GRAY_HALF:			glformat = GL_RED; gltype = GL_HALF_FLOAT; break;
+			case IFORMAT_RGBA_HALF:			glformat = GL_RGBA; gltype = GL_HALF_FLOAT; break;
 			default:
 											throw CVTException( "No equivalent GL format found" );
 											break;
@@ -322,6 +362,9 @@ namespace cvt
 
 			case IFORMAT_YUYV_UINT8:		clorder = CL_RA; cltype = CL_UNORM_INT8; break;
 			case IFORMAT_UYVY_UINT8:		clorder = CL_RA; cltype = CL_UNORM_INT8; break;
+
+			case IFORMAT_GRAY_HALF:			clorder = CL_INTENSITY; cltype = CL_HALF_FLOAT; break;
+			case IFORMAT_RGBA_HALF:			clorder = CL_RGBA; cltype = CL_HALF_FLOAT; break;
 			default:
 				throw CVTException( "No equivalent CL format found" );
 				break;
@@ -339,6 +382,7 @@ namespace cvt
 					case GL_UNSIGNED_SHORT: return IFormat::GRAY_UINT16;
 					case GL_SHORT: return IFormat::GRAY_INT16;
 					case GL_FLOAT: return IFormat::GRAY_FLOAT;
+					case GL_HALF_FLOAT: return IFormat::GRAY_HALF;
 					default:
 						throw CVTException("GL type unsupported");
 						break;
@@ -361,6 +405,7 @@ namespace cvt
 					case GL_UNSIGNED_SHORT: return IFormat::RGBA_UINT16;
 					case GL_SHORT: return IFormat::RGBA_INT16;
 					case GL_FLOAT: return IFormat::RGBA_FLOAT;
+					case GL_HALF_FLOAT: return IFormat::RGBA_HALF;
 					default:
 						throw CVTException("GL type unsupported");
 						break;
@@ -428,6 +473,14 @@ namespace cvt
                 return IFormat::BAYER_GRBG_UINT8;
             case IFORMAT_BAYER_GBRG_UINT8:
                 return IFormat::BAYER_GBRG_UINT8;
+			case IFORMAT_YUV420_PLANAR_UINT8:
+				return IFormat::YUV420_PLANAR_UINT8;
+			case IFORMAT_NV12_UINT8:
+				return IFormat::NV12_UINT8;
+			case IFORMAT_GRAY_HALF:
+				return IFormat::GRAY_HALF;
+			case IFORMAT_RGBA_HALF:
+				return IFormat::RGBA_HALF;
 			default:
 				String msg;
 				msg.sprintf( "UNKNOWN INPUT FORMAT: %d", (int)formatID );
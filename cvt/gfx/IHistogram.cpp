@@ -0,0 +1,349 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/IHistogram.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/ThreadPool.h>
+
+namespace cvt {
+
+	/* rows per chunk of the derivative */
+	#define CVT_HISTOGRAM_CHUNK_ROWS 32
+	/* row groups with their own sub-histograms, bounds the temporary memory */
+	#define CVT_HISTOGRAM_GROUPS 8
+	/* interleaved sub-histograms per group */
+	#define CVT_HISTOGRAM_SUBS 4
+
+	/* one image row as float values, GRAY_UINT8 and RGBA/BGRA_UINT8 scaled to [ 0, 1 ] */
+	class IHistogramRow {
+		public:
+			IHistogramRow( const Image& img, size_t y ) :
+				_map( img ), _isFloat( img.format().type == IFORMAT_TYPE_FLOAT ),
+				_n( img.width() * img.format().channels ), _buf( _n )
+			{
+				_map.setLine( y );
+			}
+
+			const float* values( SIMD* simd )
+			{
+				if( _isFloat )
+					return ( const float* ) _map.ptr();
+				simd->Conv_u8_to_f( _buf.ptr(), _map.ptr(), _n );
+				return _buf.ptr();
+			}
+
+			void next()
+			{
+				_map++;
+			}
+
+		private:
+			IMapScoped<const uint8_t>	_map;
+			bool						_isFloat;
+			size_t						_n;
+			ScopedBuffer<float, true>	_buf;
+	};
+
+	static inline void _histCheckFormat( const Image& img )
+	{
+		switch( img.format().formatID ) {
+			case IFORMAT_GRAY_FLOAT:
+			case IFORMAT_GRAY_UINT8:
+			case IFORMAT_RGBA_FLOAT:
+			case IFORMAT_BGRA_FLOAT:
+			case IFORMAT_RGBA_UINT8:
+			case IFORMAT_BGRA_UINT8:
+				break;
+			default:
+				throw CVTException( "Unimplemented" );
+		}
+	}
+
+	static inline int32_t _histBin( float v, size_t bins )
+	{
+		float x = v * ( float ) ( bins - 1 ) + 0.5f;
+		if( !( x >= 0.0f ) )
+			return 0;
+		if( x > ( float ) ( bins - 1 ) )
+			return ( int32_t ) bins - 1;
+		return ( int32_t ) x;
+	}
+
+	/* rows [ y0, y1 ) of group g */
+	static inline void _histGroupRows( size_t& y0, size_t& y1, size_t g, size_t ngroups, size_t height )
+	{
+		y0 = g * height / ngroups;
+		y1 = ( g + 1 ) * height / ngroups;
+	}
+
+	/* sum the sub-histograms of all groups, always in the same order */
+	template<typename T>
+	static inline void _histReduce( T* dst, const std::vector<T>& groups, size_t hsize, size_t ngroups )
+	{
+		for( size_t i = 0; i < hsize; i++ )
+			dst[ i ] = 0;
+		for( size_t c = 0; c < ngroups * CVT_HISTOGRAM_SUBS; c++ ) {
+			const T* src = &groups[ c * hsize ];
+			for( size_t i = 0; i < hsize; i++ )
+				dst[ i ] += src[ i ];
+		}
+	}
+
+	template<typename T>
+	class IHistogramGroup {
+		public:
+			IHistogramGroup( std::vector<T>& groups, size_t ngroups, size_t bins, const Image& img, IHistogramType type ) :
+				_groups( groups ), _ngroups( ngroups ), _bins( bins ), _img( img ), _type( type )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				SIMD* simd = SIMD::instance();
+				size_t channels = _img.format().channels;
+				size_t n = _img.width() * channels;
+				size_t stride = _bins + 1;
+				size_t hsize = stride * channels;
+				ScopedBuffer<float, true> weights( 4 * n );
+				ScopedBuffer<int32_t, true> index( n );
+
+				for( size_t g = begin; g < end; g++ ) {
+					T* sub = &_groups[ g * CVT_HISTOGRAM_SUBS * hsize ];
+					size_t y0, y1;
+					_histGroupRows( y0, y1, g, _ngroups, _img.height() );
+					IHistogramRow row( _img, y0 );
+					for( size_t y = y0; y < y1; y++ ) {
+						const float* values = row.values( simd );
+						if( _type == IHISTOGRAM_BSPLINE ) {
+							simd->BSplineWeights_f( weights.ptr(), index.ptr(), values, ( float ) ( _bins - 3 ), 1.0f,
+												   1.0f, ( float ) ( _bins - 2 ), n );
+							const float* w = weights.ptr();
+							const int32_t* idx = index.ptr();
+							for( size_t x = 0, s = 0; s < n; x++ ) {
+								T* h = sub + ( x & ( CVT_HISTOGRAM_SUBS - 1 ) ) * hsize - 1;
+								for( size_t c = 0; c < channels; c++, s++, w += 4, h += stride ) {
+									T* dst = h + idx[ s ];
+									dst[ 0 ] += w[ 0 ];
+									dst[ 1 ] += w[ 1 ];
+									dst[ 2 ] += w[ 2 ];
+									dst[ 3 ] += w[ 3 ];
+								}
+							}
+						} else {
+							for( size_t x = 0, s = 0; s < n; x++ ) {
+								T* h = sub + ( x & ( CVT_HISTOGRAM_SUBS - 1 ) ) * hsize;
+								for( size_t c = 0; c < channels; c++, s++, h += stride )
+									h[ _histBin( values[ s ], _bins ) ] += 1;
+							}
+						}
+						row.next();
+					}
+				}
+			}
+
+		private:
+			std::vector<T>&		_groups;
+			size_t				_ngroups;
+			size_t				_bins;
+			const Image&		_img;
+			IHistogramType		_type;
+	};
+
+	template<typename T>
+	class IHistogramJointGroup {
+		public:
+			IHistogramJointGroup( std::vector<T>& groups, size_t ngroups, size_t bins, const Image& one, const Image& two, IHistogramType type ) :
+				_groups( groups ), _ngroups( ngroups ), _bins( bins ), _one( one ), _two( two ), _type( type )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				SIMD* simd = SIMD::instance();
+				size_t n = _one.width();
+				size_t stride = _bins + 1;
+				size_t hsize = stride * stride;
+				ScopedBuffer<float, true> wone( 4 * n );
+				ScopedBuffer<float, true> wtwo( 4 * n );
+				ScopedBuffer<int32_t, true> ione( n );
+				ScopedBuffer<int32_t, true> itwo( n );
+
+				for( size_t g = begin; g < end; g++ ) {
+					T* sub = &_groups[ g * CVT_HISTOGRAM_SUBS * hsize ];
+					size_t y0, y1;
+					_histGroupRows( y0, y1, g, _ngroups, _one.height() );
+
+					IHistogramRow rone( _one, y0 );
+					IHistogramRow rtwo( _two, y0 );
+					for( size_t y = y0; y < y1; y++ ) {
+						const float* vone = rone.values( simd );
+						const float* vtwo = rtwo.values( simd );
+						if( _type == IHISTOGRAM_BSPLINE ) {
+							simd->BSplineWeights_f( wone.ptr(), ione.ptr(), vone, ( float ) ( _bins - 3 ), 1.0f, 1.0f, ( float ) ( _bins - 2 ), n );
+							simd->BSplineWeights_f( wtwo.ptr(), itwo.ptr(), vtwo, ( float ) ( _bins - 3 ), 1.0f, 1.0f, ( float ) ( _bins - 2 ), n );
+							const float* w1 = wone.ptr();
+							const float* w2 = wtwo.ptr();
+							for( size_t x = 0; x < n; x++, w1 += 4, w2 += 4 ) {
+								T* h = sub + ( x & ( CVT_HISTOGRAM_SUBS - 1 ) ) * hsize
+									 + ( itwo.ptr()[ x ] - 1 ) * stride + ione.ptr()[ x ] - 1;
+								for( size_t m = 0; m < 4; m++, h += stride ) {
+									h[ 0 ] += w2[ m ] * w1[ 0 ];
+									h[ 1 ] += w2[ m ] * w1[ 1 ];
+									h[ 2 ] += w2[ m ] * w1[ 2 ];
+									h[ 3 ] += w2[ m ] * w1[ 3 ];
+								}
+							}
+						} else {
+							for( size_t x = 0; x < n; x++ ) {
+								T* h = sub + ( x & ( CVT_HISTOGRAM_SUBS - 1 ) ) * hsize;
+								h[ _histBin( vtwo[ x ], _bins ) * stride + _histBin( vone[ x ], _bins ) ] += 1;
+							}
+						}
+						rone.next();
+						rtwo.next();
+					}
+				}
+			}
+
+		private:
+			std::vector<T>&		_groups;
+			size_t				_ngroups;
+			size_t				_bins;
+			const Image&		_one;
+			const Image&		_two;
+			IHistogramType		_type;
+	};
+
+	class IHistogramJointDerivative {
+		public:
+			IHistogramJointDerivative( Image& dst, const float* table, size_t bins, const Image& one, const Image& two ) :
+				_dst( dst ), _table( table ), _bins( bins ), _one( one ), _two( two )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				SIMD* simd = SIMD::instance();
+				size_t n = _one.width();
+				size_t stride = _bins + 1;
+				ScopedBuffer<float, true> wone( 4 * n );
+				ScopedBuffer<int32_t, true> ione( n );
+				float scale = ( float ) ( _bins - 3 );
+				float hi = ( float ) ( _bins - 2 );
+
+				IHistogramRow rone( _one, begin );
+				IHistogramRow rtwo( _two, begin );
+				IMapScoped<float> map( _dst );
+				map.setLine( begin );
+				for( size_t y = begin; y < end; y++ ) {
+					const float* vone = rone.values( simd );
+					const float* vtwo = rtwo.values( simd );
+					float* out = map.ptr();
+					simd->BSplineWeights_f( wone.ptr(), ione.ptr(), vone, scale, 1.0f, 1.0f, hi, n );
+					const float* w1 = wone.ptr();
+
+					for( size_t x = 0; x < n; x++, w1 += 4 ) {
+						float v = vtwo[ x ] * scale + 1.0f;
+						/* clamped values do not change the histogram */
+						if( !( v >= 1.0f ) || v > hi ) {
+							out[ x ] = 0.0f;
+							continue;
+						}
+						int32_t i2 = ( int32_t ) v;
+						float t = v - ( float ) i2;
+						float u = 1.0f - t;
+						float dw[ 4 ];
+						dw[ 0 ] = -0.5f * u * u;
+						dw[ 1 ] = 1.5f * t * t - 2.0f * t;
+						dw[ 2 ] = -1.5f * t * t + t + 0.5f;
+						dw[ 3 ] = 0.5f * t * t;
+
+						const float* tab = _table + ( i2 - 1 ) * stride + ione.ptr()[ x ] - 1;
+						float sum = 0.0f;
+						for( size_t m = 0; m < 4; m++, tab += stride )
+							sum += dw[ m ] * ( w1[ 0 ] * tab[ 0 ] + w1[ 1 ] * tab[ 1 ] + w1[ 2 ] * tab[ 2 ] + w1[ 3 ] * tab[ 3 ] );
+						out[ x ] = sum * scale;
+					}
+					rone.next();
+					rtwo.next();
+					map++;
+				}
+			}
+
+		private:
+			Image&			_dst;
+			const float*	_table;
+			size_t			_bins;
+			const Image&	_one;
+			const Image&	_two;
+	};
+
+	template<typename T>
+	void IHistogramKernel::histogram( T* hist, size_t bins, const Image& img, IHistogramType type )
+	{
+		_histCheckFormat( img );
+		if( type == IHISTOGRAM_BSPLINE && bins < 4 )
+			throw CVTException( "B-spline histograms need at least 4 bins" );
+
+		size_t hsize = ( bins + 1 ) * img.format().channels;
+		size_t ngroups = Math::min( ( size_t ) CVT_HISTOGRAM_GROUPS, img.height() );
+		std::vector<T> groups( ngroups * CVT_HISTOGRAM_SUBS * hsize, 0 );
+		parallelFor( 0, ngroups, IHistogramGroup<T>( groups, ngroups, bins, img, type ), 1 );
+		_histReduce( hist, groups, hsize, ngroups );
+	}
+
+	template void IHistogramKernel::histogram<float>( float*, size_t, const Image&, IHistogramType );
+	template void IHistogramKernel::histogram<double>( double*, size_t, const Image&, IHistogramType );
+
+	template<typename T>
+	void IHistogramKernel::jointHistogram( T* joint, size_t bins, const Image& one, const Image& two, IHistogramType type )
+	{
+		_histCheckFormat( one );
+		_histCheckFormat( two );
+		if( one.format().channels != 1 || two.format().channels != 1 )
+			throw CVTException( "Joint histograms need single channel images" );
+		if( one.width() != two.width() || one.height() != two.height() )
+			throw CVTException( "Joint histograms need images of equal size" );
+		if( type == IHISTOGRAM_BSPLINE && bins < 4 )
+			throw CVTException( "B-spline histograms need at least 4 bins" );
+
+		size_t hsize = ( bins + 1 ) * ( bins + 1 );
+		size_t ngroups = Math::min( ( size_t ) CVT_HISTOGRAM_GROUPS, one.height() );
+		std::vector<T> groups( ngroups * CVT_HISTOGRAM_SUBS * hsize, 0 );
+		parallelFor( 0, ngroups, IHistogramJointGroup<T>( groups, ngroups, bins, one, two, type ), 1 );
+		_histReduce( joint, groups, hsize, ngroups );
+	}
+
+	template void IHistogramKernel::jointHistogram<float>( float*, size_t, const Image&, const Image&, IHistogramType );
+	template void IHistogramKernel::jointHistogram<double>( double*, size_t, const Image&, const Image&, IHistogramType );
+
+	void IHistogramKernel::jointDerivative( Image& dst, const float* table, size_t bins, const Image& one, const Image& two )
+	{
+		dst.reallocate( one.width(), one.height(), IFormat::GRAY_FLOAT );
+		parallelFor( 0, one.height(), IHistogramJointDerivative( dst, table, bins, one, two ), CVT_HISTOGRAM_CHUNK_ROWS );
+	}
+
+}
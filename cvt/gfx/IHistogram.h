@@ -26,7 +26,6 @@
 #define CVT_IHISTOGRAM_H
 
 #include <cvt/gfx/Image.h>
-#include <cvt/math/BSpline.h>
 #include <cvt/util/Exception.h>
 
 namespace cvt {
@@ -35,6 +34,28 @@ namespace cvt {
 		IHISTOGRAM_NOINTERP
 	};
 
+	/**
+	  \brief Row parallel histogram kernels used by IHistogram and IMI.
+
+	  The image is split into a fixed number of row groups which are
+	  processed in parallel. Every group accumulates into four interleaved
+	  sub-histograms of the value type, so that neighbouring pixels falling
+	  into the same bin do not depend on each other's stores. The groups are
+	  reduced in order, the result does not depend on the number of threads.
+	  The B-spline weights of a row are evaluated with SIMD::BSplineWeights_f.
+	 */
+	class IHistogramKernel {
+		public:
+			/* channels * ( bins + 1 ) unnormalized bins per channel */
+			template<typename T>
+			static void histogram( T* hist, size_t bins, const Image& img, IHistogramType type );
+			/* ( bins + 1 ) * ( bins + 1 ) unnormalized bins, value x of one and y of two at y * ( bins + 1 ) + x */
+			template<typename T>
+			static void jointHistogram( T* joint, size_t bins, const Image& one, const Image& two, IHistogramType type );
+			/* per pixel sum of the B-spline joint weights, differentiated with respect to the value of two, times table */
+			static void jointDerivative( Image& dst, const float* table, size_t bins, const Image& one, const Image& two );
+	};
+
 	template<typename T>
 	class IHistogram {
 		public:
@@ -48,16 +69,11 @@ namespace cvt {
 			T operator()( size_t channel, size_t index ) const;
 
 		private:
+			IHistogram( const IHistogram& );
+			IHistogram& operator=( const IHistogram& );
+
 			void alloc( const Image& img );
 			void normalize( T sum );
-			void updateBSpline1f( const Image& i );
-			void updateBSpline1u8( const Image& i );
-			void updateBSpline4f( const Image& i );
-			void updateBSpline4u8( const Image& i );
-			void update1f( const Image& i );
-			void update1u8( const Image& i );
-			void update4f( const Image& i );
-			void update4u8( const Image& i );
 
 			size_t _size;
 			size_t _channels;
@@ -110,48 +126,13 @@ namespace cvt {
 				delete[] _hist;
 			_hist = new T[ ( _size + 1 ) * _channels ];
 		}
-		for( size_t i = 0; i < ( _size + 1 ) * _channels; i++ )
-			_hist[ i ] = 0;
 	}
 
 	template<typename T>
 	inline void IHistogram<T>::update( const Image& i, IHistogramType type )
 	{
 		alloc( i );
-		switch( type ) {
-			case IHISTOGRAM_BSPLINE:
-				{
-					switch( i.format().formatID ) {
-						//case IFORMAT_GRAY_UINT8:	updateBSpline1u8( i ); break;
-						case IFORMAT_GRAY_FLOAT:	updateBSpline1f( i ); break;
-						//case IFORMAT_RGBA_UINT8:
-						//case IFORMAT_BGRA_UINT8:
-						//							updateBSpline4u8( i ); break;
-						case IFORMAT_RGBA_FLOAT:
-						case IFORMAT_BGRA_FLOAT:
-													updateBSpline4f( i ); break;
-						default:
-							throw CVTException( "Unimplemented" );
-					}
-					break;
-				}
-			case IHISTOGRAM_NOINTERP:
-				{
-					switch( i.format().formatID ) {
-						//case IFORMAT_GRAY_UINT8:	update1u8( i ); break;
-						case IFORMAT_GRAY_FLOAT:	update1f( i ); break;
-						//case IFORMAT_RGBA_UINT8:
-						//case IFORMAT_BGRA_UINT8:
-						//							update4u8( i ); break;
-						case IFORMAT_RGBA_FLOAT:
-						case IFORMAT_BGRA_FLOAT:
-													update4f( i ); break;
-						default:
-							throw CVTException( "Unimplemented" );
-					}
-					break;
-				}
-		}
+		IHistogramKernel::histogram( _hist, _size, i, type );
 		normalize( i.width() * i.height() );
 	}
 
@@ -165,116 +146,6 @@ namespace cvt {
 		}
 	}
 
-	template<typename T>
-	inline void IHistogram<T>::updateBSpline1f( const Image& img )
-	{
-		size_t stride;
-		const uint8_t* ptr;
-		const uint8_t* map;
-		size_t w, h;
-
-		w = img.width();
-		h = img.height();
-		map = img.map( &stride );
-		ptr = map;
-		while( h-- ) {
-			const float* p = ( const float * ) ptr;
-			size_t n = w;
-			while( n-- ) {
-				float fidx =  *p++ * ( float ) ( _size - 3 ) + 1.0f;
-				int idx = ( int ) fidx;
-				_hist[ idx ] += BSpline<T>::eval( -fidx + ( float ) idx );
-				_hist[ idx + 1 ] += BSpline<T>::eval( - fidx + ( float ) ( idx + 1 ) );
-				_hist[ idx - 1 ] += BSpline<T>::eval( - fidx + ( float ) ( idx - 1 ) );
-				_hist[ idx + 2 ] += BSpline<T>::eval( - fidx + ( float ) ( idx + 2 ) );
-			}
-			ptr += stride;
-		}
-		img.unmap( map );
-	}
-
-	template<typename T>
-	inline void IHistogram<T>::updateBSpline4f( const Image& img )
-	{
-		size_t stride;
-		const uint8_t* ptr;
-		const uint8_t* map;
-		size_t w, h;
-
-		w = img.width();
-		h = img.height();
-		map = img.map( &stride );
-		ptr = map;
-		while( h-- ) {
-			const float* p = ( const float * ) ptr;
-			size_t n = w;
-			while( n-- ) {
-				for( size_t c = 0; c < 4; c++ ) {
-					float fidx =  *p++ * ( float ) ( _size - 3 ) + 1.0f;
-					int idx = ( int ) fidx;
-					_hist[ ( _size + 1 ) * c + idx ] += BSpline<T>::eval( - fidx - ( float ) idx );
-					_hist[ ( _size + 1 ) * c + idx + 1 ] += BSpline<T>::eval( - fidx + ( float ) ( idx + 1 ) );
-					_hist[ ( _size + 1 ) * c + idx - 1 ] += BSpline<T>::eval( - fidx + ( float ) ( idx - 1 ) );
-					_hist[ ( _size + 1 ) * c + idx + 2 ] += BSpline<T>::eval( - fidx + ( float ) ( idx + 2 ) );
-				}
-			}
-			ptr += stride;
-		}
-		img.unmap( map );
-	}
-
-	template<typename T>
-	inline void IHistogram<T>::update1f( const Image& img )
-	{
-		size_t stride;
-		const uint8_t* ptr;
-		const uint8_t* map;
-		size_t w, h;
-
-		w = img.width();
-		h = img.height();
-		map = img.map( &stride );
-		ptr = map;
-		while( h-- ) {
-			const float* p = ( const float * ) ptr;
-			size_t n = w;
-			while( n-- ) {
-				float fidx =  *p++ * ( float ) ( _size - 1 ) + 0.5f;
-				int idx = ( int ) fidx;
-				_hist[ idx ] += 1;
-			}
-			ptr += stride;
-		}
-		img.unmap( map );
-	}
-
-	template<typename T>
-	inline void IHistogram<T>::update4f( const Image& img )
-	{
-		size_t stride;
-		const uint8_t* ptr;
-		const uint8_t* map;
-		size_t w, h;
-
-		w = img.width();
-		h = img.height();
-		map = img.map( &stride );
-		ptr = map;
-		while( h-- ) {
-			const float* p = ( const float * ) ptr;
-			size_t n = w;
-			while( n-- ) {
-				for( size_t c = 0; c < 4; c++ ) {
-					float fidx =  *p++ * ( float ) ( _size - 1 ) + 0.5f;
-					int idx = ( int ) fidx;
-					_hist[ ( _size + 1 ) * c + idx ] += 1;
-				}
-			}
-			ptr += stride;
-		}
-		img.unmap( map );
-	}
-
 	typedef IHistogram<float> IHistogramf;
 	typedef IHistogram<double> IHistogramd;
 }
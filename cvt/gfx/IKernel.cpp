@@ -26,6 +26,9 @@
 #include <cvt/gfx/Image.h>
 #include <cvt/gfx/IMapScoped.h>
 
+#include <Eigen/Core>
+#include <Eigen/SVD>
+
 namespace cvt {
 	static float _id[] = { 1.0f };
 
@@ -94,4 +97,75 @@ namespace cvt {
 		}
 	}
 
+	size_t IKernel::separate( std::vector<IKernel>& hkernels, std::vector<IKernel>& vkernels, float tolerance ) const
+	{
+		hkernels.clear();
+		vkernels.clear();
+
+		double norm = 0.0;
+		size_t pivot = 0;
+		for( size_t i = 0; i < _width * _height; i++ ) {
+			norm += ( double ) _data[ i ] * ( double ) _data[ i ];
+			if( Math::abs( _data[ i ] ) > Math::abs( _data[ pivot ] ) )
+				pivot = i;
+		}
+		norm = Math::sqrt( norm );
+		if( norm == 0.0 )
+			return 0;
+
+		/* rank one: outer product of the column and the row through the largest entry */
+		size_t px = pivot % _width;
+		size_t py = pivot / _width;
+		double p = _data[ pivot ];
+		double s = Math::sqrt( Math::abs( p ) );
+		IKernel h( _width, 1 );
+		IKernel v( 1, _height );
+		for( size_t x = 0; x < _width; x++ )
+			h( x, 0 ) = ( float ) ( ( p < 0 ? -1.0 : 1.0 ) * ( double ) operator()( x, py ) / s );
+		for( size_t y = 0; y < _height; y++ )
+			v( 0, y ) = ( float ) ( ( double ) operator()( px, y ) / s );
+
+		double err = 0.0;
+		for( size_t y = 0; y < _height; y++ ) {
+			for( size_t x = 0; x < _width; x++ ) {
+				double d = ( double ) operator()( x, y ) - ( double ) v( 0, y ) * ( double ) h( x, 0 );
+				err += d * d;
+			}
+		}
+		if( Math::sqrt( err ) <= tolerance * norm ) {
+			hkernels.push_back( h );
+			vkernels.push_back( v );
+			return 1;
+		}
+
+		Eigen::MatrixXd m( _height, _width );
+		for( size_t y = 0; y < _height; y++ )
+			for( size_t x = 0; x < _width; x++ )
+				m( y, x ) = operator()( x, y );
+
+		Eigen::JacobiSVD<Eigen::MatrixXd> svd( m, Eigen::ComputeThinU | Eigen::ComputeThinV );
+		const Eigen::VectorXd& sigma = svd.singularValues();
+
+		/* smallest rank with a residual below tolerance times the norm */
+		size_t rank = sigma.size();
+		double residual = 0.0;
+		while( rank > 1 ) {
+			residual += sigma[ rank - 1 ] * sigma[ rank - 1 ];
+			if( Math::sqrt( residual ) > tolerance * norm )
+				break;
+			rank--;
+		}
+
+		for( size_t r = 0; r < rank; r++ ) {
+			double sr = Math::sqrt( sigma[ r ] );
+			for( size_t x = 0; x < _width; x++ )
+				h( x, 0 ) = ( float ) ( sr * svd.matrixV()( x, r ) );
+			for( size_t y = 0; y < _height; y++ )
+				v( 0, y ) = ( float ) ( sr * svd.matrixU()( y, r ) );
+			hkernels.push_back( h );
+			vkernels.push_back( v );
+		}
+		return rank;
+	}
+
 }
@@ -27,6 +27,8 @@
 
 #include <cvt/util/SIMD.h>
 
+#include <vector>
+
 namespace cvt {
 	class Image;
 
@@ -52,6 +54,16 @@ namespace cvt {
 
 			bool isSymmetrical() const;
 			bool isPointSymmetrical() const;
+			bool isConstant() const;
+
+			/**
+			  \brief Decomposition into a sum of separable kernels
+			  \desc  the kernel equals sum_i vkernels[ i ]( 0, y ) * hkernels[ i ]( x, 0 ) up to tolerance times
+					 the Frobenius norm. Rank one kernels are factorized exactly from one row and one column,
+					 other kernels use the singular value decomposition.
+			  \return the number of separable terms, i.e. the numerical rank of the kernel
+			 */
+			size_t separate( std::vector<IKernel>& hkernels, std::vector<IKernel>& vkernels, float tolerance = 1e-5f ) const;
 
 			void toImage( Image& dst ) const;
 
@@ -228,6 +240,17 @@ namespace cvt {
 		return true;
 	}
 
+	inline bool IKernel::isConstant() const
+	{
+		const size_t iend = _width * _height;
+		for( size_t i = 1; i < iend; i++ )
+		{
+			if( _data[ i ] != _data[ 0 ] )
+				return false;
+		}
+		return iend != 0;
+	}
+
 	inline bool IKernel::isPointSymmetrical() const
 	{
 		if( !( _width & 1 ) || !( _height & 1 ) )
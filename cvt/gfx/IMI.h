@@ -27,8 +27,19 @@
 
 #include <cvt/gfx/Image.h>
 #include <cvt/gfx/IHistogram.h>
+#include <cvt/math/Math.h>
+
+#include <vector>
 
 namespace cvt {
+	/**
+	  \brief Mutual information of two gray images.
+
+	  The joint histogram is computed with IHistogramKernel::jointHistogram,
+	  the marginals are derived from the joint histogram. For B-spline
+	  histograms the derivative of the mutual information with respect to
+	  every pixel of the second image is available via derivative().
+	 */
 	template<typename T>
 	class IMI {
 		public:
@@ -38,17 +49,26 @@ namespace cvt {
 			size_t size() const;
 			void update( const Image& one, const Image& two, IHistogramType type = IHISTOGRAM_BSPLINE );
 			T operator()( size_t x, size_t y ) const;
-			T operator() const;
+			T marginalOne( size_t x ) const;
+			T marginalTwo( size_t y ) const;
+			T operator()() const;
+			void derivative( Image& dst, const Image& one, const Image& two ) const;
 
 		private:
-			const size_t _size;
-			T _joinhist[ ( _size + 1 ) * ( _size + 1 ) ];
-			IHistogram<T> _histone;
-			IHistogram<T> _histtwo;
+			IMI( const IMI& );
+			IMI& operator=( const IMI& );
+
+			size_t				_size;
+			size_t				_samples;
+			IHistogramType		_type;
+			std::vector<T>		_joint;
+			std::vector<T>		_one;
+			std::vector<T>		_two;
 	};
 
 	template<typename T>
-	inline IMI<T>::IMI( size_t bins ) : _size( bins ), _histone( _size ), _histtwo( _size )
+	inline IMI<T>::IMI( size_t bins ) : _size( bins ), _samples( 0 ), _type( IHISTOGRAM_BSPLINE ),
+		_joint( ( bins + 1 ) * ( bins + 1 ), 0 ), _one( bins + 1, 0 ), _two( bins + 1, 0 )
 	{
 	}
 
@@ -66,130 +86,89 @@ namespace cvt {
 	template<typename T>
 	inline T IMI<T>::operator()( size_t x, size_t y ) const
 	{
-		return _hist[ y * ( _size + 1 ) + y ];
+		return _joint[ y * ( _size + 1 ) + x ];
 	}
 
 	template<typename T>
-	inline T IMI<T>::operator()() const
+	inline T IMI<T>::marginalOne( size_t x ) const
 	{
-		T ret = 0;
-		for( size_t y = 0; y < _size; y++ ) {
-			for( size_t x = 0; x < _size; x++ ) {
-				ret += _hist[ y * ( _size + 1 ) + x ] * Math::log( _hist[ y * ( _size + 1 ) + x ] / ( _histone( y ) * _histtwo( x ) + 1e-10f ) );
-			}
-		}
-		return ret;
+		return _one[ x ];
 	}
 
 	template<typename T>
-	inline void IMI<T>::update( const Image& ione, const Image& itwo, IHistogramType type )
+	inline T IMI<T>::marginalTwo( size_t y ) const
 	{
-		clear();
-		_histone.update( ione, type );
-		_histtwo.update( itwo, type );
-
-		switch( type ) {
-			case IHISTOGRAM_BSPLINE:
-				{
-					switch( i.format().formatID ) {
-						//case IFORMAT_GRAY_UINT8:	updateBSpline1u8( i ); break;
-						case IFORMAT_GRAY_FLOAT:	updateBSpline1f( ione, itwo ); break;
-						//case IFORMAT_RGBA_UINT8:
-						//case IFORMAT_BGRA_UINT8:
-						//							updateBSpline4u8( i ); break;
-						//case IFORMAT_RGBA_FLOAT:
-						//case IFORMAT_BGRA_FLOAT:
-						//							updateBSpline4f( i ); break;
-						default:
-							throw CVTException( "Unimplemented" );
-					}
-					break;
-				}
-			case IHISTOGRAM_NOINTERP:
-				{
-					switch( i.format().formatID ) {
-						//case IFORMAT_GRAY_UINT8:	update1u8( i ); break;
-						//case IFORMAT_GRAY_FLOAT:	update1f( i ); break;
-						//case IFORMAT_RGBA_UINT8:
-						//case IFORMAT_BGRA_UINT8:
-						//							update4u8( i ); break;
-						//case IFORMAT_RGBA_FLOAT:
-						//case IFORMAT_BGRA_FLOAT:
-						//							update4f( i ); break;
-						default:
-							throw CVTException( "Unimplemented" );
-					}
-					break;
-				}
-		}
-		normalize();
+		return _two[ y ];
 	}
+
 	template<typename T>
-	inline void IMI<T>::clear()
+	inline T IMI<T>::operator()() const
 	{
-		size_t size = ( _size + 1 ) * ( _size + 1 );
-			for( size_t i = 0; i < size; i++ )
-				_hist[ i ] = 0;
+		size_t stride = _size + 1;
+		T ret = 0;
+		for( size_t y = 0; y < stride; y++ ) {
+			for( size_t x = 0; x < stride; x++ ) {
+				T p = _joint[ y * stride + x ];
+				if( p > 0 )
+					ret += p * Math::log( p / ( _one[ x ] * _two[ y ] ) );
+			}
+		}
+		return ret;
 	}
 
 	template<typename T>
-	inline void IMI<T>::normalize()
+	inline void IMI<T>::update( const Image& one, const Image& two, IHistogramType type )
 	{
-		size_t size = ( _size + 1 ) * ( _size + 1 );
-			T sum = 0;
-			for( size_t i = 0; i < size; i++ )
-				sum += _hist[ i ];
-			sum = 1 / sum;
-			for( size_t i = 0; i < size; i++ )
-				_hist[ i ] *= sum;
+		size_t stride = _size + 1;
+
+		IHistogramKernel::jointHistogram( &_joint[ 0 ], _size, one, two, type );
+		_type = type;
+		_samples = one.width() * one.height();
+
+		T norm = _samples ? ( ( T ) 1 ) / ( T ) _samples : 0;
+		for( size_t i = 0; i < stride; i++ ) {
+			_one[ i ] = 0;
+			_two[ i ] = 0;
+		}
+		for( size_t y = 0; y < stride; y++ ) {
+			for( size_t x = 0; x < stride; x++ ) {
+				T p = _joint[ y * stride + x ] * norm;
+				_joint[ y * stride + x ] = p;
+				_one[ x ] += p;
+				_two[ y ] += p;
+			}
+		}
 	}
 
+	/**
+	  \brief Derivative of the mutual information with respect to the values of two, UINT8 values scaled to [ 0, 1 ].
+
+	  With the first image fixed, dMI/dv = sum_xy dp( x, y )/dv * log( p( x, y ) / p2( y ) ).
+	  dst must be evaluated for the images of the last update().
+	 */
 	template<typename T>
-	inline void IMI<T>::updateBSpline1f( const Image& ione, const Image& itwo )
+	inline void IMI<T>::derivative( Image& dst, const Image& one, const Image& two ) const
 	{
-		size_t stride;
-		size_t tstride;
-		const float* ptr = ione.map<float>( &stride );
-		const float* tptr = itwo.map<float>( &tstride );
-		size_t w, h;
-		float sum = 0;
-
-		w = itwo.width();
-		h = itwo.height();
-
-		const float* pi = ptr;
-		const float* pit = tptr;
-
-		while( h-- ) {
-			size_t n = w;
-			const float* pval = pi;
-			const float* ptval = pit;
-			while( n-- ) {
-				float r, t;
-				t = *pval * ( _size - 3 ) + 1.0f;
-				r = *ptval * ( _size - 3 ) + 1.0f;
-				int tidx = ( int ) t;
-				int ridx = ( int ) r;
-				for( int m = -1; m <= 2; m++ ) {
-					for( int o = -1; o <= 2; o++ ) {
-						float val = BSplinef::eval( -t + ( float ) ( tidx + o ) )
-							* BSplinef::eval( -r + ( float ) ( ridx + m ) );
-						_hist[ ( ridx + m ) *  ( _size + 1 ) + ( tidx + o ) ] += val;
-						sum += val;
-					}
-				}
+		if( _type != IHISTOGRAM_BSPLINE )
+			throw CVTException( "Derivative needs a B-spline histogram" );
+		if( one.width() * one.height() != _samples )
+			throw CVTException( "Derivative needs the images of the last update" );
+
+		size_t stride = _size + 1;
+		std::vector<float> table( stride * stride, 0.0f );
+		T norm = _samples ? ( ( T ) 1 ) / ( T ) _samples : 0;
+		for( size_t y = 0; y < stride; y++ ) {
+			for( size_t x = 0; x < stride; x++ ) {
+				T p = _joint[ y * stride + x ];
+				if( p > 0 )
+					table[ y * stride + x ] = ( float ) ( Math::log( p / _two[ y ] ) * norm );
 			}
-			pi += stride;
-			pit += tstride;
 		}
-
-		ione.unmap( ptr );
-		itwo.unmap( tptr );
+		IHistogramKernel::jointDerivative( dst, &table[ 0 ], _size, one, two );
 	}
 
 	typedef IMI<float> IMIf;
 	typedef IMI<double> IMId;
 }
-}
 
 #endif
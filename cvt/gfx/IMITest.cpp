@@ -0,0 +1,203 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/IHistogram.h>
+#include <cvt/gfx/IMI.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/BSpline.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/CVTTest.h>
+
+#include <vector>
+
+namespace cvt {
+
+	static void _imiRandom( Image& img, size_t w, size_t h, const IFormat& format )
+	{
+		img.reallocate( w, h, format );
+		IMapScoped<uint8_t> map( img );
+		size_t n = w * format.channels;
+		for( size_t y = 0; y < h; y++ ) {
+			if( format.type == IFORMAT_TYPE_FLOAT ) {
+				float* ptr = ( float* ) map.ptr();
+				for( size_t x = 0; x < n; x++ )
+					ptr[ x ] = Math::rand( 0.0f, 1.0f );
+			} else {
+				uint8_t* ptr = map.ptr();
+				for( size_t x = 0; x < n; x++ )
+					ptr[ x ] = ( uint8_t ) Math::rand( 0.0f, 255.99f );
+			}
+			map++;
+		}
+	}
+
+	/* scalar B-spline reference histogram */
+	static void _imiReferenceHistogram( std::vector<double>& hist, size_t bins, const Image& img )
+	{
+		size_t channels = img.format().channels;
+		double scale = img.format().type == IFORMAT_TYPE_FLOAT ? 1.0 : 1.0 / 255.0;
+		hist.assign( ( bins + 1 ) * channels, 0.0 );
+		IMapScoped<const uint8_t> map( img );
+		for( size_t y = 0; y < img.height(); y++ ) {
+			for( size_t i = 0; i < img.width() * channels; i++ ) {
+				double v = img.format().type == IFORMAT_TYPE_FLOAT ? ( ( const float* ) map.ptr() )[ i ] : map.ptr()[ i ];
+				double t = v * scale * ( bins - 3 ) + 1.0;
+				int idx = ( int ) t;
+				for( int o = -1; o <= 2; o++ )
+					hist[ ( i % channels ) * ( bins + 1 ) + idx + o ] += BSpline<double>::eval( -t + ( double ) ( idx + o ) );
+			}
+			map++;
+		}
+	}
+
+	template<typename T>
+	static bool _imiCheckHistogram( size_t bins, const Image& img, double tolerance = 1e-4 )
+	{
+		std::vector<double> ref;
+		_imiReferenceHistogram( ref, bins, img );
+		std::vector<T> hist( ref.size() );
+		IHistogramKernel::histogram( &hist[ 0 ], bins, img, IHISTOGRAM_BSPLINE );
+		for( size_t i = 0; i < ref.size(); i++ ) {
+			if( Math::abs( hist[ i ] - ref[ i ] ) > tolerance * ( 1.0 + ref[ i ] ) )
+				return false;
+		}
+		return true;
+	}
+
+	BEGIN_CVTTEST( IMI )
+		bool result = true;
+		bool b;
+
+		Math::srand( 42 );
+
+		Image gray8, grayf, rgbaf, bgra8;
+		_imiRandom( gray8, 97, 75, IFormat::GRAY_UINT8 );
+		_imiRandom( grayf, 97, 75, IFormat::GRAY_FLOAT );
+		_imiRandom( rgbaf, 61, 43, IFormat::RGBA_FLOAT );
+		_imiRandom( bgra8, 61, 43, IFormat::BGRA_UINT8 );
+
+		b = _imiCheckHistogram<float>( 32, gray8 ) && _imiCheckHistogram<float>( 32, grayf )
+			&& _imiCheckHistogram<float>( 16, rgbaf ) && _imiCheckHistogram<float>( 16, bgra8 );
+		CVTTEST_PRINT( "B-spline histogram", b );
+		result &= b;
+
+		{
+			/* accumulated in double, only the float weights limit the precision */
+			Image large;
+			_imiRandom( large, 640, 480, IFormat::GRAY_FLOAT );
+			b = _imiCheckHistogram<double>( 32, large, 1e-6 ) && _imiCheckHistogram<double>( 16, rgbaf, 1e-6 );
+			CVTTEST_PRINT( "B-spline histogram in double precision", b );
+			result &= b;
+		}
+
+		{
+			std::vector<float> hist( 4 * 17 );
+			IHistogramKernel::histogram( &hist[ 0 ], 16, rgbaf, IHISTOGRAM_NOINTERP );
+			b = true;
+			for( size_t c = 0; c < 4; c++ ) {
+				float sum = 0;
+				for( size_t i = 0; i < 17; i++ )
+					sum += hist[ c * 17 + i ];
+				b &= sum == ( float ) ( 61 * 43 );
+			}
+			CVTTEST_PRINT( "Histogram without interpolation", b );
+			result &= b;
+		}
+
+		{
+			Image noise;
+			_imiRandom( noise, 97, 75, IFormat::GRAY_FLOAT );
+			IMId mi( 24 );
+			mi.update( grayf, grayf );
+			double self = mi();
+			double sum = 0;
+			for( size_t y = 0; y < 25; y++ )
+				for( size_t x = 0; x < 25; x++ )
+					sum += mi( x, y );
+			mi.update( grayf, noise );
+			double other = mi();
+			b = self > 10.0 * other && Math::abs( sum - 1.0 ) < 1e-5;
+			CVTTEST_PRINT( "MI of identical and independent images", b );
+			result &= b;
+		}
+
+		{
+			/* compare against central differences on a few pixels */
+			Image one, two;
+			_imiRandom( one, 37, 29, IFormat::GRAY_FLOAT );
+			two.reallocate( one );
+			{
+				IMapScoped<const float> src( one );
+				IMapScoped<float> dst( two );
+				for( size_t y = 0; y < one.height(); y++ ) {
+					for( size_t x = 0; x < one.width(); x++ )
+						dst.ptr()[ x ] = Math::clamp( 0.8f * src.ptr()[ x ] + Math::rand( 0.0f, 0.2f ), 0.0f, 1.0f );
+					src++;
+					dst++;
+				}
+			}
+
+			IMId mi( 16 );
+			mi.update( one, two );
+			Image deriv;
+			mi.derivative( deriv, one, two );
+
+			const double eps = 1e-3;
+			b = true;
+			for( size_t k = 0; k < 20; k++ ) {
+				size_t x = ( k * 7 ) % one.width();
+				size_t y = ( k * 11 ) % one.height();
+				float orig;
+				{
+					IMapScoped<float> map( two );
+					orig = map( x, y );
+					map( x, y ) = orig + eps;
+				}
+				mi.update( one, two );
+				double mip = mi();
+				{
+					IMapScoped<float> map( two );
+					map( x, y ) = orig - eps;
+				}
+				mi.update( one, two );
+				double mim = mi();
+				{
+					IMapScoped<float> map( two );
+					map( x, y ) = orig;
+				}
+				double fd = ( mip - mim ) / ( 2.0 * eps );
+				IMapScoped<const float> map( deriv );
+				double d = map( x, y );
+				if( Math::abs( fd - d ) > 2e-2 * Math::abs( fd ) + 1e-6 ) {
+					CVTTEST_LOG( "pixel " << x << " " << y << ": " << d << " vs " << fd );
+					b = false;
+				}
+			}
+			CVTTEST_PRINT( "MI derivative", b );
+			result &= b;
+		}
+
+		return result;
+	END_CVTTEST
+}
@@ -0,0 +1,285 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/gfx/IRemap.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/Exception.h>
+
+namespace cvt {
+
+	/* bilinear sample of one RGGB color plane, X/Y in 1/32 units of the full resolution mosaic, result scaled by 4096 */
+	static inline int _bayerPlaneSample( const uint8_t* src, size_t stride, int X, int Y, int ox, int oy, int pw, int ph )
+	{
+		int px, py, ax, ay;
+
+		/* plane coordinates in 1/64 units */
+		X = Math::clamp( X - ox * 32, 0, ( pw - 1 ) * 64 );
+		Y = Math::clamp( Y - oy * 32, 0, ( ph - 1 ) * 64 );
+		px = Math::min( X >> 6, pw - 2 );
+		py = Math::min( Y >> 6, ph - 2 );
+		ax = X - px * 64;
+		ay = Y - py * 64;
+
+		const uint8_t* p0 = src + stride * ( 2 * py + oy ) + 2 * px + ox;
+		const uint8_t* p1 = p0 + 2 * stride;
+		int v0 = p0[ 0 ] * ( 64 - ax ) + p0[ 2 ] * ax;
+		int v1 = p1[ 0 ] * ( 64 - ax ) + p1[ 2 ] * ax;
+		return v0 * ( 64 - ay ) + v1 * ay;
+	}
+
+	static void _remapBayerRGGBu8_RGBAu8( uint8_t* dst, const int16_t* xy, const uint16_t* frac, const uint8_t* src, size_t stride,
+										  size_t srcWidth, size_t srcHeight, size_t n )
+	{
+		int pw = ( int ) srcWidth / 2;
+		int ph = ( int ) srcHeight / 2;
+
+		while( n-- ) {
+			uint16_t f = *frac++;
+			if( f & IRemap::INVALID ) {
+				dst[ 0 ] = dst[ 1 ] = dst[ 2 ] = 0;
+				dst[ 3 ] = 0xff;
+				dst += 4;
+				xy += 2;
+				continue;
+			}
+			int X = ( xy[ 0 ] << IRemap::FRAC_BITS ) + ( f & 0x3f );
+			int Y = ( xy[ 1 ] << IRemap::FRAC_BITS ) + ( ( f >> 8 ) & 0x3f );
+			xy += 2;
+
+			int r  = _bayerPlaneSample( src, stride, X, Y, 0, 0, pw, ph );
+			int g  = _bayerPlaneSample( src, stride, X, Y, 1, 0, pw, ph );
+			g     += _bayerPlaneSample( src, stride, X, Y, 0, 1, pw, ph );
+			int b  = _bayerPlaneSample( src, stride, X, Y, 1, 1, pw, ph );
+
+			dst[ 0 ] = ( uint8_t ) ( ( r + 2048 ) >> 12 );
+			dst[ 1 ] = ( uint8_t ) ( ( g + 4096 ) >> 13 );
+			dst[ 2 ] = ( uint8_t ) ( ( b + 2048 ) >> 12 );
+			dst[ 3 ] = 0xff;
+			dst += 4;
+		}
+	}
+
+	class IRemap::RemapBody
+	{
+		public:
+			RemapBody( const IRemap& map, uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, IFormatID format ) :
+				_map( map ),
+				_dst( dst ),
+				_dstride( dstride ),
+				_src( src ),
+				_sstride( sstride ),
+				_format( format ),
+				_simd( SIMD::instance() )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				size_t ntx = ( _map._width + TILE_WIDTH - 1 ) / TILE_WIDTH;
+
+				for( size_t t = begin; t < end; t++ ) {
+					size_t tx = t % ntx;
+					size_t ty = t / ntx;
+					size_t x0 = tx * TILE_WIDTH;
+					size_t y0 = ty * TILE_HEIGHT;
+					size_t tw = Math::min<size_t>( TILE_WIDTH, _map._width - x0 );
+					size_t th = Math::min<size_t>( TILE_HEIGHT, _map._height - y0 );
+					size_t off = _map.tileOffset( tx, ty );
+
+					for( size_t y = 0; y < th; y++, off += tw ) {
+						uint8_t* dst = _dst + _dstride * ( y0 + y );
+						const int16_t* xy = &_map._xy[ 2 * off ];
+						const uint16_t* frac = &_map._frac[ off ];
+						remapLine( dst, x0, xy, frac, tw );
+					}
+				}
+			}
+
+		private:
+			void remapLine( uint8_t* dst, size_t x0, const int16_t* xy, const uint16_t* frac, size_t n ) const
+			{
+				static const float blackf[ ] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+				switch( _format ) {
+					case IFORMAT_GRAY_UINT8:
+						_simd->remapBilinear1u8( dst + x0, xy, frac, _src, _sstride, 0, n );
+						break;
+					case IFORMAT_GRAY_FLOAT:
+						_simd->remapBilinear1f( ( float* ) dst + x0, xy, frac, ( const float* ) _src, _sstride, 0.0f, n );
+						break;
+					case IFORMAT_RGBA_UINT8:
+					case IFORMAT_BGRA_UINT8:
+						_simd->remapBilinear4u8( dst + 4 * x0, xy, frac, _src, _sstride, 0xff000000, n );
+						break;
+					case IFORMAT_RGBA_FLOAT:
+					case IFORMAT_BGRA_FLOAT:
+						_simd->remapBilinear4f( ( float* ) dst + 4 * x0, xy, frac, ( const float* ) _src, _sstride, blackf, n );
+						break;
+					case IFORMAT_BAYER_RGGB_UINT8:
+						_remapBayerRGGBu8_RGBAu8( dst + 4 * x0, xy, frac, _src, _sstride, _map._srcWidth, _map._srcHeight, n );
+						break;
+					default:
+						break;
+				}
+			}
+
+			const IRemap&	_map;
+			uint8_t*		_dst;
+			size_t			_dstride;
+			const uint8_t*	_src;
+			size_t			_sstride;
+			IFormatID		_format;
+			SIMD*			_simd;
+	};
+
+	IRemap::IRemap() :
+		_width( 0 ),
+		_height( 0 ),
+		_srcWidth( 0 ),
+		_srcHeight( 0 )
+	{
+	}
+
+	IRemap::IRemap( const Image& warp, size_t srcWidth, size_t srcHeight, bool halfsize ) :
+		_width( 0 ),
+		_height( 0 ),
+		_srcWidth( 0 ),
+		_srcHeight( 0 )
+	{
+		update( warp, srcWidth, srcHeight, halfsize );
+	}
+
+	void IRemap::update( const Image& warp, size_t srcWidth, size_t srcHeight, bool halfsize )
+	{
+		if( warp.format() != IFormat::GRAYALPHA_FLOAT )
+			throw CVTException( "Unsupported warp image type" );
+		if( srcWidth < 2 || srcHeight < 2 || srcWidth > 0x7fff || srcHeight > 0x7fff )
+			throw CVTException( "Unsupported source image size for remap table" );
+
+		_srcWidth  = srcWidth;
+		_srcHeight = srcHeight;
+		_width	   = halfsize ? warp.width() / 2 : warp.width();
+		_height    = halfsize ? warp.height() / 2 : warp.height();
+
+		_xy.resize( 2 * _width * _height );
+		_frac.resize( _width * _height );
+
+		IMapScoped<const float> map( warp );
+		size_t ntx = ( _width + TILE_WIDTH - 1 ) / TILE_WIDTH;
+		size_t nty = ( _height + TILE_HEIGHT - 1 ) / TILE_HEIGHT;
+
+		for( size_t ty = 0; ty < nty; ty++ ) {
+			for( size_t tx = 0; tx < ntx; tx++ ) {
+				size_t x0 = tx * TILE_WIDTH;
+				size_t y0 = ty * TILE_HEIGHT;
+				size_t tw = Math::min<size_t>( TILE_WIDTH, _width - x0 );
+				size_t th = Math::min<size_t>( TILE_HEIGHT, _height - y0 );
+				size_t idx = tileOffset( tx, ty );
+
+				for( size_t y = y0; y < y0 + th; y++ ) {
+					for( size_t x = x0; x < x0 + tw; x++ ) {
+						if( halfsize ) {
+							/* the center of the 2x2 block */
+							const float* p0 = map.line( 2 * y ) + 4 * x;
+							const float* p1 = map.line( 2 * y + 1 ) + 4 * x;
+							setEntry( idx++, 0.25f * ( p0[ 0 ] + p0[ 2 ] + p1[ 0 ] + p1[ 2 ] ),
+											 0.25f * ( p0[ 1 ] + p0[ 3 ] + p1[ 1 ] + p1[ 3 ] ) );
+						} else {
+							const float* p = map.line( y ) + 2 * x;
+							setEntry( idx++, p[ 0 ], p[ 1 ] );
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void IRemap::apply( Image& dst, const Image& src ) const
+	{
+		if( isEmpty() )
+			throw CVTException( "Remap table not initialized" );
+		if( src.width() != _srcWidth || src.height() != _srcHeight )
+			throw CVTException( "Source image size does not match remap table" );
+
+		switch( src.format().formatID ) {
+			case IFORMAT_GRAY_UINT8:
+			case IFORMAT_GRAY_FLOAT:
+			case IFORMAT_RGBA_UINT8:
+			case IFORMAT_BGRA_UINT8:
+			case IFORMAT_RGBA_FLOAT:
+			case IFORMAT_BGRA_FLOAT:
+				dst.reallocate( _width, _height, src.format() );
+				break;
+			case IFORMAT_BAYER_RGGB_UINT8:
+				if( ( _srcWidth & 1 ) || ( _srcHeight & 1 ) || _srcWidth < 4 || _srcHeight < 4 )
+					throw CVTException( "Bayer image size not supported for remapping" );
+				dst.reallocate( _width, _height, IFormat::RGBA_UINT8 );
+				break;
+			default:
+				throw CVTException( "Unsupported image format!" );
+		}
+
+		IMapScoped<uint8_t> dmap( dst );
+		IMapScoped<const uint8_t> smap( src );
+
+		size_t ntiles = ( ( _width + TILE_WIDTH - 1 ) / TILE_WIDTH ) * ( ( _height + TILE_HEIGHT - 1 ) / TILE_HEIGHT );
+		RemapBody body( *this, dmap.base(), dmap.stride(), smap.base(), smap.stride(), src.format().formatID );
+		parallelFor( 0, ntiles, body );
+	}
+
+	void IRemap::setEntry( size_t idx, float x, float y )
+	{
+		int16_t* xy = &_xy[ 2 * idx ];
+
+		/* also rejects NaN coordinates */
+		if( !( x >= -0.5f && y >= -0.5f && x <= ( float ) _srcWidth - 0.5f && y <= ( float ) _srcHeight - 0.5f ) ) {
+			xy[ 0 ] = xy[ 1 ] = 0;
+			_frac[ idx ] = INVALID;
+			return;
+		}
+
+		const float scale = ( float ) ( 1 << FRAC_BITS );
+		int X = ( int ) ( Math::clamp<float>( x, 0.0f, ( float ) ( _srcWidth - 1 ) ) * scale + 0.5f );
+		int Y = ( int ) ( Math::clamp<float>( y, 0.0f, ( float ) ( _srcHeight - 1 ) ) * scale + 0.5f );
+
+		/* keep the bilinear footprint inside the image, the fraction then reaches 1 */
+		int ix = Math::min( X >> FRAC_BITS, ( int ) _srcWidth - 2 );
+		int iy = Math::min( Y >> FRAC_BITS, ( int ) _srcHeight - 2 );
+		xy[ 0 ] = ( int16_t ) ix;
+		xy[ 1 ] = ( int16_t ) iy;
+		_frac[ idx ] = ( uint16_t ) ( ( X - ( ix << FRAC_BITS ) ) | ( ( Y - ( iy << FRAC_BITS ) ) << 8 ) );
+	}
+
+	size_t IRemap::tileOffset( size_t tx, size_t ty ) const
+	{
+		/* tiles of a band are stored one after another, rows inside a tile are packed */
+		size_t th = Math::min<size_t>( TILE_HEIGHT, _height - ty * TILE_HEIGHT );
+		return ty * TILE_HEIGHT * _width + tx * TILE_WIDTH * th;
+	}
+
+}
@@ -0,0 +1,89 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_IREMAP_H
+#define CVT_IREMAP_H
+
+#include <cvt/gfx/Image.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/**
+	  \brief Precomputed fixed-point remap table
+
+	  Compact replacement for a GRAYALPHA_FLOAT warp image as used by IWarp.
+	  Every destination pixel stores the integer source position as two int16
+	  values and the bilinear weights as 5-bit fractions ( 6 bytes instead of 8 ).
+	  Pixels mapping outside of the source image are flagged and set to the
+	  fill value. The table is stored in tiles of TILE_WIDTH x TILE_HEIGHT
+	  destination pixels, so neighbouring output pixels also access nearby
+	  source memory, and tiles are processed in parallel.
+
+	  A table built with halfsize set produces an output of half the warp
+	  resolution, sampling the source at the center of each 2x2 block.
+
+	  In addition to the gray/RGBA uint8 and float formats, BAYER_RGGB_UINT8
+	  input is demosaiced while remapping and produces RGBA_UINT8 output.
+	 */
+	class IRemap {
+		public:
+			enum {
+				TILE_WIDTH	= 64,
+				TILE_HEIGHT = 16,
+				FRAC_BITS	= 5,
+				INVALID		= 0x8000
+			};
+
+			IRemap();
+			IRemap( const Image& warp, size_t srcWidth, size_t srcHeight, bool halfsize = false );
+
+			void	update( const Image& warp, size_t srcWidth, size_t srcHeight, bool halfsize = false );
+			void	apply( Image& dst, const Image& src ) const;
+
+			size_t	width() const		{ return _width; }
+			size_t	height() const		{ return _height; }
+			size_t	srcWidth() const	{ return _srcWidth; }
+			size_t	srcHeight() const	{ return _srcHeight; }
+			bool	isEmpty() const		{ return _frac.empty(); }
+
+		private:
+			class RemapBody;
+
+			void	setEntry( size_t idx, float x, float y );
+			size_t	tileOffset( size_t tx, size_t ty ) const;
+
+			size_t					_width;
+			size_t					_height;
+			size_t					_srcWidth;
+			size_t					_srcHeight;
+			std::vector<int16_t>	_xy;
+			std::vector<uint16_t>	_frac;
+	};
+
+}
+
+#endif
@@ -241,21 +241,21 @@ namespace cvt {
 		saver->save( path, *this );
 	}
 
-	void Image::convert( Image& dst, IConvertFlags flags ) const
+	IConvertPath Image::convert( Image& dst, IConvertFlags flags ) const
 	{
-		IConvert::convert( dst, *this, flags );
+		return IConvert::convert( dst, *this, flags );
 	}
 
-	void Image::convert( Image & dst, const IFormat & dstFormat, IConvertFlags flags  ) const
+	IConvertPath Image::convert( Image & dst, const IFormat & dstFormat, IConvertFlags flags  ) const
 	{
 		dst.reallocate( _mem->_width, _mem->_height, dstFormat, dst.memType() );
-		IConvert::convert( dst, *this, flags );
+		return IConvert::convert( dst, *this, flags );
 	}
 
-	void Image::convert( Image& dst, const IFormat & dstformat, IAllocatorType memtype, IConvertFlags flags ) const
+	IConvertPath Image::convert( Image& dst, const IFormat & dstformat, IAllocatorType memtype, IConvertFlags flags ) const
 	{
 		dst.reallocate( _mem->_width, _mem->_height, dstformat, memtype );
-		IConvert::convert( dst, *this, flags );
+		return IConvert::convert( dst, *this, flags );
 	}
 
 	void Image::fill( const Color& c )
@@ -320,6 +320,30 @@ namespace cvt {
 	}
 
 
+    void Image::luma( Image& gray ) const
+    {
+        if( !_mem->_format.isPlanar() || _mem->type() != IALLOCATOR_MEM )
+            throw CVTException( "Image::luma needs a YUV420_PLANAR or NV12 image in memory" );
+        gray.shareMem( *this, IFormat::GRAY_UINT8 );
+    }
+
+    void Image::reference( const Image& img )
+    {
+        if( img._mem->type() != IALLOCATOR_MEM )
+            throw CVTException( "Image::reference needs an image in memory" );
+        if( &img != this )
+            shareMem( img, img._mem->_format );
+    }
+
+    void Image::shareMem( const Image& img, const IFormat& format )
+    {
+        if( _mem->type() != IALLOCATOR_MEM ) {
+            delete _mem;
+            _mem = new ImageAllocatorMem();
+        }
+        ( ( ImageAllocatorMem* ) _mem )->share( *( ( const ImageAllocatorMem* ) img._mem ), img._mem->_width, img._mem->_height, format );
+    }
+
     void Image::canny( Image& dst, float low, float high ) const
     {
         ICanny::detectEdges( dst, *this, low, high );
@@ -93,9 +93,9 @@ namespace cvt {
 			void copyRect( int x, int y, const Image& i, const Recti & roi );
 
 			Image* clone() const;
-			void convert( Image& dst, const IFormat & format, IAllocatorType memtype, IConvertFlags flags = ICONVERT_DEBAYER_LINEAR  ) const;
-			void convert( Image& dst, const IFormat & format, IConvertFlags flags = ICONVERT_DEBAYER_LINEAR  ) const;
-			void convert( Image& dst, IConvertFlags flags = ICONVERT_DEBAYER_LINEAR  ) const;
+			IConvertPath convert( Image& dst, const IFormat & format, IAllocatorType memtype, IConvertFlags flags = ICONVERT_DEBAYER_LINEAR  ) const;
+			IConvertPath convert( Image& dst, const IFormat & format, IConvertFlags flags = ICONVERT_DEBAYER_LINEAR  ) const;
+			IConvertPath convert( Image& dst, IConvertFlags flags = ICONVERT_DEBAYER_LINEAR  ) const;
 			void scale( Image& dst, size_t width, size_t height, const IScaleFilter& filter ) const;
 
 			void load( const String& path, ILoader* loader = NULL );
@@ -137,6 +137,19 @@ namespace cvt {
              */
             void decompose( Image& chan1, Image& chan2 ) const;
 
+            /**
+              @brief GRAY_UINT8 image of the luma plane of a YUV420_PLANAR or NV12 image without copying,
+                     gray references the memory of this image
+             */
+            void luma( Image& gray ) const;
+
+            /**
+              @brief Reference the memory of img instead of copying it. Writes to either image are
+                     visible in both until one of them is assigned or reallocated with a different
+                     size or format. img has to be a memory image.
+             */
+            void reference( const Image& img );
+
 			void dilate( Image& dst, size_t radius ) const;
 			void erode( Image& dst, size_t radius ) const;
 
@@ -176,6 +189,7 @@ namespace cvt {
 			void checkFormatAndSize( const Image & img, const char* func, size_t lineNum ) const;
 
 			void pyrdown1U8( Image& dst ) const;
+			void shareMem( const Image& img, const IFormat& format );
 
 			ImageAllocator* _mem;
 	};
@@ -50,6 +50,10 @@ namespace cvt {
 			_stride = stride;
 		}
 
+		/* the I420 chroma planes use half the stride, NV12 stores pairs of chroma samples */
+		if( _format.isPlanar() && ( ( _stride & 1 ) || _stride < 2 * ( ( _width + 1 ) / 2 ) ) )
+			throw CVTException( "Planar images need an even stride covering the chroma samples" );
+
 		_mem = NULL;
 		_data = data;
 		_refcnt = new size_t;
@@ -59,7 +63,8 @@ namespace cvt {
 
 	void ImageAllocatorMem::alloc( size_t width, size_t height, const IFormat & format )
 	{
-		if( _width == width && _height == height && _format == format )
+		/* memory shared with other images is never reused for new content */
+		if( _width == width && _height == height && _format == format && _refcnt && *_refcnt == 1 )
 			return;
 
 		release();
@@ -67,38 +72,67 @@ namespace cvt {
 		_height = height;
 		_format = format;
 		_stride = Math::pad16( _width * _format.bpp );
-		_mem = new uint8_t[ _stride * _height + 16 ];
+		_mem = new uint8_t[ _stride * _format.bufferRows( _height ) + 16 ];
 		_data = Util::alignPtr( _mem, 16 );
 		_refcnt = new size_t;
 		*_refcnt = 0;
 		retain();
 	}
 
+	void ImageAllocatorMem::share( const ImageAllocatorMem& x, size_t width, size_t height, const IFormat & format )
+	{
+		if( &x == this )
+			return;
+		x.retain();
+		release();
+		_width = width;
+		_height = height;
+		_format = format;
+		_stride = x._stride;
+		_mem = x._mem;
+		_data = x._data;
+		_refcnt = x._refcnt;
+	}
+
+	static inline void _copyRows( uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, size_t n, size_t rows )
+	{
+		SIMD* simd = SIMD::instance();
+		while( rows-- ) {
+			simd->Memcpy( dst, src, n );
+			dst += dstride;
+			src += sstride;
+		}
+	}
+
 	void ImageAllocatorMem::copy( const ImageAllocator* x, const Recti* r = NULL )
 	{
 		const uint8_t* src;
 		const uint8_t* osrc;
-		uint8_t* dst;
 		size_t sstride;
-		size_t i, n;
 		Recti rect( 0, 0, ( int ) x->_width, ( int ) x->_height );
-		SIMD* simd = SIMD::instance();
 
 		if( r )
 			rect.intersect( *r );
 
+		if( x->_format.isPlanar() && ( rect.x || rect.y || rect.width != ( int ) x->_width || rect.height != ( int ) x->_height ) )
+			throw CVTException( "Copying a region of a planar image is not supported" );
+
 		alloc( rect.width, rect.height, x->_format );
 
 		osrc = src = x->map( &sstride );
 		src += rect.y * sstride + x->_format.bpp * rect.x;
-		dst = _data;
-		n =  _format.bpp * rect.width;
-
-		i = rect.height;
-		while( i-- ) {
-			simd->Memcpy( dst, src, n );
-			dst += _stride;
-			src += sstride;
+		_copyRows( _data, _stride, src, sstride, _format.bpp * rect.width, rect.height );
+
+		/* chroma planes below the luma rows */
+		size_t cw = ( _width + 1 ) / 2;
+		size_t ch = ( _height + 1 ) / 2;
+		const uint8_t* csrc = src + _height * sstride;
+		uint8_t* cdst = _data + _height * _stride;
+		if( _format == IFormat::YUV420_PLANAR_UINT8 ) {
+			_copyRows( cdst, _stride / 2, csrc, sstride / 2, cw, ch );
+			_copyRows( cdst + ch * ( _stride / 2 ), _stride / 2, csrc + ch * ( sstride / 2 ), sstride / 2, cw, ch );
+		} else if( _format == IFormat::NV12_UINT8 ) {
+			_copyRows( cdst, _stride, csrc, sstride, 2 * cw, ch );
 		}
 		x->unmap( osrc );
 	}
@@ -115,7 +149,7 @@ namespace cvt {
 		}
 	}
 
-	void ImageAllocatorMem::retain()
+	void ImageAllocatorMem::retain() const
 	{
 		if( _refcnt ) {
 			*_refcnt += 1;
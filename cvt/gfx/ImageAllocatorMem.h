@@ -33,6 +33,8 @@ namespace cvt {
 			~ImageAllocatorMem();
 			virtual void alloc( size_t width, size_t height, const IFormat & format );
 			void alloc( size_t width, size_t height, const IFormat & format, uint8_t* data, size_t stride = 0 );
+			/* reference the memory of x, starting at its first row, instead of allocating */
+			void share( const ImageAllocatorMem& x, size_t width, size_t height, const IFormat & format );
 			virtual void copy( const ImageAllocator* x, const Recti* r );
 			virtual uint8_t* map( size_t* stride ) { *stride = _stride; return _data; };
 			virtual const uint8_t* map( size_t* stride ) const { *stride = _stride; return _data; };
@@ -41,7 +43,7 @@ namespace cvt {
 
 		private:
 			ImageAllocatorMem( const ImageAllocatorMem& );
-			void retain();
+			void retain() const;
 			void release();
 
 		private:
@@ -23,10 +23,13 @@
 */
 
 #include <cvt/gfx/Image.h>
+#include <cvt/gfx/IMapScoped.h>
 #include <cvt/util/CVTTest.h>
 #include <cvt/io/Resources.h>
 #include <cvt/util/SIMD.h>
 #include <cvt/util/Time.h>
+#include <cvt/util/ThreadPool.h>
+#include <cstring>
 
 namespace cvt {
 
@@ -67,6 +70,312 @@ namespace cvt {
 	}
 
 
+	static inline uint32_t _yuvToRGBA( int y, int u, int v )
+	{
+		u -= 128;
+		v -= 128;
+		y = ( ( y - 16 ) * 1192 ) >> 10;
+		uint32_t r = Math::clamp( y + ( ( v * 1634 ) >> 10 ), 0, 255 );
+		uint32_t g = Math::clamp( y - ( ( u * 401 + v * 832 ) >> 10 ), 0, 255 );
+		uint32_t b = Math::clamp( y + ( ( u * 2066 ) >> 10 ), 0, 255 );
+		return 0xff000000 | ( b << 16 ) | ( g << 8 ) | r;
+	}
+
+	static bool _planarTest( size_t w, size_t h )
+	{
+		bool result = true;
+		size_t cw = ( w + 1 ) / 2;
+		size_t ch = ( h + 1 ) / 2;
+		size_t istride, nstride;
+
+		Image i420( w, h, IFormat::YUV420_PLANAR_UINT8 );
+		Image nv12( w, h, IFormat::NV12_UINT8 );
+		uint8_t* pi = i420.map( &istride );
+		uint8_t* pn = nv12.map( &nstride );
+		uint8_t* pu = pi + h * istride;
+		uint8_t* pv = pu + ch * ( istride / 2 );
+		uint8_t* puv = pn + h * nstride;
+		for( size_t y = 0; y < h; y++ ) {
+			for( size_t x = 0; x < w; x++ )
+				pi[ y * istride + x ] = pn[ y * nstride + x ] = ( uint8_t ) Math::rand( 0, 255 );
+		}
+		for( size_t y = 0; y < ch; y++ ) {
+			for( size_t x = 0; x < cw; x++ ) {
+				pu[ y * ( istride / 2 ) + x ] = puv[ y * nstride + 2 * x ] = ( uint8_t ) Math::rand( 0, 255 );
+				pv[ y * ( istride / 2 ) + x ] = puv[ y * nstride + 2 * x + 1 ] = ( uint8_t ) Math::rand( 0, 255 );
+			}
+		}
+
+		Image rgba, nrgba, gray;
+		i420.convert( rgba, IFormat::RGBA_UINT8 );
+		nv12.convert( nrgba, IFormat::RGBA_UINT8 );
+		i420.luma( gray );
+
+		IMapScoped<const uint32_t> mrgba( rgba );
+		IMapScoped<const uint32_t> mnrgba( nrgba );
+		bool conv = true, same = true;
+		for( size_t y = 0; y < h; y++ ) {
+			for( size_t x = 0; x < w; x++ ) {
+				uint32_t exp = _yuvToRGBA( pi[ y * istride + x ], pu[ ( y / 2 ) * ( istride / 2 ) + x / 2 ], pv[ ( y / 2 ) * ( istride / 2 ) + x / 2 ] );
+				conv &= ( mrgba( x, y ) == exp );
+				same &= ( mnrgba( x, y ) == exp );
+			}
+		}
+		CVTTEST_PRINT( "YUV420_PLANAR -> RGBA", conv );
+		CVTTEST_PRINT( "NV12 -> RGBA", same );
+		result &= conv && same;
+
+		/* the luma view shares the buffer of the planar image */
+		bool lumaok = gray.format() == IFormat::GRAY_UINT8 && gray.width() == w && gray.height() == h;
+		{
+			size_t gstride;
+			const uint8_t* pg = gray.map( &gstride );
+			lumaok &= ( pg == pi ) && ( gstride == istride );
+			gray.unmap( pg );
+		}
+		CVTTEST_PRINT( "luma view without copy", lumaok );
+		result &= lumaok;
+
+		/* copies include the chroma planes */
+		Image icopy( i420 );
+		Image ncopy( nv12 );
+		bool copyok = true;
+		{
+			size_t cstride;
+			const uint8_t* pc = icopy.map( &cstride );
+			const uint8_t* pcu = pc + h * cstride;
+			const uint8_t* pcv = pcu + ch * ( cstride / 2 );
+			for( size_t y = 0; y < ch; y++ ) {
+				copyok &= !memcmp( pcu + y * ( cstride / 2 ), pu + y * ( istride / 2 ), cw );
+				copyok &= !memcmp( pcv + y * ( cstride / 2 ), pv + y * ( istride / 2 ), cw );
+			}
+			icopy.unmap( pc );
+			pc = ncopy.map( &cstride );
+			for( size_t y = 0; y < ch; y++ )
+				copyok &= !memcmp( pc + ( h + y ) * cstride, puv + y * nstride, 2 * cw );
+			ncopy.unmap( pc );
+		}
+		CVTTEST_PRINT( "planar copy", copyok );
+		result &= copyok;
+
+		i420.unmap( pi );
+
+		/* the view keeps the data alive, the NV12 image holds the same luma */
+		i420.reallocate( 1, 1, IFormat::RGBA_UINT8 );
+		bool alive = true;
+		{
+			IMapScoped<const uint8_t> mgray( gray );
+			for( size_t y = 0; y < h; y++ )
+				alive &= !memcmp( mgray.line( y ), pn + y * nstride, w );
+		}
+		nv12.unmap( pn );
+		CVTTEST_PRINT( "luma view outlives source", alive );
+		result &= alive;
+
+		return result;
+	}
+
+	static bool _halfFormatTest()
+	{
+		Image x( 13, 7, IFormat::RGBA_FLOAT );
+		Image h, y;
+		{
+			IMapScoped<float> map( x );
+			for( size_t r = 0; r < x.height(); r++ ) {
+				float* p = map.ptr();
+				for( size_t c = 0; c < x.width() * 4; c++ )
+					p[ c ] = ( float ) ( ( r * 52 + c ) % 64 ) / 32.0f;
+				map++;
+			}
+		}
+		x.convert( h, IFormat::RGBA_HALF );
+		h.convert( y, IFormat::RGBA_FLOAT );
+
+		IMapScoped<const float> mx( x );
+		IMapScoped<const float> my( y );
+		bool b = true;
+		for( size_t r = 0; r < x.height(); r++ ) {
+			b &= !memcmp( mx.ptr(), my.ptr(), sizeof( float ) * 4 * x.width() );
+			mx++;
+			my++;
+		}
+		return b;
+	}
+
+	static void _randomFill( Image& img )
+	{
+		IMapScoped<uint8_t> map( img );
+		for( size_t y = 0; y < img.height(); y++ ) {
+			uint8_t* p = map.ptr();
+			for( size_t x = 0; x < img.width() * img.format().bpp; x++ )
+				p[ x ] = ( uint8_t ) Math::rand( 0, 255 );
+			map++;
+		}
+	}
+
+	/* k x k box average of a GRAY_UINT8 or GRAY_FLOAT image at the block ( x, y ) */
+	static float _boxAverage( const Image& img, size_t x, size_t y, size_t k )
+	{
+		IMapScoped<const uint8_t> map( img );
+		float sum = 0.0f;
+		for( size_t j = 0; j < k; j++ ) {
+			map.setLine( y * k + j );
+			for( size_t i = 0; i < k; i++ ) {
+				if( img.format() == IFormat::GRAY_UINT8 )
+					sum += map.ptr()[ x * k + i ];
+				else
+					sum += ( ( const float* ) map.ptr() )[ x * k + i ];
+			}
+		}
+		return sum / ( float ) ( k * k );
+	}
+
+	/* conversions inside a parallel loop run serially and have to report it */
+	class ConvertNestedBody {
+		public:
+			ConvertNestedBody( const Image& src, IConvertPath* paths ) : _src( src ), _paths( paths ) {}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				for( size_t i = begin; i < end; i++ ) {
+					Image dst;
+					_paths[ i ] = _src.convert( dst, IFormat::GRAY_FLOAT );
+				}
+			}
+
+		private:
+			const Image&	_src;
+			IConvertPath*	_paths;
+	};
+
+	static bool _convertPathTest()
+	{
+		bool result = true;
+		size_t w = 320, h = 243;
+
+		Image bayer( w, h, IFormat::BAYER_RGGB_UINT8 );
+		_randomFill( bayer );
+
+		/* fused debayer to float is the same as the chain through GRAY_UINT8 */
+		Image gray, grayf, fused;
+		bayer.convert( gray, IFormat::GRAY_UINT8 );
+		gray.convert( grayf, IFormat::GRAY_FLOAT );
+		IConvertPath path = bayer.convert( fused, IFormat::GRAY_FLOAT );
+		bool b = path == ICONVERT_PATH_SERIAL || path == ICONVERT_PATH_PARALLEL;
+		{
+			IMapScoped<const float> m0( grayf );
+			IMapScoped<const float> m1( fused );
+			for( size_t y = 0; y < h; y++ ) {
+				b &= !memcmp( m0.ptr(), m1.ptr(), sizeof( float ) * w );
+				m0++;
+				m1++;
+			}
+		}
+		CVTTEST_PRINT( "BAYER_RGGB -> GRAY_FLOAT", b );
+		result &= b;
+
+		/* GBRG is RGGB without the first row */
+		Image gbrg( w, h - 1, IFormat::BAYER_GBRG_UINT8 );
+		{
+			IMapScoped<const uint8_t> ms( bayer );
+			IMapScoped<uint8_t> md( gbrg );
+			ms++;
+			for( size_t y = 0; y < h - 1; y++ ) {
+				memcpy( md.ptr(), ms.ptr(), w );
+				ms++;
+				md++;
+			}
+		}
+		Image ggray, grgba, rgba;
+		gbrg.convert( ggray, IFormat::GRAY_UINT8 );
+		gbrg.convert( grgba, IFormat::RGBA_UINT8 );
+		bayer.convert( rgba, IFormat::RGBA_UINT8 );
+		b = true;
+		{
+			IMapScoped<const uint8_t> m0( gray );
+			IMapScoped<const uint8_t> m1( ggray );
+			IMapScoped<const uint8_t> m2( rgba );
+			IMapScoped<const uint8_t> m3( grgba );
+			for( size_t y = 1; y + 2 < h; y++ ) {
+				m0.setLine( y + 1 );
+				m1.setLine( y );
+				m2.setLine( y + 1 );
+				m3.setLine( y );
+				b &= !memcmp( m0.ptr(), m1.ptr(), w );
+				b &= !memcmp( m2.ptr(), m3.ptr(), w * 4 );
+			}
+		}
+		CVTTEST_PRINT( "BAYER_GBRG == shifted BAYER_RGGB", b );
+		result &= b;
+
+		/* fused convert and downscale, the size is divisible by 2 and 3 */
+		w = 318;
+		h = 240;
+		Image yuyv( w, h, IFormat::YUYV_UINT8 );
+		_randomFill( yuyv );
+		Image ygray, ygrayf;
+		yuyv.convert( ygray, IFormat::GRAY_UINT8 );
+		yuyv.convert( ygrayf, IFormat::GRAY_FLOAT );
+		for( size_t k = 2; k <= 3; k++ ) {
+			Image small( w / k, h / k, IFormat::GRAY_UINT8 );
+			Image smallf( w / k, h / k, IFormat::GRAY_FLOAT );
+			b = IConvert::convertScaled( small, yuyv ) == ICONVERT_PATH_FUSED;
+			b &= IConvert::convertScaled( smallf, yuyv ) == ICONVERT_PATH_FUSED;
+			IMapScoped<const uint8_t> m0( small );
+			IMapScoped<const float> m1( smallf );
+			for( size_t y = 0; y < small.height(); y++ ) {
+				for( size_t x = 0; x < small.width(); x++ ) {
+					b &= m0.ptr()[ x ] == ( uint8_t ) ( _boxAverage( ygray, x, y, k ) + 0.5f );
+					b &= Math::abs( m1.ptr()[ x ] - _boxAverage( ygrayf, x, y, k ) ) < 1e-5f;
+				}
+				m0++;
+				m1++;
+			}
+			CVTTEST_PRINT( "YUYV -> GRAY convert and downscale", b );
+			result &= b;
+		}
+
+		Image odd( w / 2 + 1, h / 2, IFormat::GRAY_FLOAT );
+		b = IConvert::convertScaled( odd, yuyv ) == ICONVERT_PATH_CHAINED;
+		b &= odd.width() == w / 2 + 1 && odd.height() == h / 2 && odd.format() == IFormat::GRAY_FLOAT;
+		Image same( w, h, IFormat::YUYV_UINT8 );
+		b &= IConvert::convert( same, yuyv ) == ICONVERT_PATH_COPY;
+		CVTTEST_PRINT( "conversion paths", b );
+		result &= b;
+
+		/* a non-integer ratio has to cover the whole source, the fused box filter would crop it */
+		Image ramp( 1920, 1080, IFormat::GRAY_UINT8 );
+		{
+			IMapScoped<uint8_t> m( ramp );
+			for( size_t y = 0; y < ramp.height(); y++ ) {
+				for( size_t x = 0; x < ramp.width(); x++ )
+					m.ptr()[ x ] = ( uint8_t ) ( x * 255 / ( ramp.width() - 1 ) );
+				m++;
+			}
+		}
+		Image rampf( 800, 450, IFormat::GRAY_FLOAT );
+		b = IConvert::convertScaled( rampf, ramp ) == ICONVERT_PATH_CHAINED;
+		{
+			IMapScoped<const float> m( rampf );
+			for( size_t y = 0; y < rampf.height(); y++ ) {
+				b &= m.ptr()[ 0 ] < 0.02f && m.ptr()[ rampf.width() - 1 ] > 0.98f;
+				m++;
+			}
+		}
+		CVTTEST_PRINT( "1920x1080 -> 800x450 covers the source", b );
+		result &= b;
+
+		IConvertPath nested[ 4 ];
+		parallelFor( 0, 4, ConvertNestedBody( ramp, nested ), 1 );
+		b = true;
+		for( size_t i = 0; i < 4; i++ )
+			b &= nested[ i ] == ICONVERT_PATH_SERIAL;
+		CVTTEST_PRINT( "nested conversion reports the serial path", b );
+		result &= b;
+
+		return result;
+	}
+
 	BEGIN_CVTTEST( Image )
 		Color color( 255, 0, 0, 255 );
 		Image y;
@@ -148,7 +457,18 @@ namespace cvt {
 		b &= *( base + 3 ) == 1.0f;
 		CVTTEST_PRINT("BGRA FLOAT", b );
 		y.unmap( ( uint8_t* ) base );
-		return true;
+
+		bool result = true;
+		result &= _planarTest( 64, 32 );
+		result &= _planarTest( 37, 21 );
+		result &= _planarTest( 64, 101 );
+
+		result &= _convertPathTest();
+
+		b = _halfFormatTest();
+		CVTTEST_PRINT( "RGBA FLOAT <-> RGBA HALF", b );
+		result &= b;
+		return result;
 	END_CVTTEST
 
 	BEGIN_CVTTEST( ImageSpeed )
@@ -31,7 +31,7 @@
 namespace cvt {
 	static ParamInfoTyped<Image*> pin( "Input", true );
 	static ParamInfoTyped<Image*> pout( "Output", false );
-	static ParamInfoTyped<int>	  pradius( "Radius", false );
+	static ParamInfoTyped<int>	  pradius( "Radius", true );
 
 	static ParamInfo * _params[ 3 ] = {
 		&pin,
@@ -82,13 +82,13 @@ namespace cvt {
 	void BoxFilter::apply( const ParamSet* set, IFilterType t ) const
 	{
 		Image * in = set->arg<Image*>( 0 );
-		Image * out = set->arg<Image*>( 2 );
-		int radius = set->arg<int>( 3 );
-
+		Image * out = set->arg<Image*>( 1 );
+		int radius = set->arg<int>( 2 );
 
 		switch ( t ) {
 			case IFILTER_OPENCL:
-				this->apply( *out, *in, radius );
+			case IFILTER_CPU:
+				this->apply( *out, *in, radius, t );
 				break;
 			default:
 				throw CVTException( "Not implemented" );
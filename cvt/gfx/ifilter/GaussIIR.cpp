@@ -23,7 +23,11 @@
 */
 
 #include <cvt/gfx/ifilter/GaussIIR.h>
+#include <cvt/gfx/IMapScoped.h>
 #include <cvt/math/Math.h>
+#include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/SIMD.h>
 
 #include <cvt/cl/CLContext.h>
 #include <cvt/cl/kernel/gaussiir.h>
@@ -161,7 +165,7 @@ namespace cvt {
 		&porder
 	};
 
-	GaussIIR::GaussIIR() : IFilter( "GaussIIR", _params, 4, IFILTER_OPENCL ), _kernelIIR( 0 ), _kernelIIR2( 0 )
+	GaussIIR::GaussIIR() : IFilter( "GaussIIR", _params, 4, IFILTER_CPU | IFILTER_OPENCL ), _kernelIIR( 0 ), _kernelIIR2( 0 )
 	{
 	}
 
@@ -190,17 +194,7 @@ namespace cvt {
 				this->applyOpenCL( *out, *in, n, m, d );
 				break;
 			case IFILTER_CPU:
-				switch( in->format().type ){
-					case IFORMAT_TYPE_FLOAT:
-						this->applyCPUf( *out, *in, n, m, d );
-						break;
-					case IFORMAT_TYPE_UINT8:
-						this->applyCPUu8( *out, *in, n, m, d );
-						break;
-					default:
-						throw CVTException( "GaussIIR CPU not implemented for given Image format" );
-						break;
-				}
+				this->applyCPU( *out, *in, n, m, d );
 				break;
 			default:
 				throw CVTException( "Not implemented" );
@@ -249,290 +243,257 @@ namespace cvt {
 		_kernelIIR2->run( CLNDRange( Math::pad16( w ) ), _kernelIIR->bestLocalRange1d( CLNDRange( Math::pad16( w ) ) ) );
 	}
 
-	void GaussIIR::applyCPUf( Image& dst, const Image& src, const Vector4f & n, const Vector4f & m, const Vector4f & d ) const
-	{
-		float b1 = ( n[ 0 ] + n[ 1 ] + n[ 2 ] + n[ 3 ] ) / ( d[ 0 ] + d[ 1 ] + d[ 2 ] + d[ 3 ] + 1.0f );
-		float b2 = ( m[ 0 ] + m[ 1 ] + m[ 2 ] + m[ 3 ] ) / ( d[ 0 ] + d[ 1 ] + d[ 2 ] + d[ 3 ] + 1.0f );
-
-		size_t sstride, dstride;
-		const float * inTmp = src.map<float>( &sstride );
-		float * outTmp = dst.map<float>( &dstride );
-		const float * in = inTmp;
-		float * out = outTmp;
-
-		uint32_t h = dst.height();
-		uint32_t w = dst.width();
-		uint32_t channels = dst.channels();
-
-		/* last four values */
-		const float* x;
-		float* y;
+	/* rows of the horizontal pass processed together, the lanes of one block are rows * channels */
+	#define GAUSSIIR_LANES  16
+	/* columns ( floats ) of the vertical pass processed together */
+	#define GAUSSIIR_VBLOCK 64
 
-		float tmpLine[ channels * w ];
-		float * tmpBuf = tmpLine + channels * ( w - 1 );
-
-		// horizontal pass
-		for( uint32_t k = 0; k < h; k++ ){
-			x = in;
-			y = out;
-
-			for( uint32_t c = 0; c < channels; c++ ){
-				y[ c ] = n[ 0 ] * x[ c ] + n[ 1 ] * x[ c ] + n[ 2 ] * x[ c ] + n[ 3 ] * x[ c ]
-				- b1 * ( d[ 0 ] * x[ c ] + d[ 1 ] * x[ c ] + d[ 2 ] * x[ c ] + d[ 3 ] * x[ c ] );
+	struct GaussIIRCoeffs {
+		GaussIIRCoeffs( const Vector4f & n, const Vector4f & m, const Vector4f & d )
+		{
+			for( int k = 0; k < 4; k++ ) {
+				fwd[ k ] = n[ k ];
+				bwd[ k ] = m[ k ];
+				fwd[ 4 + k ] = d[ k ];
+				bwd[ 4 + k ] = d[ k ];
+			}
+			b1 = ( n[ 0 ] + n[ 1 ] + n[ 2 ] + n[ 3 ] ) / ( d[ 0 ] + d[ 1 ] + d[ 2 ] + d[ 3 ] + 1.0f );
+			b2 = ( m[ 0 ] + m[ 1 ] + m[ 2 ] + m[ 3 ] ) / ( d[ 0 ] + d[ 1 ] + d[ 2 ] + d[ 3 ] + 1.0f );
+		}
 
-				y[ c + channels  ] = n[ 0 ] * x[ c + channels ] + n[ 1 ] * x[ c ] + n[ 2 ] * x[ c ] + n[ 3 ] * x[ c ]
-				- d[ 0 ] * y[ c ] - b1 * ( d[ 1 ] * x[ c ] + d[ 2 ] * x[ c ] + d[ 3 ] * x[ c ] );
+		float fwd[ 8 ];
+		float bwd[ 8 ];
+		float b1;
+		float b2;
+	};
 
-				y[ c + 2 * channels ] = n[ 0 ] * x[ c + 2 * channels ] + n[ 1 ] * x[ c + channels ] + n[ 2 ] * x[ c ] + n[ 3 ] * x[ c ]
-				- d[ 0 ] * y[ c + channels ] - d[ 1 ] * y[ c ] - b1 * (  d[ 2 ] * x[ c ] + d[ 3 ] * x[ c ] );
+	/*
+	   Causal and anticausal recursion along num steps for independent lanes.
+	   Step i of the input starts at in + i * lanes, the sum of both passes is written to out + i * ostride.
+	   The borders are replicated, the same as the OpenCL kernels.
+	   fwd needs num * lanes floats, ring 5 * lanes floats.
+	 */
+	static void _gaussIIRLanes( float* out, size_t ostride, const float* in, float* fwd, float* ring, size_t lanes, size_t num, const GaussIIRCoeffs& c, SIMD* simd )
+	{
+		float* border = ring + 4 * lanes;
+		const float* x[ 4 ];
+		const float* y[ 4 ];
+
+		// causal pass
+		simd->MulValue1f( border, in, c.b1, lanes );
+		for( size_t i = 0; i < num; i++ ) {
+			for( size_t k = 0; k < 4; k++ ) {
+				x[ k ] = in + ( i > k ? i - k : 0 ) * lanes;
+				y[ k ] = i > k ? fwd + ( i - k - 1 ) * lanes : border;
+			}
+			simd->IIR4Lanes_f( fwd + i * lanes, x, y, c.fwd, lanes );
+		}
 
-				y[ c + 3 * channels ] = n[ 0 ] * x[ c + 3 * channels ] + n[ 1 ] * x[ c + 2 * channels ] + n[ 2 ] * x[ c + channels ] + n[ 3 ] * x[ c ]
-				- d[ 0 ] * y[ c + 2 * channels ] - d[ 1 ] * y[ c + channels ] - d[ 2 ] * y[ c ] - b1 * d[ 3 ] * x[ c ];
+		// anticausal pass, the last four results are kept in the ring
+		float* zbuf = fwd + num * lanes;
+		simd->MulValue1f( border, in + ( num - 1 ) * lanes, c.b2, lanes );
+		for( size_t i = num; i-- > 0; ) {
+			for( size_t k = 0; k < 4; k++ ) {
+				x[ k ] = in + Math::min( i + k, num - 1 ) * lanes;
+				y[ k ] = i + k + 1 < num ? ring + ( ( i + k + 1 ) & 0x3 ) * lanes : border;
 			}
+			simd->IIR4Lanes_f( zbuf, x, y, c.bwd, lanes );
+			simd->Add( out + i * ostride, fwd + i * lanes, zbuf, lanes );
+			memcpy( ring + ( i & 0x3 ) * lanes, zbuf, sizeof( float ) * lanes );
+		}
+	}
 
-			// forward pass
-			for( uint32_t i = 4; i < w; i++ ){
-				x+=channels; /* last 4 pixels, x[ 3*channels ] is current pixel */
+	/* horizontal pass: blocks of rows are transposed, such that the lanes run across the rows */
+	class GaussIIRHorizontal {
+		public:
+			GaussIIRHorizontal( float* dst, size_t dstride, const uint8_t* src, size_t sstride, bool u8,
+								size_t width, size_t height, size_t channels, const GaussIIRCoeffs& c ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _u8( u8 ),
+				_width( width ), _height( height ), _channels( channels ), _coeffs( c )
+			{
+				_rows = Math::max<size_t>( GAUSSIIR_LANES / channels, 1 );
+			}
 
-				for( uint32_t c = 0; c < channels; c++ ){
-					y[ 4 * channels + c ] = n[ 0 ] * x[ 3 * channels + c ] + n[ 1 ] * x[ 2 * channels + c ] + n[ 2 ] * x[ channels + c ] + n[ 3 ] * x[ c ]
-					- d[ 0 ] * y[ 3 * channels + c ] - d[ 1 ] * y[ 2 * channels + c ] - d[ 2 ] * y[ channels + c ] - d[ 3 ] * y[ c ];
+			size_t numBlocks() const { return ( _height + _rows - 1 ) / _rows; }
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				SIMD* simd = SIMD::instance();
+				const size_t rowlen = _width * _channels;
+				const size_t maxlanes = _rows * _channels;
+
+				ScopedBuffer<float, true> trans( _width * maxlanes );
+				ScopedBuffer<float, true> result( _width * maxlanes );
+				ScopedBuffer<float, true> fwd( ( _width + 1 ) * maxlanes );
+				ScopedBuffer<float, true> ring( 5 * maxlanes );
+				ScopedBuffer<float, true> line( _u8 ? rowlen : 1 );
+
+				for( size_t block = begin; block < end; block++ ) {
+					size_t y0 = block * _rows;
+					size_t rows = Math::min( _rows, _height - y0 );
+					size_t lanes = rows * _channels;
+
+					// transpose rows into lanes
+					for( size_t r = 0; r < rows; r++ ) {
+						const float* src;
+						if( _u8 ) {
+							simd->Conv_u8_to_f( line.ptr(), _src + ( y0 + r ) * _sstride, rowlen );
+							src = line.ptr();
+						} else {
+							src = ( const float* ) ( _src + ( y0 + r ) * _sstride );
+						}
+						float* t = trans.ptr() + r * _channels;
+						for( size_t x = 0; x < _width; x++ ) {
+							for( size_t ch = 0; ch < _channels; ch++ )
+								t[ ch ] = src[ ch ];
+							src += _channels;
+							t += lanes;
+						}
+					}
+
+					_gaussIIRLanes( result.ptr(), lanes, trans.ptr(), fwd.ptr(), ring.ptr(), lanes, _width, _coeffs, simd );
+
+					// transpose back
+					for( size_t r = 0; r < rows; r++ ) {
+						float* dst = ( float* ) ( ( uint8_t* ) _dst + ( y0 + r ) * _dstride );
+						const float* t = result.ptr() + r * _channels;
+						for( size_t x = 0; x < _width; x++ ) {
+							for( size_t ch = 0; ch < _channels; ch++ )
+								dst[ ch ] = t[ ch ];
+							dst += _channels;
+							t += lanes;
+						}
+					}
 				}
-				y+=channels;
 			}
 
-			// backward border init:
-			x = ( in + channels * ( w - 1 ) );
-			y = ( out + channels * ( w - 1 ) );
-			for( uint32_t c = 0; c < channels; c++ ){
-				tmpBuf[ c ] = m[ 0 ] * x[ c ] + m[ 1 ] * x[ c ] + m[ 2 ] * x[ c ] + m[ 3 ] * x[ c ]
-				- b2 * ( d[ 0 ] * x[ c ] + d[ 1 ] * x[ c ] + d[ 2 ] * x[ c ] + d[ 3 ] * x[ c ] );
+		private:
+			float*					_dst;
+			size_t					_dstride;
+			const uint8_t*			_src;
+			size_t					_sstride;
+			bool					_u8;
+			size_t					_width;
+			size_t					_height;
+			size_t					_channels;
+			size_t					_rows;
+			const GaussIIRCoeffs&	_coeffs;
+	};
 
-				*( tmpBuf - channels + c ) = m[ 0 ] * *( x - channels + c ) + m[ 1 ] * x[ c ] + m[ 2 ] * x[ c ] + m[ 3 ] * x[ c ]
-				- d[ 0 ] * tmpBuf[ c ] - b2 * ( d[ 1 ] * x[ c ] + d[ 2 ] * x[ c ] + d[ 3 ] * x[ c ] );
+	/* vertical pass: blocks of columns are processed in place, the lanes run along x */
+	class GaussIIRVertical {
+		public:
+			GaussIIRVertical( float* data, size_t stride, size_t rowlen, size_t height, const GaussIIRCoeffs& c ) :
+				_data( data ), _stride( stride ), _rowlen( rowlen ), _height( height ), _coeffs( c )
+			{
+			}
 
-				*( tmpBuf - 2 * channels + c ) = m[ 0 ] * *( x - 2 * channels + c ) + m[ 1 ] * *( x - channels + c ) + m[ 2 ] * x[ c ] + m[ 3 ] * x[ c ]
-				- d[ 0 ] * *( tmpBuf - channels + c ) - d[ 1 ] * tmpBuf[ c ] - b2 * (  d[ 2 ] * x[ c ] + d[ 3 ] * x[ c ] );
+			size_t numBlocks() const { return ( _rowlen + GAUSSIIR_VBLOCK - 1 ) / GAUSSIIR_VBLOCK; }
 
-				*( tmpBuf - 3 * channels + c ) = m[ 0 ] * *( x - 3 * channels + c ) + m[ 1 ] * *( x - 2 * channels + c ) + m[ 2 ] * *( x - channels + c ) + m[ 3 ] * x[ c ]
-				- d[ 0 ] * *( tmpBuf - 2 * channels + c ) - d[ 1 ] * *( tmpBuf - channels + c ) - d[ 2 ] * tmpBuf[ c ] - b2 * d[ 3 ] * x[ c ];
+			void operator()( size_t begin, size_t end ) const
+			{
+				SIMD* simd = SIMD::instance();
+				ScopedBuffer<float, true> col( _height * GAUSSIIR_VBLOCK );
+				ScopedBuffer<float, true> fwd( ( _height + 1 ) * GAUSSIIR_VBLOCK );
+				ScopedBuffer<float, true> ring( 5 * GAUSSIIR_VBLOCK );
 
-				y[ c ] += tmpBuf[ c ];
-				*( y - channels + c ) += *( tmpBuf - channels + c );
-				*( y - 2 * channels + c ) += *( tmpBuf - 2 * channels + c );
-				*( y - 3 * channels + c ) += *( tmpBuf - 3 * channels + c );
-			}
+				for( size_t block = begin; block < end; block++ ) {
+					size_t x0 = block * GAUSSIIR_VBLOCK;
+					size_t lanes = Math::min<size_t>( GAUSSIIR_VBLOCK, _rowlen - x0 );
 
-			// backward pass
-			y -= ( 4 * channels );
-			for (int i = w-4; i > 0; i--) {
-				x-=channels;
-				for( uint32_t c = 0; c < channels; c++ ){
-					*( tmpBuf - 4 * channels + c ) = ( m[ 0 ] * *( x - 3 * channels + c ) + m[ 1 ] * *( x - 2 * channels + c ) + m[ 2 ] * *( x - channels + c ) + m[ 3 ] * x[ c ]
-					- d[ 0 ] * *( tmpBuf - 3 * channels + c ) - d[ 1 ] * *( tmpBuf - 2 * channels + c ) - d[ 2 ] * *( tmpBuf - channels + c ) - d[ 3 ] * tmpBuf[ c ] );
-					y[ c ] += *( tmpBuf - 4 * channels + c );
+					// copy the column block, the output overwrites the input
+					const uint8_t* src = ( const uint8_t* ) ( _data + x0 );
+					for( size_t y = 0; y < _height; y++ ) {
+						memcpy( col.ptr() + y * lanes, src, sizeof( float ) * lanes );
+						src += _stride;
+					}
+
+					_gaussIIRLanes( _data + x0, _stride / sizeof( float ), col.ptr(), fwd.ptr(), ring.ptr(), lanes, _height, _coeffs, simd );
 				}
-				tmpBuf-=channels;
 			}
 
-			in += sstride;
-			out += dstride;
-		}
+		private:
+			float*					_data;
+			size_t					_stride;
+			size_t					_rowlen;
+			size_t					_height;
+			const GaussIIRCoeffs&	_coeffs;
+	};
 
-		// vertical pass
-		const float * x0 = inTmp;
-		const float * x1 = x0 + sstride;
-		const float * x2 = x1 + sstride;
-		const float * x3 = x2 + sstride;
-		float * y0 = outTmp;
-		float * y1 = y0 + dstride;
-		float * y2 = y1 + dstride;
-		float * y3 = y2 + dstride;
-		for( size_t i = 0; i < w; i++ ){
-			for( uint32_t c = 0; c < channels; c++ ){
-				y0[ c ] = n[ 0 ] * x0[ c ] + n[ 1 ] * x0[ c ] + n[ 2 ] * x0[ c ] + n[ 3 ] * x0[ c ]
-				- b1 * ( d[ 0 ] * x0[ c ] + d[ 1 ] * x0[ c ] + d[ 2 ] * x0[ c ] + d[ 3 ] * x0[ c ] );
-
-				y1[ c ] = n[ 0 ] * x1[ c ] + n[ 1 ] * x0[ c ] + n[ 2 ] * x0[ c ] + n[ 3 ] * x0[ c ]
-				- d[ 0 ] * y0[ c ] - b1 * ( d[ 1 ] * x0[ c ] + d[ 2 ] * x0[ c ] + d[ 3 ] * x0[ c ] );
-
-				y2[ c ] = n[ 0 ] * x2[ c ] + n[ 1 ] * x1[ c ] + n[ 2 ] * x0[ c ] + n[ 3 ] * x0[ c ]
-				- d[ 0 ] * y1[ c ] - d[ 1 ] * y0[ c ] - b1 * (  d[ 2 ] * x0[ c ] + d[ 3 ] * x0[ c ] );
-
-				y3[ c ] = n[ 0 ] * x3[ c ] + n[ 1 ] * x2[ c ] + n[ 2 ] * x1[ c ] + n[ 3 ] * x0[ c ]
-				- d[ 0 ] * y2[ c ] - d[ 1 ] * y1[ c ] - d[ 2 ] * y0[ c ] - b1 * d[ 3 ] * x0[ c ];
+	class GaussIIRConvertU8 {
+		public:
+			GaussIIRConvertU8( uint8_t* dst, size_t dstride, const float* src, size_t sstride, size_t rowlen ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _rowlen( rowlen )
+			{
 			}
-			x0+=channels; x1+=channels; x2+=channels; x3+=channels;
-			y0+=channels; y1+=channels; y2+=channels; y3+=channels;
-		}
 
-		float * currOut;
-		// from fourth line to end:
-		for( uint32_t i = 4; i < h; i++ ){
-			x0 = inTmp + i * sstride;
-			x1 = x0 + sstride;
-			x2 = x1 + sstride;
-			x3 = x2 + sstride;
-
-			y0 = outTmp + ( i - 4 ) * dstride;
-			y1 = y0 + dstride;
-			y2 = y1 + dstride;
-			y3 = y2 + dstride;
-			currOut = y3 + dstride;
-
-			for( uint32_t j = 0; j < w; j++ ){
-				for( uint32_t c = 0; c < channels; c++ ){
-					currOut[ c ] = n[ 0 ] * x3[ c ] + n[ 1 ] * x2[ c ] + n[ 2 ] * x1[ c ] + n[ 3 ] * x0[ c ]
-					- d[ 0 ] * y3[ c ] - d[ 1 ] * y2[ c ] - d[ 2 ] * y1[ c ] - d[ 3 ] * y0[ c ];
-				}
-				x0+=channels; x1+=channels; x2+=channels; x3+=channels;
-				y0+=channels; y1+=channels; y2+=channels; y3+=channels;
-				currOut+=channels;
+			void operator()( size_t begin, size_t end ) const
+			{
+				SIMD* simd = SIMD::instance();
+				for( size_t y = begin; y < end; y++ )
+					simd->Conv_f_to_u8( _dst + y * _dstride, ( const float* ) ( ( const uint8_t* ) _src + y * _sstride ), _rowlen );
 			}
-		}
 
-		x0 = inTmp + ( h - 1 ) * sstride;
-		x1 = x0 - sstride;
-		x2 = x1 - sstride;
-		x3 = x2 - sstride;
-
-		float tmpBuffer[ 4 * w * channels ];
-		y0 = outTmp + ( h - 1 ) * dstride;
-		y1 = y0 - dstride;
-		y2 = y1 - dstride;
-		y3 = y2 - dstride;
-
-		float * t0 = ( tmpBuffer + 3 * w * channels );
-		float * t1 = ( tmpBuffer + 2 * w * channels );
-		float * t2 = ( tmpBuffer + 1 * w * channels );
-		float * t3 = ( tmpBuffer );
-
-		for( size_t i = 0; i < w; i++ ){
-			for( uint32_t c = 0; c < channels; c++ ){
-				t0[ c ] = m[ 0 ] * x0[ c ] + m[ 1 ] * x0[ c ] + m[ 2 ] * x0[ c ] + m[ 3 ] * x0[ c ]
-				- b1 * ( d[ 0 ] * x0[ c ] + d[ 1 ] * x0[ c ] + d[ 2 ] * x0[ c ] + d[ 3 ] * x0[ c ] );
-				y0[ c ] += t0[ c ];
-
-				t1[ c ] = m[ 0 ] * x1[ c ] + m[ 1 ] * x0[ c ] + m[ 2 ] * x0[ c ] + m[ 3 ] * x0[ c ]
-				- d[ 0 ] * t0[ c ] - b1 * ( d[ 1 ] * x0[ c ] + d[ 2 ] * x0[ c ] + d[ 3 ] * x0[ c ] );
-				y1[ c ] += t1[ c ];
-
-				t2[ c ] = m[ 0 ] * x2[ c ] + m[ 1 ] * x1[ c ] + m[ 2 ] * x0[ c ] + m[ 3 ] * x0[ c ]
-				- d[ 0 ] * t1[ c ] - d[ 1 ] * t0[ c ] - b1 * (  d[ 2 ] * x0[ c ] + d[ 3 ] * x0[ c ] );
-				y2[ c ] += t2[ c ];
-
-				t3[ c ] = m[ 0 ] * x3[ c ] + m[ 1 ] * x2[ c ] + m[ 2 ] * x1[ c ] + m[ 3 ] * x0[ c ]
-				- d[ 0 ] * t2[ c ] - d[ 1 ] * t1[ c ] - d[ 2 ] * t0[ c ] - b1 * d[ 3 ] * x0[ c ];
-				y3[ c ] += t3[ c ];
-			}
-			x0+=channels; x1+=channels; x2+=channels; x3+=channels;
-			y0+=channels; y1+=channels; y2+=channels; y3+=channels;
-			t0+=channels; t1+=channels; t2+=channels; t3+=channels;
+		private:
+			uint8_t*		_dst;
+			size_t			_dstride;
+			const float*	_src;
+			size_t			_sstride;
+			size_t			_rowlen;
+	};
+
+	void GaussIIR::applyCPU( Image& dst, const Image& src, const Vector4f & n, const Vector4f & m, const Vector4f & d ) const
+	{
+		bool u8;
+		switch( src.format().type ) {
+			case IFORMAT_TYPE_FLOAT: u8 = false; break;
+			case IFORMAT_TYPE_UINT8: u8 = true; break;
+			default:
+				throw CVTException( "GaussIIR CPU not implemented for given Image format" );
 		}
 
-		float* tmp;
-		t0 = ( tmpBuffer + 3 * w * channels );
-		t1 = ( tmpBuffer + 2 * w * channels );
-		t2 = ( tmpBuffer + 1 * w * channels );
-		t3 = ( tmpBuffer );
-		for( uint32_t i = h - 4; i > 0; i-- ){
-			x0 = inTmp + ( i + 2 ) * sstride;
-			x1 = x0 - sstride;
-			x2 = x1 - sstride;
-			x3 = x2 - sstride;
-
-			currOut = outTmp + ( i - 1 ) * dstride;
-
-			for( uint32_t j = 0; j < w; j++ ){
-				for( uint32_t c = 0; c < channels; c++ ){
-					t0[ j * channels + c ] = n[ 0 ] * x3[ c ] + n[ 1 ] * x2[ c ] + n[ 2 ] * x1[ c ] + n[ 3 ] * x0[ c ]
-					- d[ 0 ] * t3[ j * channels + c ] - d[ 1 ] * t2[ j * channels + c ] - d[ 2 ] * t1[ j * channels + c ] - d[ 3 ] * t0[ j * channels + c ];
-					currOut[ c ] += t0[ j * channels + c ];
-				}
+		GaussIIRCoeffs coeffs( n, m, d );
+		const size_t w = src.width();
+		const size_t h = src.height();
+		const size_t channels = src.channels();
+		const size_t rowlen = w * channels;
+
+		/* float images are filtered in the destination, uint8 images in a temporary float buffer */
+		Image tmp;
+		if( &dst != &src )
+			dst.reallocate( w, h, src.format() );
+		if( !w || !h )
+			return;
+		if( u8 )
+			tmp.reallocate( w, h, IFormat::floatEquivalent( src.format() ) );
+		Image& buf = u8 ? tmp : dst;
 
-				// next pixel of row
-				x0+=channels; x1+=channels; x2+=channels; x3+=channels;
-				currOut+=channels;
-			}
-			tmp = t0;
-			t0 = t1; t1 = t2; t2 = t3; t3 = tmp;
-		}
+		{
+			IMapScoped<const uint8_t> srcmap( src );
+			IMapScoped<float> bufmap( buf );
 
-		src.unmap( inTmp );
-		dst.unmap( outTmp );
-	}
+			GaussIIRHorizontal hpass( bufmap.ptr(), bufmap.stride(), srcmap.ptr(), srcmap.stride(), u8, w, h, channels, coeffs );
+			parallelFor( 0, hpass.numBlocks(), hpass, parallelGrain( hpass.numBlocks() ) );
 
-	void GaussIIR::applyCPUu8( Image& dst, const Image& src, const Vector4f & _n, const Vector4f & _m, const Vector4f & _d ) const
-	{
-		uint32_t h = dst.height();
-		uint32_t w = dst.width();
-		uint32_t channels = dst.channels();
-		
-		void (SIMD::*fwdHoriz)( Fixed* dst, const uint8_t * src, size_t width, const Fixed * n, const Fixed * d, const Fixed & b1 ) const;
-		void (SIMD::*bwdHoriz)( uint8_t * dst, const Fixed* fwdRes, const uint8_t * src, size_t w, const Fixed * n, const Fixed * d, const Fixed & b  ) const;
-		void (SIMD::*fwdVert)( Fixed* buffer, const uint8_t * src, size_t sstride, size_t h, const Fixed * n, const Fixed * d, const Fixed & b ) const;
-		void (SIMD::*bwdVert)( uint8_t * dst, size_t dstride, Fixed* fwdRes, size_t h, const Fixed * n, const Fixed * d, const Fixed & b ) const;
-		
-		SIMD * simd = SIMD::instance();		
-		switch ( channels ) {
-			case 4:
-				fwdHoriz = &SIMD::IIR4FwdHorizontal4Fx;
-				bwdHoriz = &SIMD::IIR4BwdHorizontal4Fx;
-				fwdVert = &SIMD::IIR4FwdVertical4Fx;
-				bwdVert = &SIMD::IIR4BwdVertical4Fx;
-				break;
-			default:
-				String msg;
-				msg.sprintf( "Not implement for number of channles: %d", channels );
-				throw CVTException( msg.c_str() );
-				break;
-		}
-		
-		
-		Fixed n[ 4 ], m[ 4 ], d[ 4 ];
-		n[ 0 ] = _n[ 0 ]; n[ 1 ] = _n[ 1 ]; n[ 2 ] = _n[ 2 ]; n[ 3 ] = _n[ 3 ];
-		m[ 0 ] = _m[ 0 ]; m[ 1 ] = _m[ 1 ]; m[ 2 ] = _m[ 2 ]; m[ 3 ] = _m[ 3 ];
-		d[ 0 ] = _d[ 0 ]; d[ 1 ] = _d[ 1 ]; d[ 2 ] = _d[ 2 ]; d[ 3 ] = _d[ 3 ];
-
-		Fixed one( 1.0f );
-		Fixed b1 = ( n[ 0 ] + n[ 1 ] + n[ 2 ] + n[ 3 ] ) / ( d[ 0 ] + d[ 1 ] + d[ 2 ] + d[ 3 ] + one );
-		Fixed b2 = ( m[ 0 ] + m[ 1 ] + m[ 2 ] + m[ 3 ] ) / ( d[ 0 ] + d[ 1 ] + d[ 2 ] + d[ 3 ] + one );
-
-		size_t sstride, dstride;
-		const uint8_t * in = src.map<uint8_t>( &sstride );
-		uint8_t * out = dst.map<uint8_t>( &dstride );
-
-		/* last four values */
-		const uint8_t* x = in;
-		uint8_t* y = out;
-
-		Fixed* tmpLine = new Fixed[ channels * w ];		
-
-		// horizontal pass
-		for( uint32_t k = 0; k < h; k++ ){
-			( simd->*fwdHoriz )( tmpLine, x, w, n, d, b1 );
-			( simd->*bwdHoriz )( y, tmpLine, x, w, m, d, b2 );
-
-			x += sstride;
-			y += dstride;
+			GaussIIRVertical vpass( bufmap.ptr(), bufmap.stride(), rowlen, h, coeffs );
+			parallelFor( 0, vpass.numBlocks(), vpass, parallelGrain( vpass.numBlocks() ) );
 		}
-        delete[] tmpLine;
-
-		// vertical pass:
-		// buffer for 4 lines:
-		Fixed* column = new Fixed[ channels * h ];
-		x = in;
-		y = out;
-		for( uint32_t k = 0; k < w; k++ ){
-			( simd->*fwdVert )( column, y, dstride, h, n, d, b1 );
-			( simd->*bwdVert )( y, dstride, column, h, m, d, b2 );
-			x += channels;
-			y += channels;
+
+		if( u8 ) {
+			IMapScoped<const float> bufmap( buf );
+			IMapScoped<uint8_t> dstmap( dst );
+			GaussIIRConvertU8 conv( dstmap.ptr(), dstmap.stride(), bufmap.ptr(), bufmap.stride(), rowlen );
+			parallelFor( 0, h, conv, parallelGrain( h ) );
 		}
-        delete[] column;
+	}
 
+	void GaussIIR::applyCPUf( Image& dst, const Image& src, const Vector4f & n, const Vector4f & m, const Vector4f & d ) const
+	{
+		applyCPU( dst, src, n, m, d );
+	}
 
-		src.unmap( in );
-		dst.unmap( out );
+	void GaussIIR::applyCPUu8( Image& dst, const Image& src, const Vector4f & n, const Vector4f & m, const Vector4f & d ) const
+	{
+		applyCPU( dst, src, n, m, d );
 	}
 }
@@ -36,6 +36,8 @@ namespace cvt
 					GaussIIR();
 					~GaussIIR();
 			void	applyOpenCL( Image& dst, const Image& src, const Vector4f & n, const Vector4f & m, const Vector4f & d ) const;
+			/* blocked and multithreaded, for float and uint8 images with any number of channels */
+			void	applyCPU( Image& dst, const Image& src, const Vector4f & n, const Vector4f & m, const Vector4f & d ) const;
 			void	applyCPUf( Image& dst, const Image& src, const Vector4f & n, const Vector4f & m, const Vector4f & d ) const;
 			void	applyCPUu8( Image& dst, const Image& src, const Vector4f & n, const Vector4f & m, const Vector4f & d ) const;
 			void	apply( const ParamSet* set, IFilterType t = IFILTER_CPU ) const;
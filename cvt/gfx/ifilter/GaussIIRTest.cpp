@@ -0,0 +1,186 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/gfx/ifilter/GaussIIR.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/CVTTest.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/* scalar causal + anti-causal recursion with replicated borders */
+	static void _gaussIIRRef1D( float* dst, size_t dstride, const float* src, size_t sstride, size_t num,
+							   const Vector4f& n, const Vector4f& m, const Vector4f& d )
+	{
+		const float dsum = d[ 0 ] + d[ 1 ] + d[ 2 ] + d[ 3 ] + 1.0f;
+		const float b1 = ( n[ 0 ] + n[ 1 ] + n[ 2 ] + n[ 3 ] ) / dsum;
+		const float b2 = ( m[ 0 ] + m[ 1 ] + m[ 2 ] + m[ 3 ] ) / dsum;
+		std::vector<float> y( num ), z( num );
+		const int N = ( int ) num;
+
+		for( int i = 0; i < N; i++ ) {
+			float v = 0.0f;
+			for( int k = 0; k < 4; k++ ) {
+				v += n[ k ] * src[ Math::max( i - k, 0 ) * sstride ];
+				v -= d[ k ] * ( i - k - 1 >= 0 ? y[ i - k - 1 ] : b1 * src[ 0 ] );
+			}
+			y[ i ] = v;
+		}
+		for( int i = N - 1; i >= 0; i-- ) {
+			float v = 0.0f;
+			for( int k = 0; k < 4; k++ ) {
+				v += m[ k ] * src[ Math::min( i + k, N - 1 ) * sstride ];
+				v -= d[ k ] * ( i + k + 1 < N ? z[ i + k + 1 ] : b2 * src[ ( N - 1 ) * sstride ] );
+			}
+			z[ i ] = v;
+		}
+		for( int i = 0; i < N; i++ )
+			dst[ i * dstride ] = y[ i ] + z[ i ];
+	}
+
+	static bool _gaussIIRCompare( const IFormat& format, size_t w, size_t h )
+	{
+		const Vector4f n( 0.01f, 0.005f, 0.002f, 0.001f );
+		const Vector4f m( 0.005f, 0.002f, 0.001f, 0.0005f );
+		const Vector4f d( -2.0f, 1.5f, -0.5f, 0.0625f );
+		const bool u8 = format.type == IFORMAT_TYPE_UINT8;
+
+		Image src( w, h, format ), dst;
+		const size_t rowlen = w * src.channels();
+		std::vector<float> data( rowlen * h ), tmp( rowlen * h ), ref( rowlen * h );
+		{
+			IMapScoped<uint8_t> map( src );
+			for( size_t y = 0; y < h; y++ ) {
+				for( size_t i = 0; i < rowlen; i++ ) {
+					float v = Math::rand( 0.0f, 1.0f );
+					if( u8 ) {
+						map.ptr()[ i ] = ( uint8_t ) ( v * 255.0f );
+						v = map.ptr()[ i ] / 255.0f;
+					} else
+						( ( float* ) map.ptr() )[ i ] = v;
+					data[ y * rowlen + i ] = v;
+				}
+				map++;
+			}
+		}
+
+		GaussIIR gauss;
+		gauss.applyCPU( dst, src, n, m, d );
+		if( dst.width() != w || dst.height() != h || dst.format() != format )
+			return false;
+
+		/* rows, then columns, every channel separately */
+		const size_t channels = src.channels();
+		for( size_t y = 0; y < h; y++ )
+			for( size_t c = 0; c < channels; c++ )
+				_gaussIIRRef1D( &tmp[ y * rowlen + c ], channels, &data[ y * rowlen + c ], channels, w, n, m, d );
+		for( size_t i = 0; i < rowlen; i++ )
+			_gaussIIRRef1D( &ref[ i ], rowlen, &tmp[ i ], rowlen, h, n, m, d );
+
+		/* u8 output is rounded and clamped */
+		const float tolerance = u8 ? 1.0f / 255.0f + 1e-5f : 1e-5f;
+		IMapScoped<const uint8_t> map( dst );
+		for( size_t y = 0; y < h; y++ ) {
+			for( size_t i = 0; i < rowlen; i++ ) {
+				float v = u8 ? map.ptr()[ i ] / 255.0f : ( ( const float* ) map.ptr() )[ i ];
+				float r = ref[ y * rowlen + i ];
+				if( u8 )
+					r = Math::clamp( r, 0.0f, 1.0f );
+				if( Math::abs( v - r ) > tolerance )
+					return false;
+			}
+			map++;
+		}
+		return true;
+	}
+
+	static bool _gaussIIRConstant( float sigma )
+	{
+		Image src( 61, 43, IFormat::GRAY_FLOAT ), dst;
+		src.fill( Color( 0.5f ) );
+
+		GaussIIR gauss;
+		ParamSet* set = gauss.parameterSet();
+		set->setArg<Image*>( 0, &src );
+		set->setArg<Image*>( 1, &dst );
+		set->setArg<float>( 2, sigma );
+		set->setArg<int>( 3, 0 );
+		gauss.apply( set, IFILTER_CPU );
+		delete set;
+
+		IMapScoped<const float> map( dst );
+		for( size_t y = 0; y < dst.height(); y++ ) {
+			for( size_t x = 0; x < dst.width(); x++ )
+				if( Math::abs( map.ptr()[ x ] - 0.5f ) > 1e-3f )
+					return false;
+			map++;
+		}
+		return true;
+	}
+
+}
+
+using namespace cvt;
+
+BEGIN_CVTTEST( GaussIIR )
+	bool ret = true;
+	bool b;
+
+	const IFormat* formats[] = { &IFormat::GRAY_FLOAT, &IFormat::GRAYALPHA_FLOAT, &IFormat::RGBA_FLOAT, &IFormat::GRAY_UINT8, &IFormat::RGBA_UINT8 };
+	const char* names[] = { "GRAY_FLOAT", "GRAYALPHA_FLOAT", "RGBA_FLOAT", "GRAY_UINT8", "RGBA_UINT8" };
+	const size_t sizes[ 3 ][ 2 ] = { { 130, 71 }, { 37, 29 }, { 3, 2 } };
+	for( size_t f = 0; f < 5; f++ ) {
+		b = true;
+		for( size_t s = 0; s < 3; s++ )
+			b &= _gaussIIRCompare( *formats[ f ], sizes[ s ][ 0 ], sizes[ s ][ 1 ] );
+		CVTTEST_PRINT( String( "GaussIIR CPU " ) + names[ f ] + " vs. scalar recursion", b );
+		ret &= b;
+	}
+
+	b = _gaussIIRConstant( 1.0f ) && _gaussIIRConstant( 4.0f );
+	CVTTEST_PRINT( "GaussIIR CPU preserves constant images", b );
+	ret &= b;
+
+	/* zero width or height must not run the recursion over zero samples */
+	b = true;
+	try {
+		const size_t empty[ 3 ][ 2 ] = { { 0, 0 }, { 0, 7 }, { 7, 0 } };
+		const Vector4f n( 0.5f, 0.0f, 0.0f, 0.0f ), m( 0.5f, 0.0f, 0.0f, 0.0f ), d( 0.0f, 0.0f, 0.0f, 0.0f );
+		GaussIIR gauss;
+		for( size_t i = 0; i < 3; i++ ) {
+			Image src( empty[ i ][ 0 ], empty[ i ][ 1 ], IFormat::GRAY_FLOAT ), dst;
+			gauss.applyCPU( dst, src, n, m, d );
+			b &= dst.width() == empty[ i ][ 0 ] && dst.height() == empty[ i ][ 1 ];
+		}
+	} catch( Exception& ) {
+		b = false;
+	}
+	CVTTEST_PRINT( "GaussIIR CPU empty image", b );
+	ret &= b;
+
+	return ret;
+END_CVTTEST
@@ -23,6 +23,14 @@
 */
 
 #include <cvt/gfx/ifilter/GuidedFilter.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/IScaleFilter.h>
+#include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/SIMD.h>
+
+#include <vector>
+#include <string.h>
 
 #include <cvt/cl/kernel/guidedfilter/guidedfilter_calcab.h>
 #include <cvt/cl/kernel/guidedfilter/guidedfilter_calcab_outerrgb.h>
@@ -36,17 +44,19 @@ namespace cvt {
 	static ParamInfoTyped<Image*> pout( "Output", false );
 	static ParamInfoTyped<int>	  pradius( "Radius", true );
 	static ParamInfoTyped<float>  pepsilon( "Epsilon", true );
+	static ParamInfoTyped<int>	  psubsample( "Subsample", 1 /* min */, 8 /* max */, 1 /* default */, true );
 
-	static ParamInfo * _params[ 5 ] = {
+	static ParamInfo * _params[ 6 ] = {
 		&pin,
 		&pinguide,
 		&pout,
 		&pradius,
 		&pepsilon,
+		&psubsample
 	};
 
 	GuidedFilter::GuidedFilter() :
-		IFilter( "GuidedFilter", _params, 5, IFILTER_CPU | IFILTER_OPENCL ),
+		IFilter( "GuidedFilter", _params, 6, IFILTER_CPU | IFILTER_OPENCL ),
 		_clguidedfilter_calcab( _guidedfilter_calcab_source, "guidedfilter_calcab" ),
 		_clguidedfilter_calcab_outerrgb( _guidedfilter_calcab_outerrgb_source, "guidedfilter_calcab_outerrgb" ),
 		_clguidedfilter_applyab_gc( _guidedfilter_applyab_gc_source, "guidedfilter_applyab_gc" ),
@@ -59,6 +69,11 @@ namespace cvt {
 	{
 		// G guidance image, S source image
 
+		if( src.memType() != IALLOCATOR_CL ) {
+			applyCPU( dst, src, guide, radius, epsilon, rgbcovariance );
+			return;
+		}
+
 		if( rgbcovariance ) {
 			applyGC_COV( dst, src, guide, radius, epsilon );
 		} else if( src.format().channels <= 2 ) {
@@ -208,6 +223,585 @@ namespace cvt {
 	}
 
 
+	/*
+	   CPU implementation
+
+	   Box means are computed with running sums: every band of rows keeps the
+	   column sums of all input planes ( guide, source and their products ),
+	   which are updated by adding the entering and subtracting the leaving row.
+	   The planes of a row are generated on the fly, so no product or integral
+	   images are needed. The windows are clipped at the image border and
+	   normalized by the number of pixels inside the image.
+	 */
+
+	struct GFImageRows {
+		GFImageRows( const uint8_t* ptr, size_t stride, size_t channels ) : _ptr( ptr ), _stride( stride ), _channels( channels ) {}
+
+		const float*	line( size_t y ) const { return ( const float* ) ( _ptr + y * _stride ); }
+		size_t			channels() const { return _channels; }
+
+		const uint8_t*	_ptr;
+		size_t			_stride;
+		size_t			_channels;
+	};
+
+	static inline void _gfChannel( float* dst, const float* src, size_t channels, size_t channel, size_t n )
+	{
+		if( channels == 1 ) {
+			memcpy( dst, src, sizeof( float ) * n );
+			return;
+		}
+		src += channel;
+		while( n-- ) {
+			*dst++ = *src;
+			src += channels;
+		}
+	}
+
+	/* row y of each of the num planes stored one after another */
+	static inline void _gfCoeffRows( float** rows, float* planes, size_t num, size_t width, size_t height, size_t y )
+	{
+		for( size_t j = 0; j < num; j++ )
+			rows[ j ] = planes + ( j * height + y ) * width;
+	}
+
+	template<typename Kernel>
+	class GFBoxBody {
+		public:
+			GFBoxBody( const Kernel& kernel, size_t width, size_t height, size_t radius, size_t bandHeight ) :
+				_kernel( kernel ),
+				_width( width ),
+				_height( height ),
+				_radius( radius ),
+				_bandHeight( bandHeight ),
+				_invcx( width )
+			{
+				for( size_t x = 0; x < width; x++ ) {
+					size_t left = x > radius ? x - radius : 0;
+					size_t right = Math::min( width - 1, x + radius );
+					_invcx[ x ] = 1.0f / ( float ) ( right - left + 1 );
+				}
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				SIMD* simd = SIMD::instance();
+				const size_t np = _kernel.numPlanes();
+				const size_t w = _width;
+
+				ScopedBuffer<float, true> colbuf( np * w );
+				ScopedBuffer<float, true> rowbuf( np * w );
+				ScopedBuffer<float, true> meanbuf( np * w );
+				ScopedBuffer<float*, true> outbuf( _kernel.numOutputs() );
+				std::vector<float*> cols( np ), rows( np ), means( np );
+				for( size_t i = 0; i < np; i++ ) {
+					cols[ i ] = colbuf.ptr() + i * w;
+					rows[ i ] = rowbuf.ptr() + i * w;
+					means[ i ] = meanbuf.ptr() + i * w;
+				}
+
+				for( size_t band = begin; band < end; band++ ) {
+					size_t y0 = band * _bandHeight;
+					size_t y1 = Math::min( _height, y0 + _bandHeight );
+
+					// column sums for the window of the first row in the band
+					memset( colbuf.ptr(), 0, sizeof( float ) * np * w );
+					size_t ystart = y0 > _radius ? y0 - _radius : 0;
+					size_t yend = Math::min( _height - 1, y0 + _radius );
+					for( size_t yy = ystart; yy <= yend; yy++ ) {
+						_kernel.planes( &rows[ 0 ], yy );
+						for( size_t i = 0; i < np; i++ )
+							simd->Add( cols[ i ], cols[ i ], rows[ i ], w );
+					}
+
+					for( size_t y = y0; y < y1; y++ ) {
+						if( y > y0 ) {
+							if( y + _radius < _height ) {
+								_kernel.planes( &rows[ 0 ], y + _radius );
+								for( size_t i = 0; i < np; i++ )
+									simd->Add( cols[ i ], cols[ i ], rows[ i ], w );
+							}
+							if( y > _radius ) {
+								_kernel.planes( &rows[ 0 ], y - _radius - 1 );
+								for( size_t i = 0; i < np; i++ )
+									simd->Sub( cols[ i ], cols[ i ], rows[ i ], w );
+							}
+						}
+
+						size_t top = y > _radius ? y - _radius : 0;
+						size_t bottom = Math::min( _height - 1, y + _radius );
+						float invcy = 1.0f / ( float ) ( bottom - top + 1 );
+						for( size_t i = 0; i < np; i++ )
+							boxRow( means[ i ], cols[ i ], invcy );
+
+						_kernel.store( outbuf.ptr(), &means[ 0 ], y );
+					}
+				}
+			}
+
+		private:
+			void boxRow( float* dst, const float* col, float invcy ) const
+			{
+				const size_t w = _width;
+				const size_t r = _radius;
+				size_t x;
+
+				float sum = 0.0f;
+				size_t rend = Math::min( r, w - 1 );
+				for( x = 0; x <= rend; x++ )
+					sum += col[ x ];
+
+				for( x = 0; x < w; x++ ) {
+					dst[ x ] = sum * _invcx[ x ] * invcy;
+					if( x + r + 1 < w )
+						sum += col[ x + r + 1 ];
+					if( x >= r )
+						sum -= col[ x - r ];
+				}
+			}
+
+			const Kernel&		_kernel;
+			size_t				_width;
+			size_t				_height;
+			size_t				_radius;
+			size_t				_bandHeight;
+			std::vector<float>	_invcx;
+	};
+
+#define CVT_GUIDEDFILTER_BAND_ROWS 64
+
+	template<typename Kernel>
+	static void _gfBoxSweep( const Kernel& kernel, size_t width, size_t height, size_t radius )
+	{
+		size_t bands = ( height + CVT_GUIDEDFILTER_BAND_ROWS - 1 ) / CVT_GUIDEDFILTER_BAND_ROWS;
+		GFBoxBody<Kernel> body( kernel, width, height, radius, CVT_GUIDEDFILTER_BAND_ROWS );
+		parallelFor( 0, bands, body );
+	}
+
+	/* linear coefficients a, b for independent guide/source channel pairs */
+	class GFPairStats {
+		public:
+			GFPairStats( float* coeff, size_t width, size_t height, const GFImageRows& guide, const GFImageRows& src,
+						 const std::vector<size_t>& guideChannels, const std::vector<size_t>& srcChannels, float epsilon ) :
+				_coeff( coeff ), _width( width ), _height( height ), _guide( guide ), _src( src ),
+				_gc( guideChannels ), _sc( srcChannels ), _epsilon( epsilon ), _simd( SIMD::instance() )
+			{
+			}
+
+			size_t numPlanes() const { return 4 * _gc.size(); }
+			size_t numOutputs() const { return 2 * _gc.size(); }
+
+			void planes( float** dst, size_t y ) const
+			{
+				const float* g = _guide.line( y );
+				const float* s = _src.line( y );
+				for( size_t i = 0; i < _gc.size(); i++ ) {
+					float** p = dst + 4 * i;
+					_gfChannel( p[ 0 ], g, _guide.channels(), _gc[ i ], _width );
+					_gfChannel( p[ 1 ], s, _src.channels(), _sc[ i ], _width );
+					_simd->Mul( p[ 2 ], p[ 0 ], p[ 1 ], _width );
+					_simd->Mul( p[ 3 ], p[ 0 ], p[ 0 ], _width );
+				}
+			}
+
+			void store( float** out, const float* const* mean, size_t y ) const
+			{
+				_gfCoeffRows( out, _coeff, 2 * _gc.size(), _width, _height, y );
+				for( size_t i = 0; i < _gc.size(); i++ ) {
+					const float* const* m = mean + 4 * i;
+					float* a = out[ 2 * i ];
+					float* b = out[ 2 * i + 1 ];
+					for( size_t x = 0; x < _width; x++ ) {
+						float var = m[ 3 ][ x ] - m[ 0 ][ x ] * m[ 0 ][ x ];
+						float cov = m[ 2 ][ x ] - m[ 0 ][ x ] * m[ 1 ][ x ];
+						a[ x ] = cov / ( var + _epsilon );
+						b[ x ] = m[ 1 ][ x ] - a[ x ] * m[ 0 ][ x ];
+					}
+				}
+			}
+
+		private:
+			float*						_coeff;
+			size_t						_width;
+			size_t						_height;
+			const GFImageRows&			_guide;
+			const GFImageRows&			_src;
+			const std::vector<size_t>&	_gc;
+			const std::vector<size_t>&	_sc;
+			float						_epsilon;
+			SIMD*						_simd;
+	};
+
+	/* linear coefficients using the full RGB covariance of the guide */
+	class GFCovStats {
+		public:
+			GFCovStats( float* coeff, size_t width, size_t height, const GFImageRows& guide, const GFImageRows& src,
+						size_t channels, float epsilon ) :
+				_coeff( coeff ), _width( width ), _height( height ), _guide( guide ), _src( src ),
+				_channels( channels ), _epsilon( epsilon ), _simd( SIMD::instance() )
+			{
+			}
+
+			size_t numPlanes() const { return 9 + 4 * _channels; }
+			size_t numOutputs() const { return 4 * _channels; }
+
+			void planes( float** dst, size_t y ) const
+			{
+				const float* g = _guide.line( y );
+				const float* s = _src.line( y );
+
+				_gfChannel( dst[ 0 ], g, _guide.channels(), 0, _width );
+				_gfChannel( dst[ 1 ], g, _guide.channels(), 1, _width );
+				_gfChannel( dst[ 2 ], g, _guide.channels(), 2, _width );
+				_simd->Mul( dst[ 3 ], dst[ 0 ], dst[ 0 ], _width );
+				_simd->Mul( dst[ 4 ], dst[ 0 ], dst[ 1 ], _width );
+				_simd->Mul( dst[ 5 ], dst[ 0 ], dst[ 2 ], _width );
+				_simd->Mul( dst[ 6 ], dst[ 1 ], dst[ 1 ], _width );
+				_simd->Mul( dst[ 7 ], dst[ 1 ], dst[ 2 ], _width );
+				_simd->Mul( dst[ 8 ], dst[ 2 ], dst[ 2 ], _width );
+
+				for( size_t k = 0; k < _channels; k++ ) {
+					float** p = dst + 9 + 4 * k;
+					_gfChannel( p[ 0 ], s, _src.channels(), k, _width );
+					_simd->Mul( p[ 1 ], dst[ 0 ], p[ 0 ], _width );
+					_simd->Mul( p[ 2 ], dst[ 1 ], p[ 0 ], _width );
+					_simd->Mul( p[ 3 ], dst[ 2 ], p[ 0 ], _width );
+				}
+			}
+
+			void store( float** coeff, const float* const* m, size_t y ) const
+			{
+				_gfCoeffRows( coeff, _coeff, 4 * _channels, _width, _height, y );
+
+				for( size_t x = 0; x < _width; x++ ) {
+					float mr = m[ 0 ][ x ];
+					float mg = m[ 1 ][ x ];
+					float mb = m[ 2 ][ x ];
+
+					// regularized covariance of the guide
+					float s00 = m[ 3 ][ x ] - mr * mr + _epsilon;
+					float s01 = m[ 4 ][ x ] - mr * mg;
+					float s02 = m[ 5 ][ x ] - mr * mb;
+					float s11 = m[ 6 ][ x ] - mg * mg + _epsilon;
+					float s12 = m[ 7 ][ x ] - mg * mb;
+					float s22 = m[ 8 ][ x ] - mb * mb + _epsilon;
+
+					// inverse via the adjugate
+					float c00 = s11 * s22 - s12 * s12;
+					float c01 = s02 * s12 - s01 * s22;
+					float c02 = s01 * s12 - s02 * s11;
+					float c11 = s00 * s22 - s02 * s02;
+					float c12 = s01 * s02 - s00 * s12;
+					float c22 = s00 * s11 - s01 * s01;
+					float invdet = 1.0f / ( s00 * c00 + s01 * c01 + s02 * c02 );
+
+					for( size_t k = 0; k < _channels; k++ ) {
+						const float* const* p = m + 9 + 4 * k;
+						float mp = p[ 0 ][ x ];
+						float cr = p[ 1 ][ x ] - mr * mp;
+						float cg = p[ 2 ][ x ] - mg * mp;
+						float cb = p[ 3 ][ x ] - mb * mp;
+
+						float a0 = ( c00 * cr + c01 * cg + c02 * cb ) * invdet;
+						float a1 = ( c01 * cr + c11 * cg + c12 * cb ) * invdet;
+						float a2 = ( c02 * cr + c12 * cg + c22 * cb ) * invdet;
+
+						coeff[ 4 * k     ][ x ] = a0;
+						coeff[ 4 * k + 1 ][ x ] = a1;
+						coeff[ 4 * k + 2 ][ x ] = a2;
+						coeff[ 4 * k + 3 ][ x ] = mp - ( a0 * mr + a1 * mg + a2 * mb );
+					}
+				}
+			}
+
+		private:
+			float*				_coeff;
+			size_t				_width;
+			size_t				_height;
+			const GFImageRows&	_guide;
+			const GFImageRows&	_src;
+			size_t				_channels;
+			float				_epsilon;
+			SIMD*				_simd;
+	};
+
+	/* output q = a * I + b from the (averaged) coefficients and the full resolution guide */
+	class GFCombine {
+		public:
+			GFCombine( uint8_t* dst, size_t dstStride, size_t dstChannels, size_t width, const GFImageRows& guide, bool cov,
+					   const std::vector<size_t>& guideChannels, const std::vector<size_t>& outChannels, const std::vector<float>& weights ) :
+				_dst( dst ), _dstStride( dstStride ), _dstChannels( dstChannels ), _width( width ), _guide( guide ), _cov( cov ),
+				_gc( guideChannels ), _oc( outChannels ), _weights( weights )
+			{
+			}
+
+			void row( const float* const* coeff, size_t y ) const
+			{
+				const float* g = _guide.line( y );
+				const size_t gch = _guide.channels();
+				const size_t dch = _dstChannels;
+				float* out = ( float* ) ( _dst + y * _dstStride );
+
+				if( _cov ) {
+					size_t n = _oc.size();
+					for( size_t x = 0; x < _width; x++ ) {
+						const float* I = g + x * gch;
+						for( size_t k = 0; k < n; k++ ) {
+							const float* const* c = coeff + 4 * k;
+							out[ x * dch + k ] = c[ 0 ][ x ] * I[ 0 ] + c[ 1 ][ x ] * I[ 1 ] + c[ 2 ][ x ] * I[ 2 ] + c[ 3 ][ x ];
+						}
+						for( size_t k = n; k < dch; k++ )
+							out[ x * dch + k ] = 1.0f;
+					}
+					return;
+				}
+
+				memset( out, 0, sizeof( float ) * _width * dch );
+				for( size_t i = 0; i < _gc.size(); i++ ) {
+					const float* a = coeff[ 2 * i ];
+					const float* b = coeff[ 2 * i + 1 ];
+					const float* I = g + _gc[ i ];
+					float* o = out + _oc[ i ];
+					float w = _weights[ i ];
+					for( size_t x = 0; x < _width; x++ )
+						o[ x * dch ] += w * ( a[ x ] * I[ x * gch ] + b[ x ] );
+				}
+			}
+
+		private:
+			uint8_t*					_dst;
+			size_t						_dstStride;
+			size_t						_dstChannels;
+			size_t						_width;
+			const GFImageRows&			_guide;
+			bool						_cov;
+			const std::vector<size_t>&	_gc;
+			const std::vector<size_t>&	_oc;
+			const std::vector<float>&	_weights;
+	};
+
+	/* box means of the coefficient planes, either combined directly or stored */
+	class GFCoeffMeans {
+		public:
+			GFCoeffMeans( const float* coeff, size_t numPlanes, size_t width, size_t height, const GFCombine* combine, float* dst ) :
+				_coeff( coeff ), _numPlanes( numPlanes ), _width( width ), _height( height ), _combine( combine ), _dst( dst )
+			{
+			}
+
+			size_t numPlanes() const { return _numPlanes; }
+			size_t numOutputs() const { return _combine ? 0 : _numPlanes; }
+
+			void planes( float** dst, size_t y ) const
+			{
+				for( size_t j = 0; j < _numPlanes; j++ )
+					memcpy( dst[ j ], _coeff + ( j * _height + y ) * _width, sizeof( float ) * _width );
+			}
+
+			void store( float** out, const float* const* mean, size_t y ) const
+			{
+				if( _combine ) {
+					_combine->row( mean, y );
+					return;
+				}
+				_gfCoeffRows( out, _dst, _numPlanes, _width, _height, y );
+				for( size_t j = 0; j < _numPlanes; j++ )
+					memcpy( out[ j ], mean[ j ], sizeof( float ) * _width );
+			}
+
+		private:
+			const float*		_coeff;
+			size_t				_numPlanes;
+			size_t				_width;
+			size_t				_height;
+			const GFCombine*	_combine;
+			float*				_dst;
+	};
+
+	/* bilinear upsampling of subsampled coefficients for the fast guided filter */
+	class GFUpsampleBody {
+		public:
+			GFUpsampleBody( const GFCombine& combine, const float* coeff, size_t numPlanes, size_t lwidth, size_t lheight,
+							size_t width, size_t height, size_t factor ) :
+				_combine( combine ), _coeff( coeff ), _numPlanes( numPlanes ), _lwidth( lwidth ), _lheight( lheight ),
+				_width( width ), _height( height ), _factor( factor ), _x0( width ), _x1( width ), _fx( width )
+			{
+				for( size_t x = 0; x < width; x++ )
+					position( _x0[ x ], _x1[ x ], _fx[ x ], x, lwidth );
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				ScopedBuffer<float, true> rowbuf( _numPlanes * _width );
+				std::vector<float*> rows( _numPlanes );
+				for( size_t j = 0; j < _numPlanes; j++ )
+					rows[ j ] = rowbuf.ptr() + j * _width;
+
+				for( size_t y = begin; y < end; y++ ) {
+					size_t y0, y1;
+					float fy;
+					position( y0, y1, fy, y, _lheight );
+
+					for( size_t j = 0; j < _numPlanes; j++ ) {
+						const float* r0 = _coeff + ( j * _lheight + y0 ) * _lwidth;
+						const float* r1 = _coeff + ( j * _lheight + y1 ) * _lwidth;
+						float* dst = rows[ j ];
+						for( size_t x = 0; x < _width; x++ ) {
+							float v0 = Math::mix( r0[ _x0[ x ] ], r0[ _x1[ x ] ], _fx[ x ] );
+							float v1 = Math::mix( r1[ _x0[ x ] ], r1[ _x1[ x ] ], _fx[ x ] );
+							dst[ x ] = Math::mix( v0, v1, fy );
+						}
+					}
+					_combine.row( &rows[ 0 ], y );
+				}
+			}
+
+		private:
+			void position( size_t& i0, size_t& i1, float& frac, size_t i, size_t n ) const
+			{
+				float pos = ( ( float ) i + 0.5f ) / ( float ) _factor - 0.5f;
+				pos = Math::clamp( pos, 0.0f, ( float ) ( n - 1 ) );
+				i0 = ( size_t ) pos;
+				i1 = Math::min( i0 + 1, n - 1 );
+				frac = pos - ( float ) i0;
+			}
+
+			const GFCombine&	_combine;
+			const float*		_coeff;
+			size_t				_numPlanes;
+			size_t				_lwidth;
+			size_t				_lheight;
+			size_t				_width;
+			size_t				_height;
+			size_t				_factor;
+			std::vector<size_t>	_x0;
+			std::vector<size_t>	_x1;
+			std::vector<float>	_fx;
+	};
+
+	static const Image& _gfFloatImage( Image& tmp, const Image& img )
+	{
+		const IFormat& format = img.channels() <= 2 ? IFormat::GRAY_FLOAT : IFormat::RGBA_FLOAT;
+		if( img.format() == format )
+			return img;
+		img.convert( tmp, format );
+		return tmp;
+	}
+
+	void GuidedFilter::applyCPU( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon, bool rgbcovariance, size_t subsample ) const
+	{
+		if( src.width() != guide.width() || src.height() != guide.height() )
+			throw CVTException( "Source and guide image need to have the same size" );
+
+		Image tmpsrc, tmpguide;
+		const Image& srcf = _gfFloatImage( tmpsrc, src );
+		const Image& guidef = _gfFloatImage( tmpguide, guide );
+
+		const size_t width = src.width();
+		const size_t height = src.height();
+		const size_t schannels = srcf.channels();
+		const size_t gchannels = guidef.channels();
+		const size_t r = Math::max( radius, 0 );
+
+		/* setup the channel pairs, see the OpenCL variants */
+		bool cov = rgbcovariance && gchannels == 4;
+		std::vector<size_t> pairGuide, pairSrc, pairOut;
+		std::vector<float>  pairWeight;
+		size_t numCoeff;
+		if( cov ) {
+			// RGB covariance guide, filter gray or RGB
+			size_t n = schannels == 1 ? 1 : 3;
+			for( size_t k = 0; k < n; k++ )
+				pairOut.push_back( k );
+			numCoeff = 4 * n;
+		} else {
+			if( schannels == 1 ) {
+				// gray source, average the result over the guide channels
+				size_t n = gchannels == 1 ? 1 : 3;
+				for( size_t c = 0; c < n; c++ ) {
+					pairGuide.push_back( c );
+					pairSrc.push_back( 0 );
+					pairOut.push_back( 0 );
+					pairWeight.push_back( 1.0f / ( float ) n );
+				}
+			} else {
+				// color source, channel-wise
+				for( size_t c = 0; c < 4; c++ ) {
+					pairGuide.push_back( gchannels == 1 ? 0 : c );
+					pairSrc.push_back( c );
+					pairOut.push_back( c );
+					pairWeight.push_back( 1.0f );
+				}
+			}
+			numCoeff = 2 * pairGuide.size();
+		}
+
+		Image dstf;
+		bool direct = ( src.format() == srcf.format() );
+		Image& out = direct ? dst : dstf;
+		out.reallocate( width, height, srcf.format() );
+
+		IMapScoped<float> outmap( out );
+		IMapScoped<const float> guidemap( guidef );
+		GFImageRows guiderows( ( const uint8_t* ) guidemap.ptr(), guidemap.stride(), gchannels );
+		GFCombine combine( ( uint8_t* ) outmap.ptr(), outmap.stride(), schannels, width, guiderows, cov, pairGuide, pairOut, pairWeight );
+
+		size_t factor = Math::max<size_t>( subsample, 1 );
+		size_t lwidth = ( width + factor - 1 ) / factor;
+		size_t lheight = ( height + factor - 1 ) / factor;
+		if( lwidth < 2 || lheight < 2 )
+			factor = 1;
+
+		if( factor == 1 ) {
+			IMapScoped<const float> srcmap( srcf );
+			GFImageRows srcrows( ( const uint8_t* ) srcmap.ptr(), srcmap.stride(), schannels );
+
+			ScopedBuffer<float, true> coeff( numCoeff * width * height );
+			if( cov ) {
+				GFCovStats stats( coeff.ptr(), width, height, guiderows, srcrows, pairOut.size(), epsilon );
+				_gfBoxSweep( stats, width, height, r );
+			} else {
+				GFPairStats stats( coeff.ptr(), width, height, guiderows, srcrows, pairGuide, pairSrc, epsilon );
+				_gfBoxSweep( stats, width, height, r );
+			}
+
+			GFCoeffMeans means( coeff.ptr(), numCoeff, width, height, &combine, 0 );
+			_gfBoxSweep( means, width, height, r );
+		} else {
+			/* fast guided filter: coefficients on the subsampled images */
+			IScaleFilterBilinear sfilter;
+			Image srcl, guidel;
+			srcf.scale( srcl, lwidth, lheight, sfilter );
+			guidef.scale( guidel, lwidth, lheight, sfilter );
+			size_t lr = Math::max<size_t>( r / factor, 1 );
+
+			IMapScoped<const float> srcmap( srcl );
+			IMapScoped<const float> guidelmap( guidel );
+			GFImageRows srcrows( ( const uint8_t* ) srcmap.ptr(), srcmap.stride(), schannels );
+			GFImageRows guidelrows( ( const uint8_t* ) guidelmap.ptr(), guidelmap.stride(), gchannels );
+
+			ScopedBuffer<float, true> coeff( numCoeff * lwidth * lheight );
+			ScopedBuffer<float, true> coeffmean( numCoeff * lwidth * lheight );
+			if( cov ) {
+				GFCovStats stats( coeff.ptr(), lwidth, lheight, guidelrows, srcrows, pairOut.size(), epsilon );
+				_gfBoxSweep( stats, lwidth, lheight, lr );
+			} else {
+				GFPairStats stats( coeff.ptr(), lwidth, lheight, guidelrows, srcrows, pairGuide, pairSrc, epsilon );
+				_gfBoxSweep( stats, lwidth, lheight, lr );
+			}
+
+			GFCoeffMeans means( coeff.ptr(), numCoeff, lwidth, lheight, 0, coeffmean.ptr() );
+			_gfBoxSweep( means, lwidth, lheight, lr );
+
+			GFUpsampleBody upsample( combine, coeffmean.ptr(), numCoeff, lwidth, lheight, width, height, factor );
+			parallelFor( 0, height, upsample, parallelGrain( height ) );
+		}
+
+		if( !direct ) {
+			outmap.reset();
+			dstf.convert( dst, src.format() );
+		}
+	}
+
 	void GuidedFilter::apply( const ParamSet* set, IFilterType t ) const
 	{
 		Image * in = set->arg<Image*>( 0 );
@@ -215,12 +809,15 @@ namespace cvt {
 		Image * out = set->arg<Image*>( 2 );
 		int radius = set->arg<int>( 3 );
 		float epsilon = set->arg<float>( 4 );
-
+		int subsample = set->arg<int>( 5 );
 
 		switch ( t ) {
 			case IFILTER_OPENCL:
 				this->apply( *out, *in, guide?*guide:*in, radius, epsilon );
 				break;
+			case IFILTER_CPU:
+				this->applyCPU( *out, *in, guide?*guide:*in, radius, epsilon, false, Math::max( subsample, 1 ) );
+				break;
 			default:
 				throw CVTException( "Not implemented" );
 		}
@@ -39,8 +39,20 @@ namespace cvt {
 			GuidedFilter();
 			~GuidedFilter() {};
 
+			/**
+			  \brief Guided filter, uses OpenCL for images in OpenCL memory and the CPU otherwise
+			 */
 			void apply( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon, bool rgbcovariance = false ) const;
 
+			/**
+			  \brief Guided filter on the CPU
+			  \param subsample	compute the linear coefficients on a grid subsampled by this factor ( fast guided filter )
+			 */
+			void applyCPU( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon, bool rgbcovariance = false, size_t subsample = 1 ) const;
+
+			/**
+			  \brief ParamSet interface, the "Subsample" factor of the fast guided filter is only used on the CPU
+			 */
 			void apply( const ParamSet* attribs, IFilterType iftype ) const;
 
 		private:
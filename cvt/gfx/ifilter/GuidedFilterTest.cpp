@@ -0,0 +1,228 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/gfx/ifilter/GuidedFilter.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/Math.h>
+#include <cvt/math/Matrix.h>
+#include <cvt/util/CVTTest.h>
+
+#include <vector>
+
+namespace cvt {
+
+	typedef std::vector<float> GFPlane;
+
+	/* mean over the window clipped to the image */
+	static float _gfRefMean( const GFPlane& p, int w, int h, int x, int y, int r )
+	{
+		float sum = 0.0f;
+		int n = 0;
+		for( int yy = Math::max( y - r, 0 ); yy <= Math::min( y + r, h - 1 ); yy++ ) {
+			for( int xx = Math::max( x - r, 0 ); xx <= Math::min( x + r, w - 1 ); xx++ ) {
+				sum += p[ yy * w + xx ];
+				n++;
+			}
+		}
+		return sum / ( float ) n;
+	}
+
+	static GFPlane _gfRefProduct( const GFPlane& a, const GFPlane& b )
+	{
+		GFPlane ret( a.size() );
+		for( size_t i = 0; i < a.size(); i++ )
+			ret[ i ] = a[ i ] * b[ i ];
+		return ret;
+	}
+
+	/* guided filter of p with the single channel guide I */
+	static GFPlane _gfRefGray( const GFPlane& I, const GFPlane& p, int w, int h, int r, float eps )
+	{
+		GFPlane Ip = _gfRefProduct( I, p ), II = _gfRefProduct( I, I );
+		GFPlane a( w * h ), b( w * h ), q( w * h );
+		for( int y = 0; y < h; y++ ) {
+			for( int x = 0; x < w; x++ ) {
+				float mI = _gfRefMean( I, w, h, x, y, r );
+				float mp = _gfRefMean( p, w, h, x, y, r );
+				float cov = _gfRefMean( Ip, w, h, x, y, r ) - mI * mp;
+				float var = _gfRefMean( II, w, h, x, y, r ) - mI * mI;
+				a[ y * w + x ] = cov / ( var + eps );
+				b[ y * w + x ] = mp - a[ y * w + x ] * mI;
+			}
+		}
+		for( int y = 0; y < h; y++ )
+			for( int x = 0; x < w; x++ )
+				q[ y * w + x ] = _gfRefMean( a, w, h, x, y, r ) * I[ y * w + x ] + _gfRefMean( b, w, h, x, y, r );
+		return q;
+	}
+
+	/* guided filter of p with the RGB covariance of the guide I[ 0..2 ] */
+	static GFPlane _gfRefCov( const GFPlane* I, const GFPlane& p, int w, int h, int r, float eps )
+	{
+		GFPlane a[ 4 ], q( w * h );
+		GFPlane Ip[ 3 ], II[ 3 ][ 3 ];
+		for( int i = 0; i < 3; i++ ) {
+			Ip[ i ] = _gfRefProduct( I[ i ], p );
+			for( int j = 0; j < 3; j++ )
+				II[ i ][ j ] = _gfRefProduct( I[ i ], I[ j ] );
+		}
+		for( int k = 0; k < 4; k++ )
+			a[ k ].resize( w * h );
+
+		for( int y = 0; y < h; y++ ) {
+			for( int x = 0; x < w; x++ ) {
+				float mI[ 3 ], cov[ 3 ];
+				float mp = _gfRefMean( p, w, h, x, y, r );
+				for( int i = 0; i < 3; i++ )
+					mI[ i ] = _gfRefMean( I[ i ], w, h, x, y, r );
+				Matrix3f sigma;
+				for( int i = 0; i < 3; i++ ) {
+					cov[ i ] = _gfRefMean( Ip[ i ], w, h, x, y, r ) - mI[ i ] * mp;
+					for( int j = 0; j < 3; j++ )
+						sigma[ i ][ j ] = _gfRefMean( II[ i ][ j ], w, h, x, y, r ) - mI[ i ] * mI[ j ] + ( i == j ? eps : 0.0f );
+				}
+				Vector3f ak = sigma.inverse() * Vector3f( cov[ 0 ], cov[ 1 ], cov[ 2 ] );
+				for( int i = 0; i < 3; i++ )
+					a[ i ][ y * w + x ] = ak[ i ];
+				a[ 3 ][ y * w + x ] = mp - ( ak[ 0 ] * mI[ 0 ] + ak[ 1 ] * mI[ 1 ] + ak[ 2 ] * mI[ 2 ] );
+			}
+		}
+		for( int y = 0; y < h; y++ ) {
+			for( int x = 0; x < w; x++ ) {
+				float v = _gfRefMean( a[ 3 ], w, h, x, y, r );
+				for( int i = 0; i < 3; i++ )
+					v += _gfRefMean( a[ i ], w, h, x, y, r ) * I[ i ][ y * w + x ];
+				q[ y * w + x ] = v;
+			}
+		}
+		return q;
+	}
+
+	/* smooth random image, returns its channels as planes */
+	static void _gfImage( Image& img, GFPlane* planes, int w, int h, const IFormat& format, float freq )
+	{
+		img.reallocate( w, h, format );
+		const int c = img.channels();
+		float phase[ 4 ][ 2 ];
+		for( int k = 0; k < c; k++ ) {
+			planes[ k ].resize( w * h );
+			phase[ k ][ 0 ] = Math::rand( 0.0f, 6.0f );
+			phase[ k ][ 1 ] = Math::rand( 0.0f, 6.0f );
+		}
+
+		IMapScoped<float> map( img );
+		for( int y = 0; y < h; y++ ) {
+			float* ptr = map.ptr();
+			for( int x = 0; x < w; x++ ) {
+				for( int k = 0; k < c; k++ ) {
+					float v = 0.5f + 0.2f * Math::sin( freq * x + phase[ k ][ 0 ] ) * Math::cos( freq * 0.7f * y + phase[ k ][ 1 ] )
+								+ 0.05f * Math::rand( -1.0f, 1.0f );
+					ptr[ x * c + k ] = planes[ k ][ y * w + x ] = v;
+				}
+			}
+			map++;
+		}
+	}
+
+	static float _gfMaxDiff( const Image& img, const GFPlane* planes, int channels )
+	{
+		IMapScoped<const float> map( img );
+		float ret = 0.0f;
+		const int w = img.width();
+		for( size_t y = 0; y < img.height(); y++ ) {
+			const float* ptr = map.ptr();
+			for( int x = 0; x < w; x++ )
+				for( int k = 0; k < channels; k++ )
+					ret = Math::max( ret, Math::abs( ptr[ x * img.channels() + k ] - planes[ k ][ y * w + x ] ) );
+			map++;
+		}
+		return ret;
+	}
+
+	static void _gfApply( const GuidedFilter& gf, Image& dst, const Image& src, const Image& guide, int radius, float eps, int subsample )
+	{
+		ParamSet* set = gf.parameterSet();
+		set->setArg<Image*>( set->paramHandle( "Input" ), ( Image* ) &src );
+		set->setArg<Image*>( set->paramHandle( "Guide" ), ( Image* ) &guide );
+		set->setArg<Image*>( set->paramHandle( "Output" ), &dst );
+		set->setArg<int>( set->paramHandle( "Radius" ), radius );
+		set->setArg<float>( set->paramHandle( "Epsilon" ), eps );
+		set->setArg<int>( set->paramHandle( "Subsample" ), subsample );
+		gf.apply( set, IFILTER_CPU );
+		delete set;
+	}
+
+}
+
+using namespace cvt;
+
+BEGIN_CVTTEST( GuidedFilter )
+	bool ret = true;
+	bool b;
+
+	/* taller than one band of rows, so the bands have to line up */
+	const int w = 53, h = 150, r = 4;
+	const float eps = 0.01f;
+	GuidedFilter gf;
+	Image src, srcrgba, guide, guidergba, out;
+	GFPlane p[ 4 ], prgba[ 4 ], I[ 4 ], Irgba[ 4 ];
+	_gfImage( src, p, w, h, IFormat::GRAY_FLOAT, 0.3f );
+	_gfImage( srcrgba, prgba, w, h, IFormat::RGBA_FLOAT, 0.3f );
+	_gfImage( guide, I, w, h, IFormat::GRAY_FLOAT, 0.2f );
+	_gfImage( guidergba, Irgba, w, h, IFormat::RGBA_FLOAT, 0.2f );
+
+	GFPlane ref[ 4 ];
+	ref[ 0 ] = _gfRefGray( I[ 0 ], p[ 0 ], w, h, r, eps );
+	gf.applyCPU( out, src, guide, r, eps );
+	b = _gfMaxDiff( out, ref, 1 ) < 1e-4f;
+	CVTTEST_PRINT( "GuidedFilter CPU gray guide", b );
+	ret &= b;
+
+	for( int k = 0; k < 4; k++ )
+		ref[ k ] = _gfRefGray( Irgba[ k ], prgba[ k ], w, h, r, eps );
+	gf.applyCPU( out, srcrgba, guidergba, r, eps );
+	b = _gfMaxDiff( out, ref, 4 ) < 1e-4f;
+	CVTTEST_PRINT( "GuidedFilter CPU color guide, per channel", b );
+	ret &= b;
+
+	ref[ 0 ] = _gfRefCov( Irgba, p[ 0 ], w, h, r, eps );
+	gf.applyCPU( out, src, guidergba, r, eps, true );
+	b = _gfMaxDiff( out, ref, 1 ) < 1e-4f;
+	CVTTEST_PRINT( "GuidedFilter CPU RGB covariance", b );
+	ret &= b;
+
+	/* the ParamSet interface, with and without the fast guided filter */
+	Image fast;
+	ref[ 0 ] = _gfRefGray( I[ 0 ], p[ 0 ], w, h, 2 * r, eps );
+	_gfApply( gf, out, src, guide, 2 * r, eps, 1 );
+	b = _gfMaxDiff( out, ref, 1 ) < 1e-4f;
+	_gfApply( gf, fast, src, guide, 2 * r, eps, 2 );
+	b &= fast.width() == ( size_t ) w && fast.height() == ( size_t ) h;
+	b &= _gfMaxDiff( fast, ref, 1 ) < 0.05f;
+	CVTTEST_PRINT( "GuidedFilter ParamSet, Subsample 1 and 2", b );
+	ret &= b;
+
+	return ret;
+END_CVTTEST
@@ -35,46 +35,105 @@
 #include <cvt/cl/kernel/tvl1flow/tvl1_dataadd.h>
 
 #include <cvt/vision/Flow.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/ThreadPool.h>
+
+#include <xmmintrin.h>
+#include <algorithm>
 
 namespace cvt {
 		static ParamInfoTyped<Image*> pin( "Input", true );
+		static ParamInfoTyped<Image*> pin2( "Input2", true );
 		static ParamInfoTyped<Image*> pout( "Output", false );
 
-		static ParamInfo * _params[ 2 ] = {
+		static ParamInfo * _params[ 3 ] = {
 			&pin,
+			&pin2,
 			&pout,
 		};
 
-		TVL1Flow::TVL1Flow( float scalefactor, size_t levels ) : IFilter( "TVL1Flow", _params, 2, IFILTER_OPENCL ),
+		TVL1Flow::TVL1Flow( float scalefactor, size_t levels ) : IFilter( "TVL1Flow", _params, 3, IFILTER_CPU | IFILTER_OPENCL ),
 			_toggle( false ),
 			_scalefactor( scalefactor ),
 			_levels( levels ),
-			_pyrup( _pyrupmul_source, "pyrup_mul" ),
-//			_pyrdown( _pyrdown_source, "pyrdown" ),
-			_pyrdown( _pyrdown_source, "pyrdown" ),
-			_tvl1( _tvl1_source, "tvl1" ),
-			_tvl1_warp( _tvl1_warp_source, "tvl1_warp" ),
-//			_tvl1_dataadd( _tvl1_dataadd_source, "tvl1_dataadd" ),
-			_clear( _clear_source, "clear" ),
-			_median3( _median3_source, "median3" ),
-			_lambda( 70.0f )
+			_pyrup( 0 ),
+			_pyrdown( 0 ),
+			_tvl1( 0 ),
+			_tvl1_warp( 0 ),
+			_clear( 0 ),
+			_median3( 0 ),
+			_lambda( 70.0f ),
+			_convergence( 0.0f )
 		{
 			_pyr[ 0 ] = new Image[ levels ];
 			_pyr[ 1 ] = new Image[ levels ];
+			_cpupyr[ 0 ] = new Image[ levels ];
+			_cpupyr[ 1 ] = new Image[ levels ];
 		}
 
 		TVL1Flow::~TVL1Flow()
 		{
 			delete[ ] _pyr[ 0 ];
 			delete[ ] _pyr[ 1 ];
+			delete[ ] _cpupyr[ 0 ];
+			delete[ ] _cpupyr[ 1 ];
+			delete _pyrup;
+			delete _pyrdown;
+			delete _tvl1;
+			delete _tvl1_warp;
+			delete _clear;
+			delete _median3;
 		}
 
 		void TVL1Flow::apply( Image& output, const Image& src1, const Image& src2 )
+		{
+			if( src1.memType() != IALLOCATOR_CL )
+				applyCPU( output, src1, src2 );
+			else
+				applyCL( output, src1, src2 );
+		}
+
+		void TVL1Flow::apply( const ParamSet* set, IFilterType t ) const
+		{
+			Image* in = set->arg<Image*>( 0 );
+			Image* in2 = set->arg<Image*>( 1 );
+			Image* out = set->arg<Image*>( 2 );
+
+			/* the pyramids, buffers and kernels are cached in the filter */
+			TVL1Flow* self = const_cast<TVL1Flow*>( this );
+			switch ( t ) {
+				case IFILTER_OPENCL:
+					self->applyCL( *out, *in, *in2 );
+					break;
+				case IFILTER_CPU:
+					self->applyCPU( *out, *in, *in2 );
+					break;
+				default:
+					throw CVTException( "Not implemented" );
+			}
+		}
+
+		/* the kernels are only built on the first OpenCL call, so CPU-only hosts never need OpenCL */
+		void TVL1Flow::initCL()
+		{
+			if( _pyrup )
+				return;
+			_pyrup = new CLKernel( _pyrupmul_source, "pyrup_mul" );
+			_pyrdown = new CLKernel( _pyrdown_source, "pyrdown" );
+			_tvl1 = new CLKernel( _tvl1_source, "tvl1" );
+			_tvl1_warp = new CLKernel( _tvl1_warp_source, "tvl1_warp" );
+			_clear = new CLKernel( _clear_source, "clear" );
+			_median3 = new CLKernel( _median3_source, "median3" );
+		}
+
+		void TVL1Flow::applyCL( Image& output, const Image& src1, const Image& src2 )
 		{
 			if( src1.width() != src2.width() ||
 			    src1.height() != src2.height() )
 				throw CVTException( "Image do not match in size!" );
 
+			initCL();
 			fillPyramidCL( src1, 0 );
 			fillPyramidCL( src2, 1 );
 
@@ -95,13 +154,13 @@ namespace cvt {
 
 				flow = new Image( _pyr[ 0 ][ l ].width(), _pyr[ 0 ][ l ].height(), IFormat::GRAYALPHA_FLOAT, IALLOCATOR_CL );
 				if( flowold ) {
-					_pyrup.setArg( 0, *flow );
-					_pyrup.setArg( 1, *flowold );
-					_pyrup.setArg( 2, 1.0f / _scalefactor );
-					_pyrup.run( CLNDRange( Math::pad( flow->width(), PYRUPWGSIZE ), Math::pad( flow->height(), PYRUPWGSIZE ) ), CLNDRange( PYRUPWGSIZE, PYRUPWGSIZE ) );
+					_pyrup->setArg( 0, *flow );
+					_pyrup->setArg( 1, *flowold );
+					_pyrup->setArg( 2, 1.0f / _scalefactor );
+					_pyrup->run( CLNDRange( Math::pad( flow->width(), PYRUPWGSIZE ), Math::pad( flow->height(), PYRUPWGSIZE ) ), CLNDRange( PYRUPWGSIZE, PYRUPWGSIZE ) );
 				} else {
-					_clear.setArg( 0, *flow );
-					_clear.run( CLNDRange(Math::pad( flow->width(), 16 ), Math::pad( flow->height(), 16 ) ), CLNDRange( 16, 16 ));
+					_clear->setArg( 0, *flow );
+					_clear->run( CLNDRange(Math::pad( flow->width(), 16 ), Math::pad( flow->height(), 16 ) ), CLNDRange( 16, 16 ));
 				}
 
 				//float tmp = _lambda;
@@ -131,10 +190,10 @@ namespace cvt {
 			Image p1( flow.width(), flow.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL );
 			//Image p2( flow.width(), flow.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL );
 
-			_clear.setArg( 0, p1 );
-			_clear.run( CLNDRange(Math::pad( flow.width(), 16 ), Math::pad( flow.height(), 16 ) ), CLNDRange( 16, 16 ));
-		//	_clear.setArg( 0, p2 );
-		//	_clear.run( CLNDRange(Math::pad( flow.width(), 16 ), Math::pad( flow.height(), 16 ) ), CLNDRange( 16, 16 ));
+			_clear->setArg( 0, p1 );
+			_clear->run( CLNDRange(Math::pad( flow.width(), 16 ), Math::pad( flow.height(), 16 ) ), CLNDRange( 16, 16 ));
+		//	_clear->setArg( 0, p2 );
+		//	_clear->run( CLNDRange(Math::pad( flow.width(), 16 ), Math::pad( flow.height(), 16 ) ), CLNDRange( 16, 16 ));
 
 			Image* us[ 2 ] = { &flowtmp, &flow };
 
@@ -142,45 +201,45 @@ namespace cvt {
 			// WARPS
 			for( int i = 0; i < 5; i++ ) {
 				if( median ) {
-					_median3.setArg( 0, flow0 );
-					_median3.setArg( 1, *us[ 1 ] );
-					_median3.setArg( 2,  CLLocalSpace( sizeof( cl_float4 ) * ( MEDWGSIZE + 2 ) * ( MEDWGSIZE + 2 ) ) );
-					_median3.run( CLNDRange( Math::pad( flow.width(), MEDWGSIZE ), Math::pad( flow.height(), MEDWGSIZE ) ), CLNDRange( MEDWGSIZE, MEDWGSIZE ) );
+					_median3->setArg( 0, flow0 );
+					_median3->setArg( 1, *us[ 1 ] );
+					_median3->setArg( 2,  CLLocalSpace( sizeof( cl_float4 ) * ( MEDWGSIZE + 2 ) * ( MEDWGSIZE + 2 ) ) );
+					_median3->run( CLNDRange( Math::pad( flow.width(), MEDWGSIZE ), Math::pad( flow.height(), MEDWGSIZE ) ), CLNDRange( MEDWGSIZE, MEDWGSIZE ) );
 				} else
 					flow0 = *us[ 1 ];
 
-				_tvl1_warp.setArg( 0, warp );
-				_tvl1_warp.setArg( 1, flow0 );
-				_tvl1_warp.setArg( 2, src1 );
-				_tvl1_warp.setArg( 3, src2 );
-				_tvl1_warp.setArg( 4, CLLocalSpace( sizeof( cl_float4 ) * ( WARPWGSIZE + 2 ) * ( WARPWGSIZE + 2 ) ) );
-				_tvl1_warp.run( CLNDRange(Math::pad( flow.width(), WARPWGSIZE ), Math::pad( flow.height(), WARPWGSIZE ) ), CLNDRange( WARPWGSIZE, WARPWGSIZE ) );
+				_tvl1_warp->setArg( 0, warp );
+				_tvl1_warp->setArg( 1, flow0 );
+				_tvl1_warp->setArg( 2, src1 );
+				_tvl1_warp->setArg( 3, src2 );
+				_tvl1_warp->setArg( 4, CLLocalSpace( sizeof( cl_float4 ) * ( WARPWGSIZE + 2 ) * ( WARPWGSIZE + 2 ) ) );
+				_tvl1_warp->run( CLNDRange(Math::pad( flow.width(), WARPWGSIZE ), Math::pad( flow.height(), WARPWGSIZE ) ), CLNDRange( WARPWGSIZE, WARPWGSIZE ) );
 
-				//_clear.setArg( 0, *ps[ 1 ] );
-				//_clear.run( CLNDRange(Math::pad( flow.width(), 16 ), Math::pad( flow.height(), 16 ) ), CLNDRange( 16, 16 ));
-				//_clear.setArg( 0, *ps[ 2 ] );
-				//_clear.run( CLNDRange(Math::pad( flow.width(), 16 ), Math::pad( flow.height(), 16 ) ), CLNDRange( 16, 16 ));
+				//_clear->setArg( 0, *ps[ 1 ] );
+				//_clear->run( CLNDRange(Math::pad( flow.width(), 16 ), Math::pad( flow.height(), 16 ) ), CLNDRange( 16, 16 ));
+				//_clear->setArg( 0, *ps[ 2 ] );
+				//_clear->run( CLNDRange(Math::pad( flow.width(), 16 ), Math::pad( flow.height(), 16 ) ), CLNDRange( 16, 16 ));
 
 
 				Image* tmp;
 				// NUMBER of ROF/THRESHOLD iterations
 #define ROFITER 10
 				for( int k = 0; k < ROFITER; k++ ) {
-					_tvl1.setArg( 0, *ps[ 0 ] );
-					_tvl1.setArg( 1, *us[ 0 ] );
-					_tvl1.setArg( 2, *us[ 1 ] );
-					_tvl1.setArg( 3, flow0 );
-					_tvl1.setArg( 4, warp );
-					_tvl1.setArg( 5, *ps[ 1 ] );
-				//	_tvl1.setArg( 6, *ps[ 2 ] );
-//					_tvl1.setArg( 6, _lambda );
-					_tvl1.setArg( 6, _lambda * ( Math::exp( -( float ) ( k / ( float ) ROFITER ) * ( k / ( float ) ROFITER ) * 6.0f ) ) );
-//					_tvl1.setArg( 6, _lambda * ( ( Math::tanh( ( ( float ) ( -k ) + 0.5f * ( float ) ROFITER ) * 0.75f ) * 0.5f + 0.5f ) ) );
-					_tvl1.setArg( 7, THETA );
-//					_tvl1.setArg( 7, THETA * ( Math::exp( -( float ) ( k / ( float ) ROFITER ) * ( k / ( float ) ROFITER ) * 6.0f ) ) );
-					_tvl1.setArg( 8, CLLocalSpace( sizeof( cl_float4 ) * ( TVL1WGSIZE + 2 ) * ( TVL1WGSIZE + 2 ) ) );
-					_tvl1.setArg( 9, CLLocalSpace( sizeof( cl_float4 ) * ( TVL1WGSIZE + 1 ) * ( TVL1WGSIZE + 1 ) ) );
-					_tvl1.run( CLNDRange(Math::pad( flow.width(), TVL1WGSIZE ), Math::pad( flow.height(), TVL1WGSIZE ) ), CLNDRange( TVL1WGSIZE, TVL1WGSIZE ) );
+					_tvl1->setArg( 0, *ps[ 0 ] );
+					_tvl1->setArg( 1, *us[ 0 ] );
+					_tvl1->setArg( 2, *us[ 1 ] );
+					_tvl1->setArg( 3, flow0 );
+					_tvl1->setArg( 4, warp );
+					_tvl1->setArg( 5, *ps[ 1 ] );
+				//	_tvl1->setArg( 6, *ps[ 2 ] );
+//					_tvl1->setArg( 6, _lambda );
+					_tvl1->setArg( 6, _lambda * ( Math::exp( -( float ) ( k / ( float ) ROFITER ) * ( k / ( float ) ROFITER ) * 6.0f ) ) );
+//					_tvl1->setArg( 6, _lambda * ( ( Math::tanh( ( ( float ) ( -k ) + 0.5f * ( float ) ROFITER ) * 0.75f ) * 0.5f + 0.5f ) ) );
+					_tvl1->setArg( 7, THETA );
+//					_tvl1->setArg( 7, THETA * ( Math::exp( -( float ) ( k / ( float ) ROFITER ) * ( k / ( float ) ROFITER ) * 6.0f ) ) );
+					_tvl1->setArg( 8, CLLocalSpace( sizeof( cl_float4 ) * ( TVL1WGSIZE + 2 ) * ( TVL1WGSIZE + 2 ) ) );
+					_tvl1->setArg( 9, CLLocalSpace( sizeof( cl_float4 ) * ( TVL1WGSIZE + 1 ) * ( TVL1WGSIZE + 1 ) ) );
+					_tvl1->run( CLNDRange(Math::pad( flow.width(), TVL1WGSIZE ), Math::pad( flow.height(), TVL1WGSIZE ) ), CLNDRange( TVL1WGSIZE, TVL1WGSIZE ) );
 
 					tmp = ps[ 0 ];
 					ps[ 0 ] = ps[ 1 ];
@@ -192,10 +251,10 @@ namespace cvt {
 //					us[ 1 ] = tmp;
 //					} else {
 
-					_median3.setArg( 0, *us[ 1 ] );
-					_median3.setArg( 1, *us[ 0 ] );
-					_median3.setArg( 2,  CLLocalSpace( sizeof( cl_float4 ) * ( MEDWGSIZE + 2 ) * ( MEDWGSIZE + 2 ) ) );
-					_median3.run( CLNDRange( Math::pad( flow.width(), MEDWGSIZE ), Math::pad( flow.height(), MEDWGSIZE ) ), CLNDRange( MEDWGSIZE, MEDWGSIZE ) );
+					_median3->setArg( 0, *us[ 1 ] );
+					_median3->setArg( 1, *us[ 0 ] );
+					_median3->setArg( 2,  CLLocalSpace( sizeof( cl_float4 ) * ( MEDWGSIZE + 2 ) * ( MEDWGSIZE + 2 ) ) );
+					_median3->run( CLNDRange( Math::pad( flow.width(), MEDWGSIZE ), Math::pad( flow.height(), MEDWGSIZE ) ), CLNDRange( MEDWGSIZE, MEDWGSIZE ) );
 //					}
 
 
@@ -224,11 +283,492 @@ namespace cvt {
 			img.convert( pyr[ 0 ] );
 			for( size_t l = 1; l < _levels; l++ ) {
 				pyr[ l ].reallocate( pyr[ l - 1 ].width() * _scalefactor, pyr[ l - 1 ].height() * _scalefactor, IFormat::RGBA_UINT8, IALLOCATOR_CL );
-				_pyrdown.setArg( 0, pyr[ l ] );
-				_pyrdown.setArg( 1, pyr[ l - 1 ] );
-//				_pyrdown.setArg( 2, CLLocalSpace( sizeof( cl_float4 ) * ( PYRWGSIZE + 4 ) * ( PYRWGSIZE + 4 ) ) );
-//				_pyrdown.setArg( 3, CLLocalSpace( sizeof( cl_float4 ) * ( PYRWGSIZE + 4 ) * PYRWGSIZE ) );
-				_pyrdown.run( CLNDRange( Math::pad( pyr[ l ].width(), PYRWGSIZE ), Math::pad( pyr[ l ].height(), PYRWGSIZE ) ), CLNDRange( PYRWGSIZE, PYRWGSIZE ) );
+				_pyrdown->setArg( 0, pyr[ l ] );
+				_pyrdown->setArg( 1, pyr[ l - 1 ] );
+//				_pyrdown->setArg( 2, CLLocalSpace( sizeof( cl_float4 ) * ( PYRWGSIZE + 4 ) * ( PYRWGSIZE + 4 ) ) );
+//				_pyrdown->setArg( 3, CLLocalSpace( sizeof( cl_float4 ) * ( PYRWGSIZE + 4 ) * PYRWGSIZE ) );
+				_pyrdown->run( CLNDRange( Math::pad( pyr[ l ].width(), PYRWGSIZE ), Math::pad( pyr[ l ].height(), PYRWGSIZE ) ), CLNDRange( PYRWGSIZE, PYRWGSIZE ) );
+			}
+		}
+		/*
+		   CPU implementation
+
+		   The structure follows the OpenCL version: image pyramids, 5 warps per level, each with a 3x3 median of the
+		   flow followed by the thresholding / primal-dual iterations. All flow and dual variables are kept in planar
+		   float buffers, which are reused between levels and calls. One iteration is a single parallel pass over bands
+		   of rows. Each band recomputes the primal update of its one row halo, so the bands only share read-only data
+		   within an iteration and both primal and dual variables are double buffered.
+		 */
+
+#define TVL1_WARPS 5
+#define TVL1_EPS   0.04f
+#define TVL1_BETA  15.0f
+
+		static inline float _tvl1Sample( const float* img, size_t stride, int w, int h, float x, float y )
+		{
+			x = Math::clamp( x, 0.0f, ( float ) ( w - 1 ) );
+			y = Math::clamp( y, 0.0f, ( float ) ( h - 1 ) );
+			int ix = Math::min( ( int ) x, w - 2 );
+			int iy = Math::min( ( int ) y, h - 2 );
+			if( ix < 0 ) ix = 0;
+			if( iy < 0 ) iy = 0;
+			float fx = x - ( float ) ix;
+			float fy = y - ( float ) iy;
+			int ix1 = Math::min( ix + 1, w - 1 );
+			const float* r0 = img + iy * stride;
+			const float* r1 = img + Math::min( iy + 1, h - 1 ) * stride;
+			float v0 = Math::mix( r0[ ix ], r0[ ix1 ], fx );
+			float v1 = Math::mix( r1[ ix ], r1[ ix1 ], fx );
+			return Math::mix( v0, v1, fy );
+		}
+
+		/* bilinear resampling, sampled at the pixel centers like the pyramid kernels */
+		class TVL1Resample {
+			public:
+				TVL1Resample( float* dst, size_t dstride, size_t dw, const float* src, size_t sstride, size_t sw, size_t sh, float mul ) :
+					_dst( dst ), _dstride( dstride ), _dw( dw ), _src( src ), _sstride( sstride ), _sw( sw ), _sh( sh ), _mul( mul ),
+					_incx( ( float ) sw / ( float ) dw ), _incy( 0.0f )
+				{
+				}
+
+				void setHeight( size_t dh ) { _incy = ( float ) _sh / ( float ) dh; }
+
+				void operator()( size_t begin, size_t end ) const
+				{
+					for( size_t y = begin; y < end; y++ ) {
+						float* dst = _dst + y * _dstride;
+						float sy = _incy * ( ( float ) y + 0.5f ) - 0.5f;
+						for( size_t x = 0; x < _dw; x++ )
+							dst[ x ] = _mul * _tvl1Sample( _src, _sstride, _sw, _sh, _incx * ( ( float ) x + 0.5f ) - 0.5f, sy );
+					}
+				}
+
+			private:
+				float*			_dst;
+				size_t			_dstride;
+				size_t			_dw;
+				const float*	_src;
+				size_t			_sstride;
+				size_t			_sw;
+				size_t			_sh;
+				float			_mul;
+				float			_incx;
+				float			_incy;
+		};
+
+		/* rows with one replicated guard pixel on both sides, padded to multiples of four */
+		static inline void _tvl1ReplicateBorder( float* row, size_t w, size_t stride )
+		{
+			row[ -1 ] = row[ 0 ];
+			for( size_t x = w; x < stride + 4; x++ )
+				row[ x ] = row[ w - 1 ];
+		}
+
+#define TVL1_SORT2( a, b ) tmp = a; a = _mm_min_ps( a, b ); b = _mm_max_ps( tmp, b )
+#define TVL1_SORT3( a, b, c ) TVL1_SORT2( a, b ); TVL1_SORT2( b, c ); TVL1_SORT2( a, b )
+
+		/* 3x3 median of three guarded rows, same sorting network as the median3 kernel */
+		static inline void _tvl1MedianRow( float* dst, const float* r0, const float* r1, const float* r2, size_t w )
+		{
+			__m128 v[ 9 ], tmp;
+			for( size_t x = 0; x < w; x += 4 ) {
+				v[ 0 ] = _mm_loadu_ps( r0 + x - 1 );
+				v[ 1 ] = _mm_loadu_ps( r0 + x );
+				v[ 2 ] = _mm_loadu_ps( r0 + x + 1 );
+				v[ 3 ] = _mm_loadu_ps( r1 + x - 1 );
+				v[ 4 ] = _mm_loadu_ps( r1 + x );
+				v[ 5 ] = _mm_loadu_ps( r1 + x + 1 );
+				v[ 6 ] = _mm_loadu_ps( r2 + x - 1 );
+				v[ 7 ] = _mm_loadu_ps( r2 + x );
+				v[ 8 ] = _mm_loadu_ps( r2 + x + 1 );
+
+				TVL1_SORT3( v[ 0 ], v[ 1 ], v[ 2 ] );
+				TVL1_SORT3( v[ 3 ], v[ 4 ], v[ 5 ] );
+				TVL1_SORT3( v[ 6 ], v[ 7 ], v[ 8 ] );
+
+				v[ 5 ] = _mm_min_ps( v[ 2 ], _mm_min_ps( v[ 5 ], v[ 8 ] ) );
+				v[ 3 ] = _mm_max_ps( v[ 0 ], _mm_max_ps( v[ 3 ], v[ 6 ] ) );
+
+				TVL1_SORT3( v[ 1 ], v[ 4 ], v[ 7 ] );
+				TVL1_SORT3( v[ 3 ], v[ 4 ], v[ 5 ] );
+
+				_mm_store_ps( dst + x, v[ 4 ] );
+			}
+		}
+
+		/* flow0 = median3( u ) */
+		class TVL1MedianBody {
+			public:
+				TVL1MedianBody( float** dst, float* const* src, size_t w, size_t h, size_t stride ) :
+					_dst( dst ), _src( src ), _w( w ), _h( h ), _stride( stride )
+				{
+				}
+
+				void operator()( size_t begin, size_t end ) const
+				{
+					ScopedBuffer<float, true> rows( 3 * ( _stride + 8 ) );
+					float* r[ 3 ];
+					for( size_t c = 0; c < 2; c++ ) {
+						for( size_t y = begin; y < end; y++ ) {
+							for( int k = 0; k < 3; k++ ) {
+								size_t yy = Math::clamp<int>( ( int ) y + k - 1, 0, ( int ) _h - 1 );
+								r[ k ] = rows.ptr() + k * ( _stride + 8 ) + 4;
+								memcpy( r[ k ], _src[ c ] + yy * _stride, sizeof( float ) * _w );
+								_tvl1ReplicateBorder( r[ k ], _w, _stride );
+							}
+							_tvl1MedianRow( _dst[ c ] + y * _stride, r[ 0 ], r[ 1 ], r[ 2 ], _w );
+						}
+					}
+				}
+
+			private:
+				float**			_dst;
+				float* const*	_src;
+				size_t			_w;
+				size_t			_h;
+				size_t			_stride;
+		};
+
+		/* linearization of the data term around flow0: I_t, I_x, I_y and the edge weight */
+		class TVL1WarpBody {
+			public:
+				TVL1WarpBody( float** warp, float* const* u0, size_t stride, const float* img1, size_t stride1,
+							  const float* img2, size_t stride2, size_t w, size_t h ) :
+					_warp( warp ), _u0( u0 ), _stride( stride ), _img1( img1 ), _stride1( stride1 ),
+					_img2( img2 ), _stride2( stride2 ), _w( w ), _h( h )
+				{
+				}
+
+				void operator()( size_t begin, size_t end ) const
+				{
+					for( size_t y = begin; y < end; y++ ) {
+						const float* u1 = _u0[ 0 ] + y * _stride;
+						const float* u2 = _u0[ 1 ] + y * _stride;
+						const float* i1 = _img1 + y * _stride1;
+						float* it = _warp[ 0 ] + y * _stride;
+						float* ix = _warp[ 1 ] + y * _stride;
+						float* iy = _warp[ 2 ] + y * _stride;
+						float* wg = _warp[ 3 ] + y * _stride;
+
+						for( size_t x = 0; x < _w; x++ ) {
+							float sx = ( float ) x + u1[ x ];
+							float sy = ( float ) y + u2[ x ];
+							float dx = _tvl1Sample( _img2, _stride2, _w, _h, sx + 1.0f, sy ) - _tvl1Sample( _img2, _stride2, _w, _h, sx - 1.0f, sy );
+							float dy = _tvl1Sample( _img2, _stride2, _w, _h, sx, sy + 1.0f ) - _tvl1Sample( _img2, _stride2, _w, _h, sx, sy - 1.0f );
+
+							it[ x ] = _tvl1Sample( _img2, _stride2, _w, _h, sx, sy ) - i1[ x ];
+							ix[ x ] = 0.5f * dx;
+							iy[ x ] = 0.5f * dy;
+							wg[ x ] = Math::max( 1e-4f, Math::exp( -TVL1_BETA * ( Math::abs( dx ) + Math::abs( dy ) ) ) );
+						}
+					}
+				}
+
+			private:
+				float**			_warp;
+				float* const*	_u0;
+				size_t			_stride;
+				const float*	_img1;
+				size_t			_stride1;
+				const float*	_img2;
+				size_t			_stride2;
+				size_t			_w;
+				size_t			_h;
+		};
+
+		/* one iteration: thresholding, dual ascent on p and median of the primal variable */
+		class TVL1IterationBody {
+			public:
+				TVL1IterationBody( float* const* un, float* const* pn, float* const* u, float* const* p, float* const* u0, float* const* warp,
+								   size_t w, size_t h, size_t stride, size_t bandHeight, float lambda, float theta, double* change ) :
+					_un( un ), _pn( pn ), _u( u ), _p( p ), _u0( u0 ), _warp( warp ),
+					_w( w ), _h( h ), _stride( stride ), _bandHeight( bandHeight ), _lambda( lambda ), _theta( theta ), _change( change )
+				{
+				}
+
+				void operator()( size_t begin, size_t end ) const
+				{
+					const size_t rstride = _stride + 8;
+					ScopedBuffer<float, true> vbuf( 2 * ( _bandHeight + 2 ) * rstride );
+					ScopedBuffer<float, true> zero( _stride );
+					memset( zero.ptr(), 0, sizeof( float ) * _stride );
+
+					for( size_t band = begin; band < end; band++ ) {
+						size_t y0 = band * _bandHeight;
+						size_t y1 = Math::min( _h, y0 + _bandHeight );
+						size_t ys = y0 > 0 ? y0 - 1 : 0;
+						size_t ye = Math::min( _h - 1, y1 );
+						size_t nrows = ye - ys + 1;
+						float* v[ 2 ] = { vbuf.ptr() + 4, vbuf.ptr() + 4 + nrows * rstride };
+
+						// primal update including the halo rows
+						for( size_t y = ys; y <= ye; y++ )
+							primalRow( v[ 0 ] + ( y - ys ) * rstride, v[ 1 ] + ( y - ys ) * rstride, y, zero.ptr() );
+
+						double change = 0.0;
+						for( size_t y = y0; y < y1; y++ ) {
+							const float* va[ 2 ];
+							const float* vb[ 2 ];
+							const float* vc[ 2 ];
+							size_t ya = y > 0 ? y - 1 : 0;
+							size_t yc = Math::min( y + 1, _h - 1 );
+							for( int c = 0; c < 2; c++ ) {
+								va[ c ] = v[ c ] + ( ya - ys ) * rstride;
+								vb[ c ] = v[ c ] + ( y - ys ) * rstride;
+								vc[ c ] = v[ c ] + ( yc - ys ) * rstride;
+							}
+							dualRow( y, vb, vc );
+
+							for( int c = 0; c < 2; c++ ) {
+								float* un = _un[ c ] + y * _stride;
+								const float* u = _u[ c ] + y * _stride;
+								_tvl1MedianRow( un, va[ c ], vb[ c ], vc[ c ], _w );
+								for( size_t x = 0; x < _w; x++ )
+									change += Math::sqr( un[ x ] - u[ x ] );
+							}
+						}
+						_change[ band ] = change;
+					}
+				}
+
+			private:
+				/* v = threshold( u ) + theta * div( p ) */
+				void primalRow( float* v1, float* v2, size_t y, const float* zero ) const
+				{
+					const size_t off = y * _stride;
+					const float* u1 = _u[ 0 ] + off;
+					const float* u2 = _u[ 1 ] + off;
+					const float* u01 = _u0[ 0 ] + off;
+					const float* u02 = _u0[ 1 ] + off;
+					const float* it = _warp[ 0 ] + off;
+					const float* ix = _warp[ 1 ] + off;
+					const float* iy = _warp[ 2 ] + off;
+					const float* p11 = _p[ 0 ] + off;
+					const float* p12 = _p[ 1 ] + off;
+					const float* p21 = _p[ 2 ] + off;
+					const float* p22 = _p[ 3 ] + off;
+					const float* p12up = y > 0 ? p12 - _stride : zero;
+					const float* p22up = y > 0 ? p22 - _stride : zero;
+
+					const __m128 lt = _mm_set1_ps( _lambda * _theta );
+					const __m128 nlt = _mm_set1_ps( -_lambda * _theta );
+					const __m128 theta = _mm_set1_ps( _theta );
+					const __m128 mingrad = _mm_set1_ps( 1e-4f );
+
+					for( size_t x = 0; x < _w; x += 4 ) {
+						__m128 gx = _mm_load_ps( ix + x );
+						__m128 gy = _mm_load_ps( iy + x );
+						__m128 a = _mm_load_ps( u1 + x );
+						__m128 b = _mm_load_ps( u2 + x );
+
+						// rho = I_t + grad I * ( u - u0 ), step clamped to lambda * theta
+						__m128 rho = _mm_add_ps( _mm_load_ps( it + x ),
+												 _mm_add_ps( _mm_mul_ps( gx, _mm_sub_ps( a, _mm_load_ps( u01 + x ) ) ),
+															 _mm_mul_ps( gy, _mm_sub_ps( b, _mm_load_ps( u02 + x ) ) ) ) );
+						__m128 g2 = _mm_add_ps( _mm_mul_ps( gx, gx ), _mm_mul_ps( gy, gy ) );
+						__m128 step = _mm_div_ps( rho, _mm_max_ps( g2, mingrad ) );
+						step = _mm_min_ps( _mm_max_ps( step, nlt ), lt );
+						a = _mm_sub_ps( a, _mm_mul_ps( step, gx ) );
+						b = _mm_sub_ps( b, _mm_mul_ps( step, gy ) );
+
+						// divergence with p = 0 outside of the image
+						__m128 div1 = _mm_add_ps( _mm_sub_ps( _mm_load_ps( p11 + x ), _mm_loadu_ps( p11 + x - 1 ) ),
+												  _mm_sub_ps( _mm_load_ps( p12 + x ), _mm_load_ps( p12up + x ) ) );
+						__m128 div2 = _mm_add_ps( _mm_sub_ps( _mm_load_ps( p21 + x ), _mm_loadu_ps( p21 + x - 1 ) ),
+												  _mm_sub_ps( _mm_load_ps( p22 + x ), _mm_load_ps( p22up + x ) ) );
+
+						_mm_storeu_ps( v1 + x, _mm_add_ps( a, _mm_mul_ps( theta, div1 ) ) );
+						_mm_storeu_ps( v2 + x, _mm_add_ps( b, _mm_mul_ps( theta, div2 ) ) );
+					}
+					_tvl1ReplicateBorder( v1, _w, _stride );
+					_tvl1ReplicateBorder( v2, _w, _stride );
+				}
+
+				/* p = project( p + tau * ( grad v - eps * p ) ), the gradient vanishes at the last row and column */
+				void dualRow( size_t y, const float* const* v, const float* const* vdown ) const
+				{
+					const size_t off = y * _stride;
+					const float* wg = _warp[ 3 ] + off;
+					const float* p[ 4 ] = { _p[ 0 ] + off, _p[ 1 ] + off, _p[ 2 ] + off, _p[ 3 ] + off };
+					float* pn[ 4 ] = { _pn[ 0 ] + off, _pn[ 1 ] + off, _pn[ 2 ] + off, _pn[ 3 ] + off };
+
+					const __m128 tau = _mm_set1_ps( 1.0f / ( 8.0f * _theta ) );
+					const __m128 eps = _mm_set1_ps( TVL1_EPS );
+					__m128 q[ 4 ], g[ 4 ];
+
+					for( size_t x = 0; x < _w; x += 4 ) {
+						__m128 a = _mm_loadu_ps( v[ 0 ] + x );
+						__m128 b = _mm_loadu_ps( v[ 1 ] + x );
+						g[ 0 ] = _mm_sub_ps( _mm_loadu_ps( v[ 0 ] + x + 1 ), a );
+						g[ 1 ] = _mm_sub_ps( _mm_loadu_ps( vdown[ 0 ] + x ), a );
+						g[ 2 ] = _mm_sub_ps( _mm_loadu_ps( v[ 1 ] + x + 1 ), b );
+						g[ 3 ] = _mm_sub_ps( _mm_loadu_ps( vdown[ 1 ] + x ), b );
+
+						__m128 norm = _mm_setzero_ps();
+						for( int k = 0; k < 4; k++ ) {
+							__m128 pk = _mm_load_ps( p[ k ] + x );
+							q[ k ] = _mm_add_ps( pk, _mm_mul_ps( tau, _mm_sub_ps( g[ k ], _mm_mul_ps( eps, pk ) ) ) );
+							norm = _mm_add_ps( norm, _mm_mul_ps( q[ k ], q[ k ] ) );
+						}
+
+						// reproject onto the ball with radius w: q / max( 1, |q| / w )
+						__m128 w = _mm_load_ps( wg + x );
+						__m128 scale = _mm_div_ps( w, _mm_max_ps( w, _mm_sqrt_ps( norm ) ) );
+						for( int k = 0; k < 4; k++ )
+							_mm_store_ps( pn[ k ] + x, _mm_mul_ps( q[ k ], scale ) );
+					}
+
+					// keep the padding zero, it is the zero border of the divergence
+					for( int k = 0; k < 4; k++ )
+						for( size_t x = _w; x < _stride; x++ )
+							pn[ k ][ x ] = 0.0f;
+				}
+
+				float* const*	_un;
+				float* const*	_pn;
+				float* const*	_u;
+				float* const*	_p;
+				float* const*	_u0;
+				float* const*	_warp;
+				size_t			_w;
+				size_t			_h;
+				size_t			_stride;
+				size_t			_bandHeight;
+				float			_lambda;
+				float			_theta;
+				double*			_change;
+		};
+
+		void TVL1Flow::applyCPU( Image& output, const Image& src1, const Image& src2 )
+		{
+			if( src1.width() != src2.width() ||
+			    src1.height() != src2.height() )
+				throw CVTException( "Image do not match in size!" );
+
+			fillPyramidCPU( src1, 0 );
+			fillPyramidCPU( src2, 1 );
+
+			const size_t w0 = src1.width();
+			const size_t h0 = src1.height();
+			const size_t planeSize = Math::pad( w0 + 1, 4 ) * h0 + 8;
+
+			/* planes: u, un, u0, p, pn, warp; every plane starts after a zero guard of four floats */
+			if( _cpubuf.size() < 18 * planeSize )
+				_cpubuf.resize( 18 * planeSize );
+			std::fill( _cpubuf.begin(), _cpubuf.end(), 0.0f );
+			float* planes[ 18 ];
+			for( size_t i = 0; i < 18; i++ )
+				planes[ i ] = &_cpubuf[ 0 ] + i * planeSize + 4;
+
+			float* u[ 2 ]  = { planes[ 0 ], planes[ 1 ] };
+			float* un[ 2 ] = { planes[ 2 ], planes[ 3 ] };
+
+			for( int l = _levels - 1; l >= 0; l-- ) {
+				const Image& img = _cpupyr[ 0 ][ l ];
+				size_t stride = Math::pad( img.width() + 1, 4 );
+
+				if( l == ( int ) _levels - 1 ) {
+					for( size_t c = 0; c < 2; c++ )
+						memset( u[ c ], 0, sizeof( float ) * stride * img.height() );
+				} else {
+					const Image& prev = _cpupyr[ 0 ][ l + 1 ];
+					size_t pstride = Math::pad( prev.width() + 1, 4 );
+					for( size_t c = 0; c < 2; c++ ) {
+						TVL1Resample up( un[ c ], stride, img.width(), u[ c ], pstride, prev.width(), prev.height(), 1.0f / _scalefactor );
+						up.setHeight( img.height() );
+						parallelFor( 0, img.height(), up, parallelGrain( img.height() ) );
+					}
+					std::swap( u[ 0 ], un[ 0 ] );
+					std::swap( u[ 1 ], un[ 1 ] );
+				}
+
+				solveTVL1CPU( u, un, planes + 4, l );
+			}
+
+			output.reallocate( w0, h0, IFormat::GRAYALPHA_FLOAT );
+			IMapScoped<float> map( output );
+			size_t stride = Math::pad( w0 + 1, 4 );
+			for( size_t y = 0; y < h0; y++ ) {
+				float* dst = map.ptr();
+				const float* u1 = u[ 0 ] + y * stride;
+				const float* u2 = u[ 1 ] + y * stride;
+				for( size_t x = 0; x < w0; x++ ) {
+					*dst++ = u1[ x ];
+					*dst++ = u2[ x ];
+				}
+				map++;
+			}
+		}
+
+		void TVL1Flow::solveTVL1CPU( float** u, float** un, float** aux, size_t level )
+		{
+			const Image& img1 = _cpupyr[ 0 ][ level ];
+			const Image& img2 = _cpupyr[ 1 ][ level ];
+			const size_t w = img1.width();
+			const size_t h = img1.height();
+			const size_t stride = Math::pad( w + 1, 4 );
+
+			float* u0[ 2 ] = { aux[ 0 ], aux[ 1 ] };
+			float* p[ 4 ]  = { aux[ 2 ], aux[ 3 ], aux[ 4 ], aux[ 5 ] };
+			float* pn[ 4 ] = { aux[ 6 ], aux[ 7 ], aux[ 8 ], aux[ 9 ] };
+			float* warp[ 4 ] = { aux[ 10 ], aux[ 11 ], aux[ 12 ], aux[ 13 ] };
+
+			for( size_t i = 0; i < 4; i++ ) {
+				memset( p[ i ], 0, sizeof( float ) * stride * h );
+				memset( pn[ i ], 0, sizeof( float ) * stride * h );
+			}
+
+			size_t bandHeight = Math::max<size_t>( parallelGrain( h, 2 ), 8 );
+			size_t bands = ( h + bandHeight - 1 ) / bandHeight;
+			std::vector<double> change( bands );
+
+			IMapScoped<const float> map1( img1 );
+			IMapScoped<const float> map2( img2 );
+
+			for( int i = 0; i < TVL1_WARPS; i++ ) {
+				TVL1MedianBody median( u0, u, w, h, stride );
+				parallelFor( 0, h, median, parallelGrain( h ) );
+
+				TVL1WarpBody warpbody( warp, u0, stride, map1.ptr(), map1.stride() / sizeof( float ),
+									   map2.ptr(), map2.stride() / sizeof( float ), w, h );
+				parallelFor( 0, h, warpbody, parallelGrain( h ) );
+
+				for( int k = 0; k < ROFITER; k++ ) {
+					float lambda = _lambda * Math::exp( -( float ) ( k / ( float ) ROFITER ) * ( k / ( float ) ROFITER ) * 6.0f );
+					TVL1IterationBody iter( un, pn, u, p, u0, warp, w, h, stride, bandHeight, lambda, THETA, &change[ 0 ] );
+					parallelFor( 0, bands, iter );
+
+					for( size_t c = 0; c < 2; c++ )
+						std::swap( u[ c ], un[ c ] );
+					for( size_t c = 0; c < 4; c++ )
+						std::swap( p[ c ], pn[ c ] );
+
+					double sum = 0.0;
+					for( size_t b = 0; b < bands; b++ )
+						sum += change[ b ];
+					if( sum < ( double ) _convergence * ( double ) ( w * h ) )
+						break;
+				}
+			}
+		}
+
+		void TVL1Flow::fillPyramidCPU( const Image& img, size_t index )
+		{
+			Image* pyr = _cpupyr[ index ];
+
+			pyr[ 0 ].reallocate( img.width(), img.height(), IFormat::GRAY_FLOAT );
+			img.convert( pyr[ 0 ], IFormat::GRAY_FLOAT );
+			for( size_t l = 1; l < _levels; l++ ) {
+				size_t w = Math::max<size_t>( pyr[ l - 1 ].width() * _scalefactor, 1 );
+				size_t h = Math::max<size_t>( pyr[ l - 1 ].height() * _scalefactor, 1 );
+				pyr[ l ].reallocate( w, h, IFormat::GRAY_FLOAT );
+
+				IMapScoped<const float> src( pyr[ l - 1 ] );
+				IMapScoped<float> dst( pyr[ l ] );
+				TVL1Resample down( dst.ptr(), dst.stride() / sizeof( float ), w, src.ptr(), src.stride() / sizeof( float ),
+								   pyr[ l - 1 ].width(), pyr[ l - 1 ].height(), 1.0f );
+				down.setHeight( h );
+				parallelFor( 0, h, down, parallelGrain( h ) );
 			}
 		}
 }
@@ -30,32 +30,65 @@
 //#include <cvt/gfx/ifilter/GuidedFilter.h>
 #include <cvt/cl/CLKernel.h>
 
+#include <vector>
+
 namespace cvt {
 	class TVL1Flow : public IFilter {
 		public:
 			TVL1Flow( float scalefactor, size_t levels );
 			~TVL1Flow();
+			/**
+			  \brief Computes the flow from src1 to src2, uses OpenCL for images in OpenCL memory and the CPU otherwise
+			 */
 			void apply( Image& flow, const Image& src1, const Image& src2 );
-			void apply( const ParamSet* set, IFilterType t = IFILTER_CPU ) const {};
+			/**
+			  \brief Flow from "Input" to "Input2", stored in "Output"
+			 */
+			void apply( const ParamSet* set, IFilterType t = IFILTER_CPU ) const;
+
+			/**
+			  \brief OpenCL implementation of the TV-L1 flow, all images in OpenCL memory
+			 */
+			void applyCL( Image& flow, const Image& src1, const Image& src2 );
+
+			/**
+			  \brief CPU implementation of the TV-L1 flow, flow is a GRAYALPHA_FLOAT image in memory
+			 */
+			void applyCPU( Image& flow, const Image& src1, const Image& src2 );
+
+			/**
+			  \brief Stop the inner iterations of the CPU solver once the mean squared flow update falls below threshold
+			  \param threshold squared pixels, zero ( default ) always runs all iterations
+			 */
+			void setConvergenceThreshold( float threshold ) { _convergence = threshold; }
 
 		private:
+			TVL1Flow( const TVL1Flow& );
+			TVL1Flow& operator=( const TVL1Flow& );
+
+			void initCL();
 			void fillPyramidCL( const Image& img, size_t index );
 			void solveTVL1( Image& flow, const Image& src1, const Image& src2, bool median );
+			void fillPyramidCPU( const Image& img, size_t index );
+			void solveTVL1CPU( float** u, float** un, float** aux, size_t level );
 
 			bool		 _toggle;
 			float		 _scalefactor;
 			size_t		 _levels;
-			CLKernel	 _pyrup;
-			CLKernel	 _pyrdown;
-			CLKernel	 _tvl1;
-			CLKernel	 _tvl1_warp;
-//			CLKernel	 _tvl1_dataadd;
-			CLKernel	 _clear;
-			CLKernel	 _median3;
+			CLKernel*	 _pyrup;
+			CLKernel*	 _pyrdown;
+			CLKernel*	 _tvl1;
+			CLKernel*	 _tvl1_warp;
+//			CLKernel*	 _tvl1_dataadd;
+			CLKernel*	 _clear;
+			CLKernel*	 _median3;
 			float		 _lambda;
 //			ROFFGPFilter _rof;
 //			GuidedFilter _gf;
 			Image*		 _pyr[ 2 ];
+			Image*		 _cpupyr[ 2 ];
+			std::vector<float> _cpubuf;
+			float		 _convergence;
 	};
 }
 
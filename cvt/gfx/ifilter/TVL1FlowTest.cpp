@@ -0,0 +1,119 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/gfx/ifilter/TVL1Flow.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/vision/Flow.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/CVTTest.h>
+
+namespace cvt {
+
+	static float _tvl1Pattern( float x, float y )
+	{
+		return 0.5f + 0.25f * Math::sin( x * 0.21f ) * Math::cos( y * 0.17f ) + 0.2f * Math::sin( ( x + y ) * 0.05f );
+	}
+
+	/* src2 is src1 translated by ( sx, sy ), gt is the constant flow */
+	static void _tvl1Pair( Image& src1, Image& src2, Image& gt, size_t w, size_t h, float sx, float sy )
+	{
+		src1.reallocate( w, h, IFormat::GRAY_FLOAT );
+		src2.reallocate( w, h, IFormat::GRAY_FLOAT );
+		gt.reallocate( w, h, IFormat::GRAYALPHA_FLOAT );
+
+		IMapScoped<float> m1( src1 );
+		IMapScoped<float> m2( src2 );
+		IMapScoped<float> mg( gt );
+		for( size_t y = 0; y < h; y++ ) {
+			for( size_t x = 0; x < w; x++ ) {
+				m1.ptr()[ x ] = _tvl1Pattern( x, y );
+				m2.ptr()[ x ] = _tvl1Pattern( x - sx, y - sy );
+				mg.ptr()[ 2 * x ] = sx;
+				mg.ptr()[ 2 * x + 1 ] = sy;
+			}
+			m1++;
+			m2++;
+			mg++;
+		}
+	}
+
+	static bool _tvl1ParamSetTest()
+	{
+		Image src1, src2, gt, flow;
+		_tvl1Pair( src1, src2, gt, 96, 64, 1.5f, 0.5f );
+
+		TVL1Flow tvl1( 0.5f, 3 );
+		ParamSet* set = tvl1.parameterSet();
+		set->setArg<Image*>( set->paramHandle( "Input" ), &src1 );
+		set->setArg<Image*>( set->paramHandle( "Input2" ), &src2 );
+		set->setArg<Image*>( set->paramHandle( "Output" ), &flow );
+		tvl1.apply( set, IFILTER_CPU );
+		delete set;
+
+		if( flow.width() != src1.width() || flow.height() != src1.height() || flow.format() != IFormat::GRAYALPHA_FLOAT )
+			return false;
+		return Flow::AEE( flow, gt ) < 0.1f;
+	}
+
+	static bool _tvl1Test( float sx, float sy, float convergence )
+	{
+		Image src1, src2, gt, flow;
+		_tvl1Pair( src1, src2, gt, 160, 120, sx, sy );
+
+		TVL1Flow tvl1( 0.5f, 4 );
+		tvl1.setConvergenceThreshold( convergence );
+		tvl1.applyCPU( flow, src1, src2 );
+
+		if( flow.width() != src1.width() || flow.height() != src1.height() || flow.format() != IFormat::GRAYALPHA_FLOAT )
+			return false;
+		return Flow::AEE( flow, gt ) < 0.1f && Flow::AAE( flow, gt ) < 2.0f;
+	}
+
+}
+
+using namespace cvt;
+
+BEGIN_CVTTEST( TVL1Flow )
+	bool ret = true;
+	bool b;
+
+	b = _tvl1Test( 0.0f, 0.0f, 0.0f );
+	CVTTEST_PRINT( "TVL1Flow zero flow", b );
+	ret &= b;
+
+	b = _tvl1Test( 2.3f, -1.4f, 0.0f );
+	CVTTEST_PRINT( "TVL1Flow translation", b );
+	ret &= b;
+
+	b = _tvl1Test( 2.3f, -1.4f, 1e-6f );
+	CVTTEST_PRINT( "TVL1Flow translation with early out", b );
+	ret &= b;
+
+	b = _tvl1ParamSetTest();
+	CVTTEST_PRINT( "TVL1Flow ParamSet interface", b );
+	ret &= b;
+
+	return ret;
+END_CVTTEST
@@ -0,0 +1,149 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_RUNLABELING_H
+#define CVT_RUNLABELING_H
+
+#include <cvt/math/Math.h>
+
+#include <stdint.h>
+#include <vector>
+
+/* fixed strip height of the run labeling, independent of the number of threads */
+#define CVT_RUNLABELING_STRIP_HEIGHT 64
+
+namespace cvt {
+
+	/*
+	   Helpers for the strip parallel labeling of horizontal runs shared by
+	   IComponentLabeling and ICanny. A run type has the members y, xs and xe,
+	   a strip type the members y0, y1, runs and parent.
+	 */
+
+	/* union-find root with path halving */
+	static inline uint32_t _runFind( std::vector<uint32_t>& parent, uint32_t i )
+	{
+		while( parent[ i ] != i ) {
+			parent[ i ] = parent[ parent[ i ] ];
+			i = parent[ i ];
+		}
+		return i;
+	}
+
+	/* the smaller index stays root, i.e. the run first in raster order */
+	static inline void _runUnite( std::vector<uint32_t>& parent, uint32_t a, uint32_t b )
+	{
+		a = _runFind( parent, a );
+		b = _runFind( parent, b );
+		if( a < b )
+			parent[ b ] = a;
+		else if( b < a )
+			parent[ a ] = b;
+	}
+
+	/* rows [ y0, y1 ) of the strips covering height rows */
+	template<typename Strip>
+	static inline void _runStrips( std::vector<Strip>& strips, int height )
+	{
+		size_t nstrips = ( height + CVT_RUNLABELING_STRIP_HEIGHT - 1 ) / CVT_RUNLABELING_STRIP_HEIGHT;
+		strips.resize( nstrips );
+		for( size_t s = 0; s < nstrips; s++ ) {
+			strips[ s ].y0 = s * CVT_RUNLABELING_STRIP_HEIGHT;
+			strips[ s ].y1 = Math::min( ( int ) ( s + 1 ) * CVT_RUNLABELING_STRIP_HEIGHT, height );
+		}
+	}
+
+	/*
+	   appends the runs of non-zero values of row y to the strip and unites them with
+	   the overlapping runs [ prevBegin, prevEnd ) of the previous row, conn is 1 for
+	   8-connectivity and 0 for 4-connectivity
+	 */
+	template<typename Strip, typename T>
+	static inline void _runRow( Strip& strip, const T* ptr, int width, int y, size_t prevBegin, size_t prevEnd, int conn )
+	{
+		size_t p = prevBegin;
+		int x = 0;
+		while( x < width ) {
+			while( x < width && ptr[ x ] == 0 )
+				x++;
+			if( x == width )
+				break;
+			typename Strip::RunType run = typename Strip::RunType();
+			run.y = y;
+			run.xs = x;
+			while( x < width && ptr[ x ] != 0 )
+				x++;
+			run.xe = x - 1;
+
+			uint32_t i = strip.runs.size();
+			strip.runs.push_back( run );
+			strip.parent.push_back( i );
+			while( p < prevEnd && strip.runs[ p ].xe < run.xs - conn )
+				p++;
+			for( size_t q = p; q < prevEnd && strip.runs[ q ].xs <= run.xe + conn; q++ )
+				_runUnite( strip.parent, i, q );
+		}
+	}
+
+	/*
+	   global union-find over the runs of all strips, the runs of strip s start at
+	   offsets[ s ], the first row of each strip is united with the last row of the previous one
+	 */
+	template<typename Strip>
+	static inline void _runMergeStrips( std::vector<uint32_t>& parent, std::vector<size_t>& offsets, const std::vector<Strip>& strips, int conn )
+	{
+		size_t total = 0;
+		offsets.resize( strips.size() );
+		for( size_t s = 0; s < strips.size(); s++ ) {
+			offsets[ s ] = total;
+			total += strips[ s ].runs.size();
+		}
+
+		parent.resize( total );
+		for( size_t s = 0; s < strips.size(); s++ ) {
+			const Strip& strip = strips[ s ];
+			for( size_t i = 0; i < strip.runs.size(); i++ )
+				parent[ offsets[ s ] + i ] = strip.parent[ i ] + offsets[ s ];
+		}
+
+		for( size_t s = 1; s < strips.size(); s++ ) {
+			const Strip& prev = strips[ s - 1 ];
+			const Strip& cur = strips[ s ];
+			size_t prevBegin = prev.runs.size();
+			while( prevBegin > 0 && prev.runs[ prevBegin - 1 ].y == cur.y0 - 1 )
+				prevBegin--;
+			size_t p = prevBegin;
+			for( size_t i = 0; i < cur.runs.size() && cur.runs[ i ].y == cur.y0; i++ ) {
+				while( p < prev.runs.size() && prev.runs[ p ].xe < cur.runs[ i ].xs - conn )
+					p++;
+				for( size_t q = p; q < prev.runs.size() && prev.runs[ q ].xs <= cur.runs[ i ].xe + conn; q++ )
+					_runUnite( parent, offsets[ s ] + i, offsets[ s - 1 ] + q );
+			}
+		}
+	}
+
+}
+
+#endif
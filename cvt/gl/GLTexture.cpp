@@ -166,6 +166,9 @@ namespace cvt {
 
 			case IFORMAT_YUYV_UINT8:		glformat = GL_RG; gltype = GL_UNSIGNED_BYTE; break;
 			case IFORMAT_UYVY_UINT8:		glformat = GL_RG; gltype = GL_UNSIGNED_BYTE; break;
+
+			case IFORMAT_GRAY_HALF:			glformat = GL_RED; gltype = GL_HALF_FLOAT; break;
+			case IFORMAT_RGBA_HALF:			glformat = GL_RGBA; gltype = GL_HALF_FLOAT; break;
 			default:
 											throw CVTException( "No equivalent GL format found" );
 											break;
@@ -70,7 +70,9 @@ namespace cvt {
 				img.format() == IFormat::BAYER_GBRG_UINT8 ||
 				img.format() == IFormat::BAYER_GRBG_UINT8 ||
 				img.format() == IFormat::YUYV_UINT8 ||
-				img.format() == IFormat::UYVY_UINT8 ) {
+				img.format() == IFormat::UYVY_UINT8 ||
+				img.format() == IFormat::YUV420_PLANAR_UINT8 ||
+				img.format() == IFormat::NV12_UINT8 ) {
 				_img.reallocate( img.width(), img.height(), IFormat::RGBA_UINT8, IALLOCATOR_GL );
 				img.convert( _img );
 			} else {
@@ -157,6 +157,15 @@ namespace cvt {
 		return 0;
 	}
 
+	uint64_t FileSystem::modificationTime( const String& path )
+	{
+		struct stat buf;
+		if( !stat( path.c_str(), &buf ) ) {
+			return buf.st_mtime;
+		}
+		return 0;
+	}
+
 	bool FileSystem::load( Data& d, const String& path, bool zerotermination )
 	{
 		size_t len;
@@ -43,6 +43,7 @@ namespace cvt {
 			static void   ls( const String & path, std::vector<String> & entries );
 			static void   filesWithExtension( const String & path, std::vector<String>& result, const String & ext = "" );
 			static size_t size( const String& path );
+			static uint64_t modificationTime( const String& path );
 			static bool   load( Data& d, const String& path, bool zerotermination = false );
 			static bool   save( const String& path, const Data& d );
 	};
@@ -140,7 +140,10 @@ namespace cvt {
 				_format = IFormat::UYVY_UINT8;
 				break;
 			case PIX_FMT_YUV420P:
-				_format = IFormat::BGRA_UINT8;
+				_format = IFormat::YUV420_PLANAR_UINT8;
+				break;
+			case PIX_FMT_NV12:
+				_format = IFormat::NV12_UINT8;
 				break;
 			default:
 				std::cout << "Pixelformat:" << (int)_codecContext->pix_fmt << std::endl;
@@ -148,6 +151,15 @@ namespace cvt {
 		}
 	}
 
+	static inline void _copyPlane( SIMD* simd, uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, size_t n, size_t rows )
+	{
+		while( rows-- ) {
+			simd->Memcpy( dst, src, n );
+			dst += dstride;
+			src += sstride;
+		}
+	}
+
 	bool VideoReader::nextFrame( size_t )
 	{
 		int	frameFinished;
@@ -163,36 +175,26 @@ namespace cvt {
 				// Did we get a video frame?
 				if(frameFinished) {
 					// decoded a new frame lying in _avFrame
-					if( _codecContext->pix_fmt == PIX_FMT_YUV420P ) {
+					if( _codecContext->pix_fmt == PIX_FMT_YUV420P || _codecContext->pix_fmt == PIX_FMT_NV12 ) {
 						if( !_frame )
 							_frame = new Image( _width, _height, _format );
 
+						/* copy the planes, the chroma stays subsampled */
 						SIMD* simd = SIMD::instance();
-
-						uint8_t * dOrig;
-						const uint8_t * src = _avFrame->data[ 0 ];
-						const uint8_t *srcu;
-						const uint8_t *srcv;
-
-						size_t stridedst;
-						uint8_t * dst = _frame->map( &stridedst );
-						dOrig = dst;
-
-						srcu = _avFrame->data[ 1 ];
-						srcv = _avFrame->data[ 2 ];
-
-						size_t n = _height >> 1;
-						while( n-- ) {
-							simd->Conv_YUV420u8_to_BGRAu8( dst, src, srcu, srcv, _width );
-							src += _avFrame->linesize[ 0 ];
-							dst += stridedst;
-							simd->Conv_YUV420u8_to_BGRAu8( dst, src, srcu, srcv, _width );
-							src += _avFrame->linesize[ 0 ];
-							dst += stridedst;
-							srcu += _avFrame->linesize[ 1 ];
-							srcv += _avFrame->linesize[ 2 ];
+						size_t stride;
+						uint8_t* base = _frame->map( &stride );
+						size_t cw = ( _width + 1 ) >> 1;
+						size_t ch = ( _height + 1 ) >> 1;
+
+						_copyPlane( simd, base, stride, _avFrame->data[ 0 ], _avFrame->linesize[ 0 ], _width, _height );
+						uint8_t* chroma = base + _height * stride;
+						if( _codecContext->pix_fmt == PIX_FMT_NV12 ) {
+							_copyPlane( simd, chroma, stride, _avFrame->data[ 1 ], _avFrame->linesize[ 1 ], 2 * cw, ch );
+						} else {
+							_copyPlane( simd, chroma, stride / 2, _avFrame->data[ 1 ], _avFrame->linesize[ 1 ], cw, ch );
+							_copyPlane( simd, chroma + ch * ( stride / 2 ), stride / 2, _avFrame->data[ 2 ], _avFrame->linesize[ 2 ], cw, ch );
 						}
-						_frame->unmap( dOrig );
+						_frame->unmap( base );
 					} else {
 						delete _frame;
 						_frame = new Image( _width, _height, _format, _avFrame->data[ 0 ], _avFrame->linesize[ 0 ] );
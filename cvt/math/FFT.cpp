@@ -23,6 +23,11 @@
 */
 
 #include <cvt/math/FFT.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/ThreadPool.h>
+
+#include <map>
 
 namespace cvt {
 
@@ -183,4 +188,323 @@ namespace cvt {
 
 
 
+	size_t FFT::fastSize( size_t n )
+	{
+		if( n <= 1 )
+			return 1;
+
+		for( ;; n++ ) {
+			size_t m = n;
+			while( ( m & 1 ) == 0 )
+				m >>= 1;
+			while( m % 3 == 0 )
+				m /= 3;
+			while( m % 5 == 0 )
+				m /= 5;
+			if( m == 1 )
+				return n;
+		}
+	}
+
+	template<typename T>
+	FFTPlan<T>::FFTPlan( size_t n ) : _n( n )
+	{
+		if( !n )
+			throw CVTException( "Invalid FFT size" );
+
+		/* radix 4 first, then the remaining factors in increasing order */
+		size_t m = n;
+		while( m % 4 == 0 ) {
+			_factors.push_back( 4 );
+			m /= 4;
+		}
+		for( size_t p = 2; m > 1; p++ ) {
+			while( m % p == 0 ) {
+				_factors.push_back( p );
+				m /= p;
+			}
+		}
+
+		/* per pass: ( p - 1 ) * ido twiddles followed by the p roots of unity */
+		size_t l1 = 1;
+		for( size_t f = 0; f < _factors.size(); f++ ) {
+			size_t p = _factors[ f ];
+			size_t ido = n / ( l1 * p );
+			_twiddleOffsets.push_back( _twiddles.size() );
+			for( size_t j = 1; j < p; j++ ) {
+				for( size_t i = 0; i < ido; i++ ) {
+					double phi = -2.0 * M_PI * ( double ) ( ( i * j * l1 ) % n ) / ( double ) n;
+					_twiddles.push_back( Complex<T>( ( T ) Math::cos( phi ), ( T ) Math::sin( phi ) ) );
+				}
+			}
+			for( size_t j = 0; j < p; j++ ) {
+				double phi = -2.0 * M_PI * ( double ) j / ( double ) p;
+				_twiddles.push_back( Complex<T>( ( T ) Math::cos( phi ), ( T ) Math::sin( phi ) ) );
+			}
+			l1 *= p;
+		}
+	}
+
+	template<typename T>
+	void FFTPlan<T>::pass( size_t p, size_t ido, size_t l1, const Complex<T>* cc, Complex<T>* ch, const Complex<T>* twiddle ) const
+	{
+		/* cc( i, q, k ) = cc[ i + ido * ( q + p * k ) ], ch( i, k, j ) = ch[ i + ido * ( k + l1 * j ) ] */
+		const size_t chstep = ido * l1;
+
+		if( p == 2 ) {
+			for( size_t k = 0; k < l1; k++ ) {
+				const Complex<T>* in = cc + ido * 2 * k;
+				Complex<T>* out = ch + ido * k;
+				for( size_t i = 0; i < ido; i++ ) {
+					Complex<T> a = in[ i ];
+					Complex<T> b = in[ i + ido ];
+					out[ i ] = a + b;
+					out[ i + chstep ] = ( a - b ) * twiddle[ i ];
+				}
+			}
+		} else if( p == 4 ) {
+			for( size_t k = 0; k < l1; k++ ) {
+				const Complex<T>* in = cc + ido * 4 * k;
+				Complex<T>* out = ch + ido * k;
+				for( size_t i = 0; i < ido; i++ ) {
+					Complex<T> t0 = in[ i ] + in[ i + 2 * ido ];
+					Complex<T> t1 = in[ i ] - in[ i + 2 * ido ];
+					Complex<T> t2 = in[ i + ido ] + in[ i + 3 * ido ];
+					Complex<T> t3 = in[ i + ido ] - in[ i + 3 * ido ];
+					/* multiply by -i */
+					t3.set( t3.im, -t3.re );
+					out[ i ] = t0 + t2;
+					out[ i + chstep ]	  = ( t1 + t3 ) * twiddle[ i ];
+					out[ i + 2 * chstep ] = ( t0 - t2 ) * twiddle[ i + ido ];
+					out[ i + 3 * chstep ] = ( t1 - t3 ) * twiddle[ i + 2 * ido ];
+				}
+			}
+		} else {
+			const Complex<T>* roots = twiddle + ( p - 1 ) * ido;
+			for( size_t k = 0; k < l1; k++ ) {
+				const Complex<T>* in = cc + ido * p * k;
+				Complex<T>* out = ch + ido * k;
+				for( size_t i = 0; i < ido; i++ ) {
+					for( size_t j = 0; j < p; j++ ) {
+						Complex<T> sum = in[ i ];
+						size_t r = 0;
+						for( size_t q = 1; q < p; q++ ) {
+							r += j;
+							if( r >= p )
+								r -= p;
+							sum += in[ i + q * ido ] * roots[ r ];
+						}
+						out[ i + j * chstep ] = j ? sum * twiddle[ ( j - 1 ) * ido + i ] : sum;
+					}
+				}
+			}
+		}
+	}
+
+	template<typename T>
+	void FFTPlan<T>::transform( Complex<T>* data, Complex<T>* scratch, bool backward ) const
+	{
+		/* the backward transform is the conjugate of the forward transform of the conjugate */
+		if( backward ) {
+			for( size_t i = 0; i < _n; i++ )
+				data[ i ].im = -data[ i ].im;
+		}
+
+		Complex<T>* cc = data;
+		Complex<T>* ch = scratch;
+		size_t l1 = 1;
+		for( size_t f = 0; f < _factors.size(); f++ ) {
+			size_t p = _factors[ f ];
+			size_t ido = _n / ( l1 * p );
+			pass( p, ido, l1, cc, ch, &_twiddles[ _twiddleOffsets[ f ] ] );
+			Complex<T>* tmp = cc;
+			cc = ch;
+			ch = tmp;
+			l1 *= p;
+		}
+
+		if( cc != data ) {
+			for( size_t i = 0; i < _n; i++ )
+				data[ i ] = cc[ i ];
+		}
+
+		if( backward ) {
+			T scale = ( T ) 1 / ( T ) _n;
+			for( size_t i = 0; i < _n; i++ )
+				data[ i ].set( data[ i ].re * scale, -data[ i ].im * scale );
+		}
+	}
+
+	template<typename T>
+	const FFTPlan<T>& FFTPlan<T>::get( size_t n )
+	{
+		static Mutex _lock;
+		static std::map<size_t, FFTPlan<T>*> _plans;
+
+		ScopeLock lock( &_lock );
+		typename std::map<size_t, FFTPlan<T>*>::iterator it = _plans.find( n );
+		if( it != _plans.end() )
+			return *it->second;
+		FFTPlan<T>* plan = new FFTPlan<T>( n );
+		_plans[ n ] = plan;
+		return *plan;
+	}
+
+	template class FFTPlan<float>;
+	template class FFTPlan<double>;
+
+	class RealFFT2D::RowBody
+	{
+		public:
+			RowBody( const RealFFT2D& fft, Complex<float>* spectrum, uint8_t* real, size_t stride, bool backward ) :
+				_fft( fft ),
+				_spectrum( spectrum ),
+				_real( real ),
+				_stride( stride ),
+				_backward( backward )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				size_t w = _fft._width;
+				size_t h = _fft._height;
+				size_t hw = _fft.spectrumWidth();
+				ScopedBuffer<Complex<float>, true> zbuf( w );
+				ScopedBuffer<Complex<float>, true> scratch( w );
+				Complex<float>* z = zbuf.ptr();
+
+				/* two real rows are transformed as real and imaginary part of one complex row */
+				for( size_t r = begin; r < end; r++ ) {
+					size_t y0 = 2 * r;
+					size_t y1 = y0 + 1;
+					Complex<float>* s0 = _spectrum + y0 * hw;
+					Complex<float>* s1 = _spectrum + y1 * hw;
+
+					if( !_backward ) {
+						const float* src0 = ( const float* ) ( _real + y0 * _stride );
+						const float* src1 = ( const float* ) ( _real + y1 * _stride );
+						for( size_t x = 0; x < w; x++ )
+							z[ x ].set( src0[ x ], y1 < h ? src1[ x ] : 0.0f );
+
+						_fft._rowPlan.transform( z, scratch.ptr(), false );
+
+						for( size_t k = 0; k < hw; k++ ) {
+							Complex<float> a = z[ k ];
+							Complex<float> b = z[ k ? w - k : 0 ].conj();
+							s0[ k ].set( 0.5f * ( a.re + b.re ), 0.5f * ( a.im + b.im ) );
+							if( y1 < h )
+								s1[ k ].set( 0.5f * ( a.im - b.im ), -0.5f * ( a.re - b.re ) );
+						}
+					} else {
+						for( size_t k = 0; k < hw; k++ ) {
+							Complex<float> b = y1 < h ? s1[ k ] : Complex<float>( 0.0f, 0.0f );
+							z[ k ].set( s0[ k ].re - b.im, s0[ k ].im + b.re );
+						}
+						for( size_t k = hw; k < w; k++ ) {
+							Complex<float> a = s0[ w - k ];
+							Complex<float> b = y1 < h ? s1[ w - k ] : Complex<float>( 0.0f, 0.0f );
+							z[ k ].set( a.re + b.im, -a.im + b.re );
+						}
+
+						_fft._rowPlan.transform( z, scratch.ptr(), true );
+
+						float* dst0 = ( float* ) ( _real + y0 * _stride );
+						float* dst1 = ( float* ) ( _real + y1 * _stride );
+						for( size_t x = 0; x < w; x++ )
+							dst0[ x ] = z[ x ].re;
+						if( y1 < h ) {
+							for( size_t x = 0; x < w; x++ )
+								dst1[ x ] = z[ x ].im;
+						}
+					}
+				}
+			}
+
+		private:
+			const RealFFT2D&	_fft;
+			Complex<float>*		_spectrum;
+			uint8_t*			_real;
+			size_t				_stride;
+			bool				_backward;
+	};
+
+	class RealFFT2D::ColumnBody
+	{
+		public:
+			enum { BLOCK = 8 };
+
+			ColumnBody( const RealFFT2D& fft, Complex<float>* spectrum, bool backward ) :
+				_fft( fft ),
+				_spectrum( spectrum ),
+				_backward( backward )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				size_t h = _fft._height;
+				size_t hw = _fft.spectrumWidth();
+				ScopedBuffer<Complex<float>, true> buf( BLOCK * h );
+				ScopedBuffer<Complex<float>, true> scratch( h );
+
+				/* gather blocks of columns to keep the row-wise memory access */
+				for( size_t b = begin; b < end; b++ ) {
+					size_t x0 = b * BLOCK;
+					size_t n = Math::min<size_t>( BLOCK, hw - x0 );
+
+					for( size_t y = 0; y < h; y++ ) {
+						const Complex<float>* src = _spectrum + y * hw + x0;
+						for( size_t j = 0; j < n; j++ )
+							buf.ptr()[ j * h + y ] = src[ j ];
+					}
+
+					for( size_t j = 0; j < n; j++ )
+						_fft._colPlan.transform( buf.ptr() + j * h, scratch.ptr(), _backward );
+
+					for( size_t y = 0; y < h; y++ ) {
+						Complex<float>* dst = _spectrum + y * hw + x0;
+						for( size_t j = 0; j < n; j++ )
+							dst[ j ] = buf.ptr()[ j * h + y ];
+					}
+				}
+			}
+
+		private:
+			const RealFFT2D&	_fft;
+			Complex<float>*		_spectrum;
+			bool				_backward;
+	};
+
+	RealFFT2D::RealFFT2D( size_t width, size_t height ) :
+		_width( width ),
+		_height( height ),
+		_rowPlan( FFTPlan<float>::get( width ) ),
+		_colPlan( FFTPlan<float>::get( height ) )
+	{
+	}
+
+	void RealFFT2D::forward( Complex<float>* spectrum, const float* src, size_t srcStride ) const
+	{
+		size_t pairs = ( _height + 1 ) / 2;
+		RowBody rows( *this, spectrum, ( uint8_t* ) src, srcStride, false );
+		parallelFor( 0, pairs, rows, parallelGrain( pairs ) );
+		columns( spectrum, false );
+	}
+
+	void RealFFT2D::inverse( float* dst, size_t dstStride, Complex<float>* spectrum ) const
+	{
+		size_t pairs = ( _height + 1 ) / 2;
+		columns( spectrum, true );
+		RowBody rows( *this, spectrum, ( uint8_t* ) dst, dstStride, true );
+		parallelFor( 0, pairs, rows, parallelGrain( pairs ) );
+	}
+
+	void RealFFT2D::columns( Complex<float>* spectrum, bool backward ) const
+	{
+		size_t blocks = ( spectrumWidth() + ColumnBody::BLOCK - 1 ) / ColumnBody::BLOCK;
+		ColumnBody cols( *this, spectrum, backward );
+		parallelFor( 0, blocks, cols, parallelGrain( blocks ) );
+	}
+
 }
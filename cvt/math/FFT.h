@@ -26,6 +26,7 @@
 #define CVT_FFT_H
 
 #include <cvt/math/Complex.h>
+#include <vector>
 
 namespace cvt {
 	class FFT {
@@ -36,11 +37,79 @@ namespace cvt {
 			template<typename T>
 			static void fftStridedRadix2( Complex<T>* data, size_t n, size_t stride, bool inverse );
 
+			/**
+			  \brief Smallest size >= n of the form 2^a 3^b 5^c
+			 */
+			static size_t fastSize( size_t n );
 
 		private:
 			FFT();
 			FFT( const FFT& );
 	};
+
+	/**
+	  \brief Precomputed mixed radix complex FFT of a fixed size
+
+	  Sizes are factored into radix 4, 2, 3 and 5 passes, other prime factors
+	  are handled by a generic O(p^2) butterfly. The self-sorting Stockham
+	  scheme needs no bit reversal but a scratch buffer of the same size.
+	  As with fftRadix2 the backward transform is scaled by 1/n.
+
+	  Plans are immutable after construction, the instances returned by get()
+	  are cached and can be shared between threads.
+	 */
+	template<typename T>
+	class FFTPlan {
+		public:
+			FFTPlan( size_t n );
+
+			size_t	size() const { return _n; }
+
+			/* transform n values in data in place, scratch needs room for n values */
+			void	transform( Complex<T>* data, Complex<T>* scratch, bool backward ) const;
+
+			static const FFTPlan<T>& get( size_t n );
+
+		private:
+			void	pass( size_t p, size_t ido, size_t l1, const Complex<T>* cc, Complex<T>* ch, const Complex<T>* twiddle ) const;
+
+			size_t					_n;
+			std::vector<size_t>		_factors;
+			std::vector<Complex<T> > _twiddles;
+			std::vector<size_t>		_twiddleOffsets;
+	};
+
+	/**
+	  \brief 2D real to complex FFT
+
+	  The forward transform produces the non-redundant half spectrum of
+	  spectrumWidth() x height() values. Pairs of rows are transformed with
+	  one complex FFT; row and column passes run in parallel.
+	  Strides are in bytes.
+	 */
+	class RealFFT2D {
+		public:
+			RealFFT2D( size_t width, size_t height );
+
+			size_t	width() const { return _width; }
+			size_t	height() const { return _height; }
+			size_t	spectrumWidth() const { return _width / 2 + 1; }
+
+			void	forward( Complex<float>* spectrum, const float* src, size_t srcStride ) const;
+			/* the spectrum is used as scratch space and destroyed */
+			void	inverse( float* dst, size_t dstStride, Complex<float>* spectrum ) const;
+
+		private:
+			class RowBody;
+			class ColumnBody;
+
+			void	columns( Complex<float>* spectrum, bool backward ) const;
+
+			size_t					_width;
+			size_t					_height;
+			const FFTPlan<float>&	_rowPlan;
+			const FFTPlan<float>&	_colPlan;
+	};
 }
 
 #endif
@@ -0,0 +1,169 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/math/FFT.h>
+#include <cvt/math/Math.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IKernel.h>
+#include <cvt/gfx/IConvolve.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+
+#include <vector>
+
+namespace cvt {
+
+	static bool _fftPlanTest()
+	{
+		const size_t sizes[] = { 1, 2, 3, 7, 12, 16, 45, 60, 64, 100, 120 };
+		double maxerr = 0;
+
+		for( size_t s = 0; s < sizeof( sizes ) / sizeof( sizes[ 0 ] ); s++ ) {
+			size_t n = sizes[ s ];
+			std::vector<Complex<double> > x( n ), y( n ), scratch( n );
+			for( size_t i = 0; i < n; i++ )
+				x[ i ].set( Math::rand( -1.0f, 1.0f ), Math::rand( -1.0f, 1.0f ) );
+
+			y = x;
+			FFTPlan<double>::get( n ).transform( &y[ 0 ], &scratch[ 0 ], false );
+
+			/* compare to the direct DFT */
+			for( size_t k = 0; k < n; k++ ) {
+				Complex<double> sum( 0.0, 0.0 );
+				for( size_t i = 0; i < n; i++ ) {
+					double phi = -2.0 * M_PI * ( double ) ( ( i * k ) % n ) / ( double ) n;
+					sum += x[ i ] * Complex<double>( Math::cos( phi ), Math::sin( phi ) );
+				}
+				maxerr = Math::max( maxerr, ( sum - y[ k ] ).abs() );
+			}
+
+			FFTPlan<double>::get( n ).transform( &y[ 0 ], &scratch[ 0 ], true );
+			for( size_t i = 0; i < n; i++ )
+				maxerr = Math::max( maxerr, ( x[ i ] - y[ i ] ).abs() );
+		}
+
+		return maxerr < 1e-10;
+	}
+
+	static bool _realFFT2DTest()
+	{
+		const size_t w = 30, h = 9;
+		std::vector<float> img( w * h ), back( w * h );
+		for( size_t i = 0; i < w * h; i++ )
+			img[ i ] = Math::rand( -1.0f, 1.0f );
+
+		RealFFT2D fft( w, h );
+		std::vector<Complex<float> > spec( fft.spectrumWidth() * h );
+		fft.forward( &spec[ 0 ], &img[ 0 ], w * sizeof( float ) );
+
+		/* check some coefficients against the direct DFT */
+		float maxerr = 0;
+		for( size_t ky = 0; ky < h; ky += 2 ) {
+			for( size_t kx = 0; kx < fft.spectrumWidth(); kx += 3 ) {
+				Complex<double> sum( 0.0, 0.0 );
+				for( size_t y = 0; y < h; y++ ) {
+					for( size_t x = 0; x < w; x++ ) {
+						double phi = -2.0 * M_PI * ( ( double ) ( kx * x ) / w + ( double ) ( ky * y ) / h );
+						sum += Complex<double>( Math::cos( phi ), Math::sin( phi ) ) * ( double ) img[ y * w + x ];
+					}
+				}
+				Complex<float> c = spec[ ky * fft.spectrumWidth() + kx ];
+				maxerr = Math::max( maxerr, ( float ) ( sum - Complex<double>( c.re, c.im ) ).abs() );
+			}
+		}
+
+		fft.inverse( &back[ 0 ], w * sizeof( float ), &spec[ 0 ] );
+		for( size_t i = 0; i < w * h; i++ )
+			maxerr = Math::max( maxerr, Math::abs( back[ i ] - img[ i ] ) );
+
+		return maxerr < 1e-4f;
+	}
+
+	static bool _convolveFFTTest()
+	{
+		Image src( 101, 57, IFormat::GRAY_FLOAT );
+		Image freq;
+		{
+			IMapScoped<float> map( src );
+			for( size_t y = 0; y < src.height(); y++, map++ )
+				for( size_t x = 0; x < src.width(); x++ )
+					map.ptr()[ x ] = Math::rand( 0.0f, 1.0f );
+		}
+
+		IKernel kernel = IKernel::createGabor( 4.0f, 0.3f, 6.0f, 0.7f, 0.0f );
+		ssize_t kw = kernel.width();
+		ssize_t kh = kernel.height();
+		ssize_t w = src.width();
+		ssize_t h = src.height();
+		bool ret = true;
+
+		for( int b = 0; b < 3; b++ ) {
+			IBorderType btype = b == 0 ? IBORDER_CLAMP : ( b == 1 ? IBORDER_MIRROR : IBORDER_REPEAT );
+			IConvolve::convolveFFT( freq, src, kernel, btype );
+
+			/* compare with the direct sum used by the spatial convolution */
+			float maxerr = 0;
+			IMapScoped<const float> msrc( src );
+			IMapScoped<const float> mfreq( freq );
+			for( ssize_t y = 0; y < h; y++ ) {
+				for( ssize_t x = 0; x < w; x++ ) {
+					float sum = 0;
+					for( ssize_t j = 0; j < kh; j++ ) {
+						ssize_t sy = IBorder::value<ssize_t>( y - kh / 2 + j, h, btype );
+						for( ssize_t i = 0; i < kw; i++ ) {
+							ssize_t sx = IBorder::value<ssize_t>( x - kw / 2 + i, w, btype );
+							sum += kernel( i, j ) * msrc( sx, sy );
+						}
+					}
+					maxerr = Math::max( maxerr, Math::abs( sum - mfreq( x, y ) ) );
+				}
+			}
+			ret &= maxerr < 1e-3f;
+		}
+		return ret;
+	}
+
+}
+
+using namespace cvt;
+
+BEGIN_CVTTEST( FFT )
+	bool ret = true;
+	bool b;
+
+	b = _fftPlanTest();
+	CVTTEST_PRINT( "Mixed radix FFT", b );
+	ret &= b;
+
+	b = _realFFT2DTest();
+	CVTTEST_PRINT( "Real 2D FFT", b );
+	ret &= b;
+
+	b = _convolveFFTTest();
+	CVTTEST_PRINT( "FFT convolution", b );
+	ret &= b;
+
+	return ret;
+END_CVTTEST
@@ -22,50 +22,94 @@
    THE SOFTWARE.
 */
 
+
 #ifndef CVT_PCA_H
 #define CVT_PCA_H
 
+#include <cvt/math/Math.h>
 #include <Eigen/Core>
-#include <Eigen/SVD>
+#include <Eigen/QR>
+#include <Eigen/Eigenvalues>
 
 namespace cvt {
 
 	/**
 	  \ingroup Math
+	  \brief Streaming principal component analysis.
+
+	  Samples are not stored, only the running mean and the centered scatter
+	  matrix are kept. Samples are collected in small batches, each batch is
+	  centered on its own mean and added to the scatter with a rank-k update,
+	  the batch statistics are then combined with the pairwise update of
+	  Chan et al. Partial accumulators (e.g. one per thread) can be combined
+	  with merge().
 	*/
 	template<typename T>
 	class PCA
 	{
 		public:
+			typedef Eigen::Matrix<T, Eigen::Dynamic, 1>				 VectorType;
+			typedef Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> MatrixType;
+
 			PCA( size_t dimension );
+			PCA( const PCA& pca );
 			~PCA();
 
+			PCA& operator=( const PCA& pca );
+
 			size_t dimension() const;
+			size_t numSamples() const;
 
-			void addSample( const Eigen::Matrix<T, Eigen::Dynamic, 1>& sample );
+			void addSample( const VectorType& sample );
 			void addSample( const T* sample );
-//			void addSample( T* sample, size_t width, size_t stride );
+			void addSamples( const T* samples, size_t n, size_t stride );
+
+			void merge( const PCA& other );
+			void clear();
 
-			void mean( Eigen::Matrix<T, Eigen::Dynamic, 1>& m ) const;
-			void principleComponents(Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>& p) const;
-			void principleComponents( Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>& p,  Eigen::Matrix<T, Eigen::Dynamic, 1>& svalues ) const;
+			void mean( VectorType& m ) const;
+			void covariance( MatrixType& cov ) const;
+			void principleComponents( MatrixType& p ) const;
+			void principleComponents( MatrixType& p, VectorType& svalues ) const;
+			void principleComponents( MatrixType& p, VectorType& svalues, size_t k, size_t iterations = 4 ) const;
 
 		private:
 			PCA();
-			PCA( const PCA& pca );
 
-			size_t _dimension;
-			size_t _n;
+			enum { BATCH_SIZE = 64 };
+
+			void flush() const;
+			void addBatch( const MatrixType& batch, size_t n ) const;
 
-			Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> _x;
-			Eigen::Matrix<T, Eigen::Dynamic, 1>				 _mean;
+			size_t				_dimension;
+
+			/* accumulated statistics, updated lazily from the batch */
+			mutable size_t		_n;
+			mutable VectorType	_mean;
+			mutable MatrixType	_scatter;
+
+			/* pending samples, one per column */
+			mutable MatrixType	_batch;
+			mutable size_t		_nbatch;
 	};
 
 	template<typename T>
-	inline PCA<T>::PCA( size_t dimension ) : _dimension( dimension ), _n( 0 ), _x( ( int ) dimension, ( int ) dimension ), _mean( dimension )
+	inline PCA<T>::PCA( size_t dimension ) : _dimension( dimension ), _n( 0 ),
+		_mean( VectorType::Zero( dimension ) ),
+		_scatter( MatrixType::Zero( dimension, dimension ) ),
+		_batch( dimension, ( int ) BATCH_SIZE ),
+		_nbatch( 0 )
 	{
-		_mean.setZero();
-		_x.setZero();
+	}
+
+	template<typename T>
+	inline PCA<T>::PCA( const PCA& pca ) : _dimension( pca._dimension ), _n( 0 ),
+		_mean( VectorType::Zero( pca._dimension ) ),
+		_scatter( MatrixType::Zero( pca._dimension, pca._dimension ) ),
+		_batch( pca._dimension, ( int ) BATCH_SIZE ),
+		_nbatch( 0 )
+	{
+		merge( pca );
 	}
 
 	template<typename T>
@@ -73,72 +117,200 @@ namespace cvt {
 	{
 	}
 
+	template<typename T>
+	inline PCA<T>& PCA<T>::operator=( const PCA& pca )
+	{
+		if( this != &pca ) {
+			pca.flush();
+			_dimension = pca._dimension;
+			_n = pca._n;
+			_mean = pca._mean;
+			_scatter = pca._scatter;
+			_batch.resize( _dimension, ( int ) BATCH_SIZE );
+			_nbatch = 0;
+		}
+		return *this;
+	}
 
 	template<typename T>
-	size_t PCA<T>::dimension() const
+	inline size_t PCA<T>::dimension() const
 	{
 		return _dimension;
 	}
 
 	template<typename T>
-	inline void PCA<T>::addSample( const Eigen::Matrix<T, Eigen::Dynamic, 1>& sample )
+	inline size_t PCA<T>::numSamples() const
+	{
+		return _n + _nbatch;
+	}
+
+	template<typename T>
+	inline void PCA<T>::addSample( const VectorType& sample )
 	{
 		if( ( size_t )sample.rows() != _dimension )
 			return;
-		_mean += sample;
-		_x	  += sample * sample.transpose();
-		_n++;
+		_batch.col( _nbatch++ ) = sample;
+		if( _nbatch == BATCH_SIZE )
+			flush();
 	}
 
 	template<typename T>
 	inline void PCA<T>::addSample( const T* data )
 	{
-		Eigen::Map< Eigen::Matrix<T, Eigen::Dynamic, 1> > sample( ( T* )data, _dimension );
-		_mean += sample;
-		_x	  += sample * sample.transpose();
-		_n++;
+		_batch.col( _nbatch++ ) = Eigen::Map<const VectorType>( data, _dimension );
+		if( _nbatch == BATCH_SIZE )
+			flush();
 	}
 
+	/**
+	  \brief Add n samples stored with a distance of stride elements.
+	 */
+	template<typename T>
+	inline void PCA<T>::addSamples( const T* data, size_t n, size_t stride )
+	{
+		while( n-- ) {
+			addSample( data );
+			data += stride;
+		}
+	}
 
 	template<typename T>
-	inline void PCA<T>::mean( Eigen::Matrix<T, Eigen::Dynamic, 1>& m ) const
+	inline void PCA<T>::flush() const
 	{
-		if( ( size_t ) m.rows() != _dimension || !_n )
+		if( !_nbatch )
 			return;
-		T invn = 1 / ( T ) _n;
-		m = _mean * invn;
+		addBatch( _batch, _nbatch );
+		_nbatch = 0;
 	}
 
+	template<typename T>
+	inline void PCA<T>::addBatch( const MatrixType& batch, size_t nb ) const
+	{
+		/* center the batch on its own mean, rank-k update of the lower triangle */
+		VectorType bmean = batch.leftCols( nb ).rowwise().sum() / ( T ) nb;
+		MatrixType centered = batch.leftCols( nb ).colwise() - bmean;
+
+		size_t n = _n + nb;
+		VectorType delta = bmean - _mean;
+		_scatter.template selfadjointView<Eigen::Lower>().rankUpdate( centered );
+		_scatter.template selfadjointView<Eigen::Lower>().rankUpdate( delta, ( T ) _n * ( T ) nb / ( T ) n );
+		_mean += delta * ( ( T ) nb / ( T ) n );
+		_n = n;
+	}
 
+	/**
+	  \brief Combine the statistics of other with this accumulator.
+	 */
 	template<typename T>
-	void PCA<T>::principleComponents(Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>& p) const
+	inline void PCA<T>::merge( const PCA& other )
 	{
-		if( ( size_t ) p.rows() != _dimension || ( size_t ) p.cols() != _dimension || !_n )
+		if( other._dimension != _dimension )
+			return;
+		flush();
+		other.flush();
+		if( !other._n )
 			return;
 
-		T invn = 1 / ( T ) _n;
-		Eigen::Matrix<T, Eigen::Dynamic, 1> m( _dimension );
-		mean( m );
+		size_t n = _n + other._n;
+		VectorType delta = other._mean - _mean;
+		_scatter.template triangularView<Eigen::Lower>() += other._scatter;
+		_scatter.template selfadjointView<Eigen::Lower>().rankUpdate( delta, ( T ) _n * ( T ) other._n / ( T ) n );
+		_mean += delta * ( ( T ) other._n / ( T ) n );
+		_n = n;
+	}
+
+	template<typename T>
+	inline void PCA<T>::clear()
+	{
+		_n = 0;
+		_nbatch = 0;
+		_mean.setZero();
+		_scatter.setZero();
+	}
 
-		p = _x * invn - m * m.transpose();
-		Eigen::JacobiSVD<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> > svd( p, Eigen::ComputeFullU | Eigen::ComputeFullV );
-		p = svd.matrixU();
+	template<typename T>
+	inline void PCA<T>::mean( VectorType& m ) const
+	{
+		if( !numSamples() )
+			return;
+		flush();
+		m = _mean;
 	}
 
 	template<typename T>
-	void PCA<T>::principleComponents( Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>& p,  Eigen::Matrix<T, Eigen::Dynamic, 1>& svalues ) const
+	inline void PCA<T>::covariance( MatrixType& cov ) const
 	{
-		if( ( size_t ) p.rows() != _dimension || ( size_t ) p.cols() != _dimension || !_n )
+		if( !numSamples() )
 			return;
+		flush();
+		cov = _scatter.template selfadjointView<Eigen::Lower>();
+		cov /= ( T ) _n;
+	}
+
+	template<typename T>
+	inline void PCA<T>::principleComponents( MatrixType& p ) const
+	{
+		VectorType svalues;
+		principleComponents( p, svalues );
+	}
+
+	template<typename T>
+	inline void PCA<T>::principleComponents( MatrixType& p, VectorType& svalues ) const
+	{
+		if( !numSamples() )
+			return;
+
+		MatrixType cov;
+		covariance( cov );
+
+		/* eigenvalues in increasing order, return them decreasing */
+		Eigen::SelfAdjointEigenSolver<MatrixType> eig( cov );
+		p = eig.eigenvectors().rowwise().reverse();
+		svalues = eig.eigenvalues().reverse();
+	}
+
+	/**
+	  \brief The k leading principal components.
+
+	  Uses a randomized subspace iteration on the covariance, which only
+	  needs products with a d x (k + oversampling) matrix instead of a full
+	  eigen decomposition - intended for high dimensional samples.
+	 */
+	template<typename T>
+	inline void PCA<T>::principleComponents( MatrixType& p, VectorType& svalues, size_t k, size_t iterations ) const
+	{
+		if( !numSamples() || !k )
+			return;
+
+		const size_t oversampling = 8;
+		if( k + oversampling >= _dimension ) {
+			principleComponents( p, svalues );
+			p.conservativeResize( _dimension, Math::min( k, _dimension ) );
+			svalues.conservativeResize( Math::min( k, _dimension ) );
+			return;
+		}
+
+		MatrixType cov;
+		covariance( cov );
+
+		size_t l = k + oversampling;
+		MatrixType q( _dimension, l );
+		for( size_t c = 0; c < l; c++ )
+			for( size_t r = 0; r < _dimension; r++ )
+				q( r, c ) = Math::rand( ( T ) -1, ( T ) 1 );
 
-		T invn = 1 / ( T ) _n;
-		Eigen::Matrix<T, Eigen::Dynamic, 1> m( _dimension );
-		mean( m );
+		MatrixType y;
+		for( size_t i = 0; i <= iterations; i++ ) {
+			y.noalias() = cov * q;
+			Eigen::HouseholderQR<MatrixType> qr( y );
+			q = qr.householderQ() * MatrixType::Identity( _dimension, l );
+		}
 
-		p = _x * invn - m * m.transpose();
-		Eigen::JacobiSVD<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> > svd( p, Eigen::ComputeFullU | Eigen::ComputeFullV );
-		svalues = svd.singularValues();
-		p = svd.matrixU();
+		/* Rayleigh-Ritz on the small projected problem */
+		MatrixType small = q.transpose() * cov * q;
+		Eigen::SelfAdjointEigenSolver<MatrixType> eig( small );
+		p = q * eig.eigenvectors().rowwise().reverse().leftCols( k );
+		svalues = eig.eigenvalues().reverse().head( k );
 	}
 
 	typedef PCA<float> PCAf;
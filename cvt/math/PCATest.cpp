@@ -0,0 +1,170 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/math/PCA.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/CVTTest.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/* anisotropic samples with a large offset, stored column after column */
+	static void _pcaSamples( std::vector<float>& data, size_t dim, size_t n, const Eigen::MatrixXd& basis, const Eigen::VectorXd& sigma, double offset )
+	{
+		data.resize( dim * n );
+		Eigen::VectorXd z( dim );
+		for( size_t i = 0; i < n; i++ ) {
+			for( size_t d = 0; d < dim; d++ )
+				z[ d ] = sigma[ d ] * ( Math::rand( -1.0, 1.0 ) + Math::rand( -1.0, 1.0 ) );
+			Eigen::VectorXd x = basis * z;
+			for( size_t d = 0; d < dim; d++ )
+				data[ i * dim + d ] = ( float ) ( x[ d ] + offset + d );
+		}
+	}
+
+	/* two-pass reference in double precision */
+	static void _pcaReference( Eigen::VectorXd& mean, Eigen::MatrixXd& cov, const std::vector<float>& data, size_t dim, size_t n )
+	{
+		mean = Eigen::VectorXd::Zero( dim );
+		for( size_t i = 0; i < n; i++ )
+			for( size_t d = 0; d < dim; d++ )
+				mean[ d ] += data[ i * dim + d ];
+		mean /= ( double ) n;
+
+		cov = Eigen::MatrixXd::Zero( dim, dim );
+		Eigen::VectorXd x( dim );
+		for( size_t i = 0; i < n; i++ ) {
+			for( size_t d = 0; d < dim; d++ )
+				x[ d ] = data[ i * dim + d ] - mean[ d ];
+			cov += x * x.transpose();
+		}
+		cov /= ( double ) n;
+	}
+
+	static bool _pcaStreamingTest()
+	{
+		const size_t dim = 16;
+		const size_t n = 5000;
+
+		Eigen::MatrixXd basis = Eigen::MatrixXd::Identity( dim, dim );
+		Eigen::VectorXd sigma( dim );
+		for( size_t d = 0; d < dim; d++ )
+			sigma[ d ] = 0.1 + d;
+
+		std::vector<float> data;
+		_pcaSamples( data, dim, n, basis, sigma, 1000.0 );
+
+		Eigen::VectorXd rmean;
+		Eigen::MatrixXd rcov;
+		_pcaReference( rmean, rcov, data, dim, n );
+
+		/* one accumulator over everything, three partial accumulators merged */
+		PCAf pca( dim );
+		pca.addSamples( &data[ 0 ], n, dim );
+
+		PCAf part0( dim ), part1( dim ), part2( dim );
+		part0.addSamples( &data[ 0 ], 1000, dim );
+		for( size_t i = 1000; i < 1037; i++ )
+			part1.addSample( &data[ i * dim ] );
+		part2.addSamples( &data[ 1037 * dim ], n - 1037, dim );
+		part0.merge( part1 );
+		part0.merge( part2 );
+
+		bool ret = true;
+		const PCAf* accs[] = { &pca, &part0 };
+		for( size_t a = 0; a < 2; a++ ) {
+			Eigen::VectorXf m;
+			Eigen::MatrixXf cov;
+			accs[ a ]->mean( m );
+			accs[ a ]->covariance( cov );
+
+			double merr = ( m.cast<double>() - rmean ).cwiseAbs().maxCoeff();
+			double cerr = ( cov.cast<double>() - rcov ).cwiseAbs().maxCoeff() / rcov.cwiseAbs().maxCoeff();
+			bool b = accs[ a ]->numSamples() == n && merr < 1e-3 && cerr < 1e-4;
+			if( !b )
+				CVTTEST_LOG( "mean error " << merr << " relative covariance error " << cerr );
+			ret &= b;
+		}
+		CVTTEST_PRINT( "PCA streaming mean/covariance and merge", ret );
+		return ret;
+	}
+
+	static bool _pcaComponentsTest()
+	{
+		const size_t dim = 48;
+		const size_t n = 4000;
+		const size_t k = 4;
+
+		/* random orthonormal basis, a few dominant directions */
+		Eigen::MatrixXd r( dim, dim );
+		for( size_t i = 0; i < dim; i++ )
+			for( size_t j = 0; j < dim; j++ )
+				r( i, j ) = Math::rand( -1.0, 1.0 );
+		Eigen::HouseholderQR<Eigen::MatrixXd> qr( r );
+		Eigen::MatrixXd basis = qr.householderQ();
+		Eigen::VectorXd sigma = Eigen::VectorXd::Constant( dim, 0.05 );
+		for( size_t d = 0; d < k; d++ )
+			sigma[ d ] = 10.0 - 2.0 * d;
+
+		std::vector<float> data;
+		_pcaSamples( data, dim, n, basis, sigma, 0.0 );
+
+		PCAf pca( dim );
+		pca.addSamples( &data[ 0 ], n, dim );
+
+		Eigen::MatrixXf full, fast;
+		Eigen::VectorXf sfull, sfast;
+		pca.principleComponents( full, sfull );
+		pca.principleComponents( fast, sfast, k );
+
+		bool ret = fast.cols() == ( int ) k && sfast.rows() == ( int ) k;
+		for( size_t c = 0; ret && c < k; c++ ) {
+			/* components match the generating basis up to sign */
+			double align = Math::abs( full.col( c ).cast<double>().dot( basis.col( c ) ) );
+			double afast = Math::abs( fast.col( c ).dot( full.col( c ) ) );
+			double serr = Math::abs( sfast[ c ] - sfull[ c ] ) / sfull[ c ];
+			bool b = align > 0.99 && afast > 0.999 && serr < 1e-3;
+			if( !b )
+				CVTTEST_LOG( "component " << c << " : " << align << " " << afast << " " << serr );
+			ret &= b;
+		}
+		for( size_t c = 1; ret && c < dim; c++ )
+			ret &= sfull[ c ] <= sfull[ c - 1 ];
+
+		CVTTEST_PRINT( "PCA full and randomized principal components", ret );
+		return ret;
+	}
+
+BEGIN_CVTTEST( PCA )
+	bool ret = true;
+	Math::srand( 42 );
+
+	ret &= _pcaStreamingTest();
+	ret &= _pcaComponentsTest();
+
+	return ret;
+END_CVTTEST
+
+}
@@ -29,7 +29,7 @@
 #include <cvt/util/Exception.h>
 #include <cvt/math/Math.h>
 #include <Eigen/Core>
-#include <Eigen/SVD>
+#include <Eigen/Eigenvalues>
 #include <Eigen/LU>
 #include <Eigen/QR>
 
@@ -69,6 +69,8 @@ namespace cvt {
 				void principleComponents( size_t i, MatrixType& p, VectorType& svalues, T& sigma ) const;
 
 			private:
+				enum { BLOCK_SIZE = 64 };
+
 				size_t _dimension;
 				size_t _subdimension;
 				size_t _mixcomponents;
@@ -135,7 +137,7 @@ namespace cvt {
 	template<typename T>
 		inline void PPCA<T>::addSample( const T* data )
 		{
-			Eigen::Map<VectorType> sample( data, _dimension );
+			Eigen::Map<const VectorType> sample( data, _dimension );
 			_samples.push_back( sample );
 		}
 
@@ -230,6 +232,9 @@ namespace cvt {
 			T pnormalize[ _mixcomponents ];
 			std::vector<VectorType> newmeans( _mixcomponents );
 			std::vector<MatrixType> newcovar( _mixcomponents );
+			/* weighted samples centered on the previous mean, one per column */
+			std::vector<MatrixType> blocks( _mixcomponents, MatrixType( _dimension, BLOCK_SIZE ) );
+			size_t nblock = 0;
 			std::vector<MatrixType> C( _mixcomponents );
 			std::vector<VectorType> samples( _mixcomponents );
 
@@ -274,24 +279,32 @@ namespace cvt {
 						weights[ k ] /= wsum;
 						_weights[ k ] += weights[ k ];
 						newmeans[ k ] += weights[ k ] * samples[ k ];
-						/* step 3 - without the new mean */
-						newcovar[ k ] += weights[ k ] * samples[ k ] * samples[ k ].transpose();
+						/* step 3 - relative to the previous mean */
+						blocks[ k ].col( nblock ) = Math::sqrt( weights[ k ] ) * ( samples[ k ] - _means[ k ] );
 					}
 
+					/* rank-k update of the scatter matrices once a block is full */
+					if( ++nblock == BLOCK_SIZE || i + 1 == end ) {
+						for( size_t k = 0; k < _mixcomponents; k++ )
+							newcovar[ k ].template selfadjointView<Eigen::Lower>().rankUpdate( blocks[ k ].leftCols( nblock ) );
+						nblock = 0;
+					}
 				}
 
 				for( size_t k = 0; k < _mixcomponents; k++ ) {
 
 					/* normalize new means and covariances */
 					newmeans[ k ] /= _weights[ k ];
-					newcovar[ k ] /= _weights[ k ];
+					MatrixType cov = newcovar[ k ].template selfadjointView<Eigen::Lower>();
+					newcovar[ k ] = cov / _weights[ k ];
+
+					/* substract the mean shift from the covariance - part of step 3 */
+					VectorType shift = newmeans[ k ] - _means[ k ];
+					newcovar[ k ] -= shift * shift.transpose();
 
 					/* set new means */
 					_means[ k ] = newmeans[ k ];
 
-					/* substract the mean from the covariance - part of step 3 */
-					newcovar[ k ] -= _means[ k ] * _means[ k ].transpose();
-
 					if( iterations )
 						postprocessMean( _means[ k ] );
 
@@ -299,15 +312,17 @@ namespace cvt {
 					_weights[ k ] /= _samples.size();
 					std::cout << k << " : " << _weights[ k ] << std::endl;
 
-					/* decompose each covariance matrix to get the eigenvectors and -values ...	 */
-					Eigen::JacobiSVD<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> > svd( newcovar[ k ], Eigen::ComputeFullU | Eigen::ComputeFullV );
+					/* decompose each covariance matrix to get the eigenvectors and -values,
+					   the solver returns them in increasing order */
+					Eigen::SelfAdjointEigenSolver<MatrixType> eig( newcovar[ k ] );
+					VectorType evalues = eig.eigenvalues().reverse();
 
-					/* update the noise using the singular values outside the subspace */
-					_sigmas2[ k ] = svd.singularValues().block( _subdimension, 0, _dimension - _subdimension , 1 ).sum() / ( T ) ( _dimension - _subdimension );
-					/* get the singular values in the subspace */
-					_evalues[ k ] = svd.singularValues().block( 0, 0, _subdimension, 1 );
+					/* update the noise using the eigenvalues outside the subspace */
+					_sigmas2[ k ] = evalues.block( _subdimension, 0, _dimension - _subdimension , 1 ).sum() / ( T ) ( _dimension - _subdimension );
+					/* get the eigenvalues in the subspace */
+					_evalues[ k ] = evalues.block( 0, 0, _subdimension, 1 );
 					/* get the eigenvectors in the subspace */
-					_pc[ k ] = svd.matrixU().block( 0, 0, _dimension, _subdimension );
+					_pc[ k ] = eig.eigenvectors().rowwise().reverse().block( 0, 0, _dimension, _subdimension );
 					Eigen::Matrix<T, Eigen::Dynamic, 1> tmp =  _evalues[ k ];
 					tmp.array() -= _sigmas2[ k ];
 					tmp = tmp.array().sqrt();
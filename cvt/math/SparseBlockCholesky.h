@@ -0,0 +1,304 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_SPARSE_BLOCK_CHOLESKY_H
+#define CVT_SPARSE_BLOCK_CHOLESKY_H
+
+#include <vector>
+#include <algorithm>
+
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+#include <Eigen/Sparse>
+#include <Eigen/OrderingMethods>
+#include <Eigen/StdVector>
+
+namespace cvt
+{
+	/**
+	  \ingroup Math
+	  \brief Sparse Cholesky factorization of symmetric matrices made of dense bSize x bSize blocks.
+
+	  The lower block pattern is given as compressed columns: column c holds
+	  the block rows colRows[ colStart[ c ] ... colStart[ c + 1 ] ), sorted,
+	  starting with the diagonal. analyze() computes a fill reducing ordering
+	  (AMD on the block graph) and the symbolic factorization once,
+	  factorize() can then be called for any values with this pattern.
+	  All numeric work is done on fixed size blocks.
+	*/
+	template<int bSize>
+	class SparseBlockCholesky
+	{
+		public:
+			typedef Eigen::Matrix<double, bSize, bSize> BlockType;
+			typedef std::vector<BlockType, Eigen::aligned_allocator<BlockType> > BlockVector;
+
+			SparseBlockCholesky();
+
+			void analyze( size_t n, const std::vector<size_t>& colStart, const std::vector<size_t>& colRows );
+			bool factorize( const BlockVector& blocks );
+			void solve( Eigen::VectorXd& x, const Eigen::VectorXd& b ) const;
+
+			size_t size() const { return _n; }
+			size_t nonZeroBlocks() const { return _rows.size(); }
+
+		private:
+			static void invertLower( BlockType& inv, const BlockType& l );
+
+			size_t				_n;
+
+			/* new index of every block column */
+			std::vector<int>	_perm;
+
+			/* pattern of L in compressed columns, diagonal first */
+			std::vector<size_t>	_colStart;
+			std::vector<size_t>	_rows;
+
+			/* row structure of L: columns k < j with L( j, k ) != 0 and the block index */
+			std::vector<size_t>	_rowStart;
+			std::vector<size_t>	_rowCols;
+			std::vector<size_t>	_rowBlocks;
+
+			/* target block in L of every input block, transposed if the permutation flipped it */
+			std::vector<size_t>	_inputTarget;
+			std::vector<bool>	_inputTransposed;
+
+			BlockVector			_L;
+			BlockVector			_diagInv;
+			std::vector<int>	_slot;
+	};
+
+	template<int bSize>
+	inline SparseBlockCholesky<bSize>::SparseBlockCholesky() : _n( 0 )
+	{
+	}
+
+	template<int bSize>
+	inline void SparseBlockCholesky<bSize>::analyze( size_t n, const std::vector<size_t>& colStart, const std::vector<size_t>& colRows )
+	{
+		_n = n;
+
+		/* fill reducing ordering on the symmetric block graph */
+		std::vector<Eigen::Triplet<double> > triplets;
+		triplets.reserve( 2 * colRows.size() );
+		for( size_t c = 0; c < n; c++ ) {
+			for( size_t p = colStart[ c ]; p < colStart[ c + 1 ]; p++ ) {
+				triplets.push_back( Eigen::Triplet<double>( ( int ) colRows[ p ], ( int ) c, 1.0 ) );
+				triplets.push_back( Eigen::Triplet<double>( ( int ) c, ( int ) colRows[ p ], 1.0 ) );
+			}
+		}
+		Eigen::SparseMatrix<double> graph( ( int ) n, ( int ) n );
+		graph.setFromTriplets( triplets.begin(), triplets.end() );
+
+		Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> pinv, perm;
+		Eigen::AMDOrdering<int> amd;
+		amd( graph, pinv );
+		perm = pinv.inverse();
+		_perm.resize( n );
+		for( size_t i = 0; i < n; i++ )
+			_perm[ i ] = perm.indices()[ i ];
+
+		/* permuted lower pattern, strictly below the diagonal */
+		std::vector<std::vector<size_t> > acols( n );
+		for( size_t c = 0; c < n; c++ ) {
+			for( size_t p = colStart[ c ]; p < colStart[ c + 1 ]; p++ ) {
+				size_t pr = _perm[ colRows[ p ] ];
+				size_t pc = _perm[ c ];
+				if( pr != pc )
+					acols[ std::min( pr, pc ) ].push_back( std::max( pr, pc ) );
+			}
+		}
+
+		/* symbolic factorization along the elimination tree:
+		   struct( L_j ) = struct( A_j ) + struct( L_c ) for all children c of j */
+		std::vector<std::vector<size_t> > children( n );
+		std::vector<size_t> mark( n, ( size_t ) -1 );
+		std::vector<size_t> col;
+		_colStart.resize( n + 1 );
+		_rows.clear();
+		for( size_t j = 0; j < n; j++ ) {
+			_colStart[ j ] = _rows.size();
+			col.clear();
+			mark[ j ] = j;
+			for( size_t k = 0; k < acols[ j ].size(); k++ ) {
+				size_t r = acols[ j ][ k ];
+				if( mark[ r ] != j ) {
+					mark[ r ] = j;
+					col.push_back( r );
+				}
+			}
+			for( size_t ci = 0; ci < children[ j ].size(); ci++ ) {
+				size_t c = children[ j ][ ci ];
+				for( size_t p = _colStart[ c ] + 1; p < _colStart[ c + 1 ]; p++ ) {
+					size_t r = _rows[ p ];
+					if( mark[ r ] != j ) {
+						mark[ r ] = j;
+						col.push_back( r );
+					}
+				}
+			}
+			std::sort( col.begin(), col.end() );
+
+			_rows.push_back( j );
+			_rows.insert( _rows.end(), col.begin(), col.end() );
+			if( !col.empty() )
+				children[ col[ 0 ] ].push_back( j );
+		}
+		_colStart[ n ] = _rows.size();
+
+		/* row structure, sorted by column */
+		_rowStart.assign( n + 1, 0 );
+		for( size_t j = 0; j < n; j++ )
+			for( size_t p = _colStart[ j ] + 1; p < _colStart[ j + 1 ]; p++ )
+				_rowStart[ _rows[ p ] + 1 ]++;
+		for( size_t j = 0; j < n; j++ )
+			_rowStart[ j + 1 ] += _rowStart[ j ];
+		_rowCols.resize( _rowStart[ n ] );
+		_rowBlocks.resize( _rowStart[ n ] );
+		std::vector<size_t> fill( _rowStart.begin(), _rowStart.end() - 1 );
+		for( size_t j = 0; j < n; j++ ) {
+			for( size_t p = _colStart[ j ] + 1; p < _colStart[ j + 1 ]; p++ ) {
+				size_t idx = fill[ _rows[ p ] ]++;
+				_rowCols[ idx ] = j;
+				_rowBlocks[ idx ] = p;
+			}
+		}
+
+		/* where the input blocks go */
+		_inputTarget.resize( colRows.size() );
+		_inputTransposed.resize( colRows.size() );
+		for( size_t c = 0; c < n; c++ ) {
+			for( size_t p = colStart[ c ]; p < colStart[ c + 1 ]; p++ ) {
+				size_t pr = _perm[ colRows[ p ] ];
+				size_t pc = _perm[ c ];
+				size_t lc = std::min( pr, pc );
+				size_t lr = std::max( pr, pc );
+				if( lr == lc ) {
+					_inputTarget[ p ] = _colStart[ lc ];
+				} else {
+					const size_t* begin = &_rows[ 0 ] + _colStart[ lc ] + 1;
+					const size_t* end = &_rows[ 0 ] + _colStart[ lc + 1 ];
+					_inputTarget[ p ] = std::lower_bound( begin, end, lr ) - &_rows[ 0 ];
+				}
+				_inputTransposed[ p ] = pr < pc;
+			}
+		}
+
+		_L.resize( _rows.size() );
+		_diagInv.resize( n );
+		_slot.assign( n, -1 );
+	}
+
+	/* inverse of a lower triangular block by forward substitution */
+	template<int bSize>
+	inline void SparseBlockCholesky<bSize>::invertLower( BlockType& inv, const BlockType& l )
+	{
+		inv.setZero();
+		for( int c = 0; c < bSize; c++ ) {
+			inv( c, c ) = 1.0 / l( c, c );
+			for( int r = c + 1; r < bSize; r++ ) {
+				double sum = 0.0;
+				for( int k = c; k < r; k++ )
+					sum += l( r, k ) * inv( k, c );
+				inv( r, c ) = -sum / l( r, r );
+			}
+		}
+	}
+
+	template<int bSize>
+	inline bool SparseBlockCholesky<bSize>::factorize( const BlockVector& blocks )
+	{
+		for( size_t i = 0; i < _L.size(); i++ )
+			_L[ i ].setZero();
+		for( size_t i = 0; i < blocks.size(); i++ ) {
+			if( _inputTransposed[ i ] )
+				_L[ _inputTarget[ i ] ] += blocks[ i ].transpose();
+			else
+				_L[ _inputTarget[ i ] ] += blocks[ i ];
+		}
+
+		/* left looking: column j gathers the updates of all columns k with L( j, k ) != 0 */
+		BlockType tmp;
+		for( size_t j = 0; j < _n; j++ ) {
+			for( size_t p = _colStart[ j ]; p < _colStart[ j + 1 ]; p++ )
+				_slot[ _rows[ p ] ] = ( int ) p;
+
+			for( size_t rk = _rowStart[ j ]; rk < _rowStart[ j + 1 ]; rk++ ) {
+				size_t k = _rowCols[ rk ];
+				size_t bjk = _rowBlocks[ rk ];
+				const BlockType& Ljk = _L[ bjk ];
+				for( size_t q = bjk; q < _colStart[ k + 1 ]; q++ ) {
+					tmp.noalias() = _L[ q ] * Ljk.transpose();
+					_L[ _slot[ _rows[ q ] ] ] -= tmp;
+				}
+			}
+
+			/* L_jj and its inverse, the off-diagonal blocks become L_ij = A_ij L_jj^-T */
+			Eigen::LLT<BlockType> llt( _L[ _colStart[ j ] ] );
+			if( llt.info() != Eigen::Success )
+				return false;
+			_L[ _colStart[ j ] ] = llt.matrixL();
+			invertLower( _diagInv[ j ], _L[ _colStart[ j ] ] );
+			tmp = _diagInv[ j ].transpose();
+
+			for( size_t p = _colStart[ j ] + 1; p < _colStart[ j + 1 ]; p++ )
+				_L[ p ] = _L[ p ] * tmp;
+
+			for( size_t p = _colStart[ j ]; p < _colStart[ j + 1 ]; p++ )
+				_slot[ _rows[ p ] ] = -1;
+		}
+		return true;
+	}
+
+	template<int bSize>
+	inline void SparseBlockCholesky<bSize>::solve( Eigen::VectorXd& x, const Eigen::VectorXd& b ) const
+	{
+		typedef Eigen::Matrix<double, bSize, 1> VecType;
+		Eigen::VectorXd y( b.rows() );
+		for( size_t i = 0; i < _n; i++ )
+			y.template segment<bSize>( bSize * _perm[ i ] ) = b.template segment<bSize>( bSize * i );
+
+		/* L y = b */
+		for( size_t j = 0; j < _n; j++ ) {
+			VecType yj = _diagInv[ j ] * y.template segment<bSize>( bSize * j );
+			y.template segment<bSize>( bSize * j ) = yj;
+			for( size_t p = _colStart[ j ] + 1; p < _colStart[ j + 1 ]; p++ )
+				y.template segment<bSize>( bSize * _rows[ p ] ).noalias() -= _L[ p ] * yj;
+		}
+
+		/* L^T x = y */
+		for( size_t j = _n; j-- > 0; ) {
+			VecType xj = y.template segment<bSize>( bSize * j );
+			for( size_t p = _colStart[ j ] + 1; p < _colStart[ j + 1 ]; p++ )
+				xj.noalias() -= _L[ p ].transpose() * y.template segment<bSize>( bSize * _rows[ p ] );
+			y.template segment<bSize>( bSize * j ) = _diagInv[ j ].transpose() * xj;
+		}
+
+		x.resize( b.rows() );
+		for( size_t i = 0; i < _n; i++ )
+			x.template segment<bSize>( bSize * i ) = y.template segment<bSize>( bSize * _perm[ i ] );
+	}
+}
+
+#endif
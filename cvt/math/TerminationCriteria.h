@@ -47,7 +47,7 @@ namespace cvt
 			{}
 
 			TerminationCriteria( const TerminationCriteria & other ) :
-				_costThreshold( other._costThreshold ), _maxIterations( other._maxIterations )
+				_costThreshold( other._costThreshold ), _maxIterations( other._maxIterations ), _termType( other._termType )
 			{}
 
 			void setCostThreshold( T c ){ _costThreshold = c; }
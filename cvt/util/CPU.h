@@ -40,6 +40,7 @@ namespace cvt {
 		CPU_SSE4_1 = ( 1 << 6 ),
 		CPU_SSE4_2 = ( 1 << 7 ),
 		CPU_AVX    = ( 1 << 8 ),
+		CPU_F16C   = ( 1 << 9 ),
 	};
 
 	CVT_ENUM_TO_FLAGS( CPUFeatureFlags, CPUFeatures )
@@ -93,6 +94,8 @@ namespace cvt {
 			ret |= CPU_SSE4_2;
 		if( ecx & ( 1 << 28 ) )
 			ret |= CPU_AVX;
+		if( ecx & ( 1 << 29 ) )
+			ret |= CPU_F16C;
 		return ret;
 	}
 
@@ -117,6 +120,8 @@ namespace cvt {
 			std::cout << "SSE4.2 ";
 		if( f & CPU_AVX )
 			std::cout << "AVX ";
+		if( f & CPU_F16C )
+			std::cout << "F16C ";
 		std::cout << std::endl;
 	}
 
@@ -48,6 +48,17 @@ namespace cvt {
 		cvt::PluginInfo _cvtplugin = { CVT_PLUGIN_MAGIC, CVT_PLUGIN_MAJOR , CVT_PLUGIN_MINOR, ( void ( * )( cvt::PluginManager* ) ) initfunc }; \
 	}
 
+	/**
+	  \brief Registers the init function of a plugin compiled into the
+			 library or application, it is called when the PluginManager is created.
+	 */
+	struct StaticPluginRegistrar {
+		StaticPluginRegistrar( void (*init)( PluginManager* manager ) );
+	};
+
+#define CVT_PLUGIN_STATIC( initfunc ) \
+	static cvt::StaticPluginRegistrar _cvtstaticplugin_##initfunc( ( void ( * )( cvt::PluginManager* ) ) initfunc );
+
 	enum PluginType {
 		PLUGIN_ILOADER,
 		PLUGIN_ISAVER,
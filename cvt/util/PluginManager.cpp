@@ -27,11 +27,29 @@
 #include <cvt/io/FileSystem.h>
 #include <cvt/util/String.h>
 #include <cvt/util/Util.h>
+#include <cvt/util/Version.h>
 #include <vector>
+#include <fstream>
+#include <unistd.h>
 
 namespace cvt {
 	PluginManager* PluginManager::_instance = NULL;
 
+	StaticPluginRegistrar::StaticPluginRegistrar( void (*init)( PluginManager* manager ) )
+	{
+		PluginManager::staticPlugins().push_back( init );
+		// registered after the manager was created, e.g. from a library loaded later on
+		if( PluginManager::_instance )
+			init( PluginManager::_instance );
+	}
+
+	std::vector<PluginManager::PluginInit>& PluginManager::staticPlugins()
+	{
+		// function local to be independent of the static initialization order
+		static std::vector<PluginInit> plugins;
+		return plugins;
+	}
+
 	PluginManager& PluginManager::instance()
 	{
 		if( !_instance ) {
@@ -61,21 +79,222 @@ namespace cvt {
 	void PluginManager::loadDefault()
 	{
 		// Static default plugins
+		const std::vector<PluginInit>& statics = staticPlugins();
+		for( size_t i = 0; i < statics.size(); i++ )
+			statics[ i ]( this );
+
+		// Runtime loaded plugins: only opened if they are unknown to the manifest
+		std::vector<ManifestEntry> cached;
+		readManifest( cached );
 
-		// Runtime loaded plugins
+		bool dirty = false;
 		std::vector<String> entries;
 		for( size_t f = 0; f < _pluginPaths.size(); f++ ){
 			FileSystem::ls( _pluginPaths[ f ], entries );
 			for( std::vector<String>::iterator it = entries.begin(), end = entries.end(); it != end; ++it ) {
-				String path( _pluginPaths[ f ] );
-				try {
-					path += *it;
-					//std::cout << path << std::endl;
-					loadPlugin( path.c_str() );
-				} catch( Exception e ) {
-					std::cout << "Could not load plugin at path: " << path << std::endl;
+				ManifestEntry entry;
+				entry.path = _pluginPaths[ f ];
+				entry.path += *it;
+				entry.mtime = FileSystem::modificationTime( entry.path );
+				entry.size = FileSystem::size( entry.path );
+				entry.loaded = false;
+
+				bool found = false;
+				for( size_t i = 0; i < cached.size(); i++ ) {
+					if( cached[ i ].path == entry.path && cached[ i ].mtime == entry.mtime && cached[ i ].size == entry.size ) {
+						entry.records = cached[ i ].records;
+						found = true;
+						break;
+					}
+				}
+				_manifest.push_back( entry );
+
+				if( !found ) {
+					loadEntry( _manifest.back() );
+					dirty = true;
+				}
+			}
+		}
+
+		if( dirty || cached.size() != _manifest.size() )
+			writeManifest();
+	}
+
+	bool PluginManager::loadEntry( ManifestEntry& entry )
+	{
+		if( entry.loaded )
+			return false;
+		entry.loaded = true;
+
+		size_t nfilter = _ifilters.size();
+		size_t nloader = _iloaders.size();
+		size_t nsaver = _isavers.size();
+		size_t nscene = _sceneloaders.size();
+		try {
+			loadPlugin( entry.path );
+		} catch( Exception e ) {
+			std::cout << "Could not load plugin at path: " << entry.path << std::endl;
+			entry.records.clear();
+			return false;
+		}
+
+		// refresh the records with what the plugin actually registered
+		entry.records.clear();
+		for( size_t i = nfilter; i < _ifilters.size(); i++ ) {
+			ManifestRecord r;
+			r.type = PLUGIN_IFILTER;
+			r.name = _ifilters[ i ]->name();
+			entry.records.push_back( r );
+		}
+		for( size_t i = nloader; i < _iloaders.size(); i++ ) {
+			ManifestRecord r;
+			r.type = PLUGIN_ILOADER;
+			r.name = _iloaders[ i ]->name();
+			for( size_t e = 0; e < _iloaders[ i ]->sizeExtensions(); e++ )
+				r.extensions.push_back( _iloaders[ i ]->extension( e ) );
+			entry.records.push_back( r );
+		}
+		for( size_t i = nsaver; i < _isavers.size(); i++ ) {
+			ManifestRecord r;
+			r.type = PLUGIN_ISAVER;
+			r.name = _isavers[ i ]->name();
+			for( size_t e = 0; e < _isavers[ i ]->sizeExtensions(); e++ )
+				r.extensions.push_back( _isavers[ i ]->extension( e ) );
+			entry.records.push_back( r );
+		}
+		for( size_t i = nscene; i < _sceneloaders.size(); i++ ) {
+			ManifestRecord r;
+			r.type = PLUGIN_SCENELOADER;
+			r.name = _sceneloaders[ i ]->name();
+			for( size_t e = 0; e < _sceneloaders[ i ]->sizeExtensions(); e++ )
+				r.extensions.push_back( _sceneloaders[ i ]->extension( e ) );
+			entry.records.push_back( r );
+		}
+		return true;
+	}
+
+	bool PluginManager::loadEntries( PluginType type, const String& key, bool extension )
+	{
+		// an empty key loads every plugin file providing the type
+		bool ret = false;
+		for( size_t i = 0; i < _manifest.size(); i++ ) {
+			ManifestEntry& entry = _manifest[ i ];
+			if( entry.loaded )
+				continue;
+
+			bool match = false;
+			for( size_t r = 0; r < entry.records.size() && !match; r++ ) {
+				const ManifestRecord& rec = entry.records[ r ];
+				if( rec.type != type )
+					continue;
+				if( key.isEmpty() ) {
+					match = true;
+				} else if( extension ) {
+					for( size_t e = 0; e < rec.extensions.size() && !match; e++ )
+						match = key.hasSuffix( rec.extensions[ e ] );
+				} else {
+					match = rec.name == key;
 				}
 			}
+
+			if( match && loadEntry( entry ) )
+				ret = true;
+		}
+		return ret;
+	}
+
+	String PluginManager::manifestPath() const
+	{
+		String path;
+		if( Util::getEnv( path, "CVT_PLUGIN_CACHE" ) )
+			return path;
+		if( Util::getEnv( path, "HOME" ) ) {
+			path += "/.cvt_plugin_manifest";
+			return path;
+		}
+		return "";
+	}
+
+	/*
+	   Manifest layout, one tab separated record per line:
+		 CVTPLUGINMANIFEST <major> <minor>
+		 P <path> <mtime> <size>			plugin file
+		 R <type> <name> <extensions...>	registered by the preceding file
+	 */
+	void PluginManager::readManifest( std::vector<ManifestEntry>& cached ) const
+	{
+		cached.clear();
+		String path = manifestPath();
+		if( path.isEmpty() )
+			return;
+
+		std::ifstream file( path.c_str() );
+		std::string line;
+		if( !file.is_open() || !std::getline( file, line ) )
+			return;
+
+		String header;
+		header.sprintf( "CVTPLUGINMANIFEST\t%d\t%d", CVT_PLUGIN_MAJOR, CVT_PLUGIN_MINOR );
+		if( header != line.c_str() )
+			return;
+
+		std::vector<String> tokens;
+		while( std::getline( file, line ) ) {
+			tokens.clear();
+			String( line.c_str() ).tokenize( tokens, '\t' );
+			if( tokens.size() == 4 && tokens[ 0 ] == "P" ) {
+				ManifestEntry entry;
+				entry.path = tokens[ 1 ];
+				entry.mtime = tokens[ 2 ].toInteger();
+				entry.size = tokens[ 3 ].toInteger();
+				entry.loaded = false;
+				cached.push_back( entry );
+			} else if( tokens.size() >= 3 && tokens[ 0 ] == "R" && !cached.empty() ) {
+				ManifestRecord r;
+				r.type = ( PluginType ) tokens[ 1 ].toInteger();
+				r.name = tokens[ 2 ];
+				for( size_t i = 3; i < tokens.size(); i++ )
+					r.extensions.push_back( tokens[ i ] );
+				cached.back().records.push_back( r );
+			} else {
+				// corrupt manifest, rebuild it
+				cached.clear();
+				return;
+			}
+		}
+	}
+
+	void PluginManager::writeManifest() const
+	{
+		String path = manifestPath();
+		if( path.isEmpty() )
+			return;
+
+		// write to a temporary file first, concurrent processes may read the manifest
+		String tmp;
+		tmp.sprintf( "%s.%d", path.c_str(), ( int ) getpid() );
+		std::ofstream file( tmp.c_str() );
+		if( !file.is_open() )
+			return;
+
+		file << "CVTPLUGINMANIFEST\t" << CVT_PLUGIN_MAJOR << "\t" << CVT_PLUGIN_MINOR << "\n";
+		for( size_t i = 0; i < _manifest.size(); i++ ) {
+			const ManifestEntry& entry = _manifest[ i ];
+			file << "P\t" << entry.path << "\t" << entry.mtime << "\t" << entry.size << "\n";
+			for( size_t r = 0; r < entry.records.size(); r++ ) {
+				const ManifestRecord& rec = entry.records[ r ];
+				file << "R\t" << ( int ) rec.type << "\t" << rec.name;
+				for( size_t e = 0; e < rec.extensions.size(); e++ )
+					file << "\t" << rec.extensions[ e ];
+				file << "\n";
+			}
+		}
+		file.close();
+
+		try {
+			FileSystem::rename( tmp, path );
+		} catch( Exception e ) {
+			unlink( tmp.c_str() );
 		}
 	}
 
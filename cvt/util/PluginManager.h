@@ -38,16 +38,26 @@
 namespace cvt {
 	class Application;
 
+	/**
+	  \brief Registry of the loaders, savers and filters provided by plugins.
+
+	  Plugin files are not opened at startup: a manifest cache records the type,
+	  name and extensions of everything a plugin file registers, the file is
+	  only opened once one of its entries is requested. Files missing from the
+	  manifest or modified since are loaded once to refresh it. The manifest is
+	  stored at $CVT_PLUGIN_CACHE or $HOME/.cvt_plugin_manifest.
+	 */
 	class PluginManager {
 		friend class Application;
+		friend struct StaticPluginRegistrar;
 		public:
 			static PluginManager& instance();
 			void registerPlugin( Plugin* plugin );
 			void loadPlugin( const String& path );
 
-			IFilter* getIFilter( size_t i ) const;
-			IFilter* getIFilter( const String& name ) const;
-			size_t getIFilterSize() const;
+			IFilter* getIFilter( size_t i );
+			IFilter* getIFilter( const String& name );
+			size_t getIFilterSize();
 
 			ILoader* getILoaderForFilename( const String& name );
 			ISaver* getISaverForFilename( const String& name );
@@ -55,11 +65,40 @@ namespace cvt {
 			SceneLoader* getSceneLoaderForFilename( const String& name );
 
 		private:
+			typedef void (*PluginInit)( PluginManager* );
+
+			/* something a plugin file registers */
+			struct ManifestRecord {
+				PluginType			type;
+				String				name;
+				std::vector<String> extensions;
+			};
+
+			/* plugin file found in one of the plugin paths */
+			struct ManifestEntry {
+				String						path;
+				uint64_t					mtime;
+				size_t						size;
+				bool						loaded;
+				std::vector<ManifestRecord> records;
+			};
+
 			PluginManager();
 			PluginManager( const PluginManager& );
 			~PluginManager();
 			void loadDefault();
 			static void cleanup();
+			static std::vector<PluginInit>& staticPlugins();
+
+			String manifestPath() const;
+			void   readManifest( std::vector<ManifestEntry>& cached ) const;
+			void   writeManifest() const;
+			bool   loadEntry( ManifestEntry& entry );
+			bool   loadEntries( PluginType type, const String& key, bool extension );
+
+			ILoader*	 findILoader( const String& name ) const;
+			ISaver*		 findISaver( const String& name ) const;
+			SceneLoader* findSceneLoader( const String& name ) const;
 
 			std::vector<PluginFile*> _plugins;
 			std::vector<IFilter*> _ifilters;
@@ -69,6 +108,7 @@ namespace cvt {
 			std::map< const String, IFilter*> _ifiltermap;
 
 			std::vector<String>	  _pluginPaths;
+			std::vector<ManifestEntry> _manifest;
 
 			static PluginManager* _instance;
 	};
@@ -140,28 +180,57 @@ namespace cvt {
 	}
 
 
-	inline IFilter* PluginManager::getIFilter( size_t n ) const
+	inline IFilter* PluginManager::getIFilter( size_t n )
 	{
+		loadEntries( PLUGIN_IFILTER, "", false );
 		return _ifilters[ n ];
 	}
 
-	inline IFilter* PluginManager::getIFilter( const String& name ) const
+	inline IFilter* PluginManager::getIFilter( const String& name )
 	{
 		std::map< const String, IFilter*>::const_iterator it;
 		if( ( it = _ifiltermap.find( name ) ) != _ifiltermap.end() ) {
 			return it->second;
 		}
+		if( loadEntries( PLUGIN_IFILTER, name, false ) && ( it = _ifiltermap.find( name ) ) != _ifiltermap.end() ) {
+			return it->second;
+		}
 		return NULL;
 	}
 
-	inline size_t PluginManager::getIFilterSize() const
+	inline size_t PluginManager::getIFilterSize()
 	{
+		loadEntries( PLUGIN_IFILTER, "", false );
 		return _ifilters.size();
 	}
 
 	inline ILoader* PluginManager::getILoaderForFilename( const String& name )
 	{
-		for( std::vector<ILoader*>::iterator it = _iloaders.begin(), end = _iloaders.end(); it != end; ++it  )
+		ILoader* ret = findILoader( name );
+		if( !ret && loadEntries( PLUGIN_ILOADER, name, true ) )
+			ret = findILoader( name );
+		return ret;
+	}
+
+	inline ISaver* PluginManager::getISaverForFilename( const String& name )
+	{
+		ISaver* ret = findISaver( name );
+		if( !ret && loadEntries( PLUGIN_ISAVER, name, true ) )
+			ret = findISaver( name );
+		return ret;
+	}
+
+	inline SceneLoader* PluginManager::getSceneLoaderForFilename( const String& name )
+	{
+		SceneLoader* ret = findSceneLoader( name );
+		if( !ret && loadEntries( PLUGIN_SCENELOADER, name, true ) )
+			ret = findSceneLoader( name );
+		return ret;
+	}
+
+	inline ILoader* PluginManager::findILoader( const String& name ) const
+	{
+		for( std::vector<ILoader*>::const_iterator it = _iloaders.begin(), end = _iloaders.end(); it != end; ++it  )
 		{
 			for( size_t i = 0, end = ( *it )->sizeExtensions(); i < end; i++ ) {
 				if( name.hasSuffix( ( *it )->extension( i ) ) )
@@ -171,9 +240,9 @@ namespace cvt {
 		return NULL;
 	}
 
-	inline ISaver* PluginManager::getISaverForFilename( const String& name )
+	inline ISaver* PluginManager::findISaver( const String& name ) const
 	{
-		for( std::vector<ISaver*>::iterator it = _isavers.begin(), end = _isavers.end(); it != end; ++it  ) {
+		for( std::vector<ISaver*>::const_iterator it = _isavers.begin(), end = _isavers.end(); it != end; ++it  ) {
 			for( size_t i = 0, end = ( *it )->sizeExtensions(); i < end; i++ ) {
 				if( name.hasSuffix( ( *it )->extension( i ) ) )
 					return *it;
@@ -182,9 +251,9 @@ namespace cvt {
 		return NULL;
 	}
 
-	inline SceneLoader* PluginManager::getSceneLoaderForFilename( const String& name )
+	inline SceneLoader* PluginManager::findSceneLoader( const String& name ) const
 	{
-		for( std::vector<SceneLoader*>::iterator it = _sceneloaders.begin(), end = _sceneloaders.end(); it != end; ++it  )
+		for( std::vector<SceneLoader*>::const_iterator it = _sceneloaders.begin(), end = _sceneloaders.end(); it != end; ++it  )
 		{
 			for( size_t i = 0, end = ( *it )->sizeExtensions(); i < end; i++ ) {
 				if( name.hasSuffix( ( *it )->extension( i ) ) )
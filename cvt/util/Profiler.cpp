@@ -0,0 +1,282 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/util/Profiler.h>
+#include <cvt/util/Exception.h>
+#include <cvt/math/Math.h>
+
+#include <fstream>
+#include <map>
+#include <string.h>
+
+namespace cvt {
+
+	struct Profiler::ThreadBuffer {
+		ThreadBuffer( size_t id ) : id( id ), head( 0 ), inUse( true ) {}
+
+		size_t				id;
+		volatile uint64_t	head;
+		bool				inUse;
+		ProfileEvent		events[ CAPACITY ];
+	};
+
+	__thread Profiler::ThreadBuffer* Profiler::_threadBuffer = NULL;
+
+	Profiler& Profiler::instance()
+	{
+		static Profiler profiler;
+		return profiler;
+	}
+
+	Profiler::Profiler() : _enabled( true )
+	{
+		int err = pthread_key_create( &_key, Profiler::releaseBuffer );
+		if( err )
+			throw CVTException( err );
+	}
+
+	Profiler::~Profiler()
+	{
+		// threads still alive keep their buffer pointer, stop recording first
+		_enabled = false;
+		pthread_key_delete( _key );
+		for( size_t i = 0; i < _buffers.size(); i++ )
+			delete _buffers[ i ];
+	}
+
+	Profiler::ThreadBuffer* Profiler::acquireBuffer()
+	{
+		ThreadBuffer* buf = NULL;
+		_mutex.lock();
+		for( size_t i = 0; i < _buffers.size(); i++ ) {
+			if( !_buffers[ i ]->inUse ) {
+				buf = _buffers[ i ];
+				buf->inUse = true;
+				break;
+			}
+		}
+		if( !buf ) {
+			buf = new ThreadBuffer( _buffers.size() );
+			_buffers.push_back( buf );
+		}
+		_mutex.unlock();
+
+		// hand the buffer back once the thread exits
+		pthread_setspecific( _key, buf );
+		_threadBuffer = buf;
+		return buf;
+	}
+
+	void Profiler::releaseBuffer( void* buf )
+	{
+		Profiler& p = Profiler::instance();
+		p._mutex.lock();
+		( ( ThreadBuffer* ) buf )->inUse = false;
+		p._mutex.unlock();
+	}
+
+	void Profiler::record( const char* name, uint64_t begin, uint64_t end )
+	{
+		if( !_enabled )
+			return;
+
+		ThreadBuffer* buf = _threadBuffer;
+		if( !buf )
+			buf = acquireBuffer();
+
+		ProfileEvent& ev = buf->events[ buf->head & ( CAPACITY - 1 ) ];
+		ev.name = name;
+		ev.begin = begin;
+		ev.end = end;
+		ev.thread = buf->id;
+		buf->head = buf->head + 1;
+	}
+
+	void Profiler::clear()
+	{
+		_mutex.lock();
+		for( size_t i = 0; i < _buffers.size(); i++ )
+			_buffers[ i ]->head = 0;
+		_mutex.unlock();
+	}
+
+	void Profiler::events( std::vector<ProfileEvent>& events ) const
+	{
+		events.clear();
+		_mutex.lock();
+		for( size_t i = 0; i < _buffers.size(); i++ ) {
+			const ThreadBuffer* buf = _buffers[ i ];
+			uint64_t head = buf->head;
+			uint64_t n = head < CAPACITY ? head : CAPACITY;
+			for( uint64_t k = head - n; k < head; k++ )
+				events.push_back( buf->events[ k & ( CAPACITY - 1 ) ] );
+		}
+		_mutex.unlock();
+	}
+
+	void Profiler::histograms( std::vector<ProfileHistogram>& hists ) const
+	{
+		std::vector<ProfileEvent> evs;
+		events( evs );
+
+		// zones are identified by name, equal literals may have different addresses
+		std::map<std::string, size_t> index;
+		hists.clear();
+		for( size_t i = 0; i < evs.size(); i++ ) {
+			const ProfileEvent& ev = evs[ i ];
+			std::map<std::string, size_t>::iterator it = index.find( ev.name );
+			if( it == index.end() ) {
+				it = index.insert( std::make_pair( std::string( ev.name ), hists.size() ) ).first;
+				hists.push_back( ProfileHistogram( ev.name ) );
+			}
+			hists[ it->second ].add( ev.end - ev.begin );
+		}
+	}
+
+	static void _writeJSONString( std::ofstream& out, const char* str )
+	{
+		out << '"';
+		for( ; *str; str++ ) {
+			if( *str == '"' || *str == '\\' )
+				out << '\\';
+			out << *str;
+		}
+		out << '"';
+	}
+
+	void Profiler::saveChromeTrace( const String& path ) const
+	{
+		std::vector<ProfileEvent> evs;
+		events( evs );
+
+		std::ofstream out( path.c_str() );
+		if( !out.is_open() )
+			throw CVTException( "Profiler: could not open file for writing: " + std::string( path.c_str() ) );
+
+		uint64_t t0 = ( uint64_t ) -1;
+		for( size_t i = 0; i < evs.size(); i++ )
+			t0 = Math::min( t0, evs[ i ].begin );
+
+		out.setf( std::ios::fixed );
+		out.precision( 3 );
+		out << "{\"traceEvents\":[\n";
+		for( size_t i = 0; i < evs.size(); i++ ) {
+			const ProfileEvent& ev = evs[ i ];
+			out << "{\"name\":";
+			_writeJSONString( out, ev.name );
+			out << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << ev.thread
+				<< ",\"ts\":" << ( double ) ( ev.begin - t0 ) * 1e-3
+				<< ",\"dur\":" << ( double ) ( ev.end - ev.begin ) * 1e-3 << "}";
+			if( i + 1 < evs.size() )
+				out << ",";
+			out << "\n";
+		}
+		out << "],\"displayTimeUnit\":\"ms\"}\n";
+	}
+
+	ProfileHistogram::ProfileHistogram( const char* name ) :
+		_name( name ),
+		_count( 0 ),
+		_min( ( uint64_t ) -1 ),
+		_max( 0 ),
+		_sum( 0.0 )
+	{
+		memset( _bins, 0, sizeof( _bins ) );
+	}
+
+	size_t ProfileHistogram::binForValue( uint64_t ns )
+	{
+		if( ns < 4 )
+			return ( size_t ) ns;
+		size_t e = 63 - __builtin_clzll( ns );
+		return 4 * ( e - 1 ) + ( size_t ) ( ( ns >> ( e - 2 ) ) & 3 );
+	}
+
+	uint64_t ProfileHistogram::binLowerBound( size_t bin )
+	{
+		if( bin < 4 )
+			return bin;
+		size_t e = bin / 4 + 1;
+		return ( uint64_t ) ( 4 + bin % 4 ) << ( e - 2 );
+	}
+
+	double ProfileHistogram::binUpperMS( size_t bin )
+	{
+		if( bin + 1 >= NUM_BINS )
+			return ( double ) ( uint64_t ) -1 * 1e-6;
+		return ( double ) binLowerBound( bin + 1 ) * 1e-6;
+	}
+
+	void ProfileHistogram::add( uint64_t ns )
+	{
+		_bins[ binForValue( ns ) ]++;
+		_count++;
+		_min = Math::min( _min, ns );
+		_max = Math::max( _max, ns );
+		_sum += ( double ) ns;
+	}
+
+	double ProfileHistogram::minMS() const
+	{
+		return _count ? ( double ) _min * 1e-6 : 0.0;
+	}
+
+	double ProfileHistogram::maxMS() const
+	{
+		return ( double ) _max * 1e-6;
+	}
+
+	double ProfileHistogram::meanMS() const
+	{
+		return _count ? _sum * 1e-6 / ( double ) _count : 0.0;
+	}
+
+	double ProfileHistogram::percentileMS( double p ) const
+	{
+		if( !_count )
+			return 0.0;
+		uint64_t rank = ( uint64_t ) Math::ceil( Math::clamp( p, 0.0, 1.0 ) * ( double ) _count );
+		if( rank == 0 )
+			rank = 1;
+		uint64_t acc = 0;
+		for( size_t i = 0; i < NUM_BINS; i++ ) {
+			acc += _bins[ i ];
+			if( acc >= rank )
+				return Math::min( binUpperMS( i ), maxMS() );
+		}
+		return maxMS();
+	}
+
+	std::ostream& operator<<( std::ostream& out, const ProfileHistogram& hist )
+	{
+		out << hist.name() << ": n=" << hist.count()
+			<< " mean=" << hist.meanMS() << "ms"
+			<< " min=" << hist.minMS() << "ms"
+			<< " p50=" << hist.percentileMS( 0.5 ) << "ms"
+			<< " p99=" << hist.percentileMS( 0.99 ) << "ms"
+			<< " max=" << hist.maxMS() << "ms";
+		return out;
+	}
+}
@@ -0,0 +1,187 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_PROFILER_H
+#define CVT_PROFILER_H
+
+#include <cvt/util/Mutex.h>
+#include <cvt/util/String.h>
+
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#ifdef APPLE
+	#include <mach/mach_time.h>
+#endif
+#include <vector>
+#include <iostream>
+
+/**
+  \brief Time the enclosing scope as zone name ( a string literal )
+
+  The zones are only recorded if the library and the including code are
+  compiled with CVT_PROFILING defined, otherwise the macro expands to nothing.
+  Use it in .cpp files only, in inline or template code of headers the
+  expansion would depend on the including code.
+ */
+#ifdef CVT_PROFILING
+	#define CVT_PROFILE_SCOPE( name ) cvt::ProfileScope CVT_PROFILE_CONCAT( _cvtProfileScope, __LINE__ )( name )
+#else
+	#define CVT_PROFILE_SCOPE( name )
+#endif
+
+#define CVT_PROFILE_CONCAT( a, b ) CVT_PROFILE_CONCAT2( a, b )
+#define CVT_PROFILE_CONCAT2( a, b ) a##b
+
+namespace cvt {
+
+	/**
+	  \brief A recorded zone, times in nanoseconds of the monotonic clock
+	 */
+	struct ProfileEvent {
+		const char* name;
+		uint64_t	begin;
+		uint64_t	end;
+		size_t		thread;
+	};
+
+	/**
+	  \brief Latency histogram of one zone with logarithmic bins
+
+	  Every power of two is split into four bins, percentiles are reported
+	  as the upper bound of the bin they fall into.
+	 */
+	class ProfileHistogram {
+		public:
+			ProfileHistogram( const char* name = "" );
+
+			void		add( uint64_t ns );
+
+			const char* name() const	{ return _name; }
+			size_t		count() const	{ return _count; }
+			double		minMS() const;
+			double		maxMS() const;
+			double		meanMS() const;
+			double		percentileMS( double p ) const;
+
+			static const size_t NUM_BINS = 252;
+			uint64_t	binCount( size_t bin ) const { return _bins[ bin ]; }
+			static double binUpperMS( size_t bin );
+
+		private:
+			static size_t	binForValue( uint64_t ns );
+			static uint64_t binLowerBound( size_t bin );
+
+			const char* _name;
+			size_t		_count;
+			uint64_t	_min;
+			uint64_t	_max;
+			double		_sum;
+			uint64_t	_bins[ NUM_BINS ];
+	};
+
+	std::ostream& operator<<( std::ostream& out, const ProfileHistogram& hist );
+
+	/**
+	  \brief Scoped zone profiler
+
+	  Every thread records into its own ring buffer without locking, so only
+	  the latest bufferCapacity() zones per thread are kept. Buffers of
+	  finished threads are reused by new threads. Snapshots, histograms and
+	  traces should be taken while the profiled code is quiescent, zones
+	  recorded concurrently may be missing or overwritten.
+	 */
+	class Profiler {
+		public:
+			static Profiler& instance();
+
+			/* monotonic time in nanoseconds */
+			static uint64_t timestamp();
+
+			void	setEnabled( bool enabled )	{ _enabled = enabled; }
+			bool	enabled() const				{ return _enabled; }
+			size_t	bufferCapacity() const		{ return CAPACITY; }
+
+			void	record( const char* name, uint64_t begin, uint64_t end );
+			void	clear();
+
+			void	events( std::vector<ProfileEvent>& events ) const;
+			void	histograms( std::vector<ProfileHistogram>& hists ) const;
+
+			/**
+			  \brief Save the recorded zones as Chrome trace event JSON
+			  ( chrome://tracing, Perfetto )
+			 */
+			void	saveChromeTrace( const String& path ) const;
+
+		private:
+			Profiler();
+			~Profiler();
+			Profiler( const Profiler& );
+
+			struct ThreadBuffer;
+			ThreadBuffer*	acquireBuffer();
+			static void		releaseBuffer( void* buf );
+
+			static const size_t CAPACITY = 1 << 14;
+			static __thread ThreadBuffer* _threadBuffer;
+
+			mutable Mutex				_mutex;
+			std::vector<ThreadBuffer*>	_buffers;
+			pthread_key_t				_key;
+			volatile bool				_enabled;
+	};
+
+	/**
+	  \brief Records the lifetime of the object as zone, see CVT_PROFILE_SCOPE
+	 */
+	class ProfileScope {
+		public:
+			ProfileScope( const char* name ) : _name( name ), _begin( Profiler::timestamp() ) {}
+			~ProfileScope() { Profiler::instance().record( _name, _begin, Profiler::timestamp() ); }
+
+		private:
+			ProfileScope( const ProfileScope& );
+
+			const char* _name;
+			uint64_t	_begin;
+	};
+
+	inline uint64_t Profiler::timestamp()
+	{
+#ifdef APPLE
+		static mach_timebase_info_data_t timebase;
+		if( timebase.denom == 0 )
+			mach_timebase_info( &timebase );
+		return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+		struct timespec ts;
+		clock_gettime( CLOCK_MONOTONIC, &ts );
+		return ( uint64_t ) ts.tv_sec * 1000000000ULL + ( uint64_t ) ts.tv_nsec;
+#endif
+	}
+}
+
+#endif
@@ -0,0 +1,176 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/Profiler.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/CVTTest.h>
+
+#include <string.h>
+#include <vector>
+
+namespace cvt {
+
+	static size_t _profilerCount( const std::vector<ProfileEvent>& evs, const char* name )
+	{
+		size_t n = 0;
+		for( size_t i = 0; i < evs.size(); i++ ) {
+			if( !strcmp( evs[ i ].name, name ) )
+				n++;
+		}
+		return n;
+	}
+
+	static const ProfileHistogram* _profilerHistogram( const std::vector<ProfileHistogram>& hists, const char* name )
+	{
+		for( size_t i = 0; i < hists.size(); i++ ) {
+			if( !strcmp( hists[ i ].name(), name ) )
+				return &hists[ i ];
+		}
+		return NULL;
+	}
+
+	/* the percentile is the upper bound of its bin, at most a quarter above the value */
+	static bool _profilerPercentile( const ProfileHistogram& hist, double p, double expectedMS )
+	{
+		double v = hist.percentileMS( p );
+		return v >= expectedMS && v <= expectedMS * 1.25;
+	}
+
+	static bool _profilerHistogramTest()
+	{
+		bool ret = true;
+		bool b;
+
+		/* 1us ... 100us */
+		ProfileHistogram hist( "hist" );
+		for( uint64_t k = 1; k <= 100; k++ )
+			hist.add( k * 1000 );
+
+		b = hist.count() == 100;
+		b &= Math::abs( hist.minMS() - 0.001 ) < 1e-9;
+		b &= Math::abs( hist.maxMS() - 0.1 ) < 1e-9;
+		b &= Math::abs( hist.meanMS() - 0.0505 ) < 1e-9;
+		CVTTEST_PRINT( "ProfileHistogram count, min, max and mean", b );
+		ret &= b;
+
+		b = _profilerPercentile( hist, 0.0, 0.001 );
+		b &= _profilerPercentile( hist, 0.5, 0.05 );
+		b &= _profilerPercentile( hist, 0.9, 0.09 );
+		b &= Math::abs( hist.percentileMS( 1.0 ) - 0.1 ) < 1e-9;
+		CVTTEST_PRINT( "ProfileHistogram percentiles", b );
+		ret &= b;
+
+		uint64_t total = 0;
+		for( size_t i = 0; i < ProfileHistogram::NUM_BINS; i++ )
+			total += hist.binCount( i );
+		b = total == 100;
+		for( size_t i = 1; i < ProfileHistogram::NUM_BINS; i++ )
+			b &= ProfileHistogram::binUpperMS( i ) > ProfileHistogram::binUpperMS( i - 1 );
+		CVTTEST_PRINT( "ProfileHistogram bins", b );
+		ret &= b;
+
+		ProfileHistogram empty;
+		b = empty.count() == 0 && empty.percentileMS( 0.5 ) == 0.0 && empty.meanMS() == 0.0;
+		CVTTEST_PRINT( "ProfileHistogram empty", b );
+		ret &= b;
+
+		return ret;
+	}
+}
+
+using namespace cvt;
+
+BEGIN_CVTTEST( Profiler )
+	bool ret = true;
+	bool b;
+
+	Profiler& prof = Profiler::instance();
+	bool enabled = prof.enabled();
+	std::vector<ProfileEvent> evs;
+	std::vector<ProfileHistogram> hists;
+
+	prof.setEnabled( true );
+	prof.clear();
+
+	/* durations of 1us ... 10us and 5 times 20us */
+	for( uint64_t k = 1; k <= 10; k++ )
+		prof.record( "ProfilerTest::a", 1000 * k, 2000 * k );
+	for( uint64_t k = 0; k < 5; k++ )
+		prof.record( "ProfilerTest::b", 0, 20000 );
+
+	prof.events( evs );
+	b = evs.size() == 15;
+	b &= _profilerCount( evs, "ProfilerTest::a" ) == 10;
+	b &= _profilerCount( evs, "ProfilerTest::b" ) == 5;
+	for( size_t i = 1; i < evs.size(); i++ )
+		b &= evs[ i ].thread == evs[ 0 ].thread;
+	b &= evs.size() && evs[ 0 ].begin == 1000 && evs[ 0 ].end == 2000;
+	CVTTEST_PRINT( "Profiler record and events", b );
+	ret &= b;
+
+	prof.histograms( hists );
+	const ProfileHistogram* ha = _profilerHistogram( hists, "ProfilerTest::a" );
+	const ProfileHistogram* hb = _profilerHistogram( hists, "ProfilerTest::b" );
+	b = hists.size() == 2 && ha && hb;
+	b &= ha && ha->count() == 10 && Math::abs( ha->minMS() - 0.001 ) < 1e-9 && Math::abs( ha->maxMS() - 0.01 ) < 1e-9;
+	b &= hb && hb->count() == 5 && Math::abs( hb->meanMS() - 0.02 ) < 1e-9;
+	CVTTEST_PRINT( "Profiler histograms", b );
+	ret &= b;
+
+	prof.setEnabled( false );
+	prof.record( "ProfilerTest::a", 0, 1 );
+	prof.events( evs );
+	b = evs.size() == 15;
+	CVTTEST_PRINT( "Profiler disabled", b );
+	ret &= b;
+	prof.setEnabled( true );
+
+	prof.clear();
+	prof.events( evs );
+	b = evs.empty();
+	{
+		ProfileScope scope( "ProfilerTest::scope" );
+	}
+	prof.events( evs );
+	b &= evs.size() == 1 && !strcmp( evs[ 0 ].name, "ProfilerTest::scope" ) && evs[ 0 ].end >= evs[ 0 ].begin;
+	CVTTEST_PRINT( "Profiler clear and ProfileScope", b );
+	ret &= b;
+
+	/* the ring buffer keeps the latest zones */
+	prof.clear();
+	size_t cap = prof.bufferCapacity();
+	for( uint64_t k = 0; k < cap + 10; k++ )
+		prof.record( "ProfilerTest::ring", k, k + 1 );
+	prof.events( evs );
+	b = evs.size() == cap && evs[ 0 ].begin == 10 && evs.back().begin == cap + 9;
+	CVTTEST_PRINT( "Profiler ring buffer", b );
+	ret &= b;
+
+	ret &= _profilerHistogramTest();
+
+	prof.clear();
+	prof.setEnabled( enabled );
+
+	return ret;
+END_CVTTEST
@@ -1208,6 +1208,27 @@ namespace cvt {
         return sum;
     }
 
+    float SIMD::dot( float const* src1, float const* src2, const size_t n ) const
+    {
+        size_t i = n >> 2;
+
+        float sum = 0.0f;
+        while( i-- ) {
+            sum += src1[ 0 ] * src2[ 0 ];
+            sum += src1[ 1 ] * src2[ 1 ];
+            sum += src1[ 2 ] * src2[ 2 ];
+            sum += src1[ 3 ] * src2[ 3 ];
+            src1 += 4; src2 += 4;
+        }
+
+        i = n & 0x03;
+        while( i-- ) {
+            sum += *src1++ * *src2++;
+        }
+
+        return sum;
+    }
+
     float SIMD::SAD( const float* src1, const float* src2, const size_t n ) const
     {
         size_t i = n >> 2;
@@ -2066,6 +2087,62 @@ namespace cvt {
     }
 
 
+    static inline uint16_t _floatToHalf( float f )
+    {
+        union { float f; uint32_t u; } in, magic;
+        in.f = f;
+        uint16_t sign = ( in.u >> 16 ) & 0x8000;
+        in.u &= 0x7fffffff;
+
+        if( in.u >= 0x47800000 ) {
+            // too large for half or inf/nan
+            return sign | ( in.u > 0x7f800000 ? 0x7e00 : 0x7c00 );
+        } else if( in.u < 0x38800000 ) {
+            // subnormal half, the addition does the rounding
+            magic.u = 126 << 23;
+            in.f += magic.f;
+            return sign | ( uint16_t ) ( in.u - magic.u );
+        }
+        // rebias the exponent and round to nearest even
+        uint32_t odd = ( in.u >> 13 ) & 1;
+        in.u += ( ( uint32_t ) ( 15 - 127 ) << 23 ) + 0xfff + odd;
+        return sign | ( uint16_t ) ( in.u >> 13 );
+    }
+
+    static inline float _halfToFloat( uint16_t h )
+    {
+        union { float f; uint32_t u; } out, magic;
+        const uint32_t shiftedExp = 0x7c00 << 13;
+        out.u = ( h & 0x7fff ) << 13;
+        uint32_t exp = out.u & shiftedExp;
+        out.u += ( 127 - 15 ) << 23;
+        if( exp == shiftedExp ) {
+            // inf/nan
+            out.u += ( 128 - 16 ) << 23;
+        } else if( !exp ) {
+            // subnormal
+            magic.u = 113 << 23;
+            out.u += 1 << 23;
+            out.f -= magic.f;
+        }
+        out.u |= ( uint32_t ) ( h & 0x8000 ) << 16;
+        return out.f;
+    }
+
+    void SIMD::Conv_f_to_f16( uint16_t* dst, const float* src, const size_t n ) const
+    {
+        size_t i = n;
+        while( i-- )
+            *dst++ = _floatToHalf( *src++ );
+    }
+
+    void SIMD::Conv_f16_to_f( float* dst, const uint16_t* src, const size_t n ) const
+    {
+        size_t i = n;
+        while( i-- )
+            *dst++ = _halfToFloat( *src++ );
+    }
+
     void SIMD::Conv_u16_to_f( float* dst, uint16_t const* src, const size_t n ) const
     {
         size_t i = n >> 2;
@@ -2663,10 +2740,10 @@ namespace cvt {
             *dst++ = out;
         }
 
+        _srcy = ( uint8_t* ) srcy;
         if( n & 0x2 ) {
-            _srcy = ( uint8_t* ) srcy;
-            u = *srcu - 128;
-            v = *srcv - 128;
+            u = *srcu++ - 128;
+            v = *srcv++ - 128;
             r = ((v*1634) >> 10);
             g = ((u*401 + v*832) >> 10);
             b = ((u*2066) >> 10);
@@ -2685,6 +2762,22 @@ namespace cvt {
             out |= Math::clamp( y + b, 0, 255 ) << 16;
             *dst++ = out;
         }
+
+        // odd width, the last pixel has its own chroma sample
+        if( n & 0x1 ) {
+            u = *srcu - 128;
+            v = *srcv - 128;
+            r = ((v*1634) >> 10);
+            g = ((u*401 + v*832) >> 10);
+            b = ((u*2066) >> 10);
+
+            y = ( ( ( int ) *_srcy - 16 ) * 1192 ) >> 10;
+            out = 0xff000000;
+            out |= Math::clamp( y + r, 0, 255 );
+            out |= Math::clamp( y - g, 0, 255 ) << 8;
+            out |= Math::clamp( y + b, 0, 255 ) << 16;
+            *dst = out;
+        }
     }
 
     void SIMD::Conv_YUV420u8_to_BGRAu8( uint8_t* _dst, const uint8_t* _srcy, const uint8_t* srcu, const uint8_t* srcv, const size_t n ) const
@@ -2739,10 +2832,10 @@ namespace cvt {
             *dst++ = out;
         }
 
+        _srcy = ( uint8_t* ) srcy;
         if( n & 0x2 ) {
-            _srcy = ( uint8_t* ) srcy;
-            u = *srcu - 128;
-            v = *srcv - 128;
+            u = *srcu++ - 128;
+            v = *srcv++ - 128;
             r = ((v*1634) >> 10);
             g = ((u*401 + v*832) >> 10);
             b = ((u*2066) >> 10);
@@ -2761,6 +2854,22 @@ namespace cvt {
             out |= Math::clamp( y + b, 0, 255 );
             *dst++ = out;
         }
+
+        // odd width, the last pixel has its own chroma sample
+        if( n & 0x1 ) {
+            u = *srcu - 128;
+            v = *srcv - 128;
+            r = ((v*1634) >> 10);
+            g = ((u*401 + v*832) >> 10);
+            b = ((u*2066) >> 10);
+
+            y = ( ( ( int ) *_srcy - 16 ) * 1192 ) >> 10;
+            out = 0xff000000;
+            out |= Math::clamp( y + r, 0, 255 ) << 16;
+            out |= Math::clamp( y - g, 0, 255 ) << 8;
+            out |= Math::clamp( y + b, 0, 255 );
+            *dst = out;
+        }
     }
 
     void SIMD::Decompose_4f( float* dst1, float* dst2, float* dst3, float* dst4, const float* src, size_t n ) const
@@ -4706,6 +4815,95 @@ namespace cvt {
 
     }
 
+	void SIMD::remapBilinear1u8( uint8_t* dst, const int16_t* xy, const uint16_t* frac, const uint8_t* src, size_t srcStride, uint8_t fill, size_t n ) const
+	{
+		while( n-- ) {
+			uint16_t f = *frac++;
+			if( f & 0x8000 ) {
+				*dst++ = fill;
+				xy += 2;
+				continue;
+			}
+			int ax = f & 0x3f;
+			int ay = ( f >> 8 ) & 0x3f;
+			const uint8_t* p = src + srcStride * xy[ 1 ] + xy[ 0 ];
+			xy += 2;
+			int v0 = p[ 0 ] * ( 32 - ax ) + p[ 1 ] * ax;
+			p += srcStride;
+			int v1 = p[ 0 ] * ( 32 - ax ) + p[ 1 ] * ax;
+			*dst++ = ( uint8_t ) ( ( v0 * ( 32 - ay ) + v1 * ay + 512 ) >> 10 );
+		}
+	}
+
+	void SIMD::remapBilinear4u8( uint8_t* dst, const int16_t* xy, const uint16_t* frac, const uint8_t* src, size_t srcStride, uint32_t fill, size_t n ) const
+	{
+		while( n-- ) {
+			uint16_t f = *frac++;
+			if( f & 0x8000 ) {
+				*( ( uint32_t* ) dst ) = fill;
+				dst += 4;
+				xy += 2;
+				continue;
+			}
+			int ax = f & 0x3f;
+			int ay = ( f >> 8 ) & 0x3f;
+			const uint8_t* p = src + srcStride * xy[ 1 ] + sizeof( uint32_t ) * xy[ 0 ];
+			xy += 2;
+			for( size_t c = 0; c < 4; c++ ) {
+				int v0 = p[ c ] * ( 32 - ax ) + p[ c + 4 ] * ax;
+				int v1 = p[ c + srcStride ] * ( 32 - ax ) + p[ c + srcStride + 4 ] * ax;
+				*dst++ = ( uint8_t ) ( ( v0 * ( 32 - ay ) + v1 * ay + 512 ) >> 10 );
+			}
+		}
+	}
+
+	void SIMD::remapBilinear1f( float* dst, const int16_t* xy, const uint16_t* frac, const float* src, size_t srcStride, float fill, size_t n ) const
+	{
+		const float scale = 1.0f / 32.0f;
+
+		while( n-- ) {
+			uint16_t f = *frac++;
+			if( f & 0x8000 ) {
+				*dst++ = fill;
+				xy += 2;
+				continue;
+			}
+			float ax = ( float ) ( f & 0x3f ) * scale;
+			float ay = ( float ) ( ( f >> 8 ) & 0x3f ) * scale;
+			const float* p = ( const float* ) ( ( const uint8_t* ) src + srcStride * xy[ 1 ] ) + xy[ 0 ];
+			const float* p2 = ( const float* ) ( ( const uint8_t* ) p + srcStride );
+			xy += 2;
+			float v0 = Math::mix( p[ 0 ], p[ 1 ], ax );
+			float v1 = Math::mix( p2[ 0 ], p2[ 1 ], ax );
+			*dst++ = Math::mix( v0, v1, ay );
+		}
+	}
+
+	void SIMD::remapBilinear4f( float* dst, const int16_t* xy, const uint16_t* frac, const float* src, size_t srcStride, const float* fill, size_t n ) const
+	{
+		const float scale = 1.0f / 32.0f;
+
+		while( n-- ) {
+			uint16_t f = *frac++;
+			if( f & 0x8000 ) {
+				for( size_t c = 0; c < 4; c++ )
+					*dst++ = fill[ c ];
+				xy += 2;
+				continue;
+			}
+			float ax = ( float ) ( f & 0x3f ) * scale;
+			float ay = ( float ) ( ( f >> 8 ) & 0x3f ) * scale;
+			const float* p = ( const float* ) ( ( const uint8_t* ) src + srcStride * xy[ 1 ] ) + 4 * xy[ 0 ];
+			const float* p2 = ( const float* ) ( ( const uint8_t* ) p + srcStride );
+			xy += 2;
+			for( size_t c = 0; c < 4; c++ ) {
+				float v0 = Math::mix( p[ c ], p[ c + 4 ], ax );
+				float v1 = Math::mix( p2[ c ], p2[ c + 4 ], ax );
+				*dst++ = Math::mix( v0, v1, ay );
+			}
+		}
+	}
+
 	void SIMD::harrisScore1f( float* dst, const float* boxdx2, const float* boxdy2, const float* boxdxdy, float k, size_t width ) const
 	{
 		size_t x;
@@ -5749,6 +5947,48 @@ namespace cvt {
         }
     }
 
+    void SIMD::IIR4Lanes_f( float* dst, const float** x, const float** y, const float* c, size_t n ) const
+    {
+        const float* x0 = x[ 0 ];
+        const float* x1 = x[ 1 ];
+        const float* x2 = x[ 2 ];
+        const float* x3 = x[ 3 ];
+        const float* y0 = y[ 0 ];
+        const float* y1 = y[ 1 ];
+        const float* y2 = y[ 2 ];
+        const float* y3 = y[ 3 ];
+
+        for( size_t i = 0; i < n; i++ ) {
+            dst[ i ] = c[ 0 ] * x0[ i ] + c[ 1 ] * x1[ i ] + c[ 2 ] * x2[ i ] + c[ 3 ] * x3[ i ]
+                     - c[ 4 ] * y0[ i ] - c[ 5 ] * y1[ i ] - c[ 6 ] * y2[ i ] - c[ 7 ] * y3[ i ];
+        }
+    }
+
+    void SIMD::BSplineWeights_f( float* weights, int32_t* index, const float* src, float scale, float offset, float lo, float hi, size_t n ) const
+    {
+        const float s6 = 1.0f / 6.0f;
+        while( n-- ) {
+            float x = *src++ * scale + offset;
+            /* NaN maps to lo like the SSE version */
+            if( !( x >= lo ) )
+                x = lo;
+            if( x > hi )
+                x = hi;
+            int32_t idx = ( int32_t ) x;
+            float t = x - ( float ) idx;
+            float t2 = t * t;
+            float t3 = t2 * t;
+            float u = 1.0f - t;
+
+            *index++ = idx;
+            weights[ 0 ] = u * u * u * s6;
+            weights[ 1 ] = ( 3.0f * t3 - 6.0f * t2 + 4.0f ) * s6;
+            weights[ 2 ] = ( -3.0f * t3 + 3.0f * t2 + 3.0f * t + 1.0f ) * s6;
+            weights[ 3 ] = t3 * s6;
+            weights += 4;
+        }
+    }
+
     size_t SIMD::hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const
     {
         size_t d = 0;
@@ -5795,6 +6035,24 @@ namespace cvt {
         return d;
     }
 
+    void SIMD::AddU8_to_u16( uint16_t* dst, const uint8_t* src, size_t n ) const
+    {
+        while( n-- )
+            *dst++ += *src++;
+    }
+
+    void SIMD::fernIndices_u8( uint16_t* dst, const uint8_t* a, const uint8_t* b, size_t nferns, size_t ntests ) const
+    {
+        for( size_t f = 0; f < nferns; f++ ) {
+            uint16_t idx = 0;
+            for( size_t t = 0; t < ntests; t++ ) {
+                size_t off = t * nferns + f;
+                idx = ( idx << 1 ) | ( a[ off ] < b[ off ] ? 1 : 0 );
+            }
+            dst[ f ] = idx;
+        }
+    }
+
     /*
     {
         size_t d = 0;
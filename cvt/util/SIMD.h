@@ -150,6 +150,15 @@ namespace cvt {
              */
             virtual float sumSqr( float const* src, const size_t n ) const;
 
+            /**
+             * @brief dot - compute the inner product of two arrays
+             * @param src1  first input
+             * @param src2  second input
+             * @param n     size of array
+             * @return \sum_i src1[ i ] * src2[ i ]
+             */
+            virtual float dot( float const* src1, float const* src2, const size_t n ) const;
+
             virtual float SAD( const float* src1, const float* src2, const size_t n ) const;
             virtual size_t SAD( uint8_t const* src1, uint8_t const* src2, const size_t n ) const;
 
@@ -169,6 +178,14 @@ namespace cvt {
             virtual void IIR4BwdVertical4Fx( uint8_t * dst, size_t dstride, Fixed* fwdRes,
                                              size_t h, const Fixed * n, const Fixed * d, const Fixed & b ) const;
 
+            /* one step of a fourth order recursion over n independent lanes:
+               dst = c[ 0 ] * x[ 0 ] + ... + c[ 3 ] * x[ 3 ] - c[ 4 ] * y[ 0 ] - ... - c[ 7 ] * y[ 3 ] */
+            virtual void IIR4Lanes_f( float* dst, const float** x, const float** y, const float* coeffs, size_t n ) const;
+
+            /* cubic B-spline histogram weights: x = clamp( src * scale + offset, lo, hi ) with lo >= 0,
+               index[ i ] = ( int ) x and weights[ 4 * i + k ] = B( index[ i ] - 1 + k - x ), k = 0 ... 3 */
+            virtual void BSplineWeights_f( float* weights, int32_t* index, const float* src, float scale, float offset, float lo, float hi, size_t n ) const;
+
 			/* add vertical */
 			virtual void AddVert_f( float* dst, const float**bufs, size_t numbufs, size_t width ) const;
 			virtual void AddVert_f_to_u8( uint8_t* dst, const float**bufs, size_t numbufs, size_t width ) const;
@@ -231,6 +248,10 @@ namespace cvt {
             virtual void Conv_s16_to_u8( uint8_t* dst, int16_t const* src, const size_t n ) const;
 
             virtual void Conv_u16_to_f( float* dst, const uint16_t* src, const size_t n ) const;
+
+            // IEEE 754 half precision, rounded to nearest even
+            virtual void Conv_f_to_f16( uint16_t* dst, const float* src, const size_t n ) const;
+            virtual void Conv_f16_to_f( float* dst, const uint16_t* src, const size_t n ) const;
             virtual void Conv_u16_to_u8( uint8_t* dst, const uint16_t* src, const size_t n ) const;
             virtual void Conv_u16_to_XXXAu8( uint8_t* dst, const uint16_t* src, const size_t n ) const;
             virtual void Conv_GRAYf_to_GRAYu8( uint8_t* _dst, const float* src, const size_t n ) const;
@@ -315,6 +336,16 @@ namespace cvt {
             virtual void warpBilinear1u8( uint8_t* dst, const float* coords, const uint8_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, uint8_t fill, size_t n ) const;
             virtual void warpBilinear4u8( uint8_t* dst, const float* coords, const uint8_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, uint32_t fill, size_t n ) const;
 
+			/*
+			   remap using precomputed fixed-point coordinates:
+				xy   - pairs of int16 integer source coordinates ( top-left pixel of the bilinear footprint )
+				frac - bits 0-5 x fraction, bits 8-13 y fraction in 1/32 units ( 0 ... 32 ), bit 15 set marks an invalid pixel set to fill
+			 */
+			virtual void remapBilinear1u8( uint8_t* dst, const int16_t* xy, const uint16_t* frac, const uint8_t* src, size_t srcStride, uint8_t fill, size_t n ) const;
+			virtual void remapBilinear4u8( uint8_t* dst, const int16_t* xy, const uint16_t* frac, const uint8_t* src, size_t srcStride, uint32_t fill, size_t n ) const;
+			virtual void remapBilinear1f( float* dst, const int16_t* xy, const uint16_t* frac, const float* src, size_t srcStride, float fill, size_t n ) const;
+			virtual void remapBilinear4f( float* dst, const int16_t* xy, const uint16_t* frac, const float* src, size_t srcStride, const float* fill, size_t n ) const;
+
 			virtual void harrisScore1f( float* dst, const float* boxdx2, const float* boxdy2, const float* boxdxdy, float kappa, size_t width ) const;
 
             virtual float harrisResponse1u8( const uint8_t* _src, size_t srcStride, size_t w, size_t h, const float k ) const;
@@ -337,6 +368,20 @@ namespace cvt {
 
             virtual size_t hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const;
 
+            /* dst[ i ] += src[ i ] */
+            virtual void AddU8_to_u16( uint16_t* dst, const uint8_t* src, size_t n ) const;
+
+            /**
+             * @brief fernIndices_u8 - evaluate binary pixel tests of a fern bank
+             * @param dst       leaf index per fern
+             * @param a         first pixel values of the tests in test major order ( a[ t * nferns + f ] )
+             * @param b         second pixel values of the tests, same layout as a
+             * @param nferns    number of ferns
+             * @param ntests    number of tests per fern ( at most 16 )
+             * The first test of a fern defines the most significant bit of the leaf index, a bit is set if a < b.
+             */
+            virtual void fernIndices_u8( uint16_t* dst, const uint8_t* a, const uint8_t* b, size_t nferns, size_t ntests ) const;
+
 			// prefix sum for 1 channel images
 			virtual void prefixSum1_u8_to_f( float * dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const;
 			virtual void prefixSum1_f_to_f( float * dst, size_t dstStride, const float* src, size_t srcStride, size_t width, size_t height ) const;
@@ -219,6 +219,48 @@ namespace cvt
 	}
 
 
+	float SIMDSSE2::dot( float const* src1, float const* src2, const size_t n ) const
+	{
+		size_t i = n >> 3;
+
+		__m128 a0, a1, sum0, sum1;
+
+		sum0 = _mm_setzero_ps( );
+		sum1 = _mm_setzero_ps( );
+
+		if( ( ( size_t ) src1 | ( size_t ) src2 ) & 0xf ) {
+			while( i-- ) {
+				a0 = _mm_mul_ps( _mm_loadu_ps( src1 ), _mm_loadu_ps( src2 ) );
+				a1 = _mm_mul_ps( _mm_loadu_ps( src1 + 4 ), _mm_loadu_ps( src2 + 4 ) );
+				sum0 = _mm_add_ps( sum0, a0 );
+				sum1 = _mm_add_ps( sum1, a1 );
+				src1 += 8; src2 += 8;
+			}
+		} else {
+			while( i-- ) {
+				a0 = _mm_mul_ps( _mm_load_ps( src1 ), _mm_load_ps( src2 ) );
+				a1 = _mm_mul_ps( _mm_load_ps( src1 + 4 ), _mm_load_ps( src2 + 4 ) );
+				sum0 = _mm_add_ps( sum0, a0 );
+				sum1 = _mm_add_ps( sum1, a1 );
+				src1 += 8; src2 += 8;
+			}
+		}
+
+		float sum = 0.0f;
+
+		sum0 = _mm_add_ps( sum0, sum1 );
+		sum0 = _mm_add_ps( sum0, _mm_movehl_ps( sum0, sum0 ) );
+		sum0 = _mm_add_ps( sum0, _mm_shuffle_ps( sum0, sum0, _MM_SHUFFLE( 0, 0, 0, 1 ) ) );
+		_mm_store_ss( &sum, sum0 );
+
+		i = n & 0x7;
+		while( i-- ) {
+			sum += *src1++ * *src2++;
+		}
+
+		return sum;
+	}
+
 	size_t SIMDSSE2::SAD( uint8_t const* src1, uint8_t const* src2, const size_t n ) const
 	{
 		size_t i = n >> 4;
@@ -337,6 +379,90 @@ namespace cvt
 		return Math::invSqrt( var1var2 ) * cov;
 	}
 
+	void SIMDSSE2::IIR4Lanes_f( float* dst, const float** x, const float** y, const float* c, size_t n ) const
+	{
+		const float* x0 = x[ 0 ];
+		const float* x1 = x[ 1 ];
+		const float* x2 = x[ 2 ];
+		const float* x3 = x[ 3 ];
+		const float* y0 = y[ 0 ];
+		const float* y1 = y[ 1 ];
+		const float* y2 = y[ 2 ];
+		const float* y3 = y[ 3 ];
+
+		const __m128 n0 = _mm_set1_ps( c[ 0 ] );
+		const __m128 n1 = _mm_set1_ps( c[ 1 ] );
+		const __m128 n2 = _mm_set1_ps( c[ 2 ] );
+		const __m128 n3 = _mm_set1_ps( c[ 3 ] );
+		const __m128 d0 = _mm_set1_ps( c[ 4 ] );
+		const __m128 d1 = _mm_set1_ps( c[ 5 ] );
+		const __m128 d2 = _mm_set1_ps( c[ 6 ] );
+		const __m128 d3 = _mm_set1_ps( c[ 7 ] );
+		__m128 a, b;
+		size_t i = 0;
+
+		for( ; i + 4 <= n; i += 4 ) {
+			a = _mm_add_ps( _mm_mul_ps( n0, _mm_loadu_ps( x0 + i ) ), _mm_mul_ps( n1, _mm_loadu_ps( x1 + i ) ) );
+			b = _mm_add_ps( _mm_mul_ps( n2, _mm_loadu_ps( x2 + i ) ), _mm_mul_ps( n3, _mm_loadu_ps( x3 + i ) ) );
+			a = _mm_add_ps( a, b );
+			b = _mm_add_ps( _mm_mul_ps( d0, _mm_loadu_ps( y0 + i ) ), _mm_mul_ps( d1, _mm_loadu_ps( y1 + i ) ) );
+			a = _mm_sub_ps( a, b );
+			b = _mm_add_ps( _mm_mul_ps( d2, _mm_loadu_ps( y2 + i ) ), _mm_mul_ps( d3, _mm_loadu_ps( y3 + i ) ) );
+			_mm_storeu_ps( dst + i, _mm_sub_ps( a, b ) );
+		}
+
+		for( ; i < n; i++ ) {
+			dst[ i ] = c[ 0 ] * x0[ i ] + c[ 1 ] * x1[ i ] + c[ 2 ] * x2[ i ] + c[ 3 ] * x3[ i ]
+					 - c[ 4 ] * y0[ i ] - c[ 5 ] * y1[ i ] - c[ 6 ] * y2[ i ] - c[ 7 ] * y3[ i ];
+		}
+	}
+
+	void SIMDSSE2::BSplineWeights_f( float* weights, int32_t* index, const float* src, float scale, float offset, float lo, float hi, size_t n ) const
+	{
+		const __m128 vscale = _mm_set1_ps( scale );
+		const __m128 voffset = _mm_set1_ps( offset );
+		const __m128 vlo = _mm_set1_ps( lo );
+		const __m128 vhi = _mm_set1_ps( hi );
+		const __m128 one = _mm_set1_ps( 1.0f );
+		const __m128 three = _mm_set1_ps( 3.0f );
+		const __m128 four = _mm_set1_ps( 4.0f );
+		const __m128 six = _mm_set1_ps( 6.0f );
+		const __m128 s6 = _mm_set1_ps( 1.0f / 6.0f );
+		__m128 x, t, t2, t3, u, w0, w1, w2, w3;
+		__m128i idx;
+
+		size_t n4 = n >> 2;
+		while( n4-- ) {
+			x = _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( src ), vscale ), voffset );
+			x = _mm_min_ps( _mm_max_ps( x, vlo ), vhi );
+			/* truncation is floor for x >= 0 */
+			idx = _mm_cvttps_epi32( x );
+			t = _mm_sub_ps( x, _mm_cvtepi32_ps( idx ) );
+			t2 = _mm_mul_ps( t, t );
+			t3 = _mm_mul_ps( t2, t );
+			u = _mm_sub_ps( one, t );
+
+			w0 = _mm_mul_ps( _mm_mul_ps( _mm_mul_ps( u, u ), u ), s6 );
+			w1 = _mm_mul_ps( _mm_add_ps( _mm_sub_ps( _mm_mul_ps( three, t3 ), _mm_mul_ps( six, t2 ) ), four ), s6 );
+			w2 = _mm_mul_ps( _mm_add_ps( _mm_mul_ps( three, _mm_add_ps( _mm_sub_ps( t2, t3 ), t ) ), one ), s6 );
+			w3 = _mm_mul_ps( t3, s6 );
+
+			/* one group of four weights per sample */
+			_MM_TRANSPOSE4_PS( w0, w1, w2, w3 );
+			_mm_storeu_ps( weights, w0 );
+			_mm_storeu_ps( weights + 4, w1 );
+			_mm_storeu_ps( weights + 8, w2 );
+			_mm_storeu_ps( weights + 12, w3 );
+			_mm_storeu_si128( ( __m128i* ) index, idx );
+
+			src += 4;
+			index += 4;
+			weights += 16;
+		}
+
+		SIMD::BSplineWeights_f( weights, index, src, scale, offset, lo, hi, n & 3 );
+	}
+
 	void SIMDSSE2::AddVert_f( float* dst, const float**bufs, size_t numbufs, size_t width ) const
 	{
 		size_t x;
@@ -6381,4 +6507,194 @@ void SIMDSSE2::projectPoints( Vector2f* dst, const Matrix4f& _mat, const Vector3
         }
 }
 
+
+	void SIMDSSE2::AddU8_to_u16( uint16_t* dst, const uint8_t* src, size_t n ) const
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128i in, lo, hi;
+		size_t i = n >> 4;
+
+		while( i-- ) {
+			in = _mm_loadu_si128( ( __m128i* ) src );
+			lo = _mm_loadu_si128( ( __m128i* ) dst );
+			hi = _mm_loadu_si128( ( __m128i* ) ( dst + 8 ) );
+			lo = _mm_add_epi16( lo, _mm_unpacklo_epi8( in, zero ) );
+			hi = _mm_add_epi16( hi, _mm_unpackhi_epi8( in, zero ) );
+			_mm_storeu_si128( ( __m128i* ) dst, lo );
+			_mm_storeu_si128( ( __m128i* ) ( dst + 8 ), hi );
+			src += 16;
+			dst += 16;
+		}
+
+		i = n & 0xf;
+		while( i-- )
+			*dst++ += *src++;
+	}
+
+	void SIMDSSE2::fernIndices_u8( uint16_t* dst, const uint8_t* a, const uint8_t* b, size_t nferns, size_t ntests ) const
+	{
+		const __m128i bias = _mm_set1_epi8( ( char ) 0x80 );
+		const __m128i one  = _mm_set1_epi8( 1 );
+		const __m128i zero = _mm_setzero_si128();
+		__m128i va, vb, bit, idxlo, idxhi;
+		size_t f = 0;
+
+		/* 16 ferns at once, one byte lane per fern */
+		for( ; f + 16 <= nferns; f += 16 ) {
+			const uint8_t* pa = a + f;
+			const uint8_t* pb = b + f;
+			idxlo = zero;
+			idxhi = zero;
+			for( size_t t = 0; t < ntests; t++ ) {
+				/* unsigned compare via signed compare of biased values */
+				va  = _mm_xor_si128( _mm_loadu_si128( ( __m128i* ) pa ), bias );
+				vb  = _mm_xor_si128( _mm_loadu_si128( ( __m128i* ) pb ), bias );
+				bit = _mm_and_si128( _mm_cmplt_epi8( va, vb ), one );
+				idxlo = _mm_or_si128( _mm_slli_epi16( idxlo, 1 ), _mm_unpacklo_epi8( bit, zero ) );
+				idxhi = _mm_or_si128( _mm_slli_epi16( idxhi, 1 ), _mm_unpackhi_epi8( bit, zero ) );
+				pa += nferns;
+				pb += nferns;
+			}
+			_mm_storeu_si128( ( __m128i* ) ( dst + f ), idxlo );
+			_mm_storeu_si128( ( __m128i* ) ( dst + f + 8 ), idxhi );
+		}
+
+		for( ; f < nferns; f++ ) {
+			uint16_t idx = 0;
+			for( size_t t = 0; t < ntests; t++ ) {
+				size_t off = t * nferns + f;
+				idx = ( idx << 1 ) | ( a[ off ] < b[ off ] ? 1 : 0 );
+			}
+			dst[ f ] = idx;
+		}
+	}
+
+	void SIMDSSE2::remapBilinear1u8( uint8_t* dst, const int16_t* xy, const uint16_t* frac, const uint8_t* src, size_t srcStride, uint8_t fill, size_t n ) const
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i c32 = _mm_set1_epi16( 32 );
+		const __m128i fmask = _mm_set1_epi16( 0x3f );
+		const __m128i round = _mm_set1_epi32( 512 );
+		const __m128i vfill = _mm_set1_epi32( fill );
+		__m128i f, ax, ay, wx, wy, top, bottom, h0, h1, v, invalid;
+		const uint8_t* p[ 4 ];
+
+		while( n >= 4 ) {
+			/* invalid pixels point to ( 0, 0 ), so all loads are inside the image */
+			for( size_t i = 0; i < 4; i++ )
+				p[ i ] = src + srcStride * xy[ 2 * i + 1 ] + xy[ 2 * i ];
+
+			top = _mm_setr_epi16( p[ 0 ][ 0 ], p[ 0 ][ 1 ], p[ 1 ][ 0 ], p[ 1 ][ 1 ],
+								  p[ 2 ][ 0 ], p[ 2 ][ 1 ], p[ 3 ][ 0 ], p[ 3 ][ 1 ] );
+			bottom = _mm_setr_epi16( p[ 0 ][ srcStride ], p[ 0 ][ srcStride + 1 ], p[ 1 ][ srcStride ], p[ 1 ][ srcStride + 1 ],
+									 p[ 2 ][ srcStride ], p[ 2 ][ srcStride + 1 ], p[ 3 ][ srcStride ], p[ 3 ][ srcStride + 1 ] );
+
+			f  = _mm_loadl_epi64( ( const __m128i* ) frac );
+			ax = _mm_and_si128( f, fmask );
+			ay = _mm_and_si128( _mm_srli_epi16( f, 8 ), fmask );
+			wx = _mm_unpacklo_epi16( _mm_sub_epi16( c32, ax ), ax );
+			wy = _mm_unpacklo_epi16( _mm_sub_epi16( c32, ay ), ay );
+			invalid = _mm_srai_epi16( f, 15 );
+			invalid = _mm_unpacklo_epi16( invalid, invalid );
+
+			/* horizontal pass, results are at most 255 * 32 and fit into int16 */
+			h0 = _mm_madd_epi16( top, wx );
+			h1 = _mm_madd_epi16( bottom, wx );
+			v  = _mm_unpacklo_epi16( _mm_packs_epi32( h0, h0 ), _mm_packs_epi32( h1, h1 ) );
+			v  = _mm_srli_epi32( _mm_add_epi32( _mm_madd_epi16( v, wy ), round ), 10 );
+			v  = _mm_or_si128( _mm_andnot_si128( invalid, v ), _mm_and_si128( invalid, vfill ) );
+
+			v = _mm_packs_epi32( v, zero );
+			v = _mm_packus_epi16( v, zero );
+			*( ( uint32_t* ) dst ) = _mm_cvtsi128_si32( v );
+
+			dst += 4;
+			xy += 8;
+			frac += 4;
+			n -= 4;
+		}
+
+		if( n )
+			SIMD::remapBilinear1u8( dst, xy, frac, src, srcStride, fill, n );
+	}
+
+	void SIMDSSE2::remapBilinear4u8( uint8_t* dst, const int16_t* xy, const uint16_t* frac, const uint8_t* src, size_t srcStride, uint32_t fill, size_t n ) const
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i round = _mm_set1_epi32( 512 );
+		__m128i a, top, bottom, h0, h1, v;
+
+		while( n-- ) {
+			uint16_t f = *frac++;
+			if( f & 0x8000 ) {
+				*( ( uint32_t* ) dst ) = fill;
+				dst += 4;
+				xy += 2;
+				continue;
+			}
+			int ax = f & 0x3f;
+			int ay = ( f >> 8 ) & 0x3f;
+			const uint8_t* p = src + srcStride * xy[ 1 ] + sizeof( uint32_t ) * xy[ 0 ];
+			xy += 2;
+
+			/* reorder to ( c0, c1 ) pairs per channel for the multiply-add */
+			a = _mm_unpacklo_epi8( _mm_loadl_epi64( ( const __m128i* ) p ), zero );
+			top = _mm_unpacklo_epi16( a, _mm_srli_si128( a, 8 ) );
+			a = _mm_unpacklo_epi8( _mm_loadl_epi64( ( const __m128i* ) ( p + srcStride ) ), zero );
+			bottom = _mm_unpacklo_epi16( a, _mm_srli_si128( a, 8 ) );
+
+			h0 = _mm_madd_epi16( top, _mm_set1_epi32( ( ax << 16 ) | ( 32 - ax ) ) );
+			h1 = _mm_madd_epi16( bottom, _mm_set1_epi32( ( ax << 16 ) | ( 32 - ax ) ) );
+			v  = _mm_unpacklo_epi16( _mm_packs_epi32( h0, h0 ), _mm_packs_epi32( h1, h1 ) );
+			v  = _mm_madd_epi16( v, _mm_set1_epi32( ( ay << 16 ) | ( 32 - ay ) ) );
+			v  = _mm_srli_epi32( _mm_add_epi32( v, round ), 10 );
+
+			v = _mm_packs_epi32( v, zero );
+			v = _mm_packus_epi16( v, zero );
+			*( ( uint32_t* ) dst ) = _mm_cvtsi128_si32( v );
+			dst += 4;
+		}
+	}
+
+	void SIMDSSE2::remapBilinear1f( float* dst, const int16_t* xy, const uint16_t* frac, const float* src, size_t srcStride, float fill, size_t n ) const
+	{
+		const __m128i fmask = _mm_set1_epi32( 0x3f );
+		const __m128 scale = _mm_set1_ps( 1.0f / 32.0f );
+		const __m128 vfill = _mm_set1_ps( fill );
+		__m128i f, invalid;
+		__m128 ax, ay, v00, v01, v10, v11, v0, v1;
+		const float* p[ 4 ];
+
+		while( n >= 4 ) {
+			for( size_t i = 0; i < 4; i++ )
+				p[ i ] = ( const float* ) ( ( const uint8_t* ) src + srcStride * xy[ 2 * i + 1 ] ) + xy[ 2 * i ];
+
+			v00 = _mm_setr_ps( p[ 0 ][ 0 ], p[ 1 ][ 0 ], p[ 2 ][ 0 ], p[ 3 ][ 0 ] );
+			v01 = _mm_setr_ps( p[ 0 ][ 1 ], p[ 1 ][ 1 ], p[ 2 ][ 1 ], p[ 3 ][ 1 ] );
+			for( size_t i = 0; i < 4; i++ )
+				p[ i ] = ( const float* ) ( ( const uint8_t* ) p[ i ] + srcStride );
+			v10 = _mm_setr_ps( p[ 0 ][ 0 ], p[ 1 ][ 0 ], p[ 2 ][ 0 ], p[ 3 ][ 0 ] );
+			v11 = _mm_setr_ps( p[ 0 ][ 1 ], p[ 1 ][ 1 ], p[ 2 ][ 1 ], p[ 3 ][ 1 ] );
+
+			f = _mm_unpacklo_epi16( _mm_loadl_epi64( ( const __m128i* ) frac ), _mm_setzero_si128() );
+			ax = _mm_mul_ps( _mm_cvtepi32_ps( _mm_and_si128( f, fmask ) ), scale );
+			ay = _mm_mul_ps( _mm_cvtepi32_ps( _mm_and_si128( _mm_srli_epi32( f, 8 ), fmask ) ), scale );
+			invalid = _mm_srai_epi32( _mm_slli_epi32( f, 16 ), 31 );
+
+			v0 = _mm_add_ps( v00, _mm_mul_ps( _mm_sub_ps( v01, v00 ), ax ) );
+			v1 = _mm_add_ps( v10, _mm_mul_ps( _mm_sub_ps( v11, v10 ), ax ) );
+			v0 = _mm_add_ps( v0, _mm_mul_ps( _mm_sub_ps( v1, v0 ), ay ) );
+			v0 = _mm_or_ps( _mm_andnot_ps( _mm_castsi128_ps( invalid ), v0 ), _mm_and_ps( _mm_castsi128_ps( invalid ), vfill ) );
+			_mm_storeu_ps( dst, v0 );
+
+			dst += 4;
+			xy += 8;
+			frac += 4;
+			n -= 4;
+		}
+
+		if( n )
+			SIMD::remapBilinear1f( dst, xy, frac, src, srcStride, fill, n );
+	}
+
 }
@@ -46,9 +46,15 @@ namespace cvt {
 
 			using SIMDSSE::SSD;
             virtual float SSD( const float* src1, const float* src2, const size_t n ) const;
+            virtual float dot( const float* src1, const float* src2, const size_t n ) const;
 
             virtual float NCC( float const* src1, float const* src2, const size_t n ) const;
 
+			/* Infinite Impulse Response */
+			virtual void IIR4Lanes_f( float* dst, const float** x, const float** y, const float* coeffs, size_t n ) const;
+
+			virtual void BSplineWeights_f( float* weights, int32_t* index, const float* src, float scale, float offset, float lo, float hi, size_t n ) const;
+
 			/* Add vertical */
 			virtual void AddVert_f( float* dst, const float**bufs, size_t numbufs, size_t width ) const;
 			virtual void AddVert_f_to_u8( uint8_t* dst, const float**bufs, size_t numbufs, size_t width ) const;
@@ -131,6 +137,13 @@ namespace cvt {
 			virtual void adaptiveThreshold1_f_to_u8( uint8_t* dst, const float* src, const float* srcmean, size_t n, float t ) const;
 			virtual void adaptiveThreshold1_f_to_f( float* dst, const float* src, const float* srcmean, size_t n, float t ) const;
 
+			virtual void AddU8_to_u16( uint16_t* dst, const uint8_t* src, size_t n ) const;
+			virtual void fernIndices_u8( uint16_t* dst, const uint8_t* a, const uint8_t* b, size_t nferns, size_t ntests ) const;
+
+			virtual void remapBilinear1u8( uint8_t* dst, const int16_t* xy, const uint16_t* frac, const uint8_t* src, size_t srcStride, uint8_t fill, size_t n ) const;
+			virtual void remapBilinear4u8( uint8_t* dst, const int16_t* xy, const uint16_t* frac, const uint8_t* src, size_t srcStride, uint32_t fill, size_t n ) const;
+			virtual void remapBilinear1f( float* dst, const int16_t* xy, const uint16_t* frac, const float* src, size_t srcStride, float fill, size_t n ) const;
+
 			virtual void sumPoints( Vector2f& dst, const Vector2f* src, size_t n ) const;
 			virtual void sumPoints( Vector3f& dst, const Vector3f* src, size_t n ) const;
 
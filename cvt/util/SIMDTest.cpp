@@ -141,6 +141,249 @@ static bool _hammingTest()
     return result;
 }
 
+static bool _fernTest()
+{
+    bool result = true;
+
+    const size_t nferns = 37;
+    const size_t ntests = 11;
+    const size_t nclasses = 61;
+    uint8_t a[ nferns * ntests ], b[ nferns * ntests ];
+    uint8_t table[ nclasses ];
+    uint16_t expected[ nferns ], leaves[ nferns ];
+    uint16_t accumExpected[ nclasses ], accum[ nclasses ];
+
+    for( size_t i = 0; i < nferns * ntests; i++ ){
+        a[ i ] = ( uint8_t )rand();
+        b[ i ] = ( uint8_t )rand();
+    }
+    for( size_t i = 0; i < nclasses; i++ ){
+        table[ i ] = ( uint8_t )rand();
+        accumExpected[ i ] = 1000 + i + table[ i ];
+    }
+
+    for( size_t f = 0; f < nferns; f++ ){
+        uint16_t idx = 0;
+        for( size_t t = 0; t < ntests; t++ ){
+            idx <<= 1;
+            if( a[ t * nferns + f ] < b[ t * nferns + f ] )
+                idx |= 1;
+        }
+        expected[ f ] = idx;
+    }
+
+    SIMDType bestType = SIMD::bestSupportedType();
+    for( int st = SIMD_BASE; st <= bestType; st++ ) {
+        SIMD* simd = SIMD::get( ( SIMDType ) st );
+
+        bool tRes = true;
+        simd->fernIndices_u8( leaves, a, b, nferns, ntests );
+        for( size_t f = 0; f < nferns; f++ )
+            tRes &= ( leaves[ f ] == expected[ f ] );
+
+        for( size_t i = 0; i < nclasses; i++ )
+            accum[ i ] = 1000 + i;
+        simd->AddU8_to_u16( accum, table, nclasses );
+        for( size_t i = 0; i < nclasses; i++ )
+            tRes &= ( accum[ i ] == accumExpected[ i ] );
+
+        result &= tRes;
+        CVTTEST_PRINT( "Fern indices / AddU8_to_u16 " + simd->name() + ": ", tRes );
+
+        delete simd;
+    }
+
+    return result;
+}
+
+static bool _remapTest()
+{
+    bool result = true;
+
+    const size_t sw = 16;
+    const size_t sh = 16;
+    const size_t n = 39;
+    uint8_t src1u8[ sw * sh ], src4u8[ sw * sh * 4 ];
+    float src1f[ sw * sh ];
+    int16_t xy[ 2 * n ];
+    uint16_t frac[ n ];
+    uint8_t exp1u8[ n ], dst1u8[ n ], exp4u8[ 4 * n ], dst4u8[ 4 * n ];
+    float exp1f[ n ], dst1f[ n ];
+
+    for( size_t i = 0; i < sw * sh; i++ ){
+        src1u8[ i ] = ( uint8_t )rand();
+        src1f[ i ] = Math::rand( 0.0f, 1.0f );
+    }
+    for( size_t i = 0; i < sw * sh * 4; i++ )
+        src4u8[ i ] = ( uint8_t )rand();
+
+    for( size_t i = 0; i < n; i++ ){
+        if( rand() % 7 == 0 ){
+            xy[ 2 * i ] = xy[ 2 * i + 1 ] = 0;
+            frac[ i ] = 0x8000;
+            continue;
+        }
+        xy[ 2 * i ] = rand() % ( sw - 1 );
+        xy[ 2 * i + 1 ] = rand() % ( sh - 1 );
+        frac[ i ] = ( rand() % 33 ) | ( ( rand() % 33 ) << 8 );
+    }
+
+    SIMD* base = SIMD::get( SIMD_BASE );
+    base->remapBilinear1u8( exp1u8, xy, frac, src1u8, sw, 7, n );
+    base->remapBilinear4u8( exp4u8, xy, frac, src4u8, sw * 4, 0xff000000, n );
+    base->remapBilinear1f( exp1f, xy, frac, src1f, sw * sizeof( float ), -1.0f, n );
+    delete base;
+
+    SIMDType bestType = SIMD::bestSupportedType();
+    for( int st = SIMD_BASE; st <= bestType; st++ ) {
+        SIMD* simd = SIMD::get( ( SIMDType ) st );
+
+        bool tRes = true;
+        simd->remapBilinear1u8( dst1u8, xy, frac, src1u8, sw, 7, n );
+        simd->remapBilinear4u8( dst4u8, xy, frac, src4u8, sw * 4, 0xff000000, n );
+        simd->remapBilinear1f( dst1f, xy, frac, src1f, sw * sizeof( float ), -1.0f, n );
+        for( size_t i = 0; i < n; i++ ){
+            tRes &= ( dst1u8[ i ] == exp1u8[ i ] );
+            tRes &= ( Math::abs( dst1f[ i ] - exp1f[ i ] ) < 1e-5f );
+        }
+        for( size_t i = 0; i < 4 * n; i++ )
+            tRes &= ( dst4u8[ i ] == exp4u8[ i ] );
+
+        result &= tRes;
+        CVTTEST_PRINT( "remapBilinear " + simd->name() + ": ", tRes );
+
+        delete simd;
+    }
+
+    return result;
+}
+
+static bool _bsplineWeightsTest()
+{
+    bool result = true;
+
+    const size_t n = 37;
+    float src[ n ], expw[ 4 * n ], dstw[ 4 * n ];
+    int32_t expi[ n ], dsti[ n ];
+
+    for( size_t i = 0; i < n; i++ )
+        src[ i ] = Math::rand( -0.1f, 1.1f );
+
+    SIMD* base = SIMD::get( SIMD_BASE );
+    base->BSplineWeights_f( expw, expi, src, 29.0f, 1.0f, 1.0f, 30.0f, n );
+    delete base;
+
+    SIMDType bestType = SIMD::bestSupportedType();
+    for( int st = SIMD_BASE; st <= bestType; st++ ) {
+        SIMD* simd = SIMD::get( ( SIMDType ) st );
+
+        bool tRes = true;
+        simd->BSplineWeights_f( dstw, dsti, src, 29.0f, 1.0f, 1.0f, 30.0f, n );
+        for( size_t i = 0; i < n; i++ ) {
+            float sum = 0.0f;
+            tRes &= ( dsti[ i ] == expi[ i ] );
+            for( size_t k = 0; k < 4; k++ ) {
+                tRes &= ( Math::abs( dstw[ 4 * i + k ] - expw[ 4 * i + k ] ) < 1e-5f );
+                sum += dstw[ 4 * i + k ];
+            }
+            tRes &= ( Math::abs( sum - 1.0f ) < 1e-5f );
+        }
+
+        result &= tRes;
+        CVTTEST_PRINT( "BSplineWeights_f " + simd->name() + ": ", tRes );
+
+        delete simd;
+    }
+
+    return result;
+}
+
+static bool _halfTest()
+{
+    bool result = true;
+
+    const size_t n = 43;
+    float src[ n ], back[ n ];
+    uint16_t exph[ n ], dsth[ n ];
+
+    /* exactly representable values, overflow, subnormals and specials first */
+    const float fixed[ 8 ] = { 1.0f, -0.0f, 65504.0f, 65520.0f, 5.9604644775390625e-8f, 1.0f + 1.0f / 2048.0f, std::numeric_limits<float>::infinity(), -2.5f };
+    const uint16_t fixedh[ 8 ] = { 0x3c00, 0x8000, 0x7bff, 0x7c00, 0x0001, 0x3c00, 0x7c00, 0xc100 };
+    for( size_t i = 0; i < 8; i++ )
+        src[ i ] = fixed[ i ];
+    for( size_t i = 8; i < n; i++ )
+        src[ i ] = Math::rand( -1000.0f, 1000.0f ) * Math::rand( 0.0f, 1.0f ) * Math::rand( 0.0f, 1.0f );
+
+    SIMD* base = SIMD::get( SIMD_BASE );
+    base->Conv_f_to_f16( exph, src, n );
+    delete base;
+
+    for( size_t i = 0; i < 8; i++ )
+        result &= ( exph[ i ] == fixedh[ i ] );
+    CVTTEST_PRINT( "Conv_f_to_f16 reference values", result );
+
+    SIMDType bestType = SIMD::bestSupportedType();
+    for( int st = SIMD_BASE; st <= bestType; st++ ) {
+        SIMD* simd = SIMD::get( ( SIMDType ) st );
+
+        bool tRes = true;
+        simd->Conv_f_to_f16( dsth, src, n );
+        simd->Conv_f16_to_f( back, dsth, n );
+        for( size_t i = 0; i < n; i++ ) {
+            tRes &= ( dsth[ i ] == exph[ i ] );
+            if( i >= 8 || i == 0 || i == 2 || i == 7 )
+                tRes &= ( Math::abs( back[ i ] - src[ i ] ) <= Math::abs( src[ i ] ) / 2048.0f + 3e-8f );
+        }
+
+        result &= tRes;
+        CVTTEST_PRINT( "Conv_f_to_f16/Conv_f16_to_f " + simd->name() + ": ", tRes );
+
+        delete simd;
+    }
+
+    return result;
+}
+
+static bool _iir4LanesTest()
+{
+    bool result = true;
+
+    const size_t n = 37;
+    float xs[ 4 ][ n ], ys[ 4 ][ n ], exp[ n ], dst[ n ];
+    const float* x[ 4 ] = { xs[ 0 ], xs[ 1 ], xs[ 2 ], xs[ 3 ] };
+    const float* y[ 4 ] = { ys[ 0 ], ys[ 1 ], ys[ 2 ], ys[ 3 ] };
+    const float c[ 8 ] = { 0.25f, -0.125f, 0.0625f, 0.5f, -1.5f, 0.75f, -0.25f, 0.03125f };
+
+    for( size_t k = 0; k < 4; k++ ) {
+        for( size_t i = 0; i < n; i++ ) {
+            xs[ k ][ i ] = Math::rand( -1.0f, 1.0f );
+            ys[ k ][ i ] = Math::rand( -1.0f, 1.0f );
+        }
+    }
+
+    for( size_t i = 0; i < n; i++ ) {
+        exp[ i ] = c[ 0 ] * x[ 0 ][ i ] + c[ 1 ] * x[ 1 ][ i ] + c[ 2 ] * x[ 2 ][ i ] + c[ 3 ] * x[ 3 ][ i ]
+                 - c[ 4 ] * y[ 0 ][ i ] - c[ 5 ] * y[ 1 ][ i ] - c[ 6 ] * y[ 2 ][ i ] - c[ 7 ] * y[ 3 ][ i ];
+    }
+
+    SIMDType bestType = SIMD::bestSupportedType();
+    for( int st = SIMD_BASE; st <= bestType; st++ ) {
+        SIMD* simd = SIMD::get( ( SIMDType ) st );
+
+        bool tRes = true;
+        simd->IIR4Lanes_f( dst, x, y, c, n );
+        for( size_t i = 0; i < n; i++ )
+            tRes &= ( Math::abs( dst[ i ] - exp[ i ] ) < 1e-5f );
+
+        result &= tRes;
+        CVTTEST_PRINT( "IIR4Lanes_f " + simd->name() + ": ", tRes );
+
+        delete simd;
+    }
+
+    return result;
+}
+
 static bool _projectTest()
 {
 	std::vector<Vector2f> gtProjected;
@@ -248,6 +491,32 @@ static void _SSDTest( float* src1, float* src2, size_t n )
 	}
 }
 
+static void _dotTest( float* src1, float* src2, size_t n )
+{
+	float reference = 0.0f;
+	for( size_t i = 0; i < n; i++ ) {
+		src1[ i ] = Math::rand( -10.0f, 10.0f );
+		src2[ i ] = Math::rand( 0.0f, 10.0f );
+		reference += src1[ i ] * src2[ i ];
+	}
+
+	SIMDType bestType = SIMD::bestSupportedType( );
+	for( int st = SIMD_BASE; st <= bestType; st++ ) {
+		SIMD* simd = SIMD::get( ( SIMDType ) st );
+		float result = simd->dot( &src1[ 0 ], &src2[ 0 ], n );
+		bool fail = false;
+		if( Math::abs( reference - result ) > 0.0001f * Math::abs( reference ) + 0.001f ) {
+			fail = true;
+			std::cout << "Error: dot: Reference: " << reference << ", " << simd->name( ) << ": " << result << std::endl;
+		}
+		std::stringstream ss;
+		ss << simd->name( );
+		ss << " dot (float)";
+		CVTTEST_PRINT( ss.str( ), !fail );
+		delete simd;
+	}
+}
+
 static void _NCCTest( float* src1, float* src2, size_t n )
 {
 	float *constval = new float[ n ];
@@ -326,6 +595,7 @@ BEGIN_CVTTEST( simd )
 
 		_SADTest( fsrc1, fsrc2, TESTSIZE );
 		_SSDTest( fsrc1, fsrc2, TESTSIZE );
+		_dotTest( fsrc1, fsrc2, TESTSIZE );
 		_NCCTest( fsrc1, fsrc2, TESTSIZE );
 
 		delete[] fdst;
@@ -339,6 +609,21 @@ BEGIN_CVTTEST( simd )
 		testResult = _projectTest();
         CVTTEST_PRINT( "Project Points 3d->2d", testResult );
 
+		testResult = _fernTest();
+        CVTTEST_PRINT( "Fern evaluation", testResult );
+
+		testResult = _remapTest();
+        CVTTEST_PRINT( "Fixed-point remap", testResult );
+
+		testResult = _bsplineWeightsTest();
+        CVTTEST_PRINT( "B-spline histogram weights", testResult );
+
+		testResult = _halfTest();
+        CVTTEST_PRINT( "Half float conversion", testResult );
+
+		testResult = _iir4LanesTest();
+        CVTTEST_PRINT( "IIR4Lanes_f recursion step", testResult );
+
 #define TESTSIZE ( 2048 * 2048 )
 		fdst = new float[ TESTSIZE ];
 		fsrc1 = new float[ TESTSIZE ];
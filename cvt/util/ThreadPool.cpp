@@ -0,0 +1,151 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/ThreadPool.h>
+
+#include <unistd.h>
+#include <stdlib.h>
+
+namespace cvt {
+
+	static __thread bool _inPoolWorker = false;
+
+	static size_t _defaultNumThreads()
+	{
+		const char* env = getenv( "CVT_NUM_THREADS" );
+		if( env ) {
+			long n = strtol( env, NULL, 10 );
+			if( n > 0 )
+				return ( size_t ) n;
+		}
+		long n = sysconf( _SC_NPROCESSORS_ONLN );
+		return n > 0 ? ( size_t ) n : 1;
+	}
+
+	ThreadPool& ThreadPool::instance()
+	{
+		static ThreadPool pool( _defaultNumThreads() );
+		return pool;
+	}
+
+	ThreadPool::ThreadPool( size_t nthreads ) :
+		_task( NULL ),
+		_end( 0 ),
+		_grain( 1 ),
+		_next( 0 ),
+		_generation( 0 ),
+		_pending( 0 ),
+		_shutdown( false )
+	{
+		for( size_t i = 1; i < nthreads; i++ ) {
+			Worker* w = new Worker();
+			_workers.push_back( w );
+			w->run( this );
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		_mutex.lock();
+		_shutdown = true;
+		_wakeup.notifyAll();
+		_mutex.unlock();
+
+		for( size_t i = 0; i < _workers.size(); i++ ) {
+			_workers[ i ]->join();
+			delete _workers[ i ];
+		}
+	}
+
+	bool ThreadPool::run( ParallelTask& task, size_t begin, size_t end, size_t grain )
+	{
+		if( begin >= end )
+			return false;
+		if( !grain )
+			grain = 1;
+
+		/* Mutex::trylock returns true if the mutex is already locked */
+		if( end - begin <= grain || _workers.empty() || _inPoolWorker || _jobLock.trylock() ) {
+			task.execute( begin, end );
+			return false;
+		}
+
+		_mutex.lock();
+		_task	 = &task;
+		_end	 = end;
+		_grain	 = grain;
+		_next	 = begin;
+		_pending = _workers.size();
+		_generation++;
+		_wakeup.notifyAll();
+		_mutex.unlock();
+
+		_inPoolWorker = true;
+		processChunks();
+		_inPoolWorker = false;
+
+		_mutex.lock();
+		while( _pending )
+			_finished.wait( _mutex );
+		_task = NULL;
+		_mutex.unlock();
+
+		_jobLock.unlock();
+		return true;
+	}
+
+	void ThreadPool::processChunks()
+	{
+		for( ;; ) {
+			size_t start = __sync_fetch_and_add( &_next, _grain );
+			if( start >= _end )
+				break;
+			size_t stop = start + _grain;
+			_task->execute( start, stop < _end ? stop : _end );
+		}
+	}
+
+	void ThreadPool::workerLoop()
+	{
+		size_t generation = 0;
+
+		_inPoolWorker = true;
+		_mutex.lock();
+		for( ;; ) {
+			while( !_shutdown && _generation == generation )
+				_wakeup.wait( _mutex );
+			if( _shutdown )
+				break;
+			generation = _generation;
+			_mutex.unlock();
+
+			processChunks();
+
+			_mutex.lock();
+			if( --_pending == 0 )
+				_finished.notify();
+		}
+		_mutex.unlock();
+	}
+}
@@ -0,0 +1,124 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_THREADPOOL_H
+#define CVT_THREADPOOL_H
+
+#include <cvt/util/Thread.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Condition.h>
+
+#include <vector>
+#include <stdint.h>
+
+namespace cvt {
+
+	/**
+	  \brief Work item executed by the ThreadPool on sub-ranges [ begin, end )
+	 */
+	class ParallelTask {
+		public:
+			virtual ~ParallelTask() {}
+			virtual void execute( size_t begin, size_t end ) = 0;
+	};
+
+	/**
+	  \brief Process wide pool of worker threads for data-parallel loops
+
+	  The calling thread participates in the work. Nested calls or calls while
+	  another loop is in flight are executed serially by the caller, so tasks
+	  can safely use parallelFor themselves.
+	  The number of threads defaults to the number of online cores and can be
+	  overriden with the environment variable CVT_NUM_THREADS.
+	 */
+	class ThreadPool {
+		public:
+			static ThreadPool& instance();
+
+			size_t	numThreads() const { return _workers.size() + 1; }
+			bool	run( ParallelTask& task, size_t begin, size_t end, size_t grain = 1 );
+
+		private:
+			class Worker : public Thread<ThreadPool> {
+				public:
+					void execute( ThreadPool* pool ) { pool->workerLoop(); }
+			};
+
+			ThreadPool( size_t nthreads );
+			~ThreadPool();
+			ThreadPool( const ThreadPool& );
+			ThreadPool& operator=( const ThreadPool& );
+
+			void	workerLoop();
+			void	processChunks();
+
+			std::vector<Worker*>	_workers;
+			Mutex					_jobLock;
+			Mutex					_mutex;
+			Condition				_wakeup;
+			Condition				_finished;
+
+			ParallelTask*			_task;
+			size_t					_end;
+			size_t					_grain;
+			volatile size_t			_next;
+			size_t					_generation;
+			size_t					_pending;
+			bool					_shutdown;
+	};
+
+	template<typename Body>
+	class ParallelTaskBody : public ParallelTask {
+		public:
+			ParallelTaskBody( const Body& body ) : _body( body ) {}
+			void execute( size_t begin, size_t end ) { _body( begin, end ); }
+
+		private:
+			const Body& _body;
+	};
+
+	/**
+	  \brief Run body( begin, end ) on chunks of at most grain elements in parallel
+	  \param body	functor providing void operator()( size_t begin, size_t end ) const
+	  \return false if the whole range was executed serially by the caller
+	 */
+	template<typename Body>
+	inline bool parallelFor( size_t begin, size_t end, const Body& body, size_t grain = 1 )
+	{
+		ParallelTaskBody<Body> task( body );
+		return ThreadPool::instance().run( task, begin, end, grain );
+	}
+
+	/**
+	  \brief Grain size splitting n elements into roughly chunksPerThread chunks per thread
+	 */
+	inline size_t parallelGrain( size_t n, size_t chunksPerThread = 4 )
+	{
+		size_t chunks = ThreadPool::instance().numThreads() * chunksPerThread;
+		size_t grain = ( n + chunks - 1 ) / chunks;
+		return grain ? grain : 1;
+	}
+}
+
+#endif
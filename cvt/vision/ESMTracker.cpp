@@ -0,0 +1,321 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/ESMTracker.h>
+#include <cvt/util/EigenBridge.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/Profiler.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/ThreadPool.h>
+
+#include <Eigen/Cholesky>
+
+namespace cvt {
+
+	class ESMTrackerTask {
+		public:
+			ESMTrackerTask( const ESMTracker& tracker, const ImagePyramid& pyramid ) : _tracker( tracker ), _pyramid( pyramid )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				for( size_t i = begin; i < end; i++ )
+					_tracker.trackTarget( *_tracker._targets[ i ], _pyramid );
+			}
+
+		private:
+			const ESMTracker&	_tracker;
+			const ImagePyramid& _pyramid;
+	};
+
+	/* g^T * dW/dp at the identity for the SL3 generators */
+	static inline void _esmJacobian( float* j, float gx, float gy, float x, float y )
+	{
+		float gp = gx * x + gy * y;
+		j[ 0 ] = gx;
+		j[ 1 ] = gy;
+		j[ 2 ] = gx * y;
+		j[ 3 ] = gy * x;
+		j[ 4 ] = gx * x - gy * y;
+		j[ 5 ] = -gx * x - 2.0f * gy * y;
+		j[ 6 ] = -x * gp;
+		j[ 7 ] = -y * gp;
+	}
+
+	/* pose of octave 0 to the pose in an octave with the given scale and back */
+	static inline void _esmScalePose( Eigen::Matrix3f& H, float scale )
+	{
+		H( 0, 2 ) *= scale;
+		H( 1, 2 ) *= scale;
+		H( 2, 0 ) /= scale;
+		H( 2, 1 ) /= scale;
+	}
+
+	ESMTracker::ESMTracker() :
+		_octaves( 0 ),
+		_scaleFactor( 0.5f ),
+		_maxIter( 10 ),
+		_minStep( 1e-4f ),
+		_maxResidual( 0.2f )
+	{
+	}
+
+	ESMTracker::~ESMTracker()
+	{
+		clear();
+	}
+
+	void ESMTracker::clear()
+	{
+		for( size_t i = 0; i < _targets.size(); i++ )
+			delete _targets[ i ];
+		_targets.clear();
+	}
+
+	size_t ESMTracker::addTarget( const ImagePyramid& pyramid, const Recti& roi )
+	{
+		if( pyramid[ 0 ].format() != IFormat::GRAY_FLOAT )
+			throw CVTException( "ESMTracker: pyramid must be GRAY_FLOAT" );
+		if( roi.x < 1 || roi.y < 1 || roi.width < 4 || roi.height < 4 ||
+		    roi.x + roi.width + 1 > ( int ) pyramid[ 0 ].width() || roi.y + roi.height + 1 > ( int ) pyramid[ 0 ].height() )
+			throw CVTException( "ESMTracker: template region must lie inside the image" );
+		if( _targets.empty() ) {
+			_octaves = pyramid.octaves();
+			_scaleFactor = pyramid.scaleFactor();
+		} else if( _octaves != pyramid.octaves() || _scaleFactor != pyramid.scaleFactor() ) {
+			throw CVTException( "ESMTracker: all targets need the same pyramid layout" );
+		}
+
+		Target* target = new Target();
+		target->center.x = roi.x + 0.5f * ( roi.width - 1 );
+		target->center.y = roi.y + 0.5f * ( roi.height - 1 );
+		target->tracked = true;
+		target->residual = 0.0f;
+		target->octaves.resize( _octaves );
+
+		float scale = 1.0f;
+		for( size_t o = 0; o < _octaves; o++ ) {
+			const Image& img = pyramid[ o ];
+			Template& tmpl = target->octaves[ o ];
+
+			// template region in this octave, 1 pixel margin for the gradients
+			int x0 = Math::clamp<int>( Math::round( roi.x * scale ), 1, img.width() - 3 );
+			int y0 = Math::clamp<int>( Math::round( roi.y * scale ), 1, img.height() - 3 );
+			int x1 = Math::clamp<int>( Math::round( ( roi.x + roi.width - 1 ) * scale ), x0 + 1, img.width() - 2 );
+			int y1 = Math::clamp<int>( Math::round( ( roi.y + roi.height - 1 ) * scale ), y0 + 1, img.height() - 2 );
+			tmpl.cols = x1 - x0 + 1;
+			tmpl.rows = y1 - y0 + 1;
+
+			size_t n = tmpl.cols * tmpl.rows;
+			tmpl.pts.resize( n );
+			tmpl.intensity.resize( n );
+			tmpl.jac.resize( 8 * n );
+
+			Vector2f c = target->center * scale;
+			IMapScoped<const float> map( img );
+			size_t stride = map.stride() / sizeof( float );
+			size_t i = 0;
+			for( int y = y0; y <= y1; y++ ) {
+				const float* ptr = map.ptr() + y * stride;
+				for( int x = x0; x <= x1; x++, i++ ) {
+					float gx = 0.5f * ( ptr[ x + 1 ] - ptr[ x - 1 ] );
+					float gy = 0.5f * ( ptr[ x + stride ] - ptr[ x - stride ] );
+					tmpl.pts[ i ].set( x - c.x, y - c.y );
+					tmpl.intensity[ i ] = ptr[ x ];
+					_esmJacobian( &tmpl.jac[ 8 * i ], gx, gy, tmpl.pts[ i ].x, tmpl.pts[ i ].y );
+				}
+			}
+			scale *= _scaleFactor;
+		}
+
+		Eigen::Matrix3f H( Eigen::Matrix3f::Identity() );
+		H( 0, 2 ) = target->center.x;
+		H( 1, 2 ) = target->center.y;
+		target->pose.transformation() = H;
+
+		_targets.push_back( target );
+		return _targets.size() - 1;
+	}
+
+	void ESMTracker::setPose( size_t id, const Matrix3f& pose )
+	{
+		_targets[ id ]->pose.set( pose );
+	}
+
+	Matrix3f ESMTracker::pose( size_t id ) const
+	{
+		Matrix3f ret;
+		EigenBridge::toCVT( ret, _targets[ id ]->pose.transformation() );
+		return ret;
+	}
+
+	Matrix3f ESMTracker::homography( size_t id ) const
+	{
+		const Target& t = *_targets[ id ];
+		Eigen::Matrix3f center( Eigen::Matrix3f::Identity() );
+		center( 0, 2 ) = -t.center.x;
+		center( 1, 2 ) = -t.center.y;
+
+		Matrix3f ret;
+		EigenBridge::toCVT( ret, Eigen::Matrix3f( t.pose.transformation() * center ) );
+		return ret;
+	}
+
+	void ESMTracker::track( const ImagePyramid& pyramid )
+	{
+		CVT_PROFILE_SCOPE( "ESMTracker::track" );
+		if( _targets.empty() )
+			return;
+		if( pyramid.octaves() != _octaves || pyramid.scaleFactor() != _scaleFactor || pyramid[ 0 ].format() != IFormat::GRAY_FLOAT )
+			throw CVTException( "ESMTracker: pyramid does not match the targets" );
+
+		parallelFor( 0, _targets.size(), ESMTrackerTask( *this, pyramid ), 1 );
+	}
+
+	void ESMTracker::trackTarget( Target& target, const ImagePyramid& pyramid ) const
+	{
+		Eigen::Matrix3f H = target.pose.transformation();
+		float cost = 0.0f;
+		size_t valid = 0;
+
+		float scale = Math::pow( _scaleFactor, ( float ) _octaves - 1 );
+		for( int o = _octaves - 1; o >= 0; o-- ) {
+			SL3<float> pose;
+			pose.transformation() = H;
+			_esmScalePose( pose.transformation(), scale );
+
+			cost = alignOctave( target, pose, target.octaves[ o ], pyramid[ o ], valid );
+
+			H = pose.transformation();
+			_esmScalePose( H, 1.0f / scale );
+			scale /= _scaleFactor;
+		}
+
+		const Template& tmpl = target.octaves[ 0 ];
+		target.residual = Math::sqrt( cost );
+		target.tracked = 2 * valid > tmpl.pts.size() && target.residual < _maxResidual;
+		// keep the last pose of lost targets
+		if( target.tracked )
+			target.pose.transformation() = H;
+	}
+
+	float ESMTracker::evaluate( Target& target, const SL3<float>& pose, const Template& tmpl, const IMapScoped<const float>& map, size_t& valid ) const
+	{
+		size_t n = tmpl.pts.size();
+		target.warpedPts.resize( n );
+		target.warped.resize( n );
+
+		Matrix3f H;
+		EigenBridge::toCVT( H, pose.transformation() );
+
+		// points partially outside the image become NaN
+		SIMD* simd = SIMD::instance();
+		simd->transformPointsHomogenize( &target.warpedPts[ 0 ], H, &tmpl.pts[ 0 ], n );
+		simd->warpBilinear1f( &target.warped[ 0 ], &target.warpedPts[ 0 ].x, map.ptr(), map.stride(), map.width(), map.height(), NAN, n );
+
+		float ssd = 0.0f;
+		valid = 0;
+		for( size_t i = 0; i < n; i++ ) {
+			if( Math::isNaN( target.warped[ i ] ) )
+				continue;
+			ssd += Math::sqr( target.warped[ i ] - tmpl.intensity[ i ] );
+			valid++;
+		}
+		return valid ? ssd / ( float ) valid : 0.0f;
+	}
+
+	float ESMTracker::alignOctave( Target& target, SL3<float>& pose, const Template& tmpl, const Image& img, size_t& valid ) const
+	{
+		typedef Eigen::Matrix<float, 8, 8> HessType;
+		typedef Eigen::Matrix<float, 8, 1> JacType;
+
+		IMapScoped<const float> map( img );
+		float cost = evaluate( target, pose, tmpl, map, valid );
+
+		const size_t cols = tmpl.cols;
+		const size_t rows = tmpl.rows;
+		for( size_t iter = 0; iter < _maxIter && valid >= 8; iter++ ) {
+			HessType A( HessType::Zero() );
+			JacType b( JacType::Zero() );
+			JacType j, jw;
+
+			const float* w = &target.warped[ 0 ];
+			for( size_t y = 0; y < rows; y++ ) {
+				for( size_t x = 0; x < cols; x++ ) {
+					size_t i = y * cols + x;
+					// gradient of the warped image on the template grid
+					float l = w[ x > 0 ? i - 1 : i ];
+					float r = w[ x + 1 < cols ? i + 1 : i ];
+					float u = w[ y > 0 ? i - cols : i ];
+					float d = w[ y + 1 < rows ? i + cols : i ];
+					if( Math::isNaN( w[ i ] ) || Math::isNaN( l ) || Math::isNaN( r ) || Math::isNaN( u ) || Math::isNaN( d ) )
+						continue;
+					float gx = ( r - l ) * ( x > 0 && x + 1 < cols ? 0.5f : 1.0f );
+					float gy = ( d - u ) * ( y > 0 && y + 1 < rows ? 0.5f : 1.0f );
+
+					// ESM: mean of the template and the warped image gradient
+					_esmJacobian( jw.data(), gx, gy, tmpl.pts[ i ].x, tmpl.pts[ i ].y );
+					j = 0.5f * ( jw + Eigen::Map<const JacType>( &tmpl.jac[ 8 * i ] ) );
+
+					float res = w[ i ] - tmpl.intensity[ i ];
+					A.noalias() += j * j.transpose();
+					b.noalias() += j * res;
+				}
+			}
+
+			JacType delta = -A.ldlt().solve( b );
+			if( Math::isNaN( delta.sum() ) || Math::isInf( delta.sum() ) )
+				break;
+
+			// step halving if the costs increase
+			SL3<float> next;
+			float nextCost = cost;
+			size_t nextValid = 0;
+			bool accepted = false;
+			for( size_t k = 0; k < 4 && !accepted; k++ ) {
+				next.transformation() = pose.transformation();
+				next.applyInverse( delta );
+				nextCost = evaluate( target, next, tmpl, map, nextValid );
+				if( nextValid >= 8 && nextCost <= cost )
+					accepted = true;
+				else
+					delta *= 0.5f;
+			}
+
+			if( !accepted ) {
+				// restore the warped samples of the current pose
+				cost = evaluate( target, pose, tmpl, map, valid );
+				break;
+			}
+
+			pose.transformation() = next.transformation();
+			cost = nextCost;
+			valid = nextValid;
+			if( delta.array().abs().maxCoeff() < _minStep )
+				break;
+		}
+		return cost;
+	}
+}
@@ -0,0 +1,120 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_ESMTRACKER_H
+#define CVT_ESMTRACKER_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/geom/Rect.h>
+#include <cvt/math/Matrix.h>
+#include <cvt/math/SL3.h>
+#include <cvt/vision/ImagePyramid.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/**
+	  \brief ESM homography tracking of many planar targets
+
+	  For every target and pyramid octave the template samples, template gradients
+	  and the template part of the ESM Jacobian are cached when the target is added.
+	  Tracking only warps the template points into the current image with the SIMD
+	  bilinear sampler and runs coarse-to-fine over the octaves. Targets are tracked
+	  in parallel on the ThreadPool.
+
+	  The pose of a target maps template coordinates, centered at the center of the
+	  template region, to octave 0 coordinates of the current image.
+	 */
+	class ESMTracker {
+		public:
+			ESMTracker();
+			~ESMTracker();
+
+			/**
+			  \brief add a target
+			  \param pyramid	GRAY_FLOAT pyramid of the reference image, tracked pyramids must have the same number of octaves and scale factor
+			  \param roi		template region in octave 0 of the reference image
+			  \return id of the target
+			 */
+			size_t		addTarget( const ImagePyramid& pyramid, const Recti& roi );
+			void		clear();
+			size_t		numTargets() const { return _targets.size(); }
+
+			void		setPose( size_t id, const Matrix3f& pose );
+			Matrix3f	pose( size_t id ) const;
+			/* homography mapping the template region in the reference image to the current image */
+			Matrix3f	homography( size_t id ) const;
+			bool		isTracked( size_t id ) const { return _targets[ id ]->tracked; }
+			/* RMS intensity difference after the last track() call */
+			float		residual( size_t id ) const { return _targets[ id ]->residual; }
+
+			void		setMaxIterations( size_t iter ) { _maxIter = iter; }
+			void		setMinStep( float eps )			{ _minStep = eps; }
+			void		setMaxResidual( float r )		{ _maxResidual = r; }
+
+			void		track( const ImagePyramid& pyramid );
+
+		private:
+			ESMTracker( const ESMTracker& );
+			ESMTracker& operator=( const ESMTracker& );
+
+			friend class ESMTrackerTask;
+
+			/* template of a target in one octave, rows * cols points in row major order */
+			struct Template {
+				size_t				  cols, rows;
+				std::vector<Vector2f> pts;
+				std::vector<float>	  intensity;
+				/* gradient( T ) * dW/dp for the 8 SL3 parameters */
+				std::vector<float>	  jac;
+			};
+
+			struct Target {
+				std::vector<Template> octaves;
+				Vector2f			  center;
+				SL3<float>			  pose;
+				bool				  tracked;
+				float				  residual;
+
+				/* scratch buffers reused between frames */
+				std::vector<Vector2f> warpedPts;
+				std::vector<float>	  warped;
+			};
+
+			void	trackTarget( Target& target, const ImagePyramid& pyramid ) const;
+			float	alignOctave( Target& target, SL3<float>& pose, const Template& tmpl, const Image& img, size_t& valid ) const;
+			float	evaluate( Target& target, const SL3<float>& pose, const Template& tmpl, const IMapScoped<const float>& map, size_t& valid ) const;
+
+			size_t					_octaves;
+			float					_scaleFactor;
+			size_t					_maxIter;
+			float					_minStep;
+			float					_maxResidual;
+			std::vector<Target*>	_targets;
+	};
+}
+
+#endif
@@ -0,0 +1,115 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/ESMTracker.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+
+namespace cvt {
+
+	static float _esmTexture( float x, float y )
+	{
+		return 0.5f + 0.15f * Math::sin( 0.21f * x + 0.05f * y ) + 0.12f * Math::cos( 0.07f * x - 0.23f * y )
+			   + 0.1f * Math::sin( 0.013f * x * y / 7.0f + 0.3f * x );
+	}
+
+	/* renders the texture as seen through the homography H ( reference -> image ) */
+	static void _esmRender( Image& img, size_t w, size_t h, const Matrix3f& H )
+	{
+		Matrix3f Hinv = H.inverse();
+		img.reallocate( w, h, IFormat::GRAY_FLOAT );
+		IMapScoped<float> map( img );
+		for( size_t y = 0; y < h; y++ ) {
+			float* ptr = map.ptr();
+			for( size_t x = 0; x < w; x++ ) {
+				Vector2f p = Hinv * Vector2f( x, y );
+				ptr[ x ] = _esmTexture( p.x, p.y );
+			}
+			map++;
+		}
+	}
+
+	static float _esmCornerError( const Matrix3f& H, const Matrix3f& Htrue, const Recti& roi )
+	{
+		float err = 0.0f;
+		for( int i = 0; i < 4; i++ ) {
+			Vector2f c( roi.x + ( i & 1 ) * ( roi.width - 1 ), roi.y + ( i >> 1 ) * ( roi.height - 1 ) );
+			err = Math::max( err, ( H * c - Htrue * c ).length() );
+		}
+		return err;
+	}
+
+	BEGIN_CVTTEST( ESMTracker )
+		bool result = true;
+		const size_t w = 320, h = 240;
+
+		Image ref, cur;
+		Matrix3f id;
+		id.setIdentity();
+		_esmRender( ref, w, h, id );
+
+		// small rotation, scale, perspective and a translation of several pixels
+		Matrix3f motion( 1.02f * Math::cos( 0.04f ), -Math::sin( 0.04f ), 6.5f,
+						 Math::sin( 0.04f ), 0.99f * Math::cos( 0.04f ), -4.0f,
+						 2e-5f, -1e-5f, 1.0f );
+		_esmRender( cur, w, h, motion );
+
+		ImagePyramid pref( 3, 0.5f ), pcur( 3, 0.5f );
+		pref.update( ref );
+		pcur.update( cur );
+
+		ESMTracker tracker;
+		std::vector<Recti> rois;
+		rois.push_back( Recti( 40, 40, 48, 48 ) );
+		rois.push_back( Recti( 150, 60, 64, 40 ) );
+		rois.push_back( Recti( 200, 140, 50, 50 ) );
+		rois.push_back( Recti( 60, 150, 40, 60 ) );
+		for( size_t i = 0; i < rois.size(); i++ )
+			tracker.addTarget( pref, rois[ i ] );
+
+		tracker.track( pcur );
+
+		bool b = true;
+		for( size_t i = 0; i < rois.size(); i++ ) {
+			float err = _esmCornerError( tracker.homography( i ), motion, rois[ i ] );
+			if( !tracker.isTracked( i ) || err > 0.1f ) {
+				CVTTEST_LOG( "target " << i << " corner error: " << err << " residual: " << tracker.residual( i ) );
+				b = false;
+			}
+		}
+		CVTTEST_PRINT( "ESMTracker multi-target pyramid alignment", b );
+		result &= b;
+
+		// a target pushed out of the image is reported as lost
+		Matrix3f away( id );
+		away[ 0 ][ 2 ] = 1000.0f;
+		tracker.setPose( 0, away );
+		tracker.track( pcur );
+		b = !tracker.isTracked( 0 ) && tracker.isTracked( 1 );
+		CVTTEST_PRINT( "ESMTracker lost target", b );
+		result &= b;
+
+		return result;
+	END_CVTTEST
+}
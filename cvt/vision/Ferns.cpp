@@ -24,18 +24,107 @@
 
 #include <cvt/vision/Ferns.h>
 
-#include <cvt/vision/FAST.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/Exception.h>
+
+#include <fstream>
+#include <cstring>
 
 namespace cvt
 {
+	static const char	 _fernsMagic[ 8 ] = { 'C', 'V', 'T', 'F', 'E', 'R', 'N', 'S' };
+	static const uint32_t _fernsVersion = 1;
+
+	template<typename T>
+	static inline void _writeValue( std::ofstream & out, const T & v )
+	{
+		out.write( ( const char* )&v, sizeof( T ) );
+	}
+
+	template<typename T>
+	static inline void _readValue( std::ifstream & in, T & v )
+	{
+		in.read( ( char* )&v, sizeof( T ) );
+	}
+
+	/* per thread scratch memory for the bank evaluation */
+	class FernScratch
+	{
+		public:
+			FernScratch( size_t numClasses, size_t numFerns, size_t numTests ) :
+				scores( numClasses ),
+				leaves( numFerns ),
+				a( numTests ),
+				b( numTests )
+			{
+			}
+
+			std::vector<uint16_t>	scores;
+			std::vector<uint16_t>	leaves;
+			std::vector<uint8_t>	a;
+			std::vector<uint8_t>	b;
+	};
+
+	class Ferns::MatchBody
+	{
+		public:
+			MatchBody( const Ferns & ferns,
+					   const std::vector<Eigen::Vector2i> & features,
+					   const uint8_t * img, size_t stride,
+					   const std::vector<int32_t> & offsets,
+					   const Image & image,
+					   std::vector<size_t> & classIdx,
+					   std::vector<double> & probs ) :
+				_ferns( ferns ),
+				_features( features ),
+				_img( img ),
+				_stride( stride ),
+				_offsets( offsets ),
+				_image( image ),
+				_classIdx( classIdx ),
+				_probs( probs )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				FernScratch scratch( _ferns._classStride, _ferns._numFerns, _ferns._nTests );
+				for( size_t i = begin; i < end; i++ ){
+					const Eigen::Vector2i & p = _features[ i ];
+					if( !_ferns.insidePatchBounds( p, _image ) ){
+						_probs[ i ] = 0.0;
+						continue;
+					}
+					const uint8_t * center = _img + _stride * p[ 1 ] + p[ 0 ];
+					_probs[ i ] = _ferns.evaluate( _classIdx[ i ], center, &_offsets[ 0 ], scratch );
+				}
+			}
+
+		private:
+			const Ferns &							_ferns;
+			const std::vector<Eigen::Vector2i> &	_features;
+			const uint8_t *							_img;
+			size_t									_stride;
+			const std::vector<int32_t> &			_offsets;
+			const Image &							_image;
+			std::vector<size_t> &					_classIdx;
+			std::vector<double> &					_probs;
+	};
 
 	Ferns::Ferns( uint32_t patchSize, uint32_t numOverallTests, uint32_t numFerns ) :
 		_patchSize( patchSize ),
 		_numFerns( numFerns ),
 		_nTests( numOverallTests ),
 		_trainingSamples( 15000 ),
-		_featureDetector( 0 )
+		_featureDetector( 0 ),
+		_classStride( 0 ),
+		_logMin( 0.0f ),
+		_logScale( 1.0f )
 	{
+		if( !_numFerns )
+			throw CVTException( "Ferns: at least one fern is required" );
+
 		_ferns.reserve( numFerns );
 
 		while( ( _nTests % _numFerns ) != 0 ){
@@ -43,96 +132,27 @@ namespace cvt
 		}
 		_testsPerFern = _nTests / _numFerns;
 
+		if( _testsPerFern > 16 )
+			throw CVTException( "Ferns: at most 16 tests per fern are supported" );
+		if( _numFerns > 257 )
+			throw CVTException( "Ferns: at most 257 ferns are supported" );
+
 		_featureDetector = new FAST( SEGMENT_9 );
 		_featureDetector->setThreshold( 40 );
 	}
 
-	Ferns::Ferns( const std::string & fileName ) : _featureDetector( 0 )
+	Ferns::Ferns( const std::string & fileName ) :
+		_patchSize( 0 ),
+		_numFerns( 0 ),
+		_nTests( 0 ),
+		_testsPerFern( 0 ),
+		_trainingSamples( 15000 ),
+		_featureDetector( 0 ),
+		_classStride( 0 ),
+		_logMin( 0.0f ),
+		_logScale( 1.0f )
 	{
-		std::ifstream file;
-		std::string line;
-		std::istringstream strTok;
-
-		file.open( fileName.c_str(), std::ifstream::in );
-
-		getline( file, line );
-		strTok.str( line );
-		strTok >> _patchSize;
-
-		getline( file, line );
-		strTok.clear();
-		strTok.str( line );
-		strTok >> _numFerns;
-
-		getline( file, line );
-		strTok.clear();
-		strTok.str( line );
-		strTok >> _nTests;
-
-		getline( file, line );
-		strTok.clear();
-		strTok.str( line );
-		strTok >> _testsPerFern;
-
-		uint32_t numFeatures;
-		getline( file, line );
-		strTok.clear();
-		strTok.str( line );
-		strTok >> numFeatures;
-
-        int x, y;
-		std::string lineVal;
-		for( size_t i = 0; i < numFeatures; i++ ){
-			getline( file, line );
-
-			strTok.clear();
-			strTok.str( line );
-			strTok >> x;
-			strTok >> y;
-
-			_modelFeatures.push_back( Feature2Df( x, y ) );
-		}
-
-		uint32_t numProbs;
-		float	 regPrior;
-		for( size_t i = 0; i < _numFerns; i++ ){
-			getline( file, line );
-			strTok.clear();
-			strTok.str( line );
-			strTok >> numProbs;
-
-			getline( file, line );
-			strTok.clear();
-			strTok.str( line );
-			strTok >> regPrior;
-
-			_ferns.push_back( Fern( _testsPerFern, _patchSize ) );
-			Eigen::Vector2i p0, p1;
-			for( uint32_t t = 0; t < _testsPerFern; t++ ){
-				getline( file, line );
-
-				strTok.clear();
-				strTok.str( line );
-
-				strTok >> p0[ 0 ];
-				strTok >> p0[ 1 ];
-				strTok >> p1[ 0 ];
-				strTok >> p1[ 1 ];
-				_ferns.back().addTest( p0, p1 );
-			}
-
-			for( size_t p = 0; p < numProbs; p++ ){
-				double prob;
-				getline( file, line );
-				strTok.clear();
-				strTok.str( line );
-				for( size_t c = 0; c < _modelFeatures.size(); c++ ){
-					strTok >> prob;
-					_ferns.back().setProbabilityForTest( p, c, prob );
-				}
-
-			}
-		}
+		load( fileName );
 	}
 
 	Ferns::~Ferns()
@@ -143,8 +163,17 @@ namespace cvt
 
 	void Ferns::train( const Image & img )
 	{
+		if( img.format() != IFormat::GRAY_UINT8 )
+			throw CVTException( "Ferns: training image has to be GRAY_UINT8" );
+
 		RNG rng( time( NULL ) );
 
+		_ferns.clear();
+		_modelFeatures.clear();
+		_tests.resize( 4 * _nTests );
+
+		int32_t patchHalfSize = _patchSize >> 1;
+
 		Eigen::Vector2i x0, x1;
 		for( uint32_t i = 0; i < _numFerns; i++ ){
 			_ferns.push_back( Fern( _testsPerFern, _patchSize ) );
@@ -156,15 +185,19 @@ namespace cvt
 				x1[ 1 ] = rng.uniform( 0, _patchSize );
 
 				_ferns.back().addTest( x0, x1 );
+
+				// bank layout is test major, coordinates relative to the patch center
+				int16_t* test = &_tests[ 4 * ( t * _numFerns + i ) ];
+				test[ 0 ] = x0[ 0 ] - patchHalfSize;
+				test[ 1 ] = x0[ 1 ] - patchHalfSize;
+				test[ 2 ] = x1[ 0 ] - patchHalfSize;
+				test[ 3 ] = x1[ 1 ] - patchHalfSize;
 			}
 		}
 
 		// detect features in the "model"-image
-		std::vector<Feature2Df> features;
-        VectorFeature2DInserter<float> inserter( features );
-		_featureDetector->extract( img, inserter );
-
-		int32_t patchHalfSize = _patchSize >> 1;
+		FeatureSet features;
+		_featureDetector->detect( features, img );
 
 		/* train the class */
 		PatchGenerator patchGen( Rangef( 0.0f, Math::TWO_PI ), Rangef( 0.6f, 1.5f ), _patchSize, 3.0 /* noise */ );
@@ -181,7 +214,7 @@ namespace cvt
 				( y + patchHalfSize ) >= ( int32_t )img.height() )
 				continue;
 
-			_modelFeatures.push_back( features[ i ] );
+			_modelFeatures.push_back( features[ i ].pt );
 
 			this->trainClass( _modelFeatures.size() - 1, patchGen, img );
 		}
@@ -189,136 +222,271 @@ namespace cvt
 		for( size_t i = 0; i < _ferns.size(); i++ ){
 			_ferns[ i ].normalizeStatistics( _trainingSamples );
 		}
+
+		compileBank();
+
+		// the double precision statistics are not needed anymore
+		_ferns.clear();
+	}
+
+	void Ferns::compileBank()
+	{
+		size_t numLeaves  = ( size_t )1 << _testsPerFern;
+		size_t numClasses = _modelFeatures.size();
+		_classStride = Math::pad16( Math::max<size_t>( numClasses, 1 ) );
+
+		double lmin = 0.0, lmax = 0.0;
+		bool first = true;
+		for( size_t f = 0; f < _ferns.size(); f++ ){
+			for( size_t l = 0; l < numLeaves; l++ ){
+				const std::vector<double> & probs = _ferns[ f ].probsForResult( l );
+				for( size_t c = 0; c < probs.size(); c++ ){
+					if( first ){
+						lmin = lmax = probs[ c ];
+						first = false;
+					}
+					lmin = Math::min( lmin, probs[ c ] );
+					lmax = Math::max( lmax, probs[ c ] );
+				}
+			}
+		}
+
+		_logMin	  = ( float )lmin;
+		_logScale = ( lmax > lmin ) ? ( float )( ( lmax - lmin ) / 255.0 ) : 1.0f;
+
+		_logProbs.assign( _numFerns * numLeaves * _classStride, 0 );
+		for( size_t f = 0; f < _ferns.size(); f++ ){
+			for( size_t l = 0; l < numLeaves; l++ ){
+				const std::vector<double> & probs = _ferns[ f ].probsForResult( l );
+				uint8_t* dst = &_logProbs[ ( f * numLeaves + l ) * _classStride ];
+				for( size_t c = 0; c < probs.size(); c++ ){
+					double q = ( probs[ c ] - lmin ) / _logScale;
+					dst[ c ] = ( uint8_t )Math::clamp<double>( q + 0.5, 0.0, 255.0 );
+				}
+			}
+		}
+
+		initExpTable();
+	}
+
+	/* byte offsets of the test pixels for the image stride, computed per call so that matching does not modify the bank */
+	void Ferns::testOffsets( std::vector<int32_t> & offsets, size_t stride ) const
+	{
+		offsets.resize( 2 * _nTests );
+		for( size_t i = 0; i < _nTests; i++ ){
+			const int16_t* test = &_tests[ 4 * i ];
+			offsets[ 2 * i     ] = ( int32_t )test[ 1 ] * ( int32_t )stride + test[ 0 ];
+			offsets[ 2 * i + 1 ] = ( int32_t )test[ 3 ] * ( int32_t )stride + test[ 2 ];
+		}
+	}
+
+	bool Ferns::insidePatchBounds( const Eigen::Vector2i & p, const Image & img ) const
+	{
+		int32_t patchHalfSize = _patchSize >> 1;
+		return !( p[ 0 ] - patchHalfSize < 0 ||
+				  p[ 0 ] + patchHalfSize >= ( int32_t )img.width() ||
+				  p[ 1 ] - patchHalfSize < 0 ||
+				  p[ 1 ] + patchHalfSize >= ( int32_t )img.height() );
+	}
+
+	double Ferns::evaluate( size_t & bestIdx, const uint8_t * center, const int32_t * offsets, FernScratch & scratch ) const
+	{
+		SIMD* simd = SIMD::instance();
+		size_t numLeaves = ( size_t )1 << _testsPerFern;
+		size_t numClasses = _modelFeatures.size();
+
+		bestIdx = 0;
+		if( !numClasses )
+			return 0.0;
+
+		// gather the pixel pairs of all tests
+		const int32_t* off = offsets;
+		uint8_t* a = &scratch.a[ 0 ];
+		uint8_t* b = &scratch.b[ 0 ];
+		for( size_t i = 0; i < _nTests; i++ ){
+			a[ i ] = center[ off[ 0 ] ];
+			b[ i ] = center[ off[ 1 ] ];
+			off += 2;
+		}
+
+		uint16_t* leaves = &scratch.leaves[ 0 ];
+		simd->fernIndices_u8( leaves, a, b, _numFerns, _testsPerFern );
+
+		uint16_t* scores = &scratch.scores[ 0 ];
+		simd->SetValueU16( scores, 0, _classStride );
+		for( size_t f = 0; f < _numFerns; f++ ){
+			simd->AddU8_to_u16( scores, &_logProbs[ ( f * numLeaves + leaves[ f ] ) * _classStride ], _classStride );
+		}
+
+		for( size_t c = 1; c < numClasses; c++ ){
+			if( scores[ c ] > scores[ bestIdx ] )
+				bestIdx = c;
+		}
+
+		// posterior of the best class: 1 / sum_c exp( L_c - L_best )
+		double probSum = 0.0;
+		const uint16_t best = scores[ bestIdx ];
+		const size_t tableSize = _expTable.size();
+		for( size_t c = 0; c < numClasses; c++ ){
+			size_t d = best - scores[ c ];
+			if( d < tableSize )
+				probSum += _expTable[ d ];
+		}
+
+		return 1.0 / probSum;
 	}
 
 	void Ferns::match( const::std::vector<Eigen::Vector2i> & features,
 					   const Image & img,
 					   std::vector<Eigen::Vector2d> & matchedModel,
-					   std::vector<Eigen::Vector2d> & matchedFeatures )
+					   std::vector<Eigen::Vector2d> & matchedFeatures ) const
 	{
 		std::vector<double> bestProbsForPoint( _modelFeatures.size(), 0.0 );
 		std::vector<size_t> featureIndicesForPoint( _modelFeatures.size(), 0 );
 
-		int32_t patchHalfSize = _patchSize >> 1;
+		std::vector<size_t> classIdx( features.size(), 0 );
+		std::vector<double> probs( features.size(), 0.0 );
 
 		size_t stride;
 		const uint8_t * p = img.map( &stride );
+		std::vector<int32_t> off;
+		testOffsets( off, stride );
 
-		uint32_t testResult;
-		for( size_t i = 0; i < features.size(); i++ ){
-			if( features[ i ][ 0 ] - patchHalfSize < 0 ||
-			    features[ i ][ 0 ] + patchHalfSize > ( int32_t )img.width() ||
-			    features[ i ][ 1 ] - patchHalfSize < 0 ||
-			    features[ i ][ 1 ] + patchHalfSize > ( int32_t )img.height() ){
-				continue;
-			}
-
-			const uint8_t * uL = p + stride * ( features[ i ][ 1 ] - patchHalfSize ) + features[ i ][ 0 ] - patchHalfSize;
-			std::vector<double> classProbs( _modelFeatures.size(), 0.0 );
-
-
-			for( size_t f = 0; f < _ferns.size(); f++) {
-				testResult = _ferns[ f ].test( uL, stride );
-				const std::vector<double> & trainedProbabilities = _ferns[ f ].probsForResult( testResult );
-				for( size_t k = 0; k < trainedProbabilities.size(); k++ ){
-					classProbs[ k ] += trainedProbabilities[ k ];
-				}
-			}
-
-			size_t bestIdx = 0;
-			double probSum = exp( classProbs[ 0 ] );
-			for( size_t k = 1; k < classProbs.size(); k++ ){
-				probSum += exp( classProbs[ k ] );
-				if( classProbs[ k ] > classProbs[ bestIdx ] )
-					bestIdx = k;
-			}
-
-			double probability = exp( classProbs[ bestIdx ] ) / probSum;
+		MatchBody body( *this, features, p, stride, off, img, classIdx, probs );
+		parallelFor( 0, features.size(), body, Math::max<size_t>( parallelGrain( features.size() ), 32 ) );
+		img.unmap( p );
 
-			if( probability > bestProbsForPoint[ bestIdx ] ){
-				bestProbsForPoint[ bestIdx ] = probability;
+		// keep the best feature for each model point
+		for( size_t i = 0; i < features.size(); i++ ){
+			size_t bestIdx = classIdx[ i ];
+			if( probs[ i ] > bestProbsForPoint[ bestIdx ] ){
+				bestProbsForPoint[ bestIdx ] = probs[ i ];
 				featureIndicesForPoint[ bestIdx ] = i;
 			}
 		}
-		img.unmap( p );
 
-		// no check the result:
 		for( size_t i = 0; i < bestProbsForPoint.size(); i++ ){
-			std::cout << "Prob: " << bestProbsForPoint[ i ] << std::endl;
 			if( bestProbsForPoint[ i ] > 0.96 ){
-				matchedModel.push_back( Eigen::Vector2d( _modelFeatures[ i ].pt.x, _modelFeatures[ i ].pt.y ) );
+				matchedModel.push_back( Eigen::Vector2d( _modelFeatures[ i ].x, _modelFeatures[ i ].y ) );
 				matchedFeatures.push_back( features[ featureIndicesForPoint[ i ] ].cast<double>() );
 			}
 		}
-
 	}
 
-	double Ferns::classify( Eigen::Vector2i & bestClass, const Image & img, const Eigen::Vector2i & p )
+	double Ferns::classify( Eigen::Vector2i & bestClass, const Image & img, const Eigen::Vector2i & p ) const
 	{
-		size_t imStride;
+		if( !insidePatchBounds( p, img ) )
+			return 0.0;
 
-        const uint8_t * imP = img.map( &imStride );
-		int32_t patchHalfSize = _patchSize >> 1;
+		size_t imStride;
+		const uint8_t * imP = img.map( &imStride );
+		std::vector<int32_t> off;
+		testOffsets( off, imStride );
 
-        if( p[ 0 ] - patchHalfSize < 0 ||
-            p[ 0 ] + patchHalfSize > ( int32_t )img.width() ||
-            p[ 1 ] - patchHalfSize < 0 ||
-            p[ 1 ] + patchHalfSize > ( int32_t )img.height() )
-            return 0.0f;
+		FernScratch scratch( _classStride, _numFerns, _nTests );
+		size_t bestIdx;
+		double prob = evaluate( bestIdx, imP + imStride * p[ 1 ] + p[ 0 ], &off[ 0 ], scratch );
 
-		const uint8_t * uL = imP + imStride * ( p[ 1 ] - patchHalfSize ) + p[ 0 ] - patchHalfSize;
+		img.unmap( imP );
 
-		std::vector<double> classProbs( _modelFeatures.size(), 0.0 );
+		if( _modelFeatures.empty() )
+			return 0.0;
 
-		uint32_t testResult;
+		bestClass[ 0 ] = _modelFeatures[ bestIdx ].x;
+		bestClass[ 1 ] = _modelFeatures[ bestIdx ].y;
 
-		// for each fern
-		for( size_t i = 0; i < _ferns.size(); i++ ){
-			testResult = _ferns[ i ].test( uL, imStride );
-			const std::vector<double> & trainedProbs = _ferns[ i ].probsForResult( testResult );
+		return prob;
+	}
 
-			for( size_t f = 0; f < trainedProbs.size(); f++ ){
-				classProbs[ f ] += trainedProbs[ f ];
-			}
-		}
+	void Ferns::initExpTable()
+	{
+		// differences beyond exp( -20 ) do not contribute to the posterior
+		size_t maxDiff = 255 * _numFerns;
+		size_t cutoff  = ( size_t )Math::ceil( 20.0f / _logScale );
+		size_t size	   = Math::min( maxDiff, cutoff ) + 1;
+
+		_expTable.resize( size );
+		for( size_t d = 0; d < size; d++ )
+			_expTable[ d ] = Math::exp( -( float )d * _logScale );
+	}
 
-		img.unmap( imP );
+	void Ferns::save( const std::string & fileName ) const
+	{
+		std::ofstream out( fileName.c_str(), std::ios_base::out | std::ios_base::binary );
+		if( !out.is_open() )
+			throw CVTException( "Ferns: could not open file for writing: " + fileName );
+
+		uint32_t numClasses = _modelFeatures.size();
+		size_t numLeaves = ( size_t )1 << _testsPerFern;
+
+		out.write( _fernsMagic, sizeof( _fernsMagic ) );
+		_writeValue( out, _fernsVersion );
+		_writeValue( out, _patchSize );
+		_writeValue( out, _numFerns );
+		_writeValue( out, _testsPerFern );
+		_writeValue( out, numClasses );
+		_writeValue( out, _logMin );
+		_writeValue( out, _logScale );
 
-		uint32_t bestIdx = 0;
-		double probSum = 0.0;
-		for( size_t i = 0; i < classProbs.size(); i++ ){
-			probSum += exp( classProbs[ i ] );
-			if( classProbs[ i ] > classProbs[ bestIdx ] )
-				bestIdx = i;
+		for( size_t i = 0; i < _modelFeatures.size(); i++ ){
+			_writeValue( out, _modelFeatures[ i ].x );
+			_writeValue( out, _modelFeatures[ i ].y );
 		}
 
-		bestClass[ 0 ] = _modelFeatures[ bestIdx ].pt.x;
-		bestClass[ 1 ] = _modelFeatures[ bestIdx ].pt.y;
+		out.write( ( const char* )&_tests[ 0 ], _tests.size() * sizeof( int16_t ) );
+
+		// the tables are stored without the class padding
+		for( size_t i = 0; i < _numFerns * numLeaves; i++ )
+			out.write( ( const char* )&_logProbs[ i * _classStride ], numClasses );
 
-		return exp( classProbs[ bestIdx ] ) / probSum;
+		out.close();
 	}
 
-	void Ferns::save( const std::string & fileName )
+	void Ferns::load( const std::string & fileName )
 	{
-		std::ofstream out;
+		std::ifstream in( fileName.c_str(), std::ios_base::in | std::ios_base::binary );
+		if( !in.is_open() )
+			throw CVTException( "Ferns: could not open file: " + fileName );
+
+		char magic[ sizeof( _fernsMagic ) ];
+		uint32_t version, numClasses;
+		in.read( magic, sizeof( magic ) );
+		_readValue( in, version );
+		if( !in.good() || memcmp( magic, _fernsMagic, sizeof( magic ) ) || version != _fernsVersion )
+			throw CVTException( "Ferns: not a valid ferns model file: " + fileName );
+
+		_readValue( in, _patchSize );
+		_readValue( in, _numFerns );
+		_readValue( in, _testsPerFern );
+		_readValue( in, numClasses );
+		_readValue( in, _logMin );
+		_readValue( in, _logScale );
+
+		if( !in.good() || !_testsPerFern || _testsPerFern > 16 || !_numFerns || _numFerns > 257 || _logScale <= 0.0f )
+			throw CVTException( "Ferns: corrupt model file: " + fileName );
+
+		_nTests = _numFerns * _testsPerFern;
+		size_t numLeaves = ( size_t )1 << _testsPerFern;
+
+		_modelFeatures.resize( numClasses );
+		for( size_t i = 0; i < numClasses; i++ ){
+			_readValue( in, _modelFeatures[ i ].x );
+			_readValue( in, _modelFeatures[ i ].y );
+		}
 
-		out.open( fileName.c_str(), std::ios_base::out );
+		_tests.resize( 4 * _nTests );
+		in.read( ( char* )&_tests[ 0 ], _tests.size() * sizeof( int16_t ) );
 
-		out << _patchSize << std::endl;
-		out << _numFerns << std::endl;
-		out << _nTests << std::endl;
-		out << _testsPerFern << std::endl;
+		_classStride = Math::pad16( Math::max<size_t>( numClasses, 1 ) );
+		_logProbs.assign( _numFerns * numLeaves * _classStride, 0 );
+		for( size_t i = 0; i < _numFerns * numLeaves; i++ )
+			in.read( ( char* )&_logProbs[ i * _classStride ], numClasses );
 
-		out << _modelFeatures.size() << std::endl;
-		for( size_t i = 0; i < _modelFeatures.size(); i++ ){
-			out << _modelFeatures[ i ].pt.x << " " << _modelFeatures[ i ].pt.y << std::endl;
-		}
+		if( !in.good() )
+			throw CVTException( "Ferns: unexpected end of model file: " + fileName );
 
-		for( size_t i = 0; i < _ferns.size(); i++ ){
-			_ferns[ i ].serialize( out );
-		}
-
-		out.close();
+		_ferns.clear();
+		initExpTable();
 	}
 
 	void Ferns::trainClass( size_t idx, PatchGenerator & patchGen, const Image & img )
@@ -329,7 +497,7 @@ namespace cvt
 
 		for( size_t i = 0; i < _trainingSamples; i++ ) {
 			// generate a new patch
-			patchGen.next( patch, img, _modelFeatures[ idx ].pt );
+			patchGen.next( patch, img, _modelFeatures[ idx ] );
 
 			p = patch.map( &pStride );
 
@@ -341,4 +509,4 @@ namespace cvt
 			patch.unmap( p );
 		}
 	}
-}
\ No newline at end of file
+}
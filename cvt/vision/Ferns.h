@@ -28,7 +28,7 @@
 #include <cvt/gfx/Image.h>
 #include <cvt/vision/PatchGenerator.h>
 #include <cvt/vision/internal/Fern.h>
-#include <cvt/vision/FAST.h>
+#include <cvt/vision/features/FAST.h>
 
 #include <Eigen/Core>
 #include <vector>
@@ -37,7 +37,18 @@
 
 namespace cvt 
 {
+	class FernScratch;
 	
+	/**
+	  \brief Random ferns keypoint classifier
+
+	  After training or loading, all ferns are kept in a compact bank:
+	  the pixel tests are stored relative to the patch center and turned into
+	  byte offsets for the stride of each image, the log-probabilities of all
+	  leaves are quantized to u8 and stored contiguously ( fern major, then
+	  leaf, then class ), such that the scores of all classes can be
+	  accumulated with SIMD.
+	 */
 	class Ferns 
 	{
 		
@@ -48,14 +59,19 @@ namespace cvt
 			
 			void train( const Image & img );
 			
-			double classify( Eigen::Vector2i & bestClass, const Image & img, const Eigen::Vector2i & p );
+			double classify( Eigen::Vector2i & bestClass, const Image & img, const Eigen::Vector2i & p ) const;
 		
+			/* classifies all features in parallel and keeps the best feature per model point */
 			void match( const::std::vector<Eigen::Vector2i> & features,
 						const Image & img,
 						std::vector<Eigen::Vector2d> & matchedModel,
-					    std::vector<Eigen::Vector2d> & matchedFeatures );
+					    std::vector<Eigen::Vector2d> & matchedFeatures ) const;
 			
-			void save( const std::string & fileName );
+			/* binary model file */
+			void save( const std::string & fileName ) const;
+			void load( const std::string & fileName );
+
+			size_t	numClasses() const { return _modelFeatures.size(); }
 			
 		private:						
 			uint32_t	_patchSize;
@@ -66,10 +82,25 @@ namespace cvt
 			
 			std::vector<Fern>				_ferns;						
 			FAST*                           _featureDetector;			
-			std::vector<Feature2Df>	_modelFeatures;	
+			std::vector<Vector2f>			_modelFeatures;	
+
+			/* compiled fern bank */
+			std::vector<int16_t>			_tests;			// x0, y0, x1, y1 relative to the patch center, test major
+			std::vector<uint8_t>			_logProbs;		// quantized log-probabilities
+			size_t							_classStride;	// padded number of classes in _logProbs
+			float							_logMin;
+			float							_logScale;
+			std::vector<float>				_expTable;		// exp( -d * _logScale ) for score differences d
+
+			class MatchBody;
 
 			void trainClass( size_t idx, PatchGenerator & patchGen, const Image & img );
+			void compileBank();
+			void initExpTable();
+			void testOffsets( std::vector<int32_t> & offsets, size_t stride ) const;
+			bool insidePatchBounds( const Eigen::Vector2i & p, const Image & img ) const;
+			double evaluate( size_t & bestIdx, const uint8_t * center, const int32_t * offsets, FernScratch & scratch ) const;
 	};
 	
 }
-#endif
\ No newline at end of file
+#endif
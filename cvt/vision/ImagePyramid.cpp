@@ -0,0 +1,482 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/ImagePyramid.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/Profiler.h>
+
+#include <vector>
+
+/* largest period q of a rational scale factor p / q that uses polyphase tables */
+#define CVT_PYRAMID_MAX_PERIOD 10
+/* rows of the zeroth octave converted at once by updateFused( img, format ) */
+#define CVT_PYRAMID_CONVERT_ROWS 8
+
+namespace cvt
+{
+    /* p output samples for every q input samples, the taps of output i start at source sample first( i ) */
+    class PyramidPolyphase
+    {
+        public:
+            bool init( float scale );
+
+            int first( size_t i ) const { return ( int ) ( ( i / _p ) * _q ) + _offset[ i % _p ]; }
+            const float* weights( size_t i ) const { return &_weights[ ( i % _p ) * _taps ]; }
+            size_t taps() const { return _taps; }
+            size_t phases() const { return _p; }
+            size_t period() const { return _q; }
+            const float* phaseWeights( size_t phase ) const { return &_weights[ phase * _taps ]; }
+            bool binomial() const { return _p == 1 && _q == 2; }
+
+        private:
+            size_t              _p, _q;
+            size_t              _taps;
+            std::vector<int>    _offset;
+            std::vector<float>  _weights;
+    };
+
+    inline bool PyramidPolyphase::init( float scale )
+    {
+        for( _q = 2; _q <= CVT_PYRAMID_MAX_PERIOD; _q++ ) {
+            _p = ( size_t ) Math::round( scale * ( float ) _q );
+            if( _p && _p < _q && Math::abs( ( float ) _p / ( float ) _q - scale ) < 1e-4f )
+                break;
+        }
+        if( _q > CVT_PYRAMID_MAX_PERIOD )
+            return false;
+
+        if( binomial() ) {
+            /* the 5-tap binomial of Image::pyrdown, output i is centered at source sample 2 * i + 1 */
+            static const float binom5[ 5 ] = { 1.0f / 16.0f, 4.0f / 16.0f, 6.0f / 16.0f, 4.0f / 16.0f, 1.0f / 16.0f };
+            _taps = 5;
+            _offset.assign( 1, -1 );
+            _weights.assign( binom5, binom5 + 5 );
+            return true;
+        }
+
+        /* gaussian anti-aliasing filter sampled around the pixel center of every phase */
+        float s = ( float ) _p / ( float ) _q;
+        float sigma = 0.6f * Math::sqrt( 1.0f / ( s * s ) - 1.0f );
+        int radius = ( int ) Math::ceil( 2.5f * sigma );
+        _taps = 2 * radius + 2;
+        _offset.resize( _p );
+        _weights.resize( _p * _taps );
+        for( size_t j = 0; j < _p; j++ ) {
+            float c = ( ( float ) j + 0.5f ) / s - 0.5f;
+            int lo = ( int ) Math::floor( c ) - radius;
+            float* w = &_weights[ j * _taps ];
+            float sum = 0.0f;
+            for( size_t t = 0; t < _taps; t++ ) {
+                float d = ( float ) ( lo + ( int ) t ) - c;
+                w[ t ] = Math::exp( -d * d / ( 2.0f * sigma * sigma ) );
+                sum += w[ t ];
+            }
+            /* remove the bias of the sampled gaussian so that linear ramps keep their position */
+            float mean = 0.0f, var = 0.0f;
+            for( size_t t = 0; t < _taps; t++ ) {
+                float d = ( float ) ( lo + ( int ) t ) - c;
+                w[ t ] /= sum;
+                mean += w[ t ] * d;
+                var += w[ t ] * d * d;
+            }
+            var -= mean * mean;
+            for( size_t t = 0; t < _taps; t++ ) {
+                float d = ( float ) ( lo + ( int ) t ) - c;
+                w[ t ] *= 1.0f - mean * ( d - mean ) / var;
+            }
+            _offset[ j ] = lo;
+        }
+        return true;
+    }
+
+    /* one octave of the sweep: the image rows and the gradient rows computed so far */
+    struct PyramidOctave
+    {
+        const uint8_t*  data;
+        size_t          stride;
+        size_t          width, height;
+        size_t          rows;
+        uint8_t*        gx;
+        uint8_t*        gy;
+        size_t          gxstride, gystride;
+        size_t          gradRows;
+    };
+
+    /* computes the rows of octave dst from octave src, horizontally filtered source rows are kept in a ring buffer */
+    class PyramidDownsampler
+    {
+        public:
+            PyramidDownsampler( const PyramidPolyphase& pp, const PyramidOctave& src, uint8_t* dst, size_t dstride,
+                                size_t dw, size_t dh, bool u8 );
+
+            /* number of source rows needed for the next output row */
+            size_t required() const;
+            bool done() const { return _next == _dh; }
+            size_t filtered() const { return _filtered; }
+            void nextRow();
+
+        private:
+            void filterRow( size_t row );
+            void hfilter( float* dst, const float* src ) const;
+            size_t sourceRow( int row ) const { return ( size_t ) Math::clamp( row, 0, ( int ) _src.height - 1 ); }
+
+            const PyramidPolyphase& _pp;
+            const PyramidOctave&    _src;
+            uint8_t*                _dst;
+            size_t                  _dstride;
+            size_t                  _dw, _dh;
+            bool                    _u8;
+            bool                    _binomialU8;
+            size_t                  _next;
+            size_t                  _filtered;
+            size_t                  _rowstride;
+            size_t                  _xbegin, _xend;
+            ScopedBuffer<float, true>       _ring;
+            ScopedBuffer<uint16_t, true>    _ring16;
+            ScopedBuffer<float, true>       _tmp;
+            SIMD*                   _simd;
+    };
+
+    inline PyramidDownsampler::PyramidDownsampler( const PyramidPolyphase& pp, const PyramidOctave& src, uint8_t* dst, size_t dstride,
+                                                   size_t dw, size_t dh, bool u8 ) :
+        _pp( pp ),
+        _src( src ),
+        _dst( dst ),
+        _dstride( dstride ),
+        _dw( dw ),
+        _dh( dh ),
+        _u8( u8 ),
+        _binomialU8( u8 && pp.binomial() && src.width >= 4 ),
+        _next( 0 ),
+        _filtered( 0 ),
+        _rowstride( Math::pad16( dw ) ),
+        _ring( _binomialU8 ? 1 : _rowstride * pp.taps() ),
+        _ring16( _binomialU8 ? _rowstride * pp.taps() : 1 ),
+        _tmp( Math::max( src.width, dw ) + 1 ),
+        _simd( SIMD::instance() )
+    {
+        /* outputs in [ _xbegin, _xend ) need no border clamping */
+        _xbegin = 0;
+        while( _xbegin < _dw && _pp.first( _xbegin ) < 0 )
+            _xbegin++;
+        _xend = _xbegin;
+        while( _xend < _dw && ( size_t ) _pp.first( _xend ) + _pp.taps() <= _src.width )
+            _xend++;
+    }
+
+    inline size_t PyramidDownsampler::required() const
+    {
+        int last = _pp.first( _next ) + ( int ) _pp.taps();
+        return Math::min( ( size_t ) Math::max( last, 1 ), _src.height );
+    }
+
+    inline void PyramidDownsampler::hfilter( float* dst, const float* src ) const
+    {
+        size_t taps = _pp.taps();
+        size_t p = _pp.phases();
+        size_t q = _pp.period();
+
+        /* clamped borders */
+        for( size_t x = 0; x < _dw; x++ ) {
+            if( x == _xbegin )
+                x = Math::max( _xend, x );
+            if( x >= _dw )
+                break;
+            int first = _pp.first( x );
+            const float* w = _pp.weights( x );
+            float sum = 0.0f;
+            for( size_t t = 0; t < taps; t++ )
+                sum += w[ t ] * src[ Math::clamp( first + ( int ) t, 0, ( int ) _src.width - 1 ) ];
+            dst[ x ] = sum;
+        }
+
+        /* the outputs of one phase share the weights, four of them are accumulated at once */
+        for( size_t j = 0; j < p; j++ ) {
+            size_t x = _xbegin + ( j + p - _xbegin % p ) % p;
+            if( x >= _xend )
+                continue;
+            size_t n = ( _xend - x + p - 1 ) / p;
+            const float* w = _pp.phaseWeights( j );
+            const float* s = src + _pp.first( x );
+            float* d = dst + x;
+            size_t i = 0;
+            for( ; i + 4 <= n; i += 4 ) {
+                const float* s0 = s + i * q;
+                float a0 = 0.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+                for( size_t t = 0; t < taps; t++ ) {
+                    a0 += w[ t ] * s0[ t ];
+                    a1 += w[ t ] * s0[ q + t ];
+                    a2 += w[ t ] * s0[ 2 * q + t ];
+                    a3 += w[ t ] * s0[ 3 * q + t ];
+                }
+                d[ i * p ] = a0;
+                d[ ( i + 1 ) * p ] = a1;
+                d[ ( i + 2 ) * p ] = a2;
+                d[ ( i + 3 ) * p ] = a3;
+            }
+            for( ; i < n; i++ ) {
+                float sum = 0.0f;
+                for( size_t t = 0; t < taps; t++ )
+                    sum += w[ t ] * s[ i * q + t ];
+                d[ i * p ] = sum;
+            }
+        }
+    }
+
+    inline void PyramidDownsampler::filterRow( size_t row )
+    {
+        const uint8_t* src = _src.data + row * _src.stride;
+        size_t slot = ( row % _pp.taps() ) * _rowstride;
+
+        if( _binomialU8 ) {
+            _simd->pyrdownHalfHorizontal_1u8_to_1u16( _ring16.ptr() + slot, src, _src.width );
+        } else if( _u8 ) {
+            _simd->Conv_u8_to_f( _tmp.ptr(), src, _src.width );
+            hfilter( _ring.ptr() + slot, _tmp.ptr() );
+        } else {
+            hfilter( _ring.ptr() + slot, ( const float* ) src );
+        }
+    }
+
+    inline void PyramidDownsampler::nextRow()
+    {
+        size_t need = required();
+        while( _filtered < need )
+            filterRow( _filtered++ );
+
+        size_t taps = _pp.taps();
+        int first = _pp.first( _next );
+        uint8_t* dst = _dst + _next * _dstride;
+
+        if( _binomialU8 ) {
+            uint16_t* rows[ 5 ];
+            for( size_t t = 0; t < 5; t++ )
+                rows[ t ] = _ring16.ptr() + ( sourceRow( first + ( int ) t ) % taps ) * _rowstride;
+            _simd->pyrdownHalfVertical_1u16_to_1u8( dst, rows, _dw );
+        } else {
+            const float* w = _pp.weights( _next );
+            float* acc = _u8 ? _tmp.ptr() : ( float* ) dst;
+            _simd->MulValue1f( acc, _ring.ptr() + ( sourceRow( first ) % taps ) * _rowstride, w[ 0 ], _dw );
+            for( size_t t = 1; t < taps; t++ )
+                _simd->MulAddValue1f( acc, _ring.ptr() + ( sourceRow( first + ( int ) t ) % taps ) * _rowstride, w[ t ], _dw );
+            if( _u8 )
+                _simd->Conv_f_to_u8( dst, acc, _dw );
+        }
+        _next++;
+    }
+
+    template<typename T>
+    static inline void _pyramidGradientRow( float* gx, float* gy, const T* prev, const T* cur, const T* next, size_t w, float scale )
+    {
+        if( w == 1 ) {
+            gx[ 0 ] = 0.0f;
+        } else {
+            gx[ 0 ] = scale * ( ( float ) cur[ 0 ] - ( float ) cur[ 1 ] );
+            for( size_t x = 1; x < w - 1; x++ )
+                gx[ x ] = scale * ( ( float ) cur[ x - 1 ] - ( float ) cur[ x + 1 ] );
+            gx[ w - 1 ] = scale * ( ( float ) cur[ w - 2 ] - ( float ) cur[ w - 1 ] );
+        }
+        for( size_t x = 0; x < w; x++ )
+            gy[ x ] = scale * ( ( float ) prev[ x ] - ( float ) next[ x ] );
+    }
+
+    /* gradient rows need the image rows above and below */
+    static void _pyramidGradients( PyramidOctave& o, bool u8 )
+    {
+        if( !o.gx )
+            return;
+        while( o.gradRows < o.height && ( o.gradRows + 1 < o.rows || o.rows == o.height ) ) {
+            size_t y = o.gradRows;
+            const uint8_t* cur = o.data + y * o.stride;
+            const uint8_t* prev = y ? cur - o.stride : cur;
+            const uint8_t* next = y + 1 < o.height ? cur + o.stride : cur;
+            float* gx = ( float* ) ( o.gx + y * o.gxstride );
+            float* gy = ( float* ) ( o.gy + y * o.gystride );
+            if( u8 )
+                _pyramidGradientRow<uint8_t>( gx, gy, prev, cur, next, o.width, 1.0f / 255.0f );
+            else
+                _pyramidGradientRow<float>( gx, gy, ( const float* ) prev, ( const float* ) cur, ( const float* ) next, o.width, 1.0f );
+            o.gradRows++;
+        }
+    }
+
+    void ImagePyramid::update( const Image& img, const IScaleFilter& sfilter )
+    {
+        CVT_PROFILE_SCOPE( "ImagePyramid::update" );
+        _image[ 0 ].reallocate( img );
+        _image[ 0 ] = img;
+        recompute( sfilter );
+    }
+
+    void ImagePyramid::updateFused( const Image& img )
+    {
+        CVT_PROFILE_SCOPE( "ImagePyramid::updateFused" );
+        fusedUpdate( img, NULL, NULL );
+    }
+
+    void ImagePyramid::updateFused( const Image& img, ImagePyramid& gradX, ImagePyramid& gradY )
+    {
+        CVT_PROFILE_SCOPE( "ImagePyramid::updateFused" );
+        fusedUpdate( img, &gradX, &gradY );
+    }
+
+    IConvertPath ImagePyramid::updateFused( const Image& img, const IFormat& format, IConvertFlags flags )
+    {
+        CVT_PROFILE_SCOPE( "ImagePyramid::updateFused" );
+        if( img.format() == format ) {
+            fusedUpdate( img, NULL, NULL );
+            return img.memType() == IALLOCATOR_MEM ? ICONVERT_PATH_SHARED : ICONVERT_PATH_COPY;
+        }
+
+        ConversionFunction func = IConvert::function( img.format(), format );
+        PyramidPolyphase pp;
+        if( !func || _image.size() < 2 || ( format != IFormat::GRAY_UINT8 && format != IFormat::GRAY_FLOAT ) || !pp.init( _scaleFactor ) ) {
+            Image tmp;
+            img.convert( tmp, format, flags );
+            fusedUpdate( tmp, NULL, NULL );
+            return ICONVERT_PATH_CHAINED;
+        }
+
+        _image[ 0 ].reallocate( img.width(), img.height(), format );
+        size_t sstride;
+        const uint8_t* sbase = img.map( &sstride );
+        IConvertRows rows( sbase, sstride, img, format, flags );
+        fusedUpdate( _image[ 0 ], NULL, NULL, func, &rows );
+        img.unmap( sbase );
+        return ICONVERT_PATH_FUSED;
+    }
+
+    void ImagePyramid::fusedUpdate( const Image& img, ImagePyramid* gradX, ImagePyramid* gradY,
+                                    ConversionFunction convert, const IConvertRows* rows )
+    {
+        if( gradX && ( gradX->octaves() != octaves() || gradY->octaves() != octaves() ) )
+            throw CVTException( "Gradient pyramids need the same number of octaves" );
+
+        /* with a conversion img is the zeroth octave itself, its rows are converted when octave 1 needs them */
+        if( !convert ) {
+            if( img.memType() == IALLOCATOR_MEM )
+                _image[ 0 ].reference( img );
+            else
+                _image[ 0 ] = img;
+        }
+
+        const IFormat& format = img.format();
+        bool u8 = ( format == IFormat::GRAY_UINT8 );
+        PyramidPolyphase pp;
+        if( ( !u8 && format != IFormat::GRAY_FLOAT ) || !pp.init( _scaleFactor ) ) {
+            recompute( IScaleFilterGauss() );
+            if( gradX ) {
+                Image tmp;
+                for( size_t i = 0; i < _image.size(); i++ ) {
+                    _image[ i ].convert( tmp, IFormat::floatEquivalent( format ) );
+                    ( *gradX )[ i ].reallocate( tmp );
+                    ( *gradY )[ i ].reallocate( tmp );
+                    tmp.convolve( ( *gradX )[ i ], IKernel::HAAR_HORIZONTAL_3 );
+                    tmp.convolve( ( *gradY )[ i ], IKernel::HAAR_VERTICAL_3 );
+                }
+            }
+            return;
+        }
+
+        float w = _image[ 0 ].width();
+        float h = _image[ 0 ].height();
+        for( size_t i = 1; i < _image.size(); i++ ) {
+            w *= _scaleFactor;
+            h *= _scaleFactor;
+            _image[ i ].reallocate( ( size_t ) w, ( size_t ) h, format );
+        }
+
+        size_t n = _image.size();
+        std::vector<PyramidOctave> octaves( n );
+        std::vector<uint8_t*> data( n );
+        for( size_t i = 0; i < n; i++ ) {
+            PyramidOctave& o = octaves[ i ];
+            if( i || convert )
+                o.data = data[ i ] = _image[ i ].map( &o.stride );
+            else
+                o.data = ( ( const Image& ) _image[ 0 ] ).map( &o.stride );
+            o.width = _image[ i ].width();
+            o.height = _image[ i ].height();
+            o.rows = ( n == 1 ) ? o.height : 0;
+            o.gx = o.gy = NULL;
+            o.gradRows = 0;
+            if( gradX ) {
+                ( *gradX )[ i ].reallocate( o.width, o.height, IFormat::GRAY_FLOAT );
+                ( *gradY )[ i ].reallocate( o.width, o.height, IFormat::GRAY_FLOAT );
+                o.gx = ( *gradX )[ i ].map( &o.gxstride );
+                o.gy = ( *gradY )[ i ].map( &o.gystride );
+            }
+        }
+
+        std::vector<PyramidDownsampler*> down( n );
+        for( size_t i = 1; i < n; i++ )
+            down[ i ] = new PyramidDownsampler( pp, octaves[ i - 1 ], data[ i ], octaves[ i ].stride, octaves[ i ].width, octaves[ i ].height, u8 );
+
+        /* every row of octave 1 advances all coarser octaves as far as their source rows allow */
+        size_t converted = convert ? 0 : octaves[ 0 ].height;
+        if( n > 1 ) {
+            while( !down[ 1 ]->done() ) {
+                size_t need = down[ 1 ]->required();
+                if( converted < need ) {
+                    size_t end = Math::min( Math::max( need, converted + CVT_PYRAMID_CONVERT_ROWS ), octaves[ 0 ].height );
+                    convert( data[ 0 ] + converted * octaves[ 0 ].stride, octaves[ 0 ].stride, *rows, converted, end );
+                    converted = end;
+                }
+                down[ 1 ]->nextRow();
+                octaves[ 0 ].rows = down[ 1 ]->filtered();
+                octaves[ 1 ].rows++;
+                _pyramidGradients( octaves[ 0 ], u8 );
+                _pyramidGradients( octaves[ 1 ], u8 );
+                for( size_t i = 2; i < n; i++ ) {
+                    while( !down[ i ]->done() && down[ i ]->required() <= octaves[ i - 1 ].rows ) {
+                        down[ i ]->nextRow();
+                        octaves[ i ].rows++;
+                        _pyramidGradients( octaves[ i ], u8 );
+                    }
+                }
+            }
+        }
+
+        if( converted < octaves[ 0 ].height )
+            convert( data[ 0 ] + converted * octaves[ 0 ].stride, octaves[ 0 ].stride, *rows, converted, octaves[ 0 ].height );
+
+        for( size_t i = 0; i < n; i++ ) {
+            if( i ) {
+                while( !down[ i ]->done() )
+                    down[ i ]->nextRow();
+                delete down[ i ];
+            }
+            octaves[ i ].rows = octaves[ i ].height;
+            _pyramidGradients( octaves[ i ], u8 );
+
+            _image[ i ].unmap( octaves[ i ].data );
+            if( gradX ) {
+                ( *gradX )[ i ].unmap( octaves[ i ].gx );
+                ( *gradY )[ i ].unmap( octaves[ i ].gy );
+            }
+        }
+    }
+
+}
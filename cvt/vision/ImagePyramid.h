@@ -47,6 +47,34 @@ namespace cvt
              */
             void update( const Image& img, const IScaleFilter& sfilter = IScaleFilterGauss() );
 
+            /**
+             * \brief update the pyramid without copying the input: pyr[ 0 ] references the memory of img
+             * \desc  GRAY_UINT8 and GRAY_FLOAT images are downsampled with fused kernels in a single
+             *        sweep that interleaves the rows of all octaves: a scale factor of 0.5 uses the
+             *        5-tap binomial of Image::pyrdown, rational factors p/q with q <= 10 (e.g. 0.6, 0.75)
+             *        use polyphase tables. Other formats and factors fall back to IScaleFilterGauss.
+             *        img must not be modified while the pyramid is in use.
+             * \param img the zeroth scale image, images that are not in memory are copied
+             */
+            void updateFused( const Image& img );
+
+            /**
+             * \brief updateFused( img ) that also computes the GRAY_FLOAT gradients of every octave in the same sweep
+             * \desc  the gradients are I( x - 1 ) - I( x + 1 ) like convolving with IKernel::HAAR_HORIZONTAL_3 and
+             *        HAAR_VERTICAL_3, with replicated border pixels. Gradients of GRAY_UINT8 pyramids are scaled by 1 / 255.
+             */
+            void updateFused( const Image& img, ImagePyramid& gradX, ImagePyramid& gradY );
+
+            /**
+             * \brief updateFused( img ) with the zeroth scale converted to format
+             * \desc  for GRAY_UINT8 and GRAY_FLOAT pyramids the rows of img are converted into the zeroth
+             *        scale by the same sweep that downsamples them, as soon as the first octave needs them.
+             *        Other formats convert img into an intermediate image first.
+             * \return ICONVERT_PATH_FUSED, ICONVERT_PATH_CHAINED or ICONVERT_PATH_SHARED if img already has the format
+             *        ( ICONVERT_PATH_COPY if img is not in memory )
+             */
+            IConvertPath updateFused( const Image& img, const IFormat& format, IConvertFlags flags = ICONVERT_DEBAYER_LINEAR );
+
             /**
              * \brief	returns number of octaves in the pyramid
              * \desc	we start counting at 0 for the highest (biggest) image
@@ -82,6 +110,9 @@ namespace cvt
 
             /* recompute the scale space from the first octave */
             void recompute( const IScaleFilter &sfilter );
+
+            void fusedUpdate( const Image& img, ImagePyramid* gradX, ImagePyramid* gradY,
+                              ConversionFunction convert = NULL, const IConvertRows* rows = NULL );
     };
 
     inline ImagePyramid::ImagePyramid( size_t octaves, float scaleFactor ) :
@@ -90,13 +121,6 @@ namespace cvt
         _image.resize( octaves );
     }
 
-    inline void ImagePyramid::update( const Image& img, const IScaleFilter& sfilter )
-    {
-        _image[ 0 ].reallocate( img );
-        _image[ 0 ] = img;
-        recompute( sfilter );
-    }
-
     inline void ImagePyramid::recompute(  const IScaleFilter& sfilter )
     {
         float w = _image[ 0 ].width();
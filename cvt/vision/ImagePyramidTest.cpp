@@ -27,6 +27,7 @@
 #include <cvt/util/CVTTest.h>
 #include <cvt/io/Resources.h>
 #include <cvt/gfx/IScaleFilter.h>
+#include <cvt/gfx/IMapScoped.h>
 
 using namespace cvt;
 
@@ -75,6 +76,187 @@ static bool _funcTest( const cvt::Image& img )
     return true;
 }
 
+static bool _sameImage( const Image& a, const Image& b )
+{
+    if( a.width() != b.width() || a.height() != b.height() || a.format() != b.format() )
+        return false;
+    IMapScoped<const uint8_t> ma( a );
+    IMapScoped<const uint8_t> mb( b );
+    for( size_t y = 0; y < a.height(); y++ ) {
+        if( memcmp( ma.ptr(), mb.ptr(), a.width() * a.bpp() ) )
+            return false;
+        ma++;
+        mb++;
+    }
+    return true;
+}
+
+static bool _fusedBinomialTest( const Image& gray )
+{
+    ImagePyramid pyr( 3, 0.5f );
+    pyr.updateFused( gray );
+
+    size_t s0, s1;
+    const uint8_t* p0 = gray.map( &s0 );
+    const uint8_t* p1 = pyr[ 0 ].map( &s1 );
+    bool shared = ( p0 == p1 );
+    pyr[ 0 ].unmap( p1 );
+    gray.unmap( p0 );
+    CVTTEST_PRINT( "fused: octave 0 references the input", shared );
+
+    Image down1, down2;
+    gray.pyrdown( down1 );
+    down1.pyrdown( down2 );
+    bool b = _sameImage( pyr[ 1 ], down1 ) && _sameImage( pyr[ 2 ], down2 );
+    CVTTEST_PRINT( "fused 0.5 GRAY_UINT8 == Image::pyrdown", b );
+    return shared && b;
+}
+
+/* the binomial maps x to 2 * x + 1 in the finer octave, the polyphase kernels map pixel centers */
+static float _fineCoord( float x, float scale )
+{
+    if( scale == 0.5f )
+        return 2.0f * x + 1.0f;
+    return ( x + 0.5f ) / scale - 0.5f;
+}
+
+static bool _fusedRampTest( float scale )
+{
+    const size_t w = 161, h = 97;
+    Image ramp( w, h, IFormat::GRAY_FLOAT );
+    {
+        IMapScoped<float> map( ramp );
+        for( size_t y = 0; y < h; y++ ) {
+            float* p = map.ptr();
+            for( size_t x = 0; x < w; x++ )
+                p[ x ] = 0.002f * x + 0.003f * y;
+            map++;
+        }
+    }
+
+    ImagePyramid pyr( 3, scale );
+    pyr.updateFused( ramp );
+
+    bool b = true;
+    for( size_t l = 1; l < pyr.octaves(); l++ ) {
+        IMapScoped<const float> map( pyr[ l ] );
+        for( size_t y = 6; y + 6 < pyr[ l ].height(); y++ ) {
+            for( size_t x = 6; x + 6 < pyr[ l ].width(); x++ ) {
+                float x0 = x, y0 = y;
+                for( size_t k = 0; k < l; k++ ) {
+                    x0 = _fineCoord( x0, scale );
+                    y0 = _fineCoord( y0, scale );
+                }
+                b &= Math::abs( map( x, y ) - ( 0.002f * x0 + 0.003f * y0 ) ) < 1e-4f;
+            }
+        }
+    }
+    return b;
+}
+
+/* the rounding of every GRAY_UINT8 octave adds up to half a gray value */
+static bool _fusedU8Test( const Image& gray, float scale )
+{
+    Image grayf;
+    gray.convert( grayf, IFormat::GRAY_FLOAT );
+
+    ImagePyramid pyr( 4, scale );
+    ImagePyramid pyrf( 4, scale );
+    pyr.updateFused( gray );
+    pyrf.updateFused( grayf );
+
+    bool b = true;
+    for( size_t l = 1; l < pyr.octaves(); l++ ) {
+        IMapScoped<const uint8_t> m( pyr[ l ] );
+        IMapScoped<const float> mf( pyrf[ l ] );
+        for( size_t y = 0; y < pyr[ l ].height(); y++ ) {
+            const uint8_t* p = m.ptr();
+            const float* pf = mf.ptr();
+            for( size_t x = 0; x < pyr[ l ].width(); x++ )
+                b &= Math::abs( p[ x ] / 255.0f - pf[ x ] ) < ( 0.5f * l + 0.01f ) / 255.0f;
+            m++;
+            mf++;
+        }
+    }
+    return b;
+}
+
+static bool _compareInterior( const Image& a, const Image& b, float scale )
+{
+    IMapScoped<const float> ma( a );
+    IMapScoped<const float> mb( b );
+    bool ret = true;
+    for( size_t y = 1; y + 1 < a.height(); y++ ) {
+        for( size_t x = 1; x + 1 < a.width(); x++ )
+            ret &= Math::abs( ma( x, y ) - scale * mb( x, y ) ) < 1e-5f;
+    }
+    return ret;
+}
+
+static bool _fusedGradientTest( const Image& img, float scale )
+{
+    ImagePyramid pyr( 3, scale );
+    ImagePyramid gx( 3, scale );
+    ImagePyramid gy( 3, scale );
+    pyr.updateFused( img, gx, gy );
+
+    bool b = true;
+    for( size_t l = 0; l < pyr.octaves(); l++ ) {
+        Image f, dx, dy;
+        pyr[ l ].convert( f, IFormat::GRAY_FLOAT );
+        dx.reallocate( f );
+        dy.reallocate( f );
+        f.convolve( dx, IKernel::HAAR_HORIZONTAL_3 );
+        f.convolve( dy, IKernel::HAAR_VERTICAL_3 );
+        b &= gx[ l ].format() == IFormat::GRAY_FLOAT && gx[ l ].width() == f.width() && gy[ l ].height() == f.height();
+        b &= _compareInterior( gx[ l ], dx, 1.0f );
+        b &= _compareInterior( gy[ l ], dy, 1.0f );
+    }
+    return b;
+}
+
+static bool _fusedFallbackTest( const Image& img )
+{
+    ImagePyramid pyr( 3, 0.5f );
+    ImagePyramid ref( 3, 0.5f );
+    pyr.updateFused( img );
+    ref.update( img );
+
+    bool b = true;
+    for( size_t l = 0; l < pyr.octaves(); l++ )
+        b &= _sameImage( pyr[ l ], ref[ l ] );
+    return b;
+}
+
+/* converting into the zeroth octave during the sweep gives the same pyramid as converting first */
+static bool _fusedConvertTest( const IFormat& format, float scale )
+{
+    Image bayer( 320, 243, IFormat::BAYER_RGGB_UINT8 );
+    {
+        IMapScoped<uint8_t> map( bayer );
+        for( size_t y = 0; y < bayer.height(); y++ ) {
+            for( size_t x = 0; x < bayer.width(); x++ )
+                map.ptr()[ x ] = ( uint8_t ) Math::rand( 0, 255 );
+            map++;
+        }
+    }
+
+    Image gray;
+    bayer.convert( gray, format );
+    ImagePyramid pyr( 4, scale );
+    ImagePyramid ref( 4, scale );
+    bool b = pyr.updateFused( bayer, format ) == ICONVERT_PATH_FUSED;
+    ref.updateFused( gray );
+    for( size_t l = 0; l < pyr.octaves(); l++ )
+        b &= _sameImage( pyr[ l ], ref[ l ] );
+
+    /* a second update reuses the zeroth octave without touching the previous input */
+    b &= pyr.updateFused( gray, format ) == ICONVERT_PATH_SHARED;
+    b &= pyr.updateFused( bayer, format ) == ICONVERT_PATH_FUSED;
+    b &= _sameImage( pyr[ 0 ], gray );
+    return b;
+}
+
 BEGIN_CVTTEST( ImagePyramid )
 
 cvt::Resources resources;
@@ -103,6 +285,33 @@ b = _funcTest( lenagf );
 CVTTEST_PRINT( "apply(...)", b );
 result &= b;
 
+cvt::Image lenag;
+lena.convert( lenag, IFormat::GRAY_UINT8 );
+
+b = _fusedBinomialTest( lenag );
+result &= b;
+
+b = _fusedRampTest( 0.5f ) && _fusedRampTest( 0.75f ) && _fusedRampTest( 0.6f );
+CVTTEST_PRINT( "fused GRAY_FLOAT ramp 0.5 / 0.75 / 0.6", b );
+result &= b;
+
+b = _fusedU8Test( lenag, 0.75f ) && _fusedU8Test( lenag, 0.6f );
+CVTTEST_PRINT( "fused GRAY_UINT8 == GRAY_FLOAT 0.75 / 0.6", b );
+result &= b;
+
+b = _fusedGradientTest( lenagf, 0.75f ) && _fusedGradientTest( lenag, 0.5f ) && _fusedGradientTest( lenag, 0.6f );
+CVTTEST_PRINT( "fused gradients", b );
+result &= b;
+
+b = _fusedConvertTest( IFormat::GRAY_UINT8, 0.5f ) && _fusedConvertTest( IFormat::GRAY_FLOAT, 0.75f )
+    && _fusedConvertTest( IFormat::GRAY_UINT8, 0.6f );
+CVTTEST_PRINT( "fused conversion into octave 0", b );
+result &= b;
+
+b = _fusedFallbackTest( lena );
+CVTTEST_PRINT( "fused fallback for RGBA", b );
+result &= b;
+
 return result;
 
 END_CVTTEST
@@ -0,0 +1,574 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_KLT_BATCH_H
+#define CVT_KLT_BATCH_H
+
+#include <cvt/vision/KLTPatch.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/Exception.h>
+
+namespace cvt
+{
+    /**
+     *  \class KLTBatch
+     *  \brief Contiguous storage of many KLT patches that are tracked together
+     *
+     *  Templates, jacobians (one column per parameter) and inverse hessians of
+     *  all patches and octaves are stored in flat arrays. align() runs the
+     *  inverse compositional iterations of a batch of patches in lockstep: all
+     *  patches that need a new evaluation are warped with a single
+     *  interpolation call. Batches are distributed over the ThreadPool.
+     *  The result for each patch is the same as for KLTPatch::align.
+     */
+    template <size_t pSize, class PoseType>
+    class KLTBatch
+    {
+        public:
+            typedef KLTPatch<pSize, PoseType>                                  PatchType;
+            typedef Eigen::Matrix<float, PoseType::NPARAMS, PoseType::NPARAMS> HessType;
+            typedef Eigen::Matrix<float, PoseType::NPARAMS, 1>                 JacType;
+            typedef Eigen::Matrix<float, 2, PoseType::NPARAMS>                 ScreenJacType;
+            static const size_t PatchSize = pSize;
+            static const size_t NumPixels = pSize * pSize;
+            static const size_t NumParams = PoseType::NPARAMS;
+
+            KLTBatch( size_t batchSize = 32 );
+
+            /**
+             *  \brief extract a new patch at pos from all octaves of the pyramid
+             *  \return false, if the patch is too close to the border or has no texture
+             */
+            bool            add( const ImagePyramid& pyrImg,
+                                 const ImagePyramid& pyrGx,
+                                 const ImagePyramid& pyrGy,
+                                 const Vector2f& pos );
+
+            void            clear();
+            size_t          size()      const { return _poses.size(); }
+            size_t          numScales() const { return _octaves; }
+
+            PoseType&       pose( size_t idx )             { return _poses[ idx ]; }
+            const PoseType& pose( size_t idx )       const { return _poses[ idx ]; }
+            void            initPose( size_t idx, const Vector2f& pos );
+            void            currentCenter( size_t idx, Vector2f& center ) const;
+
+            const float*    pixels( size_t idx, size_t octave = 0 ) const { return &_templates[ ( idx * _octaves + octave ) * NumPixels ]; }
+            const float*    transformed( size_t idx )               const { return &_transformed[ idx * NumPixels ]; }
+            const HessType& inverseHessian( size_t idx, size_t octave = 0 ) const { return _inverseHessians[ idx * _octaves + octave ]; }
+
+            /**
+             *  \brief track the patches through the pyramid
+             *  \param success  set to 1 for every successfully aligned patch
+             *  \param indices  patches to track (each index at most once)
+             */
+            void            align( std::vector<uint8_t>& success,
+                                   const std::vector<size_t>& indices,
+                                   const ImagePyramid& pyramid,
+                                   size_t maxIters = 2 );
+
+        private:
+            typedef std::vector<float, Eigen::aligned_allocator<float> >       FloatVec;
+            typedef std::vector<HessType, Eigen::aligned_allocator<HessType> > HessVec;
+            typedef std::vector<PoseType, Eigen::aligned_allocator<PoseType> > PoseVec;
+            typedef std::vector<ScreenJacType, Eigen::aligned_allocator<ScreenJacType> > ScreenJacVec;
+
+            struct OctaveImage {
+                const float*    ptr;
+                size_t          stride;
+                size_t          width;
+                size_t          height;
+            };
+
+            struct AlignState {
+                Matrix3f                                poseSave;
+                Matrix3f                                pose;
+                JacType                                 jSum;
+                typename PoseType::ParameterVectorType  delta;
+                float                                   diffSum;
+                float                                   newError;
+                size_t                                  iter;
+                bool                                    active;
+                bool                                    success;
+                bool                                    needsDelta;
+
+                EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+            };
+            typedef std::vector<AlignState, Eigen::aligned_allocator<AlignState> > StateVec;
+
+            class AlignBody
+            {
+                public:
+                    AlignBody( KLTBatch& batch, uint8_t* success, const size_t* indices,
+                               const std::vector<OctaveImage>& images, float scaleFactor, size_t maxIters ) :
+                        _batch( batch ), _success( success ), _indices( indices ),
+                        _images( images ), _scaleFactor( scaleFactor ), _maxIters( maxIters )
+                    {
+                    }
+
+                    void operator()( size_t begin, size_t end ) const
+                    {
+                        _batch.alignPyramid( _success + begin, _indices + begin, end - begin,
+                                             _images, _scaleFactor, _maxIters );
+                    }
+
+                private:
+                    KLTBatch&                       _batch;
+                    uint8_t*                        _success;
+                    const size_t*                   _indices;
+                    const std::vector<OctaveImage>& _images;
+                    float                           _scaleFactor;
+                    size_t                          _maxIters;
+            };
+
+            size_t          _batchSize;
+            size_t          _octaves;
+            PoseVec         _poses;
+            FloatVec        _templates;
+            FloatVec        _jacobians;
+            FloatVec        _transformed;
+            HessVec         _inverseHessians;
+
+            static ScreenJacVec ScreenJacobiansAtIdentity;
+            static ScreenJacVec initScreenJacobians();
+
+            float*          jacobians( size_t idx, size_t octave )       { return &_jacobians[ ( idx * _octaves + octave ) * NumParams * NumPixels ]; }
+            const float*    jacobians( size_t idx, size_t octave ) const { return &_jacobians[ ( idx * _octaves + octave ) * NumParams * NumPixels ]; }
+
+            bool            updateOctave( size_t idx, size_t octave,
+                                          const IMapScoped<const float>& iMap,
+                                          const IMapScoped<const float>& gxMap,
+                                          const IMapScoped<const float>& gyMap,
+                                          const Vector2f& pos, size_t w, size_t h );
+
+            void            alignPyramid( uint8_t* success, const size_t* indices, size_t n,
+                                          const std::vector<OctaveImage>& images, float scaleFactor, size_t maxIters );
+            void            alignOctave( StateVec& states, const size_t* indices, size_t n,
+                                         const OctaveImage& image, size_t octave, size_t maxIters );
+            void            evaluate( StateVec& states, const size_t* indices, const std::vector<size_t>& scheduled,
+                                      std::vector<Vector2f>& warped, FloatVec& values,
+                                      const OctaveImage& image, size_t octave );
+            float           buildSystem( JacType& jSum, const float* J, const float* r ) const;
+
+            static bool     patchIsInImage( const Matrix3f& pose, size_t w, size_t h );
+    };
+
+    template <size_t pSize, class PoseType>
+    typename KLTBatch<pSize, PoseType>::ScreenJacVec KLTBatch<pSize, PoseType>::ScreenJacobiansAtIdentity( KLTBatch<pSize, PoseType>::initScreenJacobians() );
+
+    template <size_t pSize, class PoseType>
+    inline typename KLTBatch<pSize, PoseType>::ScreenJacVec KLTBatch<pSize, PoseType>::initScreenJacobians()
+    {
+        // same point layout as KLTPatch::patchPoints(), which may not be
+        // initialized yet during static initialization
+        PoseType pose;
+        ScreenJacVec jacobians( NumPixels );
+        Eigen::Vector2f p;
+        float half = pSize >> 1;
+        for( size_t i = 0; i < NumPixels; ++i ){
+            p[ 0 ] = ( float )( i % pSize ) - half;
+            p[ 1 ] = ( float )( i / pSize ) - half;
+            pose.screenJacobian( jacobians[ i ], p );
+        }
+        return jacobians;
+    }
+
+    template <size_t pSize, class PoseType>
+    inline KLTBatch<pSize, PoseType>::KLTBatch( size_t batchSize ) :
+        _batchSize( batchSize ),
+        _octaves( 0 )
+    {
+    }
+
+    template <size_t pSize, class PoseType>
+    inline void KLTBatch<pSize, PoseType>::clear()
+    {
+        _octaves = 0;
+        _poses.clear();
+        _templates.clear();
+        _jacobians.clear();
+        _transformed.clear();
+        _inverseHessians.clear();
+    }
+
+    template <size_t pSize, class PoseType>
+    inline void KLTBatch<pSize, PoseType>::initPose( size_t idx, const Vector2f& pos )
+    {
+        Matrix3f m;
+        m.setIdentity();
+        m[ 0 ][ 2 ] = pos.x;
+        m[ 1 ][ 2 ] = pos.y;
+        _poses[ idx ].set( m );
+    }
+
+    template <size_t pSize, class PoseType>
+    inline void KLTBatch<pSize, PoseType>::currentCenter( size_t idx, Vector2f& center ) const
+    {
+        const Eigen::Matrix3f& tmp = _poses[ idx ].transformation();
+        center.x = tmp( 0, 2 );
+        center.y = tmp( 1, 2 );
+    }
+
+    template <size_t pSize, class PoseType>
+    inline bool KLTBatch<pSize, PoseType>::add( const ImagePyramid& pyr,
+                                                const ImagePyramid& gradX,
+                                                const ImagePyramid& gradY,
+                                                const Vector2f& pos )
+    {
+        if( size() == 0 )
+            _octaves = pyr.octaves();
+        else if( _octaves != pyr.octaves() )
+            throw CVTException( "Number of octaves does not match the stored patches" );
+
+        size_t idx = size();
+        size_t phalf = pSize >> 1;
+
+        // make room for the new patch
+        _poses.push_back( PoseType() );
+        _templates.resize( ( idx + 1 ) * _octaves * NumPixels );
+        _jacobians.resize( ( idx + 1 ) * _octaves * NumParams * NumPixels );
+        _transformed.resize( ( idx + 1 ) * NumPixels );
+        _inverseHessians.resize( ( idx + 1 ) * _octaves );
+
+        float scale = Math::pow( pyr.scaleFactor(), ( float )_octaves - 1 );
+        bool isGood = true;
+        for( int o = _octaves - 1; o >= 0; o-- ){
+            Vector2f octavePos = pos * scale;
+            int x = octavePos.x;
+            int y = octavePos.y;
+
+            size_t w = pyr[ o ].width();
+            size_t h = pyr[ o ].height();
+
+            if( x < ( int )phalf + 1 || ( x + phalf + 1 ) >= w ||
+                y < ( int )phalf + 1 || ( y + phalf + 1 ) >= h ){
+                isGood = false;
+                break;
+            }
+
+            IMapScoped<const float> iMap( pyr[ o ] );
+            IMapScoped<const float> gxMap( gradX[ o ] );
+            IMapScoped<const float> gyMap( gradY[ o ] );
+            if( !updateOctave( idx, o, iMap, gxMap, gyMap, octavePos, w, h ) ){
+                isGood = false;
+                break;
+            }
+            scale /= pyr.scaleFactor();
+        }
+
+        if( !isGood ){
+            _poses.pop_back();
+            _templates.resize( idx * _octaves * NumPixels );
+            _jacobians.resize( idx * _octaves * NumParams * NumPixels );
+            _transformed.resize( idx * NumPixels );
+            _inverseHessians.resize( idx * _octaves );
+            return false;
+        }
+
+        initPose( idx, pos );
+        return true;
+    }
+
+    template <size_t pSize, class PoseType>
+    inline bool KLTBatch<pSize, PoseType>::updateOctave( size_t idx, size_t octave,
+                                                         const IMapScoped<const float>& iMap,
+                                                         const IMapScoped<const float>& gxMap,
+                                                         const IMapScoped<const float>& gyMap,
+                                                         const Vector2f& pos, size_t w, size_t h )
+    {
+        const float pHalf = ( pSize >> 1 );
+
+        if( pos.x < pHalf || ( pos.x > w - pHalf - 1 ) ||
+            pos.y < pHalf || ( pos.y > h - pHalf - 1 ) )
+            return false;
+
+        size_t stride = iMap.stride() / sizeof( float );
+        size_t offset = ( int )( pos.y - pHalf ) * stride + ( int )( pos.x - pHalf );
+
+        const float* iptr = iMap.ptr() + offset;
+        const float* gxptr = gxMap.ptr() + offset;
+        const float* gyptr = gyMap.ptr() + offset;
+
+        float* p = &_templates[ ( idx * _octaves + octave ) * NumPixels ];
+        float* J = jacobians( idx, octave );
+        const ScreenJacType* sj = &ScreenJacobiansAtIdentity[ 0 ];
+
+        JacType j;
+        HessType hess( HessType::Zero() );
+        size_t i = 0;
+        for( size_t y = 0; y < pSize; y++ ){
+            for( size_t x = 0; x < pSize; x++, i++ ){
+                p[ i ] = iptr[ x ];
+                j = sj[ i ].row( 0 ).transpose() * gxptr[ x ] + sj[ i ].row( 1 ).transpose() * gyptr[ x ];
+                hess.noalias() += j * j.transpose();
+                for( size_t k = 0; k < NumParams; k++ )
+                    J[ k * NumPixels + i ] = j[ k ];
+            }
+            iptr  += stride;
+            gxptr += stride;
+            gyptr += stride;
+        }
+
+        if( octave == 0 )
+            SIMD::instance()->Memcpy( ( uint8_t* )&_transformed[ idx * NumPixels ], ( const uint8_t* )p, NumPixels * sizeof( float ) );
+
+        float det = hess.determinant();
+        if( Math::abs( det ) > 1e-5 ){
+            _inverseHessians[ idx * _octaves + octave ] = hess.inverse();
+            return true;
+        }
+        return false;
+    }
+
+    template <size_t pSize, class PoseType>
+    inline void KLTBatch<pSize, PoseType>::align( std::vector<uint8_t>& success,
+                                                  const std::vector<size_t>& indices,
+                                                  const ImagePyramid& pyramid,
+                                                  size_t maxIters )
+    {
+        success.resize( indices.size() );
+        if( indices.empty() )
+            return;
+
+        if( maxIters == 0 ){
+            for( size_t i = 0; i < success.size(); i++ )
+                success[ i ] = 1;
+            return;
+        }
+
+        CVT_ASSERT( pyramid[ 0 ].format() == IFormat::GRAY_FLOAT, "Format must be GRAY_FLOAT!" );
+        if( pyramid.octaves() != _octaves )
+            throw CVTException( "Number of octaves does not match the stored patches" );
+
+        std::vector<IMapScoped<const float>*> maps( _octaves );
+        std::vector<OctaveImage> images( _octaves );
+        for( size_t o = 0; o < _octaves; o++ ){
+            maps[ o ] = new IMapScoped<const float>( pyramid[ o ] );
+            images[ o ].ptr = maps[ o ]->ptr();
+            images[ o ].stride = maps[ o ]->stride();
+            images[ o ].width = pyramid[ o ].width();
+            images[ o ].height = pyramid[ o ].height();
+        }
+
+        AlignBody body( *this, &success[ 0 ], &indices[ 0 ], images, pyramid.scaleFactor(), maxIters );
+        parallelFor( 0, indices.size(), body, _batchSize );
+
+        for( size_t o = 0; o < _octaves; o++ )
+            delete maps[ o ];
+    }
+
+    template <size_t pSize, class PoseType>
+    inline void KLTBatch<pSize, PoseType>::alignPyramid( uint8_t* success, const size_t* indices, size_t n,
+                                                         const std::vector<OctaveImage>& images,
+                                                         float scaleFactor, size_t maxIters )
+    {
+        float scale = Math::pow( scaleFactor, ( float )_octaves - 1 );
+        float invScale = 1.0f / scaleFactor;
+
+        StateVec states( n );
+        PoseVec  backup( n );
+
+        Matrix3f poseMat;
+        for( size_t i = 0; i < n; i++ ){
+            PoseType& pose = _poses[ indices[ i ] ];
+            EigenBridge::toCVT( poseMat, pose.transformation() );
+            poseMat[ 0 ][ 2 ] *= scale;
+            poseMat[ 1 ][ 2 ] *= scale;
+
+            backup[ i ] = pose;
+            pose.set( poseMat );
+        }
+
+        for( int oc = _octaves - 1; oc >= 0; --oc ){
+            alignOctave( states, indices, n, images[ oc ], oc, maxIters );
+
+            for( size_t i = 0; i < n; i++ ){
+                PoseType& pose = _poses[ indices[ i ] ];
+                if( !states[ i ].success )
+                    pose.transformation() = backup[ i ].transformation();
+
+                if( oc != 0 ){
+                    EigenBridge::toCVT( poseMat, pose.transformation() );
+                    poseMat[ 0 ][ 2 ] *= invScale;
+                    poseMat[ 1 ][ 2 ] *= invScale;
+                    pose.set( poseMat );
+                    backup[ i ].transformation() = pose.transformation();
+                }
+            }
+        }
+
+        for( size_t i = 0; i < n; i++ )
+            success[ i ] = states[ i ].success ? 1 : 0;
+    }
+
+    template <size_t pSize, class PoseType>
+    inline void KLTBatch<pSize, PoseType>::alignOctave( StateVec& states, const size_t* indices, size_t n,
+                                                        const OctaveImage& image, size_t octave, size_t maxIters )
+    {
+        std::vector<size_t> scheduled;
+        std::vector<Vector2f> warped( n * NumPixels );
+        FloatVec values( n * NumPixels );
+        scheduled.reserve( n );
+
+        // initial evaluation of all patches that are within the image
+        for( size_t i = 0; i < n; i++ ){
+            AlignState& s = states[ i ];
+            EigenBridge::toCVT( s.pose, _poses[ indices[ i ] ].transformation() );
+            s.poseSave = s.pose;
+            s.iter = 0;
+            s.success = false;
+            s.active = patchIsInImage( s.pose, image.width, image.height );
+            if( s.active )
+                scheduled.push_back( i );
+        }
+        evaluate( states, indices, scheduled, warped, values, image, octave );
+
+        for( size_t k = 0; k < scheduled.size(); k++ ){
+            size_t i = scheduled[ k ];
+            AlignState& s = states[ i ];
+            s.jSum.setZero();
+            s.diffSum = buildSystem( s.jSum, jacobians( indices[ i ], octave ), &values[ k * NumPixels ] );
+            s.needsDelta = true;
+        }
+
+        size_t numActive = scheduled.size();
+        while( numActive ){
+            // advance every active patch to its next candidate pose
+            scheduled.clear();
+            for( size_t i = 0; i < n; i++ ){
+                AlignState& s = states[ i ];
+                if( !s.active )
+                    continue;
+
+                PoseType& pose = _poses[ indices[ i ] ];
+                if( s.needsDelta ){
+                    s.delta = inverseHessian( indices[ i ], octave ) * s.jSum;
+                    s.newError = s.diffSum + 1.0f;
+                    s.needsDelta = false;
+                }
+
+                while( s.active ){
+                    if( Math::abs( s.delta.array().maxCoeff() ) < 1e-6 ){
+                        s.active = false;
+                        s.success = true;
+                        numActive--;
+                        break;
+                    }
+
+                    EigenBridge::toEigen( pose.transformation(), s.poseSave );
+                    pose.applyInverse( -s.delta );
+                    EigenBridge::toCVT( s.pose, pose.transformation() );
+
+                    if( patchIsInImage( s.pose, image.width, image.height ) ){
+                        scheduled.push_back( i );
+                        break;
+                    }
+                    s.delta *= 0.5f;
+                }
+            }
+
+            // warp all candidates at once
+            evaluate( states, indices, scheduled, warped, values, image, octave );
+
+            SIMD* simd = SIMD::instance();
+            for( size_t k = 0; k < scheduled.size(); k++ ){
+                size_t i = scheduled[ k ];
+                AlignState& s = states[ i ];
+                const float* r = &values[ k * NumPixels ];
+
+                s.newError = simd->sumSqr( r, NumPixels );
+                s.delta *= 0.5f;
+                if( s.newError > s.diffSum )
+                    continue;
+
+                // step accepted
+                s.poseSave = s.pose;
+                s.jSum.setZero();
+                s.diffSum = buildSystem( s.jSum, jacobians( indices[ i ], octave ), r );
+                s.iter++;
+                if( s.iter >= maxIters ){
+                    s.active = false;
+                    s.success = true;
+                    numActive--;
+                } else {
+                    s.needsDelta = true;
+                }
+            }
+        }
+    }
+
+    template <size_t pSize, class PoseType>
+    inline void KLTBatch<pSize, PoseType>::evaluate( StateVec& states, const size_t* indices,
+                                                     const std::vector<size_t>& scheduled,
+                                                     std::vector<Vector2f>& warped, FloatVec& values,
+                                                     const OctaveImage& image, size_t octave )
+    {
+        if( scheduled.empty() )
+            return;
+
+        SIMD* simd = SIMD::instance();
+        size_t num = scheduled.size();
+        for( size_t k = 0; k < num; k++ )
+            simd->transformPoints( &warped[ k * NumPixels ], states[ scheduled[ k ] ].pose, PatchType::patchPoints(), NumPixels );
+
+        simd->warpBilinear1f( &values[ 0 ], &warped[ 0 ].x, image.ptr, image.stride, image.width, image.height, 2.0f, num * NumPixels );
+
+        // keep the warped patch and turn the values into residuals
+        for( size_t k = 0; k < num; k++ ){
+            size_t idx = indices[ scheduled[ k ] ];
+            float* v = &values[ k * NumPixels ];
+            simd->Memcpy( ( uint8_t* )&_transformed[ idx * NumPixels ], ( const uint8_t* )v, NumPixels * sizeof( float ) );
+            simd->Sub( v, v, pixels( idx, octave ), NumPixels );
+        }
+    }
+
+    template <size_t pSize, class PoseType>
+    inline float KLTBatch<pSize, PoseType>::buildSystem( JacType& jSum, const float* J, const float* r ) const
+    {
+        SIMD* simd = SIMD::instance();
+        for( size_t k = 0; k < NumParams; k++ )
+            jSum[ k ] += simd->dot( J + k * NumPixels, r, NumPixels );
+        return simd->sumSqr( r, NumPixels );
+    }
+
+    template <size_t pSize, class PoseType>
+    inline bool KLTBatch<pSize, PoseType>::patchIsInImage( const Matrix3f& pose, size_t w, size_t h )
+    {
+        static const float half = pSize >> 1;
+        const Vector2f corners[ 4 ] = { Vector2f( -half, -half ), Vector2f( half, -half ),
+                                        Vector2f(  half,  half ), Vector2f( -half, half ) };
+
+        Vector2f pWarped;
+        for( size_t i = 0; i < 4; i++ ){
+            pWarped = pose * corners[ i ];
+            if( pWarped.x < 0.0f || pWarped.x >= w ||
+                pWarped.y < 0.0f || pWarped.y >= h )
+                return false;
+        }
+        return true;
+    }
+}
+
+#endif
@@ -23,6 +23,7 @@
 */
 
 #include <cvt/vision/KLTPatch.h>
+#include <cvt/vision/KLTBatch.h>
 #include <cvt/util/CVTTest.h>
 #include <cvt/io/Resources.h>
 
@@ -113,6 +114,64 @@ static bool _trackPatch( const ImagePyramid& gray,
     return true;
 }
 
+template<class PoseType>
+static bool _trackBatch( const ImagePyramid& gray,
+                         const ImagePyramid& gx,
+                         const ImagePyramid& gy )
+{
+    typedef KLTPatch<16, PoseType> Patch;
+    typedef KLTBatch<16, PoseType> Batch;
+
+    std::vector<Vector2f> positions;
+    for( size_t y = 60; y < 460; y += 37 )
+        for( size_t x = 60; x < 460; x += 41 )
+            positions.push_back( Vector2f( x, y ) );
+
+    Batch batch( 8 );
+    std::vector<Patch*> patches;
+    std::vector<size_t> indices;
+    std::vector<Vector2f> initial;
+    for( size_t i = 0; i < positions.size(); i++ ){
+        Patch* p = new Patch( gray.octaves() );
+        bool ok = p->update( gray, gx, gy, positions[ i ] );
+        if( ok != batch.add( gray, gx, gy, positions[ i ] ) ){
+            std::cout << "Batch and patch extraction differ at " << positions[ i ] << std::endl;
+            delete p;
+            return false;
+        }
+        if( !ok ){
+            delete p;
+            continue;
+        }
+        indices.push_back( patches.size() );
+        patches.push_back( p );
+        initial.push_back( positions[ i ] + Vector2f( Math::rand( -6.0f, 6.0f ), Math::rand( -6.0f, 6.0f ) ) );
+    }
+
+    for( size_t i = 0; i < patches.size(); i++ ){
+        patches[ i ]->initPose( initial[ i ] );
+        batch.initPose( i, initial[ i ] );
+    }
+
+    std::vector<uint8_t> success;
+    batch.align( success, indices, gray, 5 );
+
+    bool result = indices.size() > 0;
+    Vector2f cPatch, cBatch;
+    for( size_t i = 0; i < patches.size(); i++ ){
+        bool ok = patches[ i ]->align( gray, 5 );
+        patches[ i ]->currentCenter( cPatch );
+        batch.currentCenter( i, cBatch );
+        if( ok != ( success[ i ] != 0 ) || ( cPatch - cBatch ).length() > 1e-3f ){
+            std::cout << "Patch: " << cPatch << " Batch: " << cBatch << std::endl;
+            result = false;
+        }
+        delete patches[ i ];
+    }
+
+    return result;
+}
+
 BEGIN_CVTTEST( KLTPatch )
 
 Resources resources;
@@ -163,6 +222,10 @@ b = _trackPatch<GA2<float> >( pyrf, gx, gy );
 CVTTEST_PRINT( "2D General Affine Test: ", b );
 result &= b;
 
+b = _trackBatch<GA2<float> >( pyrf, gx, gy );
+CVTTEST_PRINT( "Batched tracking matches single patches: ", b );
+result &= b;
+
 return result;
 
 END_CVTTEST
@@ -23,6 +23,7 @@
 */
 
 #include <cvt/vision/PMHuberStereo.h>
+#include <cvt/vision/PatchMatchStereo.h>
 #include <cvt/util/Exception.h>
 #include <cvt/cl/CLBuffer.h>
 #include <cvt/cl/kernel/pmhstereo.h>
@@ -63,6 +64,15 @@ namespace cvt {
 
 	void PMHuberStereo::depthMap( Image& dmap, const Image& left, const Image& right, size_t patchsize, float depthmax, size_t iterations, size_t viewsamples, float dscale, Image* normalmap )
 	{
+		/* images in host memory run on the CPU engine, without the Huber smoothing term */
+		if( left.memType() != IALLOCATOR_CL && right.memType() != IALLOCATOR_CL ) {
+			PatchMatchStereo pm;
+			pm.init( left, right, patchsize, depthmax, viewsamples );
+			pm.iterate( iterations );
+			pm.depthMap( dmap, dscale, normalmap );
+			return;
+		}
+
 		if( left.width() != right.width() || left.height() != right.height() ||
 		    left.memType() != IALLOCATOR_CL || right.memType() != IALLOCATOR_CL )
 			throw CVTException( "Left/Right stereo images inconsistent or incompatible memory type" );
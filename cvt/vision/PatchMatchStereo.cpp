@@ -0,0 +1,691 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/PatchMatchStereo.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/ThreadPool.h>
+
+#include <emmintrin.h>
+#include <string.h>
+
+namespace cvt {
+
+/* same constants as the pmhstereo kernels */
+#define PMS_DEPTHREFINEMUL		2.0f
+#define PMS_NORMALREFINEMUL		0.1f
+#define PMS_NORMALCOMPMAX		0.95f
+#define PMS_NUMREFINE			2
+#define PMS_NUMRNDSAMPLE		6
+#define PMS_RNDRADIUS			3
+#define PMS_COLORWEIGHT			26.0f
+#define PMS_COLORGRADALPHA		0.05f
+#define PMS_COLORMAXDIFF		0.04f
+#define PMS_GRADMAXDIFF			0.01f
+#define PMS_MAXVIEWSAMPLES		4
+/* floats per pixel: r, g, b, 0, dx, dy, dxy, dyx */
+#define PMS_FEATURE				8
+
+	typedef PatchMatchStereo::State PMState;
+	typedef PatchMatchStereo::ViewSamples PMViewSamples;
+
+	static inline uint32_t _pmHash( uint32_t v )
+	{
+		v ^= v >> 16;
+		v *= 0x7feb352dU;
+		v ^= v >> 15;
+		v *= 0x846ca68bU;
+		v ^= v >> 16;
+		return v;
+	}
+
+	/* xorshift generator seeded per pixel and iteration, the samples do not depend on the scheduling */
+	class PMRandom {
+		public:
+			PMRandom( size_t index, size_t iter, int lr ) :
+				_s( _pmHash( ( uint32_t ) index ^ _pmHash( ( uint32_t ) ( iter * 2 + lr ) ) ) | 1 )
+			{
+			}
+
+			float operator()()
+			{
+				_s ^= _s << 13;
+				_s ^= _s >> 17;
+				_s ^= _s << 5;
+				return ( float ) ( _s >> 8 ) * ( 1.0f / 16777216.0f );
+			}
+
+		private:
+			uint32_t _s;
+	};
+
+	static inline bool _pmFinite( const PMState& s )
+	{
+		/* false for NaN and infinity */
+		return ( s.a - s.a ) == 0.0f && ( s.b - s.b ) == 0.0f && ( s.c - s.c ) == 0.0f;
+	}
+
+	static inline PMState _pmViewProp( const PMState& s )
+	{
+		PMState ret;
+		ret.a = 1.0f / s.a;
+		ret.b = -s.b / s.a;
+		ret.c = -s.c / s.a;
+		ret.cost = 0.0f;
+		return ret;
+	}
+
+	static inline float _pmTransform( const PMState& s, float x, float y )
+	{
+		return s.a * x + s.b * y + s.c;
+	}
+
+	static inline void _pmNormal( float* n, const PMState& s )
+	{
+		float px = 1.0f - s.a;
+		float py = -s.b;
+		n[ 2 ] = 1.0f / Math::sqrt( px * px + py * py + 1.0f );
+		n[ 0 ] = -px * n[ 2 ];
+		n[ 1 ] = -py * n[ 2 ];
+	}
+
+	/* state of the plane through depth z at ( x, y ) with the (unnormalized) normal components nx, ny */
+	static inline PMState _pmFromNormalDepth( float nx, float ny, float z, float x, float y, int lr )
+	{
+		nx = Math::clamp( nx, -PMS_NORMALCOMPMAX, PMS_NORMALCOMPMAX );
+		ny = Math::clamp( ny, -PMS_NORMALCOMPMAX, PMS_NORMALCOMPMAX );
+		float nfactor = Math::max( Math::sqrt( nx * nx + ny * ny ) + 0.001f, 1.0f );
+		nx /= nfactor;
+		ny /= nfactor;
+		float nz = Math::sqrt( 1.0f - nx * nx - ny * ny );
+
+		PMState ret;
+		ret.a = 1.0f + nx / nz;
+		ret.b = ny / nz;
+		ret.c = -( ( nx * x + ny * y ) / nz + z );
+		ret.cost = 0.0f;
+		return lr ? ret : _pmViewProp( ret );
+	}
+
+	static inline PMState _pmInit( PMRandom& rng, float x, float y, int lr, float normmul, float depthmax )
+	{
+		float z = rng() * depthmax;
+		float nx = ( rng() - 0.5f ) * normmul * PMS_NORMALCOMPMAX;
+		float ny = ( rng() - 0.5f ) * normmul * PMS_NORMALCOMPMAX;
+		return _pmFromNormalDepth( nx, ny, z, x, y, lr );
+	}
+
+	static inline PMState _pmRefine( PMRandom& rng, const PMState& s, float x, float y, float depthmax, int lr )
+	{
+		PMState p = lr ? s : _pmViewProp( s );
+		p.a = 1.0f - p.a;
+		p.b = -p.b;
+		p.c = -p.c;
+
+		float z = p.a * x + p.b * y + p.c;
+		float nz = 1.0f / Math::sqrt( p.a * p.a + p.b * p.b + 1.0f );
+		float nx = -p.a * nz;
+		float ny = -p.b * nz;
+
+		z = Math::clamp( z + ( rng() - 0.5f ) * PMS_DEPTHREFINEMUL, 0.0f, depthmax );
+		nx += ( rng() - 0.5f ) * PMS_NORMALREFINEMUL;
+		ny += ( rng() - 0.5f ) * PMS_NORMALREFINEMUL;
+		return _pmFromNormalDepth( nx, ny, z, x, y, lr );
+	}
+
+	/* adaptive support weighted color and gradient cost of one pixel, the weights are computed once per pixel */
+	class PMCost {
+		public:
+			PMCost( const float* f1, const float* f2, size_t width, size_t height, size_t patchsize, const float* wfactor, float* weights ) :
+				_f1( f1 ), _f2( f2 ), _w( ( int ) width ), _h( ( int ) height ), _ps( ( int ) patchsize ),
+				_wfactor( wfactor ), _weights( weights )
+			{
+			}
+
+			void setup( int x, int y )
+			{
+				const int pw = 2 * _ps + 1;
+				_x = x;
+				_y = y;
+				_dx0 = Math::max( -_ps, -x );
+				_dx1 = Math::min( _ps, _w - 1 - x );
+				_dy0 = Math::max( -_ps, -y );
+				_dy1 = Math::min( _ps, _h - 1 - y );
+
+				const float* center = _f1 + ( y * _w + x ) * PMS_FEATURE;
+				for( int dy = _dy0; dy <= _dy1; dy++ ) {
+					const float* f = _f1 + ( ( y + dy ) * _w + x ) * PMS_FEATURE;
+					float* w = _weights + ( dy + _ps ) * pw + _ps;
+					const float* fac = _wfactor + ( dy + _ps ) * pw + _ps;
+					for( int dx = _dx0; dx <= _dx1; dx++ ) {
+						const float* c = f + dx * PMS_FEATURE;
+						float d = Math::abs( center[ 0 ] - c[ 0 ] ) + Math::abs( center[ 1 ] - c[ 1 ] ) + Math::abs( center[ 2 ] - c[ 2 ] );
+						w[ dx ] = Math::exp( -d * fac[ dx ] );
+					}
+				}
+			}
+
+			float operator()( const PMState& s ) const
+			{
+				if( !_pmFinite( s ) )
+					return 1e5f;
+
+				const int pw = 2 * _ps + 1;
+				const float fw = ( float ) _w;
+				const __m128 absmask = _mm_castsi128_ps( _mm_set1_epi32( 0x7fffffff ) );
+				const __m128 cmax = _mm_set1_ps( PMS_COLORMAXDIFF );
+				const __m128 gmax = _mm_set1_ps( PMS_GRADMAXDIFF );
+				__m128 accc = _mm_setzero_ps();
+				__m128 accg = _mm_setzero_ps();
+				float wsum = 0.0f;
+
+				for( int dy = _dy0; dy <= _dy1; dy++ ) {
+					const int yy = _y + dy;
+					const float* f1 = _f1 + yy * _w * PMS_FEATURE;
+					const float* f2 = _f2 + yy * _w * PMS_FEATURE;
+					const float* w = _weights + ( dy + _ps ) * pw + _ps;
+					const float ty = s.b * ( float ) yy + s.c;
+
+					for( int dx = _dx0; dx <= _dx1; dx++ ) {
+						const int px = _x + dx;
+						float xs = s.a * ( float ) px + ty;
+						if( xs < 0.0f || xs >= fw )
+							continue;
+
+						int i0 = ( int ) xs;
+						int i1 = Math::min( i0 + 1, _w - 1 );
+						__m128 t = _mm_set1_ps( xs - ( float ) i0 );
+						__m128 wt = _mm_set1_ps( w[ dx ] );
+						wsum += w[ dx ];
+
+						const float* p0 = f2 + i0 * PMS_FEATURE;
+						const float* p1 = f2 + i1 * PMS_FEATURE;
+						const float* q = f1 + px * PMS_FEATURE;
+
+						__m128 c0 = _mm_loadu_ps( p0 );
+						__m128 g0 = _mm_loadu_ps( p0 + 4 );
+						__m128 c2 = _mm_add_ps( c0, _mm_mul_ps( t, _mm_sub_ps( _mm_loadu_ps( p1 ), c0 ) ) );
+						__m128 g2 = _mm_add_ps( g0, _mm_mul_ps( t, _mm_sub_ps( _mm_loadu_ps( p1 + 4 ), g0 ) ) );
+
+						__m128 dc = _mm_min_ps( _mm_and_ps( _mm_sub_ps( _mm_loadu_ps( q ), c2 ), absmask ), cmax );
+						__m128 dg = _mm_min_ps( _mm_and_ps( _mm_sub_ps( _mm_loadu_ps( q + 4 ), g2 ), absmask ), gmax );
+						accc = _mm_add_ps( accc, _mm_mul_ps( wt, dc ) );
+						accg = _mm_add_ps( accg, _mm_mul_ps( wt, dg ) );
+					}
+				}
+
+				if( wsum <= 1.1f )
+					return 1e5f;
+
+				/* the fourth color channel is zero in both views */
+				float c[ 4 ], g[ 4 ];
+				_mm_storeu_ps( c, accc );
+				_mm_storeu_ps( g, accg );
+				float ret = PMS_COLORGRADALPHA * ( c[ 0 ] + c[ 1 ] + c[ 2 ] + c[ 3 ] ) +
+							( 1.0f - PMS_COLORGRADALPHA ) * ( g[ 0 ] + g[ 1 ] + g[ 2 ] + g[ 3 ] );
+				return ret / wsum;
+			}
+
+		private:
+			const float*	_f1;
+			const float*	_f2;
+			int				_w;
+			int				_h;
+			int				_ps;
+			const float*	_wfactor;
+			float*			_weights;
+			int				_x, _y;
+			int				_dx0, _dx1;
+			int				_dy0, _dy1;
+	};
+
+	/* weight scale of the support window, depends on the offset only */
+	static void _pmWeightFactors( std::vector<float>& wfactor, size_t patchsize )
+	{
+		int ps = ( int ) patchsize;
+		wfactor.resize( ( 2 * ps + 1 ) * ( 2 * ps + 1 ) );
+		for( int dy = -ps; dy <= ps; dy++ ) {
+			for( int dx = -ps; dx <= ps; dx++ ) {
+				float len = Math::sqrt( ( float ) ( dx * dx + dy * dy ) );
+				wfactor[ ( dy + ps ) * ( 2 * ps + 1 ) + dx + ps ] = Math::smoothstep( 0.0f, 26.0f, len ) * 1.5f * PMS_COLORWEIGHT + 5.0f;
+			}
+		}
+	}
+
+	class PMInitBody {
+		public:
+			PMInitBody( PMState* states, const float* f1, const float* f2, size_t width, size_t height,
+						size_t patchsize, const float* wfactor, float depthmax, int lr ) :
+				_states( states ), _f1( f1 ), _f2( f2 ), _width( width ), _height( height ),
+				_patchsize( patchsize ), _wfactor( wfactor ), _depthmax( depthmax ), _lr( lr )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				ScopedBuffer<float, true> weights( Math::sqr( 2 * _patchsize + 1 ) );
+				PMCost cost( _f1, _f2, _width, _height, _patchsize, _wfactor, weights.ptr() );
+
+				for( size_t y = begin; y < end; y++ ) {
+					for( size_t x = 0; x < _width; x++ ) {
+						PMRandom rng( y * _width + x, 0, _lr );
+						PMState& s = _states[ y * _width + x ];
+						s = _pmInit( rng, ( float ) x, ( float ) y, _lr, 1.0f, _depthmax );
+						cost.setup( ( int ) x, ( int ) y );
+						s.cost = cost( s );
+					}
+				}
+			}
+
+		private:
+			PMState*		_states;
+			const float*	_f1;
+			const float*	_f2;
+			size_t			_width;
+			size_t			_height;
+			size_t			_patchsize;
+			const float*	_wfactor;
+			float			_depthmax;
+			int				_lr;
+	};
+
+	/*
+	   Updates the pixels of one color of the checkerboard. All proposals are taken from
+	   pixels of the other color, so the pixels of one pass are independent of each other.
+	 */
+	class PMPropagateBody {
+		public:
+			PMPropagateBody( PMState* states, const PMViewSamples* viewin, const float* f1, const float* f2,
+							 size_t width, size_t height, size_t patchsize, const float* wfactor,
+							 float depthmax, size_t viewsamples, int lr, size_t iter, size_t color ) :
+				_states( states ), _viewin( viewin ), _f1( f1 ), _f2( f2 ), _width( width ), _height( height ),
+				_patchsize( patchsize ), _wfactor( wfactor ), _depthmax( depthmax ), _viewsamples( viewsamples ),
+				_lr( lr ), _iter( iter ), _color( color )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				static const int neighbours[ 8 ][ 2 ] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 },
+														  { -3, 0 }, { 3, 0 }, { 0, -3 }, { 0, 3 } };
+				const int w = ( int ) _width;
+				const int h = ( int ) _height;
+				ScopedBuffer<float, true> weights( Math::sqr( 2 * _patchsize + 1 ) );
+				PMCost cost( _f1, _f2, _width, _height, _patchsize, _wfactor, weights.ptr() );
+
+				for( size_t y = begin; y < end; y++ ) {
+					for( size_t x = ( y + _color ) & 1; x < _width; x += 2 ) {
+						const float xf = ( float ) x;
+						const float yf = ( float ) y;
+						const size_t idx = y * _width + x;
+						PMRandom rng( idx, _iter, _lr );
+						PMState self = _states[ idx ];
+						PMState n;
+
+						cost.setup( ( int ) x, ( int ) y );
+
+						for( int i = 0; i < 8; i++ ) {
+							int nx = ( int ) x + neighbours[ i ][ 0 ];
+							int ny = ( int ) y + neighbours[ i ][ 1 ];
+							if( nx < 0 || nx >= w || ny < 0 || ny >= h )
+								continue;
+							n = _states[ ny * w + nx ];
+							tryState( self, n, cost );
+						}
+
+						// random samples from the other color in the neighbourhood
+						for( int i = 0; i < PMS_NUMRNDSAMPLE; i++ ) {
+							int dx = ( int ) ( rng() * ( 2 * PMS_RNDRADIUS + 1 ) ) - PMS_RNDRADIUS;
+							int dy = ( int ) ( rng() * ( 2 * PMS_RNDRADIUS + 1 ) ) - PMS_RNDRADIUS;
+							if( ( ( dx + dy ) & 1 ) == 0 )
+								dy += dy < PMS_RNDRADIUS ? 1 : -1;
+							int nx = ( int ) x + dx;
+							int ny = ( int ) y + dy;
+							if( nx < 0 || nx >= w || ny < 0 || ny >= h )
+								continue;
+							n = _states[ ny * w + nx ];
+							tryState( self, n, cost );
+						}
+
+						n = _pmInit( rng, xf, yf, _lr, 2.0f, _depthmax );
+						tryState( self, n, cost );
+
+						const PMViewSamples& view = _viewin[ idx ];
+						size_t nview = Math::min<size_t>( view.n, _viewsamples );
+						for( size_t i = 0; i < nview; i++ ) {
+							n = view.samples[ i ];
+							tryState( self, n, cost );
+						}
+
+						for( int i = 0; i < PMS_NUMREFINE; i++ ) {
+							n = _pmRefine( rng, self, xf, yf, _depthmax, _lr );
+							tryState( self, n, cost );
+						}
+
+						_states[ idx ] = self;
+					}
+				}
+			}
+
+		private:
+			static inline void tryState( PMState& self, PMState& n, const PMCost& cost )
+			{
+				n.cost = cost( n );
+				if( n.cost <= self.cost )
+					self = n;
+			}
+
+			PMState*				_states;
+			const PMViewSamples*	_viewin;
+			const float*			_f1;
+			const float*			_f2;
+			size_t					_width;
+			size_t					_height;
+			size_t					_patchsize;
+			const float*			_wfactor;
+			float					_depthmax;
+			size_t					_viewsamples;
+			int						_lr;
+			size_t					_iter;
+			size_t					_color;
+	};
+
+	/* proposes the states of one view to the matched pixels of the other view, rows are independent */
+	class PMViewPropBody {
+		public:
+			PMViewPropBody( PMViewSamples* viewout, const PMState* states, size_t width, size_t viewsamples ) :
+				_viewout( viewout ), _states( states ), _width( width ), _viewsamples( viewsamples )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				for( size_t y = begin; y < end; y++ ) {
+					PMViewSamples* out = _viewout + y * _width;
+					const PMState* s = _states + y * _width;
+
+					for( size_t x = 0; x < _width; x++ )
+						out[ x ].n = 0;
+
+					for( size_t x = 0; x < _width; x++ ) {
+						float pos = _pmTransform( s[ x ], ( float ) x, ( float ) y ) + 0.5f;
+						if( !( pos >= 0.0f && pos < ( float ) _width ) )
+							continue;
+						PMViewSamples& v = out[ ( size_t ) pos ];
+						if( ( size_t ) v.n < _viewsamples )
+							v.samples[ v.n++ ] = _pmViewProp( s[ x ] );
+					}
+				}
+			}
+
+		private:
+			PMViewSamples*	_viewout;
+			const PMState*	_states;
+			size_t			_width;
+			size_t			_viewsamples;
+	};
+
+	PatchMatchStereo::PatchMatchStereo() :
+		_width( 0 ),
+		_height( 0 ),
+		_patchsize( 0 ),
+		_depthmax( 0.0f ),
+		_viewsamples( 0 ),
+		_iter( 0 ),
+		_maxdispdiff( 0.5f ),
+		_maxanglediff( 10.0f )
+	{
+	}
+
+	PatchMatchStereo::~PatchMatchStereo()
+	{
+	}
+
+	void PatchMatchStereo::init( const Image& left, const Image& right, size_t patchsize, float depthmax, size_t viewsamples )
+	{
+		if( left.width() != right.width() || left.height() != right.height() )
+			throw CVTException( "Left/Right stereo images inconsistent" );
+
+		/* an empty pair leaves the matcher uninitialized */
+		if( !left.width() || !left.height() ) {
+			_width = _height = 0;
+			_iter = 0;
+			return;
+		}
+
+		_width = left.width();
+		_height = left.height();
+		_patchsize = patchsize;
+		_depthmax = depthmax;
+		_viewsamples = Math::min<size_t>( viewsamples, PMS_MAXVIEWSAMPLES );
+		_iter = 0;
+
+		setupFeatures( _feature[ 0 ], left );
+		setupFeatures( _feature[ 1 ], right );
+
+		std::vector<float> wfactor;
+		_pmWeightFactors( wfactor, _patchsize );
+
+		size_t grain = parallelGrain( _height );
+		for( int view = 0; view < 2; view++ ) {
+			_state[ view ].resize( _width * _height );
+			_view[ view ].resize( _width * _height );
+			for( size_t i = 0; i < _view[ view ].size(); i++ )
+				_view[ view ][ i ].n = 0;
+
+			PMInitBody body( &_state[ view ][ 0 ], &_feature[ view ][ 0 ], &_feature[ 1 - view ][ 0 ], _width, _height,
+							 _patchsize, &wfactor[ 0 ], _depthmax, 1 - view );
+			parallelFor( 0, _height, body, grain );
+		}
+	}
+
+	void PatchMatchStereo::setupFeatures( std::vector<float>& feature, const Image& img )
+	{
+		Image rgba;
+		img.convert( rgba, IFormat::RGBA_FLOAT, IALLOCATOR_MEM );
+
+		const size_t w = _width;
+		const size_t h = _height;
+		feature.resize( w * h * PMS_FEATURE );
+
+		/* gray values with a zero border as used by the gradient kernel */
+		std::vector<float> gray( ( w + 2 ) * ( h + 2 ), 0.0f );
+		IMapScoped<const float> map( rgba );
+		for( size_t y = 0; y < h; y++ ) {
+			const float* src = map.ptr();
+			float* f = &feature[ y * w * PMS_FEATURE ];
+			float* g = &gray[ ( y + 1 ) * ( w + 2 ) + 1 ];
+			for( size_t x = 0; x < w; x++ ) {
+				f[ 0 ] = src[ 0 ];
+				f[ 1 ] = src[ 1 ];
+				f[ 2 ] = src[ 2 ];
+				f[ 3 ] = 0.0f;
+				g[ x ] = 0.2126f * src[ 0 ] + 0.7152f * src[ 1 ] + 0.0722f * src[ 2 ];
+				src += 4;
+				f += PMS_FEATURE;
+			}
+			map++;
+		}
+
+		const size_t gs = w + 2;
+		for( size_t y = 0; y < h; y++ ) {
+			const float* g = &gray[ ( y + 1 ) * gs + 1 ];
+			float* f = &feature[ y * w * PMS_FEATURE ];
+			for( size_t x = 0; x < w; x++ ) {
+				f[ 4 ] = ( g[ x + 1 ] - g[ x - 1 ] ) * 0.5f + ( g[ x + 1 - gs ] - g[ x - 1 - gs ] ) * 0.25f + ( g[ x + 1 + gs ] - g[ x - 1 + gs ] ) * 0.25f;
+				f[ 5 ] = ( g[ x + gs ] - g[ x - gs ] ) * 0.5f + ( g[ x - 1 + gs ] - g[ x - 1 - gs ] ) * 0.25f + ( g[ x + 1 + gs ] - g[ x + 1 - gs ] ) * 0.25f;
+				f[ 6 ] = g[ x + 1 + gs ] - g[ x - 1 - gs ];
+				f[ 7 ] = g[ x - 1 + gs ] - g[ x + 1 - gs ];
+				f += PMS_FEATURE;
+			}
+		}
+	}
+
+	void PatchMatchStereo::iterate( size_t n )
+	{
+		if( !_width )
+			throw CVTException( "PatchMatchStereo not initialized" );
+
+		for( size_t i = 0; i < n; i++ ) {
+			_iter++;
+			propagateView( 0 );
+			propagateView( 1 );
+		}
+	}
+
+	void PatchMatchStereo::propagateView( size_t view )
+	{
+		std::vector<float> wfactor;
+		_pmWeightFactors( wfactor, _patchsize );
+
+		size_t grain = parallelGrain( _height );
+		for( size_t color = 0; color < 2; color++ ) {
+			PMPropagateBody body( &_state[ view ][ 0 ], &_view[ view ][ 0 ], &_feature[ view ][ 0 ], &_feature[ 1 - view ][ 0 ],
+								  _width, _height, _patchsize, &wfactor[ 0 ], _depthmax, _viewsamples,
+								  view == 0 ? 1 : 0, _iter, color );
+			parallelFor( 0, _height, body, grain );
+		}
+
+		PMViewPropBody prop( &_view[ 1 - view ][ 0 ], &_state[ view ][ 0 ], _width, _viewsamples );
+		parallelFor( 0, _height, prop, grain );
+	}
+
+	/* left states passing the left/right check, rejected ones are marked with a negative cost */
+	void PatchMatchStereo::consistency( std::vector<State>& out ) const
+	{
+		const float maxcos = Math::cos( Math::deg2Rad( _maxanglediff ) );
+		out.resize( _width * _height );
+
+		for( size_t y = 0; y < _height; y++ ) {
+			for( size_t x = 0; x < _width; x++ ) {
+				const State& sl = _state[ 0 ][ y * _width + x ];
+				State& o = out[ y * _width + x ];
+				o = sl;
+				o.cost = -1.0f;
+
+				float x2 = _pmTransform( sl, ( float ) x, ( float ) y );
+				float rx = Math::round( x2 );
+				if( !( rx >= 0.0f && rx < ( float ) _width ) )
+					continue;
+
+				const State& sr = _state[ 1 ][ y * _width + ( size_t ) rx ];
+				float nl[ 3 ], nr[ 3 ];
+				_pmNormal( nl, sl );
+				_pmNormal( nr, _pmViewProp( sr ) );
+				float ndiff = nl[ 0 ] * nr[ 0 ] + nl[ 1 ] * nr[ 1 ] + nl[ 2 ] * nr[ 2 ];
+				float dmax = Math::abs( ( float ) x - _pmTransform( sr, x2, ( float ) y ) );
+
+				if( dmax < _maxdispdiff && ndiff > maxcos )
+					o.cost = sl.cost;
+			}
+		}
+	}
+
+	void PatchMatchStereo::depthMap( Image& dmap, float dscale, Image* normalmap ) const
+	{
+		if( !_width )
+			throw CVTException( "PatchMatchStereo not initialized" );
+
+		if( dscale <= 0.0f )
+			dscale = 1.0f / _depthmax;
+
+		std::vector<State> states;
+		consistency( states );
+
+		IFormat format = ( dmap.channels() != 1 ) ? IFormat::GRAY_FLOAT : dmap.format();
+		Image depth( _width, _height, IFormat::GRAY_FLOAT );
+		std::vector<const State*> selected( _width * _height );
+
+		{
+			IMapScoped<float> map( depth );
+			for( size_t y = 0; y < _height; y++ ) {
+				const State* s = &states[ y * _width ];
+				const State** sel = &selected[ y * _width ];
+				float* d = map.ptr();
+				const float yf = ( float ) y;
+
+				for( size_t x = 0; x < _width; x++ ) {
+					const float xf = ( float ) x;
+
+					if( s[ x ].cost >= 0.0f ) {
+						sel[ x ] = &s[ x ];
+						d[ x ] = Math::abs( _pmTransform( s[ x ], xf, yf ) - xf ) * dscale;
+						continue;
+					}
+
+					/* take the smaller disparity of the nearest valid neighbours in the row */
+					float disp = 0.0f;
+					sel[ x ] = NULL;
+					for( size_t l = x; l-- > 0; ) {
+						if( s[ l ].cost >= 0.0f ) {
+							disp = xf - _pmTransform( s[ l ], xf, yf );
+							sel[ x ] = &s[ l ];
+							break;
+						}
+					}
+					for( size_t r = x + 1; r < _width; r++ ) {
+						if( s[ r ].cost >= 0.0f ) {
+							float dr = xf - _pmTransform( s[ r ], xf, yf );
+							if( !sel[ x ] || dr < disp ) {
+								disp = dr;
+								sel[ x ] = &s[ r ];
+							}
+							break;
+						}
+					}
+					d[ x ] = disp * dscale;
+				}
+				map++;
+			}
+		}
+
+		if( normalmap ) {
+			normalmap->reallocate( _width, _height, IFormat::RGBA_FLOAT );
+			IMapScoped<float> map( *normalmap );
+			for( size_t y = 0; y < _height; y++ ) {
+				const State* const* sel = &selected[ y * _width ];
+				float* n = map.ptr();
+				for( size_t x = 0; x < _width; x++ ) {
+					if( sel[ x ] )
+						_pmNormal( n, *sel[ x ] );
+					else {
+						n[ 0 ] = n[ 1 ] = 0.0f;
+						n[ 2 ] = 1.0f;
+					}
+					n[ 3 ] = 0.0f;
+					n += 4;
+				}
+				map++;
+			}
+		}
+
+		if( format == IFormat::GRAY_FLOAT )
+			dmap = depth;
+		else
+			depth.convert( dmap, format, IALLOCATOR_MEM );
+	}
+}
@@ -0,0 +1,101 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_PATCHMATCHSTEREO_H
+#define CVT_PATCHMATCHSTEREO_H
+
+#include <cvt/gfx/Image.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/**
+	  \brief Slanted plane PatchMatch stereo on the CPU
+
+	  Uses the same plane states, matching cost, view propagation and left/right consistency
+	  as the OpenCL PMHuberStereo, without the Huber smoothing term.
+	  Pixels are updated in a red-black order, so each half-sweep runs in parallel and
+	  the result does not depend on the number of threads.
+
+	  The state survives between calls: init() once, then iterate() as often as needed
+	  and query depthMap() in between to inspect intermediate results.
+	 */
+	class PatchMatchStereo {
+		public:
+			PatchMatchStereo();
+			~PatchMatchStereo();
+
+			void	init( const Image& left, const Image& right, size_t patchsize, float depthmax, size_t viewsamples = 4 );
+			void	iterate( size_t n = 1 );
+			size_t	iterations() const { return _iter; }
+
+			void	depthMap( Image& dmap, float dscale = -1.0f, Image* normalmap = NULL ) const;
+
+			void	setConsistencyThreshold( float maxdispdiff, float maxanglediff );
+
+			/**
+			  \brief Plane x' = a * x + b * y + c mapping a pixel to the other view together with its cost
+			 */
+			struct State {
+				float a, b, c, cost;
+			};
+
+			/**
+			  \brief Candidate planes proposed by the other view for one pixel
+			 */
+			struct ViewSamples {
+				int		n;
+				State	samples[ 4 ];
+			};
+
+		private:
+			PatchMatchStereo( const PatchMatchStereo& );
+			PatchMatchStereo& operator=( const PatchMatchStereo& );
+
+			void	setupFeatures( std::vector<float>& feature, const Image& img );
+			void	propagateView( size_t view );
+			void	consistency( std::vector<State>& out ) const;
+
+			size_t						_width;
+			size_t						_height;
+			size_t						_patchsize;
+			float						_depthmax;
+			size_t						_viewsamples;
+			size_t						_iter;
+			float						_maxdispdiff;
+			float						_maxanglediff;
+			std::vector<float>			_feature[ 2 ];
+			std::vector<State>			_state[ 2 ];
+			std::vector<ViewSamples>	_view[ 2 ];
+	};
+
+	inline void PatchMatchStereo::setConsistencyThreshold( float maxdispdiff, float maxanglediff )
+	{
+		_maxdispdiff = maxdispdiff;
+		_maxanglediff = maxanglediff;
+	}
+}
+
+#endif
@@ -0,0 +1,183 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/PatchMatchStereo.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/CVTTest.h>
+
+namespace cvt {
+
+	static float _pmsTexture( float x, float y, int c )
+	{
+		return 0.5f + 0.25f * Math::sin( x * 0.31f + y * 0.17f + c ) + 0.2f * Math::sin( x * 0.07f * ( c + 1 ) + y * 0.29f );
+	}
+
+	static float _pmsForeground( float x, float y, int c )
+	{
+		return 0.5f + 0.3f * Math::sin( x * 0.5f - y * 0.8f + c ) * Math::cos( x * 0.13f + y * 0.2f );
+	}
+
+	/*
+	   left( x ) = right( x - d ): the background has disparity dbg, the rectangle
+	   [ fx0, fx1 ) x [ fy0, fy1 ) of the left view has disparity dfg
+	 */
+	static void _pmsPair( Image& left, Image& right, size_t w, size_t h, float dbg, float dfg,
+						  size_t fx0, size_t fx1, size_t fy0, size_t fy1 )
+	{
+		left.reallocate( w, h, IFormat::RGBA_FLOAT );
+		right.reallocate( w, h, IFormat::RGBA_FLOAT );
+
+		IMapScoped<float> ml( left );
+		IMapScoped<float> mr( right );
+		for( size_t y = 0; y < h; y++ ) {
+			float* pl = ml.ptr();
+			float* pr = mr.ptr();
+			bool fgrow = y >= fy0 && y < fy1;
+			for( size_t x = 0; x < w; x++ ) {
+				float xr = ( float ) x + dfg;
+				bool fgl = fgrow && x >= fx0 && x < fx1;
+				bool fgr = fgrow && xr >= ( float ) fx0 && xr < ( float ) fx1;
+				for( int c = 0; c < 3; c++ ) {
+					pl[ 4 * x + c ] = fgl ? _pmsForeground( x, y, c ) : _pmsTexture( x, y, c );
+					pr[ 4 * x + c ] = fgr ? _pmsForeground( xr, y, c ) : _pmsTexture( x + dbg, y, c );
+				}
+				pl[ 4 * x + 3 ] = pr[ 4 * x + 3 ] = 1.0f;
+			}
+			ml++;
+			mr++;
+		}
+	}
+
+	/* mean absolute disparity error inside [ x0, x1 ) x [ y0, y1 ) */
+	static float _pmsError( const Image& disparity, float d, size_t x0, size_t x1, size_t y0, size_t y1 )
+	{
+		IMapScoped<const float> map( disparity );
+		double err = 0.0;
+		for( size_t y = y0; y < y1; y++ ) {
+			const float* p = map.line( y );
+			for( size_t x = x0; x < x1; x++ )
+				err += Math::abs( p[ x ] - d );
+		}
+		return ( float ) ( err / ( double ) ( ( x1 - x0 ) * ( y1 - y0 ) ) );
+	}
+
+	static float _pmsMaxError( const Image& disparity, float d, size_t x0, size_t x1, size_t y0, size_t y1 )
+	{
+		IMapScoped<const float> map( disparity );
+		float err = 0.0f;
+		for( size_t y = y0; y < y1; y++ ) {
+			const float* p = map.line( y );
+			for( size_t x = x0; x < x1; x++ )
+				err = Math::max( err, Math::abs( p[ x ] - d ) );
+		}
+		return err;
+	}
+
+	static bool _pmsShiftTest()
+	{
+		const size_t w = 96, h = 64;
+		const float d = 6.3f;
+		Image left, right, disparity;
+		_pmsPair( left, right, w, h, d, d, 0, 0, 0, 0 );
+
+		PatchMatchStereo pms;
+		pms.init( left, right, 5, 16.0f );
+		pms.iterate( 3 );
+		pms.depthMap( disparity, 1.0f );
+
+		if( disparity.width() != w || disparity.height() != h || pms.iterations() != 3 )
+			return false;
+		/* the leftmost columns have no match in the right view */
+		return _pmsError( disparity, d, 12, w - 4, 4, h - 4 ) < 0.1f;
+	}
+
+	static bool _pmsOcclusionTest()
+	{
+		const size_t w = 96, h = 64;
+		const float dbg = 4.0f, dfg = 12.0f;
+		const size_t fx0 = 44, fx1 = 76, fy0 = 16, fy1 = 48;
+		Image left, right, disparity;
+		_pmsPair( left, right, w, h, dbg, dfg, fx0, fx1, fy0, fy1 );
+
+		PatchMatchStereo pms;
+		pms.init( left, right, 5, 16.0f );
+		pms.iterate( 3 );
+		pms.depthMap( disparity, 1.0f );
+
+		bool ret = true;
+		ret &= _pmsError( disparity, dbg, 10, 36, 4, h - 4 ) < 0.25f;
+		ret &= _pmsError( disparity, dfg, fx0 + 4, fx1 - 4, fy0 + 4, fy1 - 4 ) < 0.25f;
+		/*
+		   the background left of the rectangle is hidden in the right view: it fails the
+		   left/right check and is filled from the background plane of its left neighbour
+		 */
+		ret &= _pmsMaxError( disparity, dbg, fx0 - ( size_t ) ( dfg - dbg ), fx0, fy0 + 4, fy1 - 4 ) < 2.0f;
+		return ret;
+	}
+
+	/* empty images leave the matcher uninitialized instead of touching empty state vectors */
+	static bool _pmsEmptyTest()
+	{
+		Image left( 0, 0, IFormat::RGBA_FLOAT ), right( 0, 0, IFormat::RGBA_FLOAT ), disparity;
+		PatchMatchStereo pms;
+		pms.init( left, right, 5, 16.0f );
+
+		bool ret = pms.iterations() == 0;
+		try {
+			pms.iterate( 1 );
+			ret = false;
+		} catch( const Exception& ) {
+		}
+		try {
+			pms.depthMap( disparity, 1.0f );
+			ret = false;
+		} catch( const Exception& ) {
+		}
+		return ret;
+	}
+
+}
+
+using namespace cvt;
+
+BEGIN_CVTTEST( PatchMatchStereo )
+	bool ret = true;
+	bool b;
+
+	b = _pmsShiftTest();
+	CVTTEST_PRINT( "PatchMatchStereo fronto-parallel shift", b );
+	ret &= b;
+
+	b = _pmsOcclusionTest();
+	CVTTEST_PRINT( "PatchMatchStereo occlusion and left/right check", b );
+	ret &= b;
+
+	b = _pmsEmptyTest();
+	CVTTEST_PRINT( "PatchMatchStereo empty images", b );
+	ret &= b;
+
+	return ret;
+END_CVTTEST
@@ -0,0 +1,468 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/PoseGraph.h>
+#include <cvt/math/SE3.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/Profiler.h>
+
+#include <algorithm>
+
+#include <Eigen/Geometry>
+
+namespace cvt {
+
+    typedef Eigen::Matrix<double, 6, 1> PoseGraphVector6;
+    typedef Eigen::Matrix<double, 6, 6> PoseGraphMatrix6;
+
+    static inline void _skew( Eigen::Matrix3d & s, const Eigen::Vector3d & v )
+    {
+        s <<      0, -v[ 2 ],  v[ 1 ],
+             v[ 2 ],       0, -v[ 0 ],
+            -v[ 1 ],  v[ 0 ],       0;
+    }
+
+    /* logarithm of SE(3) in the parameter order of SE3: rotation, translation */
+    static inline void _logSE3( PoseGraphVector6 & xi, const Eigen::Matrix4d & t )
+    {
+        Eigen::Matrix3d r = t.block<3, 3>( 0, 0 );
+        Eigen::AngleAxisd aa( r );
+        double theta = aa.angle();
+        Eigen::Vector3d w = aa.axis() * theta;
+
+        Eigen::Matrix3d W;
+        _skew( W, w );
+
+        double c;
+        if( theta < 1e-5 )
+            c = 1.0 / 12.0 + theta * theta / 720.0;
+        else
+            c = ( 1.0 - 0.5 * theta * Math::sin( theta ) / ( 1.0 - Math::cos( theta ) ) ) / ( theta * theta );
+
+        Eigen::Matrix3d vinv = Eigen::Matrix3d::Identity() - 0.5 * W + c * W * W;
+        xi.head<3>() = w;
+        xi.tail<3>() = vinv * t.block<3, 1>( 0, 3 );
+    }
+
+    /* inverse of a rigid transformation */
+    static inline void _inverseSE3( Eigen::Matrix4d & inv, const Eigen::Matrix4d & t )
+    {
+        inv.setIdentity();
+        inv.block<3, 3>( 0, 0 ) = t.block<3, 3>( 0, 0 ).transpose();
+        inv.block<3, 1>( 0, 3 ) = -inv.block<3, 3>( 0, 0 ) * t.block<3, 1>( 0, 3 );
+    }
+
+    class PoseGraphLinearize
+    {
+        public:
+            PoseGraphLinearize( PoseGraph & graph ) : _graph( graph )
+            {
+            }
+
+            void operator()( size_t begin, size_t end ) const
+            {
+                PoseGraphVector6 e;
+                Eigen::Matrix4d tiinv, xinv;
+                Eigen::Matrix3d sk;
+                PoseGraphMatrix6 adj, ad, jr, Ji, Jj, WJi, WJj;
+
+                for( size_t i = begin; i < end; i++ ){
+                    const PoseGraph::Edge & edge = _graph._edges[ i ];
+                    PoseGraph::Linearization & lin = _graph._lin[ i ];
+                    const Eigen::Matrix4d & ti = _graph._poses[ edge.from ];
+                    const Eigen::Matrix4d & tj = _graph._poses[ edge.to ];
+
+                    PoseGraph::residual( e, edge.measurementInv, ti, tj );
+
+                    // e = log( Z^-1 T_i^-1 T_j ), local updates T <- T exp( d ):
+                    // de/dd_j = Jr^-1( e ), de/dd_i = -Jr^-1( e ) Ad( ( T_i^-1 T_j )^-1 )
+                    ad.setZero();
+                    _skew( sk, e.head<3>() );
+                    ad.block<3, 3>( 0, 0 ) = sk;
+                    ad.block<3, 3>( 3, 3 ) = sk;
+                    _skew( sk, e.tail<3>() );
+                    ad.block<3, 3>( 3, 0 ) = sk;
+                    jr.setIdentity();
+                    jr += 0.5 * ad + ( 1.0 / 12.0 ) * ad * ad;
+
+                    _inverseSE3( tiinv, ti );
+                    _inverseSE3( xinv, tiinv * tj );
+                    adj.setZero();
+                    adj.block<3, 3>( 0, 0 ) = xinv.block<3, 3>( 0, 0 );
+                    adj.block<3, 3>( 3, 3 ) = xinv.block<3, 3>( 0, 0 );
+                    _skew( sk, xinv.block<3, 1>( 0, 3 ) );
+                    adj.block<3, 3>( 3, 0 ) = sk * xinv.block<3, 3>( 0, 0 );
+
+                    Jj = jr;
+                    Ji.noalias() = -jr * adj;
+
+                    lin.chi2 = e.dot( edge.information * e );
+                    double w = _graph._kernel ? _graph._kernel->weight( Math::sqrt( lin.chi2 ) ) : 1.0;
+
+                    WJi.noalias() = w * edge.information * Ji;
+                    WJj.noalias() = w * edge.information * Jj;
+                    lin.Hii.noalias() = Ji.transpose() * WJi;
+                    lin.Hjj.noalias() = Jj.transpose() * WJj;
+                    lin.Hij.noalias() = Ji.transpose() * WJj;
+                    lin.gi.noalias() = WJi.transpose() * e;
+                    lin.gj.noalias() = WJj.transpose() * e;
+                    lin.chi2 *= w;
+                }
+            }
+
+        private:
+            PoseGraph & _graph;
+    };
+
+    class PoseGraphAssemble
+    {
+        public:
+            PoseGraphAssemble( PoseGraph & graph, const std::vector<size_t> & varNode, double lambda ) :
+                _graph( graph ), _varNode( varNode ), _lambda( lambda )
+            {
+            }
+
+            void operator()( size_t begin, size_t end ) const
+            {
+                for( size_t c = begin; c < end; c++ ){
+                    size_t node = _varNode[ c ];
+                    size_t colBegin = _graph._colStart[ c ];
+                    size_t nb = _graph._colStart[ c + 1 ] - colBegin;
+
+                    for( size_t p = colBegin; p < colBegin + nb; p++ )
+                        _graph._H[ p ].setZero();
+                    PoseGraphVector6 b = PoseGraphVector6::Zero();
+
+                    for( size_t k = _graph._incStart[ node ]; k < _graph._incStart[ node + 1 ]; k++ ){
+                        size_t ei = _graph._incEdges[ k ];
+                        const PoseGraph::Edge & edge = _graph._edges[ ei ];
+                        const PoseGraph::Linearization & lin = _graph._lin[ ei ];
+
+                        // diagonal block is the first of the column
+                        bool isTo = edge.to == node;
+                        size_t other = isTo ? edge.from : edge.to;
+                        if( isTo ){
+                            b += lin.gj;
+                            _graph._H[ colBegin ] += lin.Hjj;
+                        } else {
+                            b += lin.gi;
+                            _graph._H[ colBegin ] += lin.Hii;
+                        }
+
+                        // block ( other, node ) below the diagonal
+                        int ov = _graph._var[ other ];
+                        if( ov > ( int ) c ){
+                            const size_t* rbegin = &_graph._colRows[ 0 ] + colBegin;
+                            const size_t* pos = std::lower_bound( rbegin, rbegin + nb, ( size_t ) ov );
+                            if( isTo )
+                                _graph._H[ pos - &_graph._colRows[ 0 ] ] += lin.Hij;
+                            else
+                                _graph._H[ pos - &_graph._colRows[ 0 ] ] += lin.Hij.transpose();
+                        }
+                    }
+
+                    // Marquardt damping of the diagonal
+                    _graph._H[ colBegin ].diagonal() *= ( 1.0 + _lambda );
+
+                    _graph._b.segment<6>( 6 * c ) = b;
+                }
+            }
+
+        private:
+            PoseGraph &                 _graph;
+            const std::vector<size_t> & _varNode;
+            double                      _lambda;
+    };
+
+    class PoseGraphEvaluate
+    {
+        public:
+            PoseGraphEvaluate( const PoseGraph & graph, const PoseGraph::PoseVector & poses, std::vector<double> & costs ) :
+                _graph( graph ), _poses( poses ), _costs( costs )
+            {
+            }
+
+            void operator()( size_t begin, size_t end ) const
+            {
+                PoseGraphVector6 e;
+                for( size_t i = begin; i < end; i++ ){
+                    const PoseGraph::Edge & edge = _graph._edges[ i ];
+                    PoseGraph::residual( e, edge.measurementInv, _poses[ edge.from ], _poses[ edge.to ] );
+                    double chi2 = e.dot( edge.information * e );
+                    double w = _graph._kernel ? _graph._kernel->weight( Math::sqrt( chi2 ) ) : 1.0;
+                    _costs[ i ] = w * chi2;
+                }
+            }
+
+        private:
+            const PoseGraph &               _graph;
+            const PoseGraph::PoseVector &   _poses;
+            std::vector<double> &           _costs;
+    };
+
+    PoseGraph::PoseGraph() :
+        _kernel( 0 ),
+        _numVars( 0 ),
+        _structureValid( false ),
+        _lambda( 1e-4 ),
+        _iterations( 0 ),
+        _costs( 0.0 )
+    {
+    }
+
+    PoseGraph::~PoseGraph()
+    {
+    }
+
+    size_t PoseGraph::addNode( const Eigen::Matrix4d & pose, bool fixed )
+    {
+        _poses.push_back( pose );
+        _fixed.push_back( fixed );
+        _structureValid = false;
+        return _poses.size() - 1;
+    }
+
+    size_t PoseGraph::addEdge( size_t from, size_t to, const Eigen::Matrix4d & measurement, const InformationType & information )
+    {
+        if( from >= _poses.size() || to >= _poses.size() )
+            throw CVTException( "PoseGraph: edge references an unknown node" );
+        if( from == to )
+            throw CVTException( "PoseGraph: edge has to connect two different nodes" );
+
+        Edge edge;
+        edge.from = from;
+        edge.to = to;
+        _inverseSE3( edge.measurementInv, measurement );
+        edge.information = information;
+        _edges.push_back( edge );
+        _structureValid = false;
+        return _edges.size() - 1;
+    }
+
+    void PoseGraph::clear()
+    {
+        _poses.clear();
+        _fixed.clear();
+        _edges.clear();
+        _lin.clear();
+        _structureValid = false;
+    }
+
+    void PoseGraph::setPose( size_t node, const Eigen::Matrix4d & pose )
+    {
+        _poses[ node ] = pose;
+    }
+
+    void PoseGraph::setFixed( size_t node, bool fixed )
+    {
+        if( _fixed[ node ] != fixed ){
+            _fixed[ node ] = fixed;
+            _structureValid = false;
+        }
+    }
+
+    void PoseGraph::residual( PoseGraphVector6 & e, const Eigen::Matrix4d & zinv, const Eigen::Matrix4d & ti, const Eigen::Matrix4d & tj )
+    {
+        Eigen::Matrix4d tiinv;
+        _inverseSE3( tiinv, ti );
+        Eigen::Matrix4d err = zinv * tiinv * tj;
+        _logSE3( e, err );
+    }
+
+    void PoseGraph::buildStructure()
+    {
+        size_t n = _poses.size();
+
+        // node to edge incidence
+        _incStart.assign( n + 1, 0 );
+        for( size_t i = 0; i < _edges.size(); i++ ){
+            _incStart[ _edges[ i ].from + 1 ]++;
+            _incStart[ _edges[ i ].to + 1 ]++;
+        }
+        for( size_t i = 0; i < n; i++ )
+            _incStart[ i + 1 ] += _incStart[ i ];
+        _incEdges.resize( _incStart[ n ] );
+        std::vector<size_t> fill( _incStart.begin(), _incStart.end() - 1 );
+        for( size_t i = 0; i < _edges.size(); i++ ){
+            _incEdges[ fill[ _edges[ i ].from ]++ ] = i;
+            _incEdges[ fill[ _edges[ i ].to ]++ ] = i;
+        }
+
+        // connected components, a component without a fixed node holds its first node,
+        // so an edgeless node stays constant and every block of the system is regular
+        std::vector<bool> held( _fixed );
+        std::vector<bool> visited( n, false );
+        std::vector<size_t> stack, component;
+        for( size_t i = 0; i < n; i++ ){
+            if( visited[ i ] )
+                continue;
+            bool anchored = false;
+            component.clear();
+            stack.push_back( i );
+            visited[ i ] = true;
+            while( !stack.empty() ){
+                size_t node = stack.back();
+                stack.pop_back();
+                component.push_back( node );
+                anchored |= _fixed[ node ];
+                for( size_t k = _incStart[ node ]; k < _incStart[ node + 1 ]; k++ ){
+                    const Edge & edge = _edges[ _incEdges[ k ] ];
+                    size_t other = edge.from == node ? edge.to : edge.from;
+                    if( !visited[ other ] ){
+                        visited[ other ] = true;
+                        stack.push_back( other );
+                    }
+                }
+            }
+            if( !anchored )
+                held[ *std::min_element( component.begin(), component.end() ) ] = true;
+        }
+
+        // variable indices
+        _var.resize( n );
+        _numVars = 0;
+        for( size_t i = 0; i < n; i++ )
+            _var[ i ] = held[ i ] ? -1 : ( int ) _numVars++;
+
+        // lower block pattern, the diagonal first in every column
+        _colStart.resize( _numVars + 1 );
+        _colRows.clear();
+        _colRows.reserve( _numVars + _edges.size() );
+        std::vector<size_t> rows;
+        for( size_t node = 0; node < n; node++ ){
+            if( _var[ node ] < 0 )
+                continue;
+            size_t c = _var[ node ];
+            _colStart[ c ] = _colRows.size();
+
+            rows.clear();
+            for( size_t k = _incStart[ node ]; k < _incStart[ node + 1 ]; k++ ){
+                const Edge & edge = _edges[ _incEdges[ k ] ];
+                int ov = _var[ edge.from == node ? edge.to : edge.from ];
+                if( ov > ( int ) c )
+                    rows.push_back( ov );
+            }
+            std::sort( rows.begin(), rows.end() );
+            rows.erase( std::unique( rows.begin(), rows.end() ), rows.end() );
+
+            _colRows.push_back( c );
+            _colRows.insert( _colRows.end(), rows.begin(), rows.end() );
+        }
+        _colStart[ _numVars ] = _colRows.size();
+
+        _H.resize( _colRows.size() );
+        _solver.analyze( _numVars, _colStart, _colRows );
+
+        _b.resize( 6 * _numVars );
+        _lin.resize( _edges.size() );
+        _structureValid = true;
+    }
+
+    void PoseGraph::linearize()
+    {
+        parallelFor( 0, _edges.size(), PoseGraphLinearize( *this ), 256 );
+    }
+
+    double PoseGraph::evaluate( const PoseVector & poses ) const
+    {
+        std::vector<double> costs( _edges.size() );
+        parallelFor( 0, _edges.size(), PoseGraphEvaluate( *this, poses, costs ), 256 );
+
+        double sum = 0.0;
+        for( size_t i = 0; i < costs.size(); i++ )
+            sum += costs[ i ];
+        return sum;
+    }
+
+    double PoseGraph::costs() const
+    {
+        return evaluate( _poses );
+    }
+
+    void PoseGraph::optimize( const TerminationCriteria<double> & criteria )
+    {
+        CVT_PROFILE_SCOPE( "PoseGraph::optimize" );
+        _iterations = 0;
+        _costs = evaluate( _poses );
+
+        if( !_structureValid )
+            buildStructure();
+        if( !_numVars || _edges.empty() )
+            return;
+
+        std::vector<size_t> varNode( _numVars );
+        for( size_t i = 0; i < _poses.size(); i++ )
+            if( _var[ i ] >= 0 )
+                varNode[ _var[ i ] ] = i;
+
+        double lambda = _lambda;
+        bool relinearize = true;
+        Eigen::VectorXd delta;
+        PoseVector candidate;
+        SE3<double> update;
+
+        while( !criteria.finished( _costs, _iterations ) && lambda < 1e12 ){
+            if( relinearize )
+                linearize();
+            parallelFor( 0, _numVars, PoseGraphAssemble( *this, varNode, lambda ), 64 );
+
+            // the symbolic factorization is reused as long as the graph does not change
+            if( !_solver.factorize( _H ) ){
+                lambda *= 10.0;
+                relinearize = false;
+                continue;
+            }
+            _solver.solve( delta, -_b );
+            if( Math::isNaN( delta.sum() ) || Math::isInf( delta.sum() ) ){
+                lambda *= 10.0;
+                relinearize = false;
+                continue;
+            }
+
+            candidate = _poses;
+            for( size_t c = 0; c < _numVars; c++ ){
+                update.set( candidate[ varNode[ c ] ] );
+                update.applyInverse( delta.segment<6>( 6 * c ) );
+                candidate[ varNode[ c ] ] = update.transformation();
+            }
+
+            double costs = evaluate( candidate );
+            if( costs < _costs ){
+                bool converged = ( _costs - costs ) < 1e-12 * _costs;
+                _poses.swap( candidate );
+                _costs = costs;
+                _iterations++;
+                lambda = Math::max( lambda * 0.1, 1e-10 );
+                relinearize = true;
+                if( converged )
+                    break;
+            } else {
+                lambda *= 10.0;
+                relinearize = false;
+            }
+        }
+    }
+
+}
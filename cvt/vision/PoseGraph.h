@@ -0,0 +1,157 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_POSEGRAPH_H
+#define CVT_POSEGRAPH_H
+
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/StdVector>
+
+#include <cvt/math/TerminationCriteria.h>
+#include <cvt/math/SparseBlockCholesky.h>
+#include <cvt/vision/RobustWeighting.h>
+
+namespace cvt {
+
+    /**
+     *  \brief SE(3) pose graph with a sparse Levenberg-Marquardt optimizer
+     *
+     *  Nodes are absolute poses (node to world), edges relative pose
+     *  measurements Z_ij ~ T_i^-1 T_j weighted by a 6x6 information matrix
+     *  in the parameter order of SE3 (rotation, translation). Updates are
+     *  applied in the local frame of each node, T <- T exp( d ).
+     *  Nodes and edges are stored contiguously, the adjacency is kept in
+     *  compressed row form and the block pattern of the normal equations
+     *  is built and analyzed once, later iterations only refactorize.
+     *  Every connected component without a fixed node holds its first
+     *  node constant, in particular nodes without edges are not moved.
+     */
+    class PoseGraph
+    {
+        public:
+            typedef Eigen::Matrix<double, 6, 6> InformationType;
+
+            PoseGraph();
+            ~PoseGraph();
+
+            size_t addNode( const Eigen::Matrix4d & pose, bool fixed = false );
+            size_t addEdge( size_t from, size_t to, const Eigen::Matrix4d & measurement,
+                            const InformationType & information = InformationType::Identity() );
+            void clear();
+
+            size_t numNodes() const { return _poses.size(); }
+            size_t numEdges() const { return _edges.size(); }
+
+            const Eigen::Matrix4d & pose( size_t node ) const { return _poses[ node ]; }
+            void setPose( size_t node, const Eigen::Matrix4d & pose );
+            void setFixed( size_t node, bool fixed );
+            bool isFixed( size_t node ) const { return _fixed[ node ]; }
+
+            /**
+             *  \brief robust kernel applied to the Mahalanobis norm of the edge
+             *         residuals, not owned, NULL for plain least squares
+             */
+            void setRobustKernel( const RobustEstimator<double>* kernel ) { _kernel = kernel; }
+
+            void optimize( const TerminationCriteria<double> & criteria );
+
+            /* squared, weighted residual sum */
+            double costs() const;
+            size_t iterations() const { return _iterations; }
+            double lambda() const { return _lambda; }
+            void setLambda( double lambda ) { _lambda = lambda; }
+
+        private:
+            PoseGraph( const PoseGraph & );
+            PoseGraph& operator=( const PoseGraph & );
+
+            struct Edge {
+                size_t          from;
+                size_t          to;
+                Eigen::Matrix4d measurementInv;
+                InformationType information;
+                EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+            };
+
+            /* per edge blocks of the normal equations */
+            struct Linearization {
+                Eigen::Matrix<double, 6, 6> Hii;
+                Eigen::Matrix<double, 6, 6> Hjj;
+                Eigen::Matrix<double, 6, 6> Hij;
+                Eigen::Matrix<double, 6, 1> gi;
+                Eigen::Matrix<double, 6, 1> gj;
+                double                      chi2;
+                EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+            };
+
+            typedef std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d> > PoseVector;
+            typedef std::vector<Edge, Eigen::aligned_allocator<Edge> > EdgeVector;
+            typedef std::vector<Linearization, Eigen::aligned_allocator<Linearization> > LinearizationVector;
+
+            void buildStructure();
+            void linearize();
+            void buildSystem();
+            double evaluate( const PoseVector & poses ) const;
+
+            static void residual( Eigen::Matrix<double, 6, 1> & e, const Eigen::Matrix4d & zinv,
+                                  const Eigen::Matrix4d & ti, const Eigen::Matrix4d & tj );
+
+            PoseVector          _poses;
+            std::vector<bool>   _fixed;
+            EdgeVector          _edges;
+
+            const RobustEstimator<double>* _kernel;
+
+            /* variable index per node, -1 for fixed nodes */
+            std::vector<int>    _var;
+            size_t              _numVars;
+
+            /* node to edge incidence in compressed row form */
+            std::vector<size_t> _incStart;
+            std::vector<size_t> _incEdges;
+
+            /* lower block pattern per variable column: sorted block rows */
+            std::vector<size_t> _colStart;
+            std::vector<size_t> _colRows;
+
+            bool                _structureValid;
+            LinearizationVector _lin;
+            SparseBlockCholesky<6>::BlockVector _H;
+            Eigen::VectorXd     _b;
+            SparseBlockCholesky<6> _solver;
+
+            double              _lambda;
+            size_t              _iterations;
+            double              _costs;
+
+            friend class PoseGraphLinearize;
+            friend class PoseGraphAssemble;
+            friend class PoseGraphEvaluate;
+    };
+
+}
+
+#endif
@@ -0,0 +1,193 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/PoseGraph.h>
+#include <cvt/math/SE3.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/CVTTest.h>
+
+namespace cvt {
+
+    typedef std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d> > PoseGraphTestPoses;
+
+    static Eigen::Matrix4d _relative( const Eigen::Matrix4d & a, const Eigen::Matrix4d & b )
+    {
+        return a.inverse() * b;
+    }
+
+    /* poses on a helix, consecutive edges plus loop closures between the turns */
+    static void _helix( PoseGraphTestPoses & poses, size_t n, size_t perTurn )
+    {
+        poses.resize( n );
+        for( size_t i = 0; i < n; i++ ){
+            double phi = 2.0 * Math::PI * ( double ) i / ( double ) perTurn;
+            SE3<double> p( 0.1 * Math::sin( phi ), 0.0, phi, 5.0 * Math::cos( phi ), 5.0 * Math::sin( phi ), 0.05 * i );
+            poses[ i ] = p.transformation();
+        }
+    }
+
+    static void _buildGraph( PoseGraph & graph, const PoseGraphTestPoses & gt, size_t perTurn, double noise )
+    {
+        // initial estimate: ground truth disturbed by a drift
+        Eigen::Matrix4d drift = Eigen::Matrix4d::Identity();
+        for( size_t i = 0; i < gt.size(); i++ ){
+            SE3<double> d( noise * Math::rand( -1.0, 1.0 ), noise * Math::rand( -1.0, 1.0 ), noise * Math::rand( -1.0, 1.0 ),
+                           noise * Math::rand( -1.0, 1.0 ), noise * Math::rand( -1.0, 1.0 ), noise * Math::rand( -1.0, 1.0 ) );
+            drift = drift * d.transformation();
+            graph.addNode( i ? Eigen::Matrix4d( gt[ i ] * drift ) : gt[ i ] );
+        }
+
+        for( size_t i = 1; i < gt.size(); i++ )
+            graph.addEdge( i - 1, i, _relative( gt[ i - 1 ], gt[ i ] ) );
+        for( size_t i = perTurn; i < gt.size(); i += 3 )
+            graph.addEdge( i - perTurn, i, _relative( gt[ i - perTurn ], gt[ i ] ) );
+    }
+
+    static double _maxPoseError( const PoseGraph & graph, const PoseGraphTestPoses & gt )
+    {
+        double err = 0.0;
+        for( size_t i = 0; i < gt.size(); i++ )
+            err = Math::max( err, ( graph.pose( i ) - gt[ i ] ).cwiseAbs().maxCoeff() );
+        return err;
+    }
+
+    static bool _poseGraphExact()
+    {
+        PoseGraphTestPoses gt;
+        _helix( gt, 400, 40 );
+
+        PoseGraph graph;
+        _buildGraph( graph, gt, 40, 0.01 );
+        double initial = _maxPoseError( graph, gt );
+
+        TerminationCriteria<double> criteria;
+        criteria.setCostThreshold( 1e-16 );
+        criteria.setMaxIterations( 30 );
+        graph.optimize( criteria );
+
+        double err = _maxPoseError( graph, gt );
+        bool b = err < 1e-6 && initial > 0.1;
+        if( !b )
+            CVTTEST_LOG( "initial error " << initial << " final error " << err << " iterations " << graph.iterations() );
+        CVTTEST_PRINT( "PoseGraph recovers consistent graph", b );
+        return b;
+    }
+
+    static bool _poseGraphRobust()
+    {
+        PoseGraphTestPoses gt;
+        _helix( gt, 200, 40 );
+
+        PoseGraph graph;
+        _buildGraph( graph, gt, 40, 0.002 );
+
+        // wrong loop closures
+        SE3<double> wrong( 0.0, 0.0, 1.0, 2.0, 0.0, 0.0 );
+        graph.addEdge( 10, 150, wrong.transformation() );
+        graph.addEdge( 60, 170, wrong.transformation() );
+
+        // redescending kernel, the initial estimate is close enough
+        Tukey<double> tukey;
+        tukey.setThreshold( 1.0 );
+        graph.setRobustKernel( &tukey );
+
+        TerminationCriteria<double> criteria;
+        criteria.setMaxIterations( 50 );
+        graph.optimize( criteria );
+
+        double err = _maxPoseError( graph, gt );
+        bool b = err < 1e-4;
+        if( !b )
+            CVTTEST_LOG( "final error with outliers " << err );
+        CVTTEST_PRINT( "PoseGraph robust kernel rejects wrong loop closures", b );
+        return b;
+    }
+
+    static bool _poseGraphFixed()
+    {
+        PoseGraphTestPoses gt;
+        _helix( gt, 60, 20 );
+
+        PoseGraph graph;
+        _buildGraph( graph, gt, 20, 0.01 );
+        graph.setPose( 30, gt[ 30 ] );
+        graph.setFixed( 30, true );
+
+        TerminationCriteria<double> criteria;
+        criteria.setCostThreshold( 1e-16 );
+        graph.optimize( criteria );
+
+        // the fixed node holds the gauge, it must not move
+        bool b = ( graph.pose( 30 ) - gt[ 30 ] ).cwiseAbs().maxCoeff() == 0.0 &&
+                 _maxPoseError( graph, gt ) < 1e-6;
+        CVTTEST_PRINT( "PoseGraph fixed nodes", b );
+        return b;
+    }
+
+    static bool _poseGraphEdgeless()
+    {
+        PoseGraphTestPoses gt;
+        _helix( gt, 60, 20 );
+
+        PoseGraph graph;
+        _buildGraph( graph, gt, 20, 0.01 );
+
+        // a node without edges and a second component without a fixed node
+        SE3<double> p( 0.3, -0.2, 0.1, 1.0, 2.0, 3.0 );
+        SE3<double> q( 0.0, 0.1, 0.0, 1.0, 0.0, 0.0 );
+        size_t lone = graph.addNode( p.transformation() );
+        size_t a = graph.addNode( p.transformation() );
+        size_t b = graph.addNode( p.transformation() );
+        graph.addEdge( a, b, q.transformation() );
+
+        TerminationCriteria<double> criteria;
+        criteria.setCostThreshold( 1e-16 );
+        criteria.setMaxIterations( 30 );
+        graph.optimize( criteria );
+
+        Eigen::Matrix4d expected = p.transformation() * q.transformation();
+        bool ret = graph.iterations() > 0 &&
+                   _maxPoseError( graph, gt ) < 1e-6 &&
+                   ( graph.pose( lone ) - p.transformation() ).cwiseAbs().maxCoeff() == 0.0 &&
+                   ( graph.pose( a ) - p.transformation() ).cwiseAbs().maxCoeff() == 0.0 &&
+                   ( graph.pose( b ) - expected ).cwiseAbs().maxCoeff() < 1e-6;
+        if( !ret )
+            CVTTEST_LOG( "iterations " << graph.iterations() << " error " << _maxPoseError( graph, gt ) );
+        CVTTEST_PRINT( "PoseGraph nodes without edges", ret );
+        return ret;
+    }
+
+BEGIN_CVTTEST( PoseGraph )
+    bool ret = true;
+    Math::srand( 1234 );
+
+    ret &= _poseGraphExact();
+    ret &= _poseGraphRobust();
+    ret &= _poseGraphFixed();
+    ret &= _poseGraphEdgeless();
+
+    return ret;
+END_CVTTEST
+
+}
@@ -25,6 +25,8 @@
 #ifndef CVT_ROBUST_WEIGHTING_H
 #define CVT_ROBUST_WEIGHTING_H
 
+#include <cvt/math/Math.h>
+
 namespace cvt
 {
     template <class T>
@@ -33,6 +35,16 @@ namespace cvt
         public:
             virtual ~RobustEstimator(){}
             virtual T weight( T res ) const = 0;
+
+            /**
+             * \brief compute the weights for n residuals at once
+             */
+            virtual void weights( T* w, const T* res, size_t n ) const
+            {
+                for( size_t i = 0; i < n; i++ )
+                    w[ i ] = weight( res[ i ] );
+            }
+
             virtual void setScale( T sigma ) = 0;
             virtual bool isRobust() const { return true; }
     };
@@ -42,6 +54,12 @@ namespace cvt
         NoWeighting(){}
         T weight( T ) const { return (T)1; }
 
+        void weights( T* w, const T*, size_t n ) const
+        {
+            for( size_t i = 0; i < n; i++ )
+                w[ i ] = ( T )1;
+        }
+
         void setThreshold( T /*thresh*/ ){}
         void setScale( T /*sigma*/ ){}
         bool isRobust() const { return false; }
@@ -61,6 +79,15 @@ namespace cvt
                 return c / t;
         }
 
+        void weights( T* w, const T* res, size_t n ) const
+        {
+            const T cs = c * s;
+            for( size_t i = 0; i < n; i++ ){
+                T t = Math::abs( res[ i ] );
+                w[ i ] = ( t < cs ) ? ( T )1 : cs / t;
+            }
+        }
+
         void setThreshold( T thresh ){ c = thresh; }
         void setScale( T scale ){ s = scale; }
 
@@ -85,6 +112,15 @@ namespace cvt
                 return Math::sqr( 1 - Math::sqr( rs / c ) );
         }
 
+        void weights( T* w, const T* res, size_t n ) const
+        {
+            const T invcs = ( T )1 / ( c * s );
+            for( size_t i = 0; i < n; i++ ){
+                T u = Math::abs( res[ i ] ) * invcs;
+                w[ i ] = ( u > ( T )1 ) ? ( T )0 : Math::sqr( 1 - u * u );
+            }
+        }
+
         void setThreshold( T thresh ){ c = thresh; }
         void setScale( T sigma ){ s = sigma; }
 
@@ -0,0 +1,619 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/SGMStereo.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/ThreadPool.h>
+
+#include <emmintrin.h>
+#include <string.h>
+#include <vector>
+
+namespace cvt {
+
+#define SGM_CENSUSRX	4
+#define SGM_CENSUSRY	3
+#define SGM_MAXCOST		62
+/* guard entries around the disparities of one path cost vector */
+#define SGM_PAD			8
+#define SGM_INF			0x3fff
+/* default rows per stripe, fixed so that the result does not depend on the number of threads */
+#define SGM_STRIPE_ROWS	64
+
+	static inline uint32_t _sgmPopcount( uint64_t v )
+	{
+#ifdef __GNUC__
+		return ( uint32_t ) __builtin_popcountll( v );
+#else
+		v = v - ( ( v >> 1 ) & 0x5555555555555555ULL );
+		v = ( v & 0x3333333333333333ULL ) + ( ( v >> 2 ) & 0x3333333333333333ULL );
+		v = ( v + ( v >> 4 ) ) & 0x0f0f0f0f0f0f0f0fULL;
+		return ( uint32_t ) ( ( v * 0x0101010101010101ULL ) >> 56 );
+#endif
+	}
+
+	/* population count of both 64-bit lanes, the results are in the low 16 bits of each lane */
+	static inline __m128i _sgmPopcount2( __m128i v )
+	{
+		const __m128i m1 = _mm_set1_epi8( 0x55 );
+		const __m128i m2 = _mm_set1_epi8( 0x33 );
+		const __m128i m4 = _mm_set1_epi8( 0x0f );
+		v = _mm_sub_epi8( v, _mm_and_si128( _mm_srli_epi16( v, 1 ), m1 ) );
+		v = _mm_add_epi8( _mm_and_si128( v, m2 ), _mm_and_si128( _mm_srli_epi16( v, 2 ), m2 ) );
+		v = _mm_and_si128( _mm_add_epi8( v, _mm_srli_epi16( v, 4 ) ), m4 );
+		return _mm_sad_epu8( v, _mm_setzero_si128() );
+	}
+
+	/* hamming distances of v to 8 consecutive signatures */
+	static inline void _sgmHamming8( uint8_t* dst, const __m128i& v, const uint64_t* census )
+	{
+		__m128i h[ 4 ];
+		for( int k = 0; k < 4; k++ ) {
+			h[ k ] = _sgmPopcount2( _mm_xor_si128( v, _mm_loadu_si128( ( const __m128i* ) ( census + 2 * k ) ) ) );
+			h[ k ] = _mm_shuffle_epi32( h[ k ], _MM_SHUFFLE( 3, 1, 2, 0 ) );
+		}
+		__m128i lo = _mm_unpacklo_epi64( h[ 0 ], h[ 1 ] );
+		__m128i hi = _mm_unpacklo_epi64( h[ 2 ], h[ 3 ] );
+		__m128i w = _mm_packs_epi32( lo, hi );
+		_mm_storel_epi64( ( __m128i* ) dst, _mm_packus_epi16( w, w ) );
+	}
+
+	static inline int16_t _sgmHMin( __m128i v )
+	{
+		v = _mm_min_epi16( v, _mm_shuffle_epi32( v, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+		v = _mm_min_epi16( v, _mm_shuffle_epi32( v, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+		v = _mm_min_epi16( v, _mm_shufflelo_epi16( v, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+		return ( int16_t ) _mm_cvtsi128_si32( v );
+	}
+
+	/*
+	   One step of NP paths ending in the same pixel:
+	   L( p, d ) = C( p, d ) + min( L( p - r, d ), L( p - r, d +- 1 ) + P1, min L( p - r ) + P2 ) - min L( p - r )
+	   prev needs valid guard entries at -1 and disp. The minima of the new path costs are stored in mins,
+	   with ACC the path costs are added to sum.
+	 */
+	template<bool ACC, int NP>
+	static inline void _sgmPathStep( int16_t* const* cur, const int16_t* const* prev, const int16_t* minprev, int16_t* mins,
+									 const uint8_t* cost, uint16_t* sum, size_t disp, const __m128i& p1, int16_t p2 )
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128i mp[ NP ], mp2[ NP ], vmin[ NP ];
+
+		for( int k = 0; k < NP; k++ ) {
+			mp[ k ] = _mm_set1_epi16( minprev[ k ] );
+			mp2[ k ] = _mm_set1_epi16( minprev[ k ] + p2 );
+			vmin[ k ] = _mm_set1_epi16( SGM_INF );
+		}
+
+		for( size_t d = 0; d < disp; d += 8 ) {
+			__m128i cst = _mm_unpacklo_epi8( _mm_loadl_epi64( ( const __m128i* ) ( cost + d ) ), zero );
+			__m128i total = zero;
+			for( int k = 0; k < NP; k++ ) {
+				const int16_t* pk = prev[ k ] + d;
+				__m128i a = _mm_load_si128( ( const __m128i* ) pk );
+				__m128i b = _mm_adds_epi16( _mm_loadu_si128( ( const __m128i* ) ( pk - 1 ) ), p1 );
+				__m128i c = _mm_adds_epi16( _mm_loadu_si128( ( const __m128i* ) ( pk + 1 ) ), p1 );
+				__m128i m = _mm_min_epi16( _mm_min_epi16( a, b ), _mm_min_epi16( c, mp2[ k ] ) );
+				__m128i l = _mm_sub_epi16( _mm_add_epi16( cst, m ), mp[ k ] );
+				_mm_store_si128( ( __m128i* ) ( cur[ k ] + d ), l );
+				vmin[ k ] = _mm_min_epi16( vmin[ k ], l );
+				total = _mm_add_epi16( total, l );
+			}
+			if( ACC ) {
+				__m128i* s = ( __m128i* ) ( sum + d );
+				_mm_store_si128( s, _mm_adds_epu16( _mm_load_si128( s ), total ) );
+			}
+		}
+
+		for( int k = 0; k < NP; k++ )
+			mins[ k ] = _sgmHMin( vmin[ k ] );
+	}
+
+	/* 9x7 census signature with replicated borders */
+	class SGMCensusBody {
+		public:
+			SGMCensusBody( uint64_t* dst, const uint8_t* src, size_t stride, size_t width, size_t height ) :
+				_dst( dst ), _src( src ), _stride( stride ), _width( width ), _height( height )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				const int w = ( int ) _width;
+				const int h = ( int ) _height;
+				const uint8_t* rows[ 2 * SGM_CENSUSRY + 1 ];
+
+				for( size_t y = begin; y < end; y++ ) {
+					for( int dy = -SGM_CENSUSRY; dy <= SGM_CENSUSRY; dy++ )
+						rows[ dy + SGM_CENSUSRY ] = _src + Math::clamp( ( int ) y + dy, 0, h - 1 ) * _stride;
+					const uint8_t* center = rows[ SGM_CENSUSRY ];
+					uint64_t* dst = _dst + y * _width;
+
+					/* blocks of 16 pixels in the interior, scalar code with replicated borders for the rest */
+					int x0 = 0, x1 = 0;
+					if( w >= 16 + 2 * SGM_CENSUSRX ) {
+						x0 = x1 = SGM_CENSUSRX;
+						for( ; x1 + 16 + SGM_CENSUSRX <= w; x1 += 16 )
+							censusBlock( dst + x1, rows, x1 );
+					}
+
+					for( int x = 0; x < w; x++ ) {
+						if( x == x0 )
+							x = x1;
+						if( x >= w )
+							break;
+						const uint8_t c = center[ x ];
+						uint64_t v = 0;
+						int k = 0;
+						for( int dy = 0; dy <= 2 * SGM_CENSUSRY; dy++ ) {
+							const uint8_t* r = rows[ dy ];
+							for( int dx = -SGM_CENSUSRX; dx <= SGM_CENSUSRX; dx++ ) {
+								if( dy == SGM_CENSUSRY && dx == 0 )
+									continue;
+								v |= ( uint64_t ) ( r[ Math::clamp( x + dx, 0, w - 1 ) ] < c ) << k;
+								k++;
+							}
+						}
+						dst[ x ] = v;
+					}
+				}
+			}
+
+		private:
+			/* bit k of the signature is the comparison with the k-th neighbour, collected as one byte per group of eight */
+			static inline void censusBlock( uint64_t* dst, const uint8_t* const* rows, int x )
+			{
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i c = _mm_loadu_si128( ( const __m128i* ) ( rows[ SGM_CENSUSRY ] + x ) );
+				__m128i g[ 8 ];
+				for( int i = 0; i < 8; i++ )
+					g[ i ] = zero;
+
+				int k = 0;
+				for( int dy = 0; dy <= 2 * SGM_CENSUSRY; dy++ ) {
+					for( int dx = -SGM_CENSUSRX; dx <= SGM_CENSUSRX; dx++ ) {
+						if( dy == SGM_CENSUSRY && dx == 0 )
+							continue;
+						__m128i r = _mm_loadu_si128( ( const __m128i* ) ( rows[ dy ] + x + dx ) );
+						/* r < c */
+						__m128i lt = _mm_andnot_si128( _mm_cmpeq_epi8( _mm_subs_epu8( c, r ), zero ), _mm_set1_epi8( ( char ) ( 1 << ( k & 7 ) ) ) );
+						g[ k >> 3 ] = _mm_or_si128( g[ k >> 3 ], lt );
+						k++;
+					}
+				}
+
+				/* transpose the 8 x 16 bytes to 16 signatures */
+				__m128i t[ 8 ], u[ 4 ], v[ 4 ];
+				for( int i = 0; i < 4; i++ ) {
+					t[ 2 * i ] = _mm_unpacklo_epi8( g[ 2 * i ], g[ 2 * i + 1 ] );
+					t[ 2 * i + 1 ] = _mm_unpackhi_epi8( g[ 2 * i ], g[ 2 * i + 1 ] );
+				}
+				u[ 0 ] = _mm_unpacklo_epi16( t[ 0 ], t[ 2 ] );
+				u[ 1 ] = _mm_unpackhi_epi16( t[ 0 ], t[ 2 ] );
+				u[ 2 ] = _mm_unpacklo_epi16( t[ 1 ], t[ 3 ] );
+				u[ 3 ] = _mm_unpackhi_epi16( t[ 1 ], t[ 3 ] );
+				v[ 0 ] = _mm_unpacklo_epi16( t[ 4 ], t[ 6 ] );
+				v[ 1 ] = _mm_unpackhi_epi16( t[ 4 ], t[ 6 ] );
+				v[ 2 ] = _mm_unpacklo_epi16( t[ 5 ], t[ 7 ] );
+				v[ 3 ] = _mm_unpackhi_epi16( t[ 5 ], t[ 7 ] );
+				for( int i = 0; i < 4; i++ ) {
+					_mm_storeu_si128( ( __m128i* ) ( dst + 4 * i ), _mm_unpacklo_epi32( u[ i ], v[ i ] ) );
+					_mm_storeu_si128( ( __m128i* ) ( dst + 4 * i + 2 ), _mm_unpackhi_epi32( u[ i ], v[ i ] ) );
+				}
+			}
+
+			uint64_t*		_dst;
+			const uint8_t*	_src;
+			size_t			_stride;
+			size_t			_width;
+			size_t			_height;
+	};
+
+	/* cost volume, aggregation and disparity selection of a number of stripes */
+	class SGMStripeBody {
+		public:
+			SGMStripeBody( uint8_t* dst, size_t dstride, const uint64_t* censusl, const uint64_t* censusr,
+						   size_t width, size_t height, size_t disp, size_t paths, uint16_t p1, uint16_t p2,
+						   float lrthreshold, size_t stripeHeight, size_t overlap ) :
+				_dst( dst ), _dstride( dstride ), _censusl( censusl ), _censusr( censusr ),
+				_width( width ), _height( height ), _disp( disp ), _paths( paths ), _p1( p1 ), _p2( p2 ),
+				_lrthreshold( lrthreshold ), _stripeHeight( stripeHeight ), _overlap( overlap )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				const size_t dp = _disp + 2 * SGM_PAD;
+				const size_t extrows = Math::min( _height, _stripeHeight + 2 * _overlap );
+				const size_t rowsize = _width * dp;
+
+				ScopedBuffer<uint8_t, true> cost( extrows * _width * _disp + 8 );
+				ScopedBuffer<uint16_t, true> sum( _stripeHeight * _width * _disp );
+				/* previous and current row of the three non-horizontal directions, two horizontal vectors and the start vector */
+				ScopedBuffer<int16_t, true> lbuf( 6 * rowsize + 3 * dp );
+				ScopedBuffer<int16_t, true> mins( 6 * _width );
+
+				int16_t* l = lbuf.ptr();
+				for( size_t i = 0; i < lbuf.size(); i++ )
+					l[ i ] = SGM_INF;
+				int16_t* start = l + 6 * rowsize + 2 * dp + SGM_PAD;
+				memset( start, 0, sizeof( int16_t ) * _disp );
+
+				for( size_t s = begin; s < end; s++ ) {
+					size_t y0 = s * _stripeHeight;
+					size_t y1 = Math::min( _height, y0 + _stripeHeight );
+					size_t e0 = y0 > _overlap ? y0 - _overlap : 0;
+					size_t e1 = Math::min( _height, y1 + _overlap );
+
+					costVolume( cost.ptr(), e0, e1 );
+					memset( sum.ptr(), 0, sizeof( uint16_t ) * ( y1 - y0 ) * _width * _disp );
+					aggregate<true>( sum.ptr(), cost.ptr(), l, mins.ptr(), start, e0, e1, y0, y1 );
+					aggregate<false>( sum.ptr(), cost.ptr(), l, mins.ptr(), start, e0, e1, y0, y1 );
+					for( size_t y = y0; y < y1; y++ )
+						selectRow( ( float* ) ( _dst + y * _dstride ), sum.ptr() + ( y - y0 ) * _width * _disp );
+				}
+			}
+
+		private:
+			void costVolume( uint8_t* cost, size_t e0, size_t e1 ) const
+			{
+				/* right signatures in reversed order, so the disparities of one pixel are consecutive */
+				ScopedBuffer<uint64_t, true> rev( _width );
+
+				for( size_t y = e0; y < e1; y++ ) {
+					const uint64_t* cl = _censusl + y * _width;
+					const uint64_t* cr = _censusr + y * _width;
+					uint8_t* c = cost + ( y - e0 ) * _width * _disp;
+
+					for( size_t x = 0; x < _width; x++ )
+						rev.ptr()[ x ] = cr[ _width - 1 - x ];
+
+					for( size_t x = 0; x < _width; x++ ) {
+						const uint64_t v = cl[ x ];
+						const uint64_t* r = rev.ptr() + _width - 1 - x;
+						const __m128i vv = _mm_unpacklo_epi64( _mm_loadl_epi64( ( const __m128i* ) &v ), _mm_loadl_epi64( ( const __m128i* ) &v ) );
+						size_t dmax = Math::min( x + 1, _disp );
+						size_t d = 0;
+						for( ; d + 8 <= dmax; d += 8 )
+							_sgmHamming8( c + d, vv, r + d );
+						for( ; d < dmax; d++ )
+							c[ d ] = ( uint8_t ) _sgmPopcount( v ^ r[ d ] );
+						for( ; d < _disp; d++ )
+							c[ d ] = SGM_MAXCOST;
+						c += _disp;
+					}
+				}
+			}
+
+			/*
+			   FORWARD: top to bottom with the paths from the left, top-left, top and top-right.
+			   Otherwise bottom to top with the mirrored paths.
+			   Only the rows [ y0, y1 ) of the extended stripe [ e0, e1 ) are accumulated.
+			 */
+			template<bool FORWARD>
+			void aggregate( uint16_t* sum, const uint8_t* cost, int16_t* lbuf, int16_t* mins, const int16_t* start,
+							size_t e0, size_t e1, size_t y0, size_t y1 ) const
+			{
+				const size_t dp = _disp + 2 * SGM_PAD;
+				const size_t rowsize = _width * dp;
+				const int step = FORWARD ? 1 : -1;
+				const __m128i p1 = _mm_set1_epi16( _p1 );
+				const int16_t p2 = _p2;
+				const bool diagonal = _paths == 8;
+
+				int16_t* rows[ 2 ][ 3 ];
+				int16_t* rmins[ 2 ][ 3 ];
+				for( int k = 0; k < 2; k++ ) {
+					for( int dir = 0; dir < 3; dir++ ) {
+						rows[ k ][ dir ] = lbuf + ( k * 3 + dir ) * rowsize + SGM_PAD;
+						rmins[ k ][ dir ] = mins + ( k * 3 + dir ) * _width;
+					}
+				}
+				int16_t* hbuf[ 2 ] = { lbuf + 6 * rowsize + SGM_PAD, lbuf + 6 * rowsize + dp + SGM_PAD };
+
+				for( size_t i = 0; i < e1 - e0; i++ ) {
+					const size_t y = FORWARD ? e0 + i : e1 - 1 - i;
+					const bool first = i == 0;
+					const bool acc = y >= y0 && y < y1;
+					const uint8_t* crow = cost + ( y - e0 ) * _width * _disp;
+					uint16_t* srow = sum + ( acc ? ( y - y0 ) * _width * _disp : 0 );
+					int16_t** prev = rows[ i & 1 ];
+					int16_t** cur = rows[ 1 - ( i & 1 ) ];
+					int16_t** pmin = rmins[ i & 1 ];
+					int16_t** cmin = rmins[ 1 - ( i & 1 ) ];
+
+					const int16_t* hprev = start;
+					int16_t hmin = 0;
+					int hk = 0;
+
+					for( size_t j = 0; j < _width; j++ ) {
+						const size_t x = FORWARD ? j : _width - 1 - j;
+						int16_t* lc[ 4 ];
+						const int16_t* lp[ 4 ];
+						int16_t mp[ 4 ], mn[ 4 ];
+						int np = 1;
+
+						/* along the row */
+						lc[ 0 ] = hbuf[ hk ];
+						lp[ 0 ] = hprev;
+						mp[ 0 ] = hmin;
+
+						/* from the previous row: dir 1 is vertical, dir 0 comes from x - step and dir 2 from x + step */
+						for( int dir = diagonal ? 0 : 1; dir < ( diagonal ? 3 : 2 ); dir++ ) {
+							lp[ np ] = start;
+							mp[ np ] = 0;
+							if( !first ) {
+								long px = ( long ) x + ( dir - 1 ) * step;
+								if( px >= 0 && px < ( long ) _width ) {
+									lp[ np ] = prev[ dir ] + px * dp;
+									mp[ np ] = pmin[ dir ][ px ];
+								}
+							}
+							lc[ np ] = cur[ dir ] + x * dp;
+							np++;
+						}
+
+						/* the overlap rows only feed the paths crossing rows, the path along the row is skipped there */
+						const uint8_t* c = crow + x * _disp;
+						uint16_t* s = srow + x * _disp;
+						if( diagonal ) {
+							if( acc )
+								_sgmPathStep<true, 4>( lc, lp, mp, mn, c, s, _disp, p1, p2 );
+							else
+								_sgmPathStep<false, 3>( lc + 1, lp + 1, mp + 1, mn + 1, c, s, _disp, p1, p2 );
+							cmin[ 0 ][ x ] = mn[ 1 ];
+							cmin[ 1 ][ x ] = mn[ 2 ];
+							cmin[ 2 ][ x ] = mn[ 3 ];
+						} else {
+							if( acc )
+								_sgmPathStep<true, 2>( lc, lp, mp, mn, c, s, _disp, p1, p2 );
+							else
+								_sgmPathStep<false, 1>( lc + 1, lp + 1, mp + 1, mn + 1, c, s, _disp, p1, p2 );
+							cmin[ 1 ][ x ] = mn[ 1 ];
+						}
+
+						if( acc ) {
+							hprev = lc[ 0 ];
+							hmin = mn[ 0 ];
+							hk = 1 - hk;
+						}
+					}
+				}
+			}
+
+			/* winner takes all with subpixel refinement, the right disparities are taken from the same sums */
+			void selectRow( float* dst, const uint16_t* sum ) const
+			{
+				ScopedBuffer<int16_t, true> bestr( _width + 8 );
+				ScopedBuffer<int16_t, true> dispr( _width + 8 );
+				ScopedBuffer<int, true> displ( _width );
+				const bool lrcheck = _lrthreshold >= 0.0f;
+				const __m128i eight = _mm_set1_epi16( 8 );
+				const __m128i ramp = _mm_setr_epi16( 0, 1, 2, 3, 4, 5, 6, 7 );
+				/* right disparities are stored from x - d - 7 to x - d, so the sums get reversed */
+				const __m128i rramp = _mm_setr_epi16( 7, 6, 5, 4, 3, 2, 1, 0 );
+
+				for( size_t x = 0; x < _width + 8; x++ ) {
+					bestr.ptr()[ x ] = SGM_INF;
+					dispr.ptr()[ x ] = 0;
+				}
+
+				for( size_t x = 0; x < _width; x++ ) {
+					const uint16_t* s = sum + x * _disp;
+					const size_t dmax = Math::min( x + 1, _disp );
+					/* the sums are bounded by 8 * ( SGM_MAXCOST + P2 ), signed 16-bit comparisons are fine */
+					__m128i vmin = _mm_set1_epi16( SGM_INF );
+					__m128i vidx = _mm_setzero_si128();
+					__m128i d = ramp;
+					__m128i dr = rramp;
+					size_t d0 = 0;
+
+					for( ; d0 + 8 <= dmax; d0 += 8 ) {
+						__m128i v = _mm_load_si128( ( const __m128i* ) ( s + d0 ) );
+						__m128i lt = _mm_cmplt_epi16( v, vmin );
+						vmin = _mm_min_epi16( v, vmin );
+						vidx = _mm_or_si128( _mm_and_si128( lt, d ), _mm_andnot_si128( lt, vidx ) );
+
+						if( lrcheck ) {
+							__m128i vr = _mm_shufflelo_epi16( _mm_shufflehi_epi16( v, _MM_SHUFFLE( 0, 1, 2, 3 ) ), _MM_SHUFFLE( 0, 1, 2, 3 ) );
+							vr = _mm_shuffle_epi32( vr, _MM_SHUFFLE( 1, 0, 3, 2 ) );
+							__m128i* br = ( __m128i* ) ( bestr.ptr() + x - d0 - 7 );
+							__m128i* dp = ( __m128i* ) ( dispr.ptr() + x - d0 - 7 );
+							__m128i b = _mm_loadu_si128( br );
+							__m128i ltr = _mm_cmplt_epi16( vr, b );
+							_mm_storeu_si128( br, _mm_min_epi16( vr, b ) );
+							_mm_storeu_si128( dp, _mm_or_si128( _mm_and_si128( ltr, dr ), _mm_andnot_si128( ltr, _mm_loadu_si128( dp ) ) ) );
+						}
+						d = _mm_add_epi16( d, eight );
+						dr = _mm_add_epi16( dr, eight );
+					}
+
+					int16_t m[ 8 ], idx[ 8 ];
+					_mm_storeu_si128( ( __m128i* ) m, vmin );
+					_mm_storeu_si128( ( __m128i* ) idx, vidx );
+					int best = SGM_INF;
+					int bd = 0;
+					for( int i = 0; i < 8; i++ ) {
+						if( m[ i ] < best || ( m[ i ] == best && idx[ i ] < bd ) ) {
+							best = m[ i ];
+							bd = idx[ i ];
+						}
+					}
+					for( ; d0 < dmax; d0++ ) {
+						if( s[ d0 ] < best ) {
+							best = s[ d0 ];
+							bd = ( int ) d0;
+						}
+						if( lrcheck && ( int16_t ) s[ d0 ] < bestr.ptr()[ x - d0 ] ) {
+							bestr.ptr()[ x - d0 ] = s[ d0 ];
+							dispr.ptr()[ x - d0 ] = ( int16_t ) d0;
+						}
+					}
+					displ.ptr()[ x ] = bd;
+
+					float df = ( float ) bd;
+					if( bd > 0 && bd < ( int ) dmax - 1 ) {
+						float denom = ( float ) s[ bd - 1 ] + ( float ) s[ bd + 1 ] - 2.0f * ( float ) best;
+						if( denom > 0.0f )
+							df += ( ( float ) s[ bd - 1 ] - ( float ) s[ bd + 1 ] ) / ( 2.0f * denom );
+					}
+					dst[ x ] = df;
+				}
+
+				if( !lrcheck )
+					return;
+
+				for( size_t x = 0; x < _width; x++ ) {
+					int xr = ( int ) x - displ.ptr()[ x ];
+					if( Math::abs( ( float ) ( dispr.ptr()[ xr ] - displ.ptr()[ x ] ) ) > _lrthreshold )
+						dst[ x ] = 0.0f;
+				}
+			}
+
+			uint8_t*		_dst;
+			size_t			_dstride;
+			const uint64_t*	_censusl;
+			const uint64_t*	_censusr;
+			size_t			_width;
+			size_t			_height;
+			size_t			_disp;
+			size_t			_paths;
+			uint16_t		_p1;
+			uint16_t		_p2;
+			float			_lrthreshold;
+			size_t			_stripeHeight;
+			size_t			_overlap;
+	};
+
+	SGMStereo::SGMStereo( size_t maxdisparity, size_t paths ) :
+		_maxdisp( 0 ),
+		_paths( 8 ),
+		_p1( 8 ),
+		_p2( 96 ),
+		_lrthreshold( 1.0f ),
+		_stripeHeight( 0 ),
+		_overlap( 16 )
+	{
+		setMaxDisparity( maxdisparity );
+		setPaths( paths );
+	}
+
+	SGMStereo::~SGMStereo()
+	{
+	}
+
+	/**
+	  \brief Penalties for disparity changes of one and of more than one pixel
+
+	  P2 is clamped such that the aggregated costs 8 * ( SGM_MAXCOST + P2 ) stay below
+	  SGM_INF, the winner takes all search uses signed 16-bit comparisons.
+	 */
+	void SGMStereo::setPenalties( uint16_t p1, uint16_t p2 )
+	{
+		const uint16_t maxp2 = ( SGM_INF - 1 ) / 8 - SGM_MAXCOST;
+		_p2 = Math::min( Math::max( p1, p2 ), maxp2 );
+		_p1 = Math::min( p1, _p2 );
+	}
+
+	/**
+	  \brief Number of disparities, rounded up to a multiple of 8
+	 */
+	void SGMStereo::setMaxDisparity( size_t maxdisparity )
+	{
+		_maxdisp = Math::pad( Math::max<size_t>( maxdisparity, 8 ), 8 );
+	}
+
+	/**
+	  \brief Aggregation along 4 (horizontal and vertical) or 8 paths
+	 */
+	void SGMStereo::setPaths( size_t paths )
+	{
+		if( paths != 4 && paths != 8 )
+			throw CVTException( "SGM supports 4 or 8 paths" );
+		_paths = paths;
+	}
+
+	void SGMStereo::disparityMap( Image& disparity, const Image& left, const Image& right ) const
+	{
+		if( left.width() != right.width() || left.height() != right.height() )
+			throw CVTException( "Left/Right stereo images inconsistent" );
+
+		const size_t w = left.width();
+		const size_t h = left.height();
+
+		Image gray[ 2 ];
+		left.convert( gray[ 0 ], IFormat::GRAY_UINT8, IALLOCATOR_MEM );
+		right.convert( gray[ 1 ], IFormat::GRAY_UINT8, IALLOCATOR_MEM );
+
+		std::vector<uint64_t> census[ 2 ];
+		for( int i = 0; i < 2; i++ ) {
+			census[ i ].resize( w * h );
+			IMapScoped<const uint8_t> map( gray[ i ] );
+			SGMCensusBody body( &census[ i ][ 0 ], map.base(), map.stride(), w, h );
+			parallelFor( 0, h, body, parallelGrain( h ) );
+		}
+
+		size_t stripe = _stripeHeight ? _stripeHeight : SGM_STRIPE_ROWS;
+		stripe = Math::min( stripe, h );
+
+		disparity.reallocate( w, h, IFormat::GRAY_FLOAT, IALLOCATOR_MEM );
+		IMapScoped<float> map( disparity );
+		SGMStripeBody body( ( uint8_t* ) map.base(), map.stride(), &census[ 0 ][ 0 ], &census[ 1 ][ 0 ],
+							w, h, _maxdisp, _paths, _p1, _p2, _lrthreshold, stripe, _overlap );
+		parallelFor( 0, ( h + stripe - 1 ) / stripe, body );
+	}
+
+	/**
+	  \brief Rectifies the raw images with rect before matching
+	 */
+	void SGMStereo::disparityMap( Image& disparity, const StereoRectification& rect, const Image& left, const Image& right ) const
+	{
+		Image rleft, rright;
+		rect.undistortLeft( rleft, left );
+		rect.undistortRight( rright, right );
+		disparityMap( disparity, rleft, rright );
+	}
+
+	/**
+	  \brief Depth in units of the calibrated baseline, zero for invalid pixels
+	 */
+	void SGMStereo::depthMap( Image& depth, const StereoRectification& rect, const Image& left, const Image& right ) const
+	{
+		disparityMap( depth, rect, left, right );
+
+		const StereoCameraCalibration& calib = rect.rectifiedCalibration();
+		const float fb = calib.firstCamera().focalLength().x * calib.baseLine();
+
+		IMapScoped<float> map( depth );
+		for( size_t y = 0; y < depth.height(); y++ ) {
+			float* d = map.ptr();
+			for( size_t x = 0; x < depth.width(); x++ )
+				d[ x ] = d[ x ] > 0.0f ? fb / d[ x ] : 0.0f;
+			map++;
+		}
+	}
+}
@@ -0,0 +1,92 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_SGMSTEREO_H
+#define CVT_SGMSTEREO_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/vision/StereoRectification.h>
+
+namespace cvt {
+
+	/**
+	  \brief Semi-global matching on rectified stereo pairs
+
+	  Matching costs are hamming distances of 9x7 census signatures stored as an
+	  8-bit cost volume. The costs are aggregated along 4 or 8 paths with 16-bit
+	  SSE arithmetic. The image is split into horizontal stripes which are
+	  processed in parallel. Each stripe is extended by overlap rows, so
+	  the vertical paths can settle before they reach the stripe. Memory use
+	  depends on the stripe height and not on the image height. With a stripe
+	  height of at least the image height the result is exact SGM.
+
+	  The disparities are refined to subpixel accuracy with a parabola fit.
+	  Pixels failing the left/right check are set to zero.
+	 */
+	class SGMStereo {
+		public:
+			SGMStereo( size_t maxdisparity = 128, size_t paths = 8 );
+			~SGMStereo();
+
+			void	setMaxDisparity( size_t maxdisparity );
+			size_t	maxDisparity() const { return _maxdisp; }
+			void	setPaths( size_t paths );
+			void	setPenalties( uint16_t p1, uint16_t p2 );
+			void	setLRThreshold( float maxdiff );
+			void	setStripeHeight( size_t rows, size_t overlap = 16 );
+
+			void	disparityMap( Image& disparity, const Image& left, const Image& right ) const;
+			void	disparityMap( Image& disparity, const StereoRectification& rect, const Image& left, const Image& right ) const;
+			void	depthMap( Image& depth, const StereoRectification& rect, const Image& left, const Image& right ) const;
+
+		private:
+			size_t		_maxdisp;
+			size_t		_paths;
+			uint16_t	_p1;
+			uint16_t	_p2;
+			float		_lrthreshold;
+			size_t		_stripeHeight;
+			size_t		_overlap;
+	};
+
+	/**
+	  \brief Maximal difference of the left and right disparity, negative values disable the check
+	 */
+	inline void SGMStereo::setLRThreshold( float maxdiff )
+	{
+		_lrthreshold = maxdiff;
+	}
+
+	/**
+	  \brief Rows per stripe, 0 selects the default of 64 rows
+	 */
+	inline void SGMStereo::setStripeHeight( size_t rows, size_t overlap )
+	{
+		_stripeHeight = rows;
+		_overlap = overlap;
+	}
+}
+
+#endif
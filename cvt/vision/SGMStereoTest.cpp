@@ -0,0 +1,191 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/SGMStereo.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/CVTTest.h>
+
+namespace cvt {
+
+	static float _sgmTexture( float x, float y )
+	{
+		return 0.5f + 0.2f * Math::sin( x * 0.9f + y * 0.37f ) + 0.15f * Math::sin( x * 0.23f - y * 0.61f ) + 0.1f * Math::sin( x * 1.7f + y * 1.3f );
+	}
+
+	static float _sgmForeground( float x, float y )
+	{
+		return 0.5f + 0.3f * Math::sin( x * 0.5f - y * 0.8f ) * Math::cos( x * 0.13f + y * 0.2f );
+	}
+
+	static uint8_t _sgmPixel( float v )
+	{
+		return ( uint8_t ) Math::clamp( 255.0f * v, 0.0f, 255.0f );
+	}
+
+	/* left( x ) = right( x - d( x ) ) with the slanted background disparity d( x ) = d0 + slope * x */
+	static void _sgmSlantedPair( Image& left, Image& right, size_t w, size_t h, float d0, float slope )
+	{
+		left.reallocate( w, h, IFormat::GRAY_UINT8 );
+		right.reallocate( w, h, IFormat::GRAY_UINT8 );
+
+		IMapScoped<uint8_t> ml( left );
+		IMapScoped<uint8_t> mr( right );
+		for( size_t y = 0; y < h; y++ ) {
+			uint8_t* pl = ml.ptr();
+			uint8_t* pr = mr.ptr();
+			for( size_t x = 0; x < w; x++ ) {
+				/* xl - d( xl ) = x */
+				float xl = ( ( float ) x + d0 ) / ( 1.0f - slope );
+				pl[ x ] = _sgmPixel( _sgmTexture( x, y ) );
+				pr[ x ] = _sgmPixel( _sgmTexture( xl, y ) );
+			}
+			ml++;
+			mr++;
+		}
+	}
+
+	/* constant background disparity dbg, the rectangle [ fx0, fx1 ) x [ fy0, fy1 ) of the left view has disparity dfg */
+	static void _sgmOcclusionPair( Image& left, Image& right, size_t w, size_t h, size_t dbg, size_t dfg,
+								   size_t fx0, size_t fx1, size_t fy0, size_t fy1 )
+	{
+		left.reallocate( w, h, IFormat::GRAY_UINT8 );
+		right.reallocate( w, h, IFormat::GRAY_UINT8 );
+
+		IMapScoped<uint8_t> ml( left );
+		IMapScoped<uint8_t> mr( right );
+		for( size_t y = 0; y < h; y++ ) {
+			uint8_t* pl = ml.ptr();
+			uint8_t* pr = mr.ptr();
+			bool fgrow = y >= fy0 && y < fy1;
+			for( size_t x = 0; x < w; x++ ) {
+				size_t xr = x + dfg;
+				bool fgl = fgrow && x >= fx0 && x < fx1;
+				bool fgr = fgrow && xr >= fx0 && xr < fx1;
+				pl[ x ] = _sgmPixel( fgl ? _sgmForeground( x, y ) : _sgmTexture( x, y ) );
+				pr[ x ] = _sgmPixel( fgr ? _sgmForeground( xr, y ) : _sgmTexture( x + dbg, y ) );
+			}
+			ml++;
+			mr++;
+		}
+	}
+
+	static bool _sgmSlantedTest( size_t paths )
+	{
+		const size_t w = 192, h = 96, maxdisp = 48;
+		const float d0 = 12.0f, slope = 0.08f;
+		Image left, right, disparity;
+		_sgmSlantedPair( left, right, w, h, d0, slope );
+
+		SGMStereo sgm( maxdisp, paths );
+		sgm.disparityMap( disparity, left, right );
+		if( disparity.width() != w || disparity.height() != h )
+			return false;
+
+		/* valid pixels are within one pixel of the ground truth, invalid pixels are rare */
+		IMapScoped<const float> map( disparity );
+		size_t valid = 0, bad = 0, num = 0;
+		double err = 0.0;
+		for( size_t y = 4; y < h - 4; y++ ) {
+			const float* p = map.line( y );
+			for( size_t x = maxdisp; x < w - 4; x++ ) {
+				num++;
+				if( p[ x ] == 0.0f )
+					continue;
+				float e = Math::abs( p[ x ] - ( d0 + slope * x ) );
+				valid++;
+				err += e;
+				if( e > 1.0f )
+					bad++;
+			}
+		}
+		return valid > num * 0.98 && bad < valid / 100 && err / valid < 0.35;
+	}
+
+	static bool _sgmOcclusionTest( float lrthreshold, size_t& occinvalid, size_t& occnum )
+	{
+		const size_t w = 192, h = 96, maxdisp = 48;
+		const size_t dbg = 8, dfg = 24;
+		const size_t fx0 = 96, fx1 = 144, fy0 = 24, fy1 = 72;
+		Image left, right, disparity;
+		_sgmOcclusionPair( left, right, w, h, dbg, dfg, fx0, fx1, fy0, fy1 );
+
+		SGMStereo sgm( maxdisp );
+		sgm.setLRThreshold( lrthreshold );
+		sgm.disparityMap( disparity, left, right );
+
+		IMapScoped<const float> map( disparity );
+		size_t bad = 0, num = 0;
+		occinvalid = occnum = 0;
+		for( size_t y = 4; y < h - 4; y++ ) {
+			const float* p = map.line( y );
+			bool fgrow = y >= fy0 + 2 && y < fy1 - 2;
+			for( size_t x = maxdisp; x < w - 4; x++ ) {
+				/* the background left of the rectangle is hidden in the right view */
+				if( fgrow && x + ( dfg - dbg ) >= fx0 && x < fx0 ) {
+					occnum++;
+					if( p[ x ] == 0.0f )
+						occinvalid++;
+					continue;
+				}
+				/* skip the borders of the rectangle */
+				if( y + 2 >= fy0 && y < fy1 + 2 && x + 2 >= fx0 && x < fx1 + 2 )
+					if( !( y >= fy0 + 2 && y < fy1 - 2 && x >= fx0 + 2 && x < fx1 - 2 ) )
+						continue;
+				bool fg = y >= fy0 && y < fy1 && x >= fx0 && x < fx1;
+				num++;
+				if( Math::abs( p[ x ] - ( float ) ( fg ? dfg : dbg ) ) > 1.0f )
+					bad++;
+			}
+		}
+		return bad < num / 50;
+	}
+
+}
+
+using namespace cvt;
+
+BEGIN_CVTTEST( SGMStereo )
+	bool ret = true;
+	bool b;
+
+	b = _sgmSlantedTest( 8 );
+	CVTTEST_PRINT( "SGMStereo slanted plane, 8 paths", b );
+	ret &= b;
+
+	b = _sgmSlantedTest( 4 );
+	CVTTEST_PRINT( "SGMStereo slanted plane, 4 paths", b );
+	ret &= b;
+
+	size_t occinvalid, occnum, occinvalidnocheck, occnumnocheck;
+	b = _sgmOcclusionTest( 1.0f, occinvalid, occnum );
+	b &= _sgmOcclusionTest( -1.0f, occinvalidnocheck, occnumnocheck );
+	/* the left/right check invalidates most of the occluded pixels, without it all get a disparity */
+	b &= occinvalid > occnum * 0.9 && occinvalidnocheck == 0;
+	CVTTEST_PRINT( "SGMStereo occlusion and left/right check", b );
+	ret &= b;
+
+	return ret;
+END_CVTTEST
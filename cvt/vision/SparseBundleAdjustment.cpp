@@ -29,6 +29,8 @@
 #include <cvt/math/Math.h>
 #include <cvt/math/SE3.h>
 #include <cvt/vision/Vision.h>
+#include <cvt/util/Profiler.h>
+#include <cvt/util/ThreadPool.h>
 
 #include <cstring>
 
@@ -72,6 +74,7 @@ namespace cvt {
 
     void SparseBundleAdjustment::optimize( SlamMap & map, const TerminationCriteria<double> & criteria )
     {
+        CVT_PROFILE_SCOPE( "SparseBundleAdjustment::optimize" );
         _iterations = 0;
         _costs	    = 0.0;
 
@@ -141,6 +144,11 @@ namespace cvt {
                 break;
             }
 
+            // rejected steps do not count as iterations: stop once the
+            // damping is so large that no further progress is possible
+            if( _lambda > 1e12 )
+                break;
+
         }
     }
 
@@ -311,75 +319,110 @@ namespace cvt {
         _sparseReduced.finalize();
     }
 
+    struct SBAFillColumns {
+        SBAFillColumns( SparseBundleAdjustment& sba, const SlamMap& map ) : _sba( sba ), _map( map ) {}
+
+        void operator()( size_t begin, size_t end ) const
+        {
+            for( size_t c = begin; c < end; c++ )
+                _sba.fillSparseMatrixColumn( _map, c );
+        }
+
+        SparseBundleAdjustment& _sba;
+        const SlamMap&          _map;
+    };
+
     void SparseBundleAdjustment::fillSparseMatrix( const SlamMap & map )
+    {
+        // every camera only writes its own block column of the preallocated pattern
+        size_t numCams = map.numKeyframes();
+        parallelFor( 0, numCams, SBAFillColumns( *this, map ), parallelGrain( numCams ) );
+    }
+
+    void SparseBundleAdjustment::fillSparseMatrixColumn( const SlamMap & map, size_t c )
     {
         // according to the joint Point tracks, we can now fill our matrix:
         CamJTJ tmpBlock;
         Eigen::Matrix<double, camParamDim, pointParamDim> tmpEval;
         CamResidualType tmpRes;
 
-        size_t numCams = map.numKeyframes();
-        for( size_t c = 0; c < numCams; c++ ){
-            // first create block for this cam:
-            tmpBlock = _camsJTJ[ c ];
-            tmpRes   = _camResiduals[ c ];
-
-			// augment the jacobian diagonal
-            //tmpBlock.diagonal().array() += _lambda;
-            tmpBlock.diagonal().array() *= ( 1.0 + _lambda );
-
-            // go over all point measures:
-            const Keyframe & k = map.keyframeForId( c );
-            Keyframe::MeasurementIterator measIter = k.measurementsBegin();
-            Keyframe::MeasurementIterator measEnd  = k.measurementsEnd();
-            while( measIter != measEnd ){
-                size_t pointId = measIter->first;
-
-                const Eigen::Matrix<double, camParamDim, pointParamDim> & cp = _camPointJTJ.block( c, pointId );
-                tmpEval = cp * _invAugPJTJ[ pointId ];
-                tmpBlock -= tmpEval * cp.transpose();
-                tmpRes   -= tmpEval * _pointResiduals[ pointId ];
-
-                ++measIter;
-            }
+        // first create block for this cam:
+        tmpBlock = _camsJTJ[ c ];
+        tmpRes   = _camResiduals[ c ];
 
-            // set the block in the sparse matrix:
-            setBlockInReducedSparse( tmpBlock, c, c );
-            _reducedRHS.segment<camParamDim>( camParamDim * c ) = tmpRes;
+        // augment the jacobian diagonal
+        //tmpBlock.diagonal().array() += _lambda;
+        tmpBlock.diagonal().array() *= ( 1.0 + _lambda );
 
+        // go over all point measures:
+        const Keyframe & k = map.keyframeForId( c );
+        Keyframe::MeasurementIterator measIter = k.measurementsBegin();
+        Keyframe::MeasurementIterator measEnd  = k.measurementsEnd();
+        while( measIter != measEnd ){
+            size_t pointId = measIter->first;
 
-            JointMeasurements::ConstMapIterType iter   = _jointMeasures.secondEntityIteratorBegin( c );
-            JointMeasurements::ConstMapIterType iStop  = _jointMeasures.secondEntityIteratorEnd( c );
-            while( iter != iStop ){
-                size_t c2 = iter->first; // id of second cam:
+            const Eigen::Matrix<double, camParamDim, pointParamDim> & cp = _camPointJTJ.block( c, pointId );
+            tmpEval = cp * _invAugPJTJ[ pointId ];
+            tmpBlock -= tmpEval * cp.transpose();
+            tmpRes   -= tmpEval * _pointResiduals[ pointId ];
 
-                // iterate over the joint measurements of the two cameras
-                std::set<size_t>::const_iterator pIdIter = iter->second.begin();
-                std::set<size_t>::const_iterator pEnd    = iter->second.end();
-                tmpBlock.setZero();
-                while( pIdIter != pEnd ){
-                    size_t pId = *pIdIter;
-                    tmpBlock -= _camPointJTJ.block( c, pId ) * _invAugPJTJ[ pId ] * _camPointJTJ.block( c2, pId ).transpose();
-                    ++pIdIter;
-                }
-                ++iter;
+            ++measIter;
+        }
+
+        // set the block in the sparse matrix:
+        setBlockInReducedSparse( tmpBlock, c, c );
+        _reducedRHS.segment<camParamDim>( camParamDim * c ) = tmpRes;
 
-                setBlockInReducedSparse( tmpBlock.transpose(), c2, c );
+
+        JointMeasurements::ConstMapIterType iter   = _jointMeasures.secondEntityIteratorBegin( c );
+        JointMeasurements::ConstMapIterType iStop  = _jointMeasures.secondEntityIteratorEnd( c );
+        while( iter != iStop ){
+            size_t c2 = iter->first; // id of second cam:
+
+            // iterate over the joint measurements of the two cameras
+            std::set<size_t>::const_iterator pIdIter = iter->second.begin();
+            std::set<size_t>::const_iterator pEnd    = iter->second.end();
+            tmpBlock.setZero();
+            while( pIdIter != pEnd ){
+                size_t pId = *pIdIter;
+                tmpBlock -= _camPointJTJ.block( c, pId ) * _invAugPJTJ[ pId ] * _camPointJTJ.block( c2, pId ).transpose();
+                ++pIdIter;
             }
+            ++iter;
+
+            setBlockInReducedSparse( tmpBlock.transpose(), c2, c );
         }
     }
 
+    struct SBAInvertPointHessians {
+        typedef SparseBundleAdjustment::PointJTJ PointJTJ;
+
+        SBAInvertPointHessians( PointJTJ* invAug, const PointJTJ* jtj, double lambda ) :
+            _invAug( invAug ), _jtj( jtj ), _lambda( lambda )
+        {
+        }
+
+        void operator()( size_t begin, size_t end ) const
+        {
+            PointJTJ inv;
+            for( size_t i = begin; i < end; i++ ){
+                inv = _jtj[ i ];
+                // augment the diagonal:
+                //inv.diagonal().array() += _lambda;
+                inv.diagonal().array() *= ( 1.0 + _lambda );
+                // TODO: is there a way to exploit symmetry when inverting with Eigen?
+                _invAug[ i ] = inv.inverse();
+            }
+        }
+
+        PointJTJ*       _invAug;
+        const PointJTJ* _jtj;
+        double          _lambda;
+    };
+
     void SparseBundleAdjustment::updateInverseAugmentedPointHessians()
     {
-        PointJTJ inv;
-        for( size_t i = 0; i < _nPts; i++ ){
-            inv = _pointsJTJ[ i ];
-            // augment the diagonal:
-            //inv.diagonal().array() += _lambda;
-            inv.diagonal().array() *= ( 1.0 + _lambda );
-            // TODO: is there a way to exploit symmetry when inverting with Eigen?
-            _invAugPJTJ[ i ] = inv.inverse();
-        }
+        parallelFor( 0, _nPts, SBAInvertPointHessians( _invAugPJTJ, _pointsJTJ, _lambda ), parallelGrain( _nPts ) );
     }
 
     void SparseBundleAdjustment::setBlockInReducedSparse( const CamJTJ & m,
@@ -402,19 +445,60 @@ namespace cvt {
         }
     }
 
+    struct SBASolveStructure {
+        SBASolveStructure( SparseBundleAdjustment& sba,
+                           Eigen::VectorXd& deltaStruct,
+                           const Eigen::VectorXd& deltaCam,
+                           SlamMap& map,
+                           std::vector<double>& costs,
+                           size_t grain ) :
+            _sba( sba ), _deltaStruct( deltaStruct ), _deltaCam( deltaCam ), _map( map ), _costs( costs ), _grain( grain )
+        {
+        }
+
+        void operator()( size_t begin, size_t end ) const
+        {
+            _costs[ begin / _grain ] = _sba.solveStructure( _deltaStruct, _deltaCam, _map, begin, end );
+        }
+
+        SparseBundleAdjustment& _sba;
+        Eigen::VectorXd&        _deltaStruct;
+        const Eigen::VectorXd&  _deltaCam;
+        SlamMap&                _map;
+        std::vector<double>&    _costs;
+        size_t                  _grain;
+    };
+
     void SparseBundleAdjustment::solveStructure( Eigen::VectorXd & deltaStruct,
                                                  const Eigen::VectorXd & deltaCam,
                                                  SlamMap & map )
     {
+        // points are independent, sum the costs per chunk to stay deterministic
         size_t nPts = map.numFeatures();
+        size_t grain = parallelGrain( nPts );
+        std::vector<double> costs( ( nPts + grain - 1 ) / grain, 0.0 );
+        parallelFor( 0, nPts, SBASolveStructure( *this, deltaStruct, deltaCam, map, costs, grain ), grain );
+
+        _costs = 0.0;
+        for( size_t i = 0; i < costs.size(); i++ )
+            _costs += costs[ i ];
+        _costs /= _nMeas;
+    }
+
+    double SparseBundleAdjustment::solveStructure( Eigen::VectorXd & deltaStruct,
+                                                   const Eigen::VectorXd & deltaCam,
+                                                   SlamMap & map,
+                                                   size_t begin,
+                                                   size_t end )
+    {
         Eigen::Vector3d res;
         Eigen::Vector3d tmp;
         Eigen::Vector2d pp, r;
 
         const Eigen::Matrix3d & K = map.intrinsics();
 
-        _costs = 0.0;
-        for( size_t i = 0; i < nPts; i++ ){
+        double costs = 0.0;
+        for( size_t i = begin; i < end; i++ ){
             MapFeature& f = map.featureForId( i );
             MapFeature::ConstPointTrackIterator camIter = f.pointTrackBegin();
             const MapFeature::ConstPointTrackIterator itEnd = f.pointTrackEnd();
@@ -444,11 +528,11 @@ namespace cvt {
                 // get the measurement of point i in keyframe *camIter:
                 const MapMeasurement & meas = kf.measurementForId( i );
                 r = ( meas.point - pp );
-                _costs += ( r.transpose() * meas.information * r );
+                costs += ( r.transpose() * meas.information * r );
                 ++camIter;
             }
         }
-        _costs /= _nMeas;
+        return costs;
     }
 
     void SparseBundleAdjustment::undoStep( const Eigen::VectorXd & dCam,
@@ -115,6 +115,7 @@ namespace cvt {
 			void buildReducedCameraSystem( const SlamMap & map );
 			void evaluateApproxHessians( const SlamMap & map );
 			void fillSparseMatrix( const SlamMap & map );
+			void fillSparseMatrixColumn( const SlamMap & map, size_t cam );
 
 			// calculate the augmented inverse Hessians of the points:
 			void updateInverseAugmentedPointHessians();
@@ -138,6 +139,13 @@ namespace cvt {
 								 const Eigen::VectorXd & deltaCam,
 								 SlamMap & map );
 
+			/* solve the points [begin, end), returns their costs */
+			double solveStructure( Eigen::VectorXd & deltaStruct,
+								   const Eigen::VectorXd & deltaCam,
+								   SlamMap & map,
+								   size_t begin,
+								   size_t end );
+
 			void undoStep( const Eigen::VectorXd & dCam,
 						   const Eigen::VectorXd & dPoint,
 						   SlamMap & map );
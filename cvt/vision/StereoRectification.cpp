@@ -28,29 +28,60 @@
 namespace cvt {
 
 	StereoRectification::StereoRectification( const CameraCalibration& left,
-											  const CameraCalibration& right )
+											  const CameraCalibration& right,
+											  bool halfsize )
 	{
+		size_t w = left.width();
+		size_t h = left.height();
+
+		if( !w || !h || w != right.width() || h != right.height() )
+			throw CVTException( "Stereo rectification needs calibrations with equal, valid image sizes" );
+
 		StereoCameraCalibration scalib( left, right );
-		size_t w = 0;
-		size_t h = 0;
-		//_leftWarp.re
-		scalib.undistortRectify( _rectifiedCalibration, _leftWarp, _rightWarp, w, h );
+		Image leftWarp( w, h, IFormat::GRAYALPHA_FLOAT );
+		Image rightWarp( w, h, IFormat::GRAYALPHA_FLOAT );
+		scalib.undistortRectify( _rectifiedCalibration, leftWarp, rightWarp, w, h );
+
+		_leftMap.update( leftWarp, w, h, halfsize );
+		_rightMap.update( rightWarp, w, h, halfsize );
+
+		CameraCalibration cam0 = _rectifiedCalibration.firstCamera();
+		CameraCalibration cam1 = _rectifiedCalibration.secondCamera();
+		if( halfsize ) {
+			/* pixel x of the half size image covers the original pixels 2x and 2x + 1 */
+			Matrix3f K0 = cam0.intrinsics();
+			Matrix3f K1 = cam1.intrinsics();
+			for( size_t i = 0; i < 2; i++ ) {
+				K0[ i ][ i ] *= 0.5f;
+				K1[ i ][ i ] *= 0.5f;
+				K0[ i ][ 2 ] = ( K0[ i ][ 2 ] - 0.5f ) * 0.5f;
+				K1[ i ][ 2 ] = ( K1[ i ][ 2 ] - 0.5f ) * 0.5f;
+			}
+			cam0.setIntrinsics( K0 );
+			cam1.setIntrinsics( K1 );
+		}
+		cam0.setWidth( _leftMap.width() );
+		cam0.setHeight( _leftMap.height() );
+		cam1.setWidth( _rightMap.width() );
+		cam1.setHeight( _rightMap.height() );
+		_rectifiedCalibration.setFirstCamera( cam0 );
+		_rectifiedCalibration.setSecondCamera( cam1 );
 	}
 
 	StereoRectification::StereoRectification( const StereoRectification& other ):
 		_rectifiedCalibration( other._rectifiedCalibration ),
-		_leftWarp( other._leftWarp ),
-		_rightWarp( other._rightWarp )
+		_leftMap( other._leftMap ),
+		_rightMap( other._rightMap )
 	{}
 
 	void StereoRectification::undistortLeft( Image& out, const Image& in ) const
 	{
-		IWarp::apply( out, in, _leftWarp );
+		_leftMap.apply( out, in );
 	}
 
 	void StereoRectification::undistortRight( Image& out, const Image& in ) const
 	{
-		IWarp::apply( out, in, _rightWarp );
+		_rightMap.apply( out, in );
 	}
 
 }
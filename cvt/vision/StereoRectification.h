@@ -26,21 +26,31 @@
 #define CVT_STEREO_RECTIFICATION_H
 
 #include <cvt/vision/StereoCameraCalibration.h>
+#include <cvt/gfx/IRemap.h>
 
 namespace cvt {
 
+	/**
+	  \brief Undistortion and rectification of stereo image pairs
+
+	  The rectifying warps are converted to compact fixed-point remap tables
+	  ( see IRemap ). Bayer RGGB input is demosaiced while remapping and with
+	  halfsize set the rectified images have half the calibrated resolution.
+	 */
 	class StereoRectification {
 		public:
-			StereoRectification( const CameraCalibration& left, const CameraCalibration& right );
+			StereoRectification( const CameraCalibration& left, const CameraCalibration& right, bool halfsize = false );
 			StereoRectification( const StereoRectification& other );
 
 			void undistortLeft( Image& out, const Image& in ) const;
 			void undistortRight( Image& out, const Image& in ) const;
 
+			const StereoCameraCalibration& rectifiedCalibration() const { return _rectifiedCalibration; }
+
 		private:
 			StereoCameraCalibration _rectifiedCalibration;
-			Image	_leftWarp;
-			Image	_rightWarp;
+			IRemap	_leftMap;
+			IRemap	_rightMap;
 	};
 
 }
@@ -24,6 +24,7 @@
 
 #include <cvt/vision/TSDFVolume.h>
 #include <cvt/cl/kernel/TSDFVolume/TSDFVolume.h>
+#include <cvt/util/Profiler.h>
 
 namespace cvt
 {
@@ -60,6 +61,7 @@ namespace cvt
 
 	void TSDFVolume::addDepthMap( const Matrix4f& proj, const Image& depthmap, float scale )
 	{
+		CVT_PROFILE_SCOPE( "TSDFVolume::addDepthMap" );
 		// update projection matrix
 		Matrix4f projall = proj * _g2w;
 
@@ -92,6 +94,7 @@ namespace cvt
 
 	void TSDFVolume::rayCastDepthMap( Image& depthmap, const Matrix4f& proj, float scale )
 	{
+		CVT_PROFILE_SCOPE( "TSDFVolume::rayCastDepthMap" );
 		Matrix4f projall = proj * _g2w;
 
 		depthmap.reallocate( depthmap.width(), depthmap.height(), IFormat::GRAY_FLOAT, IALLOCATOR_CL );
@@ -28,6 +28,7 @@
 #include <cvt/vision/features/agast/Agast5_8.h>
 #include <cvt/vision/features/agast/Agast7_12d.h>
 #include <cvt/vision/features/agast/Agast7_12s.h>
+#include <cvt/util/Profiler.h>
 
 namespace cvt
 {
@@ -48,10 +49,17 @@ namespace cvt
 
     AGAST::~AGAST()
     {
+        delete _astDetector;
+    }
+
+    AGAST* AGAST::clone() const
+    {
+        return new AGAST( _astType, _threshold, _border );
     }
 
     void AGAST::detect( FeatureSet& features, const Image& img )
     {
+        CVT_PROFILE_SCOPE( "AGAST::detect" );
         if( img.format() != IFormat::GRAY_UINT8 )
             throw CVTException( "Input Image format must be GRAY_UINT8" );
 
@@ -61,6 +69,7 @@ namespace cvt
 
     void AGAST::detect( FeatureSet& featureSet, const ImagePyramid& imgpyr )
     {
+        CVT_PROFILE_SCOPE( "AGAST::detect" );
         if( imgpyr[ 0 ].format() != IFormat::GRAY_UINT8 )
             throw CVTException( "Input Image format must be GRAY_UINT8" );
 
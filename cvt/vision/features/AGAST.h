@@ -43,6 +43,7 @@ namespace cvt {
             AGAST( ASTType astType, uint8_t threshold = 30, size_t border = 3 );
             ~AGAST();
 
+            AGAST* clone() const;
             void detect( FeatureSet& features, const Image& image );
             void detect( FeatureSet& features, const ImagePyramid& image );
 
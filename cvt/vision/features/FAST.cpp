@@ -24,6 +24,7 @@
 
 #include <cvt/vision/features/FAST.h>
 #include <cvt/gfx/IScaleFilter.h>
+#include <cvt/util/Profiler.h>
 
 namespace cvt
 {
@@ -39,8 +40,14 @@ namespace cvt
 	{
 	}
 
+	FAST* FAST::clone() const
+	{
+		return new FAST( _fastSize, _threshold, _border );
+	}
+
 	void FAST::detect( FeatureSet& featureset, const Image& img )
 	{
+		CVT_PROFILE_SCOPE( "FAST::detect" );
 		if( img.format() != IFormat::GRAY_UINT8 )
 			throw CVTException( "Input Image format must be GRAY_UINT8" );
 
@@ -67,6 +74,7 @@ namespace cvt
 
 	void FAST::detect( FeatureSet& featureset, const ImagePyramid& imgpyr )
 	{
+		CVT_PROFILE_SCOPE( "FAST::detect" );
 		if( imgpyr[ 0 ].format() != IFormat::GRAY_UINT8 )
 			throw CVTException( "Input Image format must be GRAY_UINT8" );
 
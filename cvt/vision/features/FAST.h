@@ -48,6 +48,7 @@ namespace cvt
 			FAST( FASTSize size = SEGMENT_9, uint8_t threshold = 30, size_t border = 3 );
 			~FAST();
 
+			FAST* clone() const;
 			void detect( FeatureSet& features, const Image& image );
 			void detect( FeatureSet& features, const ImagePyramid& image );
 
@@ -24,8 +24,20 @@
 
 
 #include <cvt/vision/features/Harris.h>
+#include <cvt/util/Profiler.h>
 
 namespace cvt {
 	const float Harris::_kappa = 0.04f; // 0.04 to 0.15 - TODO: make parameter
 	const int	Harris::_radius = 3;
+
+	void Harris::detect( FeatureSet& features, const Image& image )
+	{
+		CVT_PROFILE_SCOPE( "Harris::detect" );
+		if( image.format() == IFormat::GRAY_FLOAT )
+			detectFloat( features, image );
+		else if( image.format() == IFormat::GRAY_UINT8 )
+			detectU8( features, image );
+		else
+			throw CVTException( "Input Image format must be GRAY_FLOAT or GRAY_UINT8" );
+	}
 }
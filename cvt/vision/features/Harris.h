@@ -40,6 +40,7 @@ namespace cvt
 			Harris( float threshold = 5e-5f, size_t border = 3 );
 			~Harris();
 
+			Harris* clone() const;
 			void detect( FeatureSet& features, const Image& image );
 			void detect( FeatureSet& features, const ImagePyramid& image );
 
@@ -70,15 +71,9 @@ namespace cvt
 	{
 	}
 
-	inline void Harris::detect( FeatureSet& features, const Image& image )
+	inline Harris* Harris::clone() const
 	{
-		if( image.format() == IFormat::GRAY_FLOAT )
-			detectFloat( features, image );
-		else if( image.format() == IFormat::GRAY_UINT8 )
-			detectU8( features, image );
-		else
-			throw CVTException( "Input Image format must be GRAY_FLOAT or GRAY_UINT8" );
-
+		return new Harris( _threshold, _border );
 	}
 
 	inline void Harris::detectFloat( FeatureSet& features, const Image& image )
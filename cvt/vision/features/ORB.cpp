@@ -23,6 +23,7 @@
 */
 
 #include <cvt/vision/features/ORB.h>
+#include <cvt/util/Profiler.h>
 
 namespace cvt {
 
@@ -32,4 +33,137 @@ namespace cvt {
 	};
 
 	#include "ORBPattern.h"
+
+	void ORB::extract( const ImagePyramid& pyr, const FeatureSet& features )
+	{
+		CVT_PROFILE_SCOPE( "ORB::extract" );
+		if( pyr[ 0 ].channels() != 1 ||
+			( pyr[ 0 ].format() != IFormat::GRAY_UINT8 && pyr[ 0 ].format() != IFormat::GRAY_FLOAT ) )
+			throw CVTException( "Unimplemented" );
+
+		ImagePyramid integralPyr( pyr.octaves(), pyr.scaleFactor() );
+		pyr.integralImage( integralPyr );
+
+		size_t octaves = pyr.octaves();
+		std::vector<IMapScoped<const float>*> maps;
+		std::vector<float> scales;
+		for( size_t i = 0; i < octaves; ++i ){
+			maps.push_back( new IMapScoped<const float>( integralPyr[ i ] ) );
+			scales.push_back( Math::pow( integralPyr.scaleFactor(), ( float )i ) );
+		}
+
+		size_t iend = features.size();
+		Vector2f vs;
+		for( size_t i = 0; i < iend; ++i ) {
+			_features.push_back( Descriptor( features[ i ] ) );
+			Descriptor& desc = _features.back();
+			size_t o = desc.octave;
+			vs = desc.pt * scales[ o ];
+
+			desc.angle = centroidAngle( vs, *maps[ o ] );
+			descriptor( desc, vs, *maps[ o ] );
+		}
+
+		for( size_t i = 0; i < octaves; ++i ){
+			delete maps[ i ];
+		}
+	}
+
+	void ORB::extract( const Image& img, const FeatureSet& features )
+	{
+		CVT_PROFILE_SCOPE( "ORB::extract" );
+		if( img.channels() != 1 ||
+			( img.format() != IFormat::GRAY_UINT8 && img.format() != IFormat::GRAY_FLOAT ) )
+			throw CVTException( "Unimplemented" );
+
+		IntegralImage iimage( img );
+		IMapScoped<const float> map( iimage.sumImage() );
+
+		size_t iend = features.size();
+		for( size_t i = 0; i < iend; ++i ) {
+			_features.push_back( Descriptor( features[ i ] ) );
+			Descriptor& desc = _features.back();
+			desc.angle = centroidAngle( desc.pt, map );
+			descriptor( desc, desc.pt, map );
+		}
+	}
+
+	void ORB::matchBruteForce( std::vector<FeatureMatch>& matches, const FeatureDescriptorExtractor& other, float distThresh ) const
+	{
+		CVT_PROFILE_SCOPE( "ORB::matchBruteForce" );
+		DistFunc dfunc;
+		FeatureMatcher::matchBruteForce<Descriptor,DistFunc>( matches, this->_features, ( ( const ORB& ) other)._features, dfunc, distThresh );
+	}
+
+	void ORB::matchInWindow( std::vector<MatchingIndices>& matches,
+							  const std::vector<FeatureDescriptor*>& other,
+							  float maxFeatureDist,
+							  float maxDescDistance ) const
+	{
+		CVT_PROFILE_SCOPE( "ORB::matchInWindow" );
+		DistFunc dfunc;
+		FeatureMatcher::matchInWindow<Descriptor, DistFunc>( matches,
+															 other,
+															 this->_features,
+															 dfunc,
+															 maxFeatureDist,
+															 maxDescDistance );
+	}
+
+	void ORB::matchInWindow( std::vector<MatchingIndices>& matches,
+							  const RowLookupTable& rlt,
+							  const std::vector<FeatureDescriptor*>& other,
+							  float maxFeatureDist,
+							  float maxDescDistance ) const
+	{
+		CVT_PROFILE_SCOPE( "ORB::matchInWindow" );
+		DistFunc dfunc;
+		FeatureMatcher::matchInWindow<Descriptor, DistFunc>( matches,
+															 rlt,
+															 other,
+															 this->_features,
+															 dfunc,
+															 maxFeatureDist,
+															 maxDescDistance );
+	}
+
+	void ORB::scanLineMatch( std::vector<FeatureMatch>& matches,
+							  const std::vector<const FeatureDescriptor*>& left,
+							  float minDisp,
+							  float maxDisp,
+							  float maxDescDist,
+							  float maxLineDist ) const
+	{
+		CVT_PROFILE_SCOPE( "ORB::scanLineMatch" );
+		DistFunc dfunc;
+		FeatureMatcher::scanLineMatch( matches,
+									   left,
+									   _features,
+									   dfunc,
+									   minDisp,
+									   maxDisp,
+									   maxDescDist,
+									   maxLineDist );
+	}
+
+    void ORB::scanLineMatch( std::vector<FeatureMatch>& matches,
+                             const RowLookupTable& rlt,
+                             const std::vector<const FeatureDescriptor*>& left,
+                             float minDisp,
+                             float maxDisp,
+                             float maxDescDist,
+                             float maxLineDist ) const
+    {
+        CVT_PROFILE_SCOPE( "ORB::scanLineMatch" );
+        DistFunc dfunc;
+        FeatureMatcher::scanLineMatch( matches,
+                                       rlt,
+                                       left,
+                                       _features,
+                                       dfunc,
+                                       minDisp,
+                                       maxDisp,
+                                       maxDescDist,
+                                       maxLineDist );
+    }
 }
@@ -36,8 +36,7 @@ namespace cvt {
 //    {
 //        typedef ...   ParameterType; -> parameter (vector) representation
 //        typedef ...   JacobianType; -> typedef for Jacobian
-//        typedef std::vector<JacobianType,
-//                            Eigen::aligned_allocator<JacobianType> > JacobianVectorType;
+//        typedef JacobianArray<JacobianType> JacobianVectorType; -> SoA storage of the jacobians
 //        typedef ...   HessianType; -> typedef for Hessian (J^TJ)
 //        typedef ... ResidualType;
 //        typedef std::vector<ResidualType>       ResidualVectorType;
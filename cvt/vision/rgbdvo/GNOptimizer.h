@@ -83,7 +83,7 @@ namespace cvt {
             result.numPixels = residuals.size();
             result.costs = this->evaluateSystem( hessian,
                                                  deltaSum,
-                                                 &jacobians[ 0 ],
+                                                 jacobians,
                                                  &residuals[ 0 ],
                                                  residuals.size() );
 
@@ -0,0 +1,141 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_JACOBIANARRAY_H
+#define CVT_JACOBIANARRAY_H
+
+#include <vector>
+#include <string.h>
+#include <Eigen/Core>
+#include <Eigen/StdVector>
+#include <cvt/math/Math.h>
+
+namespace cvt {
+
+    /**
+     * \class JacobianArray
+     * \brief Structure of arrays storage for per pixel jacobians (1 x N rows)
+     *
+     * Each parameter is stored in its own 16 byte aligned column, so the
+     * normal equations can be accumulated with SIMD dot products.
+     */
+    template <class JType>
+    class JacobianArray
+    {
+        public:
+            enum { Dimension = JType::ColsAtCompileTime };
+
+            JacobianArray() : _size( 0 ), _stride( 0 ) {}
+
+            size_t size() const { return _size; }
+            bool   empty() const { return _size == 0; }
+            void   clear() { _size = 0; }
+
+            void   reserve( size_t n );
+            void   resize( size_t n );
+
+            void   push_back( const JType& j );
+            void   set( size_t i, const JType& j );
+            void   get( JType& j, size_t i ) const;
+            JType  operator[]( size_t i ) const { JType j; get( j, i ); return j; }
+
+            /**
+             * \brief copy the rows given by indices from src
+             */
+            void   gather( const JacobianArray<JType>& src, const size_t* indices, size_t n );
+
+            float*       column( size_t d )       { return &_data[ d * _stride ]; }
+            const float* column( size_t d ) const { return &_data[ d * _stride ]; }
+
+        private:
+            std::vector<float, Eigen::aligned_allocator<float> > _data;
+            size_t  _size;
+            size_t  _stride;
+    };
+
+    template <class JType>
+    inline void JacobianArray<JType>::reserve( size_t n )
+    {
+        if( n <= _stride )
+            return;
+
+        size_t stride = ( n + 3 ) & ~( ( size_t )3 );
+        std::vector<float, Eigen::aligned_allocator<float> > data( Dimension * stride );
+        if( _size ){
+            for( size_t d = 0; d < Dimension; d++ )
+                memcpy( &data[ d * stride ], &_data[ d * _stride ], sizeof( float ) * _size );
+        }
+        _data.swap( data );
+        _stride = stride;
+    }
+
+    template <class JType>
+    inline void JacobianArray<JType>::resize( size_t n )
+    {
+        reserve( n );
+        _size = n;
+    }
+
+    template <class JType>
+    inline void JacobianArray<JType>::push_back( const JType& j )
+    {
+        if( _size == _stride )
+            reserve( Math::max<size_t>( 2 * _stride, 64 ) );
+        set( _size++, j );
+    }
+
+    template <class JType>
+    inline void JacobianArray<JType>::set( size_t i, const JType& j )
+    {
+        float* dst = &_data[ i ];
+        for( size_t d = 0; d < Dimension; d++, dst += _stride )
+            *dst = j.coeff( 0, d );
+    }
+
+    template <class JType>
+    inline void JacobianArray<JType>::get( JType& j, size_t i ) const
+    {
+        const float* src = &_data[ i ];
+        for( size_t d = 0; d < Dimension; d++, src += _stride )
+            j.coeffRef( 0, d ) = *src;
+    }
+
+    template <class JType>
+    inline void JacobianArray<JType>::gather( const JacobianArray<JType>& src, const size_t* indices, size_t n )
+    {
+        resize( n );
+        if( !n )
+            return;
+        for( size_t d = 0; d < Dimension; d++ ){
+            float* dst = column( d );
+            const float* s = src.column( d );
+            for( size_t i = 0; i < n; i++ )
+                dst[ i ] = s[ indices[ i ] ];
+        }
+    }
+
+}
+
+#endif // CVT_JACOBIANARRAY_H
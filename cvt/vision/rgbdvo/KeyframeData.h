@@ -31,6 +31,7 @@
 #include <cvt/gfx/IMapScoped.h>
 #include <cvt/vision/rgbdvo/RGBDPreprocessor.h>
 #include <cvt/vision/rgbdvo/GradientThresholdSelection.h>
+#include <cvt/vision/rgbdvo/JacobianArray.h>
 
 namespace cvt {
 
@@ -79,7 +80,7 @@ namespace cvt {
             typedef typename Warp::HessianType      HessianType;
             typedef Eigen::Matrix<float, 1, 2>      GradientType;
             typedef std::vector<ScreenJacobianType, Eigen::aligned_allocator<ScreenJacobianType> > ScreenJacVec;
-            typedef std::vector<JacobianType, Eigen::aligned_allocator<JacobianType> > JacobianVec;
+            typedef JacobianArray<JacobianType>     JacobianVec;
 
             IntensityData(){}
             virtual ~IntensityData(){}
@@ -107,7 +108,7 @@ namespace cvt {
 
             virtual void erase( size_t n )
             {
-                _jacobians.erase( _jacobians.begin() + n, _jacobians.end() );
+                _jacobians.resize( n );
                 _points3d.erase( _points3d.begin() + n, _points3d.end() );
                 _pixelValues.erase( _pixelValues.begin() + n, _pixelValues.end() );
             }
@@ -158,18 +159,24 @@ namespace cvt {
                                      const std::vector<float>& interpolated ) const
             {
 
-                const JacobianVecType& refJacs = this->jacobians();
+                size_t n = this->size();
+                if( !n ){
+                    residuals.clear();
+                    jacobians.clear();
+                    return;
+                }
+                std::vector<size_t> valid( n );
                 size_t savePos = 0;
                 // sort out data which is out of image bounds:
-                for( size_t i = 0; i < this->size(); ++i ){
+                for( size_t i = 0; i < n; ++i ){
                     if( interpolated[ i ] >= 0.0f ){
-                        jacobians[ savePos ] = refJacs[ i ];
+                        valid[ savePos ] = i;
                         residuals[ savePos ] = residuals[ i ];
                         ++savePos;
                     }
                 }
                 residuals.erase( residuals.begin() + savePos, residuals.end() );
-                jacobians.erase( jacobians.begin() + savePos, jacobians.end() );
+                jacobians.gather( this->jacobians(), &valid[ 0 ], savePos );
             }
 
             void updateOfflineData( const Matrix4f& world2Cam,
@@ -246,16 +253,15 @@ namespace cvt {
 
                             Warp::screenJacobian( sj, p3d, intr );
 
-                            // add jacobian for the point
-                            this->_jacobians.push_back( JacobianType() );
-                            JacobianType& j = this->_jacobians.back();
-
-                            // precompute it using the gradient and screen jacobian value
+                            // precompute the jacobian using the gradient and screen jacobian value
                             Warp::computeJacobian( j, sj, g, value[ x ] );
 
                             // this is to get the inverse incremental pose update
                             j.template head<6>() *= -1.0f;
 
+                            // add jacobian for the point
+                            this->_jacobians.push_back( j );
+
                             // add point
                             this->_points3d.push_back( p3dw );
 
@@ -316,6 +322,7 @@ namespace cvt {
                 // sort out bad pixels (out of image)
                 const ScreenJacVec& sj = _screenJacobians;
                 GradientType grad;
+                JacobianType j;
                 size_t savePos = 0;
 
                 for( size_t i = 0; i < n; ++i ){
@@ -324,14 +331,15 @@ namespace cvt {
                         grad.coeffRef( 0, 1 ) = intGradY[ i ];
 
                         // compute the Fwd jacobians
-                        Warp::computeJacobian( jacobians[ savePos ], sj[ i ], grad, interpolated[ i ] );
-                        jacobians[ savePos ] *= -1.0f;
+                        Warp::computeJacobian( j, sj[ i ], grad, interpolated[ i ] );
+                        j *= -1.0f;
+                        jacobians.set( savePos, j );
                         residuals[ savePos ] = residuals[ i ];
                         ++savePos;
                     }
                 }
                 residuals.erase( residuals.begin() + savePos, residuals.end() );
-                jacobians.erase( jacobians.begin() + savePos, jacobians.end() );
+                jacobians.resize( savePos );
             }
 
 
@@ -495,6 +503,7 @@ namespace cvt {
                 // sort out bad pixels (out of image)
                 const ScreenJacVec& sj = this->screenJacobians();
                 GradientType grad;
+                JacobianType j;
                 size_t savePos = 0;
 
                 for( size_t i = 0; i < n; ++i ){
@@ -503,14 +512,15 @@ namespace cvt {
                         grad.coeffRef( 0, 1 ) = 0.5 * ( intGradY[ i ] + _referenceGradients[ i ].coeffRef( 0, 1 ) );
 
                         // compute the ESM jacobians
-                        Warp::computeJacobian( jacobians[ savePos ], sj[ i ], grad, interpolated[ i ] );
-                        jacobians[ savePos ] *= -1.0f;
+                        Warp::computeJacobian( j, sj[ i ], grad, interpolated[ i ] );
+                        j *= -1.0f;
+                        jacobians.set( savePos, j );
                         residuals[ savePos ] = residuals[ i ];
                         ++savePos;
                     }
                 }
                 residuals.erase( residuals.begin() + savePos, residuals.end() );
-                jacobians.erase( jacobians.begin() + savePos, jacobians.end() );
+                jacobians.resize( savePos );
             }
 
             void updateOfflineData( const Matrix4f& pose,
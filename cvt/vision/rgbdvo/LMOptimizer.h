@@ -77,7 +77,7 @@ namespace cvt {
 
         // initial costs
         costFunc.evaluate( residuals, jacobians, octave );
-        result.costs = Base::evaluateSystem( hessian, deltaSum, &jacobians[ 0 ], &residuals[ 0 ], residuals.size() );
+        result.costs = Base::evaluateSystem( hessian, deltaSum, jacobians, &residuals[ 0 ], residuals.size() );
         result.numPixels = residuals.size();
 
         ModelType saved( costFunc.model() );
@@ -103,7 +103,7 @@ namespace cvt {
             if( residuals.size() && currentCosts < result.costs ){
                 // step accept - update the system:
                 this->_overallDelta.noalias() += deltaP;
-                result.costs = Base::evaluateSystem( hessian, deltaSum, &jacobians[ 0 ], &residuals[ 0 ], residuals.size() );
+                result.costs = Base::evaluateSystem( hessian, deltaSum, jacobians, &residuals[ 0 ], residuals.size() );
                 saved = costFunc.model();
                 lambda *= 0.1f;
                 result.numPixels = residuals.size();
@@ -41,6 +41,7 @@ namespace cvt {
             typedef CostFunction<Derived>                CostFuncType;
             typedef typename CostFuncType::DataType      T;
             typedef typename CostFuncType::JacobianType  JacobianType;
+            typedef typename CostFuncType::JacobianVectorType JacobianVectorType;
             typedef typename CostFuncType::HessianType   HessianType;
             typedef typename CostFuncType::ParameterType DeltaType;
 
@@ -97,7 +98,7 @@ namespace cvt {
             bool checkResult( const Result& res ) const;
 
             float evaluateSystem( HessianType& hessian, JacobianType& deltaSum,
-                                  const JacobianType* jacobians, const float* residuals, size_t n );
+                                  const JacobianVectorType& jacobians, const float* residuals, size_t n );
 
             void resetOverallDelta();
 
@@ -202,7 +203,7 @@ namespace cvt {
 
     template <class Derived>
     inline float Optimizer<Derived>::evaluateSystem( HessianType& hessian, JacobianType& deltaSum,
-                                                     const JacobianType* jacobians, const float* residuals, size_t n  )
+                                                     const JacobianVectorType& jacobians, const float* residuals, size_t n  )
     {        
         float median = this->computeMedian( residuals, n );
         float mad = this->computeMAD( residuals, n, median );
@@ -46,8 +46,7 @@ namespace cvt {
         typedef float                                       DataType;
         typedef Eigen::Matrix<DataType, Warp::NParams, 1>   ParameterType;
         typedef Eigen::Matrix<DataType, 1, Warp::NParams>   JacobianType;
-        typedef Eigen::aligned_allocator<JacobianType>      AlocType;
-        typedef std::vector<JacobianType, AlocType>         JacobianVectorType;
+        typedef JacobianArray<JacobianType>                 JacobianVectorType;
         typedef Eigen::Matrix<DataType, Warp::NParams, Warp::NParams>  HessianType;
 
         typedef DataType                                    ResidualType;
@@ -51,7 +51,7 @@ namespace cvt
             typedef Eigen::Matrix<float, 1, 2>      GradientType;
 
             typedef std::vector<ScreenJacobianType, Eigen::aligned_allocator<ScreenJacobianType> > ScreenJacVec;
-            typedef std::vector<JacobianType, Eigen::aligned_allocator<JacobianType> > JacobianVec;           
+            typedef JacobianArray<JacobianType>     JacobianVec;
 
             RGBDKeyframe( const ReferenceFactory& factory,
                           const Matrix3f& K,
@@ -26,7 +26,10 @@
 #define CVT_SYSTEMBUILDER_H
 
 #include <cvt/vision/RobustWeighting.h>
+#include <cvt/vision/rgbdvo/JacobianArray.h>
 #include <cvt/math/Math.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/ThreadPool.h>
 
 namespace cvt {
     template <class EigenMat>
@@ -72,6 +75,143 @@ namespace cvt {
                 }
                 return ssd / n;
             }
+
+            /**
+             * \brief accumulate the weighted normal equations from SoA jacobians
+             *
+             * The pixels are split into fixed chunks which are processed in
+             * parallel. Each chunk computes the robust weights and the upper
+             * triangle of H and b blockwise with SIMD dot products. The
+             * partial sums are reduced in chunk order, so the result does not
+             * depend on the number of threads.
+             */
+            template <class HessType, class JType>
+            static float build( const RobustEstimator<float>& lossFunc,
+                                HessType& H,
+                                JType& b,
+                                const JacobianArray<JType>& jacobians,
+                                const float* residuals,
+                                size_t n )
+            {
+                typedef NormalEquations<JacobianArray<JType>::Dimension> Partial;
+
+                b.setZero();
+                H.setZero();
+                if( !n )
+                    return 0.0f;
+
+                /* fixed chunks, the reduction order must not depend on the thread count */
+                const size_t chunkSize = ( ( size_t )CHUNK_MIN + BLOCK_SIZE - 1 ) & ~( ( size_t )BLOCK_SIZE - 1 );
+                size_t numChunks = ( n + chunkSize - 1 ) / chunkSize;
+
+                std::vector<Partial> partials( numChunks );
+                NormalEquationBody<JType> body( &partials[ 0 ], lossFunc, jacobians, residuals, n, chunkSize );
+                parallelFor( 0, numChunks, body );
+
+                float ssd = 0.0f;
+                for( size_t c = 0; c < numChunks; c++ ){
+                    const Partial& p = partials[ c ];
+                    const float* h = p.hessian;
+                    for( int i = 0; i < Partial::Dimension; i++ ){
+                        b( 0, i ) += p.gradient[ i ];
+                        for( int k = i; k < Partial::Dimension; k++ )
+                            H( i, k ) += *h++;
+                    }
+                    ssd += p.ssd;
+                }
+
+                for( int i = 1; i < Partial::Dimension; i++ )
+                    for( int k = 0; k < i; k++ )
+                        H( i, k ) = H( k, i );
+
+                return ssd / n;
+            }
+
+        private:
+            enum {
+                BLOCK_SIZE = 256,
+                CHUNK_MIN  = 4096
+            };
+
+            template <int N>
+            struct NormalEquations {
+                enum { Dimension = N };
+
+                NormalEquations() : ssd( 0.0f )
+                {
+                    for( int i = 0; i < N * ( N + 1 ) / 2; i++ )
+                        hessian[ i ] = 0.0f;
+                    for( int i = 0; i < N; i++ )
+                        gradient[ i ] = 0.0f;
+                }
+
+                float hessian[ N * ( N + 1 ) / 2 ];
+                float gradient[ N ];
+                float ssd;
+            };
+
+            template <class JType>
+            class NormalEquationBody
+            {
+                public:
+                    typedef NormalEquations<JacobianArray<JType>::Dimension> Partial;
+
+                    NormalEquationBody( Partial* partials,
+                                        const RobustEstimator<float>& lossFunc,
+                                        const JacobianArray<JType>& jacobians,
+                                        const float* residuals,
+                                        size_t n,
+                                        size_t chunkSize ) :
+                        _partials( partials ),
+                        _lossFunc( lossFunc ),
+                        _jacobians( jacobians ),
+                        _residuals( residuals ),
+                        _n( n ),
+                        _chunkSize( chunkSize ),
+                        _simd( SIMD::instance() )
+                    {
+                    }
+
+                    void operator()( size_t begin, size_t end ) const
+                    {
+                        float weights[ BLOCK_SIZE ];
+                        float wr[ BLOCK_SIZE ];
+                        float wj[ BLOCK_SIZE ];
+
+                        for( size_t c = begin; c < end; c++ ){
+                            Partial& p = _partials[ c ];
+                            size_t cend = Math::min( _n, ( c + 1 ) * _chunkSize );
+
+                            for( size_t pos = c * _chunkSize; pos < cend; pos += BLOCK_SIZE ){
+                                size_t num = Math::min<size_t>( BLOCK_SIZE, cend - pos );
+                                const float* r = _residuals + pos;
+
+                                _lossFunc.weights( weights, r, num );
+                                _simd->Mul( wr, weights, r, num );
+                                p.ssd += _simd->sumSqr( r, num );
+
+                                float* h = p.hessian;
+                                for( int i = 0; i < Partial::Dimension; i++ ){
+                                    const float* ji = _jacobians.column( i ) + pos;
+                                    p.gradient[ i ] += _simd->dot( ji, wr, num );
+
+                                    _simd->Mul( wj, weights, ji, num );
+                                    for( int k = i; k < Partial::Dimension; k++ )
+                                        *h++ += _simd->dot( wj, _jacobians.column( k ) + pos, num );
+                                }
+                            }
+                        }
+                    }
+
+                private:
+                    Partial*                        _partials;
+                    const RobustEstimator<float>&   _lossFunc;
+                    const JacobianArray<JType>&     _jacobians;
+                    const float*                    _residuals;
+                    size_t                          _n;
+                    size_t                          _chunkSize;
+                    SIMD*                           _simd;
+            };
     };
 
 }
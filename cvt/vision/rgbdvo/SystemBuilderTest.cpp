@@ -0,0 +1,124 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/util/CVTTest.h>
+
+#include <cvt/vision/rgbdvo/SystemBuilder.h>
+#include <cvt/vision/rgbdvo/JacobianArray.h>
+#include <Eigen/Core>
+#include <Eigen/StdVector>
+
+#include <vector>
+
+namespace cvt
+{
+    template <int N>
+    static bool testSystem( const RobustEstimator<float>& estimator, size_t n )
+    {
+        typedef Eigen::Matrix<float, 1, N> JacType;
+        typedef Eigen::Matrix<float, N, N> HessType;
+
+        std::vector<JacType, Eigen::aligned_allocator<JacType> > aos( n );
+        JacobianArray<JacType> soa;
+        std::vector<float> residuals( n );
+
+        for( size_t i = 0; i < n; i++ ){
+            for( int k = 0; k < N; k++ )
+                aos[ i ]( 0, k ) = Math::rand( -1.0f, 1.0f );
+            residuals[ i ] = Math::rand( -2.0f, 2.0f );
+            soa.push_back( aos[ i ] );
+        }
+
+        HessType H0, H1;
+        JacType b0, b1;
+        float ssd0 = SystemBuilder::build( estimator, H0, b0, &aos[ 0 ], &residuals[ 0 ], n );
+        float ssd1 = SystemBuilder::build( estimator, H1, b1, soa, &residuals[ 0 ], n );
+
+        float scale = 1e-4f * n;
+        if( Math::abs( ssd0 - ssd1 ) > 1e-4f * ssd0 )
+            return false;
+        if( ( H0 - H1 ).cwiseAbs().maxCoeff() > scale )
+            return false;
+        if( ( b0 - b1 ).cwiseAbs().maxCoeff() > scale )
+            return false;
+        return H1.isApprox( H1.transpose() );
+    }
+
+    static bool testGather()
+    {
+        typedef Eigen::Matrix<float, 1, 8> JacType;
+
+        JacobianArray<JacType> src, dst;
+        JacType j;
+        for( size_t i = 0; i < 100; i++ ){
+            j.fill( i );
+            src.push_back( j );
+        }
+
+        std::vector<size_t> ids;
+        for( size_t i = 0; i < 100; i += 3 )
+            ids.push_back( i );
+        dst.gather( src, &ids[ 0 ], ids.size() );
+
+        if( dst.size() != ids.size() )
+            return false;
+        for( size_t i = 0; i < ids.size(); i++ ){
+            if( dst[ i ] != src[ ids[ i ] ] )
+                return false;
+        }
+        return true;
+    }
+
+BEGIN_CVTTEST( RGBDSystemBuilder )
+
+bool result = true;
+bool b;
+
+b = testGather();
+CVTTEST_PRINT( "JacobianArray gather", b );
+result &= b;
+
+Huberf huber;
+huber.setScale( 0.5f );
+b = testSystem<6>( huber, 50000 );
+CVTTEST_PRINT( "SoA normal equations (6 params, Huber)", b );
+result &= b;
+
+Tukeyf tukey;
+tukey.setScale( 0.4f );
+b = testSystem<8>( tukey, 12345 );
+CVTTEST_PRINT( "SoA normal equations (8 params, Tukey)", b );
+result &= b;
+
+NoWeightingf noweight;
+b = testSystem<6>( noweight, 17 );
+CVTTEST_PRINT( "SoA normal equations (small)", b );
+result &= b;
+
+return result;
+
+END_CVTTEST
+
+}
@@ -29,7 +29,8 @@
 namespace cvt
 {
     SlamMap::SlamMap() :
-        _numMeas( 0 )
+        _numMeas( 0 ),
+        _version( 0 )
     {
     }
 
@@ -42,12 +43,14 @@ namespace cvt
         _keyframes.clear();
         _features.clear();
         _numMeas = 0;
+        _version++;
     }
 
     size_t SlamMap::addKeyframe( const Eigen::Matrix4d& pose )
     {
         size_t id = _keyframes.size();
         _keyframes.push_back( Keyframe( pose, id ) );
+        _version++;
         return id;
     }
 
@@ -55,6 +58,7 @@ namespace cvt
     size_t SlamMap::addFeature( const MapFeature& world )
     {
         _features.push_back( world );
+        _version++;
         return _features.size()-1;
     }
 
@@ -74,6 +78,7 @@ namespace cvt
         _features[ pointId ].addPointTrack( keyframeId );
         _keyframes[ keyframeId ].addFeature( meas, pointId );
         _numMeas++;
+        _version++;
     }
 
     int SlamMap::findClosestKeyframe( const Eigen::Matrix4d& worldT ) const
@@ -170,6 +175,7 @@ namespace cvt
         size_t numKF = keyframes->childSize();
         _keyframes.resize( numKF );
         _numMeas = 0;
+        _version++;
         for( size_t i = 0; i < _keyframes.size(); i++ ){
             XMLNode* kfNode = keyframes->child( i );
 
@@ -105,6 +105,9 @@ namespace cvt
          size_t numKeyframes()	  const { return _keyframes.size(); }
          size_t numMeasurements() const { return _numMeas; }
 
+         /* incremented whenever keyframes, features or measurements are added */
+         size_t version()		  const { return _version; }
+
          void deserialize( XMLNode* node );
          XMLNode* serialize() const;
 
@@ -122,6 +125,7 @@ namespace cvt
 		 MapFeatureVectorType	_features;
 		 Eigen::Matrix3d		_intrinsics;
          size_t					_numMeas;
+         size_t					_version;
    };
 }
 
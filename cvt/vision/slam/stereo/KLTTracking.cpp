@@ -44,38 +44,47 @@ namespace cvt
                                      const ImagePyramid&            pyr )
     {
         SIMD* simd = SIMD::instance();
-        const size_t nPixels = Math::sqr( PatchType::size() );
+        const size_t nPixels = Math::sqr( PatchBatch::PatchSize );
         const float  maxSSD = nPixels * _ssdThreshold;
         const size_t maxSAD = nPixels * _sadThreshold;
 
-        Vector2f center;
-
+        // collect the valid patches and start from the predicted positions
+        std::vector<size_t> indices;
+        std::vector<size_t> ids;
+        indices.reserve( predictedPositions.size() );
+        ids.reserve( predictedPositions.size() );
         for( size_t i = 0; i < predictedPositions.size(); i++ ){
-            const Vector2f& p = predictedPositions[ i ];
-
             size_t id = predictedIds[ i ];
-            //  get the patch
-            PatchType* patch = _patchForId[ id ];
+            int idx = _patchForId[ id ];
 
-            if( patch == 0 ){
+            if( idx < 0 ){
                 // this was a bad PATCH
                 continue;
             }
 
-            // start from predicted position
-            patch->initPose( p );
-
-            //  try to track the patch
-            if( patch->align( pyr, 5 ) ){
-                // successfully tracked: check SSD, SAD values
-                float ssd = simd->SSD( patch->pixels(), patch->transformed(), nPixels );
-                if( ssd < maxSSD ){
-                    size_t sad = simd->SAD( patch->pixels(), patch->transformed(), nPixels );
-                    if( sad < maxSAD ){
-                        patch->currentCenter( center );
-                        trackedPositions.add( Vector2d( center.x, center.y ) );
-                        trackedFeatureIds.push_back( id );
-                    }
+            _patches.initPose( idx, predictedPositions[ i ] );
+            indices.push_back( idx );
+            ids.push_back( id );
+        }
+
+        //  try to track all patches at once
+        std::vector<uint8_t> aligned;
+        _patches.align( aligned, indices, pyr, 5 );
+
+        Vector2f center;
+        for( size_t i = 0; i < indices.size(); i++ ){
+            if( !aligned[ i ] )
+                continue;
+
+            // successfully tracked: check SSD, SAD values
+            size_t idx = indices[ i ];
+            float ssd = simd->SSD( _patches.pixels( idx ), _patches.transformed( idx ), nPixels );
+            if( ssd < maxSSD ){
+                size_t sad = simd->SAD( _patches.pixels( idx ), _patches.transformed( idx ), nPixels );
+                if( sad < maxSAD ){
+                    _patches.currentCenter( idx, center );
+                    trackedPositions.add( Vector2d( center.x, center.y ) );
+                    trackedFeatureIds.push_back( ids[ i ] );
                 }
             }
         }
@@ -86,31 +95,22 @@ namespace cvt
                                             const ImagePyramid& pyrGradY,
                                             const Vector2f & f, size_t id )
     {
-        std::vector<PatchType*> patches;
-        std::vector<Vector2f>  feature;
-        feature.push_back( f );
-
-        PatchType::extractPatches( patches, feature, pyr, pyrGradX, pyrGradY );
-
         if( id != _patchForId.size() ){
             throw CVTException( "Patch IDs out of sync" );
         }
 
         // FIXME: shall we handle this differently?
         // Problem: Map has already added feature with id at this point
-        if( patches.size() )
-            _patchForId.push_back( patches[ 0 ] );
+        if( _patches.add( pyr, pyrGradX, pyrGradY, f ) )
+            _patchForId.push_back( _patches.size() - 1 );
         else
-            _patchForId.push_back( 0 );
-
+            _patchForId.push_back( -1 );
     }
 
 
     void KLTTracking::clear()
     {
-        for( size_t i = 0; i < _patchForId.size(); i++ ){
-            delete _patchForId[ i ];
-        }
+        _patches.clear();
         _patchForId.clear();
     }
 }
@@ -27,7 +27,7 @@
 
 #include <cvt/vision/slam/stereo/FeatureTracking.h>
 #include <cvt/vision/slam/stereo/DescriptorDatabase.h>
-#include <cvt/vision/KLTPatch.h>
+#include <cvt/vision/KLTBatch.h>
 #include <cvt/math/GA2.h>
 
 
@@ -78,9 +78,11 @@ namespace cvt
         private:
             typedef GA2<float>          PoseType;
             static const size_t         PatchSize = 16;
-            typedef KLTPatch<PatchSize, PoseType> PatchType;
+            typedef KLTBatch<PatchSize, PoseType> PatchBatch;
 
-            std::vector<PatchType*>     _patchForId;
+            PatchBatch                  _patches;
+            /* index into _patches, -1 for features without a valid patch */
+            std::vector<int>            _patchForId;
             float                       _ssdThreshold;
             float                       _sadThreshold;
     };
@@ -0,0 +1,297 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/slam/stereo/MapOptimizer.h>
+#include <cvt/util/Profiler.h>
+
+#include <map>
+#include <algorithm>
+
+namespace cvt
+{
+    MapOptimizer::MapOptimizer() :
+        _windowSize( 10 ),
+        _queued( NULL ),
+        _result( NULL ),
+        _busy( false ),
+        _shutdown( false ),
+        _version( 0 )
+    {
+        _termCrit.setCostThreshold( 0.1 );
+        _termCrit.setMaxIterations( 5 );
+        _worker.run( this );
+    }
+
+    MapOptimizer::~MapOptimizer()
+    {
+        _mutex.lock();
+        _shutdown = true;
+        _wakeup.notify();
+        _mutex.unlock();
+        _worker.join();
+
+        delete _queued;
+        delete _result;
+    }
+
+    void MapOptimizer::optimize( const SlamMap& map, size_t keyframeId )
+    {
+        LocalWindow* window = createWindow( map, keyframeId );
+        if( !window )
+            return;
+
+        _mutex.lock();
+        delete _queued;
+        _queued = window;
+        _wakeup.notify();
+        _mutex.unlock();
+    }
+
+    bool MapOptimizer::applyUpdates( SlamMap& map )
+    {
+        _mutex.lock();
+        LocalWindow* window = _result;
+        _result = NULL;
+        _mutex.unlock();
+
+        if( !window )
+            return false;
+
+        bool changed = applyWindow( map, *window );
+        delete window;
+        return changed;
+    }
+
+    bool MapOptimizer::applyWindow( SlamMap& map, const LocalWindow& window )
+    {
+        // if the map grew since the snapshot, entries the front-end touched
+        // in the meantime keep their value instead of being overwritten
+        bool merge = map.version() != window.mapVersion;
+        bool changed = false;
+        for( size_t i = 0; i < window.keyframeIds.size(); i++ ){
+            size_t id = window.keyframeIds[ i ];
+            if( id >= map.numKeyframes() )
+                continue;
+            Keyframe& kf = map.keyframeForId( id );
+            if( merge && kf.pose().transformation() != window.poses[ i ] )
+                continue;
+            kf.setPose( window.map.keyframeForId( i ).pose().transformation() );
+            changed = true;
+        }
+
+        for( size_t i = 0; i < window.featureIds.size(); i++ ){
+            size_t id = window.featureIds[ i ];
+            if( id >= map.numFeatures() )
+                continue;
+            Eigen::Vector4d& p = map.featureForId( id ).estimate();
+            if( merge && p != window.points[ i ] )
+                continue;
+            p = window.map.featureForId( i ).estimate();
+            changed = true;
+        }
+        return changed;
+    }
+
+    void MapOptimizer::setMaxIterations( size_t iters )
+    {
+        _mutex.lock();
+        _termCrit.setMaxIterations( iters );
+        _mutex.unlock();
+    }
+
+    void MapOptimizer::setWindowSize( size_t n )
+    {
+        _mutex.lock();
+        _windowSize = Math::max<size_t>( n, 2 );
+        _mutex.unlock();
+    }
+
+    size_t MapOptimizer::windowSize() const
+    {
+        _mutex.lock();
+        size_t ret = _windowSize;
+        _mutex.unlock();
+        return ret;
+    }
+
+    bool MapOptimizer::isRunning() const
+    {
+        _mutex.lock();
+        bool ret = _queued != NULL || _busy;
+        _mutex.unlock();
+        return ret;
+    }
+
+    void MapOptimizer::clear()
+    {
+        _mutex.lock();
+        delete _queued;
+        _queued = NULL;
+        while( _busy )
+            _idle.wait( _mutex );
+        delete _result;
+        _result = NULL;
+        _mutex.unlock();
+    }
+
+    size_t MapOptimizer::version() const
+    {
+        _mutex.lock();
+        size_t ret = _version;
+        _mutex.unlock();
+        return ret;
+    }
+
+    static bool _cmpCovisibility( const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b )
+    {
+        // more shared features first, older keyframes on ties
+        if( a.first != b.first )
+            return a.first > b.first;
+        return a.second < b.second;
+    }
+
+    MapOptimizer::LocalWindow* MapOptimizer::createWindow( const SlamMap& map, size_t keyframeId ) const
+    {
+        if( keyframeId >= map.numKeyframes() )
+            return NULL;
+
+        // count the features the keyframe shares with every other keyframe
+        const Keyframe& kf = map.keyframeForId( keyframeId );
+        std::map<size_t, size_t> shared;
+        for( Keyframe::MeasurementIterator it = kf.measurementsBegin(); it != kf.measurementsEnd(); ++it ){
+            const MapFeature& f = map.featureForId( it->first );
+            for( MapFeature::ConstPointTrackIterator cam = f.pointTrackBegin(); cam != f.pointTrackEnd(); ++cam ){
+                if( *cam != keyframeId )
+                    shared[ *cam ]++;
+            }
+        }
+
+        std::vector<std::pair<size_t, size_t> > ranked;
+        for( std::map<size_t, size_t>::const_iterator it = shared.begin(); it != shared.end(); ++it )
+            ranked.push_back( std::make_pair( it->second, it->first ) );
+        std::sort( ranked.begin(), ranked.end(), _cmpCovisibility );
+
+        std::vector<size_t> kfIds;
+        kfIds.push_back( keyframeId );
+        size_t windowSize = this->windowSize();
+        for( size_t i = 0; i < ranked.size() && kfIds.size() < windowSize; i++ )
+            kfIds.push_back( ranked[ i ].second );
+        if( kfIds.size() < 2 )
+            return NULL;
+        // the oldest keyframe becomes local keyframe 0, which keeps its pose
+        std::sort( kfIds.begin(), kfIds.end() );
+
+        LocalWindow* window = new LocalWindow();
+        window->mapVersion = map.version();
+        window->map.setIntrinsics( map.intrinsics() );
+        std::map<size_t, size_t> localKf;
+        for( size_t i = 0; i < kfIds.size(); i++ ){
+            localKf[ kfIds[ i ] ] = window->map.addKeyframe( map.keyframeForId( kfIds[ i ] ).pose().transformation() );
+            window->keyframeIds.push_back( kfIds[ i ] );
+            window->poses.push_back( map.keyframeForId( kfIds[ i ] ).pose().transformation() );
+        }
+
+        // features seen at least twice inside the window, -1 marks skipped ones
+        std::map<size_t, long> localFeature;
+        for( size_t i = 0; i < kfIds.size(); i++ ){
+            const Keyframe& k = map.keyframeForId( kfIds[ i ] );
+            for( Keyframe::MeasurementIterator it = k.measurementsBegin(); it != k.measurementsEnd(); ++it ){
+                size_t fid = it->first;
+                std::map<size_t, long>::iterator lf = localFeature.find( fid );
+                if( lf == localFeature.end() ){
+                    const MapFeature& f = map.featureForId( fid );
+                    size_t views = 0;
+                    for( MapFeature::ConstPointTrackIterator cam = f.pointTrackBegin(); cam != f.pointTrackEnd(); ++cam )
+                        views += localKf.count( *cam );
+
+                    long id = -1;
+                    if( views > 1 ){
+                        id = window->map.addFeature( MapFeature( f.estimate(), f.covariance() ) );
+                        window->featureIds.push_back( fid );
+                        window->points.push_back( f.estimate() );
+                    }
+                    lf = localFeature.insert( std::make_pair( fid, id ) ).first;
+                }
+                if( lf->second >= 0 )
+                    window->map.addMeasurement( lf->second, i, it->second );
+            }
+        }
+
+        if( !window->map.numFeatures() ){
+            delete window;
+            return NULL;
+        }
+        return window;
+    }
+
+    void MapOptimizer::optimizeWindow( LocalWindow& window, const TerminationCriteria<double>& termCrit )
+    {
+        CVT_PROFILE_SCOPE( "MapOptimizer::optimizeWindow" );
+        SlamMap& map = window.map;
+        Eigen::Matrix4d anchor = map.keyframeForId( 0 ).pose().transformation();
+
+        SparseBundleAdjustment sba;
+        sba.optimize( map, termCrit );
+
+        // the window is not connected to fixed keyframes: move the result
+        // back such that the oldest keyframe keeps its pose
+        Eigen::Matrix4d g = map.keyframeForId( 0 ).pose().transformation().inverse() * anchor;
+        Eigen::Matrix4d gInv = g.inverse();
+        for( size_t i = 0; i < map.numKeyframes(); i++ ){
+            Keyframe& kf = map.keyframeForId( i );
+            kf.setPose( kf.pose().transformation() * g );
+        }
+        for( size_t i = 0; i < map.numFeatures(); i++ ){
+            Eigen::Vector4d& p = map.featureForId( i ).estimate();
+            p = gInv * p;
+        }
+    }
+
+    void MapOptimizer::workerLoop()
+    {
+        _mutex.lock();
+        while( true ){
+            while( !_queued && !_shutdown )
+                _wakeup.wait( _mutex );
+            if( _shutdown )
+                break;
+
+            LocalWindow* window = _queued;
+            _queued = NULL;
+            _busy = true;
+            TerminationCriteria<double> termCrit( _termCrit );
+            _mutex.unlock();
+
+            optimizeWindow( *window, termCrit );
+
+            _mutex.lock();
+            delete _result;
+            _result = window;
+            _version++;
+            _busy = false;
+            _idle.notifyAll();
+        }
+        _mutex.unlock();
+    }
+}
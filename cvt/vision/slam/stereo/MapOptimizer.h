@@ -27,50 +27,98 @@
 
 #include <cvt/vision/SparseBundleAdjustment.h>
 #include <cvt/util/Thread.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Condition.h>
 
 namespace cvt
 {
-    class MapOptimizer : public Thread<SlamMap>
+    /**
+     *  \brief Asynchronous local bundle adjustment
+     *
+     *  optimize() copies the covisibility window of a keyframe into a local map
+     *  and hands it to a worker thread, which runs the bundle adjustment on the copy.
+     *  Finished windows are published and written back by applyUpdates().
+     *  The shared map is never touched by the worker, and the caller only waits
+     *  for pointer swaps.
+     */
+    class MapOptimizer
     {
         public:
             MapOptimizer();
             ~MapOptimizer();
 
-            void execute( SlamMap* map );
+            /**
+             *  \brief  queue the local window around a keyframe for optimization
+             *  \param  map         the map, only read during the call
+             *  \param  keyframeId  the keyframe the window is centered on
+             *  A queued window that was not started yet is replaced.
+             */
+            void optimize( const SlamMap& map, size_t keyframeId );
+
+            /**
+             *  \brief  write the poses and points of the latest finished window to map
+             *  Entries modified since the window was created keep their current value.
+             *  \return true if the map was changed
+             */
+            bool applyUpdates( SlamMap& map );
+
+            /* true while a window is queued or being optimized */
             bool isRunning() const;
 
-            void setMaxIterations( size_t iters ) { _termCrit.setMaxIterations( iters ); }
+            /* wait for the worker and drop queued and finished windows */
+            void clear();
 
-        private:            
-            TerminationCriteria<double>	_termCrit;
-            bool						_isRunning;
-    };
+            /* number of windows optimized so far */
+            size_t version() const;
 
-    inline MapOptimizer::MapOptimizer() :
-        _isRunning( false )
-    {
-        _termCrit.setCostThreshold( 0.1 );
-        _termCrit.setMaxIterations( 5 );
-    }
+            void setMaxIterations( size_t iters );
 
-    inline MapOptimizer::~MapOptimizer()
-    {
-        if( _isRunning )
-            join();
-    }
+            /* maximum number of keyframes in the local window */
+            void setWindowSize( size_t n );
+            size_t windowSize() const;
 
-    inline void MapOptimizer::execute( SlamMap* map )
-    {
-        SparseBundleAdjustment sba;
-        _isRunning = true;
-        sba.optimize( *map, _termCrit );
-        _isRunning = false;
-    }
+        private:
+            MapOptimizer( const MapOptimizer& );
+            MapOptimizer& operator=( const MapOptimizer& );
 
-    inline bool MapOptimizer::isRunning() const
-    {
-        return _isRunning;
-    }
+            typedef std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d> > PoseVector;
+            typedef std::vector<Eigen::Vector4d, Eigen::aligned_allocator<Eigen::Vector4d> > PointVector;
+
+            /* local copy of a part of the map, ids are dense */
+            struct LocalWindow {
+                SlamMap             map;
+                std::vector<size_t> keyframeIds;
+                std::vector<size_t> featureIds;
+
+                /* version of the source map and the values the window started from */
+                size_t              mapVersion;
+                PoseVector          poses;
+                PointVector         points;
+            };
+
+            class Worker : public Thread<MapOptimizer> {
+                public:
+                    void execute( MapOptimizer* opt ) { opt->workerLoop(); }
+            };
+
+            LocalWindow* createWindow( const SlamMap& map, size_t keyframeId ) const;
+            static void  optimizeWindow( LocalWindow& window, const TerminationCriteria<double>& termCrit );
+            static bool  applyWindow( SlamMap& map, const LocalWindow& window );
+            void         workerLoop();
+
+            TerminationCriteria<double> _termCrit;
+            size_t                      _windowSize;
+
+            mutable Mutex               _mutex;
+            Condition                   _wakeup;
+            Condition                   _idle;
+            LocalWindow*                _queued;
+            LocalWindow*                _result;
+            bool                        _busy;
+            bool                        _shutdown;
+            size_t                      _version;
+            Worker                      _worker;
+    };
 }
 
 #endif
@@ -35,6 +35,8 @@
 #include <cvt/vision/features/RowLookupTable.h>
 #include <cvt/vision/slam/stereo/FeatureAnalyzer.h>
 #include <cvt/util/Time.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/Profiler.h>
 
 namespace cvt
 {
@@ -42,11 +44,14 @@ namespace cvt
                             FeatureDescriptorExtractor* descExtractor,
                             const StereoCameraCalibration &calib ,
                             const Params &params ):
+       _params( params ),
        _detector( detector ),
-       _descExtractorLeft( descExtractor ),
-       _descExtractorRight( descExtractor->clone() ),
-       _pyrLeft( _params.pyramidOctaves, _params.pyramidScaleFactor ),
-       _pyrRight( _params.pyramidOctaves, _params.pyramidScaleFactor ),
+       _detectorRight( detector->clone() ),
+       _current( new StereoFrame( _params.pyramidOctaves, _params.pyramidScaleFactor,
+                                  descExtractor->clone(), descExtractor->clone() ) ),
+       _pending( new StereoFrame( _params.pyramidOctaves, _params.pyramidScaleFactor,
+                                  descExtractor->clone(), descExtractor->clone() ) ),
+       _extractionThread( *this ),
        _pyrLeftf( _params.pyramidOctaves, _params.pyramidScaleFactor ),
        _pyrRightf( _params.pyramidOctaves, _params.pyramidScaleFactor ),
        _gradXl( _params.pyramidOctaves, _params.pyramidScaleFactor ),
@@ -55,7 +60,7 @@ namespace cvt
        _kernelGy( IKernel::HAAR_VERTICAL_3 ),
        _calib( calib ),
        _activeKF( -1 ),
-       _params( params )
+       _lastSBAKeyframes( 0 )
     {
         _kernelGx.scale( -0.5f );
         _kernelGy.scale( -0.5f );
@@ -68,19 +73,78 @@ namespace cvt
         _map.setIntrinsics( K );
     }
 
+    StereoSLAM::~StereoSLAM()
+    {
+        delete _current;
+        delete _pending;
+        delete _detectorRight;
+    }
+
     void StereoSLAM::newImages( const Image& imgLeftGray, const Image& imgRightGray )
     {
         CVT_ASSERT( imgLeftGray.format() == IFormat::GRAY_UINT8, "INPUT IMAGES NEED TO BE GRAY_UINT8" );
         CVT_ASSERT( imgRightGray.format() == IFormat::GRAY_UINT8, "INPUT IMAGES NEED TO BE GRAY_UINT8" );
 
-        // prepare debug image
-        imgLeftGray.convert( _debugMono, IFormat::RGBA_UINT8 );
+        bool debug = debugFeaturesWanted();
+        if( !_params.pipelined ){
+            // frame left over from pipelined mode
+            flush();
+            extractFeatures( *_current, imgLeftGray, imgRightGray, debug );
+            trackFrame( *_current );
+            _current->valid = false;
+            return;
+        }
+
+        // extract the features of this pair while the previous one is tracked
+        _extractionThread.start( _pending, imgLeftGray, imgRightGray, debug );
+        if( _current->valid )
+            trackFrame( *_current );
+        _extractionThread.join();
+
+        std::swap( _current, _pending );
+        _pending->valid = false;
+    }
+
+    void StereoSLAM::flush()
+    {
+        if( _current->valid ){
+            trackFrame( *_current );
+            _current->valid = false;
+        }
+    }
 
-        // detect current keypoints and extract descriptors
-        extractFeatures( imgLeftGray, imgRightGray );
+    bool StereoSLAM::debugFeaturesWanted()
+    {
+        return ( _params.dbgShowFeatures || _params.dbgShowNMSFilteredFeatures || _params.dbgShowBest3kFeatures )
+               && trackedFeatureImage.numDelegates();
+    }
 
-        std::cout << "CurrentFeatures Left: "  << _descExtractorLeft->size() << std::endl;
-        std::cout << "CurrentFeatures Right: " << _descExtractorRight->size() << std::endl;
+    void StereoSLAM::trackFrame( StereoFrame& frame )
+    {
+        CVT_PROFILE_SCOPE( "StereoSLAM::track" );
+        // pick up the result of the background bundle adjustment
+        if( _bundler.applyUpdates( _map ) )
+            mapChanged.notify( _map );
+
+        if( _params.verbose ){
+            std::cout << "CurrentFeatures Left: "  << frame.descLeft->size() << std::endl;
+            std::cout << "CurrentFeatures Right: " << frame.descRight->size() << std::endl;
+        }
+
+        // the debug image is only built if somebody listens
+        bool debugImage = trackedFeatureImage.numDelegates() > 0;
+        if( debugImage ){
+            frame.pyrLeft[ 0 ].convert( _debugMono, IFormat::RGBA_UINT8 );
+            if ( _params.dbgShowFeatures ) {
+                debugImageDrawFeatures( _debugMono, frame.dbgDetected, Color::BLUE );
+            }
+            if ( _params.dbgShowNMSFilteredFeatures ) {
+                debugImageDrawFeatures( _debugMono, frame.dbgNMSFiltered, Color::BLACK );
+            }
+            if ( _params.dbgShowBest3kFeatures ) {
+                debugImageDrawFeatures( _debugMono, frame.dbgBest, Color::GRAY );
+            }
+        }
 
         // predict current visible features by projecting with current estimate of pose
         std::vector<Vector2f>           predictedPositions;
@@ -114,13 +178,15 @@ namespace cvt
         size_t numTrackedFeatures = tracked.size();
         numTrackedPoints.notify( numTrackedFeatures );
 
-        createDebugImageMono1( _debugMono,
-                               tracked,
-                               predictedPositions,
-                               matchedIndices,
-                               predictedFeatureIds );
+        if( debugImage ){
+            createDebugImageMono1( _debugMono,
+                                   tracked,
+                                   predictedPositions,
+                                   matchedIndices,
+                                   predictedFeatureIds );
 
-        trackedFeatureImage.notify( _debugMono );
+            trackedFeatureImage.notify( _debugMono );
+        }
 
         std::vector<size_t> trackingInliers;
         estimateCameraPose( trackingInliers, tracked.points3d, tracked.points2d );
@@ -149,69 +215,96 @@ namespace cvt
         int last = _activeKF;
         poseEigen = _pose.transformation().cast<double>();
         _activeKF = _map.findClosestKeyframe( poseEigen );
-        if ( _activeKF != last ) {
+        if ( _activeKF != last && _params.verbose ) {
             std::cout << "Active KF: " << _activeKF << std::endl;
         }
 
         // update relative pose:
         Eigen::Matrix4d kfPose = _map.keyframeForId( _activeKF ).pose().transformation();
 
-        std::cout << "Keyframe Pose: " << kfPose << std::endl;
         // transform the relative pose into
         _keyframeRelativePose = poseEigen * kfPose.inverse();
 
-        std::cout << "Relative Pose " << _keyframeRelativePose << std::endl;
+        if( _params.verbose ){
+            std::cout << "Keyframe Pose: " << kfPose << std::endl;
+            std::cout << "Relative Pose " << _keyframeRelativePose << std::endl;
+        }
    }
 
-   void StereoSLAM::extractFeatures( const Image& left, const Image& right )
+   struct StereoSLAM::ExtractSides {
+       ExtractSides( const StereoSLAM& slam, StereoFrame& frame, const Image& left, const Image& right, bool debug ) :
+           _slam( slam ), _frame( frame ), _debug( debug )
+       {
+           _img[ 0 ] = &left;
+           _img[ 1 ] = &right;
+       }
+
+       void operator()( size_t begin, size_t end ) const
+       {
+           for( size_t side = begin; side < end; side++ )
+               _slam.extractSide( _frame, side, *_img[ side ], _debug );
+       }
+
+       const StereoSLAM& _slam;
+       StereoFrame&      _frame;
+       const Image*      _img[ 2 ];
+       bool              _debug;
+   };
+
+   void StereoSLAM::extractFeatures( StereoFrame& frame, const Image& left, const Image& right, bool debug ) const
    {
-	   // update image pyramid(s)
-	   _pyrLeft.update( left );
-	   _pyrRight.update( right );
+       // left and right use their own detector, pyramid and extractor
+       ExtractSides sides( *this, frame, left, right, debug );
+       parallelFor( 0, 2, sides );
+       frame.valid = true;
 
-	   // detect features in current left frame
-	   FeatureSet leftFeatures, rightFeatures;
-	   _detector->detect( leftFeatures, _pyrLeft );
-	   _detector->detect( rightFeatures, _pyrRight );
+       if( _params.verbose )
+           std::cout << "Left: "<< frame.descLeft->size() << " - Right: " << frame.descRight->size() << std::endl;
+   }
 
-       if ( _params.dbgShowFeatures ) {
-           debugImageDrawFeatures( _debugMono, leftFeatures, Color::BLUE );
+   void StereoSLAM::extractSide( StereoFrame& frame, size_t side, const Image& img, bool debug ) const
+   {
+	   CVT_PROFILE_SCOPE( "StereoSLAM::extract" );
+	   FeatureDetector* detector = side ? _detectorRight : _detector;
+	   ImagePyramid& pyr = side ? frame.pyrRight : frame.pyrLeft;
+	   FeatureDescriptorExtractor* extractor = side ? frame.descRight : frame.descLeft;
+	   // intermediate results are only drawn for the left view
+	   debug = debug && !side;
+
+	   // update image pyramid
+	   pyr.update( img );
+
+	   // detect features in current frame
+	   FeatureSet features;
+	   detector->detect( features, pyr );
+
+       if ( debug && _params.dbgShowFeatures ) {
+           frame.dbgDetected = features;
        }
 
-       const int NMS_RADIUS( _params.nonMaximumSuppressionRadius );
-	   leftFeatures.filterNMS( NMS_RADIUS, true );
-	   rightFeatures.filterNMS( NMS_RADIUS, true );
+       features.filterNMS( _params.nonMaximumSuppressionRadius, true );
 
-       if ( _params.dbgShowNMSFilteredFeatures ) {
-           debugImageDrawFeatures( _debugMono, leftFeatures, Color::BLACK );
+       if ( debug && _params.dbgShowNMSFilteredFeatures ) {
+           frame.dbgNMSFiltered = features;
        }
 
-	   const int X_CELLS = _params.gridFilteringCellsX;
-	   const int Y_CELLS = _params.gridFilteringCellsY;
-	   const int MAX_CELL_FEATURES = _params.maxFeaturesPerCell;
        if ( _params.useGridFiltering ) {
-           leftFeatures.filterGrid( _pyrLeft[ 0 ].width(), _pyrLeft[ 0 ].height(), X_CELLS, Y_CELLS, MAX_CELL_FEATURES );
-           rightFeatures.filterGrid( _pyrLeft[ 0 ].width(), _pyrLeft[ 0 ].height(), X_CELLS, Y_CELLS, MAX_CELL_FEATURES );
+           features.filterGrid( pyr[ 0 ].width(), pyr[ 0 ].height(),
+                                _params.gridFilteringCellsX, _params.gridFilteringCellsY,
+                                _params.maxFeaturesPerCell );
        } else {
-            leftFeatures.filterBest( _params.bestFeaturesCount, true );
-            rightFeatures.filterBest( _params.bestFeaturesCount, true );
+           features.filterBest( _params.bestFeaturesCount, true );
        }
 
-	   leftFeatures.sortPosition();
-	   rightFeatures.sortPosition();
+	   features.sortPosition();
 
-       if ( _params.dbgShowBest3kFeatures ) {
-           debugImageDrawFeatures( _debugMono, leftFeatures, Color::GRAY );
+       if ( debug && _params.dbgShowBest3kFeatures ) {
+           frame.dbgBest = features;
        }
 
-       std::cout << "Left: "<< leftFeatures.size() << " - Right: " << rightFeatures.size() << std::endl;
-
 	   // extract the descriptors
-	   _descExtractorLeft->clear();
-	   _descExtractorLeft->extract( _pyrLeft, leftFeatures );
-
-	   _descExtractorRight->clear();
-	   _descExtractorRight->extract( _pyrRight, rightFeatures );
+	   extractor->clear();
+	   extractor->extract( pyr, features );
    }
 
    void StereoSLAM::predictVisibleFeatures( std::vector<Vector2f>& imgPositions,
@@ -226,7 +319,8 @@ namespace cvt
 								   _calib.firstCamera(),
 								   _params.keyframeSelectionRadius );
 
-	   std::cout << "Visible points from map (Selected points): " << ids.size() << std::endl;
+	   if( _params.verbose )
+		   std::cout << "Visible points from map (Selected points): " << ids.size() << std::endl;
 
 	   // get the corresponding descriptors
 	   _descriptorDatabase.descriptorsAndPatchesForIds( descriptors, patches, ids );
@@ -241,12 +335,13 @@ namespace cvt
                                              std::vector<StereoSLAM::PatchType*>& predictedPatches,
                                              const std::vector<size_t>& predictedIds )
     {
-        _pyrLeft.convert( _pyrLeftf, IFormat::GRAY_FLOAT  );
+        CVT_PROFILE_SCOPE( "StereoSLAM::klt" );
+        _current->pyrLeft.convert( _pyrLeftf, IFormat::GRAY_FLOAT  );
 
 
         // match with current left features
-        RowLookupTable rlt( *_descExtractorLeft );
-        _descExtractorLeft->matchInWindow( matchedIndices,
+        RowLookupTable rlt( *_current->descLeft );
+        _current->descLeft->matchInWindow( matchedIndices,
                                            rlt,
                                            predictedDescriptors,
                                            _params.matchingWindow,
@@ -262,7 +357,7 @@ namespace cvt
             PatchType* patch = predictedPatches[ m.srcIdx ];
 
 
-            const Vector2f& pt = ( *_descExtractorLeft )[ m.dstIdx ].pt;
+            const Vector2f& pt = ( *_current->descLeft )[ m.dstIdx ].pt;
 
             // TODO: try to only update the position and keep the rest of the patch pose
             //       the idea would be, that the last alignment/oriantation of this patch
@@ -294,7 +389,8 @@ namespace cvt
     {
         if ( p3d.size() < 6 ){
             // too few features -> lost track: relocalization needed
-            std::cout << "Too few features tracked - relocalization needed" << std::endl;
+            if( _params.verbose )
+                std::cout << "Too few features tracked - relocalization needed" << std::endl;
             return;
         }
 
@@ -314,10 +410,12 @@ namespace cvt
         estimated = ransac.estimate( 5000 );
         inlierPercentage = ( float )ransac.inlierIndices().size() / ( float )p3d.size();
 
-        std::cout << "Inlier Percentage: " << inlierPercentage << " (RANSAC inliers: " <<
-                     ransac.inlierIndices().size() << ")\n";
+        if( _params.verbose ){
+            std::cout << "Inlier Percentage: " << inlierPercentage << " (RANSAC inliers: " <<
+                         ransac.inlierIndices().size() << ")\n";
 
-        std::cout << "EPnP: Estimated Pose: \n" << estimated << std::endl;
+            std::cout << "EPnP: Estimated Pose: \n" << estimated << std::endl;
+        }
 
         inlierIndices = ransac.inlierIndices();
 
@@ -325,7 +423,8 @@ namespace cvt
         Huberf estimator;
         estimator.setThreshold( 1.0f );
         reprError.minimize( estimated, inlierIndices, k, estimator );
-        std::cout << "Refined Pose: \n" << estimated << std::endl;
+        if( _params.verbose )
+            std::cout << "Refined Pose: \n" << estimated << std::endl;
 
         _pose.set( estimated );
         newCameraPose.notify( estimated );
@@ -339,12 +438,12 @@ namespace cvt
    {
        // sort out free features (currently not tracked)
 	   std::vector<const FeatureDescriptor*> freeFeaturesLeft;
-	   sortOutFreeFeatures( freeFeaturesLeft, _descExtractorLeft, trackingInliers, matchedIndices );
+	   sortOutFreeFeatures( freeFeaturesLeft, _current->descLeft, trackingInliers, matchedIndices );
 
 	   // try to match the free features with right frame
 	   std::vector<FeatureMatch> stereoMatches;
-       RowLookupTable rltRight( *_descExtractorRight );
-	   _descExtractorRight->scanLineMatch( stereoMatches,
+       RowLookupTable rltRight( *_current->descRight );
+	   _current->descRight->scanLineMatch( stereoMatches,
                                            rltRight,
 										   freeFeaturesLeft,
 										   _params.minDisparity,
@@ -352,7 +451,7 @@ namespace cvt
 										   _params.stereoMaxDescDistance,
 										   _params.maxEpilineDistance );
 
-	   if ( _params.dbgShowStereoMatches ) {
+	   if ( _params.dbgShowStereoMatches && newStereoMatches.numDelegates() && stereoMatches.size() ) {
 		   Image debugImg;
 		   createStereoMatchingDebugImage( debugImg, stereoMatches );
 		   newStereoMatches.notify( debugImg );
@@ -361,7 +460,7 @@ namespace cvt
 	   // left is already converted to float
 	   _pyrLeftf.convolve( _gradXl, _kernelGx );
 	   _pyrLeftf.convolve( _gradYl, _kernelGy );
-	   _pyrRight.convert( _pyrRightf, IFormat::GRAY_FLOAT );
+	   _current->pyrRight.convert( _pyrRightf, IFormat::GRAY_FLOAT );
 	   // maybe also update the patches of the currently tracked features
 
 	   // subpixel refinement of the stereo matches
@@ -378,7 +477,7 @@ namespace cvt
 	   float bd = 0.0f;
        //int counter = 0;
 	   for( size_t i = 0; i < stereoMatches.size(); ++i ){
-		   DescriptorDatabase::PatchType* patch = new DescriptorDatabase::PatchType( _pyrLeft.octaves() );
+		   DescriptorDatabase::PatchType* patch = new DescriptorDatabase::PatchType( _current->pyrLeft.octaves() );
 		   const FeatureMatch& m = stereoMatches[ i ];
 		   const Vector2f& posL = m.feature0->pt;
 		   const Vector2f& posR = m.feature1->pt;
@@ -438,8 +537,8 @@ namespace cvt
 
    void StereoSLAM::clear()
    {
-      if( _bundler.isRunning() )
-         _bundler.join();
+      _bundler.clear();
+      _lastSBAKeyframes = 0;
 
       _map.clear();
 
@@ -463,17 +562,14 @@ namespace cvt
    {
 	   // a new keyframe should have a minimum number of features
 	  if( ( newPoints3d.size() + trackedMapPoints.size() ) < _params.minFeaturesForKeyframe ){
-		  std::cout << "Could only triangulate " << newPoints3d.size() << " new features " << std::endl;
+		  if( _params.verbose )
+			  std::cout << "Could only triangulate " << newPoints3d.size() << " new features " << std::endl;
 		  return;
 	  }
-	  // wait until current ba thread is ready
-	  if( _bundler.isRunning() ){
-		  _bundler.join();
-	  }
-
 	  keyframeAdded.notify();
 	  mapChanged.notify( _map );
-	  std::cout << "Triangulated: " << newPoints3d.size() << std::endl;
+	  if( _params.verbose )
+		  std::cout << "Triangulated: " << newPoints3d.size() << std::endl;
 	   // add a new Keyframe to the map
 	   Eigen::Matrix4d transform( _pose.transformation().cast<double>() );
 
@@ -515,11 +611,11 @@ namespace cvt
 	   }
 
        /* bundle adjust */
-       static size_t lastNKF = 0;
-       if( _params.useSBA && ( _map.numKeyframes() - lastNKF ) > _params.sbaDeltaKeyframes ){
+       if( _params.useSBA && ( _map.numKeyframes() - _lastSBAKeyframes ) > _params.sbaDeltaKeyframes ){
            _bundler.setMaxIterations( _params.sbaIterations );
-           lastNKF = _map.numKeyframes();
-           _bundler.run( &_map );
+           _bundler.setWindowSize( _params.sbaWindowSize );
+           _lastSBAKeyframes = _map.numKeyframes();
+           _bundler.optimize( _map, kid );
        }
    }
 
@@ -533,12 +629,14 @@ namespace cvt
 
 	  // if distance is too far from active, always create a new one:
 	  if( kfDist > _params.maxKeyframeDistance ){
-		  std::cout << "New keyframe needed - too far from active keyframe: " << kfDist << std::endl;
+		  if( _params.verbose )
+			  std::cout << "New keyframe needed - too far from active keyframe: " << kfDist << std::endl;
 		  return true;
 	  }
 
 	  if( numTrackedFeatures < _params.minTrackedFeatures ){
-		  std::cout << "New keyframe needed - too few inliers: " << numTrackedFeatures << std::endl;
+		  if( _params.verbose )
+			  std::cout << "New keyframe needed - too few inliers: " << numTrackedFeatures << std::endl;
 		  return true;
 	  }
 
@@ -584,7 +682,7 @@ namespace cvt
             const MatchingIndices& m = matchedIndices[ i ];
 
             // draw the current feature here:
-            const Vector2f& p = ( *_descExtractorLeft )[ m.dstIdx ].pt;
+            const Vector2f& p = ( *_current->descLeft )[ m.dstIdx ].pt;
             g.setColor( Color::PINK );
             g.fillRect( ( int )p.x - 2, ( int )p.y - 2, 5, 5 );
 
@@ -629,8 +727,8 @@ namespace cvt
         typedef std::vector<FeatureMatch> FeatureMatches;
 
         cvt::Image left, right;
-        _pyrLeft[ 0 ].convert( left, IFormat::RGBA_UINT8 );
-        _pyrRight[ 0 ].convert( right, IFormat::RGBA_UINT8 );
+        _current->pyrLeft[ 0 ].convert( left, IFormat::RGBA_UINT8 );
+        _current->pyrRight[ 0 ].convert( right, IFormat::RGBA_UINT8 );
 
 
         debugImage.reallocate( left.width(),
@@ -36,6 +36,7 @@
 #include <cvt/vision/StereoCameraCalibration.h>
 #include <cvt/vision/slam/stereo/FeatureTracking.h>
 #include <cvt/vision/slam/stereo/MapOptimizer.h>
+#include <cvt/util/Thread.h>
 #include <set>
 
 namespace cvt
@@ -70,10 +71,13 @@ namespace cvt
                    useSBA( false ),
                    sbaIterations( 5 ),
                    sbaDeltaKeyframes( 1 ),
+                   sbaWindowSize( 10 ),
 				   dbgShowFeatures( false ),
 				   dbgShowNMSFilteredFeatures( false ),
 				   dbgShowBest3kFeatures( false ),
-				   dbgShowStereoMatches( false )
+				   dbgShowStereoMatches( false ),
+				   pipelined( false ),
+				   verbose( false )
 				{
 				}
 
@@ -117,18 +121,29 @@ namespace cvt
                  * added since last sba run */
                 size_t  sbaDeltaKeyframes;
 
+                /* number of covisible keyframes optimized together,
+                 * sba runs in the background on a copy of this window */
+                size_t  sbaWindowSize;
+
 				/* debug params */
 				bool dbgShowFeatures;
 				bool dbgShowNMSFilteredFeatures;
 				bool dbgShowBest3kFeatures;
 				bool dbgShowStereoMatches;
+
+				/* extract the features of the next frame while tracking
+				 * the current one: results are delayed by one frame */
+				bool pipelined;
+
+				/* print tracking statistics to stdout */
+				bool verbose;
 		   };
 
 		   StereoSLAM( FeatureDetector* detector,
 					   FeatureDescriptorExtractor* descExtractor,
 					   const StereoCameraCalibration& calib,
 					   const Params& params=Params());
-
+		   ~StereoSLAM();
 
 		 /**
 		  * @brief newImages
@@ -138,6 +153,11 @@ namespace cvt
 		 void				newImages( const Image& imgLeft,
 									   const Image& imgRight );
 
+		 /**
+		  * @brief track the frame still pending in pipelined mode
+		  */
+		 void				flush();
+
 		 const SlamMap&		map() const { return _map; }
 
 		 void				clear();
@@ -175,14 +195,74 @@ namespace cvt
 			size_t size() const { return points3d.size(); }
 		 };
 
+		 /* result of the feature extraction stage for one stereo pair */
+		 struct StereoFrame {
+			StereoFrame( size_t octaves, float scaleFactor,
+						 FeatureDescriptorExtractor* left,
+						 FeatureDescriptorExtractor* right ) :
+				pyrLeft( octaves, scaleFactor ),
+				pyrRight( octaves, scaleFactor ),
+				descLeft( left ),
+				descRight( right ),
+				valid( false )
+			{
+			}
+
+			~StereoFrame()
+			{
+				delete descLeft;
+				delete descRight;
+			}
+
+			ImagePyramid				pyrLeft;
+			ImagePyramid				pyrRight;
+			FeatureDescriptorExtractor* descLeft;
+			FeatureDescriptorExtractor* descRight;
+
+			/* intermediate left features, only kept for the debug image */
+			FeatureSet					dbgDetected;
+			FeatureSet					dbgNMSFiltered;
+			FeatureSet					dbgBest;
+			bool						valid;
+		 };
+
+		 /* runs the extraction stage of the next frame in pipelined mode */
+		 class ExtractionThread : public Thread<StereoFrame> {
+			public:
+			   ExtractionThread( StereoSLAM& slam ) : _slam( slam ), _left( NULL ), _right( NULL ), _debug( false ) {}
+
+			   void start( StereoFrame* frame, const Image& left, const Image& right, bool debug )
+			   {
+				   _left = &left;
+				   _right = &right;
+				   _debug = debug;
+				   run( frame );
+			   }
+
+			   void execute( StereoFrame* frame ) { _slam.extractFeatures( *frame, *_left, *_right, _debug ); }
+
+			private:
+			   StereoSLAM&	_slam;
+			   const Image* _left;
+			   const Image* _right;
+			   bool			_debug;
+		 };
+
+		 struct ExtractSides;
+		 friend class ExtractionThread;
+		 friend struct ExtractSides;
+
 		 typedef DescriptorDatabase::PatchType	PatchType;
 		 Params						 _params;
 		 FeatureDetector*			 _detector;
-		 FeatureDescriptorExtractor* _descExtractorLeft;
-		 FeatureDescriptorExtractor* _descExtractorRight;
+		 FeatureDetector*			 _detectorRight;
 		 DescriptorDatabase			 _descriptorDatabase;
-		 ImagePyramid				 _pyrLeft;
-		 ImagePyramid				 _pyrRight;
+
+		 /* double buffered extraction results: _current is tracked,
+		  * _pending is filled concurrently in pipelined mode */
+		 StereoFrame*				 _current;
+		 StereoFrame*				 _pending;
+		 ExtractionThread			 _extractionThread;
 
 		 /* float versions for KLT */
 		 ImagePyramid				 _pyrLeftf;
@@ -201,10 +281,14 @@ namespace cvt
          Eigen::Matrix4d             _keyframeRelativePose;
 		 SlamMap					 _map;
 		 MapOptimizer				 _bundler;
+		 size_t						 _lastSBAKeyframes;
 		 Image						 _lastImage;
 		 Image						 _debugMono;
 
-		 void extractFeatures( const Image& left, const Image& right );
+		 void extractFeatures( StereoFrame& frame, const Image& left, const Image& right, bool debug ) const;
+		 void extractSide( StereoFrame& frame, size_t side, const Image& img, bool debug ) const;
+		 void trackFrame( StereoFrame& frame );
+		 bool debugFeaturesWanted();
 
 		 void predictVisibleFeatures( std::vector<Vector2f>& imgPositions,
 									  std::vector<size_t>& ids,